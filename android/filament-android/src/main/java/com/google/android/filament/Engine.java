@@ -229,7 +229,8 @@ public class Engine {
                     config.resourceAllocatorCacheSizeMB, config.resourceAllocatorCacheMaxAge,
                     config.disableHandleUseAfterFreeCheck,
                     config.preferredShaderLanguage.ordinal(),
-                    config.forceGLES2Context, config.assertNativeWindowIsValid);
+                    config.forceGLES2Context, config.assertNativeWindowIsValid,
+                    config.maxCommandBufferSizeMB, config.readbackBufferCount);
             return this;
         }
 
@@ -471,6 +472,32 @@ public class Engine {
          *      - PlatformEGLAndroid
          */
         public boolean assertNativeWindowIsValid = false;
+
+        /**
+         * Maximum size in MiB the low-level command buffer arena is allowed to grow to.
+         *
+         * When the engine has to stall for several consecutive frames, waiting for the backend to
+         * free up space in the command buffer arena, the arena is grown at the end of a frame,
+         * up to this size. Growing requires waiting for the backend to process all pending
+         * commands, which happens at most once per growth step.
+         *
+         * If 0 or smaller than commandBufferSizeMB, the arena never grows.
+         *
+         * This value affects the application's memory usage.
+         */
+        public long maxCommandBufferSizeMB = 0;
+
+        /**
+         * Number of buffers the OpenGL backend keeps around to stage
+         * {@link Renderer#readPixels} readbacks. Applications reading back every frame, e.g. to
+         * encode a video, should set this to the number of readbacks in flight, usually 2 or 3.
+         * Larger values use more GPU memory.
+         *
+         * 0 disables the reuse of these buffers.
+         *
+         * Only respected by the OpenGL backend.
+         */
+        public long readbackBufferCount = 3;
     }
 
     private Engine(long nativeEngine, Config config) {
@@ -672,6 +699,34 @@ public class Engine {
         return nIsAutomaticInstancingEnabled(getNativeObject());
     }
 
+    /**
+     * Enables or disables the merging of render primitives into indirect multi-draws.
+     * Consecutive render primitives of a renderable that share the same geometry (vertex and
+     * index buffers) and MaterialInstance, but draw different ranges of indices, are then drawn
+     * with a single draw call, which can greatly reduce CPU overhead for renderables made of
+     * many primitives.
+     *
+     * This has no effect if the backend doesn't support indexed multi-draw-indirect, in which
+     * case {@link #isMultiDrawIndirectEnabled} keeps returning false.
+     *
+     * Disabled by default.
+     *
+     * @param enable true to enable, false to disable multi-draw-indirect.
+     *
+     * @see RenderableManager.Builder#geometry
+     */
+    public void setMultiDrawIndirectEnabled(boolean enable) {
+        nSetMultiDrawIndirectEnabled(getNativeObject(), enable);
+    }
+
+    /**
+     * @return true if multi-draw-indirect is enabled, false otherwise.
+     * @see #setMultiDrawIndirectEnabled
+     */
+    public boolean isMultiDrawIndirectEnabled() {
+        return nIsMultiDrawIndirectEnabled(getNativeObject());
+    }
+
     /**
      * Retrieves the configuration settings of this {@link Engine}.
      *
@@ -1401,6 +1456,8 @@ public class Engine {
     private static native long nGetEntityManager(long nativeEngine);
     private static native void nSetAutomaticInstancingEnabled(long nativeEngine, boolean enable);
     private static native boolean nIsAutomaticInstancingEnabled(long nativeEngine);
+    private static native void nSetMultiDrawIndirectEnabled(long nativeEngine, boolean enable);
+    private static native boolean nIsMultiDrawIndirectEnabled(long nativeEngine);
     private static native long nGetMaxStereoscopicEyes(long nativeEngine);
     private static native int nGetSupportedFeatureLevel(long nativeEngine);
     private static native int nSetActiveFeatureLevel(long nativeEngine, int ordinal);
@@ -1416,7 +1473,8 @@ public class Engine {
             long resourceAllocatorCacheSizeMB, long resourceAllocatorCacheMaxAge,
             boolean disableHandleUseAfterFreeCheck,
             int preferredShaderLanguage,
-            boolean forceGLES2Context, boolean assertNativeWindowIsValid);
+            boolean forceGLES2Context, boolean assertNativeWindowIsValid,
+            long maxCommandBufferSizeMB, long readbackBufferCount);
     private static native void nSetBuilderFeatureLevel(long nativeBuilder, int ordinal);
     private static native void nSetBuilderSharedContext(long nativeBuilder, long sharedContext);
     private static native void nSetBuilderPaused(long nativeBuilder, boolean paused);
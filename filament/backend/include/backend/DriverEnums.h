@@ -500,9 +500,24 @@ enum class ElementType : uint8_t {
 enum class BufferObjectBinding : uint8_t {
     VERTEX,
     UNIFORM,
-    SHADER_STORAGE
+    SHADER_STORAGE,
+    DRAW_INDIRECT       //!< holds DrawIndexedIndirectArgs, see DriverApi::drawIndirect()
 };
 
+/**
+ * Arguments of a single indexed draw, as read by DriverApi::drawIndirect() from a
+ * BufferObjectBinding::DRAW_INDIRECT buffer object. The layout is the one expected by
+ * glMultiDrawElementsIndirect() and vkCmdDrawIndexedIndirect().
+ */
+struct DrawIndexedIndirectArgs {
+    uint32_t indexCount;        //!< number of indices to draw
+    uint32_t instanceCount;     //!< number of instances to draw
+    uint32_t firstIndex;        //!< index of the first index to draw, in indices (not bytes)
+    int32_t baseVertex;         //!< value added to each index, must be 0 for now
+    uint32_t baseInstance;      //!< must be 0
+};
+static_assert(sizeof(DrawIndexedIndirectArgs) == 20);
+
 //! Face culling Mode
 enum class CullingMode : uint8_t {
     NONE,               //!< No culling, front and back faces are visible
@@ -1319,6 +1334,16 @@ static_assert(sizeof(StencilState::StencilOperations) == 5u,
 static_assert(sizeof(StencilState) == 12u,
         "StencilState size not what was intended");
 
+/**
+ * Number of graphics API state changes requested during a frame, split between those that
+ * resulted in an API call and those skipped because the state was already set. A raster or
+ * stencil state that is skipped as a whole counts as a single elided change.
+ */
+struct StateChangeStatistics {
+    uint32_t issued = 0;    //!< state changes sent to the graphics API
+    uint32_t elided = 0;    //!< redundant state changes that were skipped
+};
+
 using FrameScheduledCallback = utils::Invocable<void(backend::PresentCallable)>;
 
 enum class Workaround : uint16_t {
@@ -98,6 +98,12 @@ public:
          *      - PlatformEGLAndroid
          */
         bool assertNativeWindowIsValid = false;
+
+        /**
+         * Number of unused readback buffers kept around to be reused by readPixels() and
+         * readBufferSubData(). Only honored by the GL backend.
+         */
+        size_t readbackBufferCount = 3;
     };
 
     Platform() noexcept;
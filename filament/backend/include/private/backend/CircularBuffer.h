@@ -42,9 +42,13 @@ public:
 
     static size_t getBlockSize() noexcept { return sPageSize; }
 
-    // Total size of circular buffer. This is a constant.
+    // Total size of circular buffer. This only changes with resize().
     size_t size() const noexcept { return mSize; }
 
+    // Reallocates the circular buffer with a new size. The buffer must be empty and none of the
+    // ranges returned by getBuffer() can be in use anymore.
+    void resize(size_t bufferSize) noexcept;
+
     // Allocates `s` bytes in the circular buffer and returns a pointer to the memory. All
     // allocations must not exceed size() bytes.
     inline void* allocate(size_t s) noexcept {
@@ -79,8 +83,8 @@ private:
     void* mData = nullptr;
     int mAshmemFd = -1;
 
-    // size of the circular buffer (constant)
-    size_t const mSize;
+    // size of the circular buffer
+    size_t mSize;
 
     // pointer to the beginning of recorded data
     void* mTail = nullptr;
@@ -22,6 +22,7 @@
 #include <utils/Condition.h>
 #include <utils/Mutex.h>
 
+#include <chrono>
 #include <vector>
 
 #include <stddef.h>
@@ -33,12 +34,28 @@ namespace filament::backend {
  * A producer-consumer command queue that uses a CircularBuffer as main storage
  */
 class CommandBufferQueue {
+public:
+    // Statistics accumulated between two calls to endFrame()
+    struct Statistics {
+        size_t bytesRecorded = 0;               // size of the commands flushed
+        std::chrono::nanoseconds blocked{};     // time flush() spent waiting for the driver
+        uint32_t blockedCount = 0;              // number of times flush() had to wait
+        uint32_t queueDepth = 0;                // buffers waiting to be executed at endFrame()
+        size_t highWatermark = 0;               // highest number of bytes in use, ever
+        size_t bufferSize = 0;                  // current size of the circular buffer
+    };
+
+private:
     struct Range {
         void* begin;
         void* end;
     };
 
+    // number of consecutive frames flush() must block before the circular buffer is grown
+    static constexpr uint32_t GROW_AFTER_BLOCKED_FRAME_COUNT = 3;
+
     const size_t mRequiredSize;
+    const size_t mMaxBufferSize;
 
     CircularBuffer mCircularBuffer;
 
@@ -52,11 +69,17 @@ class CommandBufferQueue {
     uint32_t mExitRequested = 0;
     bool mPaused = false;
 
+    // only accessed from the thread calling flush()
+    Statistics mStatistics;
+    uint32_t mBlockedFrameCount = 0;
+
     static constexpr uint32_t EXIT_REQUESTED = 0x31415926;
 
 public:
     // requiredSize: guaranteed available space after flush()
-    CommandBufferQueue(size_t requiredSize, size_t bufferSize, bool paused);
+    // maxBufferSize: size the circular buffer is allowed to grow to, 0 to disable growing.
+    CommandBufferQueue(size_t requiredSize, size_t bufferSize, bool paused,
+            size_t maxBufferSize = 0);
     ~CommandBufferQueue();
 
     CircularBuffer& getCircularBuffer() noexcept { return mCircularBuffer; }
@@ -66,6 +89,12 @@ public:
 
     size_t getHighWatermark() const noexcept { return mHighWatermark; }
 
+    // Marks a frame boundary and returns the statistics accumulated since the previous call.
+    // If flush() had to block during several consecutive frames and growing is enabled, the
+    // circular buffer is grown here, which requires waiting for all pending commands to be
+    // executed. Must be called from the thread calling flush(), right after flush().
+    Statistics endFrame();
+
     // wait for commands to be available and returns an array containing these commands
     std::vector<Range> waitForCommands() const;
 
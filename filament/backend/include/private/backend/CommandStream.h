@@ -18,6 +18,7 @@
 #define TNT_FILAMENT_BACKEND_PRIVATE_COMMANDSTREAM_H
 
 #include "private/backend/CircularBuffer.h"
+#include "private/backend/CommandStreamCapture.h"
 #include "private/backend/Dispatcher.h"
 #include "private/backend/Driver.h"
 
@@ -215,10 +216,22 @@ public:
 
     CircularBuffer const& getCircularBuffer() const noexcept { return mCurrentBuffer; }
 
+    /*
+     * When a CommandStreamCapture is set, all subsequent commands are also recorded into it
+     * (synchronous calls are not recorded). Set to nullptr to stop capturing.
+     * The capture must outlive this CommandStream or be removed before it's destroyed.
+     */
+    void setCapture(CommandStreamCapture* capture) noexcept { mCapture = capture; }
+
+    CommandStreamCapture* getCapture() const noexcept { return mCapture; }
+
 public:
 #define DECL_DRIVER_API(methodName, paramsDecl, params)                                         \
     inline void methodName(paramsDecl) {                                                        \
         DEBUG_COMMAND_BEGIN(methodName, false, params);                                         \
+        if (UTILS_UNLIKELY(mCapture)) {                                                         \
+            mCapture->record(CommandId::methodName, params);                                    \
+        }                                                                                       \
         using Cmd = COMMAND_TYPE(methodName);                                                   \
         void* const p = allocateCommand(CommandBase::align(sizeof(Cmd)));                       \
         new(p) Cmd(mDispatcher.methodName##_, APPLY(std::move, params));                        \
@@ -238,6 +251,9 @@ public:
     inline RetType methodName(paramsDecl) {                                                     \
         DEBUG_COMMAND_BEGIN(methodName, false, params);                                         \
         RetType result = mDriver.methodName##S();                                               \
+        if (UTILS_UNLIKELY(mCapture)) {                                                         \
+            mCapture->record(CommandId::methodName, result, params);                            \
+        }                                                                                       \
         using Cmd = COMMAND_TYPE(methodName##R);                                                \
         void* const p = allocateCommand(CommandBase::align(sizeof(Cmd)));                       \
         new(p) Cmd(mDispatcher.methodName##_, RetType(result), APPLY(std::move, params));       \
@@ -291,6 +307,7 @@ private:
     Driver& UTILS_RESTRICT mDriver;
     CircularBuffer& UTILS_RESTRICT mCurrentBuffer;
     Dispatcher mDispatcher;
+    CommandStreamCapture* mCapture = nullptr;
 
 #ifndef NDEBUG
     // just for debugging...
@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_BACKEND_PRIVATE_COMMANDSTREAMCAPTURE_H
+#define TNT_FILAMENT_BACKEND_PRIVATE_COMMANDSTREAMCAPTURE_H
+
+#include <backend/BufferDescriptor.h>
+#include <backend/DescriptorSetOffsetArray.h>
+#include <backend/DriverEnums.h>
+#include <backend/Handle.h>
+#include <backend/PipelineState.h>
+#include <backend/PixelBufferDescriptor.h>
+#include <backend/Program.h>
+#include <backend/TargetBufferInfo.h>
+
+#include <utils/CString.h>
+#include <utils/Invocable.h>
+
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament::backend {
+
+class CommandStream;
+
+/*
+ * Identifies a recorded DriverApi command. The values are generated from DriverAPI.inc, so
+ * a capture is only guaranteed to replay with the same version of the backend that produced it.
+ * Synchronous calls are not commands and are never recorded.
+ */
+enum class CommandId : uint16_t {
+#define DECL_DRIVER_API(methodName, paramsDecl, params) methodName,
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params) methodName,
+#include "private/backend/DriverAPI.inc"
+    COUNT
+};
+
+const char* getCommandName(CommandId id) noexcept;
+
+/*
+ * CommandStreamCapture serializes DriverApi commands, along with the content of their
+ * BufferDescriptor and PixelBufferDescriptor payloads, so they can be replayed later on any
+ * Driver with CommandStreamReplay.
+ *
+ * Pointers that only make sense in the recording process (native windows, callbacks, user data)
+ * are not recorded and are replayed as nullptr.
+ *
+ * A capture only knows about the resources created while it's recording. To replay a capture
+ * started in the middle of a session, a RESOURCES capture must be set on the CommandStream
+ * before any resource is created. A capture constructed from it starts with a preamble that
+ * re-creates all the live resources.
+ *
+ * CommandStreamCapture is not thread-safe, it must be used from the thread that writes into
+ * the CommandStream (see CommandStream::setCapture()).
+ */
+class CommandStreamCapture {
+public:
+    static constexpr uint32_t MAGIC = 0x43534346;   // 'FCSC'
+    static constexpr uint32_t VERSION = 2;
+
+    enum class Mode : uint8_t {
+        // Records all the commands
+        COMMANDS,
+        // Only keeps the commands that created the live resources, and for each part of their
+        // state (a descriptor, a range of a buffer, a region of a texture...), the last command
+        // that changed it. The commands that destroy a resource drop all of its commands.
+        RESOURCES
+    };
+
+    explicit CommandStreamCapture(Mode mode = Mode::COMMANDS) noexcept;
+
+    // Creates a COMMANDS capture whose preamble re-creates the resources tracked by resources,
+    // a RESOURCES capture. The new capture forwards all the commands it records to resources,
+    // which therefore stays up to date.
+    explicit CommandStreamCapture(CommandStreamCapture* resources) noexcept;
+
+    ~CommandStreamCapture() noexcept;
+
+    CommandStreamCapture(CommandStreamCapture const&) = delete;
+    CommandStreamCapture& operator=(CommandStreamCapture const&) = delete;
+
+    template<typename ... ARGS>
+    void record(CommandId id, ARGS const& ... args) {
+        // The descriptor set commands need bookkeeping, because the size of
+        // DescriptorSetOffsetArray is implied by the layout of the descriptor set it is bound
+        // with. They're selected by their parameter types, so that overload resolution of the
+        // other commands never has to look at these signatures.
+        using Params = std::tuple<std::decay_t<ARGS>...>;
+        if constexpr (std::is_same_v<Params,
+                std::tuple<DescriptorSetLayoutHandle, DescriptorSetLayout>>) {
+            recordDescriptorSetLayout(id, args...);
+        } else if constexpr (std::is_same_v<Params,
+                std::tuple<DescriptorSetHandle, DescriptorSetLayoutHandle>>) {
+            recordDescriptorSet(id, args...);
+        } else if constexpr (std::is_same_v<Params,
+                std::tuple<DescriptorSetHandle, descriptor_set_t, DescriptorSetOffsetArray>>) {
+            recordBindDescriptorSet(id, args...);
+        } else {
+            size_t const offset = beginCommand(id);
+            (serialize(args), ...);
+            endCommand(offset);
+        }
+        if (mResources) {
+            mResources->record(id, args...);
+        }
+    }
+
+    // number of commands recorded so far, including the preamble
+    size_t getCommandCount() const noexcept { return mCommandCount; }
+
+    // number of commands of the preamble, i.e. that re-create the resources
+    size_t getPreambleCommandCount() const noexcept { return mPreambleCommandCount; }
+
+    // the RESOURCES capture this capture was created with, or nullptr
+    CommandStreamCapture* getResources() const noexcept { return mResources; }
+
+    // size in bytes of the capture so far
+    size_t getSize() const noexcept { return mData.size(); }
+
+    // the capture, including its header
+    void const* getData() const noexcept { return mData.data(); }
+
+    // discards all recorded commands, except the preamble which is written again
+    void clear() noexcept;
+
+    // writes the capture to a file, returns false on error.
+    bool save(const char* path) const noexcept;
+
+private:
+    // A command kept by a RESOURCES capture
+    struct KeptCommand {
+        uint64_t slot;          // the part of the resource it changes, 0 for its creation
+        uint64_t sequence;      // commands are replayed in this order
+        std::vector<uint8_t> data;
+    };
+
+    size_t beginCommand(CommandId id);
+    void endCommand(size_t offset);
+    void write(void const* data, size_t size);
+    void keepCommand(size_t offset);
+    void writePreamble();
+
+    void recordDescriptorSetLayout(CommandId id,
+            DescriptorSetLayoutHandle dslh, DescriptorSetLayout const& info);
+    void recordDescriptorSet(CommandId id,
+            DescriptorSetHandle dsh, DescriptorSetLayoutHandle dslh);
+    void recordBindDescriptorSet(CommandId id,
+            DescriptorSetHandle dsh, descriptor_set_t set, DescriptorSetOffsetArray const& offsets);
+
+    template<typename T, typename = std::enable_if_t<std::is_trivially_copyable_v<T>>>
+    void serialize(T const& value) {
+        write(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void serialize(Handle<T> const& handle) {
+        HandleBase::HandleId const id = handle.getId();
+        write(&id, sizeof(id));
+    }
+
+    // pointers are meaningless outside the recording process
+    template<typename T>
+    void serialize(T* const&) { }
+
+    template<typename T>
+    void serialize(utils::Invocable<T> const&) { }
+
+    void serialize(const char* const& string);
+    void serialize(utils::CString const& string);
+    void serialize(BufferDescriptor const& data);
+    void serialize(PixelBufferDescriptor const& data);
+    void serialize(TargetBufferInfo const& info);
+    void serialize(MRT const& mrt);
+    void serialize(PipelineState const& state);
+    void serialize(DescriptorSetLayout const& info);
+    void serialize(Program const& program);
+
+    std::vector<uint8_t> mData;
+    size_t mCommandCount = 0;
+    size_t mPreambleCommandCount = 0;
+    std::unordered_map<HandleBase::HandleId, uint32_t> mDynamicOffsetCounts;
+    CommandStreamCapture* const mResources = nullptr;
+    Mode const mMode;
+
+    // RESOURCES mode: the commands kept for each live resource, its creation first
+    std::unordered_map<HandleBase::HandleId, std::vector<KeptCommand>> mKeptCommands;
+    uint64_t mSequence = 0;
+};
+
+/*
+ * CommandStreamReplay replays a capture produced by CommandStreamCapture into a CommandStream.
+ *
+ * Handles created by the replayed commands are remapped to the handles of the replaying
+ * driver. Handles that were created before the capture started, and aren't re-created by its
+ * preamble, can't be resolved and are replayed as null handles; only the NoopDriver tolerates
+ * those.
+ */
+class CommandStreamReplay {
+public:
+    // data must contain a full capture, as returned by CommandStreamCapture::getData()
+    explicit CommandStreamReplay(std::vector<uint8_t> data) noexcept;
+    ~CommandStreamReplay() noexcept;
+
+    CommandStreamReplay(CommandStreamReplay const&) = delete;
+    CommandStreamReplay& operator=(CommandStreamReplay const&) = delete;
+
+    // reads a capture from a file, the returned object is invalid on error
+    static CommandStreamReplay load(const char* path);
+
+    CommandStreamReplay(CommandStreamReplay&& rhs) noexcept;
+
+    // returns true if the capture header was recognized
+    bool isValid() const noexcept { return mValid; }
+
+    // true when all commands have been replayed
+    bool done() const noexcept { return !mValid || mCurrent == mData.size(); }
+
+    // restarts the replay from the first command, handle mappings are forgotten
+    void rewind() noexcept;
+
+    // true while the commands of the preamble are replayed
+    bool inPreamble() const noexcept { return mValid && mCurrent < mFrameOffset; }
+
+    // Restarts the replay from the first command after the preamble. The resources created by
+    // the preamble are kept, so that the captured commands can be replayed several times.
+    void rewindToFrame() noexcept;
+
+    // Replays the next command into driverApi. Returns the id of the replayed command,
+    // or CommandId::COUNT if the capture is exhausted or corrupted.
+    CommandId replayNextCommand(CommandStream& driverApi);
+
+    // number of handles referenced by the capture that couldn't be resolved
+    size_t getUnresolvedHandleCount() const noexcept { return mUnresolvedHandleCount; }
+
+private:
+    struct Reader;
+    friend struct Reader;
+
+    std::vector<uint8_t> mData;
+    size_t mCurrent = 0;
+    size_t mFrameOffset = 0;
+    size_t mUnresolvedHandleCount = 0;
+    std::unordered_map<HandleBase::HandleId, HandleBase::HandleId> mHandles;
+    bool mValid = false;
+};
+
+} // namespace filament::backend
+
+#endif // TNT_FILAMENT_BACKEND_PRIVATE_COMMANDSTREAMCAPTURE_H
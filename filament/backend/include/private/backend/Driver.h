@@ -79,6 +79,10 @@ public:
     // the default implementation simply calls fn
     virtual void execute(std::function<void(void)> const& fn);
 
+    // called on the render-thread, returns the state changes made since the last beginFrame()
+    // the default implementation returns zeros, i.e. the statistics are not tracked
+    virtual StateChangeStatistics getStateChangeStatistics() const noexcept;
+
     // This is called on debug build, or when enabled manually on the backend thread side.
     virtual void debugCommandBegin(CommandStream* cmds,
             bool synchronous, const char* methodName) noexcept = 0;
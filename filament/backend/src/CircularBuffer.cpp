@@ -55,6 +55,15 @@ CircularBuffer::~CircularBuffer() noexcept {
     dealloc();
 }
 
+void CircularBuffer::resize(size_t bufferSize) noexcept {
+    assert_invariant(empty());
+    dealloc();
+    mSize = bufferSize;
+    mData = alloc(bufferSize);
+    mTail = mData;
+    mHead = mData;
+}
+
 // If the system support mmap(), use it for creating a "hard circular buffer" where two virtual
 // address ranges are mapped to the same physical pages.
 //
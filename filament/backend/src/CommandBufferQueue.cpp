@@ -27,6 +27,7 @@
 #include <utils/debug.h>
 
 #include <algorithm>
+#include <chrono>
 #include <mutex>
 #include <iterator>
 #include <utility>
@@ -39,8 +40,10 @@ using namespace utils;
 
 namespace filament::backend {
 
-CommandBufferQueue::CommandBufferQueue(size_t requiredSize, size_t bufferSize, bool paused)
+CommandBufferQueue::CommandBufferQueue(size_t requiredSize, size_t bufferSize, bool paused,
+        size_t maxBufferSize)
         : mRequiredSize((requiredSize + (CircularBuffer::getBlockSize() - 1u)) & ~(CircularBuffer::getBlockSize() -1u)),
+          mMaxBufferSize((maxBufferSize + (CircularBuffer::getBlockSize() - 1u)) & ~(CircularBuffer::getBlockSize() -1u)),
           mCircularBuffer(bufferSize),
           mFreeSpace(mCircularBuffer.size()),
           mPaused(paused) {
@@ -115,18 +118,19 @@ void CommandBufferQueue::flush() noexcept {
     mCommandBuffersToExecute.push_back({ begin, end });
     mCondition.notify_one();
 
+    size_t const totalUsed = circularBuffer.size() - mFreeSpace;
+    mHighWatermark = std::max(mHighWatermark, totalUsed);
+    mStatistics.bytesRecorded += used;
+
     // wait until there is enough space in the buffer
     if (UTILS_UNLIKELY(mFreeSpace < requiredSize)) {
 
 #ifndef NDEBUG
-        size_t const totalUsed = circularBuffer.size() - mFreeSpace;
         slog.d << "CommandStream used too much space (will block): "
                 << "needed space " << requiredSize << " out of " << mFreeSpace
                 << ", totalUsed=" << totalUsed << ", current=" << used
                 << ", queue size=" << mCommandBuffersToExecute.size() << " buffers"
                 << io::endl;
-
-        mHighWatermark = std::max(mHighWatermark, totalUsed);
 #endif
 
         SYSTRACE_NAME("waiting: CircularBuffer::flush()");
@@ -135,13 +139,55 @@ void CommandBufferQueue::flush() noexcept {
                 "CommandStream is full, but since the rendering thread is paused, "
                 "the buffer cannot flush and we will deadlock. Instead, abort.";
 
+        auto const start = std::chrono::steady_clock::now();
         mCondition.wait(lock, [this, requiredSize]() -> bool {
             // TODO: on macOS, we need to call pumpEvents from time to time
             return mFreeSpace >= requiredSize;
         });
+        mStatistics.blocked += std::chrono::steady_clock::now() - start;
+        mStatistics.blockedCount++;
     }
 }
 
+CommandBufferQueue::Statistics CommandBufferQueue::endFrame() {
+    Statistics statistics = mStatistics;
+    mStatistics = {};
+
+    mBlockedFrameCount = statistics.blockedCount ? mBlockedFrameCount + 1 : 0;
+
+    std::unique_lock<utils::Mutex> lock(mLock);
+    statistics.queueDepth = uint32_t(mCommandBuffersToExecute.size());
+    statistics.highWatermark = mHighWatermark;
+
+    CircularBuffer& circularBuffer = mCircularBuffer;
+    size_t const currentSize = circularBuffer.size();
+    if (UTILS_UNLIKELY(UTILS_HAS_THREADING &&
+            mBlockedFrameCount >= GROW_AFTER_BLOCKED_FRAME_COUNT &&
+            currentSize < mMaxBufferSize && circularBuffer.empty() &&
+            !mPaused && !mExitRequested)) {
+        SYSTRACE_NAME("CommandBufferQueue::grow");
+
+        // the circular buffer can only be reallocated once the driver thread has released
+        // all the command buffers.
+        mCondition.wait(lock, [this]() -> bool {
+            return mFreeSpace == mCircularBuffer.size() || mExitRequested;
+        });
+
+        if (!mExitRequested) {
+            size_t const newSize = std::min(currentSize * 2, mMaxBufferSize);
+            circularBuffer.resize(newSize);
+            mFreeSpace = circularBuffer.size();
+            slog.i << "CommandStream kept blocking, growing the command buffer from "
+                    << currentSize / 1024 << " KiB to " << newSize / 1024 << " KiB"
+                    << io::endl;
+        }
+        mBlockedFrameCount = 0;
+    }
+
+    statistics.bufferSize = circularBuffer.size();
+    return statistics;
+}
+
 std::vector<CommandBufferQueue::Range> CommandBufferQueue::waitForCommands() const {
     if (!UTILS_HAS_THREADING) {
         return std::move(mCommandBuffersToExecute);
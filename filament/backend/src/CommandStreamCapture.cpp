@@ -0,0 +1,808 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "private/backend/CommandStreamCapture.h"
+#include "private/backend/CommandStream.h"
+#include "private/backend/DriverApi.h"
+
+#include <backend/BufferDescriptor.h>
+#include <backend/DescriptorSetOffsetArray.h>
+#include <backend/DriverEnums.h>
+#include <backend/Handle.h>
+#include <backend/PipelineState.h>
+#include <backend/PixelBufferDescriptor.h>
+#include <backend/Program.h>
+#include <backend/TargetBufferInfo.h>
+
+#include <utils/CString.h>
+#include <utils/FixedCapacityVector.h>
+#include <utils/Log.h>
+#include <utils/debug.h>
+#include <utils/ostream.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace utils;
+
+namespace filament::backend {
+
+namespace {
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t frameOffset;   // offset of the first command after the preamble
+};
+
+struct CommandHeader {
+    uint16_t id;
+    uint16_t reserved;
+    uint32_t size;      // size of the arguments, not including this header
+};
+
+// The commands returning a handle create a resource
+constexpr bool CREATES_RESOURCE[] = {
+#define DECL_DRIVER_API(methodName, paramsDecl, params) false,
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params) true,
+#include "private/backend/DriverAPI.inc"
+};
+
+constexpr bool DESTROYS_RESOURCE[] = {
+#define DECL_DRIVER_API(methodName, paramsDecl, params) \
+        std::string_view(#methodName).substr(0, 7) == "destroy",
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params) false,
+#include "private/backend/DriverAPI.inc"
+};
+
+static_assert(std::size(CREATES_RESOURCE) == size_t(CommandId::COUNT));
+static_assert(std::size(DESTROYS_RESOURCE) == size_t(CommandId::COUNT));
+
+// FNV-1a
+uint64_t hash(void const* data, size_t size) noexcept {
+    uint64_t h = 0xcbf29ce484222325;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ static_cast<uint8_t const*>(data)[i]) * 0x100000001b3;
+    }
+    return h;
+}
+
+/*
+ * Returns the part of its resource changed by a command, or 0 if the command doesn't change the
+ * state of a resource. args are the serialized arguments of the command, they all start with
+ * the handle of the resource.
+ */
+uint64_t getStateSlot(CommandId id, uint8_t const* args, size_t size) noexcept {
+    constexpr size_t HANDLE_SIZE = sizeof(HandleBase::HandleId);
+    auto const readAt = [args, size](size_t offset, auto* out) {
+        if (offset + sizeof(*out) <= size) {
+            memcpy(out, args + offset, sizeof(*out));
+        }
+    };
+    switch (id) {
+        case CommandId::updateDescriptorSetBuffer:
+        case CommandId::updateDescriptorSetTexture: {
+            descriptor_binding_t binding = 0;
+            readAt(HANDLE_SIZE, &binding);
+            return 1 + uint64_t(binding);
+        }
+        case CommandId::setVertexBufferObject: {
+            uint32_t index = 0;
+            readAt(HANDLE_SIZE, &index);
+            return 1 + uint64_t(index);
+        }
+        case CommandId::updateIndexBuffer:
+        case CommandId::updateBufferObject:
+        case CommandId::updateBufferObjectUnsynchronized: {
+            // the byte range of the update, which follows its payload
+            uint64_t payloadSize = 0;
+            uint32_t byteOffset = 0;
+            readAt(HANDLE_SIZE, &payloadSize);
+            readAt(HANDLE_SIZE + sizeof(payloadSize) + payloadSize, &byteOffset);
+            uint64_t const range[] = { byteOffset, payloadSize };
+            return hash(range, sizeof(range)) | 1;
+        }
+        case CommandId::update3DImage:
+            // the level and region of the update
+            return hash(args + HANDLE_SIZE,
+                    std::min(size - std::min(size, HANDLE_SIZE), sizeof(uint32_t) * 7)) | 1;
+        case CommandId::generateMipmaps:
+            return UINT64_MAX;
+        default:
+            return 0;
+    }
+}
+
+} // anonymous namespace
+
+const char* getCommandName(CommandId id) noexcept {
+    switch (id) {
+#define DECL_DRIVER_API(methodName, paramsDecl, params) \
+        case CommandId::methodName: return #methodName;
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params) \
+        case CommandId::methodName: return #methodName;
+#include "private/backend/DriverAPI.inc"
+        case CommandId::COUNT:
+            break;
+    }
+    return "<invalid>";
+}
+
+// ------------------------------------------------------------------------------------------------
+// CommandStreamCapture
+// ------------------------------------------------------------------------------------------------
+
+CommandStreamCapture::CommandStreamCapture(Mode mode) noexcept
+        : mMode(mode) {
+    clear();
+}
+
+CommandStreamCapture::CommandStreamCapture(CommandStreamCapture* resources) noexcept
+        : mResources(resources), mMode(Mode::COMMANDS) {
+    assert_invariant(!resources || resources->mMode == Mode::RESOURCES);
+    clear();
+}
+
+CommandStreamCapture::~CommandStreamCapture() noexcept = default;
+
+void CommandStreamCapture::clear() noexcept {
+    FileHeader const header{ MAGIC, VERSION, sizeof(FileHeader) };
+    mData.clear();
+    mCommandCount = 0;
+    mPreambleCommandCount = 0;
+    mKeptCommands.clear();
+    write(&header, sizeof(header));
+    if (mResources) {
+        writePreamble();
+    }
+}
+
+void CommandStreamCapture::writePreamble() {
+    // the commands kept for all the resources, in the order they were recorded
+    std::vector<KeptCommand const*> commands;
+    commands.reserve(mResources->mCommandCount);
+    for (auto const& [handle, kept] : mResources->mKeptCommands) {
+        for (KeptCommand const& command : kept) {
+            commands.push_back(&command);
+        }
+    }
+    std::sort(commands.begin(), commands.end(), [](auto const* lhs, auto const* rhs) {
+        return lhs->sequence < rhs->sequence;
+    });
+    for (KeptCommand const* command : commands) {
+        write(command->data.data(), command->data.size());
+    }
+    mCommandCount = mPreambleCommandCount = commands.size();
+    mDynamicOffsetCounts = mResources->mDynamicOffsetCounts;
+
+    uint64_t const frameOffset = mData.size();
+    memcpy(mData.data() + offsetof(FileHeader, frameOffset), &frameOffset, sizeof(frameOffset));
+}
+
+bool CommandStreamCapture::save(const char* path) const noexcept {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        slog.e << "CommandStreamCapture: can't open " << path << io::endl;
+        return false;
+    }
+    size_t const written = fwrite(mData.data(), 1, mData.size(), file);
+    fclose(file);
+    if (written != mData.size()) {
+        slog.e << "CommandStreamCapture: error writing " << path << io::endl;
+        return false;
+    }
+    return true;
+}
+
+size_t CommandStreamCapture::beginCommand(CommandId id) {
+    size_t const offset = mData.size();
+    CommandHeader const header{ uint16_t(id), 0, 0 };
+    write(&header, sizeof(header));
+    return offset;
+}
+
+void CommandStreamCapture::endCommand(size_t offset) {
+    uint32_t const size = uint32_t(mData.size() - offset - sizeof(CommandHeader));
+    memcpy(mData.data() + offset + offsetof(CommandHeader, size), &size, sizeof(size));
+    if (mMode == Mode::RESOURCES) {
+        keepCommand(offset);
+        return;
+    }
+    mCommandCount++;
+}
+
+void CommandStreamCapture::keepCommand(size_t offset) {
+    CommandHeader header{};
+    memcpy(&header, mData.data() + offset, sizeof(header));
+    uint8_t const* const args = mData.data() + offset + sizeof(header);
+    CommandId const id = CommandId(header.id);
+
+    HandleBase::HandleId handle = HandleBase::nullid;
+    if (header.size >= sizeof(handle)) {
+        memcpy(&handle, args, sizeof(handle));
+    }
+
+    auto const keep = [this, offset](std::vector<KeptCommand>& kept, uint64_t slot) {
+        kept.push_back({ slot, mSequence++, { mData.begin() + ptrdiff_t(offset), mData.end() }});
+        mCommandCount++;
+    };
+
+    if (CREATES_RESOURCE[size_t(id)]) {
+        std::vector<KeptCommand>& kept = mKeptCommands[handle];
+        mCommandCount -= kept.size();
+        kept.clear();
+        keep(kept, 0);
+    } else if (DESTROYS_RESOURCE[size_t(id)]) {
+        auto const pos = mKeptCommands.find(handle);
+        if (pos != mKeptCommands.end()) {
+            mCommandCount -= pos->second.size();
+            mKeptCommands.erase(pos);
+        }
+        mDynamicOffsetCounts.erase(handle);
+    } else if (id == CommandId::resetBufferObject) {
+        // the content of the buffer is gone, only its creation remains
+        auto const pos = mKeptCommands.find(handle);
+        if (pos != mKeptCommands.end()) {
+            mCommandCount -= pos->second.size() - 1;
+            pos->second.resize(1);
+        }
+    } else if (uint64_t const slot = getStateSlot(id, args, header.size)) {
+        // the previous command that changed this part of the resource is replaced
+        auto const pos = mKeptCommands.find(handle);
+        if (pos != mKeptCommands.end()) {
+            std::vector<KeptCommand>& kept = pos->second;
+            auto const previous = std::find_if(kept.begin() + 1, kept.end(),
+                    [slot](KeptCommand const& command) { return command.slot == slot; });
+            if (previous != kept.end()) {
+                kept.erase(previous);
+                mCommandCount--;
+            }
+            keep(kept, slot);
+        }
+    }
+    mData.resize(offset);
+}
+
+void CommandStreamCapture::write(void const* data, size_t size) {
+    uint8_t const* const p = static_cast<uint8_t const*>(data);
+    mData.insert(mData.end(), p, p + size);
+}
+
+void CommandStreamCapture::recordDescriptorSetLayout(CommandId id,
+        DescriptorSetLayoutHandle dslh, DescriptorSetLayout const& info) {
+    uint32_t count = 0;
+    for (auto const& binding : info.bindings) {
+        if (any(binding.flags & DescriptorFlags::DYNAMIC_OFFSET)) {
+            count++;
+        }
+    }
+    mDynamicOffsetCounts[dslh.getId()] = count;
+    size_t const offset = beginCommand(id);
+    serialize(dslh);
+    serialize(info);
+    endCommand(offset);
+}
+
+void CommandStreamCapture::recordDescriptorSet(CommandId id,
+        DescriptorSetHandle dsh, DescriptorSetLayoutHandle dslh) {
+    auto const pos = mDynamicOffsetCounts.find(dslh.getId());
+    if (pos != mDynamicOffsetCounts.end()) {
+        mDynamicOffsetCounts[dsh.getId()] = pos->second;
+    }
+    size_t const offset = beginCommand(id);
+    serialize(dsh);
+    serialize(dslh);
+    endCommand(offset);
+}
+
+void CommandStreamCapture::recordBindDescriptorSet(CommandId id,
+        DescriptorSetHandle dsh, descriptor_set_t set, DescriptorSetOffsetArray const& offsets) {
+    // if the descriptor set was created before the capture started, we can't know how many
+    // dynamic offsets it has.
+    uint32_t count = 0;
+    if (!offsets.empty()) {
+        auto const pos = mDynamicOffsetCounts.find(dsh.getId());
+        if (pos != mDynamicOffsetCounts.end()) {
+            count = pos->second;
+        }
+    }
+    size_t const offset = beginCommand(id);
+    serialize(dsh);
+    serialize(set);
+    serialize(count);
+    write(offsets.data(), count * sizeof(DescriptorSetOffsetArray::value_type));
+    endCommand(offset);
+}
+
+void CommandStreamCapture::serialize(const char* const& string) {
+    serialize(CString{ string ? string : "" });
+}
+
+void CommandStreamCapture::serialize(CString const& string) {
+    uint32_t const length = string.size();
+    serialize(length);
+    write(string.c_str_safe(), length + 1);
+}
+
+void CommandStreamCapture::serialize(BufferDescriptor const& data) {
+    uint64_t const size = data.buffer ? data.size : 0;
+    serialize(size);
+    write(data.buffer, size);
+}
+
+void CommandStreamCapture::serialize(PixelBufferDescriptor const& data) {
+    serialize(static_cast<BufferDescriptor const&>(data));
+    serialize(data.left);
+    serialize(data.top);
+    serialize(uint8_t(data.type));
+    serialize(uint8_t(data.alignment));
+    if (data.type == PixelDataType::COMPRESSED) {
+        serialize(data.imageSize);
+        serialize(data.compressedFormat);
+    } else {
+        serialize(data.stride);
+        serialize(data.format);
+    }
+}
+
+void CommandStreamCapture::serialize(TargetBufferInfo const& info) {
+    serialize(info.handle);
+    serialize(info.level);
+    serialize(info.layer);
+}
+
+void CommandStreamCapture::serialize(MRT const& mrt) {
+    for (size_t i = 0; i < MRT::MAX_SUPPORTED_RENDER_TARGET_COUNT; i++) {
+        serialize(mrt[i]);
+    }
+}
+
+void CommandStreamCapture::serialize(PipelineState const& state) {
+    serialize(state.program);
+    serialize(state.vertexBufferInfo);
+    for (auto const& layout : state.pipelineLayout.setLayout) {
+        serialize(layout);
+    }
+    serialize(state.rasterState);
+    serialize(state.stencilState);
+    serialize(state.polygonOffset);
+    serialize(state.primitiveType);
+}
+
+void CommandStreamCapture::serialize(DescriptorSetLayout const& info) {
+    serialize(uint32_t(info.bindings.size()));
+    write(info.bindings.data(), info.bindings.size() * sizeof(DescriptorSetLayoutBinding));
+}
+
+void CommandStreamCapture::serialize(Program const& program) {
+    for (auto const& blob : program.getShadersSource()) {
+        serialize(uint32_t(blob.size()));
+        write(blob.data(), blob.size());
+    }
+    serialize(program.getShaderLanguage());
+    serialize(program.getName());
+    serialize(program.getCacheId());
+    serialize(program.getPriorityQueue());
+    serialize(program.isMultiview());
+
+    auto const& specializationConstants = program.getSpecializationConstants();
+    serialize(uint32_t(specializationConstants.size()));
+    for (auto const& constant : specializationConstants) {
+        serialize(constant.id);
+        serialize(constant.value);
+    }
+
+    for (size_t i = 0; i < Program::SHADER_TYPE_COUNT; i++) {
+        auto const& pushConstants = program.getPushConstants(ShaderStage(i));
+        serialize(uint32_t(pushConstants.size()));
+        for (auto const& constant : pushConstants) {
+            serialize(constant.name);
+            serialize(constant.type);
+        }
+    }
+
+    for (auto const& bindings : program.getDescriptorBindings()) {
+        serialize(uint32_t(bindings.size()));
+        for (auto const& descriptor : bindings) {
+            serialize(descriptor.name);
+            serialize(descriptor.type);
+            serialize(descriptor.binding);
+        }
+    }
+
+    auto const& attributes = program.getAttributes();
+    serialize(uint32_t(attributes.size()));
+    for (auto const& [name, location] : attributes) {
+        serialize(name);
+        serialize(location);
+    }
+
+    auto const& bindingUniforms = program.getBindingUniformInfo();
+    serialize(uint32_t(bindingUniforms.size()));
+    for (auto const& [index, name, uniforms] : bindingUniforms) {
+        serialize(index);
+        serialize(name);
+        serialize(uint32_t(uniforms.size()));
+        for (auto const& uniform : uniforms) {
+            serialize(uniform.name);
+            serialize(uniform.offset);
+            serialize(uniform.size);
+            serialize(uniform.type);
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// CommandStreamReplay
+// ------------------------------------------------------------------------------------------------
+
+struct CommandStreamReplay::Reader {
+    CommandStreamReplay& replay;
+    CommandStream& driverApi;
+    size_t const end;
+    bool error = false;
+
+    void read(void* out, size_t size) noexcept {
+        if (UTILS_UNLIKELY(replay.mCurrent + size > end)) {
+            memset(out, 0, size);
+            error = true;
+            return;
+        }
+        memcpy(out, replay.mData.data() + replay.mCurrent, size);
+        replay.mCurrent += size;
+    }
+
+    // returns a pointer to the next `size` bytes of the capture
+    void const* skip(size_t size) noexcept {
+        if (UTILS_UNLIKELY(replay.mCurrent + size > end)) {
+            error = true;
+            return nullptr;
+        }
+        void const* p = replay.mData.data() + replay.mCurrent;
+        replay.mCurrent += size;
+        return p;
+    }
+
+    template<typename T>
+    T read() noexcept {
+        T value{};
+        read(&value, sizeof(T));
+        return value;
+    }
+
+    HandleBase::HandleId readHandleId() noexcept {
+        return read<HandleBase::HandleId>();
+    }
+
+    template<typename R, typename ... ARGS>
+    std::tuple<std::decay_t<ARGS>...> readArguments(R (CommandStream::*)(ARGS...)) {
+        std::tuple<std::decay_t<ARGS>...> args;
+        std::apply([this](auto& ... arg) { (deserialize(arg), ...); }, args);
+        return args;
+    }
+
+    template<typename T, typename = std::enable_if_t<std::is_trivially_copyable_v<T>>>
+    void deserialize(T& value) noexcept {
+        read(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void deserialize(Handle<T>& handle) noexcept {
+        HandleBase::HandleId const id = readHandleId();
+        if (id == HandleBase::nullid) {
+            handle = {};
+            return;
+        }
+        auto const pos = replay.mHandles.find(id);
+        if (pos == replay.mHandles.end()) {
+            replay.mUnresolvedHandleCount++;
+            handle = {};
+            return;
+        }
+        handle = Handle<T>{ pos->second };
+    }
+
+    template<typename T>
+    void deserialize(T*& p) noexcept {
+        p = nullptr;
+    }
+
+    template<typename T>
+    void deserialize(utils::Invocable<T>&) noexcept {
+    }
+
+    void deserialize(const char*& string) noexcept {
+        uint32_t const length = read<uint32_t>();
+        // the capture outlives the replayed commands, so we can point directly into it
+        string = static_cast<const char*>(skip(length + 1));
+        if (!string) {
+            string = "";
+        }
+    }
+
+    void deserialize(CString& string) {
+        uint32_t const length = read<uint32_t>();
+        auto const* p = static_cast<const char*>(skip(length + 1));
+        string = p ? CString{ p, length } : CString{};
+    }
+
+    static void* copyPayload(void const* data, size_t size) noexcept {
+        void* const buffer = malloc(size);
+        if (data) {
+            memcpy(buffer, data, size);
+        } else {
+            memset(buffer, 0, size);
+        }
+        return buffer;
+    }
+
+    static void freePayload(void* buffer, size_t, void*) noexcept {
+        free(buffer);
+    }
+
+    void deserialize(BufferDescriptor& data) {
+        // payloads are copied because the driver may write into them (e.g. readBufferSubData)
+        size_t const size = size_t(read<uint64_t>());
+        if (size) {
+            void const* p = skip(size);
+            data = BufferDescriptor(copyPayload(p, size), size, &freePayload);
+        }
+    }
+
+    void deserialize(PixelBufferDescriptor& data) {
+        size_t const size = size_t(read<uint64_t>());
+        void* const buffer = size ? copyPayload(skip(size), size) : nullptr;
+        auto const left = read<uint32_t>();
+        auto const top = read<uint32_t>();
+        auto const type = PixelDataType(read<uint8_t>());
+        auto const alignment = read<uint8_t>();
+        if (type == PixelDataType::COMPRESSED) {
+            auto const imageSize = read<uint32_t>();
+            auto const compressedFormat = read<CompressedPixelDataType>();
+            data = PixelBufferDescriptor(buffer, size, compressedFormat, imageSize,
+                    buffer ? &freePayload : nullptr);
+            data.left = left;
+            data.top = top;
+        } else {
+            auto const stride = read<uint32_t>();
+            auto const format = read<PixelDataFormat>();
+            data = PixelBufferDescriptor(buffer, size, format, type, alignment,
+                    left, top, stride, buffer ? &freePayload : nullptr);
+        }
+    }
+
+    void deserialize(TargetBufferInfo& info) noexcept {
+        deserialize(info.handle);
+        deserialize(info.level);
+        deserialize(info.layer);
+    }
+
+    void deserialize(MRT& mrt) noexcept {
+        for (size_t i = 0; i < MRT::MAX_SUPPORTED_RENDER_TARGET_COUNT; i++) {
+            deserialize(mrt[i]);
+        }
+    }
+
+    void deserialize(PipelineState& state) noexcept {
+        deserialize(state.program);
+        deserialize(state.vertexBufferInfo);
+        for (auto& layout : state.pipelineLayout.setLayout) {
+            deserialize(layout);
+        }
+        deserialize(state.rasterState);
+        deserialize(state.stencilState);
+        deserialize(state.polygonOffset);
+        deserialize(state.primitiveType);
+    }
+
+    void deserialize(DescriptorSetLayout& info) {
+        uint32_t const count = read<uint32_t>();
+        info.bindings = FixedCapacityVector<DescriptorSetLayoutBinding>(count);
+        read(info.bindings.data(), count * sizeof(DescriptorSetLayoutBinding));
+    }
+
+    void deserialize(DescriptorSetOffsetArray& offsets) {
+        uint32_t const count = read<uint32_t>();
+        if (count) {
+            offsets = DescriptorSetOffsetArray(count, driverApi);
+            read(offsets.data(), count * sizeof(DescriptorSetOffsetArray::value_type));
+        }
+    }
+
+    void deserialize(Program& program) {
+        for (size_t i = 0; i < Program::SHADER_TYPE_COUNT; i++) {
+            uint32_t const size = read<uint32_t>();
+            void const* const blob = skip(size);
+            if (size && blob) {
+                program.shader(ShaderStage(i), blob, size);
+            }
+        }
+        program.shaderLanguage(read<ShaderLanguage>());
+
+        CString name;
+        deserialize(name);
+        program.diagnostics(name, [](io::ostream& out) -> io::ostream& { return out; });
+        program.cacheId(read<uint64_t>());
+        program.priorityQueue(read<CompilerPriorityQueue>());
+        program.multiview(read<bool>());
+
+        Program::SpecializationConstantsInfo specializationConstants(read<uint32_t>());
+        for (auto& constant : specializationConstants) {
+            deserialize(constant.id);
+            deserialize(constant.value);
+        }
+        program.specializationConstants(std::move(specializationConstants));
+
+        for (size_t i = 0; i < Program::SHADER_TYPE_COUNT; i++) {
+            FixedCapacityVector<Program::PushConstant> pushConstants(read<uint32_t>());
+            for (auto& constant : pushConstants) {
+                deserialize(constant.name);
+                deserialize(constant.type);
+            }
+            program.pushConstants(ShaderStage(i), std::move(pushConstants));
+        }
+
+        for (size_t set = 0; set < MAX_DESCRIPTOR_SET_COUNT; set++) {
+            Program::DescriptorBindingsInfo bindings(read<uint32_t>());
+            for (auto& descriptor : bindings) {
+                deserialize(descriptor.name);
+                deserialize(descriptor.type);
+                deserialize(descriptor.binding);
+            }
+            program.descriptorBindings(descriptor_set_t(set), std::move(bindings));
+        }
+
+        Program::AttributesInfo attributes(read<uint32_t>());
+        for (auto& [name, location] : attributes) {
+            deserialize(name);
+            deserialize(location);
+        }
+        program.attributes(std::move(attributes));
+
+        uint32_t const bindingUniformsCount = read<uint32_t>();
+        for (uint32_t i = 0; i < bindingUniformsCount && !error; i++) {
+            uint8_t const index = read<uint8_t>();
+            CString bindingName;
+            deserialize(bindingName);
+            Program::UniformInfo uniforms(read<uint32_t>());
+            for (auto& uniform : uniforms) {
+                deserialize(uniform.name);
+                deserialize(uniform.offset);
+                deserialize(uniform.size);
+                deserialize(uniform.type);
+            }
+            program.uniforms(index, std::move(bindingName), std::move(uniforms));
+        }
+    }
+};
+
+CommandStreamReplay::CommandStreamReplay(std::vector<uint8_t> data) noexcept
+        : mData(std::move(data)) {
+    FileHeader header{};
+    if (mData.size() >= sizeof(header)) {
+        memcpy(&header, mData.data(), sizeof(header));
+    }
+    mValid = header.magic == CommandStreamCapture::MAGIC &&
+             header.version == CommandStreamCapture::VERSION &&
+             header.frameOffset >= sizeof(header) && header.frameOffset <= mData.size();
+    mFrameOffset = mValid ? size_t(header.frameOffset) : 0;
+    rewind();
+}
+
+CommandStreamReplay::CommandStreamReplay(CommandStreamReplay&& rhs) noexcept = default;
+
+CommandStreamReplay::~CommandStreamReplay() noexcept = default;
+
+CommandStreamReplay CommandStreamReplay::load(const char* path) {
+    std::vector<uint8_t> data;
+    FILE* file = fopen(path, "rb");
+    if (file) {
+        fseek(file, 0, SEEK_END);
+        long const size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        if (size > 0) {
+            data.resize(size_t(size));
+            if (fread(data.data(), 1, data.size(), file) != data.size()) {
+                data.clear();
+            }
+        }
+        fclose(file);
+    }
+    if (data.empty()) {
+        slog.e << "CommandStreamReplay: can't read " << path << io::endl;
+    }
+    return CommandStreamReplay{ std::move(data) };
+}
+
+void CommandStreamReplay::rewind() noexcept {
+    mCurrent = mValid ? sizeof(FileHeader) : mData.size();
+    mUnresolvedHandleCount = 0;
+    mHandles.clear();
+}
+
+void CommandStreamReplay::rewindToFrame() noexcept {
+    if (mValid) {
+        mCurrent = mFrameOffset;
+    }
+}
+
+CommandId CommandStreamReplay::replayNextCommand(CommandStream& driverApi) {
+    if (done()) {
+        return CommandId::COUNT;
+    }
+
+    CommandHeader header{};
+    if (mCurrent + sizeof(header) > mData.size()) {
+        mValid = false;
+        return CommandId::COUNT;
+    }
+    memcpy(&header, mData.data() + mCurrent, sizeof(header));
+    mCurrent += sizeof(header);
+
+    size_t const end = mCurrent + header.size;
+    if (end > mData.size()) {
+        mValid = false;
+        return CommandId::COUNT;
+    }
+
+    Reader reader{ *this, driverApi, end };
+    CommandId const id = CommandId(header.id);
+    switch (id) {
+#define DECL_DRIVER_API(methodName, paramsDecl, params)                                         \
+        case CommandId::methodName: {                                                           \
+            auto args = reader.readArguments(&CommandStream::methodName);                       \
+            apply(&CommandStream::methodName, driverApi, std::move(args));                      \
+            break;                                                                              \
+        }
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params)                         \
+        case CommandId::methodName: {                                                           \
+            HandleBase::HandleId const handle = reader.readHandleId();                          \
+            auto args = reader.readArguments(&CommandStream::methodName);                       \
+            RetType const result = apply(&CommandStream::methodName, driverApi, std::move(args)); \
+            mHandles[handle] = result.getId();                                                  \
+            break;                                                                              \
+        }
+#include "private/backend/DriverAPI.inc"
+        case CommandId::COUNT:
+        default:
+            slog.e << "CommandStreamReplay: unknown command " << header.id << io::endl;
+            mValid = false;
+            return CommandId::COUNT;
+    }
+
+    if (UTILS_UNLIKELY(reader.error || mCurrent != end)) {
+        slog.w << "CommandStreamReplay: malformed " << getCommandName(id) << io::endl;
+        mCurrent = end;
+    }
+    return id;
+}
+
+} // namespace filament::backend
@@ -218,4 +218,8 @@ void Driver::execute(std::function<void(void)> const& fn) {
     fn();
 }
 
+StateChangeStatistics Driver::getStateChangeStatistics() const noexcept {
+    return {};
+}
+
 } // namespace filament::backend
@@ -1036,6 +1036,11 @@ bool MetalDriver::isDepthClampSupported() {
     return true;
 }
 
+bool MetalDriver::isMultiDrawIndirectSupported() {
+    // Metal has no multi-draw, this would need indirect command buffers.
+    return false;
+}
+
 bool MetalDriver::isWorkaroundNeeded(Workaround workaround) {
     switch (workaround) {
         case Workaround::SPLIT_EASU:
@@ -1871,6 +1876,11 @@ void MetalDriver::draw2(uint32_t indexOffset, uint32_t indexCount, uint32_t inst
                                                 instanceCount:instanceCount];
 }
 
+void MetalDriver::drawIndirect(Handle<HwBufferObject> boh, uint32_t byteOffset,
+        uint32_t drawCount) {
+    // not supported, see isMultiDrawIndirectSupported()
+}
+
 void MetalDriver::draw(PipelineState ps, Handle<HwRenderPrimitive> rph,
         uint32_t const indexOffset, uint32_t const indexCount, uint32_t const instanceCount) {
     MetalRenderPrimitive const* const rp = handle_cast<MetalRenderPrimitive>(rph);
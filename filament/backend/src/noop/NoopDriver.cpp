@@ -209,6 +209,10 @@ bool NoopDriver::isDepthClampSupported() {
     return false;
 }
 
+bool NoopDriver::isMultiDrawIndirectSupported() {
+    return true;
+}
+
 bool NoopDriver::isWorkaroundNeeded(Workaround) {
     return false;
 }
@@ -354,6 +358,10 @@ void NoopDriver::bindRenderPrimitive(Handle<HwRenderPrimitive> rph) {
 void NoopDriver::draw2(uint32_t indexOffset, uint32_t indexCount, uint32_t instanceCount) {
 }
 
+void NoopDriver::drawIndirect(Handle<HwBufferObject> boh, uint32_t byteOffset,
+        uint32_t drawCount) {
+}
+
 void NoopDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> rph,
         uint32_t indexOffset, uint32_t indexCount, uint32_t instanceCount) {
 }
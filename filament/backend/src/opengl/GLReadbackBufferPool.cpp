@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GLReadbackBufferPool.h"
+
+#include "GLUtils.h"
+#include "OpenGLContext.h"
+#include "gl_headers.h"
+
+#include <utils/Log.h>
+#include <utils/debug.h>
+
+#include <algorithm>
+
+namespace filament::backend {
+
+GLReadbackBufferPool::GLReadbackBufferPool() noexcept = default;
+
+GLReadbackBufferPool::~GLReadbackBufferPool() noexcept {
+    assert_invariant(mBuffers.empty());
+}
+
+void GLReadbackBufferPool::terminate(OpenGLContext& gl) noexcept {
+    for (Buffer const& buffer : mBuffers) {
+        destroy(gl, buffer);
+    }
+    mBuffers.clear();
+}
+
+GLReadbackBufferPool::Buffer GLReadbackBufferPool::acquire(
+        OpenGLContext& gl, uint32_t size) noexcept {
+#ifndef FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2
+    // use the smallest buffer that's large enough
+    auto best = mBuffers.end();
+    for (auto it = mBuffers.begin(); it != mBuffers.end(); ++it) {
+        if (it->size >= size && (best == mBuffers.end() || it->size < best->size)) {
+            best = it;
+        }
+    }
+    if (best != mBuffers.end()) {
+        Buffer const buffer = *best;
+        mBuffers.erase(best);
+        gl.bindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
+        return buffer;
+    }
+
+    Buffer buffer{ 0, size };
+    glGenBuffers(1, &buffer.id);
+    gl.bindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
+    glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, nullptr, GL_STREAM_READ);
+    CHECK_GL_ERROR(utils::slog.e)
+    return buffer;
+#else
+    return {};
+#endif
+}
+
+void GLReadbackBufferPool::release(OpenGLContext& gl, Buffer buffer) noexcept {
+    mBuffers.push_back(buffer);
+    if (mBuffers.size() > mCapacity) {
+        // we keep the largest buffers, they can be used for any readback
+        auto const smallest = std::min_element(mBuffers.begin(), mBuffers.end(),
+                [](Buffer const& lhs, Buffer const& rhs) { return lhs.size < rhs.size; });
+        destroy(gl, *smallest);
+        mBuffers.erase(smallest);
+    }
+}
+
+void GLReadbackBufferPool::destroy(OpenGLContext& gl, Buffer buffer) noexcept {
+#ifndef FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2
+    gl.deleteBuffer(buffer.id, GL_PIXEL_PACK_BUFFER);
+#endif
+}
+
+} // namespace filament::backend
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_BACKEND_OPENGL_GLREADBACKBUFFERPOOL_H
+#define TNT_FILAMENT_BACKEND_OPENGL_GLREADBACKBUFFERPOOL_H
+
+#include "gl_headers.h"
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament::backend {
+
+class OpenGLContext;
+
+/*
+ * GLReadbackBufferPool recycles the pixel pack buffers used by readPixels() and
+ * readBufferSubData().
+ *
+ * A readback holds its buffer until the GPU is done writing to it and the result has been mapped,
+ * a few frames later. When reading back every frame, the same few buffers are used in turn,
+ * instead of creating and allocating the storage of a new buffer each time.
+ */
+class GLReadbackBufferPool {
+public:
+    struct Buffer {
+        GLuint id = 0;
+        uint32_t size = 0;
+    };
+
+    GLReadbackBufferPool() noexcept;
+    ~GLReadbackBufferPool() noexcept;
+
+    GLReadbackBufferPool(GLReadbackBufferPool const&) = delete;
+    GLReadbackBufferPool& operator=(GLReadbackBufferPool const&) = delete;
+
+    // maximum number of unused buffers kept by the pool
+    void setCapacity(size_t capacity) noexcept { mCapacity = capacity; }
+
+    // destroys the unused buffers, the GL context must be current
+    void terminate(OpenGLContext& gl) noexcept;
+
+    // Returns a buffer of at least size bytes, bound to GL_PIXEL_PACK_BUFFER
+    Buffer acquire(OpenGLContext& gl, uint32_t size) noexcept;
+
+    // Returns a buffer to the pool, once its content has been read
+    void release(OpenGLContext& gl, Buffer buffer) noexcept;
+
+private:
+    static void destroy(OpenGLContext& gl, Buffer buffer) noexcept;
+
+    std::vector<Buffer> mBuffers;   // unused buffers
+    size_t mCapacity = 0;
+};
+
+} // namespace filament::backend
+
+#endif // TNT_FILAMENT_BACKEND_OPENGL_GLREADBACKBUFFERPOOL_H
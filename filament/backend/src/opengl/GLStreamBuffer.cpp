@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GLStreamBuffer.h"
+
+#include "GLUtils.h"
+#include "gl_headers.h"
+
+#include <utils/Log.h>
+#include <utils/compiler.h>
+#include <utils/debug.h>
+
+#include <string.h>
+
+namespace filament::backend {
+
+// glCopyBufferSubData() doesn't have alignment requirements, this keeps memcpy() happy
+static constexpr uint32_t ALIGNMENT = 16;
+
+GLStreamBuffer::GLStreamBuffer() noexcept = default;
+
+GLStreamBuffer::~GLStreamBuffer() noexcept {
+    assert_invariant(!mBuffer);
+}
+
+void GLStreamBuffer::terminate() noexcept {
+#ifndef FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2
+    for (GLsync& fence : mFences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (mBuffer) {
+        glDeleteBuffers(1, &mBuffer);
+        mBuffer = 0;
+    }
+    mHead = 0;
+    mSegment = 0;
+#endif
+}
+
+uint32_t GLStreamBuffer::allocate(uint32_t size) noexcept {
+#ifndef FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2
+    uint32_t const current = mSegment;
+    uint32_t const offset = (mHead + ALIGNMENT - 1u) & ~(ALIGNMENT - 1u);
+    if (offset + size <= (current + 1u) * SEGMENT_SIZE) {
+        // ranges never straddle two segments
+        return offset;
+    }
+
+    // we're done with the current segment, start the next one if the GPU is done with it
+    uint32_t const next = (current + 1u) % SEGMENT_COUNT;
+    GLsync& fence = mFences[next];
+    if (fence) {
+        GLenum const status = glClientWaitSync(fence, 0, 0u);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return CAPACITY;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    mFences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    mSegment = next;
+    mHead = next * SEGMENT_SIZE;
+    return mHead;
+#else
+    return CAPACITY;
+#endif
+}
+
+bool GLStreamBuffer::copy(GLuint buffer, uint32_t byteOffset,
+        void const* data, uint32_t size) noexcept {
+#ifndef FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2
+    if (UTILS_UNLIKELY(size > MAX_UPLOAD_SIZE)) {
+        return false;
+    }
+
+    if (UTILS_UNLIKELY(!mBuffer)) {
+        glGenBuffers(1, &mBuffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, mBuffer);
+        glBufferData(GL_COPY_READ_BUFFER, CAPACITY, nullptr, GL_STREAM_DRAW);
+    }
+
+    uint32_t const offset = allocate(size);
+    if (UTILS_UNLIKELY(offset == CAPACITY)) {
+        return false;
+    }
+
+    // The COPY_READ and COPY_WRITE targets are not tracked by OpenGLContext and are not used
+    // anywhere else, so we can bind them directly.
+    glBindBuffer(GL_COPY_READ_BUFFER, mBuffer);
+
+    // The fences guarantee the GPU is not using this range anymore
+    void* const vaddr = glMapBufferRange(GL_COPY_READ_BUFFER, offset, (GLsizeiptr)size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (UTILS_UNLIKELY(!vaddr)) {
+        return false;
+    }
+    memcpy(vaddr, data, size);
+    mHead = offset + size;
+    if (UTILS_UNLIKELY(glUnmapBuffer(GL_COPY_READ_BUFFER) == GL_FALSE)) {
+        // the content of the range is undefined (e.g. after a screen mode change), let the
+        // caller retry with a regular update.
+        return false;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            (GLintptr)offset, (GLintptr)byteOffset, (GLsizeiptr)size);
+
+    CHECK_GL_ERROR(utils::slog.e)
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace filament::backend
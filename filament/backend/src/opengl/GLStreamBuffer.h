@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_BACKEND_OPENGL_GLSTREAMBUFFER_H
+#define TNT_FILAMENT_BACKEND_OPENGL_GLSTREAMBUFFER_H
+
+#include "gl_headers.h"
+
+#include <stdint.h>
+
+namespace filament::backend {
+
+/*
+ * GLStreamBuffer is a ring buffer used to stage updates of dynamic buffer objects.
+ *
+ * The data is written to a free part of the ring, which can be mapped without synchronization,
+ * and then copied to its destination with glCopyBufferSubData(). Only the source of the copy is
+ * guaranteed to be idle: the copy is ordered with the draw calls like glBufferSubData() would be,
+ * so if the GPU is still reading the destination, the driver has to handle that write-after-read
+ * hazard the same way, by waiting or by renaming the destination. This helps with drivers that
+ * stall the CPU in glBufferSubData() when the buffer is busy. It doesn't with drivers that
+ * already stage glBufferSubData(), e.g. on Mesa's llvmpipe it's about 5% slower.
+ *
+ * The ring is split in a few segments, each guarded by a fence inserted when we're done writing
+ * it. A segment is reused only once its fence has signaled, we never wait for it: if the GPU is
+ * that much behind, copy() fails and the caller falls back to a regular update.
+ *
+ * This requires OpenGL ES 3.0 and glMapBufferRange().
+ */
+class GLStreamBuffer {
+public:
+    static constexpr uint32_t CAPACITY = 2 * 1024 * 1024;
+    static constexpr uint32_t SEGMENT_COUNT = 4;
+    static constexpr uint32_t SEGMENT_SIZE = CAPACITY / SEGMENT_COUNT;
+
+    // Updates larger than this are not worth streaming
+    static constexpr uint32_t MAX_UPLOAD_SIZE = SEGMENT_SIZE;
+
+    GLStreamBuffer() noexcept;
+    ~GLStreamBuffer() noexcept;
+
+    GLStreamBuffer(GLStreamBuffer const&) = delete;
+    GLStreamBuffer& operator=(GLStreamBuffer const&) = delete;
+
+    // destroys the GL objects, the GL context must be current
+    void terminate() noexcept;
+
+    // Copies size bytes from data to the buffer object `buffer` at byteOffset, returns false if
+    // the ring has no room for it, in which case nothing was done.
+    bool copy(GLuint buffer, uint32_t byteOffset, void const* data, uint32_t size) noexcept;
+
+private:
+    // Returns the offset in the ring of a new range of the given size, or CAPACITY if none is
+    // available.
+    uint32_t allocate(uint32_t size) noexcept;
+
+    GLuint mBuffer = 0;
+    uint32_t mHead = 0;                 // next free byte of the ring
+    uint32_t mSegment = 0;              // segment being written
+#ifndef FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2
+    GLsync mFences[SEGMENT_COUNT] = {}; // signaled when the GPU is done with a segment
+#endif
+};
+
+} // namespace filament::backend
+
+#endif // TNT_FILAMENT_BACKEND_OPENGL_GLSTREAMBUFFER_H
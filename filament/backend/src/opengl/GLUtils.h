@@ -130,6 +130,13 @@ constexpr inline GLenum getBufferBindingType(BufferObjectBinding bindingType) no
 #else
             utils::panic(__func__, __FILE__, __LINE__, "SHADER_STORAGE not supported");
             return 0x90D2; // just to return something
+#endif
+        case BufferObjectBinding::DRAW_INDIRECT:
+#ifdef BACKEND_OPENGL_LEVEL_GLES31
+            return GL_DRAW_INDIRECT_BUFFER;
+#else
+            utils::panic(__func__, __FILE__, __LINE__, "DRAW_INDIRECT not supported");
+            return 0x8F3F; // just to return something
 #endif
     }
 }
@@ -688,6 +688,7 @@ void OpenGLContext::initExtensionsGLES(Extensions* ext, GLint major, GLint minor
     ext->EXT_discard_framebuffer = exts.has("GL_EXT_discard_framebuffer"sv);
 #ifndef __EMSCRIPTEN__
     ext->EXT_disjoint_timer_query = exts.has("GL_EXT_disjoint_timer_query"sv);
+    ext->EXT_multi_draw_indirect = exts.has("GL_EXT_multi_draw_indirect"sv);
     ext->EXT_multisampled_render_to_texture = exts.has("GL_EXT_multisampled_render_to_texture"sv);
     ext->EXT_multisampled_render_to_texture2 = exts.has("GL_EXT_multisampled_render_to_texture2"sv);
     ext->EXT_protected_textures = exts.has("GL_EXT_protected_textures"sv);
@@ -758,6 +759,7 @@ void OpenGLContext::initExtensionsGL(Extensions* ext, GLint major, GLint minor)
     ext->EXT_depth_clamp = true;
     ext->EXT_discard_framebuffer = false;
     ext->EXT_disjoint_timer_query = true;
+    ext->EXT_multi_draw_indirect = exts.has("GL_ARB_multi_draw_indirect"sv);
     ext->EXT_multisampled_render_to_texture = false;
     ext->EXT_multisampled_render_to_texture2 = false;
     ext->EXT_shader_framebuffer_fetch = exts.has("GL_EXT_shader_framebuffer_fetch"sv);
@@ -789,9 +791,10 @@ void OpenGLContext::initExtensionsGL(Extensions* ext, GLint major, GLint minor)
     if (major > 4 || (major == 4 && minor >= 2)) {
         ext->ARB_shading_language_packing = true;
     }
-    // OpenGL 4.3 implies EXT_discard_framebuffer
+    // OpenGL 4.3 implies EXT_discard_framebuffer and ARB_multi_draw_indirect
     if (major > 4 || (major == 4 && minor >= 3)) {
         ext->EXT_discard_framebuffer = true;
+        ext->EXT_multi_draw_indirect = true;
         ext->KHR_debug = true;
     }
     // OpenGL 4.5 implies EXT_clip_control
@@ -823,20 +826,20 @@ void OpenGLContext::unbindFramebuffer(GLenum target) noexcept {
 void OpenGLContext::bindFramebufferResolved(GLenum target, GLuint buffer) noexcept {
     switch (target) {
         case GL_FRAMEBUFFER:
-            if (state.draw_fbo != buffer || state.read_fbo != buffer) {
+            if (trackStateChange(state.draw_fbo != buffer || state.read_fbo != buffer)) {
                 state.draw_fbo = state.read_fbo = buffer;
                 glBindFramebuffer(target, buffer);
             }
             break;
 #ifndef FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2
         case GL_DRAW_FRAMEBUFFER:
-            if (state.draw_fbo != buffer) {
+            if (trackStateChange(state.draw_fbo != buffer)) {
                 state.draw_fbo = buffer;
                 glBindFramebuffer(target, buffer);
             }
             break;
         case GL_READ_FRAMEBUFFER:
-            if (state.read_fbo != buffer) {
+            if (trackStateChange(state.read_fbo != buffer)) {
                 state.read_fbo = buffer;
                 glBindFramebuffer(target, buffer);
             }
@@ -853,8 +856,8 @@ void OpenGLContext::bindBuffer(GLenum target, GLuint buffer) noexcept {
         // GL_ELEMENT_ARRAY_BUFFER is a special case, where the currently bound VAO remembers
         // the index buffer, unless there are no VAO bound (see: bindVertexArray)
         assert_invariant(state.vao.p);
-        if (state.buffers.genericBinding[targetIndex] != buffer
-            || ((state.vao.p != &mDefaultVAO) && (state.vao.p->elementArray != buffer))) {
+        if (trackStateChange(state.buffers.genericBinding[targetIndex] != buffer
+            || ((state.vao.p != &mDefaultVAO) && (state.vao.p->elementArray != buffer)))) {
             state.buffers.genericBinding[targetIndex] = buffer;
             if (state.vao.p != &mDefaultVAO) {
                 state.vao.p->elementArray = buffer;
@@ -894,7 +897,7 @@ void OpenGLContext::pixelStore(GLenum pname, GLint param) noexcept {
             goto default_case;
     }
 
-    if (UTILS_UNLIKELY(*pcur != param)) {
+    if (UTILS_UNLIKELY(trackStateChange(*pcur != param))) {
         *pcur = param;
 default_case:
         glPixelStorei(pname, param);
@@ -940,14 +943,18 @@ void OpenGLContext::unbindSampler(GLuint sampler) noexcept {
 void OpenGLContext::deleteBuffer(GLuint buffer, GLenum target) noexcept {
     glDeleteBuffers(1, &buffer);
 
-    // bindings of bound buffers are reset to 0
-    size_t const targetIndex = getIndexForBufferTarget(target);
-    auto& genericBinding = state.buffers.genericBinding[targetIndex];
-    if (genericBinding == buffer) {
-        genericBinding = 0;
+    // bindings of bound buffers are reset to 0, on all targets: the buffer could be bound to
+    // other targets than its own (e.g. a uniform buffer bound as a shader storage buffer)
+    UTILS_NOUNROLL
+    for (auto& genericBinding: state.buffers.genericBinding) {
+        if (genericBinding == buffer) {
+            genericBinding = 0;
+        }
     }
 
     if (UTILS_UNLIKELY(bugs.rebind_buffer_after_deletion)) {
+        GLuint const genericBinding =
+                state.buffers.genericBinding[getIndexForBufferTarget(target)];
         if (genericBinding) {
             glBindBuffer(target, genericBinding);
         }
@@ -957,9 +964,8 @@ void OpenGLContext::deleteBuffer(GLuint buffer, GLenum target) noexcept {
     assert_invariant(mFeatureLevel >= FeatureLevel::FEATURE_LEVEL_1 ||
             (target != GL_UNIFORM_BUFFER && target != GL_TRANSFORM_FEEDBACK_BUFFER));
 
-    if (target == GL_UNIFORM_BUFFER || target == GL_TRANSFORM_FEEDBACK_BUFFER) {
-        auto& indexedBinding = state.buffers.targets[targetIndex];
-        UTILS_NOUNROLL
+    UTILS_NOUNROLL
+    for (auto& indexedBinding: state.buffers.targets) {
         for (auto& entry: indexedBinding.buffers) {
             if (entry.name == buffer) {
                 entry.name = 0;
@@ -1017,6 +1023,8 @@ void OpenGLContext::resetState() noexcept {
 
     // increase the state version so other parts of the state know to reset
     state.age++;
+    state.raster.version++;
+    state.stencil.version++;
 
     if (state.major > 2) {
 #ifndef FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2
@@ -227,6 +227,7 @@ public:
         bool EXT_depth_clamp;
         bool EXT_discard_framebuffer;
         bool EXT_disjoint_timer_query;
+        bool EXT_multi_draw_indirect;
         bool EXT_multisampled_render_to_texture2;
         bool EXT_multisampled_render_to_texture;
         bool EXT_protected_textures;
@@ -389,6 +390,7 @@ public:
             GLboolean colorMask         = GL_TRUE;
             GLboolean depthMask         = GL_TRUE;
             GLenum depthFunc            = GL_LESS;
+            uint32_t version            = 0;    // incremented when any of the above changes
         } raster;
 
         struct {
@@ -413,6 +415,7 @@ public:
                 StencilOp op;
                 GLuint stencilMask      = ~GLuint(0);
             } front, back;
+            uint32_t version            = 0;    // incremented when any of the above changes
         } stencil;
 
         struct PolygonOffset {
@@ -435,7 +438,7 @@ public:
                     GLsizeiptr size = 0;
                 } buffers[MAX_BUFFER_BINDINGS];
             } targets[3];   // there are only 3 indexed buffer targets
-            GLuint genericBinding[7] = {};
+            GLuint genericBinding[8] = {};
         } buffers;
 
         struct {
@@ -464,6 +467,9 @@ public:
         uint8_t age = 0;
     } state;
 
+    // State changes made through this context, the driver resets them at the start of a frame
+    StateChangeStatistics stateChanges;
+
     struct Procs {
         void (* bindVertexArray)(GLuint array);
         void (* deleteVertexArrays)(GLsizei n, const GLuint* arrays);
@@ -601,13 +607,33 @@ private:
             Bugs const& bugs) noexcept;
 
     template <typename T, typename F>
-    static inline void update_state(T& state, T const& expected, F functor, bool force = false) noexcept {
-        if (UTILS_UNLIKELY(force || state != expected)) {
+    inline void update_state(T& state, T const& expected, F functor, bool force = false) noexcept {
+        if (UTILS_UNLIKELY(trackStateChange(force || state != expected))) {
             state = expected;
             functor();
         }
     }
 
+    // records whether a state change results in a GL call, returns `changed`
+    inline bool trackStateChange(bool changed) noexcept {
+        if (changed) {
+            stateChanges.issued++;
+        } else {
+            stateChanges.elided++;
+        }
+        return changed;
+    }
+
+    // GL_STENCIL_TEST is part of the stencil state, the other caps are considered part of the
+    // raster state, except for the scissor test which is set per render pass
+    inline void capChanged(GLenum cap) noexcept {
+        if (cap == GL_STENCIL_TEST) {
+            state.stencil.version++;
+        } else if (cap != GL_SCISSOR_TEST) {
+            state.raster.version++;
+        }
+    }
+
     void setDefaultState() noexcept;
 };
 
@@ -654,6 +680,9 @@ constexpr size_t OpenGLContext::getIndexForBufferTarget(GLenum target) noexcept
 #ifndef FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2
         case GL_PIXEL_PACK_BUFFER:          index = 5; break;
         case GL_PIXEL_UNPACK_BUFFER:        index = 6; break;
+#endif
+#if defined(BACKEND_OPENGL_LEVEL_GLES31)
+        case GL_DRAW_INDIRECT_BUFFER:       index = 7; break;
 #endif
         default: break;
     }
@@ -749,9 +778,10 @@ void OpenGLContext::bindBufferRange(GLenum target, GLuint index, GLuint buffer,
     size_t const targetIndex = getIndexForBufferTarget(target);
     // this ALSO sets the generic binding
     assert_invariant(targetIndex < sizeof(state.buffers.targets) / sizeof(*state.buffers.targets));
-    if (   state.buffers.targets[targetIndex].buffers[index].name != buffer
+    if (trackStateChange(
+               state.buffers.targets[targetIndex].buffers[index].name != buffer
            || state.buffers.targets[targetIndex].buffers[index].offset != offset
-           || state.buffers.targets[targetIndex].buffers[index].size != size) {
+           || state.buffers.targets[targetIndex].buffers[index].size != size)) {
         state.buffers.targets[targetIndex].buffers[index].name = buffer;
         state.buffers.targets[targetIndex].buffers[index].offset = offset;
         state.buffers.targets[targetIndex].buffers[index].size = size;
@@ -782,7 +812,7 @@ void OpenGLContext::enableVertexAttribArray(RenderPrimitive const* rp, GLuint in
     assert_invariant(rp);
     assert_invariant(index < rp->vertexAttribArray.size());
     bool const force = rp->stateVersion != state.age;
-    if (UTILS_UNLIKELY(force || !rp->vertexAttribArray[index])) {
+    if (UTILS_UNLIKELY(trackStateChange(force || !rp->vertexAttribArray[index]))) {
         rp->vertexAttribArray.set(index);
         glEnableVertexAttribArray(index);
     }
@@ -792,7 +822,7 @@ void OpenGLContext::disableVertexAttribArray(RenderPrimitive const* rp, GLuint i
     assert_invariant(rp);
     assert_invariant(index < rp->vertexAttribArray.size());
     bool const force = rp->stateVersion != state.age;
-    if (UTILS_UNLIKELY(force || rp->vertexAttribArray[index])) {
+    if (UTILS_UNLIKELY(trackStateChange(force || rp->vertexAttribArray[index]))) {
         rp->vertexAttribArray.unset(index);
         glDisableVertexAttribArray(index);
     }
@@ -800,16 +830,18 @@ void OpenGLContext::disableVertexAttribArray(RenderPrimitive const* rp, GLuint i
 
 void OpenGLContext::enable(GLenum cap) noexcept {
     size_t const index = getIndexForCap(cap);
-    if (UTILS_UNLIKELY(!state.enables.caps[index])) {
+    if (UTILS_UNLIKELY(trackStateChange(!state.enables.caps[index]))) {
         state.enables.caps.set(index);
+        capChanged(cap);
         glEnable(cap);
     }
 }
 
 void OpenGLContext::disable(GLenum cap) noexcept {
     size_t const index = getIndexForCap(cap);
-    if (UTILS_UNLIKELY(state.enables.caps[index])) {
+    if (UTILS_UNLIKELY(trackStateChange(state.enables.caps[index]))) {
         state.enables.caps.unset(index);
+        capChanged(cap);
         glDisable(cap);
     }
 }
@@ -817,34 +849,38 @@ void OpenGLContext::disable(GLenum cap) noexcept {
 void OpenGLContext::frontFace(GLenum mode) noexcept {
     update_state(state.raster.frontFace, mode, [&]() {
         glFrontFace(mode);
+        state.raster.version++;
     });
 }
 
 void OpenGLContext::cullFace(GLenum mode) noexcept {
     update_state(state.raster.cullFace, mode, [&]() {
         glCullFace(mode);
+        state.raster.version++;
     });
 }
 
 void OpenGLContext::blendEquation(GLenum modeRGB, GLenum modeA) noexcept {
-    if (UTILS_UNLIKELY(
-            state.raster.blendEquationRGB != modeRGB || state.raster.blendEquationA != modeA)) {
+    if (UTILS_UNLIKELY(trackStateChange(
+            state.raster.blendEquationRGB != modeRGB || state.raster.blendEquationA != modeA))) {
         state.raster.blendEquationRGB = modeRGB;
         state.raster.blendEquationA   = modeA;
+        state.raster.version++;
         glBlendEquationSeparate(modeRGB, modeA);
     }
 }
 
 void OpenGLContext::blendFunction(GLenum srcRGB, GLenum srcA, GLenum dstRGB, GLenum dstA) noexcept {
-    if (UTILS_UNLIKELY(
+    if (UTILS_UNLIKELY(trackStateChange(
             state.raster.blendFunctionSrcRGB != srcRGB ||
             state.raster.blendFunctionSrcA != srcA ||
             state.raster.blendFunctionDstRGB != dstRGB ||
-            state.raster.blendFunctionDstA != dstA)) {
+            state.raster.blendFunctionDstA != dstA))) {
         state.raster.blendFunctionSrcRGB = srcRGB;
         state.raster.blendFunctionSrcA = srcA;
         state.raster.blendFunctionDstRGB = dstRGB;
         state.raster.blendFunctionDstA = dstA;
+        state.raster.version++;
         glBlendFuncSeparate(srcRGB, dstRGB, srcA, dstA);
     }
 }
@@ -852,17 +888,20 @@ void OpenGLContext::blendFunction(GLenum srcRGB, GLenum srcA, GLenum dstRGB, GLe
 void OpenGLContext::colorMask(GLboolean flag) noexcept {
     update_state(state.raster.colorMask, flag, [&]() {
         glColorMask(flag, flag, flag, flag);
+        state.raster.version++;
     });
 }
 void OpenGLContext::depthMask(GLboolean flag) noexcept {
     update_state(state.raster.depthMask, flag, [&]() {
         glDepthMask(flag);
+        state.raster.version++;
     });
 }
 
 void OpenGLContext::depthFunc(GLenum func) noexcept {
     update_state(state.raster.depthFunc, func, [&]() {
         glDepthFunc(func);
+        state.raster.version++;
     });
 }
 
@@ -870,9 +909,11 @@ void OpenGLContext::stencilFuncSeparate(GLenum funcFront, GLint refFront, GLuint
         GLenum funcBack, GLint refBack, GLuint maskBack) noexcept {
     update_state(state.stencil.front.func, {funcFront, refFront, maskFront}, [&]() {
         glStencilFuncSeparate(GL_FRONT, funcFront, refFront, maskFront);
+        state.stencil.version++;
     });
     update_state(state.stencil.back.func, {funcBack, refBack, maskBack}, [&]() {
         glStencilFuncSeparate(GL_BACK, funcBack, refBack, maskBack);
+        state.stencil.version++;
     });
 }
 
@@ -880,18 +921,22 @@ void OpenGLContext::stencilOpSeparate(GLenum sfailFront, GLenum dpfailFront, GLe
         GLenum sfailBack, GLenum dpfailBack, GLenum dppassBack) noexcept {
     update_state(state.stencil.front.op, {sfailFront, dpfailFront, dppassFront}, [&]() {
         glStencilOpSeparate(GL_FRONT, sfailFront, dpfailFront, dppassFront);
+        state.stencil.version++;
     });
     update_state(state.stencil.back.op, {sfailBack, dpfailBack, dppassBack}, [&]() {
         glStencilOpSeparate(GL_BACK, sfailBack, dpfailBack, dppassBack);
+        state.stencil.version++;
     });
 }
 
 void OpenGLContext::stencilMaskSeparate(GLuint maskFront, GLuint maskBack) noexcept {
     update_state(state.stencil.front.stencilMask, maskFront, [&]() {
         glStencilMaskSeparate(GL_FRONT, maskFront);
+        state.stencil.version++;
     });
     update_state(state.stencil.back.stencilMask, maskBack, [&]() {
         glStencilMaskSeparate(GL_BACK, maskBack);
+        state.stencil.version++;
     });
 }
 
@@ -256,6 +256,8 @@ OpenGLDriver::OpenGLDriver(OpenGLPlatform* platform, const Platform::DriverConfi
     mTexturesWithStreamsAttached.reserve(8);
     mStreamsWithPendingAcquiredImage.reserve(8);
 
+    mReadbackBufferPool.setCapacity(driverConfig.readbackBufferCount);
+
 #ifndef NDEBUG
     slog.i << "OS version: " << mPlatform.getOSVersion() << io::endl;
 #endif
@@ -297,6 +299,8 @@ void OpenGLDriver::terminate() {
 
     mShaderCompilerService.terminate();
 
+    mStreamBuffer.terminate();
+
 #ifndef FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2
     // and make sure to execute all the GpuCommandCompleteOps callbacks
     executeGpuCommandsCompleteOps();
@@ -313,6 +317,9 @@ void OpenGLDriver::terminate() {
     assert_invariant(mGpuCommandCompleteOps.empty());
 #endif
 
+    // all the readbacks have completed above
+    mReadbackBufferPool.terminate(mContext);
+
     delete mCurrentPushConstants;
     mCurrentPushConstants = nullptr;
 
@@ -325,6 +332,10 @@ ShaderModel OpenGLDriver::getShaderModel() const noexcept {
     return mContext.getShaderModel();
 }
 
+StateChangeStatistics OpenGLDriver::getStateChangeStatistics() const noexcept {
+    return mContext.stateChanges;
+}
+
 // ------------------------------------------------------------------------------------------------
 // Change and track GL state
 // ------------------------------------------------------------------------------------------------
@@ -418,6 +429,13 @@ void OpenGLDriver::setRasterState(RasterState rs) noexcept {
     mRenderPassColorWrite |= rs.colorWrite;
     mRenderPassDepthWrite |= rs.depthWrite;
 
+    // consecutive draws often use the same raster state, in which case we can skip all the
+    // individual state checks below, unless the GL state was changed by someone else.
+    if (UTILS_LIKELY(rs == mRasterState && mRasterStateVersion == gl.state.raster.version)) {
+        gl.stateChanges.elided++;
+        return;
+    }
+
     // culling state
     if (rs.culling == CullingMode::NONE) {
         gl.disable(GL_CULL_FACE);
@@ -470,6 +488,9 @@ void OpenGLDriver::setRasterState(RasterState rs) noexcept {
             gl.disable(GL_DEPTH_CLAMP);
         }
     }
+
+    mRasterState = rs;
+    mRasterStateVersion = gl.state.raster.version;
 }
 
 void OpenGLDriver::setStencilState(StencilState ss) noexcept {
@@ -477,6 +498,13 @@ void OpenGLDriver::setStencilState(StencilState ss) noexcept {
 
     mRenderPassStencilWrite |= ss.stencilWrite;
 
+    // see setRasterState()
+    if (UTILS_LIKELY(mStencilStateVersion == gl.state.stencil.version &&
+            !memcmp(&ss, &mStencilState, sizeof(StencilState)))) {
+        gl.stateChanges.elided++;
+        return;
+    }
+
     // stencil test / operation
     // GL_STENCIL_TEST must be enabled if we're testing OR writing to the stencil buffer.
     if (UTILS_LIKELY(
@@ -513,6 +541,9 @@ void OpenGLDriver::setStencilState(StencilState ss) noexcept {
                 getStencilOp(ss.back.stencilOpDepthStencilPass));
         gl.stencilMaskSeparate(ss.front.writeMask, ss.back.writeMask);
     }
+
+    mStencilState = ss;
+    mStencilStateVersion = gl.state.stencil.version;
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -2287,6 +2318,11 @@ bool OpenGLDriver::isDepthClampSupported() {
     return getContext().ext.EXT_depth_clamp;
 }
 
+bool OpenGLDriver::isMultiDrawIndirectSupported() {
+    auto const& gl = getContext();
+    return !gl.isES2() && gl.ext.EXT_multi_draw_indirect;
+}
+
 bool OpenGLDriver::isWorkaroundNeeded(Workaround workaround) {
     switch (workaround) {
         case Workaround::SPLIT_EASU:
@@ -2439,6 +2475,11 @@ void OpenGLDriver::updateBufferObject(
         assert_invariant(bo->gl.buffer);
         memcpy(static_cast<uint8_t*>(bo->gl.buffer) + byteOffset, bd.buffer, bd.size);
         bo->age++;
+    } else if (bo->usage == BufferUsage::DYNAMIC && streamBufferObject(bo, bd, byteOffset)) {
+        // Dynamic buffers are updated several times per frame (e.g. the per-renderable, light
+        // or skinning UBOs). The copy from the ring writes the destination in order with the
+        // draws, so a destination still in use is synchronized like with glBufferSubData(), see
+        // GLStreamBuffer.
     } else {
         assert_invariant(bo->gl.id);
         gl.bindBuffer(bo->gl.binding, bo->gl.id);
@@ -2447,7 +2488,8 @@ void OpenGLDriver::updateBufferObject(
             glBufferData(bo->gl.binding, (GLsizeiptr)bd.size, bd.buffer, getBufferUsage(bo->usage));
         } else {
             // glBufferSubData() could be catastrophically inefficient if several are
-            // issued during the same frame. Currently, we're not doing that though.
+            // issued during the same frame. Dynamic buffers normally go through the stream
+            // buffer above.
             glBufferSubData(bo->gl.binding, byteOffset, (GLsizeiptr)bd.size, bd.buffer);
         }
     }
@@ -2478,6 +2520,8 @@ void OpenGLDriver::updateBufferObjectUnsynchronized(
         if (bo->gl.binding != GL_UNIFORM_BUFFER) {
             // TODO: use updateBuffer() for all types of buffer? Make sure GL supports that.
             updateBufferObject(boh, std::move(bd), byteOffset);
+        } else if (streamBufferObject(bo, bd, byteOffset)) {
+            scheduleDestroy(std::move(bd));
         } else {
             auto& gl = mContext;
             gl.bindBuffer(bo->gl.binding, bo->gl.id);
@@ -2505,6 +2549,19 @@ retry:
 #endif
 }
 
+bool OpenGLDriver::streamBufferObject(GLBufferObject const* bo,
+        BufferDescriptor const& bd, uint32_t byteOffset) noexcept {
+#ifndef FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2
+    if constexpr (HAS_MAPBUFFERS) {
+        if (UTILS_LIKELY(!mContext.isES2())) {
+            assert_invariant(bo->gl.id);
+            return mStreamBuffer.copy(bo->gl.id, byteOffset, bd.buffer, uint32_t(bd.size));
+        }
+    }
+#endif
+    return false;
+}
+
 void OpenGLDriver::resetBufferObject(Handle<HwBufferObject> boh) {
     DEBUG_MARKER()
 
@@ -3268,10 +3325,9 @@ void OpenGLDriver::readPixels(Handle<HwRenderTarget> src,
     // which we're always emulating. So if we have a resolved fbo (fbo_read), use that instead.
     gl.bindFramebuffer(GL_READ_FRAMEBUFFER, s->gl.fbo_read ? s->gl.fbo_read : s->gl.fbo);
 
-    GLuint pbo;
-    glGenBuffers(1, &pbo);
-    gl.bindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
-    glBufferData(GL_PIXEL_PACK_BUFFER, pboSize, nullptr, GL_STATIC_DRAW);
+    // the PBO comes from a pool, so that we don't allocate a new one each time when reading
+    // back every frame.
+    GLReadbackBufferPool::Buffer const pbo = mReadbackBufferPool.acquire(gl, uint32_t(pboSize));
     glReadPixels(GLint(x), GLint(y), GLint(width), GLint(height), glFormat, glType, nullptr);
     gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
     CHECK_GL_ERROR(utils::slog.e)
@@ -3282,7 +3338,7 @@ void OpenGLDriver::readPixels(Handle<HwRenderTarget> src,
     whenGpuCommandsComplete([this, width, height, pbo, pboSize, pUserBuffer]() mutable {
         PixelBufferDescriptor& p = *pUserBuffer;
         auto& gl = mContext;
-        gl.bindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+        gl.bindBuffer(GL_PIXEL_PACK_BUFFER, pbo.id);
         void* vaddr = nullptr;
 #if defined(__EMSCRIPTEN__)
         std::unique_ptr<uint8_t[]> clientBuffer = std::make_unique<uint8_t[]>(pboSize);
@@ -3311,7 +3367,7 @@ void OpenGLDriver::readPixels(Handle<HwRenderTarget> src,
 #endif
         }
         gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-        glDeleteBuffers(1, &pbo);
+        mReadbackBufferPool.release(gl, pbo);
         scheduleDestroy(std::move(p));
         delete pUserBuffer;
         CHECK_GL_ERROR(utils::slog.e)
@@ -3331,10 +3387,7 @@ void OpenGLDriver::readBufferSubData(backend::BufferObjectHandle boh,
     if constexpr (true) {
         // schedule a copy of the buffer we're reading into a PBO, this *should* happen
         // asynchronously without stalling the CPU.
-        GLuint pbo;
-        glGenBuffers(1, &pbo);
-        gl.bindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
-        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, nullptr, GL_STATIC_DRAW);
+        GLReadbackBufferPool::Buffer const pbo = mReadbackBufferPool.acquire(gl, size);
         gl.bindBuffer(bo->gl.binding, bo->gl.id);
         glCopyBufferSubData(bo->gl.binding, GL_PIXEL_PACK_BUFFER, offset, 0, size);
         gl.bindBuffer(bo->gl.binding, 0);
@@ -3346,14 +3399,14 @@ void OpenGLDriver::readBufferSubData(backend::BufferObjectHandle boh,
         whenGpuCommandsComplete([this, size, pbo, pUserBuffer]() mutable {
             BufferDescriptor& p = *pUserBuffer;
             auto& gl = mContext;
-            gl.bindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+            gl.bindBuffer(GL_PIXEL_PACK_BUFFER, pbo.id);
             void* vaddr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
             if (vaddr) {
                 memcpy(p.buffer, vaddr, size);
                 glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
             }
             gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-            glDeleteBuffers(1, &pbo);
+            mReadbackBufferPool.release(gl, pbo);
             scheduleDestroy(std::move(p));
             delete pUserBuffer;
             CHECK_GL_ERROR(utils::slog.e)
@@ -3451,6 +3504,7 @@ void OpenGLDriver::beginFrame(
     DEBUG_MARKER()
     auto& gl = mContext;
     insertEventMarker("beginFrame");
+    gl.stateChanges = {};
     mPlatform.beginFrame(monotonic_clock_ns, refreshIntervalNs, frameId);
     if (UTILS_UNLIKELY(!mTexturesWithStreamsAttached.empty())) {
         OpenGLPlatform& platform = mPlatform;
@@ -3898,9 +3952,23 @@ void OpenGLDriver::bindDescriptorSet(
     }
 }
 
-void OpenGLDriver::updateDescriptors(utils::bitset8 invalidDescriptorSets) noexcept {
+void OpenGLDriver::updateDescriptors(utils::bitset8 invalidDescriptorSets,
+        UTILS_UNUSED_IN_RELEASE bool compute) noexcept {
     assert_invariant(mBoundProgram);
     auto const offsetOnly = mInvalidDescriptorSetBindingOffsets & ~mInvalidDescriptorSetBindings;
+#ifndef NDEBUG
+    if (!compute) {
+        // validate that the descriptor-set layouts match the layouts set in the pipeline
+        // we don't need to do the check if only the offset is changing
+        (invalidDescriptorSets & ~offsetOnly).forEachSetBit([this](size_t set) {
+            auto const& entry = mBoundDescriptorSets[set];
+            if (entry.dsh) {
+                GLDescriptorSet* const ds = handle_cast<GLDescriptorSet*>(entry.dsh);
+                ds->validate(mHandleAllocator, mCurrentSetLayout[set]);
+            }
+        });
+    }
+#endif
     invalidDescriptorSets.forEachSetBit([this, offsetOnly,
             &boundDescriptorSets = mBoundDescriptorSets,
             &context = mContext,
@@ -3909,13 +3977,6 @@ void OpenGLDriver::updateDescriptors(utils::bitset8 invalidDescriptorSets) noexc
         auto const& entry = boundDescriptorSets[set];
         if (entry.dsh) {
             GLDescriptorSet* const ds = handle_cast<GLDescriptorSet*>(entry.dsh);
-#ifndef NDEBUG
-            if (UTILS_UNLIKELY(!offsetOnly[set])) {
-                // validate that this descriptor-set layout matches the layout set in the pipeline
-                // we don't need to do the check if only the offset is changing
-                ds->validate(mHandleAllocator, mCurrentSetLayout[set]);
-            }
-#endif
             ds->bind(context, mHandleAllocator, boundProgram,
                     set, entry.offsets.data(), offsetOnly[set]);
         }
@@ -3958,6 +4019,52 @@ void OpenGLDriver::draw2(uint32_t indexOffset, uint32_t indexCount, uint32_t ins
 #endif
 }
 
+void OpenGLDriver::drawIndirect(Handle<HwBufferObject> boh,
+        uint32_t byteOffset, uint32_t drawCount) {
+    DEBUG_MARKER()
+    assert_invariant(!mContext.isES2());
+    assert_invariant(mContext.ext.EXT_multi_draw_indirect);
+    assert_invariant(mBoundRenderPrimitive);
+#if FILAMENT_ENABLE_MATDBG
+    if (UTILS_UNLIKELY(!mValidProgram)) {
+        return;
+    }
+#endif
+    assert_invariant(mBoundProgram);
+    assert_invariant(mValidProgram);
+
+    // When the program changes, we might have to rebind all or some descriptors
+    auto const invalidDescriptorSets =
+            mInvalidDescriptorSetBindings | mInvalidDescriptorSetBindingOffsets;
+    if (UTILS_UNLIKELY(invalidDescriptorSets.any())) {
+        updateDescriptors(invalidDescriptorSets);
+    }
+
+#if defined(BACKEND_OPENGL_LEVEL_GLES31)
+    GLBufferObject const* const bo = handle_cast<const GLBufferObject*>(boh);
+    assert_invariant(bo->bindingType == BufferObjectBinding::DRAW_INDIRECT);
+    assert_invariant(byteOffset + drawCount * sizeof(DrawIndexedIndirectArgs) <= bo->byteCount);
+
+    GLRenderPrimitive const* const rp = mBoundRenderPrimitive;
+    mContext.bindBuffer(GL_DRAW_INDIRECT_BUFFER, bo->gl.id);
+#   if defined(BACKEND_OPENGL_VERSION_GL)
+    glMultiDrawElementsIndirect(GLenum(rp->type), rp->gl.getIndicesType(),
+            reinterpret_cast<const void*>(uintptr_t(byteOffset)),
+            (GLsizei)drawCount, sizeof(DrawIndexedIndirectArgs));
+#   elif defined(GL_EXT_multi_draw_indirect)
+    glMultiDrawElementsIndirectEXT(GLenum(rp->type), rp->gl.getIndicesType(),
+            reinterpret_cast<const void*>(uintptr_t(byteOffset)),
+            (GLsizei)drawCount, sizeof(DrawIndexedIndirectArgs));
+#   endif
+#endif
+
+#if FILAMENT_ENABLE_MATDBG
+    CHECK_GL_ERROR_NON_FATAL(utils::slog.e)
+#else
+    CHECK_GL_ERROR(utils::slog.e)
+#endif
+}
+
 // This is the ES2 version of draw2().
 void OpenGLDriver::draw2GLES2(uint32_t indexOffset, uint32_t indexCount, uint32_t instanceCount) {
     DEBUG_MARKER()
@@ -4024,15 +4131,35 @@ void OpenGLDriver::dispatchCompute(Handle<HwProgram> program, math::uint3 workGr
         return;
     }
 
+    // compute programs don't have a pipeline layout, the descriptor sets bound with
+    // bindDescriptorSet() are applied as they are.
+    auto const invalidDescriptorSets =
+            mInvalidDescriptorSetBindings | mInvalidDescriptorSetBindingOffsets;
+    if (UTILS_UNLIKELY(invalidDescriptorSets.any())) {
+        updateDescriptors(invalidDescriptorSets, true);
+    }
+
 #if defined(BACKEND_OPENGL_LEVEL_GLES31)
 
 #if defined(__ANDROID__)
     // on Android, GLES3.1 and above entry-points are defined in glext
     // (this is temporary, until we phase-out API < 21)
     using glext::glDispatchCompute;
+    using glext::glMemoryBarrier;
 #endif
 
     glDispatchCompute(workGroupCount.x, workGroupCount.y, workGroupCount.z);
+
+    // Writes to shader storage buffers are incoherent, make them visible to whatever uses the
+    // buffers next: another dispatch, a draw (e.g. indirect arguments, vertices or indices),
+    // or a buffer update or readback.
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT |
+            GL_UNIFORM_BARRIER_BIT |
+            GL_COMMAND_BARRIER_BIT |
+            GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+            GL_ELEMENT_ARRAY_BARRIER_BIT |
+            GL_BUFFER_UPDATE_BARRIER_BIT |
+            GL_PIXEL_BUFFER_BARRIER_BIT);
 #endif // BACKEND_OPENGL_LEVEL_GLES31
 
 #if FILAMENT_ENABLE_MATDBG
@@ -23,6 +23,8 @@
 #include "GLBufferObject.h"
 #include "GLDescriptorSet.h"
 #include "GLDescriptorSetLayout.h"
+#include "GLReadbackBufferPool.h"
+#include "GLStreamBuffer.h"
 #include "GLTexture.h"
 #include "ShaderCompilerService.h"
 
@@ -205,6 +207,8 @@ private:
 
     ShaderModel getShaderModel() const noexcept final;
 
+    StateChangeStatistics getStateChangeStatistics() const noexcept final;
+
     /*
      * Driver interface
      */
@@ -305,6 +309,10 @@ private:
     void textureStorage(OpenGLDriver::GLTexture* t, uint32_t width, uint32_t height,
             uint32_t depth, bool useProtectedMemory) noexcept;
 
+    // stages a buffer object update in mStreamBuffer, returns false if it couldn't
+    bool streamBufferObject(GLBufferObject const* bo,
+            BufferDescriptor const& bd, uint32_t byteOffset) noexcept;
+
     /* State tracking GL wrappers... */
 
            void bindTexture(GLuint unit, GLTexture const* t) noexcept;
@@ -326,12 +334,19 @@ private:
     GLboolean mRenderPassDepthWrite{};
     GLboolean mRenderPassStencilWrite{};
 
+    // last raster and stencil states applied, valid while the context's state version matches
+    RasterState mRasterState;
+    StencilState mStencilState;
+    uint32_t mRasterStateVersion = ~0u;
+    uint32_t mStencilStateVersion = ~0u;
+
     GLRenderPrimitive const* mBoundRenderPrimitive = nullptr;
     OpenGLProgram* mBoundProgram = nullptr;
     bool mValidProgram = false;
     utils::bitset8 mInvalidDescriptorSetBindings;
     utils::bitset8 mInvalidDescriptorSetBindingOffsets;
-    void updateDescriptors(utils::bitset8 invalidDescriptorSets) noexcept;
+    // compute programs don't have a pipeline layout, the descriptor sets are not validated
+    void updateDescriptors(utils::bitset8 invalidDescriptorSets, bool compute = false) noexcept;
 
     struct {
         backend::DescriptorSetHandle dsh;
@@ -368,6 +383,12 @@ private:
     std::vector<std::function<void()>> mFrameCompleteOps;
 #endif
 
+    // staging ring for the updates of dynamic buffer objects
+    GLStreamBuffer mStreamBuffer;
+
+    // pixel pack buffers of readPixels() and readBufferSubData()
+    GLReadbackBufferPool mReadbackBufferPool;
+
     // tasks regularly executed on the main thread at until they return true
     void runEveryNowAndThen(std::function<bool()> fn) noexcept;
     void executeEveryNowAndThenOps() noexcept;
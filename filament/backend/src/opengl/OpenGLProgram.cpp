@@ -136,6 +136,7 @@ void OpenGLProgram::initializeProgramState(OpenGLContext& context, GLuint progra
 
     GLuint tmu = 0;
     GLuint binding = 0;
+    UTILS_UNUSED GLuint ssboBinding = 0;
 
     // needed for samplers
     context.useProgram(program);
@@ -144,8 +145,39 @@ void OpenGLProgram::initializeProgramState(OpenGLContext& context, GLuint progra
     for (backend::descriptor_set_t set = 0; set < MAX_DESCRIPTOR_SET_COUNT; set++) {
         for (Program::Descriptor const& entry: lazyInitializationData.descriptorBindings[set]) {
             switch (entry.type) {
-                case DescriptorType::UNIFORM_BUFFER:
                 case DescriptorType::SHADER_STORAGE_BUFFER: {
+#if defined(BACKEND_OPENGL_LEVEL_GLES31)
+                    // shader storage blocks are not uniform blocks, and have their own binding
+                    // points; they don't exist on ES2 or ES3.0.
+                    if (!entry.name.empty() &&
+                            (context.isAtLeastGLES<3, 1>() || context.isAtLeastGL<4, 3>())) {
+#   if defined(__ANDROID__)
+                        using glext::glGetProgramResourceIndex;
+                        using glext::glGetProgramResourceiv;
+#   endif
+                        GLuint const index = glGetProgramResourceIndex(program,
+                                GL_SHADER_STORAGE_BLOCK, entry.name.c_str());
+                        if (index != GL_INVALID_INDEX) {
+                            // this can fail if the program doesn't use this descriptor
+#   if defined(BACKEND_OPENGL_VERSION_GL)
+                            glShaderStorageBlockBinding(program, index, ssboBinding);
+                            mBindingMap.insert(set, entry.binding, { ssboBinding, entry.type });
+                            ++ssboBinding;
+#   else
+                            // ES doesn't allow changing the binding, it is set by the shader
+                            GLenum const prop = GL_BUFFER_BINDING;
+                            GLint shaderBinding = 0;
+                            glGetProgramResourceiv(program, GL_SHADER_STORAGE_BLOCK, index,
+                                    1, &prop, 1, nullptr, &shaderBinding);
+                            mBindingMap.insert(set, entry.binding,
+                                    { GLuint(shaderBinding), entry.type });
+#   endif
+                        }
+                    }
+#endif
+                    break;
+                }
+                case DescriptorType::UNIFORM_BUFFER: {
                     if (!entry.name.empty()) {
 #ifndef FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2
                         if (UTILS_LIKELY(!context.isES2())) {
@@ -64,6 +64,9 @@ PFNGLCLIPCONTROLEXTPROC glClipControlEXT;
 #ifdef GL_EXT_discard_framebuffer
 PFNGLDISCARDFRAMEBUFFEREXTPROC glDiscardFramebufferEXT;
 #endif
+#ifdef GL_EXT_multi_draw_indirect
+PFNGLMULTIDRAWELEMENTSINDIRECTEXTPROC glMultiDrawElementsIndirectEXT;
+#endif
 #ifdef GL_KHR_parallel_shader_compile
 PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR;
 #endif
@@ -75,6 +78,9 @@ PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC glFramebufferTextureMultiviewOVR;
 // On Android, If we want to support a build system less than ANDROID_API 21, we need to
 // use getProcAddress for ES3.1 and above entry points.
 PFNGLDISPATCHCOMPUTEPROC glDispatchCompute;
+PFNGLMEMORYBARRIERPROC glMemoryBarrier;
+PFNGLGETPROGRAMRESOURCEINDEXPROC glGetProgramResourceIndex;
+PFNGLGETPROGRAMRESOURCEIVPROC glGetProgramResourceiv;
 #endif
 static std::once_flag sGlExtInitialized;
 #endif // __EMSCRIPTEN__
@@ -117,6 +123,9 @@ void importGLESExtensionsEntryPoints() {
 #ifdef GL_EXT_discard_framebuffer
         getProcAddress(glDiscardFramebufferEXT, "glDiscardFramebufferEXT");
 #endif
+#ifdef GL_EXT_multi_draw_indirect
+        getProcAddress(glMultiDrawElementsIndirectEXT, "glMultiDrawElementsIndirectEXT");
+#endif
 #ifdef GL_KHR_parallel_shader_compile
         getProcAddress(glMaxShaderCompilerThreadsKHR, "glMaxShaderCompilerThreadsKHR");
 #endif
@@ -125,6 +134,9 @@ void importGLESExtensionsEntryPoints() {
 #endif
 #if defined(__ANDROID__) && !defined(FILAMENT_SILENCE_NOT_SUPPORTED_BY_ES2)
         getProcAddress(glDispatchCompute, "glDispatchCompute");
+        getProcAddress(glMemoryBarrier, "glMemoryBarrier");
+        getProcAddress(glGetProgramResourceIndex, "glGetProgramResourceIndex");
+        getProcAddress(glGetProgramResourceiv, "glGetProgramResourceiv");
 #endif
     });
 #endif // __EMSCRIPTEN__
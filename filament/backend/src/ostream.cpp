@@ -361,6 +361,7 @@ io::ostream& operator<<(io::ostream& out, BufferObjectBinding binding) {
         CASE(BufferObjectBinding, VERTEX)
         CASE(BufferObjectBinding, UNIFORM)
         CASE(BufferObjectBinding, SHADER_STORAGE)
+        CASE(BufferObjectBinding, DRAW_INDIRECT)
     }
     return out;
 }
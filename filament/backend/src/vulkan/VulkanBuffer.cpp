@@ -72,6 +72,9 @@ void VulkanBuffer::loadFromCpu(VkCommandBuffer cmdbuf, const void* cpuData, uint
         } else if (mUsage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
             srcAccess = VK_ACCESS_INDEX_READ_BIT;
             srcStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        } else if (mUsage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+            srcAccess = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+            srcStage = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
         }
 
         VkBufferMemoryBarrier barrier{
@@ -115,6 +118,9 @@ void VulkanBuffer::loadFromCpu(VkCommandBuffer cmdbuf, const void* cpuData, uint
         dstAccessMask |= VK_ACCESS_UNIFORM_READ_BIT;
         dstStageMask |=
                 (VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    } else if (mUsage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+        dstAccessMask |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        dstStageMask |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
     } else if (mUsage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
         // TODO: implement me
     }
@@ -128,6 +128,10 @@ public:
         return mPhysicalDeviceFeatures.depthClamp == VK_TRUE;
     }
 
+    inline bool isMultiDrawIndirectSupported() const noexcept {
+        return mPhysicalDeviceFeatures.multiDrawIndirect == VK_TRUE;
+    }
+
     inline bool isDebugMarkersSupported() const noexcept {
         return mDebugMarkersSupported;
     }
@@ -989,6 +989,10 @@ bool VulkanDriver::isDepthClampSupported() {
     return mContext.isDepthClampSupported();
 }
 
+bool VulkanDriver::isMultiDrawIndirectSupported() {
+    return mContext.isMultiDrawIndirectSupported();
+}
+
 bool VulkanDriver::isWorkaroundNeeded(Workaround workaround) {
     switch (workaround) {
         case Workaround::SPLIT_EASU: {
@@ -1883,6 +1887,27 @@ void VulkanDriver::draw2(uint32_t indexOffset, uint32_t indexCount, uint32_t ins
     FVK_SYSTRACE_END();
 }
 
+void VulkanDriver::drawIndirect(Handle<HwBufferObject> boh, uint32_t byteOffset,
+        uint32_t drawCount) {
+    FVK_SYSTRACE_CONTEXT();
+    FVK_SYSTRACE_START("drawIndirect");
+
+    VulkanCommandBuffer& commands = mCommands.get();
+    VkCommandBuffer cmdbuffer = commands.buffer();
+
+    mDescriptorSetManager.commit(&commands, mBoundPipeline.pipelineLayout,
+            mBoundPipeline.descriptorSetMask);
+
+    auto* bo = mResourceAllocator.handle_cast<VulkanBufferObject*>(boh);
+    assert_invariant(bo->bindingType == BufferObjectBinding::DRAW_INDIRECT);
+    commands.acquire(bo);
+
+    vkCmdDrawIndexedIndirect(cmdbuffer, bo->buffer.getGpuBuffer(), byteOffset, drawCount,
+            sizeof(DrawIndexedIndirectArgs));
+
+    FVK_SYSTRACE_END();
+}
+
 void VulkanDriver::draw(PipelineState state, Handle<HwRenderPrimitive> rph,
         uint32_t const indexOffset, uint32_t const indexCount, uint32_t const instanceCount) {
     VulkanRenderPrimitive* const rp = mResourceAllocator.handle_cast<VulkanRenderPrimitive*>(rph);
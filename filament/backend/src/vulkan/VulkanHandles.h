@@ -452,6 +452,8 @@ inline constexpr VkBufferUsageFlagBits getBufferObjectUsage(
             return VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
         case BufferObjectBinding::SHADER_STORAGE:
             return VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        case BufferObjectBinding::DRAW_INDIRECT:
+            return VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
         // when adding more buffer-types here, make sure to update VulkanBuffer::loadFromCpu()
         // if necessary.
     }
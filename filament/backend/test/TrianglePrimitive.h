@@ -50,6 +50,7 @@ public:
     ~TrianglePrimitive();
 
     PrimitiveHandle getRenderPrimitive() const noexcept;
+    VertexInfoHandle getVertexBufferInfo() const noexcept;
 
     void updateVertices(const filament::math::float2 vertices[3]) noexcept;
     void updateIndices(const index_type* indices) noexcept;
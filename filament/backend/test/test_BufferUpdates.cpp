@@ -328,4 +328,122 @@ TEST_F(BackendTest, BufferObjectUpdateWithOffset) {
     getDriver().purge();
 }
 
+// Same as BufferObjectUpdateWithOffset, with a dynamic uniform buffer. On OpenGL, updates of
+// dynamic buffers are staged in a ring buffer and copied by the GPU. Between the two draw calls,
+// we update another buffer enough times for the ring to wrap around several times, the result
+// must be identical.
+TEST_F(BackendTest, DynamicBufferObjectUpdates) {
+    auto& api = getDriverApi();
+
+    // Create a platform-specific SwapChain and make it current.
+    auto swapChain = createSwapChain();
+    api.makeCurrent(swapChain, swapChain);
+
+    // Create a program.
+    filamat::DescriptorSets descriptors;
+    descriptors[1] = { { "Params",
+            { DescriptorType::UNIFORM_BUFFER, ShaderStageFlags::FRAGMENT, 0 }, {} } };
+    ShaderGenerator shaderGen(
+            vertex, fragment, sBackend, sIsMobilePlatform, std::move(descriptors));
+    Program p = shaderGen.getProgram(api);
+    p.descriptorBindings(1, {{ "Params", DescriptorType::UNIFORM_BUFFER, 0 }});
+    auto program = api.createProgram(std::move(p));
+
+    DescriptorSetLayoutHandle descriptorSetLayout = api.createDescriptorSetLayout({
+            {{
+                     DescriptorType::UNIFORM_BUFFER,
+                     ShaderStageFlags::ALL_SHADER_STAGE_FLAGS, 0,
+                     DescriptorFlags::NONE, 0
+             }}});
+
+    DescriptorSetHandle descriptorSet = api.createDescriptorSet(descriptorSetLayout);
+
+    auto ubuffer = api.createBufferObject(sizeof(MaterialParams) + 64,
+            BufferObjectBinding::UNIFORM, BufferUsage::DYNAMIC);
+
+    api.updateDescriptorSetBuffer(descriptorSet, 0, ubuffer, 0, sizeof(MaterialParams) + 64);
+    api.bindDescriptorSet(descriptorSet, 1, {});
+
+    // A buffer that is never used, only updated.
+    constexpr size_t SCRATCH_SIZE = 64 * 1024;
+    auto scratch = api.createBufferObject(SCRATCH_SIZE,
+            BufferObjectBinding::UNIFORM, BufferUsage::DYNAMIC);
+
+    // Create a render target.
+    auto colorTexture = api.createTexture(SamplerType::SAMPLER_2D, 1,
+            TextureFormat::RGBA8, 1, 512, 512, 1, TextureUsage::COLOR_ATTACHMENT);
+    auto renderTarget = api.createRenderTarget(
+            TargetBufferFlags::COLOR0, 512, 512, 1, 0, {{colorTexture}}, {}, {});
+
+    auto updateParams = [&api, ubuffer](MaterialParams const& params, size_t offset,
+            size_t size) {
+        auto* tmp = new MaterialParams(params);
+        auto cb = [](void* buffer, size_t, void* user) {
+            delete (MaterialParams*)user;
+        };
+        BufferDescriptor bd((char*)tmp + offset, size, cb, tmp);
+        api.updateBufferObject(ubuffer, std::move(bd), 64 + offset);
+    };
+
+    // Upload garbage first, then the uniforms for the first triangle.
+    updateParams({ .color = { 0.0f, 1.0f, 0.0f, 1.0f } }, 0, sizeof(MaterialParams));
+    updateParams({
+            .color = { 1.0f, 0.0f, 0.5f, 1.0f },
+            .offset = { 0.0f, 0.0f, 0.0f, 0.0f } }, 0, sizeof(MaterialParams));
+
+    RenderPassParams params = {};
+    params.flags.clear = TargetBufferFlags::COLOR;
+    params.clearColor = {0.f, 0.f, 1.f, 1.f};
+    params.flags.discardStart = TargetBufferFlags::ALL;
+    params.flags.discardEnd = TargetBufferFlags::NONE;
+    params.viewport.height = 512;
+    params.viewport.width = 512;
+    renderTriangle({{ DescriptorSetLayoutHandle{}, descriptorSetLayout }},
+            renderTarget, swapChain, program, params);
+
+    // 16 MiB of updates, more than the ring holds.
+    for (size_t i = 0; i < 256; i++) {
+        BufferDescriptor bd(malloc(SCRATCH_SIZE), SCRATCH_SIZE,
+                [](void* buffer, size_t, void*) { free(buffer); });
+        api.updateBufferObject(scratch, std::move(bd), 0);
+    }
+
+    // Upload uniforms for the second triangle, only update color.b, color.a, offset.x,
+    // and offset.y.
+    updateParams({
+            .color = { 1.0f, 0.0f, 1.0f, 1.0f },
+            .offset = { 0.5f, 0.5f, 0.0f, 0.0f } },
+            offsetof(MaterialParams, color.b), sizeof(float) * 4);
+
+    params.flags.clear = TargetBufferFlags::NONE;
+    params.flags.discardStart = TargetBufferFlags::NONE;
+    renderTriangle({{ DescriptorSetLayoutHandle{}, descriptorSetLayout }},
+            renderTarget, swapChain, program, params);
+
+    // the image is the same as BufferObjectUpdateWithOffset's
+    static const uint32_t expectedHash = 91322442;
+    readPixelsAndAssertHash(
+            "DynamicBufferObjectUpdates", 512, 512, renderTarget, expectedHash, true);
+
+    api.flush();
+    api.commit(swapChain);
+    api.endFrame(0);
+
+    api.destroyProgram(program);
+    api.destroySwapChain(swapChain);
+    api.destroyDescriptorSet(descriptorSet);
+    api.destroyDescriptorSetLayout(descriptorSetLayout);
+    api.destroyBufferObject(ubuffer);
+    api.destroyBufferObject(scratch);
+    api.destroyRenderTarget(renderTarget);
+    api.destroyTexture(colorTexture);
+
+    // This ensures all driver commands have finished before exiting the test.
+    api.finish();
+
+    executeCommands();
+
+    getDriver().purge();
+}
+
 } // namespace test
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <private/backend/CircularBuffer.h>
+#include <private/backend/CommandBufferQueue.h>
+
+#include <chrono>
+#include <thread>
+
+#include <stddef.h>
+
+using namespace filament::backend;
+
+namespace {
+
+constexpr size_t REQUIRED_SIZE = 64u * 1024u;
+constexpr size_t BUFFER_SIZE = 3u * REQUIRED_SIZE;
+
+// Stands in for a slow driver thread: releases the command buffers, without executing them,
+// some time after they were flushed.
+class Consumer {
+public:
+    explicit Consumer(CommandBufferQueue& queue) : mQueue(queue), mThread([this]() {
+        while (!mQueue.isExitRequested()) {
+            auto const buffers = mQueue.waitForCommands();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            for (auto const& item : buffers) {
+                if (item.begin) {
+                    mQueue.releaseBuffer(item);
+                }
+            }
+        }
+    }) {
+    }
+
+    ~Consumer() {
+        mQueue.requestExit();
+        mThread.join();
+        // waitForCommands() doesn't block anymore, release what's left
+        for (auto const& item : mQueue.waitForCommands()) {
+            if (item.begin) {
+                mQueue.releaseBuffer(item);
+            }
+        }
+    }
+
+private:
+    CommandBufferQueue& mQueue;
+    std::thread mThread;
+};
+
+// Records and flushes more than the whole circular buffer in chunks, so that flush() has to
+// wait for the consumer at least once. flush() guarantees REQUIRED_SIZE bytes are available
+// when it returns, so each chunk is always valid.
+void recordBlockingFrame(CommandBufferQueue& queue) {
+    CircularBuffer& circularBuffer = queue.getCircularBuffer();
+    size_t const chunk = REQUIRED_SIZE - 256;
+    for (size_t i = 0, c = circularBuffer.size() / chunk + 1; i < c; i++) {
+        circularBuffer.allocate(chunk);
+        queue.flush();
+    }
+}
+
+} // anonymous namespace
+
+TEST(CommandBufferQueueTest, Statistics) {
+    CommandBufferQueue queue(REQUIRED_SIZE, BUFFER_SIZE, false);
+    Consumer consumer(queue);
+
+    queue.getCircularBuffer().allocate(1024);
+    queue.flush();
+    CommandBufferQueue::Statistics statistics = queue.endFrame();
+    EXPECT_GE(statistics.bytesRecorded, 1024u);
+    EXPECT_EQ(statistics.blockedCount, 0u);
+    EXPECT_EQ(statistics.bufferSize, queue.getCircularBuffer().size());
+    EXPECT_GE(statistics.highWatermark, statistics.bytesRecorded);
+
+    recordBlockingFrame(queue);
+    statistics = queue.endFrame();
+    EXPECT_GE(statistics.blockedCount, 1u);
+    EXPECT_GT(statistics.blocked.count(), 0);
+    EXPECT_GT(statistics.highWatermark, BUFFER_SIZE - REQUIRED_SIZE);
+
+    // statistics are reset by endFrame()
+    statistics = queue.endFrame();
+    EXPECT_EQ(statistics.bytesRecorded, 0u);
+    EXPECT_EQ(statistics.blockedCount, 0u);
+}
+
+TEST(CommandBufferQueueTest, NoGrowthByDefault) {
+    CommandBufferQueue queue(REQUIRED_SIZE, BUFFER_SIZE, false);
+    Consumer consumer(queue);
+
+    size_t const size = queue.getCircularBuffer().size();
+    for (int i = 0; i < 8; i++) {
+        recordBlockingFrame(queue);
+        EXPECT_EQ(queue.endFrame().bufferSize, size);
+    }
+}
+
+TEST(CommandBufferQueueTest, GrowsAfterBlockedFrames) {
+    CommandBufferQueue queue(REQUIRED_SIZE, BUFFER_SIZE, false, 3 * BUFFER_SIZE);
+    Consumer consumer(queue);
+
+    size_t const size = queue.getCircularBuffer().size();
+
+    // the buffer only grows after 3 consecutive blocked frames
+    recordBlockingFrame(queue);
+    EXPECT_EQ(queue.endFrame().bufferSize, size);
+    recordBlockingFrame(queue);
+    EXPECT_EQ(queue.endFrame().bufferSize, size);
+
+    // a frame that doesn't block resets the count
+    queue.endFrame();
+    recordBlockingFrame(queue);
+    EXPECT_EQ(queue.endFrame().bufferSize, size);
+    recordBlockingFrame(queue);
+    EXPECT_EQ(queue.endFrame().bufferSize, size);
+    recordBlockingFrame(queue);
+    EXPECT_EQ(queue.endFrame().bufferSize, 2 * size);
+    EXPECT_EQ(queue.getCircularBuffer().size(), 2 * size);
+
+    // the buffer is still usable after growing, and growth is capped to maxBufferSize
+    for (int i = 0; i < 3; i++) {
+        recordBlockingFrame(queue);
+        queue.endFrame();
+    }
+    EXPECT_EQ(queue.getCircularBuffer().size(), 3 * BUFFER_SIZE);
+    for (int i = 0; i < 3; i++) {
+        recordBlockingFrame(queue);
+        EXPECT_EQ(queue.endFrame().bufferSize, 3 * BUFFER_SIZE);
+    }
+}
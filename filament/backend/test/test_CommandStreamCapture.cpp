@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <private/backend/CommandBufferQueue.h>
+#include <private/backend/CommandStream.h>
+#include <private/backend/CommandStreamCapture.h>
+#include <private/backend/Driver.h>
+#include <private/backend/PlatformFactory.h>
+
+#include <backend/DescriptorSetOffsetArray.h>
+#include <backend/DriverEnums.h>
+
+#include <utils/FixedCapacityVector.h>
+
+#include <memory>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace filament::backend;
+
+namespace {
+
+// A CommandStream backed by a fresh noop driver. Fake handles are allocated sequentially from 1,
+// so two instances fed the same commands produce the same handles.
+struct NoopCommandStream {
+    static constexpr size_t REQUIRED_SIZE = 256u * 1024u;
+
+    NoopCommandStream() {
+        Backend backend = Backend::NOOP;
+        platform = PlatformFactory::create(&backend);
+        driver = platform->createDriver(nullptr, {});
+        queue = std::make_unique<CommandBufferQueue>(REQUIRED_SIZE, 2 * REQUIRED_SIZE, false);
+        driverApi = std::make_unique<CommandStream>(*driver, queue->getCircularBuffer());
+    }
+
+    ~NoopCommandStream() {
+        execute();
+        driverApi.reset();
+        queue.reset();
+        driver->purge();
+        delete driver;
+        PlatformFactory::destroy(&platform);
+    }
+
+    void execute() {
+        queue->flush();
+        for (auto const& item : queue->waitForCommands()) {
+            if (item.begin) {
+                driverApi->execute(item.begin);
+                queue->releaseBuffer(item);
+            }
+        }
+    }
+
+    Platform* platform = nullptr;
+    Driver* driver = nullptr;
+    std::unique_ptr<CommandBufferQueue> queue;
+    std::unique_ptr<CommandStream> driverApi;
+};
+
+std::vector<uint8_t> copyCapture(CommandStreamCapture const& capture) {
+    auto const* p = static_cast<uint8_t const*>(capture.getData());
+    return { p, p + capture.getSize() };
+}
+
+} // anonymous namespace
+
+TEST(CommandStreamCaptureTest, DescriptorSetRoundTrip) {
+    CommandStreamCapture capture;
+    {
+        NoopCommandStream stream;
+        CommandStream& driverApi = *stream.driverApi;
+        driverApi.setCapture(&capture);
+
+        DescriptorSetLayout layout{ utils::FixedCapacityVector<DescriptorSetLayoutBinding>{
+                { DescriptorType::UNIFORM_BUFFER, ShaderStageFlags::VERTEX, 0,
+                        DescriptorFlags::DYNAMIC_OFFSET },
+                { DescriptorType::SAMPLER, ShaderStageFlags::FRAGMENT, 1 },
+                { DescriptorType::UNIFORM_BUFFER, ShaderStageFlags::FRAGMENT, 2,
+                        DescriptorFlags::DYNAMIC_OFFSET },
+        }};
+        DescriptorSetLayoutHandle const dslh = driverApi.createDescriptorSetLayout(
+                std::move(layout));
+        DescriptorSetHandle const dsh = driverApi.createDescriptorSet(dslh);
+        driverApi.bindDescriptorSet(dsh, 1, { { 256, 512 }, driverApi });
+        driverApi.bindDescriptorSet(dsh, 2, {});
+        driverApi.destroyDescriptorSet(dsh);
+        driverApi.destroyDescriptorSetLayout(dslh);
+
+        driverApi.setCapture(nullptr);
+    }
+    EXPECT_EQ(capture.getCommandCount(), 6u);
+
+    // Replay the capture on a new driver while capturing it again. Because the noop driver
+    // hands out the same handles, the second capture must be identical to the first one,
+    // including the dynamic offsets whose count is only known from the layout.
+    std::vector<uint8_t> const original = copyCapture(capture);
+    CommandStreamReplay replay(original);
+    ASSERT_TRUE(replay.isValid());
+
+    CommandStreamCapture recapture;
+    std::vector<CommandId> replayed;
+    {
+        NoopCommandStream stream;
+        stream.driverApi->setCapture(&recapture);
+        while (!replay.done()) {
+            CommandId const id = replay.replayNextCommand(*stream.driverApi);
+            ASSERT_NE(id, CommandId::COUNT);
+            replayed.push_back(id);
+        }
+        stream.driverApi->setCapture(nullptr);
+    }
+
+    std::vector<CommandId> const expected{
+            CommandId::createDescriptorSetLayout,
+            CommandId::createDescriptorSet,
+            CommandId::bindDescriptorSet,
+            CommandId::bindDescriptorSet,
+            CommandId::destroyDescriptorSet,
+            CommandId::destroyDescriptorSetLayout,
+    };
+    EXPECT_EQ(replayed, expected);
+    EXPECT_EQ(replay.getUnresolvedHandleCount(), 0u);
+    EXPECT_EQ(recapture.getCommandCount(), capture.getCommandCount());
+    ASSERT_EQ(recapture.getSize(), capture.getSize());
+    EXPECT_EQ(memcmp(recapture.getData(), capture.getData(), capture.getSize()), 0);
+}
+
+TEST(CommandStreamCaptureTest, UnknownDescriptorSetDropsOffsets) {
+    // A descriptor set created before the capture started has an unknown layout, its dynamic
+    // offsets can't be recorded, but the command itself must still replay.
+    CommandStreamCapture capture;
+    {
+        NoopCommandStream stream;
+        CommandStream& driverApi = *stream.driverApi;
+        DescriptorSetLayoutHandle const dslh = driverApi.createDescriptorSetLayout({
+                utils::FixedCapacityVector<DescriptorSetLayoutBinding>{
+                        { DescriptorType::UNIFORM_BUFFER, ShaderStageFlags::VERTEX, 0,
+                                DescriptorFlags::DYNAMIC_OFFSET }}});
+        DescriptorSetHandle const dsh = driverApi.createDescriptorSet(dslh);
+
+        driverApi.setCapture(&capture);
+        driverApi.bindDescriptorSet(dsh, 0, { { 64 }, driverApi });
+        driverApi.setCapture(nullptr);
+
+        driverApi.destroyDescriptorSet(dsh);
+        driverApi.destroyDescriptorSetLayout(dslh);
+    }
+    EXPECT_EQ(capture.getCommandCount(), 1u);
+
+    CommandStreamReplay replay(copyCapture(capture));
+    ASSERT_TRUE(replay.isValid());
+    {
+        NoopCommandStream stream;
+        EXPECT_EQ(replay.replayNextCommand(*stream.driverApi), CommandId::bindDescriptorSet);
+    }
+    EXPECT_TRUE(replay.done());
+    EXPECT_EQ(replay.getUnresolvedHandleCount(), 1u);
+}
+
+TEST(CommandStreamCaptureTest, PreambleRecreatesLiveResources) {
+    // magic, version and offset of the frame
+    constexpr size_t HEADER_SIZE = 16;
+
+    CommandStreamCapture resources(CommandStreamCapture::Mode::RESOURCES);
+    std::unique_ptr<CommandStreamCapture> capture;
+    {
+        NoopCommandStream stream;
+        CommandStream& driverApi = *stream.driverApi;
+        driverApi.setCapture(&resources);
+
+        DescriptorSetLayoutHandle const dslh = driverApi.createDescriptorSetLayout({
+                utils::FixedCapacityVector<DescriptorSetLayoutBinding>{
+                        { DescriptorType::UNIFORM_BUFFER, ShaderStageFlags::VERTEX, 0,
+                                DescriptorFlags::DYNAMIC_OFFSET }}});
+        DescriptorSetHandle const dsh = driverApi.createDescriptorSet(dslh);
+        BufferObjectHandle const boh = driverApi.createBufferObject(256,
+                BufferObjectBinding::UNIFORM, BufferUsage::DYNAMIC);
+        // the second update of the same range replaces the first one
+        for (uint8_t value : { 1, 2 }) {
+            void* const data = malloc(64);
+            memset(data, value, 64);
+            driverApi.updateBufferObject(boh, { data, 64,
+                    [](void* buffer, size_t, void*) { free(buffer); } }, 0);
+        }
+        driverApi.updateDescriptorSetBuffer(dsh, 0, boh, 0, 64);
+        // resources destroyed before the capture aren't part of it
+        driverApi.destroyBufferObject(driverApi.createBufferObject(16,
+                BufferObjectBinding::UNIFORM, BufferUsage::STATIC));
+        EXPECT_EQ(resources.getCommandCount(), 5u);
+
+        capture = std::make_unique<CommandStreamCapture>(&resources);
+        driverApi.setCapture(capture.get());
+        driverApi.bindDescriptorSet(dsh, 0, { { 64 }, driverApi });
+        driverApi.setCapture(capture->getResources());
+
+        driverApi.destroyDescriptorSet(dsh);
+        driverApi.destroyBufferObject(boh);
+        driverApi.destroyDescriptorSetLayout(dslh);
+        driverApi.setCapture(nullptr);
+    }
+    EXPECT_EQ(resources.getCommandCount(), 0u);
+    EXPECT_EQ(capture->getPreambleCommandCount(), 5u);
+    EXPECT_EQ(capture->getCommandCount(), 6u);
+
+    // All the handles are resolved, and the dynamic offsets of the descriptor set are known, so
+    // recording the replay produces the same commands. The frame can then be replayed again
+    // without its preamble.
+    CommandStreamReplay replay(copyCapture(*capture));
+    ASSERT_TRUE(replay.isValid());
+    CommandStreamCapture recapture;
+    std::vector<CommandId> replayed;
+    {
+        NoopCommandStream stream;
+        stream.driverApi->setCapture(&recapture);
+        while (replay.inPreamble()) {
+            replayed.push_back(replay.replayNextCommand(*stream.driverApi));
+        }
+        EXPECT_EQ(replayed.size(), 5u);
+        while (!replay.done()) {
+            replayed.push_back(replay.replayNextCommand(*stream.driverApi));
+        }
+        stream.driverApi->setCapture(nullptr);
+
+        replay.rewindToFrame();
+        EXPECT_FALSE(replay.inPreamble());
+        while (!replay.done()) {
+            replayed.push_back(replay.replayNextCommand(*stream.driverApi));
+        }
+    }
+
+    std::vector<CommandId> const expected{
+            CommandId::createDescriptorSetLayout,
+            CommandId::createDescriptorSet,
+            CommandId::createBufferObject,
+            CommandId::updateBufferObject,
+            CommandId::updateDescriptorSetBuffer,
+            CommandId::bindDescriptorSet,
+            CommandId::bindDescriptorSet,
+    };
+    EXPECT_EQ(replayed, expected);
+    EXPECT_EQ(replay.getUnresolvedHandleCount(), 0u);
+
+    // the recapture has no preamble, only its header differs
+    ASSERT_EQ(recapture.getSize(), capture->getSize());
+    EXPECT_EQ(memcmp(static_cast<uint8_t const*>(recapture.getData()) + HEADER_SIZE,
+            static_cast<uint8_t const*>(capture->getData()) + HEADER_SIZE,
+            capture->getSize() - HEADER_SIZE), 0);
+}
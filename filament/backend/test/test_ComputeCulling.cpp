@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BackendTest.h"
+
+#include <math/mat4.h>
+#include <math/vec4.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace test {
+
+using namespace filament;
+using namespace filament::backend;
+using namespace filament::math;
+
+// Culls bounding spheres against the 6 planes of a frustum. The visible instances are appended
+// to a compacted list, and their count is accumulated in the instanceCount of indirect draw
+// arguments, which can be consumed by drawIndirect() without a round-trip to the CPU.
+static const char* const cullingCs = R"(
+layout(local_size_x = 64) in;
+layout(std430, binding = 0) readonly buffer Scene {
+    vec4 planes[6];
+    vec4 spheres[];
+} scene;
+layout(std430, binding = 1) buffer DrawArgs {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+} args;
+layout(std430, binding = 2) writeonly buffer Visible {
+    uint instances[];
+} visible;
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    vec4 s = scene.spheres[i];
+    bool inside = true;
+    for (int p = 0; p < 6; p++) {
+        inside = inside && (dot(scene.planes[p].xyz, s.xyz) + scene.planes[p].w >= -s.w);
+    }
+    if (inside) {
+        uint slot = atomicAdd(args.instanceCount, 1u);
+        visible.instances[slot] = i;
+    }
+})";
+
+// Returns the normalized planes of the frustum of the projection p, pointing inward
+static void getFrustumPlanes(mat4f const& p, float4 planes[6]) noexcept {
+    mat4f const t = transpose(p);
+    planes[0] = t[3] + t[0];    // left
+    planes[1] = t[3] - t[0];    // right
+    planes[2] = t[3] + t[1];    // bottom
+    planes[3] = t[3] - t[1];    // top
+    planes[4] = t[3] + t[2];    // near
+    planes[5] = t[3] - t[2];    // far
+    for (size_t i = 0; i < 6; i++) {
+        planes[i] /= length(planes[i].xyz);
+    }
+}
+
+TEST_F(BackendTest, ComputeFrustumCulling) {
+    auto& api = getDriverApi();
+
+    // Compute is only wired through descriptor sets in the OpenGL backend for now
+    if (sBackend != Backend::OPENGL ||
+            api.getFeatureLevel() < FeatureLevel::FEATURE_LEVEL_2) {
+        GTEST_SKIP();
+    }
+
+    constexpr uint32_t kGroupSize = 64;
+    constexpr uint32_t kInstanceCount = 64 * 1024;
+
+    float4 planes[6];
+    getFrustumPlanes(mat4f::perspective(60.0f, 1.0f, 0.1f, 100.0f), planes);
+
+    // Generate the bounding spheres and the expected result. Spheres too close to a plane are
+    // moved away from it, so the result doesn't depend on the floating-point precision.
+    std::vector<float4> spheres(kInstanceCount);
+    std::vector<uint32_t> expected;
+    uint32_t seed = 1;
+    auto const random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return float(seed >> 8u) / float(1u << 24u);
+    };
+    for (uint32_t i = 0; i < kInstanceCount; i++) {
+        float4 s;
+        bool inside;
+        bool ambiguous;
+        do {
+            s = { random() * 200.0f - 100.0f, random() * 200.0f - 100.0f,
+                  -random() * 120.0f, random() * 2.0f };
+            inside = true;
+            ambiguous = false;
+            for (float4 const& plane : planes) {
+                float const d = dot(plane.xyz, s.xyz) + plane.w + s.w;
+                inside = inside && d >= 0.0f;
+                ambiguous = ambiguous || std::abs(d) < 1e-3f;
+            }
+        } while (ambiguous);
+        spheres[i] = s;
+        if (inside) {
+            expected.push_back(i);
+        }
+    }
+    ASSERT_FALSE(expected.empty());
+    ASSERT_LT(expected.size(), kInstanceCount);
+
+    size_t const sceneSize = sizeof(planes) + kInstanceCount * sizeof(float4);
+    size_t const visibleSize = kInstanceCount * sizeof(uint32_t);
+
+    DrawIndexedIndirectArgs drawArgs{};
+    uint32_t* const visible = (uint32_t*)calloc(1, visibleSize);
+
+    // The test is executed within this block scope to force destructors to run before
+    // executeCommands().
+    {
+        // Create a SwapChain and make it current, compute needs a current context.
+        auto swapChain = api.createSwapChainHeadless(256, 256, 0);
+        api.makeCurrent(swapChain, swapChain);
+
+        std::string const shader = std::string(sIsMobilePlatform ?
+                "#version 310 es\nprecision highp float;\n" : "#version 450 core\n") + cullingCs;
+
+        Program p;
+        p.shaderLanguage(ShaderLanguage::ESSL3);
+        p.shader(ShaderStage::COMPUTE, shader.data(), shader.size() + 1);
+        p.descriptorBindings(0, {
+                { "Scene", DescriptorType::SHADER_STORAGE_BUFFER, 0 },
+                { "DrawArgs", DescriptorType::SHADER_STORAGE_BUFFER, 1 },
+                { "Visible", DescriptorType::SHADER_STORAGE_BUFFER, 2 }});
+        ProgramHandle program = api.createProgram(std::move(p));
+
+        DescriptorSetLayoutHandle descriptorSetLayout = api.createDescriptorSetLayout({{
+                { DescriptorType::SHADER_STORAGE_BUFFER, ShaderStageFlags::COMPUTE, 0,
+                        DescriptorFlags::NONE, 0 },
+                { DescriptorType::SHADER_STORAGE_BUFFER, ShaderStageFlags::COMPUTE, 1,
+                        DescriptorFlags::NONE, 0 },
+                { DescriptorType::SHADER_STORAGE_BUFFER, ShaderStageFlags::COMPUTE, 2,
+                        DescriptorFlags::NONE, 0 }}});
+        DescriptorSetHandle descriptorSet = api.createDescriptorSet(descriptorSetLayout);
+
+        auto* const scene = (float4*)malloc(sceneSize);
+        memcpy(scene, planes, sizeof(planes));
+        memcpy(scene + 6, spheres.data(), kInstanceCount * sizeof(float4));
+        BufferObjectHandle sceneBuffer = api.createBufferObject(sceneSize,
+                BufferObjectBinding::SHADER_STORAGE, BufferUsage::STATIC);
+        api.updateBufferObject(sceneBuffer, { scene, sceneSize,
+                [](void* buffer, size_t, void*) { free(buffer); } }, 0);
+
+        // The culling pass produces the arguments of a single instanced draw
+        auto* const args = (DrawIndexedIndirectArgs*)malloc(sizeof(DrawIndexedIndirectArgs));
+        *args = { .indexCount = 3, .instanceCount = 0 };
+        BufferObjectHandle argsBuffer = api.createBufferObject(sizeof(DrawIndexedIndirectArgs),
+                BufferObjectBinding::DRAW_INDIRECT, BufferUsage::STATIC);
+        api.updateBufferObject(argsBuffer, { args, sizeof(DrawIndexedIndirectArgs),
+                [](void* buffer, size_t, void*) { free(buffer); } }, 0);
+
+        BufferObjectHandle visibleBuffer = api.createBufferObject(visibleSize,
+                BufferObjectBinding::SHADER_STORAGE, BufferUsage::STATIC);
+
+        api.updateDescriptorSetBuffer(descriptorSet, 0, sceneBuffer, 0, sceneSize);
+        api.updateDescriptorSetBuffer(descriptorSet, 1, argsBuffer, 0,
+                sizeof(DrawIndexedIndirectArgs));
+        api.updateDescriptorSetBuffer(descriptorSet, 2, visibleBuffer, 0, visibleSize);
+
+        api.beginFrame(0, 0, 0);
+
+        api.bindDescriptorSet(descriptorSet, 0, {});
+        api.dispatchCompute(program, { kInstanceCount / kGroupSize, 1, 1 });
+
+        api.readBufferSubData(argsBuffer, 0, sizeof(DrawIndexedIndirectArgs),
+                { &drawArgs, sizeof(DrawIndexedIndirectArgs) });
+        api.readBufferSubData(visibleBuffer, 0, visibleSize, { visible, visibleSize });
+
+        api.commit(swapChain);
+        api.endFrame(0);
+
+        // Cleanup.
+        api.destroyBufferObject(visibleBuffer);
+        api.destroyBufferObject(argsBuffer);
+        api.destroyBufferObject(sceneBuffer);
+        api.destroyDescriptorSet(descriptorSet);
+        api.destroyDescriptorSetLayout(descriptorSetLayout);
+        api.destroyProgram(program);
+        api.destroySwapChain(swapChain);
+    }
+
+    // Wait for the readbacks to come back.
+    api.finish();
+
+    executeCommands();
+    getDriver().purge();
+
+    EXPECT_EQ(drawArgs.indexCount, 3u);
+    EXPECT_EQ(drawArgs.instanceCount, expected.size());
+
+    // the order of the compacted list depends on the scheduling of the invocations
+    std::vector<uint32_t> result(visible, visible + std::min(
+            size_t(drawArgs.instanceCount), size_t(kInstanceCount)));
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(result, expected);
+
+    free(visible);
+}
+
+} // namespace test
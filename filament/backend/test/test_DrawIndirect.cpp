@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BackendTest.h"
+
+#include "ShaderGenerator.h"
+#include "TrianglePrimitive.h"
+
+#include <utils/Hash.h>
+
+#include <stdlib.h>
+
+namespace test {
+
+using namespace filament;
+using namespace filament::backend;
+
+static const char* const triangleVs = R"(#version 450 core
+layout(location = 0) in vec4 mesh_position;
+void main() {
+    gl_Position = vec4(mesh_position.xy, 0.0, 1.0);
+#if defined(TARGET_VULKAN_ENVIRONMENT)
+    // In Vulkan, clip space is Y-down. In OpenGL and Metal, clip space is Y-up.
+    gl_Position.y = -gl_Position.y;
+#endif
+})";
+
+static const char* const triangleFs = R"(#version 450 core
+precision mediump int; precision highp float;
+layout(location = 0) out vec4 fragColor;
+void main() {
+    fragColor = vec4(1.0f);
+})";
+
+// Reads back the render target and stores the hash of its content in *hash
+static void readPixelsHash(DriverApi& api, Handle<HwRenderTarget> rt,
+        uint32_t width, uint32_t height, uint32_t* hash) {
+    size_t const size = width * height * 4;
+    PixelBufferDescriptor pbd(calloc(1, size), size,
+            PixelDataFormat::RGBA, PixelDataType::UBYTE, 1, 0, 0, width,
+            [](void* buffer, size_t size, void* user) {
+                *(uint32_t*)user = utils::hash::murmur3((const uint32_t*)buffer, size / 4, 0);
+                free(buffer);
+            }, hash);
+    api.readPixels(rt, 0, 0, width, height, std::move(pbd));
+}
+
+// An indirect multi-draw must render the same image as the equivalent direct draws
+TEST_F(BackendTest, DrawIndirectMatchesDraw) {
+    auto& api = getDriverApi();
+
+    if (!api.isMultiDrawIndirectSupported()) {
+        GTEST_SKIP();
+    }
+
+    constexpr uint32_t kWidth = 256;
+    constexpr uint32_t kHeight = 256;
+
+    uint32_t expectedHash = 0;
+    uint32_t indirectHash = 1;
+
+    // The test is executed within this block scope to force destructors to run before
+    // executeCommands().
+    {
+        // Create a SwapChain and make it current. We don't really use it so the res doesn't matter.
+        auto swapChain = api.createSwapChainHeadless(256, 256, 0);
+        api.makeCurrent(swapChain, swapChain);
+
+        // Create a program.
+        ShaderGenerator shaderGen(triangleVs, triangleFs, sBackend, sIsMobilePlatform);
+        Program p = shaderGen.getProgram(api);
+        ProgramHandle program = api.createProgram(std::move(p));
+
+        Handle<HwTexture> texture = api.createTexture(SamplerType::SAMPLER_2D, 1,
+                TextureFormat::RGBA8, 1, kWidth, kHeight, 1,
+                TextureUsage::SAMPLEABLE | TextureUsage::COLOR_ATTACHMENT);
+
+        Handle<HwRenderTarget> renderTarget = api.createRenderTarget(TargetBufferFlags::COLOR,
+                kWidth, kHeight, 1, 0, { texture, 0, 0 }, {}, {});
+
+        TrianglePrimitive triangle(api);
+
+        // The second draw is empty, this checks that the draws are read at the right stride.
+        size_t const argsSize = 2 * sizeof(DrawIndexedIndirectArgs);
+        auto* args = (DrawIndexedIndirectArgs*)malloc(argsSize);
+        args[0] = { .indexCount = 3, .instanceCount = 1 };
+        args[1] = { .indexCount = 0, .instanceCount = 1 };
+        BufferObjectHandle argsBuffer = api.createBufferObject(argsSize,
+                BufferObjectBinding::DRAW_INDIRECT, BufferUsage::STATIC);
+        api.updateBufferObject(argsBuffer, { args, argsSize,
+                [](void* buffer, size_t, void*) { free(buffer); } }, 0);
+
+        RenderPassParams params = {};
+        params.flags.clear = TargetBufferFlags::COLOR0;
+        params.viewport = { 0, 0, kWidth, kHeight };
+        params.clearColor = math::float4(0.0f, 0.0f, 1.0f, 1.0f);
+        params.flags.discardStart = TargetBufferFlags::ALL;
+        params.flags.discardEnd = TargetBufferFlags::NONE;
+
+        PipelineState ps = {};
+        ps.program = program;
+        ps.rasterState.colorWrite = true;
+        ps.rasterState.depthWrite = false;
+        ps.rasterState.culling = CullingMode::NONE;
+
+        api.makeCurrent(swapChain, swapChain);
+        api.beginFrame(0, 0, 0);
+
+        // Render a white triangle over blue, with a regular draw.
+        api.beginRenderPass(renderTarget, params);
+        api.draw(ps, triangle.getRenderPrimitive(), 0, 3, 1);
+        api.endRenderPass();
+        readPixelsHash(api, renderTarget, kWidth, kHeight, &expectedHash);
+
+        // Render the same triangle with an indirect multi-draw.
+        api.beginRenderPass(renderTarget, params);
+        ps.primitiveType = PrimitiveType::TRIANGLES;
+        ps.vertexBufferInfo = triangle.getVertexBufferInfo();
+        api.bindPipeline(ps);
+        api.bindRenderPrimitive(triangle.getRenderPrimitive());
+        api.drawIndirect(argsBuffer, 0, 2);
+        api.endRenderPass();
+        readPixelsHash(api, renderTarget, kWidth, kHeight, &indirectHash);
+
+        api.commit(swapChain);
+        api.endFrame(0);
+
+        // Cleanup.
+        api.destroyBufferObject(argsBuffer);
+        api.destroyRenderTarget(renderTarget);
+        api.destroyTexture(texture);
+        api.destroyProgram(program);
+        api.destroySwapChain(swapChain);
+    }
+
+    // Wait for the ReadPixels results to come back.
+    api.finish();
+
+    executeCommands();
+    getDriver().purge();
+
+    EXPECT_EQ(expectedHash, indirectHash);
+}
+
+} // namespace test
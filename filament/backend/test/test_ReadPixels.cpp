@@ -22,8 +22,10 @@
 
 #include <utils/Hash.h>
 
-#include <fstream>
 #include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
 
 using namespace filament;
 using namespace filament::backend;
@@ -468,4 +470,112 @@ TEST_F(ReadPixelsTest, ReadPixelsPerformance) {
     executeCommands();
 }
 
+// Reads back a 1080p render target every frame, without waiting for the readbacks to complete,
+// as a video encoder would. On OpenGL, this reuses the same few pixel pack buffers.
+TEST_F(ReadPixelsTest, ReadPixelsPipelinedThroughput) {
+    const size_t width = 1920;
+    const size_t height = 1080;
+    const size_t frameSize = width * height * 4;
+    const int frameCount = 120;
+    const int maxFramesInFlight = 3;
+
+    auto swapChain = getDriverApi().createSwapChainHeadless(width, height, 0);
+    getDriverApi().makeCurrent(swapChain, swapChain);
+
+    ShaderGenerator shaderGen(vertex, fragmentFloat, sBackend, sIsMobilePlatform);
+    Program p = shaderGen.getProgram(getDriverApi());
+    auto program = getDriverApi().createProgram(std::move(p));
+
+    Handle<HwTexture> texture = getDriverApi().createTexture(SamplerType::SAMPLER_2D, 1,
+            TextureFormat::RGBA8, 1, width, height, 1,
+            TextureUsage::COLOR_ATTACHMENT | TextureUsage::SAMPLEABLE);
+    Handle<HwRenderTarget> renderTarget = getDriverApi().createRenderTarget(
+            TargetBufferFlags::COLOR, width, height, 1, 0, {{ texture }}, {}, {});
+
+    TrianglePrimitive triangle(getDriverApi());
+
+    RenderPassParams params = {};
+    fullViewport(params);
+    params.flags.clear = TargetBufferFlags::COLOR;
+    params.clearColor = {0.f, 0.f, 1.f, 1.f};
+    params.flags.discardStart = TargetBufferFlags::ALL;
+    params.flags.discardEnd = TargetBufferFlags::NONE;
+    params.viewport.width = width;
+    params.viewport.height = height;
+
+    PipelineState state;
+    state.program = program;
+    state.rasterState.colorWrite = true;
+    state.rasterState.depthWrite = false;
+    state.rasterState.depthFunc = RasterState::DepthFunc::A;
+    state.rasterState.culling = CullingMode::NONE;
+
+    // the caller's buffers, used in turn
+    struct Frame {
+        std::unique_ptr<uint8_t[]> buffer;
+        bool pending = false;
+    };
+    Frame frames[maxFramesInFlight];
+    for (Frame& frame : frames) {
+        frame.buffer = std::make_unique<uint8_t[]>(frameSize);
+    }
+
+    int stallCount = 0;
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frameCount; ++i) {
+        Frame& frame = frames[i % maxFramesInFlight];
+        if (frame.pending) {
+            // the readback of this buffer is still in flight
+            flushAndWait();
+            stallCount++;
+        }
+        ASSERT_FALSE(frame.pending);
+
+        getDriverApi().makeCurrent(swapChain, swapChain);
+        getDriverApi().beginFrame(0, 0, 0);
+
+        getDriverApi().beginRenderPass(renderTarget, params);
+        getDriverApi().draw(state, triangle.getRenderPrimitive(), 0, 3, 1);
+        getDriverApi().endRenderPass();
+
+        frame.pending = true;
+        PixelBufferDescriptor descriptor(frame.buffer.get(), frameSize,
+                PixelDataFormat::RGBA, PixelDataType::UBYTE, 1, 0, 0, width,
+                [](void*, size_t, void* user) {
+                    static_cast<Frame*>(user)->pending = false;
+                }, &frame);
+        getDriverApi().readPixels(renderTarget, 0, 0, width, height, std::move(descriptor));
+
+        getDriverApi().commit(swapChain);
+        getDriverApi().endFrame(0);
+
+        // don't wait for the GPU, flush() runs the callbacks of the completed readbacks
+        getDriverApi().flush();
+        executeCommands();
+        getDriver().purge();
+    }
+    flushAndWait();
+    auto const elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+    for (Frame const& frame : frames) {
+        EXPECT_FALSE(frame.pending);
+        // pixels are either white or the clear color, both have a blue component of 1
+        EXPECT_EQ(frame.buffer[2], 0xFF);
+        EXPECT_EQ(frame.buffer[frameSize - 2], 0xFF);
+    }
+
+    printf("Read back %d frames of %zux%zu in %.3f s: %.1f fps, %.1f MiB/s, %d stalls\n",
+            frameCount, width, height, elapsed,
+            frameCount / elapsed, double(frameCount * frameSize) / (1024.0 * 1024.0) / elapsed,
+            stallCount);
+
+    getDriverApi().destroyProgram(program);
+    getDriverApi().destroySwapChain(swapChain);
+    getDriverApi().destroyRenderTarget(renderTarget);
+    getDriverApi().destroyTexture(texture);
+    getDriverApi().finish();
+    executeCommands();
+}
+
 } // namespace test
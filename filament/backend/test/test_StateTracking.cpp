@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BackendTest.h"
+
+#include "ShaderGenerator.h"
+#include "TrianglePrimitive.h"
+
+namespace test {
+
+using namespace filament;
+using namespace filament::backend;
+
+static const char* const triangleVs = R"(#version 450 core
+layout(location = 0) in vec4 mesh_position;
+void main() {
+    gl_Position = vec4(mesh_position.xy, 0.0, 1.0);
+#if defined(TARGET_VULKAN_ENVIRONMENT)
+    // In Vulkan, clip space is Y-down. In OpenGL and Metal, clip space is Y-up.
+    gl_Position.y = -gl_Position.y;
+#endif
+})";
+
+static const char* const triangleFs = R"(#version 450 core
+precision mediump int; precision highp float;
+layout(location = 0) out vec4 fragColor;
+void main() {
+    fragColor = vec4(1.0f);
+})";
+
+// Draws with an unchanged pipeline state must not make any state change
+TEST_F(BackendTest, RedundantStateChangesAreElided) {
+    auto& api = getDriverApi();
+
+    // Only the OpenGL backend tracks its state changes
+    if (sBackend != Backend::OPENGL) {
+        GTEST_SKIP();
+    }
+
+    StateChangeStatistics afterFirstDraw;
+    StateChangeStatistics afterLastDraw;
+
+    // The test is executed within this block scope to force destructors to run before
+    // executeCommands().
+    {
+        auto swapChain = api.createSwapChainHeadless(256, 256, 0);
+        api.makeCurrent(swapChain, swapChain);
+
+        ShaderGenerator shaderGen(triangleVs, triangleFs, sBackend, sIsMobilePlatform);
+        Program p = shaderGen.getProgram(api);
+        ProgramHandle program = api.createProgram(std::move(p));
+
+        auto defaultRenderTarget = api.createDefaultRenderTarget(0);
+
+        TrianglePrimitive triangle(api);
+
+        RenderPassParams params = {};
+        fullViewport(params);
+        params.flags.clear = TargetBufferFlags::COLOR;
+        params.flags.discardStart = TargetBufferFlags::ALL;
+        params.flags.discardEnd = TargetBufferFlags::NONE;
+
+        PipelineState ps = {};
+        ps.program = program;
+        ps.rasterState.colorWrite = true;
+        ps.rasterState.depthWrite = false;
+        ps.rasterState.culling = CullingMode::NONE;
+
+        api.beginFrame(0, 0, 0);
+        api.beginRenderPass(defaultRenderTarget, params);
+
+        api.draw(ps, triangle.getRenderPrimitive(), 0, 3, 1);
+        api.queueCommand([&]() {
+            afterFirstDraw = getDriver().getStateChangeStatistics();
+        });
+
+        for (int i = 0; i < 8; i++) {
+            api.draw(ps, triangle.getRenderPrimitive(), 0, 3, 1);
+        }
+        api.queueCommand([&]() {
+            afterLastDraw = getDriver().getStateChangeStatistics();
+        });
+
+        api.endRenderPass();
+        api.commit(swapChain);
+        api.endFrame(0);
+
+        api.destroyProgram(program);
+        api.destroyRenderTarget(defaultRenderTarget);
+        api.destroySwapChain(swapChain);
+    }
+
+    api.finish();
+
+    executeCommands();
+    getDriver().purge();
+
+    EXPECT_GT(afterFirstDraw.issued, 0u);
+    EXPECT_EQ(afterLastDraw.issued, afterFirstDraw.issued);
+    EXPECT_GT(afterLastDraw.elided, afterFirstDraw.elided);
+}
+
+} // namespace test
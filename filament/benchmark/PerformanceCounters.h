@@ -31,7 +31,9 @@ class PerformanceCounters {
 public:
     explicit PerformanceCounters(benchmark::State& state)
             : state(state) {
-        profiler.resetEvents(utils::Profiler::EV_CPU_CYCLES | utils::Profiler::EV_BPU_MISSES);
+        // instructions are always counted; keep the group small enough to be scheduled at once
+        profiler.resetEvents(utils::Profiler::EV_CPU_CYCLES |
+                utils::Profiler::EV_L1D_MISSES | utils::Profiler::EV_BPU_MISSES);
         profiler.start();
     }
 
@@ -49,6 +51,8 @@ public:
                     { "I",   { avgItem * (double)counters.getInstructions(), benchmark::Counter::kAvgIterations }},
                     { "BPU", { std::floor(0.5 + avgItem * (double)counters.getBranchMisses() / state.iterations()), benchmark::Counter::kDefaults }},
                     { "CPI", {           (double)counters.getCPI(),          benchmark::Counter::kAvgThreads }},
+                    { "IPC", {           (double)counters.getIPC(),          benchmark::Counter::kAvgThreads }},
+                    { "L1DM",{ avgItem * (double)counters.getL1DMisses(),    benchmark::Counter::kAvgIterations }},
             });
         }
     }
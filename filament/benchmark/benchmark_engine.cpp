@@ -0,0 +1,508 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include "Allocators.h"
+#include "Froxelizer.h"
+#include "RenderPass.h"
+
+#include "details/Camera.h"
+#include "details/ColorGrading.h"
+#include "details/Engine.h"
+#include "details/Material.h"
+#include "details/Scene.h"
+#include "details/View.h"
+
+#include <filament/Box.h>
+#include <filament/Camera.h>
+#include <filament/ColorGrading.h>
+#include <filament/Engine.h>
+#include <filament/Frustum.h>
+#include <filament/IndexBuffer.h>
+#include <filament/LightManager.h>
+#include <filament/Material.h>
+#include <filament/MaterialInstance.h>
+#include <filament/RenderableManager.h>
+#include <filament/Scene.h>
+#include <filament/ToneMapper.h>
+#include <filament/TransformManager.h>
+#include <filament/VertexBuffer.h>
+#include <filament/View.h>
+#include <filament/Viewport.h>
+
+#include <utils/EntityManager.h>
+#include <utils/JobSystem.h>
+
+#include <math/half.h>
+#include <math/mat4.h>
+#include <math/vec3.h>
+#include <math/vec4.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace filament;
+using namespace filament::math;
+using namespace utils;
+
+/*
+ * Engine-level benchmarks. A synthetic scene made of state.range(0) cubes and 256 point lights,
+ * scattered in front of the camera, is rendered with the NOOP backend, and the CPU kernels
+ * that run for each frame are measured individually.
+ */
+class FilamentEngineFixture : public benchmark::Fixture {
+protected:
+    static constexpr size_t LIGHT_COUNT = 256;
+    static constexpr size_t ARENA_SIZE = 32u * 1024u * 1024u;
+    static constexpr uint32_t WIDTH = 1920;
+    static constexpr uint32_t HEIGHT = 1080;
+
+    FEngine* engine = nullptr;
+    FScene* scene = nullptr;
+    FView* view = nullptr;
+    FCamera* camera = nullptr;
+    VertexBuffer* vertexBuffer = nullptr;
+    IndexBuffer* indexBuffer = nullptr;
+    Entity cameraEntity;
+    Entity sun;
+    std::vector<Entity> renderables;
+    std::vector<Entity> lights;
+    std::vector<mat4f> transforms;
+
+    RootArenaScope::Arena arena{ "FilamentEngineFixture", ARENA_SIZE };
+    std::vector<uint8_t> commandArenaStorage;
+
+public:
+    void SetUp(benchmark::State& state) override {
+        Engine* const e = Engine::create(Engine::Backend::NOOP);
+        engine = downcast(e);
+
+        static const float3 vertices[8] = {
+                { -1, -1, -1 }, {  1, -1, -1 }, { -1,  1, -1 }, {  1,  1, -1 },
+                { -1, -1,  1 }, {  1, -1,  1 }, { -1,  1,  1 }, {  1,  1,  1 },
+        };
+        static const uint16_t indices[36] = {
+                0, 1, 3,  0, 3, 2,  4, 6, 7,  4, 7, 5,  0, 2, 6,  0, 6, 4,
+                1, 5, 7,  1, 7, 3,  0, 4, 5,  0, 5, 1,  2, 3, 7,  2, 7, 6,
+        };
+
+        vertexBuffer = VertexBuffer::Builder()
+                .vertexCount(8)
+                .bufferCount(1)
+                .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+                .build(*e);
+        vertexBuffer->setBufferAt(*e, 0, { vertices, sizeof(vertices) });
+
+        indexBuffer = IndexBuffer::Builder()
+                .indexCount(36)
+                .bufferType(IndexBuffer::IndexType::USHORT)
+                .build(*e);
+        indexBuffer->setBuffer(*e, { indices, sizeof(indices) });
+
+        Scene* const s = e->createScene();
+        scene = downcast(s);
+
+        EntityManager& em = EntityManager::get();
+        auto& tcm = e->getTransformManager();
+        MaterialInstance const* const mi = e->getDefaultMaterial()->getDefaultInstance();
+
+        std::default_random_engine gen; // NOLINT
+        std::uniform_real_distribution<float> rand(-100.0f, 100.0f);
+        auto randomPosition = [&]() -> float3 {
+            // roughly half the scene is in front of the camera
+            float const z = -std::abs(rand(gen));
+            return { rand(gen), rand(gen), z };
+        };
+
+        size_t const renderableCount = size_t(state.range(0));
+        renderables.resize(renderableCount);
+        transforms.resize(renderableCount);
+        em.create(renderableCount, renderables.data());
+        for (size_t i = 0; i < renderableCount; i++) {
+            RenderableManager::Builder(1)
+                    .boundingBox({{ -1, -1, -1 }, { 1, 1, 1 }})
+                    .material(0, mi)
+                    .geometry(0, RenderableManager::PrimitiveType::TRIANGLES,
+                            vertexBuffer, indexBuffer, 0, 36)
+                    .castShadows(i % 4 == 0)
+                    .build(*e, renderables[i]);
+            transforms[i] = mat4f::translation(randomPosition());
+            tcm.create(renderables[i], {}, transforms[i]);
+            s->addEntity(renderables[i]);
+        }
+
+        lights.resize(LIGHT_COUNT);
+        em.create(LIGHT_COUNT, lights.data());
+        for (Entity const light : lights) {
+            LightManager::Builder(LightManager::Type::POINT)
+                    .position(randomPosition())
+                    .falloff(10.0f)
+                    .intensity(1000.0f)
+                    .build(*e, light);
+            s->addEntity(light);
+        }
+
+        sun = em.create();
+        LightManager::Builder(LightManager::Type::SUN)
+                .direction({ 0, -1, -1 })
+                .castShadows(true)
+                .build(*e, sun);
+        s->addEntity(sun);
+
+        cameraEntity = em.create();
+        Camera* const c = e->createCamera(cameraEntity);
+        c->setProjection(45.0, double(WIDTH) / HEIGHT, 0.1, 200.0);
+        camera = downcast(c);
+
+        view = downcast(e->createView());
+        view->setScene(scene);
+        view->setCamera(camera);
+        view->setViewport({ 0, 0, WIDTH, HEIGHT });
+
+        commandArenaStorage.resize(engine->getPerFrameCommandsSize());
+    }
+
+    void TearDown(benchmark::State&) override {
+        Engine* e = engine;
+        EntityManager& em = EntityManager::get();
+        e->destroy(view);
+        e->destroy(scene);
+        e->destroyCameraComponent(cameraEntity);
+        for (Entity const entity : renderables) {
+            e->destroy(entity);
+        }
+        for (Entity const entity : lights) {
+            e->destroy(entity);
+        }
+        e->destroy(sun);
+        e->destroy(vertexBuffer);
+        e->destroy(indexBuffer);
+        em.destroy(cameraEntity);
+        em.destroy(sun);
+        em.destroy(renderables.size(), renderables.data());
+        em.destroy(lights.size(), lights.data());
+        renderables.clear();
+        lights.clear();
+        Engine::destroy(&e);
+        engine = nullptr;
+    }
+
+    // Runs FView::prepare() like the Renderer does, so that the scene's renderable and light
+    // data are ready for the kernels measured below.
+    CameraInfo prepareView(RootArenaScope& rootArenaScope) {
+        CameraInfo const cameraInfo = view->computeCameraInfo(*engine);
+        view->prepare(*engine, engine->getDriverApi(), rootArenaScope, view->getViewport(),
+                cameraInfo, {}, false);
+        if (auto* sync = view->getFroxelizerSync()) {
+            engine->getJobSystem().waitAndRelease(sync);
+            view->setFroxelizerSync(nullptr);
+        }
+        engine->flush();
+        return cameraInfo;
+    }
+};
+
+BENCHMARK_DEFINE_F(FilamentEngineFixture, scenePrepare)(benchmark::State& state) {
+    JobSystem& js = engine->getJobSystem();
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            RootArenaScope rootArenaScope(arena);
+            scene->prepare(js, rootArenaScope, mat4{}, false);
+        }
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK_DEFINE_F(FilamentEngineFixture, culling)(benchmark::State& state) {
+    JobSystem& js = engine->getJobSystem();
+    RootArenaScope rootArenaScope(arena);
+    CameraInfo const cameraInfo = prepareView(rootArenaScope);
+    Frustum const frustum{ mat4f{
+            highPrecisionMultiply(cameraInfo.cullingProjection, cameraInfo.view) }};
+    FScene::RenderableSoa& soa = scene->getRenderableData();
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            FView::cullRenderables(js, soa, frustum, 0);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK_DEFINE_F(FilamentEngineFixture, renderPass)(benchmark::State& state) {
+    RootArenaScope rootArenaScope(arena);
+    CameraInfo const cameraInfo = prepareView(rootArenaScope);
+    FScene::RenderableSoa& soa = scene->getRenderableData();
+    view->updatePrimitivesLod(*engine, cameraInfo, soa, view->getVisibleRenderables());
+    void* const begin = commandArenaStorage.data();
+    void* const end = commandArenaStorage.data() + commandArenaStorage.size();
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            // generates and sorts the color pass commands
+            RenderPass::Arena commandArena("Command Arena", { begin, end });
+            RenderPass const pass = RenderPassBuilder(commandArena)
+                    .commandTypeFlags(RenderPass::CommandTypeFlags::COLOR)
+                    .camera(cameraInfo)
+                    .geometry(soa, view->getVisibleRenderables())
+                    .colorPassDescriptorSet(&view->getColorPassDescriptorSet())
+                    .build(*engine);
+            benchmark::DoNotOptimize(pass.begin());
+        }
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * view->getVisibleRenderables().size());
+    }
+}
+
+BENCHMARK_DEFINE_F(FilamentEngineFixture, froxelization)(benchmark::State& state) {
+    RootArenaScope rootArenaScope(arena);
+    CameraInfo const cameraInfo = prepareView(rootArenaScope);
+    Froxelizer froxelizer(*engine);
+    froxelizer.prepare(engine->getDriverApi(), rootArenaScope, view->getViewport(),
+            cameraInfo.projection, cameraInfo.zn, cameraInfo.zf);
+    FScene::LightSoa const& lightData = scene->getLightData();
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            froxelizer.froxelizeLights(*engine, cameraInfo.view, lightData);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * lightData.size());
+    }
+    froxelizer.terminate(engine->getDriverApi());
+    engine->flush();
+}
+
+BENCHMARK_DEFINE_F(FilamentEngineFixture, transformUpdate)(benchmark::State& state) {
+    auto& tcm = engine->getTransformManager();
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            for (size_t i = 0, c = renderables.size(); i < c; i++) {
+                tcm.setTransform(tcm.getInstance(renderables[i]), transforms[i]);
+            }
+        }
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+/*
+ * Material instance benchmarks. state.range(0) instances of the skybox material are created, and
+ * for each frame 1% of them change a parameter before FEngine::prepare() commits them.
+ */
+class FilamentMaterialInstanceFixture : public benchmark::Fixture {
+protected:
+    FEngine* engine = nullptr;
+    std::vector<MaterialInstance*> instances;
+
+public:
+    void SetUp(benchmark::State& state) override {
+        engine = downcast(Engine::create(Engine::Backend::NOOP));
+        Material const* const material = engine->getSkyboxMaterial();
+        instances.resize(size_t(state.range(0)));
+        for (MaterialInstance*& mi : instances) {
+            mi = material->createInstance();
+        }
+        // the first frame commits all the instances
+        engine->prepare();
+        engine->flush();
+    }
+
+    void TearDown(benchmark::State&) override {
+        Engine* e = engine;
+        for (MaterialInstance* const mi : instances) {
+            e->destroy(mi);
+        }
+        instances.clear();
+        Engine::destroy(&e);
+        engine = nullptr;
+    }
+};
+
+BENCHMARK_DEFINE_F(FilamentMaterialInstanceFixture, prepare)(benchmark::State& state) {
+    size_t const count = instances.size();
+    size_t const dirtyCount = std::max(count / 100, size_t(1));
+    size_t next = 0;
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            for (size_t i = 0; i < dirtyCount; i++) {
+                instances[next]->setParameter("color", float4{ float(i) });
+                next = (next + 1) % count;
+            }
+            engine->prepare();
+            state.PauseTiming();
+            engine->flush();
+            state.ResumeTiming();
+        }
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * dirtyCount);
+    }
+}
+
+/*
+ * Color grading LUT generation benchmarks. The argument is the dimension of the LUT, the LUTs
+ * have adjustments in every stage and use the RGB10_A2 format.
+ */
+class FilamentColorGradingFixture : public benchmark::Fixture {
+protected:
+    FEngine* engine = nullptr;
+    ACESToneMapper aces;
+    FilmicToneMapper filmic;
+    std::vector<half4> data;
+    std::vector<uint32_t> converted;
+
+    ColorGrading::Builder createBuilder(benchmark::State const& state,
+            ToneMapper const& toneMapper, float contrast) {
+        ColorGrading::Builder builder;
+        builder.dimensions(uint8_t(state.range(0)))
+                .toneMapper(&toneMapper)
+                .exposure(0.5f)
+                .contrast(contrast)
+                .curves(float3{ 0.9f }, float3{ 1.1f }, float3{ 0.95f });
+        // build() finds out whether the builder has adjustments
+        engine->destroy(downcast(builder.build(*engine)));
+        return builder;
+    }
+
+    void generate(ColorGrading::Builder const& builder, FColorGrading::StageCache* cache) {
+        FColorGrading::generateLut(engine->getJobSystem(), builder, cache,
+                data.data(), converted.data());
+    }
+
+public:
+    void SetUp(benchmark::State& state) override {
+        engine = downcast(Engine::create(Engine::Backend::NOOP));
+        size_t const dimension = size_t(state.range(0));
+        data.resize(dimension * dimension * dimension);
+        converted.resize(dimension * dimension * dimension);
+    }
+
+    void TearDown(benchmark::State&) override {
+        Engine* e = engine;
+        Engine::destroy(&e);
+        engine = nullptr;
+    }
+};
+
+BENCHMARK_DEFINE_F(FilamentColorGradingFixture, generateLut)(benchmark::State& state) {
+    // every stage is computed
+    ColorGrading::Builder const builder = createBuilder(state, aces, 1.2f);
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            generate(builder, nullptr);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * data.size());
+    }
+}
+
+BENCHMARK_DEFINE_F(FilamentColorGradingFixture, generateLutNoAdjustments)(benchmark::State& state) {
+    // only the LogC decoding and the output stage are computed
+    ColorGrading::Builder builder;
+    builder.dimensions(uint8_t(state.range(0))).toneMapper(&aces);
+    engine->destroy(downcast(builder.build(*engine)));
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            generate(builder, nullptr);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * data.size());
+    }
+}
+
+BENCHMARK_DEFINE_F(FilamentColorGradingFixture, contrastChanges)(benchmark::State& state) {
+    // the input stage is cached
+    ColorGrading::Builder const builders[2] = {
+            createBuilder(state, aces, 1.2f), createBuilder(state, aces, 1.4f) };
+    FColorGrading::StageCache cache;
+    size_t i = 0;
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            generate(builders[i++ & 1u], &cache);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * data.size());
+    }
+}
+
+BENCHMARK_DEFINE_F(FilamentColorGradingFixture, toneMapperChanges)(benchmark::State& state) {
+    // the input and grading stages are cached
+    ColorGrading::Builder const builders[2] = {
+            createBuilder(state, aces, 1.2f), createBuilder(state, filmic, 1.2f) };
+    FColorGrading::StageCache cache;
+    size_t i = 0;
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            generate(builders[i++ & 1u], &cache);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * data.size());
+    }
+}
+
+BENCHMARK_DEFINE_F(FilamentColorGradingFixture, build)(benchmark::State& state) {
+    // creates and destroys a ColorGrading, with the cached LUT if state.range(1) is not 0
+    bool const cached = state.range(1) != 0;
+    ColorGrading::Builder builder = createBuilder(state, aces, 1.2f);
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            if (!cached) {
+                state.PauseTiming();
+                engine->getColorGradingLutCache().entries.clear();
+                engine->getColorGradingStageCache() = {};
+                state.ResumeTiming();
+            }
+            engine->destroy(downcast(builder.build(*engine)));
+            state.PauseTiming();
+            engine->flush();
+            state.ResumeTiming();
+        }
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * data.size());
+    }
+}
+
+BENCHMARK_REGISTER_F(FilamentEngineFixture, scenePrepare)->Arg(1000)->Arg(10000);
+BENCHMARK_REGISTER_F(FilamentEngineFixture, culling)->Arg(1000)->Arg(10000);
+BENCHMARK_REGISTER_F(FilamentEngineFixture, renderPass)->Arg(1000)->Arg(10000);
+BENCHMARK_REGISTER_F(FilamentEngineFixture, froxelization)->Arg(1000);
+BENCHMARK_REGISTER_F(FilamentEngineFixture, transformUpdate)->Arg(1000)->Arg(10000);
+BENCHMARK_REGISTER_F(FilamentMaterialInstanceFixture, prepare)->Arg(1000)->Arg(10000)->Arg(100000);
+BENCHMARK_REGISTER_F(FilamentColorGradingFixture, generateLut)->Arg(32)->Arg(64);
+BENCHMARK_REGISTER_F(FilamentColorGradingFixture, generateLutNoAdjustments)->Arg(32)->Arg(64);
+BENCHMARK_REGISTER_F(FilamentColorGradingFixture, contrastChanges)->Arg(32)->Arg(64);
+BENCHMARK_REGISTER_F(FilamentColorGradingFixture, toneMapperChanges)->Arg(32)->Arg(64);
+BENCHMARK_REGISTER_F(FilamentColorGradingFixture, build)->Args({ 32, 0 })->Args({ 32, 1 });
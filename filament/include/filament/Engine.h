@@ -387,6 +387,58 @@ public:
          *      - PlatformEGLAndroid
          */
         bool assertNativeWindowIsValid = false;
+
+        /**
+         * Maximum size in MiB the low-level command buffer arena is allowed to grow to.
+         *
+         * When the engine has to stall for several consecutive frames, waiting for the backend to
+         * free up space in the command buffer arena, the arena is grown at the end of a frame,
+         * up to this size. Growing requires waiting for the backend to process all pending
+         * commands, which happens at most once per growth step.
+         *
+         * If 0 or smaller than commandBufferSizeMB, the arena never grows.
+         *
+         * This value affects the application's memory usage.
+         */
+        uint32_t maxCommandBufferSizeMB = 0;
+
+        /**
+         * Number of buffers the OpenGL backend keeps around to stage Renderer::readPixels()
+         * readbacks. Applications reading back every frame, e.g. to encode a video, should set
+         * this to the number of readbacks in flight, usually 2 or 3. Larger values use more
+         * GPU memory.
+         *
+         * 0 disables the reuse of these buffers.
+         *
+         * Only respected by the OpenGL backend.
+         */
+        uint32_t readbackBufferCount = 3;
+
+        /**
+         * Keeps a copy of the commands that created the backend resources which are still alive,
+         * along with the last commands that updated their content. Command stream captures,
+         * requested with the debug property "d.renderer.doCommandStreamCapture", then start with
+         * these commands, so they can be replayed on any backend with the cmdreplay tool.
+         *
+         * This uses about as much memory as the content of all the buffers and textures, and
+         * slows down every command. Only meant for debugging.
+         */
+        bool commandStreamCapturePreamble = false;
+    };
+
+    /**
+     * Statistics about the low-level command buffer, accumulated during the last frame.
+     *
+     * @see getCommandBufferStatistics
+     */
+    struct CommandBufferStatistics {
+        using duration_ns = int64_t;
+        size_t bytesRecorded;       //!< size of the commands recorded during the frame [bytes]
+        duration_ns blockedTime;    //!< time spent waiting for space in the command buffer [ns]
+        uint32_t blockedCount;      //!< number of times the engine had to wait for space
+        uint32_t queueDepth;        //!< command buffers not yet processed by the backend
+        size_t highWatermark;       //!< highest command buffer usage since creation [bytes]
+        size_t bufferSize;          //!< current size of the command buffer arena [bytes]
     };
 
 #if UTILS_HAS_THREADING
@@ -673,6 +725,19 @@ public:
      */
     const Config& getConfig() const noexcept;
 
+    /**
+     * Returns statistics about the low-level command buffer for the last frame, that is,
+     * accumulated between the last two calls to Renderer::endFrame().
+     *
+     * A non-zero blockedTime means that the main thread stalled because the backend couldn't
+     * keep up, or because the command buffer is too small. queueDepth is roughly the number of
+     * frames the backend is behind.
+     *
+     * @return a CommandBufferStatistics for the last frame
+     * @see Config::commandBufferSizeMB, Config::maxCommandBufferSizeMB
+     */
+    CommandBufferStatistics getCommandBufferStatistics() const noexcept;
+
     /**
      * Returns the maximum number of stereoscopic eyes supported by Filament. The actual number of
      * eyes rendered is set at Engine creation time with the Engine::Config::stereoscopicEyeCount
@@ -734,6 +799,30 @@ public:
      */
     bool isAutomaticInstancingEnabled() const noexcept;
 
+    /**
+     * Enables or disables the merging of render primitives into indirect multi-draws.
+     * Consecutive render primitives of a renderable that share the same geometry (vertex and
+     * index buffers) and MaterialInstance, but draw different ranges of indices, are then drawn
+     * with a single draw call, which can greatly reduce CPU overhead for renderables made of
+     * many primitives.
+     *
+     * This has no effect if the backend doesn't support indexed multi-draw-indirect, in which
+     * case isMultiDrawIndirectEnabled() keeps returning false.
+     *
+     * Disabled by default.
+     *
+     * @param enable true to enable, false to disable multi-draw-indirect.
+     *
+     * @see RenderableManager::Builder::geometry
+     */
+    void setMultiDrawIndirectEnabled(bool enable) noexcept;
+
+    /**
+     * @return true if multi-draw-indirect is enabled, false otherwise.
+     * @see setMultiDrawIndirectEnabled
+     */
+    bool isMultiDrawIndirectEnabled() const noexcept;
+
     /**
      * Creates a SwapChain from the given Operating System's native window handle.
      *
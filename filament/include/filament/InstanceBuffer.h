@@ -17,6 +17,7 @@
 #ifndef TNT_FILAMENT_INSTANCEBUFFER_H
 #define TNT_FILAMENT_INSTANCEBUFFER_H
 
+#include <filament/Box.h>
 #include <filament/FilamentAPI.h>
 #include <filament/Engine.h>
 
@@ -70,6 +71,24 @@ public:
          */
         Builder& localTransforms(math::mat4f const* UTILS_NULLABLE localTransforms) noexcept;
 
+        /**
+         * Culls each instance individually against the frustum of the View's culling camera.
+         * The camera passes (color, depth prepass, picking, SSR...) then only draw the visible
+         * instances, shadow maps still draw all of them.
+         *
+         * When the backend supports compute and indirect draws (currently OpenGL 4.3 or
+         * OpenGL ES 3.1 with EXT_multi_draw_indirect), the instances are culled and packed by a
+         * compute program, and drawn without a round-trip to the CPU. Otherwise they're culled on
+         * the CPU.
+         *
+         * Instances are not culled when the View has frustum culling disabled, or uses stereo
+         * rendering.
+         *
+         * @param boundingBox the bounding box of the geometry of a single instance, in the
+         *                    instance's local space, i.e. before its local transform is applied.
+         */
+        Builder& culling(Box const& boundingBox) noexcept;
+
         /**
          * Associate an optional name with this InstanceBuffer for debugging purposes.
          *
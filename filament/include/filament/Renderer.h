@@ -97,6 +97,9 @@ public:
         time_point_ns endFrame;             //!< Renderer::endFrame() time since epoch [ns]
         time_point_ns backendBeginFrame;    //!< Backend thread time of frame start since epoch [ns]
         time_point_ns backendEndFrame;      //!< Backend thread time of frame end since epoch [ns]
+        uint32_t stateChanges;              //!< graphics API state changes made by the backend
+        uint32_t redundantStateChanges;     //!< redundant state changes skipped by the backend
+        duration_ns latency;                //!< estimated beginFrame() to GPU end, or 0 [ns]
     };
 
     /**
@@ -114,6 +117,51 @@ public:
      */
     size_t getMaxFrameHistorySize() const noexcept;
 
+    /**
+     * CPU time spent rendering a View, broken down by phase. All durations are measured on the
+     * thread calling render(), except for froxelization which runs concurrently with culling.
+     * @see getCpuFrameInfoHistory()
+     */
+    struct ViewCpuTimings {
+        using duration_ns = int64_t;
+        duration_ns prepare;            //!< scene preparation [ns]
+        duration_ns culling;            //!< renderable culling and partitioning [ns]
+        duration_ns shadows;            //!< shadow maps setup and shadow casters culling [ns]
+        duration_ns froxelization;      //!< lights froxelization [ns]
+        duration_ns commands;           //!< render passes commands generation and sort [ns]
+        duration_ns frameGraphCompile;  //!< frame graph compilation [ns]
+        duration_ns frameGraphExecute;  //!< frame graph execution, overlaps with commands [ns]
+    };
+
+    /**
+     * CPU timing information about a frame
+     * @see getCpuFrameInfoHistory()
+     */
+    struct CpuFrameInfo {
+        static constexpr size_t MAX_VIEW_COUNT = 4;
+        using duration_ns = int64_t;
+        uint32_t frameId;                   //!< monotonically increasing frame identifier
+        duration_ns flush;                  //!< command buffer flush in endFrame() [ns]
+        uint32_t viewCount;                 //!< number of valid entries in views
+        ViewCpuTimings views[MAX_VIEW_COUNT]; //!< one entry per render() call, in order
+        uint32_t materialUniformBufferCount;  //!< buffer objects holding material uniforms
+        uint32_t materialUniformUploadCount;  //!< material uniforms buffer updates this frame
+        uint32_t materialUniformUploadSize;   //!< material uniforms uploaded this frame [bytes]
+        uint32_t renderableUniformUploadCount; //!< renderables uniforms buffer updates this frame
+        uint32_t renderableUniformUploadSize;  //!< renderables uniforms uploaded this frame [bytes]
+    };
+
+    /**
+     * Retrieve an historic of CPU timing information. Unlike getFrameInfoHistory(), a frame's
+     * CPU timings are available as soon as endFrame() returns, and don't depend on GPU timer
+     * queries being supported. Views rendered past CpuFrameInfo::MAX_VIEW_COUNT in a frame are
+     * not recorded. The maximum frame history size is given by getMaxFrameHistorySize().
+     * @param historySize requested history size. The returned vector could be smaller.
+     * @return A vector of CpuFrameInfo, most recent frame first.
+     */
+    utils::FixedCapacityVector<Renderer::CpuFrameInfo> getCpuFrameInfoHistory(
+            size_t historySize = 1) const noexcept;
+
     /**
      * Use FrameRateOptions to set the desired frame rate and control how quickly the system
      * reacts to GPU load changes.
@@ -143,6 +191,32 @@ public:
         uint8_t interval = 1;              //!< desired frame interval in unit of 1.0 / DisplayInfo::refreshRate
     };
 
+    /**
+     * Use LatencyOptions to trade some throughput for a lower latency between the beginning of
+     * a frame and its presentation, e.g. for interactive or streaming applications.
+     *
+     * When enabled:
+     * - at most maxFramesInFlight frames can be queued before beginFrame() asks to skip frames.
+     * - if the vsync time is known (see setVsyncTime() and beginFrame()), beginFrame() sleeps
+     *   so that the frame starts "just in time" to be done by the next vsync, based on the
+     *   latency of the recent frames (see FrameInfo::latency). Applications should update
+     *   their scene (e.g. from user input) after beginFrame() returns to benefit from it.
+     *
+     * Frame timing information requires GPU timer queries, without them only the number of
+     * frames in flight is limited.
+     *
+     * maxFramesInFlight: maximum number of frames queued, 1 or 2.
+     * safetyMargin:      time kept before the vsync, as a ratio of the frame interval.
+     *
+     * @see FrameInfo::latency
+     * @see FrameRateOptions::interval
+     */
+    struct LatencyOptions {
+        bool enabled = false;           //!< enable the low latency mode
+        uint8_t maxFramesInFlight = 1;  //!< maximum number of frames queued
+        float safetyMargin = 0.1f;      //!< time kept before vsync, in unit of the frame interval
+    };
+
     /**
      * ClearOptions are used at the beginning of a frame to clear or retain the SwapChain content.
      */
@@ -197,6 +271,11 @@ public:
      */
     void setFrameRateOptions(FrameRateOptions const& options) noexcept;
 
+    /**
+     * Set options controlling the frame latency.
+     */
+    void setLatencyOptions(LatencyOptions const& options) noexcept;
+
     /**
      * Set ClearOptions which are used at the beginning of a frame to clear or retain the
      * SwapChain content.
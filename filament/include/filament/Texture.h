@@ -106,6 +106,7 @@ public:
     struct PrefilterOptions {
         uint16_t sampleCount = 8;   //!< sample count used for filtering
         bool mirror = true;         //!< whether the environment must be mirrored
+        bool fast = false;          //!< trade some accuracy for speed, e.g. for frequent updates
     private:
         UTILS_UNUSED uintptr_t reserved[3] = {};
     };
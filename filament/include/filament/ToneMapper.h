@@ -68,6 +68,24 @@ struct UTILS_PUBLIC ToneMapper {
      *         function applied ("linear")
      */
     virtual math::float3 operator()(math::float3 c) const noexcept = 0;
+
+    /**
+     * Identifies the curve of a tone mapper. Two tone mappers with the same key, and a type
+     * other than 0, map every color identically.
+     */
+    struct Key {
+        uint32_t type = 0;              //!< 0 if the curve is unknown
+        float parameters[4] = {};       //!< parameters of the curve, depending on its type
+    };
+
+    /**
+     * Returns the key of this tone mapper. Filament uses it to reuse the color grading LUTs
+     * made with an identical tone mapper, even one that was destroyed since.
+     *
+     * The default implementation returns a key of type 0: the LUTs made with this tone mapper
+     * are never reused. Custom tone mappers should not override it.
+     */
+    virtual Key getKey() const noexcept;
 };
 
 /**
@@ -79,6 +97,7 @@ struct UTILS_PUBLIC LinearToneMapper final : public ToneMapper {
     ~LinearToneMapper() noexcept final;
 
     math::float3 operator()(math::float3 c) const noexcept override;
+    Key getKey() const noexcept override;
 };
 
 /**
@@ -91,6 +110,7 @@ struct UTILS_PUBLIC ACESToneMapper final : public ToneMapper {
     ~ACESToneMapper() noexcept final;
 
     math::float3 operator()(math::float3 c) const noexcept override;
+    Key getKey() const noexcept override;
 };
 
 /**
@@ -104,6 +124,7 @@ struct UTILS_PUBLIC ACESLegacyToneMapper final : public ToneMapper {
     ~ACESLegacyToneMapper() noexcept final;
 
     math::float3 operator()(math::float3 c) const noexcept override;
+    Key getKey() const noexcept override;
 };
 
 /**
@@ -117,6 +138,7 @@ struct UTILS_PUBLIC FilmicToneMapper final : public ToneMapper {
     ~FilmicToneMapper() noexcept final;
 
     math::float3 operator()(math::float3 x) const noexcept override;
+    Key getKey() const noexcept override;
 };
 
 /**
@@ -129,6 +151,7 @@ struct UTILS_PUBLIC PBRNeutralToneMapper final : public ToneMapper {
     ~PBRNeutralToneMapper() noexcept final;
 
     math::float3 operator()(math::float3 x) const noexcept override;
+    Key getKey() const noexcept override;
 };
 
 /**
@@ -150,6 +173,7 @@ struct UTILS_PUBLIC AgxToneMapper final : public ToneMapper {
     ~AgxToneMapper() noexcept final;
 
     math::float3 operator()(math::float3 x) const noexcept override;
+    Key getKey() const noexcept override;
 
     AgxLook look;
 };
@@ -194,6 +218,7 @@ struct UTILS_PUBLIC GenericToneMapper final : public ToneMapper {
     GenericToneMapper& operator=(GenericToneMapper&& rhs) noexcept;
 
     math::float3 operator()(math::float3 x) const noexcept override;
+    Key getKey() const noexcept override;
 
     /** Returns the contrast of the curve as a strictly positive value. */
     float getContrast() const noexcept;
@@ -256,6 +281,7 @@ struct UTILS_PUBLIC DisplayRangeToneMapper final : public ToneMapper {
     ~DisplayRangeToneMapper() noexcept override;
 
     math::float3 operator()(math::float3 c) const noexcept override;
+    Key getKey() const noexcept override;
 };
 
 } // namespace filament
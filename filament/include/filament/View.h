@@ -519,6 +519,20 @@ public:
      */
     DynamicResolutionOptions getDynamicResolutionOptions() const noexcept;
 
+    /**
+     * Returns by how much the CPU work of this view should be scaled to fit the frame budget.
+     *
+     * When dynamic resolution is enabled and the frame time is limited by the CPU (the main
+     * thread or the backend thread) rather than by the GPU, lowering the resolution doesn't
+     * help. In that case the resolution is not lowered, and this hint can be used by the
+     * application to reduce the CPU cost of the scene, e.g. by selecting lower levels of detail
+     * or culling small objects more aggressively.
+     *
+     * @return a factor in ]0, 1], 1 meaning that no reduction is needed. This is always 1 when
+     *         dynamic resolution is disabled.
+     */
+    float getLevelOfDetailHint() const noexcept;
+
     /**
      * Sets the rendering quality for this view. Refer to RenderQuality for more
      * information about the different settings available.
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DynamicResolutionController.h"
+
+#include <math/scalar.h>
+
+#include <algorithm>
+
+namespace filament {
+
+// Weight of a new CPU time measurement, CPU times are not denoised like the GPU frame time.
+static constexpr float CPU_TIME_SMOOTHING = 0.2f;
+
+// The GPU is considered the bottleneck as long as its frame time is at least this fraction of
+// the CPU time. The backend thread often blocks on the GPU when it's the bottleneck (e.g. when
+// presenting), so the CPU time is never much lower than the GPU time in that case.
+static constexpr float GPU_BOUND_RATIO = 0.85f;
+
+// ... and stops being the bottleneck below this fraction, the gap avoids flip-flopping.
+static constexpr float CPU_BOUND_RATIO = 0.75f;
+
+DynamicResolutionController::DynamicResolutionController() noexcept {
+    // The integral term is used to fight back the dead-band below, we limit how much it can act.
+    mPidController.setIntegralLimits(-100.0f, 100.0f);
+
+    // Dead-band, 1% for scaling down, 5% for scaling up. This stabilizes all the jitters.
+    mPidController.setOutputDeadBand(-0.01f, 0.05f);
+}
+
+float DynamicResolutionController::update(FrameTimes const& times, float target) noexcept {
+    float const cpu = std::max(times.mainThread, times.backendThread);
+    mCpuTime = mCpuTime == 0.0f ? cpu : math::lerp(mCpuTime, cpu, CPU_TIME_SMOOTHING);
+
+    if (times.gpu <= 0.0f) {
+        mBottleneck = Bottleneck::UNKNOWN;
+    } else {
+        float const ratio = mBottleneck == Bottleneck::GPU ? CPU_BOUND_RATIO : GPU_BOUND_RATIO;
+        mBottleneck = times.gpu >= mCpuTime * ratio ? Bottleneck::GPU : Bottleneck::CPU;
+    }
+
+    // Reducing the CPU work helps unless we know the GPU is the bottleneck
+    mLevelOfDetailHint = 1.0f;
+    if (mBottleneck != Bottleneck::GPU && mCpuTime > target) {
+        mLevelOfDetailHint = target / mCpuTime;
+    }
+
+    if (mBottleneck == Bottleneck::UNKNOWN) {
+        // without the GPU time we can't tell what the resolution does to the frame time
+        return 1.0f;
+    }
+
+    // we don't really need dt here, setting it to 1, means our parameters are in "frames"
+    float const dt = 1.0f;
+    float const out = mPidController.update(times.gpu / target, 1.0f, dt);
+
+    // maps pid command to a relative scale
+    float const command = out < 0.0f ? (1.0f / (1.0f - out)) : (1.0f + out);
+
+    // lowering the resolution doesn't help when the CPU is the bottleneck
+    return mBottleneck == Bottleneck::CPU ? std::max(command, 1.0f) : command;
+}
+
+void DynamicResolutionController::setScaleClamped(bool clamped) noexcept {
+    // When the CPU is the bottleneck the resolution is held, which is also outside the range
+    // the PID controls.
+    mPidController.setIntegralInhibitionEnabled(clamped || mBottleneck == Bottleneck::CPU);
+}
+
+} // namespace filament
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DYNAMICRESOLUTIONCONTROLLER_H
+#define TNT_FILAMENT_DYNAMICRESOLUTIONCONTROLLER_H
+
+#include "PIDController.h"
+
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * Drives dynamic resolution from the GPU frame time, the main thread time and the backend
+ * thread time of recent frames.
+ *
+ * Lowering the resolution only reduces the GPU work, so the resolution is only lowered when the
+ * GPU is the bottleneck. When the CPU is the bottleneck, the resolution is allowed to go up if
+ * the GPU has some headroom, but never down; instead, a level of detail hint tells by how much
+ * the CPU work should be reduced to fit the frame budget.
+ *
+ * This class doesn't know about viewports or scale limits, it only computes by how much the
+ * number of pixels should change; it's completely deterministic, which allows to test it with
+ * a simulated frame time model.
+ */
+class DynamicResolutionController {
+public:
+    // All times are in milliseconds
+    struct FrameTimes {
+        float gpu = 0.0f;               // denoised GPU frame time, 0 if unknown
+        float mainThread = 0.0f;        // main thread time between beginFrame and endFrame
+        float backendThread = 0.0f;     // backend thread time between beginFrame and endFrame
+    };
+
+    enum class Bottleneck : uint8_t {
+        UNKNOWN,    // not enough information (e.g. no GPU timer)
+        GPU,
+        CPU
+    };
+
+    DynamicResolutionController() noexcept;
+
+    void setGains(float Kp, float Ki, float Kd) noexcept {
+        mPidController.setParallelGains(Kp, Ki, Kd);
+    }
+
+    // Returns the factor by which the number of pixels should be scaled to fit `target`, the
+    // frame time budget. 1 means no change.
+    float update(FrameTimes const& times, float target) noexcept;
+
+    // Must be called after update() to tell whether the scale had to be clamped, in which case
+    // the integral term is paused, so it doesn't wind-up while we're outside the controllable
+    // range.
+    void setScaleClamped(bool clamped) noexcept;
+
+    Bottleneck getBottleneck() const noexcept { return mBottleneck; }
+
+    // Factor by which the CPU work should be scaled to fit the frame budget, in ]0, 1].
+    // This is always 1 when the GPU is the bottleneck.
+    float getLevelOfDetailHint() const noexcept { return mLevelOfDetailHint; }
+
+    PIDController const& getPidController() const noexcept { return mPidController; }
+
+private:
+    PIDController mPidController;
+    float mCpuTime = 0.0f;              // smoothed CPU time, slowest of the two threads
+    float mLevelOfDetailHint = 1.0f;
+    Bottleneck mBottleneck = Bottleneck::UNKNOWN;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_DYNAMICRESOLUTIONCONTROLLER_H
@@ -410,6 +410,14 @@ bool Engine::isAutomaticInstancingEnabled() const noexcept {
     return downcast(this)->isAutomaticInstancingEnabled();
 }
 
+void Engine::setMultiDrawIndirectEnabled(bool enable) noexcept {
+    downcast(this)->setMultiDrawIndirectEnabled(enable);
+}
+
+bool Engine::isMultiDrawIndirectEnabled() const noexcept {
+    return downcast(this)->isMultiDrawIndirectEnabled();
+}
+
 FeatureLevel Engine::getSupportedFeatureLevel() const noexcept {
     return downcast(this)->getSupportedFeatureLevel();
 }
@@ -430,6 +438,10 @@ const Engine::Config& Engine::getConfig() const noexcept {
     return downcast(this)->getConfig();
 }
 
+Engine::CommandBufferStatistics Engine::getCommandBufferStatistics() const noexcept {
+    return downcast(this)->getCommandBufferStatistics();
+}
+
 bool Engine::isStereoSupported(StereoscopicType) const noexcept {
     return downcast(this)->isStereoSupported();
 }
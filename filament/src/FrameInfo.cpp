@@ -16,6 +16,8 @@
 
 #include "FrameInfo.h"
 
+#include "details/Engine.h"
+
 #include <filament/Renderer.h>
 
 #include <backend/DriverEnums.h>
@@ -95,6 +97,7 @@ void FrameInfoManager::beginFrame(DriverApi& driver, Config const& config, uint3
                 // conversion to our duration happens here
                 pFront = mQueries[mLast].pInfo;
                 pFront->frameTime = std::chrono::duration<uint64_t, std::nano>(elapsed);
+                estimateGpuEndFrame(*pFront, std::chrono::nanoseconds(elapsed));
                 mLast = (mLast + 1) % POOL_COUNT;
                 denoiseFrameTime(history, config);
                 break;
@@ -122,14 +125,17 @@ void FrameInfoManager::beginFrame(DriverApi& driver, Config const& config, uint3
     }
 }
 
-void FrameInfoManager::endFrame(DriverApi& driver) noexcept {
+void FrameInfoManager::endFrame(FEngine& engine) noexcept {
+    DriverApi& driver = engine.getDriverApi();
     auto& front = mFrameTimeHistory.front();
     // close the timer query
     driver.endTimerQuery(mQueries[mIndex].handle);
     // queue custom backend command to query the current time
-    driver.queueCommand([&front](){
+    driver.queueCommand([&front, &engine](){
         // backend frame end-time
         front.backendEndFrame = std::chrono::steady_clock::now();
+        // the state changes since the backend's beginFrame()
+        front.stateChanges = engine.getStateChangeStatistics();
         // signal that the data is available
         front.ready.store(true, std::memory_order_release);
     });
@@ -138,6 +144,82 @@ void FrameInfoManager::endFrame(DriverApi& driver) noexcept {
     mIndex = (mIndex + 1) % POOL_COUNT;
 }
 
+details::FrameInfo FrameInfoManager::getLastFrameInfo() const noexcept {
+    // if pFront is not set yet, return FrameInfo(). But the `valid` field will be false in this case.
+    details::FrameInfo info = pFront ? *pFront : details::FrameInfo{};
+
+    // The thread times don't depend on the timer queries, we take them from the latest frame
+    // the backend is done with. This is usually more recent than pFront.
+    auto const& history = mFrameTimeHistory;
+    for (size_t i = 0, c = history.size(); i < c; ++i) {
+        auto const& entry = history[i];
+        if (entry.ready.load(std::memory_order_acquire)) {
+            info.mainThreadTime = entry.endFrame - entry.beginFrame;
+            info.backendThreadTime = entry.backendEndFrame - entry.backendBeginFrame;
+            info.threadTimesValid = true;
+            break;
+        }
+    }
+    return info;
+}
+
+void FrameInfoManager::estimateGpuEndFrame(FrameInfoImpl& info,
+        clock::duration elapsed) noexcept {
+    // We don't have GPU timestamps, only the GPU duration of the frame. The GPU can't start a
+    // frame before the backend is done submitting it, nor before it's done with the previous
+    // frame. This ignores the time the GPU takes to pick up the work, which is small compared
+    // to the queueing we want to account for.
+    if (!info.ready.load(std::memory_order_acquire)) {
+        return;
+    }
+    clock::time_point const start = std::max(info.backendEndFrame, mLastGpuEndFrame);
+    info.gpuEndFrame = start + elapsed;
+    mLastGpuEndFrame = info.gpuEndFrame;
+}
+
+FrameInfoManager::clock::duration FrameInfoManager::getLatencyEstimate(
+        size_t historySize) const noexcept {
+    clock::duration latency{};
+    auto const& history = mFrameTimeHistory;
+    for (size_t i = 0, c = history.size(); i < c && historySize; ++i) {
+        auto const& entry = history[i];
+        if (entry.gpuEndFrame != clock::time_point{}) {
+            latency = std::max(latency, entry.gpuEndFrame - entry.beginFrame);
+            --historySize;
+        }
+    }
+    return latency;
+}
+
+void FrameInfoManager::addViewCpuTimings(ViewCpuTimingsImpl const& timings) noexcept {
+    auto& front = mFrameTimeHistory.front();
+    // views past MAX_VIEW_COUNT are not recorded
+    if (front.viewCount < front.views.size()) {
+        front.views[front.viewCount++] = timings;
+    }
+}
+
+void FrameInfoManager::setFlushTime(clock::duration flush) noexcept {
+    auto& front = mFrameTimeHistory.front();
+    front.flush = flush;
+    front.cpuReady = true;
+}
+
+void FrameInfoManager::addRenderableUniformStats(
+        uint32_t uploadCount, uint32_t uploadSize) noexcept {
+    auto& front = mFrameTimeHistory.front();
+    front.renderableUniformUploadCount += uploadCount;
+    front.renderableUniformUploadSize += uploadSize;
+}
+
+void FrameInfoManager::setMaterialUniformStats(uint32_t bufferCount,
+        uint32_t uploadCount, uint32_t uploadSize) noexcept {
+    auto& front = mFrameTimeHistory.front();
+    front.materialUniformBufferCount = bufferCount;
+    front.materialUniformUploadCount = uploadCount;
+    front.materialUniformUploadSize = uploadSize;
+}
+
 void FrameInfoManager::denoiseFrameTime(FrameHistoryQueue& history, Config const& config) noexcept {
     assert_invariant(!history.empty());
 
@@ -196,10 +278,55 @@ utils::FixedCapacityVector<Renderer::FrameInfo> FrameInfoManager::getFrameInfoHi
                 duration_cast<nanoseconds>(entry.beginFrame.time_since_epoch()).count(),
                 duration_cast<nanoseconds>(entry.endFrame.time_since_epoch()).count(),
                 duration_cast<nanoseconds>(entry.backendBeginFrame.time_since_epoch()).count(),
-                duration_cast<nanoseconds>(entry.backendEndFrame.time_since_epoch()).count()
+                duration_cast<nanoseconds>(entry.backendEndFrame.time_since_epoch()).count(),
+                entry.stateChanges.issued,
+                entry.stateChanges.elided,
+                entry.gpuEndFrame == clock::time_point{} ? 0 :
+                        duration_cast<nanoseconds>(entry.gpuEndFrame - entry.beginFrame).count()
         });
     }
     return result;
 }
 
+utils::FixedCapacityVector<Renderer::CpuFrameInfo> FrameInfoManager::getCpuFrameInfoHistory(
+        size_t historySize) const noexcept {
+    auto result = utils::FixedCapacityVector<Renderer::CpuFrameInfo>::with_capacity(MAX_FRAMETIME_HISTORY);
+    auto const& history = mFrameTimeHistory;
+    using namespace std::chrono;
+    auto toNanoseconds = [](ViewCpuTimingsImpl::duration d) -> Renderer::FrameInfo::duration_ns {
+        return duration_cast<nanoseconds>(d).count();
+    };
+    for (size_t i = 0, c = history.size(); i < c && historySize; ++i) {
+        auto const& entry = history[i];
+        if (!entry.cpuReady) {
+            // the frame is still in progress
+            continue;
+        }
+        Renderer::CpuFrameInfo info{};
+        info.frameId = entry.frameId;
+        info.flush = toNanoseconds(entry.flush);
+        info.viewCount = entry.viewCount;
+        info.materialUniformBufferCount = entry.materialUniformBufferCount;
+        info.materialUniformUploadCount = entry.materialUniformUploadCount;
+        info.materialUniformUploadSize = entry.materialUniformUploadSize;
+        info.renderableUniformUploadCount = entry.renderableUniformUploadCount;
+        info.renderableUniformUploadSize = entry.renderableUniformUploadSize;
+        for (size_t j = 0; j < entry.viewCount; j++) {
+            ViewCpuTimingsImpl const& view = entry.views[j];
+            info.views[j] = {
+                    toNanoseconds(view.prepare),
+                    toNanoseconds(view.culling),
+                    toNanoseconds(view.shadows),
+                    toNanoseconds(view.froxelization),
+                    toNanoseconds(view.commands),
+                    toNanoseconds(view.frameGraphCompile),
+                    toNanoseconds(view.frameGraphExecute)
+            };
+        }
+        result.push_back(info);
+        --historySize;
+    }
+    return result;
+}
+
 } // namespace filament
@@ -19,6 +19,7 @@
 
 #include <filament/Renderer.h>
 
+#include <backend/DriverEnums.h>
 #include <backend/Handle.h>
 
 #include <private/backend/DriverApi.h>
@@ -45,10 +46,26 @@ struct FrameInfo {
     duration frameTime{};            // frame period
     duration denoisedFrameTime{};    // frame period (median filter)
     bool valid = false;              // true if the data of the structure is valid
+    duration mainThreadTime{};       // main thread beginFrame to endFrame
+    duration backendThreadTime{};    // backend thread beginFrame to endFrame
+    bool threadTimesValid = false;   // true if the thread times are valid, independent of `valid`
 };
 } // namespace details
 
+// CPU time spent rendering a View, measured on the thread calling Renderer::render()
+struct ViewCpuTimingsImpl {
+    using duration = std::chrono::steady_clock::duration;
+    duration prepare{};              // FScene::prepare()
+    duration culling{};              // renderable culling and partitioning
+    duration shadows{};              // shadow maps setup and shadow casters culling
+    duration froxelization{};        // lights froxelization, runs concurrently with culling
+    duration commands{};             // render passes commands generation and sort
+    duration frameGraphCompile{};    // FrameGraph::compile()
+    duration frameGraphExecute{};    // FrameGraph::execute(), includes some of `commands`
+};
+
 struct FrameInfoImpl : public details::FrameInfo {
+    static constexpr size_t MAX_VIEW_COUNT = 4;
     using clock = std::chrono::steady_clock;
     using time_point = clock::time_point;
     uint32_t const frameId;
@@ -56,7 +73,18 @@ struct FrameInfoImpl : public details::FrameInfo {
     time_point endFrame;             // main thread endFrame time
     time_point backendBeginFrame;    // backend thread beginFrame time (makeCurrent time)
     time_point backendEndFrame;      // backend thread endFrame time (present time)
+    time_point gpuEndFrame{};        // estimated GPU end time, unset if unknown
+    backend::StateChangeStatistics stateChanges{}; // backend thread state changes of the frame
     std::atomic_bool ready{};        // true once backend thread has populated its data
+    clock::duration flush{};         // main thread endFrame command buffer flush
+    bool cpuReady = false;           // true once the main thread has populated its data
+    uint32_t viewCount = 0;          // number of valid entries in views
+    uint32_t materialUniformBufferCount = 0;
+    uint32_t materialUniformUploadCount = 0;
+    uint32_t materialUniformUploadSize = 0;
+    uint32_t renderableUniformUploadCount = 0;
+    uint32_t renderableUniformUploadSize = 0;
+    std::array<ViewCpuTimingsImpl, MAX_VIEW_COUNT> views;
     explicit FrameInfoImpl(uint32_t frameId) noexcept
         : frameId(frameId) {
     }
@@ -161,18 +189,36 @@ public:
     void beginFrame(backend::DriverApi& driver, Config const& config, uint32_t frameId) noexcept;
 
     // call this immediately before "swap buffers"
-    void endFrame(backend::DriverApi& driver) noexcept;
+    void endFrame(FEngine& engine) noexcept;
 
-    details::FrameInfo getLastFrameInfo() const noexcept {
-        // if pFront is not set yet, return FrameInfo(). But the `valid` field will be false in this case.
-        return pFront ? *pFront : details::FrameInfo{};
-    }
+    // records the CPU timings of a View rendered during the current frame
+    void addViewCpuTimings(ViewCpuTimingsImpl const& timings) noexcept;
+
+    // records the time spent flushing the command buffer at the end of the current frame,
+    // this completes the CPU timings of the frame.
+    void setFlushTime(clock::duration flush) noexcept;
+
+    // records the renderables uniform buffer updates of a View rendered during the current frame
+    void addRenderableUniformStats(uint32_t uploadCount, uint32_t uploadSize) noexcept;
+
+    // records the material uniform buffers statistics of the current frame
+    void setMaterialUniformStats(uint32_t bufferCount,
+            uint32_t uploadCount, uint32_t uploadSize) noexcept;
+
+    details::FrameInfo getLastFrameInfo() const noexcept;
+
+    // Returns the longest latency (beginFrame to the end of the GPU work) of the last
+    // `historySize` frames for which it is known, or 0 if none is.
+    clock::duration getLatencyEstimate(size_t historySize) const noexcept;
 
     utils::FixedCapacityVector<Renderer::FrameInfo> getFrameInfoHistory(size_t historySize) const noexcept;
 
+    utils::FixedCapacityVector<Renderer::CpuFrameInfo> getCpuFrameInfoHistory(size_t historySize) const noexcept;
+
 private:
     using FrameHistoryQueue = CircularQueue<FrameInfoImpl, MAX_FRAMETIME_HISTORY>;
     static void denoiseFrameTime(FrameHistoryQueue& history, Config const& config) noexcept;
+    void estimateGpuEndFrame(FrameInfoImpl& info, clock::duration elapsed) noexcept;
     struct Query {
         backend::Handle<backend::HwTimerQuery> handle{};
         FrameInfoImpl* pInfo = nullptr;
@@ -182,6 +228,7 @@ private:
     uint32_t mLast = 0;                 // index of oldest query still active
     FrameInfoImpl* pFront = nullptr;    // the most recent slot with a valid frame time
     FrameHistoryQueue mFrameTimeHistory;
+    clock::time_point mLastGpuEndFrame{}; // estimated GPU end time of the last timed frame
 };
 
 
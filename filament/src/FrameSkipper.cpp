@@ -36,6 +36,10 @@ FrameSkipper::FrameSkipper(size_t latency) noexcept
 
 FrameSkipper::~FrameSkipper() noexcept = default;
 
+void FrameSkipper::setFrameLatency(size_t latency) noexcept {
+    mLast = std::clamp(latency, size_t(1), MAX_FRAME_LATENCY) - 1;
+}
+
 void FrameSkipper::terminate(DriverApi& driver) noexcept {
     for (auto fence : mDelayedFences) {
         if (fence) {
@@ -62,11 +66,14 @@ void FrameSkipper::endFrame(DriverApi& driver) noexcept {
     auto& fences = mDelayedFences;
     size_t const last = mLast;
 
-    // pop the oldest fence and advance the other ones
-    if (fences.front()) {
-        driver.destroyFence(fences.front());
-    }
-    std::move(fences.begin() + 1, fences.end(), fences.begin());
+    // pop the oldest fence and advance the other ones, if the latency was lowered we need to
+    // pop more than one fence.
+    do {
+        if (fences.front()) {
+            driver.destroyFence(fences.front());
+        }
+        std::move(fences.begin() + 1, fences.end(), fences.begin());
+    } while (fences[last]);
 
     // add a new fence to the end
     assert_invariant(!fences[last]);
@@ -74,4 +81,9 @@ void FrameSkipper::endFrame(DriverApi& driver) noexcept {
     fences[last] = driver.createFence();
 }
 
+size_t FrameSkipper::getFramesInFlight() const noexcept {
+    return std::count_if(mDelayedFences.begin(), mDelayedFences.end(),
+            [](auto const& fence) { return bool(fence); });
+}
+
 } // namespace filament
@@ -45,6 +45,8 @@ class FrameSkipper {
      */
     static constexpr size_t MAX_FRAME_LATENCY = 2;
 public:
+    static constexpr size_t DEFAULT_FRAME_LATENCY = 2;
+
     /*
      * The latency parameter defines how many unfinished frames we want to accept before we start
      * dropping frames. This affects frame latency.
@@ -59,9 +61,13 @@ public:
      * A latency 3 allows the main thread, driver thread and GPU to overlap, each being able to
      * use up to 16ms (or whatever the refresh rate is).
      */
-    explicit FrameSkipper(size_t latency = 2) noexcept;
+    explicit FrameSkipper(size_t latency = DEFAULT_FRAME_LATENCY) noexcept;
     ~FrameSkipper() noexcept;
 
+    // Changes the latency, the fences of frames past the new latency are dropped at the next
+    // endFrame().
+    void setFrameLatency(size_t latency) noexcept;
+
     void terminate(backend::DriverApi& driver) noexcept;
 
     // Returns false if we need to skip this frame, because the GPU is running behind the CPU;
@@ -71,10 +77,13 @@ public:
 
     void endFrame(backend::DriverApi& driver) noexcept;
 
+    // Number of frames whose fence is still held, i.e. that can still make beginFrame() skip.
+    size_t getFramesInFlight() const noexcept;
+
 private:
     using Container = std::array<backend::Handle<backend::HwFence>, MAX_FRAME_LATENCY>;
     mutable Container mDelayedFences{};
-    uint8_t const mLast;
+    uint8_t mLast;
 };
 
 } // namespace filament
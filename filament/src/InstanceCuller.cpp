@@ -0,0 +1,370 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "InstanceCuller.h"
+
+#include "Culler.h"
+#include "RenderPrimitive.h"
+
+#include "components/RenderableManager.h"
+
+#include "details/Engine.h"
+#include "details/InstanceBuffer.h"
+#include "details/Scene.h"
+
+#include <private/filament/EngineEnums.h>
+#include <private/filament/UibStructs.h>
+
+#include <backend/DriverEnums.h>
+#include <backend/Program.h>
+
+#include <utils/compiler.h>
+#include <utils/debug.h>
+#include <utils/Slice.h>
+
+#include <math/vec3.h>
+#include <math/vec4.h>
+
+#include <algorithm>
+#include <string>
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace filament::math;
+using namespace utils;
+
+namespace filament {
+
+using namespace backend;
+
+namespace {
+
+// Parameters of the culling of one renderable, see Params in the compute shader
+struct CullingParams {
+    float4 planes[6];           // frustum planes, pointing outward
+    float4 center;              // xyz: center of the bounding box of an instance, in local space
+    float4 halfExtent;          // xyz: half extent of the bounding box of an instance
+    uint32_t instanceCount;
+    uint32_t firstDrawArgs;     // index of the draw arguments of the first primitive
+    uint32_t drawArgsCount;     // number of primitives
+    uint32_t firstVisible;      // index of the first visible instance in the instance buffer
+    uint8_t padding[112];       // the parameters of each renderable are bound separately
+};
+static_assert(sizeof(CullingParams) == 256);
+
+// Culls one instance per invocation. The data of the visible instances is copied after the data
+// of all the instances, and their count is accumulated in the instanceCount of the draw arguments
+// of each primitive of the renderable.
+constexpr char const* const cullingCs = R"(
+layout(local_size_x = 64) in;
+
+struct DrawIndexedIndirectArgs {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Params {
+    vec4 planes[6];
+    vec4 center;
+    vec4 halfExtent;
+    uint instanceCount;
+    uint firstDrawArgs;
+    uint drawArgsCount;
+    uint firstVisible;
+} params;
+
+layout(std430, binding = 1) buffer DrawArgs {
+    DrawIndexedIndirectArgs args[];
+} drawArgs;
+
+// the PerRenderableData of each instance, 16 uvec4 each
+layout(std430, binding = 2) buffer Instances {
+    uvec4 data[];
+} instances;
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= params.instanceCount) {
+        return;
+    }
+
+    // the world space bounding box of the instance, from its worldFromModelMatrix
+    uint first = i * 16u;
+    mat4 m = mat4(
+            uintBitsToFloat(instances.data[first + 0u]),
+            uintBitsToFloat(instances.data[first + 1u]),
+            uintBitsToFloat(instances.data[first + 2u]),
+            uintBitsToFloat(instances.data[first + 3u]));
+    vec3 c = (m * vec4(params.center.xyz, 1.0)).xyz;
+    vec3 e = abs(m[0].xyz) * params.halfExtent.x +
+             abs(m[1].xyz) * params.halfExtent.y +
+             abs(m[2].xyz) * params.halfExtent.z;
+
+    // same test as Culler::intersects()
+    bool visible = true;
+    for (int p = 0; p < 6; p++) {
+        vec4 plane = params.planes[p];
+        visible = visible && (dot(plane.xyz, c) - dot(abs(plane.xyz), e) + plane.w < 0.0);
+    }
+
+    if (visible) {
+        uint slot = atomicAdd(drawArgs.args[params.firstDrawArgs].instanceCount, 1u);
+        for (uint p = 1u; p < params.drawArgsCount; p++) {
+            atomicAdd(drawArgs.args[params.firstDrawArgs + p].instanceCount, 1u);
+        }
+        uint dst = (params.firstVisible + slot) * 16u;
+        for (uint k = 0u; k < 16u; k++) {
+            instances.data[dst + k] = instances.data[first + k];
+        }
+    }
+})";
+
+} // anonymous namespace
+
+size_t InstanceCuller::cull(Frustum const& frustum, Box const& box, mat4f const& rootTransform,
+        mat4f const* localTransforms, size_t count, uint32_t* visible) noexcept {
+    assert_invariant(count <= CONFIG_MAX_INSTANCES);
+    static_assert(CONFIG_MAX_INSTANCES % Culler::MODULO == 0);
+
+    // Culler::intersects() processes a multiple of Culler::MODULO boxes
+    float3 centers[CONFIG_MAX_INSTANCES];
+    float3 extents[CONFIG_MAX_INSTANCES];
+    Culler::result_type results[CONFIG_MAX_INSTANCES] = {};
+    for (size_t i = 0; i < count; i++) {
+        Box const b = rigidTransform(box, rootTransform * localTransforms[i]);
+        centers[i] = b.center;
+        extents[i] = b.halfExtent;
+    }
+    for (size_t i = count, c = Culler::round(count); i < c; i++) {
+        centers[i] = 0;
+        extents[i] = 0;
+    }
+    Culler::intersects(results, frustum, centers, extents, count, 0);
+
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        visible[visibleCount] = uint32_t(i);
+        visibleCount += results[i] & 1u;
+    }
+    return visibleCount;
+}
+
+bool InstanceCuller::isGpuCullingSupported(FEngine& engine) noexcept {
+    // compute is only wired through descriptor-sets in the OpenGL backend for now
+    DriverApi& driver = engine.getDriverApi();
+    return engine.getBackend() == Backend::OPENGL &&
+           driver.getFeatureLevel() >= FeatureLevel::FEATURE_LEVEL_2 &&
+           driver.isMultiDrawIndirectSupported() &&
+           !engine.debug.renderer.disable_gpu_instance_culling;
+}
+
+ProgramHandle InstanceCuller::createProgram(FEngine& engine) noexcept {
+    std::string const shader = std::string(engine.getShaderModel() == ShaderModel::DESKTOP ?
+            "#version 430 core\n" : "#version 310 es\nprecision highp float;\n") + cullingCs;
+
+    Program program;
+    program.shaderLanguage(ShaderLanguage::ESSL3);
+    program.shader(ShaderStage::COMPUTE, shader.data(), shader.size() + 1);
+    program.descriptorBindings(0, {
+            { "Params", DescriptorType::SHADER_STORAGE_BUFFER, 0 },
+            { "DrawArgs", DescriptorType::SHADER_STORAGE_BUFFER, 1 },
+            { "Instances", DescriptorType::SHADER_STORAGE_BUFFER, 2 }});
+    return engine.getDriverApi().createProgram(std::move(program));
+}
+
+backend::DescriptorSetLayout InstanceCuller::getDescriptorSetLayout() noexcept {
+    return {{
+            { DescriptorType::SHADER_STORAGE_BUFFER, ShaderStageFlags::COMPUTE, 0 },
+            { DescriptorType::SHADER_STORAGE_BUFFER, ShaderStageFlags::COMPUTE, 1 },
+            { DescriptorType::SHADER_STORAGE_BUFFER, ShaderStageFlags::COMPUTE, 2 }}};
+}
+
+InstanceCuller::InstanceCuller() noexcept = default;
+
+InstanceCuller::~InstanceCuller() noexcept {
+    assert_invariant(!mParams);
+    assert_invariant(!mDrawArgs);
+}
+
+void InstanceCuller::terminate(DriverApi& driver) noexcept {
+    if (mParams) {
+        driver.destroyBufferObject(mParams);
+        mParams.clear();
+    }
+    if (mDrawArgs) {
+        driver.destroyBufferObject(mDrawArgs);
+        mDrawArgs.clear();
+    }
+}
+
+void InstanceCuller::cull(FEngine& engine, FScene::RenderableSoa& renderableData,
+        Range<uint32_t> visibleRenderables, Frustum const& frustum) {
+    FRenderableManager::InstancesInfo const* const instancesData =
+            renderableData.data<FScene::INSTANCES>();
+    Slice<FRenderPrimitive> const* const primitivesData =
+            renderableData.data<FScene::PRIMITIVES>();
+
+    uint32_t renderableCount = 0;
+    uint32_t drawArgsCount = 0;
+    for (uint32_t const i : visibleRenderables) {
+        FInstanceBuffer const* const buffer = instancesData[i].buffer;
+        if (UTILS_UNLIKELY(buffer && buffer->isCullingEnabled())) {
+            renderableCount++;
+            drawArgsCount += primitivesData[i].size();
+        }
+    }
+
+    if (UTILS_LIKELY(!renderableCount)) {
+        return;
+    }
+
+    if (isGpuCullingSupported(engine)) {
+        cullOnGpu(engine, renderableData, visibleRenderables, frustum,
+                renderableCount, drawArgsCount);
+        return;
+    }
+
+    mat4f const* const worldTransformData = renderableData.data<FScene::WORLD_TRANSFORM>();
+    PerRenderableData const* const uboData = renderableData.data<FScene::UBO>();
+    FScene::InstanceCullingInfo* const cullingData =
+            renderableData.data<FScene::INSTANCE_CULLING>();
+
+    uint32_t visible[CONFIG_MAX_INSTANCES];
+    for (uint32_t const i : visibleRenderables) {
+        FInstanceBuffer* const buffer = instancesData[i].buffer;
+        if (UTILS_UNLIKELY(buffer && buffer->isCullingEnabled())) {
+            size_t const visibleCount = cull(frustum, buffer->getCullingBox(),
+                    worldTransformData[i], buffer->getLocalTransforms(),
+                    buffer->getInstanceCount(), visible);
+            buffer->prepareVisible(engine, worldTransformData[i], uboData[i],
+                    instancesData[i].handle, visible, visibleCount);
+            cullingData[i] = {
+                    .visibleCount = uint16_t(visibleCount),
+                    .culled = true };
+        }
+    }
+}
+
+void InstanceCuller::cullOnGpu(FEngine& engine, FScene::RenderableSoa& renderableData,
+        Range<uint32_t> visibleRenderables, Frustum const& frustum,
+        uint32_t renderableCount, uint32_t drawArgsCount) {
+    DriverApi& driver = engine.getDriverApi();
+
+    // allocate 1/3 extra, with a minimum of 16 objects
+    auto const grow = [](uint32_t count) { return std::max(16u, (4u * count + 2u) / 3u); };
+
+    if (mParamsCount < renderableCount) {
+        if (mParams) {
+            driver.destroyBufferObject(mParams);
+        }
+        mParamsCount = grow(renderableCount);
+        mParams = driver.createBufferObject(mParamsCount * sizeof(CullingParams),
+                BufferObjectBinding::SHADER_STORAGE, BufferUsage::DYNAMIC);
+    }
+
+    if (mDrawArgsCount < drawArgsCount) {
+        if (mDrawArgs) {
+            driver.destroyBufferObject(mDrawArgs);
+        }
+        mDrawArgsCount = grow(drawArgsCount);
+        mDrawArgs = driver.createBufferObject(mDrawArgsCount * sizeof(DrawIndexedIndirectArgs),
+                BufferObjectBinding::DRAW_INDIRECT, BufferUsage::DYNAMIC);
+    }
+
+    FRenderableManager::InstancesInfo const* const instancesData =
+            renderableData.data<FScene::INSTANCES>();
+    Slice<FRenderPrimitive> const* const primitivesData =
+            renderableData.data<FScene::PRIMITIVES>();
+    FScene::InstanceCullingInfo* const cullingData =
+            renderableData.data<FScene::INSTANCE_CULLING>();
+
+    // The instance counts are reset, the culling accumulates the visible instances in them.
+    uint32_t const paramsSize = renderableCount * sizeof(CullingParams);
+    uint32_t const drawArgsSize = drawArgsCount * sizeof(DrawIndexedIndirectArgs);
+    auto* const params = (CullingParams*)::malloc(paramsSize);
+    auto* const drawArgs = (DrawIndexedIndirectArgs*)::malloc(drawArgsSize);
+
+    float4 planes[6];
+    frustum.getNormalizedPlanes(planes);
+
+    uint32_t paramsIndex = 0;
+    uint32_t drawArgsIndex = 0;
+    for (uint32_t const i : visibleRenderables) {
+        FInstanceBuffer const* const buffer = instancesData[i].buffer;
+        if (UTILS_UNLIKELY(buffer && buffer->isCullingEnabled())) {
+            Box const& box = buffer->getCullingBox();
+            Slice<FRenderPrimitive> const& primitives = primitivesData[i];
+            CullingParams& p = params[paramsIndex++];
+            memcpy(p.planes, planes, sizeof(planes));
+            p.center = float4{ box.center, 0.0f };
+            p.halfExtent = float4{ box.halfExtent, 0.0f };
+            p.instanceCount = uint32_t(buffer->getInstanceCount());
+            p.firstDrawArgs = drawArgsIndex;
+            p.drawArgsCount = uint32_t(primitives.size());
+            p.firstVisible = CONFIG_MAX_INSTANCES;
+            cullingData[i] = {
+                    .drawArgs = mDrawArgs,
+                    .firstDrawArgs = drawArgsIndex,
+                    .culled = true };
+            for (auto const& primitive : primitives) {
+                drawArgs[drawArgsIndex++] = {
+                        .indexCount = primitive.getIndexCount(),
+                        .instanceCount = 0,
+                        .firstIndex = primitive.getIndexOffset(),
+                        .baseVertex = 0,
+                        .baseInstance = 0 };
+            }
+        }
+    }
+    assert_invariant(paramsIndex == renderableCount);
+    assert_invariant(drawArgsIndex == drawArgsCount);
+
+    driver.updateBufferObject(mParams, { params, paramsSize,
+            +[](void* buffer, size_t, void*) { ::free(buffer); } }, 0);
+    driver.updateBufferObject(mDrawArgs, { drawArgs, drawArgsSize,
+            +[](void* buffer, size_t, void*) { ::free(buffer); } }, 0);
+
+    // One dispatch per renderable, because each has its own instance buffer object. The data of
+    // all the instances was uploaded by FScene::updateUBOs().
+    ProgramHandle const program = engine.getInstanceCullingProgram();
+    DescriptorSetLayoutHandle const layout =
+            engine.getInstanceCullingDescriptorSetLayout().getHandle();
+    paramsIndex = 0;
+    for (uint32_t const i : visibleRenderables) {
+        FInstanceBuffer const* const buffer = instancesData[i].buffer;
+        if (UTILS_UNLIKELY(buffer && buffer->isCullingEnabled())) {
+            DescriptorSetHandle const descriptorSet = driver.createDescriptorSet(layout);
+            driver.updateDescriptorSetBuffer(descriptorSet, 0,
+                    mParams, paramsIndex * sizeof(CullingParams), sizeof(CullingParams));
+            driver.updateDescriptorSetBuffer(descriptorSet, 1,
+                    mDrawArgs, 0, drawArgsSize);
+            driver.updateDescriptorSetBuffer(descriptorSet, 2,
+                    instancesData[i].handle, 0, 2 * sizeof(PerRenderableUib));
+            driver.bindDescriptorSet(descriptorSet, 0, {});
+            uint32_t const groupCount =
+                    (uint32_t(buffer->getInstanceCount()) + GROUP_SIZE - 1) / GROUP_SIZE;
+            driver.dispatchCompute(program, { groupCount, 1, 1 });
+            driver.destroyDescriptorSet(descriptorSet);
+            paramsIndex++;
+        }
+    }
+}
+
+} // namespace filament
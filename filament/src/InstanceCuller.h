@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_INSTANCECULLER_H
+#define TNT_FILAMENT_INSTANCECULLER_H
+
+#include "details/Scene.h"
+
+#include <filament/Box.h>
+#include <filament/Frustum.h>
+
+#include <private/backend/DriverApi.h>
+
+#include <backend/DriverEnums.h>
+#include <backend/Handle.h>
+
+#include <utils/Range.h>
+
+#include <math/mat4.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+class FEngine;
+
+/*
+ * Culls the instances of the InstanceBuffers that have a culling box, against the frustum of
+ * the camera. The passes that render the camera's point of view draw only the visible instances,
+ * whose data is packed in the second half of the renderable's instance buffer object. The other
+ * passes (e.g. shadow maps) draw all the instances from the first half.
+ *
+ * On the CPU, the visible instances are uploaded with FInstanceBuffer::prepareVisible() and their
+ * count is in FScene::INSTANCE_CULLING.
+ *
+ * On the GPU, a compute program culls the instances, copies the visible ones and writes their
+ * count in the indirect draw arguments of each primitive, which are then drawn with
+ * drawIndirect(). The CPU never reads the result back.
+ */
+class InstanceCuller {
+public:
+    // local_size_x of the compute program
+    static constexpr uint32_t GROUP_SIZE = 64;
+
+    // Culls `count` instances, transformed by rootTransform * localTransforms[i], whose bounding
+    // box is `box` in their local space. Writes the indices of the visible instances in
+    // `visible` and returns how many there are.
+    static size_t cull(Frustum const& frustum, Box const& box, math::mat4f const& rootTransform,
+            math::mat4f const* localTransforms, size_t count, uint32_t* visible) noexcept;
+
+    // whether the instances are culled on the GPU with this engine
+    static bool isGpuCullingSupported(FEngine& engine) noexcept;
+
+    static backend::ProgramHandle createProgram(FEngine& engine) noexcept;
+    static backend::DescriptorSetLayout getDescriptorSetLayout() noexcept;
+
+    InstanceCuller() noexcept;
+    ~InstanceCuller() noexcept;
+
+    InstanceCuller(InstanceCuller const&) = delete;
+    InstanceCuller& operator=(InstanceCuller const&) = delete;
+
+    // Culls the instances of the renderables in `visibleRenderables`. This must be called after
+    // FScene::updateUBOs(), which uploads the data of all the instances.
+    void cull(FEngine& engine, FScene::RenderableSoa& renderableData,
+            utils::Range<uint32_t> visibleRenderables, Frustum const& frustum);
+
+    void terminate(backend::DriverApi& driver) noexcept;
+
+private:
+    void cullOnGpu(FEngine& engine, FScene::RenderableSoa& renderableData,
+            utils::Range<uint32_t> visibleRenderables, Frustum const& frustum,
+            uint32_t renderableCount, uint32_t drawArgsCount);
+
+    // culling parameters of each renderable, one CullingParams each
+    backend::Handle<backend::HwBufferObject> mParams;
+    uint32_t mParamsCount = 0;
+
+    // indirect draw arguments of each primitive
+    backend::Handle<backend::HwBufferObject> mDrawArgs;
+    uint32_t mDrawArgsCount = 0;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_INSTANCECULLER_H
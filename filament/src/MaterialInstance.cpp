@@ -33,6 +33,7 @@ void FMaterialInstance::setParameterUntypedImpl(std::string_view name, const voi
     ssize_t offset = mMaterial->getUniformInterfaceBlock().getFieldOffset(name, 0);
     if (UTILS_LIKELY(offset >= 0)) {
         mUniforms.setUniformUntyped<Size>(size_t(offset), value);  // handles specialization for mat3f
+        invalidate();
     }
 }
 
@@ -52,6 +53,7 @@ inline void FMaterialInstance::setParameterImpl(std::string_view name, mat3f con
     ssize_t offset = mMaterial->getUniformInterfaceBlock().getFieldOffset(name, 0);
     if (UTILS_LIKELY(offset >= 0)) {
         mUniforms.setUniform(size_t(offset), value);
+        invalidate();
     }
 }
 
@@ -64,6 +66,7 @@ void FMaterialInstance::setParameterUntypedImpl(std::string_view name,
     ssize_t offset = mMaterial->getUniformInterfaceBlock().getFieldOffset(name, 0);
     if (UTILS_LIKELY(offset >= 0)) {
         mUniforms.setUniformArrayUntyped<Size>(size_t(offset), value, count);
+        invalidate();
     }
 }
 
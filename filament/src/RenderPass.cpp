@@ -51,6 +51,7 @@
 #include <utils/Range.h>
 
 #include <algorithm>
+#include <chrono>
 #include <functional>
 #include <limits>
 #include <utility>
@@ -113,6 +114,9 @@ RenderPass::RenderPass(FEngine& engine, RenderPassBuilder const& builder) noexce
           mScissorViewport(builder.mScissorViewport),
           mCustomCommands(engine.getPerRenderPassArena()) {
 
+    using clock = std::chrono::steady_clock;
+    clock::time_point const start = clock::now();
+
     // compute the number of commands we need
     updateSummedPrimitiveCounts(
             const_cast<FScene::RenderableSoa&>(mRenderableSoa), builder.mVisibleRenderables);
@@ -169,9 +173,18 @@ RenderPass::RenderPass(FEngine& engine, RenderPassBuilder const& builder) noexce
                 instanceify(engine, commandBegin, commandEnd, stereoscopicEyeCount));
     }
 
+    if (engine.isMultiDrawIndirectEnabled()) {
+        commandEnd = resize(builder.mArena,
+                multidrawify(engine, commandBegin, commandEnd));
+    }
+
     // these are `const` from this point on...
     mCommandBegin = commandBegin;
     mCommandEnd = commandEnd;
+
+    if (builder.mCommandGenerationTime) {
+        *builder.mCommandGenerationTime += clock::now() - start;
+    }
 }
 
 // this destructor is actually heavy because it inlines ~vector<>
@@ -328,9 +341,8 @@ RenderPass::Command* RenderPass::instanceify(FEngine& engine,
         Command const* e = curr + 1;
         if (UTILS_LIKELY(
                 !curr->info.hasSkinning && !curr->info.hasMorphing &&
-                 curr->info.instanceCount <= 1))
+                !curr->info.hasHybridInstancing && curr->info.instanceCount <= 1))
         {
-            assert_invariant(!curr->info.hasHybridInstancing);
             // we can't have nice things! No more than maxInstanceCount due to UBO size limits
             e = std::find_if_not(curr, std::min(last, curr + maxInstanceCount),
                     [lhs = *curr](Command const& rhs) {
@@ -357,7 +369,7 @@ RenderPass::Command* RenderPass::instanceify(FEngine& engine,
             // allocate our staging buffer only if needed
             if (UTILS_UNLIKELY(!stagingBuffer)) {
                 // Create a temporary UBO for holding the per-renderable data of each primitive,
-                // The `curr->info.index` is updated so that this (now instanced) command can
+                // The `curr->info.uboSlot` is updated so that this (now instanced) command can
                 // bind the UBO in the right place (where the per-instance data is).
                 // The lifetime of this object is the longest of this RenderPass and all its
                 // executors.
@@ -401,6 +413,7 @@ RenderPass::Command* RenderPass::instanceify(FEngine& engine,
             // make the first command instanced
             curr[0].info.instanceCount = instanceCount * eyeCount;
             curr[0].info.index = instancedPrimitiveOffset;
+            curr[0].info.uboSlot = instancedPrimitiveOffset;
             curr[0].info.dsh = mInstancedDescriptorSetHandle;
 
             instancedPrimitiveOffset += instanceCount;
@@ -444,6 +457,124 @@ RenderPass::Command* RenderPass::instanceify(FEngine& engine,
     return last;
 }
 
+RenderPass::Command* RenderPass::multidrawify(FEngine& engine,
+        Command* curr, Command* const last) const noexcept {
+    SYSTRACE_NAME("multidrawify");
+
+    DrawIndexedIndirectArgs* args = nullptr;
+    uint32_t argsCount = 0;
+    Command* const lastCommand = mergeMultiDraws(curr, last, args, argsCount);
+
+    if (UTILS_UNLIKELY(args)) {
+        DriverApi& driver = engine.getDriverApi();
+
+        // The lifetime of this buffer is the longest of this RenderPass and all its executors.
+        uint32_t const size = argsCount * sizeof(DrawIndexedIndirectArgs);
+        mMultiDrawArgsHandle = BufferObjectSharedHandle{
+                driver.createBufferObject(size,
+                        BufferObjectBinding::DRAW_INDIRECT, BufferUsage::STATIC), driver };
+
+        driver.updateBufferObject(mMultiDrawArgsHandle, {
+                args, size,
+                +[](void* buffer, size_t, void*) {
+                    ::free(buffer);
+                }
+        }, 0);
+    }
+
+    return lastCommand;
+}
+
+RenderPass::Command* RenderPass::mergeMultiDraws(Command* curr, Command* const last,
+        DrawIndexedIndirectArgs*& args, uint32_t& argsCount) noexcept {
+
+    // mergeMultiDraws works by scanning the **sorted** command stream, looking for consecutive
+    // draw commands that only differ by the range of indices they draw -- typically the
+    // primitives of a renderable sharing the same vertex and index buffers and MaterialInstance.
+    // Such a run is replaced by a single indirect multi-draw command, whose draw arguments
+    // are stored in a buffer object shared by all the multi-draws of this pass.
+    // The per-renderable descriptor-set is bound once per command, so only draws that use
+    // the same per-renderable data (descriptor-set and offsets) can be merged.
+
+    Command* firstSentinel = nullptr;
+    size_t const count = last - curr;
+    assert_invariant(args == nullptr);
+    argsCount = 0;
+
+    while (curr != last) {
+        Command const* e = curr + 1;
+        // the draw arguments of GPU culled instances are not known until the GPU writes them
+        if (UTILS_LIKELY((curr->key & CUSTOM_MASK) == uint64_t(CustomCommand::PASS) &&
+                curr->info.rph && !curr->info.drawArgs)) {
+            e = std::find_if_not(curr + 1, last,
+                    [lhs = curr->info](Command const& command) {
+                        PrimitiveInfo const& rhs = command.info;
+                        // everything but the index range must be identical
+                        return (command.key & CUSTOM_MASK) == uint64_t(CustomCommand::PASS) &&
+                               !rhs.drawArgs &&
+                               lhs.mi == rhs.mi &&
+                               lhs.rph == rhs.rph &&
+                               lhs.vbih == rhs.vbih &&
+                               lhs.dsh == rhs.dsh &&
+                               lhs.uboSlot == rhs.uboSlot &&
+                               lhs.skinningOffset == rhs.skinningOffset &&
+                               lhs.morphingOffset == rhs.morphingOffset &&
+                               lhs.rasterState == rhs.rasterState &&
+                               lhs.instanceCount == rhs.instanceCount &&
+                               lhs.materialVariant == rhs.materialVariant &&
+                               lhs.hasSkinning == rhs.hasSkinning &&
+                               lhs.hasMorphing == rhs.hasMorphing &&
+                               lhs.hasHybridInstancing == rhs.hasHybridInstancing &&
+                               lhs.hasInstanceCulling == rhs.hasInstanceCulling;
+                    });
+        }
+
+        uint32_t const drawCount = e - curr;
+        assert_invariant(drawCount > 0);
+
+        if (UTILS_UNLIKELY(drawCount > 1)) {
+            // allocate our staging buffer only if needed, it's large enough for all commands
+            if (UTILS_UNLIKELY(!args)) {
+                args = (DrawIndexedIndirectArgs*)::malloc(count * sizeof(DrawIndexedIndirectArgs));
+            }
+
+            assert_invariant(argsCount + drawCount <= count);
+            for (uint32_t i = 0; i < drawCount; i++) {
+                args[argsCount + i] = {
+                        .indexCount = curr[i].info.indexCount,
+                        .instanceCount = curr[i].info.instanceCount,
+                        .firstIndex = curr[i].info.indexOffset,
+                        .baseVertex = 0,
+                        .baseInstance = 0 };
+            }
+
+            // make the first command a multi-draw
+            curr[0].info.hasMultiDraw = true;
+            curr[0].info.indexOffset = argsCount;
+            curr[0].info.indexCount = drawCount;
+
+            argsCount += drawCount;
+
+            // cancel commands that are now part of the multi-draw
+            firstSentinel = !firstSentinel ? curr : firstSentinel;
+            for (uint32_t i = 1; i < drawCount; i++) {
+                curr[i].key = uint64_t(Pass::SENTINEL);
+            }
+        }
+
+        curr = const_cast<Command*>(e);
+    }
+
+    if (UTILS_UNLIKELY(firstSentinel)) {
+        // remove all the canceled commands
+        return std::remove_if(firstSentinel, last, [](auto const& command) {
+            return command.key == uint64_t(Pass::SENTINEL);
+        });
+    }
+
+    return last;
+}
+
 
 /* static */
 UTILS_ALWAYS_INLINE // This function exists only to make the code more readable. we want it inlined.
@@ -592,6 +723,9 @@ RenderPass::Command* RenderPass::generateCommandsImpl(RenderPass::CommandTypeFla
     bool const hasDepthClamp =
             renderFlags & HAS_DEPTH_CLAMP;
 
+    bool const hasInstanceCulling =
+            renderFlags & HAS_INSTANCE_CULLING;
+
     float const cameraPositionDotCameraForward = dot(cameraPosition, cameraForward);
 
     auto const* const UTILS_RESTRICT soaWorldAABBCenter = soa.data<FScene::WORLD_AABB_CENTER>();
@@ -602,6 +736,8 @@ RenderPass::Command* RenderPass::generateCommandsImpl(RenderPass::CommandTypeFla
     auto const* const UTILS_RESTRICT soaVisibilityMask  = soa.data<FScene::VISIBLE_MASK>();
     auto const* const UTILS_RESTRICT soaInstanceInfo    = soa.data<FScene::INSTANCES>();
     auto const* const UTILS_RESTRICT soaDescriptorSet   = soa.data<FScene::DESCRIPTOR_SET_HANDLE>();
+    auto const* const UTILS_RESTRICT soaUboSlot         = soa.data<FScene::UBO_SLOT>();
+    auto const* const UTILS_RESTRICT soaInstanceCulling = soa.data<FScene::INSTANCE_CULLING>();
 
     Command cmd;
 
@@ -686,13 +822,32 @@ RenderPass::Command* RenderPass::generateCommandsImpl(RenderPass::CommandTypeFla
         cmd.key |= makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
         cmd.key |= makeField(soaVisibility[i].channel, CHANNEL_MASK, CHANNEL_SHIFT);
         cmd.info.index = i;
+        cmd.info.uboSlot = soaUboSlot[i];
         cmd.info.hasHybridInstancing = (bool)soaInstanceInfo[i].handle;
         cmd.info.instanceCount = soaInstanceInfo[i].count;
         cmd.info.hasMorphing = (bool)morphing.handle;
         cmd.info.hasSkinning = (bool)skinning.handle;
+        cmd.info.hasMultiDraw = false;
+        cmd.info.hasInstanceCulling = false;
+        cmd.info.drawArgs = {};
 
         assert_invariant(cmd.info.hasHybridInstancing || cmd.info.instanceCount <= 1);
 
+        // Only the instances visible from the camera are drawn, their data is packed after the
+        // data of all the instances. With GPU culling, the instance count is in drawArgs.
+        FScene::InstanceCullingInfo const& instanceCulling = soaInstanceCulling[i];
+        if (UTILS_UNLIKELY(hasInstanceCulling && instanceCulling.culled)) {
+            assert_invariant(cmd.info.hasHybridInstancing && !hasInstancedStereo);
+            cmd.info.hasInstanceCulling = true;
+            cmd.info.drawArgs = instanceCulling.drawArgs;
+            if (!cmd.info.drawArgs) {
+                cmd.info.instanceCount = instanceCulling.visibleCount;
+                if (!cmd.info.instanceCount) {
+                    continue;
+                }
+            }
+        }
+
         // soaInstanceInfo[i].count is the number of instances the user has requested, either for
         // manual or hybrid instancing. Instanced stereo multiplies the number of instances by the
         // eye count.
@@ -711,6 +866,7 @@ RenderPass::Command* RenderPass::generateCommandsImpl(RenderPass::CommandTypeFla
         const bool writeDepthForShadowCasters = depthContainsShadowCasters & shadowCaster;
 
         const Slice<FRenderPrimitive>& primitives = soaPrimitives[i];
+        uint32_t drawArgsIndex = instanceCulling.firstDrawArgs;
         /*
          * This is our hot loop. It's written to avoid branches.
          * When modifying this code, always ensure it stays efficient.
@@ -727,6 +883,10 @@ RenderPass::Command* RenderPass::generateCommandsImpl(RenderPass::CommandTypeFla
             cmd.info.vbih = primitive.getVertexBufferInfoHandle();
             cmd.info.indexOffset = primitive.getIndexOffset();
             cmd.info.indexCount = primitive.getIndexCount();
+            if (UTILS_UNLIKELY(cmd.info.drawArgs)) {
+                // each primitive has its own draw arguments, in order
+                cmd.info.indexOffset = drawArgsIndex++;
+            }
             cmd.info.type = primitive.getPrimitiveType();
             cmd.info.morphingOffset = primitive.getMorphingBufferOffset();
 // FIXME: morphtarget buffer
@@ -947,7 +1107,7 @@ void RenderPass::Executor::execute(FEngine& engine,
                 sizeof(COMMAND_TYPE(bindRenderPrimitive)) +
                 sizeof(COMMAND_TYPE(bindDescriptorSet)) + backend::CustomCommand::align(sizeof(NoopCommand) + 8) +
                 sizeof(COMMAND_TYPE(setPushConstant)) +
-                sizeof(COMMAND_TYPE(draw2));
+                std::max(sizeof(COMMAND_TYPE(draw2)), sizeof(COMMAND_TYPE(drawIndirect)));
 
 
         // Number of Commands that can be issued and guaranteed to fit in the current
@@ -1073,8 +1233,10 @@ void RenderPass::Executor::execute(FEngine& engine,
 
                 // Bind per-renderable uniform block. There is no need to attempt to skip this command
                 // because the backends already do this.
+                // The instances that passed the instance culling are after all the instances.
                 uint32_t const offset = info.hasHybridInstancing ?
-                                      0 : info.index * sizeof(PerRenderableData);
+                        (info.hasInstanceCulling ? sizeof(PerRenderableUib) : 0) :
+                        info.uboSlot * sizeof(PerRenderableData);
 
                 assert_invariant(info.dsh);
                 driver.bindDescriptorSet(info.dsh,
@@ -1086,7 +1248,17 @@ void RenderPass::Executor::execute(FEngine& engine,
                             +PushConstantIds::MORPHING_BUFFER_OFFSET, int32_t(info.morphingOffset));
                 }
 
-                driver.draw2(info.indexOffset, info.indexCount, info.instanceCount);
+                if (UTILS_UNLIKELY(info.hasMultiDraw)) {
+                    // indexOffset and indexCount are the range of the draw arguments
+                    driver.drawIndirect(mMultiDrawArgsHandle,
+                            info.indexOffset * sizeof(DrawIndexedIndirectArgs), info.indexCount);
+                } else if (UTILS_UNLIKELY(info.drawArgs)) {
+                    // indexOffset is the index of the draw arguments written by the culling
+                    driver.drawIndirect(info.drawArgs,
+                            info.indexOffset * sizeof(DrawIndexedIndirectArgs), 1);
+                } else {
+                    driver.draw2(info.indexOffset, info.indexCount, info.instanceCount);
+                }
             }
         }
 
@@ -1105,6 +1277,7 @@ RenderPass::Executor::Executor(RenderPass const& pass, Command const* b, Command
           mCustomCommands(pass.mCustomCommands.data(), pass.mCustomCommands.size()),
           mInstancedUboHandle(pass.mInstancedUboHandle),
           mInstancedDescriptorSetHandle(pass.mInstancedDescriptorSetHandle),
+          mMultiDrawArgsHandle(pass.mMultiDrawArgsHandle),
           mColorPassDescriptorSet(pass.mColorPassDescriptorSet),
           mScissor(pass.mScissorViewport),
           mPolygonOffsetOverride(false),
@@ -39,6 +39,7 @@
 
 #include <math/mathfwd.h>
 
+#include <chrono>
 #include <functional>
 #include <limits>
 #include <optional>
@@ -49,6 +50,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
+// for gtest
+class RenderPassTest;
+
 namespace filament {
 
 namespace backend {
@@ -248,9 +252,11 @@ public:
         backend::RenderPrimitiveHandle rph;                 // 4 bytes
         backend::VertexBufferInfoHandle vbih;               // 4 bytes
         backend::DescriptorSetHandle dsh;                   // 4 bytes
-        uint32_t indexOffset;                               // 4 bytes
-        uint32_t indexCount;                                // 4 bytes
+        uint32_t indexOffset;                               // 4 bytes [multi-draw: first args]
+                                                            //         [drawArgs: args index]
+        uint32_t indexCount;                                // 4 bytes [multi-draw: draw count]
         uint32_t index = 0;                                 // 4 bytes
+        uint32_t uboSlot = 0;                               // 4 bytes
         uint32_t skinningOffset = 0;                        // 4 bytes
         uint32_t morphingOffset = 0;                        // 4 bytes
 
@@ -262,8 +268,11 @@ public:
         bool hasSkinning : 1;                               //              1 bit
         bool hasMorphing : 1;                               //              1 bit
         bool hasHybridInstancing : 1;                       //              1 bit
+        bool hasMultiDraw : 1;                              //              1 bit
+        bool hasInstanceCulling : 1;                        //              1 bit
 
-        uint32_t rfu[2];                                    // 16 bytes
+        // draw arguments written by the GPU instance culling, or null
+        backend::BufferObjectHandle drawArgs;               // 4 bytes
     };
     static_assert(sizeof(PrimitiveInfo) == 56);
 
@@ -286,6 +295,8 @@ public:
     static constexpr RenderFlags HAS_INVERSE_FRONT_FACES   = 0x02;
     static constexpr RenderFlags IS_INSTANCED_STEREOSCOPIC = 0x04;
     static constexpr RenderFlags HAS_DEPTH_CLAMP           = 0x08;
+    // draw only the instances that passed the View's instance culling, see InstanceCuller
+    static constexpr RenderFlags HAS_INSTANCE_CULLING      = 0x10;
 
     // Arena used for commands
     using Arena = utils::Arena<
@@ -349,6 +360,7 @@ public:
         utils::Slice<CustomCommandFn> mCustomCommands;
         BufferObjectSharedHandle mInstancedUboHandle;
         DescriptorSetSharedHandle mInstancedDescriptorSetHandle;
+        BufferObjectSharedHandle mMultiDrawArgsHandle;
         ColorPassDescriptorSet const* mColorPassDescriptorSet = nullptr;
         // this stores either the scissor-viewport or the scissor override
         backend::Viewport mScissor{ 0, 0, INT32_MAX, INT32_MAX };
@@ -402,6 +414,7 @@ public:
     }
 
 private:
+    friend class ::RenderPassTest;
     friend class FRenderer;
     friend class RenderPassBuilder;
     RenderPass(FEngine& engine, RenderPassBuilder const& builder) noexcept;
@@ -434,6 +447,15 @@ private:
             Command* begin, Command* end,
             int32_t eyeCount) const noexcept;
 
+    // merges commands into indirect multi-draws then trims sentinels
+    RenderPass::Command* multidrawify(FEngine& engine,
+            Command* begin, Command* end) const noexcept;
+
+    // the part of multidrawify() that doesn't need the driver: `args` is allocated with malloc()
+    // only if at least one multi-draw was formed, and holds `argsCount` draw arguments.
+    static Command* mergeMultiDraws(Command* begin, Command* end,
+            backend::DrawIndexedIndirectArgs*& args, uint32_t& argsCount) noexcept;
+
     // We choose the command count per job to minimize JobSystem overhead.
     static constexpr size_t JOBS_PARALLEL_FOR_COMMANDS_COUNT = 128;
     static constexpr size_t JOBS_PARALLEL_FOR_COMMANDS_SIZE  =
@@ -469,6 +491,7 @@ private:
     Command const* /* const */ mCommandEnd = nullptr;     // Pointer to one past the last command
     mutable BufferObjectSharedHandle mInstancedUboHandle; // ubo for instanced primitives
     mutable DescriptorSetSharedHandle mInstancedDescriptorSetHandle; // a descriptor-set to hold the ubo
+    mutable BufferObjectSharedHandle mMultiDrawArgsHandle; // draw arguments of multi-draw commands
     // a vector for our custom commands
     using CustomCommandVector = std::vector<Executor::CustomCommandFn,
             utils::STLAllocator<Executor::CustomCommandFn, LinearAllocatorArena>>;
@@ -489,6 +512,7 @@ class RenderPassBuilder {
     Variant mVariant{};
     ColorPassDescriptorSet const* mColorPassDescriptorSet = nullptr;
     FScene::VisibleMaskType mVisibilityMask = std::numeric_limits<FScene::VisibleMaskType>::max();
+    std::chrono::steady_clock::duration* mCommandGenerationTime = nullptr;
 
     using CustomCommandRecord = std::tuple<
             uint8_t,
@@ -569,6 +593,13 @@ public:
         return *this;
     }
 
+    // If set, the time spent generating and sorting commands is added to *duration
+    RenderPassBuilder& commandGenerationTime(
+            std::chrono::steady_clock::duration* duration) noexcept {
+        mCommandGenerationTime = duration;
+        return *this;
+    }
+
     RenderPassBuilder& customCommand(FEngine& engine,
             uint8_t channel,
             RenderPass::Pass pass,
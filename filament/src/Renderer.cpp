@@ -91,6 +91,10 @@ void Renderer::setFrameRateOptions(FrameRateOptions const& options) noexcept {
     downcast(this)->setFrameRateOptions(options);
 }
 
+void Renderer::setLatencyOptions(LatencyOptions const& options) noexcept {
+    downcast(this)->setLatencyOptions(options);
+}
+
 void Renderer::setClearOptions(const ClearOptions& options) {
     downcast(this)->setClearOptions(options);
 }
@@ -115,4 +119,9 @@ size_t Renderer::getMaxFrameHistorySize() const noexcept {
     return downcast(this)->getMaxFrameHistorySize();
 }
 
+utils::FixedCapacityVector<Renderer::CpuFrameInfo> Renderer::getCpuFrameInfoHistory(
+        size_t historySize) const noexcept {
+    return downcast(this)->getCpuFrameInfoHistory(historySize);
+}
+
 } // namespace filament
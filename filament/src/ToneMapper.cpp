@@ -190,6 +190,24 @@ float3 ACES(float3 color, float brightness) noexcept {
         A::A() noexcept = default; \
         A::~A() noexcept = default;
 
+// Types of the keys of the built-in tone mappers, custom tone mappers use UNKNOWN
+enum class ToneMapperType : uint32_t {
+    UNKNOWN = 0,
+    LINEAR,
+    ACES,
+    ACES_LEGACY,
+    FILMIC,
+    PBR_NEUTRAL,
+    AGX,
+    GENERIC,
+    DISPLAY_RANGE,
+};
+
+#define DEFAULT_KEY(A, T) \
+        ToneMapper::Key A::getKey() const noexcept { return { uint32_t(ToneMapperType::T) }; }
+
+DEFAULT_KEY(ToneMapper, UNKNOWN)
+
 DEFAULT_CONSTRUCTORS(ToneMapper)
 
 //------------------------------------------------------------------------------
@@ -197,6 +215,7 @@ DEFAULT_CONSTRUCTORS(ToneMapper)
 //------------------------------------------------------------------------------
 
 DEFAULT_CONSTRUCTORS(LinearToneMapper)
+DEFAULT_KEY(LinearToneMapper, LINEAR)
 
 float3 LinearToneMapper::operator()(float3 v) const noexcept {
     return saturate(v);
@@ -207,18 +226,21 @@ float3 LinearToneMapper::operator()(float3 v) const noexcept {
 //------------------------------------------------------------------------------
 
 DEFAULT_CONSTRUCTORS(ACESToneMapper)
+DEFAULT_KEY(ACESToneMapper, ACES)
 
 float3 ACESToneMapper::operator()(math::float3 c) const noexcept {
     return aces::ACES(c, 1.0f);
 }
 
 DEFAULT_CONSTRUCTORS(ACESLegacyToneMapper)
+DEFAULT_KEY(ACESLegacyToneMapper, ACES_LEGACY)
 
 float3 ACESLegacyToneMapper::operator()(math::float3 c) const noexcept {
     return aces::ACES(c, 1.0f / 0.6f);
 }
 
 DEFAULT_CONSTRUCTORS(FilmicToneMapper)
+DEFAULT_KEY(FilmicToneMapper, FILMIC)
 
 float3 FilmicToneMapper::operator()(math::float3 x) const noexcept {
     // Narkowicz 2015, "ACES Filmic Tone Mapping Curve"
@@ -235,6 +257,7 @@ float3 FilmicToneMapper::operator()(math::float3 x) const noexcept {
 //------------------------------------------------------------------------------
 
 DEFAULT_CONSTRUCTORS(PBRNeutralToneMapper)
+DEFAULT_KEY(PBRNeutralToneMapper, PBR_NEUTRAL)
 
 float3 PBRNeutralToneMapper::operator()(math::float3 color) const noexcept {
     // PBR Tone Mapping, https://modelviewer.dev/examples/tone-mapping.html
@@ -263,6 +286,10 @@ float3 PBRNeutralToneMapper::operator()(math::float3 color) const noexcept {
 AgxToneMapper::AgxToneMapper(AgxToneMapper::AgxLook look) noexcept : look(look) {}
 AgxToneMapper::~AgxToneMapper() noexcept = default;
 
+ToneMapper::Key AgxToneMapper::getKey() const noexcept {
+    return { uint32_t(ToneMapperType::AGX), { float(look) } };
+}
+
 // These matrices taken from Blender's implementation of AgX, which works with Rec.2020 primaries.
 // https://github.com/EaryChow/AgX_LUT_Gen/blob/main/AgXBaseRec2020.py
 constexpr mat3f AgXInsetMatrix {
@@ -361,6 +388,7 @@ float3 AgxToneMapper::operator()(float3 v) const noexcept {
 //------------------------------------------------------------------------------
 
 DEFAULT_CONSTRUCTORS(DisplayRangeToneMapper)
+DEFAULT_KEY(DisplayRangeToneMapper, DISPLAY_RANGE)
 
 float3 DisplayRangeToneMapper::operator()(math::float3 c) const noexcept {
     // 16 debug colors + 1 duplicated at the end for easy indexing
@@ -465,6 +493,11 @@ float3 GenericToneMapper::operator()(math::float3 x) const noexcept {
     return mOptions->outputScale * x / (x + mOptions->inputScale);
 }
 
+ToneMapper::Key GenericToneMapper::getKey() const noexcept {
+    return { uint32_t(ToneMapperType::GENERIC), {
+            mOptions->contrast, mOptions->midGrayIn, mOptions->midGrayOut, mOptions->hdrMax } };
+}
+
 float GenericToneMapper::getContrast() const noexcept { return  mOptions->contrast; }
 float GenericToneMapper::getMidGrayIn() const noexcept { return  mOptions->midGrayIn; }
 float GenericToneMapper::getMidGrayOut() const noexcept { return  mOptions->midGrayOut; }
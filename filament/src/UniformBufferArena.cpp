@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "UniformBufferArena.h"
+
+#include "private/backend/DriverApi.h"
+
+#include <backend/BufferDescriptor.h>
+#include <backend/DriverEnums.h>
+
+#include <utils/CString.h>
+#include <utils/debug.h>
+
+#include <algorithm>
+#include <utility>
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace filament {
+
+using namespace backend;
+
+// Larger uploads don't go through the command stream, so that committing many pages at once
+// can't overflow it.
+static constexpr uint32_t MAX_COMMAND_STREAM_UPLOAD_SIZE = 16 * 1024;
+
+static constexpr uint32_t alignSize(uint32_t size) noexcept {
+    return (size + UniformBufferArena::ALIGNMENT - 1u) & ~(UniformBufferArena::ALIGNMENT - 1u);
+}
+
+UniformBufferArena::UniformBufferArena() noexcept = default;
+
+UniformBufferArena::~UniformBufferArena() noexcept = default;
+
+void UniformBufferArena::terminate(DriverApi& driver) noexcept {
+    assert_invariant(mDedicatedCount == 0);
+    for (Page const& page : mPages) {
+        assert_invariant(page.freeSize == PAGE_SIZE);
+        driver.destroyBufferObject(page.buffer);
+    }
+    mPages.clear();
+}
+
+UniformBufferArena::Allocation UniformBufferArena::allocate(DriverApi& driver,
+        uint32_t size, const char* debugTag) {
+    assert_invariant(size);
+    uint32_t const alignedSize = alignSize(size);
+
+    if (!mSuballocationEnabled || alignedSize > PAGE_SIZE) {
+        Handle<HwBufferObject> const buffer = driver.createBufferObject(size,
+                BufferObjectBinding::UNIFORM, BufferUsage::DYNAMIC);
+        driver.setDebugTag(buffer.getId(), utils::CString(debugTag));
+        mDedicatedCount++;
+        return { buffer, 0, size, DEDICATED };
+    }
+
+    // first fit, in the first page that has enough room
+    for (uint32_t i = 0;; i++) {
+        if (i == mPages.size()) {
+            Page& page = mPages.emplace_back();
+            page.buffer = driver.createBufferObject(PAGE_SIZE,
+                    BufferObjectBinding::UNIFORM, BufferUsage::DYNAMIC);
+            driver.setDebugTag(page.buffer.getId(), utils::CString("UniformBufferArena"));
+            page.shadow = std::make_unique<uint8_t[]>(PAGE_SIZE);
+            page.freeRanges.push_back({ 0, PAGE_SIZE });
+        }
+        Page& page = mPages[i];
+        if (page.freeSize < alignedSize) {
+            continue;
+        }
+        auto const pos = std::find_if(page.freeRanges.begin(), page.freeRanges.end(),
+                [alignedSize](Range const& range) { return range.size >= alignedSize; });
+        if (pos != page.freeRanges.end()) {
+            uint32_t const offset = pos->offset;
+            pos->offset += alignedSize;
+            pos->size -= alignedSize;
+            if (pos->size == 0) {
+                page.freeRanges.erase(pos);
+            }
+            page.freeSize -= alignedSize;
+            return { page.buffer, offset, size, i };
+        }
+    }
+}
+
+void UniformBufferArena::free(DriverApi& driver, Allocation const& allocation) noexcept {
+    if (allocation.page == DEDICATED) {
+        if (allocation.buffer) {
+            driver.destroyBufferObject(allocation.buffer);
+            mDedicatedCount--;
+        }
+        return;
+    }
+
+    Page& page = mPages[allocation.page];
+    Range range{ allocation.offset, alignSize(allocation.size) };
+    page.freeSize += range.size;
+
+    // insert the range, merging it with its neighbors
+    auto& freeRanges = page.freeRanges;
+    auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), range.offset,
+            [](Range const& lhs, uint32_t offset) { return lhs.offset < offset; });
+    if (next != freeRanges.end() && range.offset + range.size == next->offset) {
+        range.size += next->size;
+        next = freeRanges.erase(next);
+    }
+    if (next != freeRanges.begin()) {
+        auto const prev = std::prev(next);
+        if (prev->offset + prev->size == range.offset) {
+            prev->size += range.size;
+            return;
+        }
+    }
+    freeRanges.insert(next, range);
+}
+
+void UniformBufferArena::write(DriverApi& driver, Allocation const& allocation,
+        void const* data, uint32_t size) noexcept {
+    assert_invariant(size <= allocation.size);
+    if (allocation.page == DEDICATED) {
+        upload(driver, allocation.buffer, 0, data, size);
+        return;
+    }
+    Page& page = mPages[allocation.page];
+    memcpy(page.shadow.get() + allocation.offset, data, size);
+    page.dirtyRanges.push_back({ allocation.offset, size });
+}
+
+void UniformBufferArena::update(DriverApi& driver, Allocation const& allocation,
+        void const* data, uint32_t size) noexcept {
+    assert_invariant(size <= allocation.size);
+    if (allocation.page != DEDICATED) {
+        // keep the copy up-to-date, it's used by the next uploads of nearby ranges
+        memcpy(mPages[allocation.page].shadow.get() + allocation.offset, data, size);
+    }
+    upload(driver, allocation.buffer, allocation.offset, data, size);
+}
+
+void UniformBufferArena::commit(DriverApi& driver) noexcept {
+    for (Page& page : mPages) {
+        auto& dirtyRanges = page.dirtyRanges;
+        if (dirtyRanges.empty()) {
+            continue;
+        }
+        std::sort(dirtyRanges.begin(), dirtyRanges.end(),
+                [](Range const& lhs, Range const& rhs) { return lhs.offset < rhs.offset; });
+
+        Range current = dirtyRanges.front();
+        for (size_t i = 1, c = dirtyRanges.size(); i < c; i++) {
+            Range const& range = dirtyRanges[i];
+            uint32_t const end = current.offset + current.size;
+            if (range.offset <= end + MAX_UPLOAD_GAP) {
+                current.size = std::max(end, range.offset + range.size) - current.offset;
+            } else {
+                upload(driver, page.buffer, current.offset,
+                        page.shadow.get() + current.offset, current.size);
+                current = range;
+            }
+        }
+        upload(driver, page.buffer, current.offset,
+                page.shadow.get() + current.offset, current.size);
+        dirtyRanges.clear();
+    }
+}
+
+void UniformBufferArena::upload(DriverApi& driver, Handle<HwBufferObject> buffer,
+        uint32_t offset, void const* data, uint32_t size) noexcept {
+    BufferDescriptor bd;
+    if (size <= MAX_COMMAND_STREAM_UPLOAD_SIZE) {
+        bd = BufferDescriptor(driver.allocate(size), size);
+    } else {
+        bd = BufferDescriptor(malloc(size), size,
+                [](void* buffer, size_t, void*) { ::free(buffer); });
+    }
+    memcpy(const_cast<void*>(bd.buffer), data, size);
+    driver.updateBufferObject(buffer, std::move(bd), offset);
+    mUploadCount++;
+    mUploadSize += size;
+}
+
+UniformBufferArena::Stats UniformBufferArena::getStats() const noexcept {
+    return {
+            .bufferCount = uint32_t(mPages.size()) + mDedicatedCount,
+            .uploadCount = mUploadCount,
+            .uploadSize = mUploadSize,
+    };
+}
+
+void UniformBufferArena::resetStats() noexcept {
+    mUploadCount = 0;
+    mUploadSize = 0;
+}
+
+} // namespace filament
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_UNIFORMBUFFERARENA_H
+#define TNT_FILAMENT_UNIFORMBUFFERARENA_H
+
+#include <backend/DriverApiForward.h>
+#include <backend/Handle.h>
+
+#include <memory>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * UniformBufferArena suballocates small uniform buffers, e.g. the ones of material instances, from
+ * a few large buffer objects (pages).
+ *
+ * The arena keeps a copy of its pages in CPU memory, so that writes to many allocations can be
+ * uploaded with a few large updates, instead of one update per allocation. Nearby dirty ranges
+ * are uploaded together, including the clean data between them.
+ *
+ * Allocations that don't fit in a page, or all of them if suballocation is disabled, get their
+ * own buffer object.
+ */
+class UniformBufferArena {
+public:
+    // Offset alignment of the allocations. Like the per-renderable UBO, we assume no backend
+    // requires more than 256 bytes.
+    static constexpr uint32_t ALIGNMENT = 256;
+
+    // Size of the pages
+    static constexpr uint32_t PAGE_SIZE = 64 * 1024;
+
+    // Dirty ranges closer than this are uploaded together
+    static constexpr uint32_t MAX_UPLOAD_GAP = 2 * 1024;
+
+    struct Allocation {
+        backend::Handle<backend::HwBufferObject> buffer;
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        uint32_t page = DEDICATED;      // index of the page, or DEDICATED
+    };
+
+    struct Stats {
+        uint32_t bufferCount = 0;       // buffer objects currently allocated by the arena
+        uint32_t uploadCount = 0;       // updateBufferObject() issued since the last resetStats()
+        uint32_t uploadSize = 0;        // bytes uploaded since the last resetStats()
+    };
+
+    UniformBufferArena() noexcept;
+    ~UniformBufferArena() noexcept;
+
+    UniformBufferArena(UniformBufferArena const&) = delete;
+    UniformBufferArena& operator=(UniformBufferArena const&) = delete;
+
+    // frees all the buffer objects, all allocations must have been freed
+    void terminate(backend::DriverApi& driver) noexcept;
+
+    // Backends that emulate uniform buffers (i.e. feature level 0) can't use suballocations
+    void setSuballocationEnabled(bool enabled) noexcept { mSuballocationEnabled = enabled; }
+
+    Allocation allocate(backend::DriverApi& driver, uint32_t size, const char* debugTag);
+
+    void free(backend::DriverApi& driver, Allocation const& allocation) noexcept;
+
+    // Updates an allocation, the upload is deferred until the next commit() if possible
+    void write(backend::DriverApi& driver, Allocation const& allocation,
+            void const* data, uint32_t size) noexcept;
+
+    // Updates an allocation and uploads it immediately, e.g. between two draw calls
+    void update(backend::DriverApi& driver, Allocation const& allocation,
+            void const* data, uint32_t size) noexcept;
+
+    // Uploads all the writes since the last commit()
+    void commit(backend::DriverApi& driver) noexcept;
+
+    Stats getStats() const noexcept;
+
+    void resetStats() noexcept;
+
+    static constexpr uint32_t DEDICATED = UINT32_MAX;
+
+private:
+    struct Range {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    struct Page {
+        backend::Handle<backend::HwBufferObject> buffer;
+        std::unique_ptr<uint8_t[]> shadow;
+        std::vector<Range> freeRanges;      // sorted by offset, never adjacent
+        std::vector<Range> dirtyRanges;     // in write order
+        uint32_t freeSize = PAGE_SIZE;
+    };
+
+    void upload(backend::DriverApi& driver, backend::Handle<backend::HwBufferObject> buffer,
+            uint32_t offset, void const* data, uint32_t size) noexcept;
+
+    std::vector<Page> mPages;
+    uint32_t mDedicatedCount = 0;
+    uint32_t mUploadCount = 0;
+    uint32_t mUploadSize = 0;
+    bool mSuballocationEnabled = true;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_UNIFORMBUFFERARENA_H
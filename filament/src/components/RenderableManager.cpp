@@ -588,7 +588,11 @@ void FRenderableManager::create(
             // PerRenderableUib, regardless of the number of instances. This is because the buffer
             // will get bound to the PER_RENDERABLE UBO, and we can't bind a buffer smaller than the
             // full size of the UBO.
-            instances.handle = driver.createBufferObject(sizeof(PerRenderableUib),
+            // With instance culling, the instances visible from the camera are packed in a second
+            // PerRenderableUib, see InstanceCuller.
+            size_t const size = instances.buffer->isCullingEnabled() ?
+                    2 * sizeof(PerRenderableUib) : sizeof(PerRenderableUib);
+            instances.handle = driver.createBufferObject(size,
                     BufferObjectBinding::UNIFORM, backend::BufferUsage::DYNAMIC);
             if (auto name = instances.buffer->getName(); !name.empty()) {
                 driver.setDebugTag(instances.handle.getId(), std::move(name));
@@ -33,10 +33,15 @@
 #include <utils/Mutex.h>
 #include <utils/Systrace.h>
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
+#include <iterator>
 #include <mutex>
 #include <tuple>
+#include <type_traits>
 
 namespace filament {
 
@@ -627,171 +632,336 @@ static ColorTransform selectOETF(const ColorSpace& colorSpace) noexcept {
 // Color grading implementation
 //------------------------------------------------------------------------------
 
+// The LUT is generated in three stages:
+// - input: LogC decoding, exposure, night adaptation, white balance, channel mixer and tonal
+//   ranges, all in linear space
+// - grading: the adjustments done in log space, vibrance, saturation and curves
+// - output: tone mapping, gamut mapping and the OETF
+// The engine keeps the outputs of the input and grading stages, which are only recomputed when
+// their parameters change, and the last few complete LUTs, see LutCache.
+
+using InputParameters = FColorGrading::InputParameters;
+using GradingParameters = FColorGrading::GradingParameters;
+using OutputParameters = FColorGrading::OutputParameters;
+using LutKey = FColorGrading::LutKey;
+using LutCache = FColorGrading::LutCache;
+
+template<typename T>
+static bool isSameStage(T const& lhs, T const& rhs) noexcept {
+    // The parameters are only made of 32-bit fields, so they have no padding
+    static_assert(std::is_trivially_copyable_v<T> && sizeof(T) % 4 == 0);
+    return memcmp(&lhs, &rhs, sizeof(T)) == 0;
+}
+
 struct Config {
     size_t lutDimension{};
-    mat3f  adaptationTransform;
-    mat3f  colorGradingIn;
     mat3f  colorGradingOut;
-    float3 colorGradingLuminance{};
+    const ToneMapper* toneMapper = nullptr;
+    bool   luminanceScaling = false;
+    bool   gamutMapping = false;
 
     ColorTransform oetf;
-};
 
-// Inside the FColorGrading constructor, TSAN sporadically detects a data race on the config struct;
-// the Filament thread writes and the Job thread reads. In practice there should be no data race, so
-// we force TSAN off to silence the warning.
-UTILS_NO_SANITIZE_THREAD
-FColorGrading::FColorGrading(FEngine& engine, const Builder& builder) {
-    SYSTRACE_CALL();
+    InputParameters input{};
+    GradingParameters grading{};
 
-    DriverApi& driver = engine.getDriverApi();
+    // The LogC decoding is separable, so it's only done once per coordinate
+    std::array<float, 64> linear{};
 
-    Config c;
-    // This lock protects the data inside Config, which is written to by the Filament thread,
-    // and read from multiple Job threads.
-    utils::Mutex configLock;
-    {
-        std::lock_guard<utils::Mutex> const lock(configLock);
-        c.lutDimension          = builder->dimension;
-        c.adaptationTransform   = adaptationTransform(builder->whiteBalance);
-        c.colorGradingIn        = selectColorGradingTransformIn(builder->toneMapping);
-        c.colorGradingOut       = selectColorGradingTransformOut(builder->toneMapping);
-        c.colorGradingLuminance = selectColorGradingLuminance(builder->toneMapping);
-        c.oetf                  = selectOETF(builder->outputColorSpace);
+    // Without adjustments, the input stage is colorGradingIn applied to the decoded coordinates,
+    // i.e. the sum of one term per axis: column i of the matrix times the coordinate on axis i
+    std::array<float3, 64> axes[3]{};
+
+    // Outputs of the input and grading stages, see StageCache
+    float3* inputData = nullptr;
+    float3* gradingData = nullptr;      // null if there are no adjustments
+    bool inputCached = false;
+    bool gradingCached = false;
+};
+
+static void generateInputSlice(Config const& c, size_t b, float3* UTILS_RESTRICT out) noexcept {
+    InputParameters const& p = c.input;
+    float const* const linear = c.linear.data();
+
+    if (!p.hasAdjustments) {
+        // only the sums of the per-axis terms are left, they vectorize
+        float3 const* UTILS_RESTRICT const axisR = c.axes[0].data();
+        float3 const* UTILS_RESTRICT const axisG = c.axes[1].data();
+        for (size_t g = 0; g < p.dimension; g++) {
+            float3 const gb = axisG[g] + c.axes[2][b];
+            for (size_t r = 0; r < p.dimension; r++) {
+                out[r] = axisR[r] + gb;
+            }
+            out += p.dimension;
+        }
+        return;
     }
 
-    mDimension = c.lutDimension;
+    for (size_t g = 0; g < p.dimension; g++) {
+        for (size_t r = 0; r < p.dimension; r++) {
+            float3 v{ linear[r], linear[g], linear[b] };
 
-    size_t lutElementCount = c.lutDimension * c.lutDimension * c.lutDimension;
-    size_t elementSize = sizeof(half4);
-    void* data = malloc(lutElementCount * elementSize);
+            // Exposure
+            v = adjustExposure(v, p.exposure);
 
-    auto [textureFormat, format, type] = selectLutTextureParams(builder->format);
-    assert_invariant(FTexture::isTextureFormatSupported(engine, textureFormat));
-    assert_invariant(FTexture::validatePixelFormatAndType(textureFormat, format, type));
+            // Purkinje shift ("low-light" vision)
+            v = scotopicAdaptation(v, p.nightAdaptation);
+
+            // Move to color grading color space
+            v = p.colorGradingIn * v;
+
+            // White balance
+            v = chromaticAdaptation(v, p.adaptationTransform);
+
+            // Kill negative values before the next transforms
+            v = max(v, 0.0f);
+
+            // Channel mixer
+            v = channelMixer(v, p.outRed, p.outGreen, p.outBlue);
 
-    void* converted = nullptr;
-    if (type == PixelDataType::UINT_2_10_10_10_REV) {
-        // convert input to UINT_2_10_10_10_REV if needed
-        converted = malloc(lutElementCount * sizeof(uint32_t));
+            // Shadows/mid-tones/highlights
+            v = tonalRanges(v, p.luminance, p.shadows, p.midtones, p.highlights,
+                    p.tonalRanges);
+
+            *out++ = v;
+        }
     }
+}
 
-    //auto now = std::chrono::steady_clock::now();
+static void generateGradingSlice(GradingParameters const& p, float3 luminance,
+        float3 const* UTILS_RESTRICT in, float3* UTILS_RESTRICT out, size_t count) noexcept {
+    for (size_t i = 0; i < count; i++) {
+        // The adjustments below behave better in log space
+        float3 v = linear_to_LogC(in[i]);
 
-    // Multithreadedly generate the tone mapping 3D look-up table using 32 jobs
-    // Slices are 8 KiB (128 cache lines) apart.
-    // This takes about 3-6ms on Android in Release
-    JobSystem& js = engine.getJobSystem();
-    auto *slices = js.createJob();
-    for (size_t b = 0; b < c.lutDimension; b++) {
-        auto *job = js.createJob(slices,
-                [data, converted, b, &c, &configLock, builder](JobSystem&, JobSystem::Job*) {
-            Config config;
-            {
-                std::lock_guard<utils::Mutex> lock(configLock);
-                config = c;
-            }
-            half4* UTILS_RESTRICT p = (half4*) data + b * config.lutDimension * config.lutDimension;
-            for (size_t g = 0; g < config.lutDimension; g++) {
-                for (size_t r = 0; r < config.lutDimension; r++) {
-                    float3 v = float3{r, g, b} * (1.0f / float(config.lutDimension - 1u));
+        // ASC CDL
+        v = colorDecisionList(v, p.slope, p.offset, p.power);
 
-                    // LogC encoding
-                    v = LogC_to_linear(v);
+        // Contrast in log space
+        v = contrast(v, p.contrast);
 
-                    // Kill negative values near 0.0f due to imprecision in the log conversion
-                    v = max(v, 0.0f);
+        // Back to linear space
+        v = LogC_to_linear(v);
 
-                    if (builder->hasAdjustments) {
-                        // Exposure
-                        v = adjustExposure(v, builder->exposure);
+        // Vibrance in linear space
+        v = vibrance(v, luminance, p.vibrance);
 
-                        // Purkinje shift ("low-light" vision)
-                        v = scotopicAdaptation(v, builder->nightAdaptation);
-                    }
+        // Saturation in linear space
+        v = saturation(v, luminance, p.saturation);
 
-                    // Move to color grading color space
-                    v = c.colorGradingIn * v;
+        // Kill negative values before curves
+        v = max(v, 0.0f);
 
-                    if (builder->hasAdjustments) {
-                        // White balance
-                        v = chromaticAdaptation(v, config.adaptationTransform);
+        // RGB curves
+        out[i] = curves(v, p.shadowGamma, p.midPoint, p.highlightScale);
+    }
+}
 
-                        // Kill negative values before the next transforms
-                        v = max(v, 0.0f);
+static void generateOutputSlice(Config const& config,
+        float3 const* UTILS_RESTRICT in, half4* UTILS_RESTRICT out, size_t count) noexcept {
+    for (size_t i = 0; i < count; i++) {
+        float3 v = in[i];
 
-                        // Channel mixer
-                        v = channelMixer(v, builder->outRed, builder->outGreen, builder->outBlue);
+        // Tone mapping
+        if (config.luminanceScaling) {
+            v = luminanceScaling(v, *config.toneMapper, config.input.luminance);
+        } else {
+            v = (*config.toneMapper)(v);
+        }
 
-                        // Shadows/mid-tones/highlights
-                        v = tonalRanges(v, c.colorGradingLuminance,
-                                builder->shadows, builder->midtones, builder->highlights,
-                                builder->tonalRanges);
+        // Go back to display color space
+        v = config.colorGradingOut * v;
 
-                        // The adjustments below behave better in log space
-                        v = linear_to_LogC(v);
+        // Apply gamut mapping
+        if (config.gamutMapping) {
+            // TODO: This should depend on the output color space
+            v = gamutMapping_sRGB(v);
+        }
 
-                        // ASC CDL
-                        v = colorDecisionList(v, builder->slope, builder->offset, builder->power);
+        // TODO: We should convert to the output color space if we use a working
+        //       color space that's not sRGB
+        // TODO: Allow the user to customize the output color space
 
-                        // Contrast in log space
-                        v = contrast(v, builder->contrast);
+        // We need to clamp for the output transfer function
+        v = saturate(v);
 
-                        // Back to linear space
-                        v = LogC_to_linear(v);
+        // Apply OETF
+        v = config.oetf(v);
 
-                        // Vibrance in linear space
-                        v = vibrance(v, c.colorGradingLuminance, builder->vibrance);
+        out[i] = half4{ v, 0.0f };
+    }
+}
 
-                        // Saturation in linear space
-                        v = saturation(v, c.colorGradingLuminance, builder->saturation);
+InputParameters FColorGrading::getInputParameters(const Builder& builder) noexcept {
+    return {
+            .dimension           = builder->dimension,
+            .hasAdjustments      = builder->hasAdjustments,
+            .exposure            = builder->exposure,
+            .nightAdaptation     = builder->nightAdaptation,
+            .colorGradingIn      = selectColorGradingTransformIn(builder->toneMapping),
+            .luminance           = selectColorGradingLuminance(builder->toneMapping),
+            .adaptationTransform = adaptationTransform(builder->whiteBalance),
+            .outRed              = builder->outRed,
+            .outGreen            = builder->outGreen,
+            .outBlue             = builder->outBlue,
+            .shadows             = builder->shadows,
+            .midtones            = builder->midtones,
+            .highlights          = builder->highlights,
+            .tonalRanges         = builder->tonalRanges,
+    };
+}
 
-                        // Kill negative values before curves
-                        v = max(v, 0.0f);
+GradingParameters FColorGrading::getGradingParameters(const Builder& builder) noexcept {
+    return {
+            .slope          = builder->slope,
+            .offset         = builder->offset,
+            .power          = builder->power,
+            .contrast       = builder->contrast,
+            .vibrance       = builder->vibrance,
+            .saturation     = builder->saturation,
+            .shadowGamma    = builder->shadowGamma,
+            .midPoint       = builder->midPoint,
+            .highlightScale = builder->highlightScale,
+    };
+}
 
-                        // RGB curves
-                        v = curves(v,
-                                builder->shadowGamma, builder->midPoint, builder->highlightScale);
-                    }
+bool FColorGrading::getLutKey(const Builder& builder, LutKey* key) noexcept {
+    if (!builder->toneMapper) {
+        return false;
+    }
+    ToneMapper::Key const toneMapper = builder->toneMapper->getKey();
+    *key = {
+            .input = getInputParameters(builder),
+            .grading = getGradingParameters(builder),
+            .output = {
+                    .format           = uint32_t(builder->format),
+                    .luminanceScaling = builder->luminanceScaling,
+                    .gamutMapping     = builder->gamutMapping,
+                    .linearOutput     = builder->outputColorSpace.getTransferFunction() == Linear,
+                    .colorGradingOut  = selectColorGradingTransformOut(builder->toneMapping),
+                    .toneMapperType   = toneMapper.type,
+            },
+    };
+    std::copy(std::begin(toneMapper.parameters), std::end(toneMapper.parameters),
+            key->output.toneMapperParameters);
+    return toneMapper.type != 0;
+}
 
-                    // Tone mapping
-                    if (builder->luminanceScaling) {
-                        v = luminanceScaling(v, *builder->toneMapper, c.colorGradingLuminance);
-                    } else {
-                        v = (*builder->toneMapper)(v);
-                    }
+// Returns the data of the LUT of the given key and makes it the most recently used, or null
+static std::vector<uint8_t> const* findLut(LutCache& cache, LutKey const& key) noexcept {
+    auto& entries = cache.entries;
+    auto const pos = std::find_if(entries.begin(), entries.end(),
+            [&key](LutCache::Entry const& entry) { return isSameStage(entry.key, key); });
+    if (pos == entries.end()) {
+        return nullptr;
+    }
+    std::rotate(pos, pos + 1, entries.end());
+    return &entries.back().data;
+}
 
-                    // Go back to display color space
-                    v = c.colorGradingOut * v;
+static void addLut(LutCache& cache, LutKey const& key, void const* data, size_t size) noexcept {
+    auto& entries = cache.entries;
+    if (entries.size() == LutCache::CAPACITY) {
+        entries.erase(entries.begin());
+    }
+    auto const* const bytes = static_cast<uint8_t const*>(data);
+    entries.push_back({ key, { bytes, bytes + size } });
+}
 
-                    // Apply gamut mapping
-                    if (builder->gamutMapping) {
-                        // TODO: This should depend on the output color space
-                        v = gamutMapping_sRGB(v);
-                    }
+// Inside generateLut(), TSAN sporadically detects a data race on the config struct; the Filament
+// thread writes and the Job thread reads. In practice there should be no data race, so we force
+// TSAN off to silence the warning.
+UTILS_NO_SANITIZE_THREAD
+void FColorGrading::generateLut(JobSystem& js, const Builder& builder, StageCache* cache,
+        half4* data, uint32_t* converted) noexcept {
+    Config c;
+    // This lock protects the data inside Config, which is written to by the Filament thread,
+    // and read from multiple Job threads.
+    utils::Mutex configLock;
+    {
+        std::lock_guard<utils::Mutex> const lock(configLock);
+        c.lutDimension          = builder->dimension;
+        c.colorGradingOut       = selectColorGradingTransformOut(builder->toneMapping);
+        c.toneMapper            = builder->toneMapper;
+        c.luminanceScaling      = builder->luminanceScaling;
+        c.gamutMapping          = builder->gamutMapping;
+        c.oetf                  = selectOETF(builder->outputColorSpace);
 
-                    // TODO: We should convert to the output color space if we use a working
-                    //       color space that's not sRGB
-                    // TODO: Allow the user to customize the output color space
+        c.input                 = getInputParameters(builder);
+        c.grading               = getGradingParameters(builder);
+
+        assert_invariant(c.lutDimension <= c.linear.size());
+        for (size_t i = 0; i < c.lutDimension; i++) {
+            float3 const v{ float(i) * (1.0f / float(c.lutDimension - 1u)) };
+            // Kill negative values near 0.0f due to imprecision in the log conversion
+            c.linear[i] = max(LogC_to_linear(v), 0.0f).x;
+            for (size_t axis = 0; axis < 3; axis++) {
+                c.axes[axis][i] = c.input.colorGradingIn[axis] * c.linear[i];
+            }
+        }
+    }
 
-                    // We need to clamp for the output transfer function
-                    v = saturate(v);
+    size_t const lutElementCount = c.lutDimension * c.lutDimension * c.lutDimension;
 
-                    // Apply OETF
-                    v = c.oetf(v);
+    // Find out which stages can be reused from the previous LUT, without a cache they are all
+    // computed in temporary buffers
+    StageCache uncached;
+    StageCache& stages = cache ? *cache : uncached;
+    {
+        std::lock_guard<utils::Mutex> const lock(configLock);
+        c.inputCached = !stages.inputData.empty() && isSameStage(stages.input, c.input);
+        c.gradingCached = c.inputCached && !stages.gradingData.empty() &&
+                isSameStage(stages.grading, c.grading);
+        if (!c.inputCached) {
+            stages.input = c.input;
+            stages.inputData.resize(lutElementCount);
+            stages.gradingData.clear();
+        }
+        if (c.input.hasAdjustments && !c.gradingCached) {
+            stages.grading = c.grading;
+            stages.gradingData.resize(lutElementCount);
+        }
+        c.inputData = stages.inputData.data();
+        c.gradingData = c.input.hasAdjustments ? stages.gradingData.data() : nullptr;
+    }
 
-                    *p++ = half4{v, 0.0f};
+    // Multithreadedly generate the tone mapping 3D look-up table using 32 jobs
+    // Slices are 8 KiB (128 cache lines) apart.
+    // This takes about 3-6ms on Android in Release
+    auto *slices = js.createJob();
+    for (size_t b = 0; b < c.lutDimension; b++) {
+        auto *job = js.createJob(slices,
+                [data, converted, b, &c, &configLock](JobSystem&, JobSystem::Job*) {
+            Config config;
+            {
+                std::lock_guard<utils::Mutex> lock(configLock);
+                config = c;
+            }
+            const size_t sliceSize = config.lutDimension * config.lutDimension;
+
+            float3* const input = config.inputData + b * sliceSize;
+            if (!config.inputCached) {
+                generateInputSlice(config, b, input);
+            }
+
+            float3 const* graded = input;
+            if (config.gradingData) {
+                float3* const grading = config.gradingData + b * sliceSize;
+                if (!config.gradingCached) {
+                    generateGradingSlice(config.grading, config.input.luminance,
+                            input, grading, sliceSize);
                 }
+                graded = grading;
             }
 
+            generateOutputSlice(config, graded, data + b * sliceSize, sliceSize);
+
             if (converted) {
-                uint32_t* const UTILS_RESTRICT dst = (uint32_t*) converted +
-                        b * config.lutDimension * config.lutDimension;
-                half4* UTILS_RESTRICT src = (half4*) data +
-                        b * config.lutDimension * config.lutDimension;
+                uint32_t* const UTILS_RESTRICT dst = converted + b * sliceSize;
+                half4* UTILS_RESTRICT src = data + b * sliceSize;
                 // we use a vectorize width of 8 because, on ARMv8 it allows the compiler to write eight
                 // 32-bits results in one go.
-                const size_t count = (config.lutDimension * config.lutDimension) & ~0x7u; // tell the compiler that we're a multiple of 8
+                const size_t count = sliceSize & ~0x7u; // tell the compiler that we're a multiple of 8
                 #pragma clang loop vectorize_width(8)
                 for (size_t i = 0; i < count; ++i) {
                     float4 v{src[i]};
@@ -809,6 +979,49 @@ FColorGrading::FColorGrading(FEngine& engine, const Builder& builder) {
     // TODO: Should we do a runAndRetain() and defer the wait() + texture creation until
     //       getHwHandle() is invoked?
     js.runAndWait(slices);
+}
+
+FColorGrading::FColorGrading(FEngine& engine, const Builder& builder) {
+    SYSTRACE_CALL();
+
+    DriverApi& driver = engine.getDriverApi();
+
+    mDimension = builder->dimension;
+
+    size_t lutElementCount = mDimension * mDimension * mDimension;
+
+    auto [textureFormat, format, type] = selectLutTextureParams(builder->format);
+    assert_invariant(FTexture::isTextureFormatSupported(engine, textureFormat));
+    assert_invariant(FTexture::validatePixelFormatAndType(textureFormat, format, type));
+
+    // convert input to UINT_2_10_10_10_REV if needed
+    bool const convert = type == PixelDataType::UINT_2_10_10_10_REV;
+    size_t const elementSize = convert ? sizeof(uint32_t) : sizeof(half4);
+    size_t const size = lutElementCount * elementSize;
+    void* const data = malloc(size);
+
+    //auto now = std::chrono::steady_clock::now();
+
+    LutKey key;
+    LutCache& lutCache = engine.getColorGradingLutCache();
+    bool const cacheable = getLutKey(builder, &key);
+    std::vector<uint8_t> const* const cached = cacheable ? findLut(lutCache, key) : nullptr;
+    if (cached) {
+        assert_invariant(cached->size() == size);
+        memcpy(data, cached->data(), size);
+    } else {
+        void* const lut = convert ? malloc(lutElementCount * sizeof(half4)) : data;
+        StageCache& cache = engine.getColorGradingStageCache();
+        generateLut(engine.getJobSystem(), builder, &cache,
+                (half4*) lut, convert ? (uint32_t*) data : nullptr);
+        cache.owner = this;
+        if (convert) {
+            free(lut);
+        }
+        if (cacheable) {
+            addLut(lutCache, key, data, size);
+        }
+    }
 
     //std::chrono::duration<float, std::milli> duration = std::chrono::steady_clock::now() - now;
     //slog.d << "LUT generation time: " << duration.count() << " ms" << io::endl;
@@ -818,23 +1031,17 @@ FColorGrading::FColorGrading(FEngine& engine, const Builder& builder) {
             1,
             textureFormat,
             1,
-            c.lutDimension,
-            c.lutDimension,
-            c.lutDimension,
+            mDimension,
+            mDimension,
+            mDimension,
             TextureUsage::DEFAULT
     );
 
-    if (converted) {
-        free(data);
-        data = converted;
-        elementSize = sizeof(uint32_t);
-    }
-
     driver.update3DImage(mLutHandle, 0,
             0, 0, 0,
-            c.lutDimension, c.lutDimension, c.lutDimension,
+            mDimension, mDimension, mDimension,
             PixelBufferDescriptor{
-                    data, lutElementCount * elementSize,format, type,
+                    data, size, format, type,
                     [](void* buffer, size_t, void*) { free(buffer); }
             }
     );
@@ -845,6 +1052,12 @@ FColorGrading::~FColorGrading() noexcept = default;
 void FColorGrading::terminate(FEngine& engine) {
     DriverApi& driver = engine.getDriverApi();
     driver.destroyTexture(mLutHandle);
+
+    // the stages are only kept as long as the ColorGrading that computed them last
+    StageCache& cache = engine.getColorGradingStageCache();
+    if (cache.owner == this) {
+        cache = {};
+    }
 }
 
 } //namespace filament
@@ -24,7 +24,17 @@
 
 #include <filament/ColorGrading.h>
 
-#include <math/mathfwd.h>
+#include <math/mat3.h>
+#include <math/vec3.h>
+#include <math/vec4.h>
+
+#include <vector>
+
+#include <stdint.h>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
 
 namespace filament {
 
@@ -32,6 +42,88 @@ class FEngine;
 
 class FColorGrading : public ColorGrading {
 public:
+    // Parameters of the stages of the LUT generation that precede tone mapping, see
+    // ColorGrading.cpp. They only contain 32-bit fields so they can be compared bitwise.
+    struct InputParameters {
+        uint32_t dimension;
+        uint32_t hasAdjustments;
+        float exposure;
+        float nightAdaptation;
+        math::mat3f colorGradingIn;
+        math::float3 luminance;
+        math::mat3f adaptationTransform;
+        math::float3 outRed;
+        math::float3 outGreen;
+        math::float3 outBlue;
+        math::float3 shadows;
+        math::float3 midtones;
+        math::float3 highlights;
+        math::float4 tonalRanges;
+    };
+
+    struct GradingParameters {
+        math::float3 slope;
+        math::float3 offset;
+        math::float3 power;
+        float contrast;
+        float vibrance;
+        float saturation;
+        math::float3 shadowGamma;
+        math::float3 midPoint;
+        math::float3 highlightScale;
+    };
+
+    // Parameters of the output stage: tone mapping, gamut mapping and the OETF
+    struct OutputParameters {
+        uint32_t format;
+        uint32_t luminanceScaling;
+        uint32_t gamutMapping;
+        uint32_t linearOutput;
+        math::mat3f colorGradingOut;
+        uint32_t toneMapperType;
+        float toneMapperParameters[4];
+    };
+
+    struct LutKey {
+        InputParameters input;
+        GradingParameters grading;
+        OutputParameters output;
+    };
+
+    // The engine also keeps the last few LUTs, as uploaded to the GPU, keyed by all their
+    // parameters, so a ColorGrading identical to a recent one doesn't compute anything. This
+    // happens when an app re-creates the same ColorGrading, or when an editor undoes a change.
+    // LUTs made with a tone mapper without a key (see ToneMapper::getKey()) are never kept.
+    // The cache lives as long as the engine and holds up to 4 LUTs, at most 8 MiB.
+    struct LutCache {
+        static constexpr size_t CAPACITY = 4;
+        struct Entry {
+            LutKey key;
+            std::vector<uint8_t> data;
+        };
+        std::vector<Entry> entries;     // the most recently used is last
+    };
+
+    // The engine keeps the outputs of the last LUT generation for each stage preceding tone
+    // mapping, so that the next LUT only recomputes the stages whose parameters changed, e.g.
+    // when a slider of an editor changes the contrast or the tone mapper. The outputs take up to
+    // a few MiB, they are released along with the ColorGrading that computed them.
+    struct StageCache {
+        InputParameters input{};
+        GradingParameters grading{};
+        std::vector<math::float3> inputData;      // empty if invalid
+        std::vector<math::float3> gradingData;    // empty if invalid
+        FColorGrading const* owner = nullptr;
+    };
+
+    // Generates the LUT described by builder in data, and its RGB10_A2 version in converted if
+    // not null. The stages found in cache are reused and cache is updated, it can be null.
+    static void generateLut(utils::JobSystem& js, const Builder& builder, StageCache* cache,
+            math::half4* data, uint32_t* converted) noexcept;
+
+    // Returns the key of the LUT described by builder, and whether it can be cached
+    static bool getLutKey(const Builder& builder, LutKey* key) noexcept;
+
     FColorGrading(FEngine& engine, const Builder& builder);
     FColorGrading(const FColorGrading& rhs) = delete;
     FColorGrading& operator=(const FColorGrading& rhs) = delete;
@@ -46,6 +138,9 @@ public:
     uint32_t getDimension() const noexcept { return mDimension; }
 
 private:
+    static InputParameters getInputParameters(const Builder& builder) noexcept;
+    static GradingParameters getGradingParameters(const Builder& builder) noexcept;
+
     backend::TextureHandle mLutHandle;
     uint32_t mDimension;
 };
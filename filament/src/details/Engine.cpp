@@ -16,6 +16,7 @@
 
 #include "details/Engine.h"
 
+#include "InstanceCuller.h"
 #include "MaterialParser.h"
 #include "ResourceAllocator.h"
 #include "RenderPrimitive.h"
@@ -109,6 +110,7 @@ Engine* FEngine::create(Engine::Builder const& builder) {
                 .forceGLES2Context = instance->getConfig().forceGLES2Context,
                 .stereoscopicType = instance->getConfig().stereoscopicType,
                 .assertNativeWindowIsValid = instance->getConfig().assertNativeWindowIsValid,
+                .readbackBufferCount = instance->getConfig().readbackBufferCount,
         };
         instance->mDriver = platform->createDriver(sharedContext, driverConfig);
 
@@ -208,7 +210,8 @@ FEngine::FEngine(Engine::Builder const& builder) :
         mCommandBufferQueue(
                 builder->mConfig.minCommandBufferSizeMB * MiB,
                 builder->mConfig.commandBufferSizeMB * MiB,
-                builder->mPaused),
+                builder->mPaused,
+                builder->mConfig.maxCommandBufferSizeMB * MiB),
         mPerRenderPassArena(
                 "FEngine::mPerRenderPassAllocator",
                 builder->mConfig.perRenderPassArenaSizeMB * MiB),
@@ -253,6 +256,12 @@ void FEngine::init() {
 
     DriverApi& driverApi = getDriverApi();
 
+    if (UTILS_UNLIKELY(mConfig.commandStreamCapturePreamble)) {
+        mCommandStreamResources = std::make_unique<CommandStreamCapture>(
+                CommandStreamCapture::Mode::RESOURCES);
+        driverApi.setCapture(mCommandStreamResources.get());
+    }
+
     mActiveFeatureLevel = std::min(mActiveFeatureLevel, driverApi.getFeatureLevel());
 
 #ifndef FILAMENT_ENABLE_FEATURE_LEVEL_0
@@ -262,6 +271,9 @@ void FEngine::init() {
     slog.i << "Backend feature level: " << int(driverApi.getFeatureLevel()) << io::endl;
     slog.i << "FEngine feature level: " << int(mActiveFeatureLevel) << io::endl;
 
+    // feature level 0 backends emulate uniform buffers and can't bind them at an offset
+    mUniformBufferArena.setSuballocationEnabled(
+            driverApi.getFeatureLevel() > FeatureLevel::FEATURE_LEVEL_0);
 
     mResourceAllocatorDisposer = std::make_shared<ResourceAllocatorDisposer>(driverApi);
 
@@ -489,6 +501,10 @@ void FEngine::shutdown() {
     mPerViewDescriptorSetLayoutDepthVariant.terminate(mHwDescriptorSetLayoutFactory, driver);
     mPerViewDescriptorSetLayoutSsrVariant.terminate(mHwDescriptorSetLayoutFactory, driver);
     mPerRenderableDescriptorSetLayout.terminate(mHwDescriptorSetLayoutFactory, driver);
+    mInstanceCullingDescriptorSetLayout.terminate(mHwDescriptorSetLayoutFactory, driver);
+    if (mInstanceCullingProgram) {
+        driver.destroyProgram(mInstanceCullingProgram);
+    }
 
     driver.destroyRenderPrimitive(mFullScreenTriangleRph);
 
@@ -532,6 +548,7 @@ void FEngine::shutdown() {
     for (auto& item : mMaterialInstances) {
         cleanupResourceList(std::move(item.second));
     }
+    mUniformBufferArena.terminate(driver);
 
     cleanupResourceListLocked(mFenceListLock, std::move(mFences));
 
@@ -566,6 +583,8 @@ void FEngine::shutdown() {
     getDriver().purge();
 
     // and destroy the CommandStream
+    getDriverApi().setCapture(nullptr);
+    mCommandStreamResources.reset();
     std::destroy_at(std::launder(reinterpret_cast<DriverApi*>(&mDriverApiStorage)));
 
     /*
@@ -579,15 +598,23 @@ void FEngine::shutdown() {
 void FEngine::prepare() {
     SYSTRACE_CALL();
     // prepare() is called once per Renderer frame. Ideally we would upload the content of
-    // UBOs that are visible only. It's not such a big issue because the actual upload() is
-    // skipped if the UBO hasn't changed. Still we could have a lot of these.
+    // UBOs that are visible only. We only commit the material instances that changed since the
+    // last frame, and the ones that refer to textures whose handle can change. Their uniforms
+    // are uploaded together by the arena.
     FEngine::DriverApi& driver = getDriverApi();
 
-    for (auto& materialInstanceList: mMaterialInstances) {
-        materialInstanceList.second.forEach([&driver](FMaterialInstance* item) {
-            item->commit(driver);
-        });
+    size_t count = 0;
+    for (FMaterialInstance* const item : mDirtyMaterialInstances) {
+        item->commit(driver, mUniformBufferArena);
+        if (UTILS_UNLIKELY(item->needsCommitEveryFrame())) {
+            item->mDirtyListIndex = uint32_t(count);
+            mDirtyMaterialInstances[count++] = item;
+        } else {
+            item->mDirtyListIndex = FMaterialInstance::NOT_DIRTY;
+        }
     }
+    mDirtyMaterialInstances.resize(count);
+    mUniformBufferArena.commit(driver);
 
     mMaterials.forEach([](FMaterial* material) {
 #if FILAMENT_ENABLE_MATDBG
@@ -596,6 +623,25 @@ void FEngine::prepare() {
     });
 }
 
+void FEngine::addDirtyMaterialInstance(FMaterialInstance* p) noexcept {
+    assert_invariant(p->mDirtyListIndex == FMaterialInstance::NOT_DIRTY);
+    p->mDirtyListIndex = uint32_t(mDirtyMaterialInstances.size());
+    mDirtyMaterialInstances.push_back(p);
+}
+
+void FEngine::removeDirtyMaterialInstance(FMaterialInstance* p) noexcept {
+    uint32_t const index = p->mDirtyListIndex;
+    if (index != FMaterialInstance::NOT_DIRTY) {
+        // the order of the list doesn't matter, move the last instance in place of this one
+        assert_invariant(mDirtyMaterialInstances[index] == p);
+        FMaterialInstance* const last = mDirtyMaterialInstances.back();
+        mDirtyMaterialInstances[index] = last;
+        last->mDirtyListIndex = index;
+        mDirtyMaterialInstances.pop_back();
+        p->mDirtyListIndex = FMaterialInstance::NOT_DIRTY;
+    }
+}
+
 void FEngine::gc() {
     // Note: this runs in a Job
     auto& em = mEntityManager;
@@ -707,6 +753,7 @@ int FEngine::loop() {
             .forceGLES2Context = mConfig.forceGLES2Context,
             .stereoscopicType =  mConfig.stereoscopicType,
             .assertNativeWindowIsValid = mConfig.assertNativeWindowIsValid,
+            .readbackBufferCount = mConfig.readbackBufferCount,
     };
     mDriver = mPlatform->createDriver(mSharedGLContext, driverConfig);
 
@@ -733,6 +780,18 @@ void FEngine::flushCommandBuffer(CommandBufferQueue& commandQueue) {
     commandQueue.flush();
 }
 
+void FEngine::endCommandBufferFrame() {
+    CommandBufferQueue::Statistics const stats = mCommandBufferQueue.endFrame();
+    mCommandBufferStatistics = {
+            .bytesRecorded = stats.bytesRecorded,
+            .blockedTime = stats.blocked.count(),
+            .blockedCount = stats.blockedCount,
+            .queueDepth = stats.queueDepth,
+            .highWatermark = stats.highWatermark,
+            .bufferSize = stats.bufferSize,
+    };
+}
+
 const FMaterial* FEngine::getSkyboxMaterial() const noexcept {
     FMaterial const* material = mSkyboxMaterial;
     if (UTILS_UNLIKELY(material == nullptr)) {
@@ -742,6 +801,23 @@ const FMaterial* FEngine::getSkyboxMaterial() const noexcept {
     return material;
 }
 
+backend::ProgramHandle FEngine::getInstanceCullingProgram() noexcept {
+    if (UTILS_UNLIKELY(!mInstanceCullingProgram)) {
+        mInstanceCullingProgram = InstanceCuller::createProgram(*this);
+    }
+    return mInstanceCullingProgram;
+}
+
+filament::DescriptorSetLayout const& FEngine::getInstanceCullingDescriptorSetLayout() noexcept {
+    if (UTILS_UNLIKELY(!mInstanceCullingDescriptorSetLayout.getHandle())) {
+        mInstanceCullingDescriptorSetLayout = {
+                mHwDescriptorSetLayoutFactory,
+                getDriverApi(),
+                InstanceCuller::getDescriptorSetLayout() };
+    }
+    return mInstanceCullingDescriptorSetLayout;
+}
+
 // -----------------------------------------------------------------------------------------------
 // Resource management
 // -----------------------------------------------------------------------------------------------
@@ -1389,6 +1465,11 @@ Engine::Config Engine::BuilderDetails::validateConfig(Config config) noexcept {
             config.commandBufferSizeMB,
             config.minCommandBufferSizeMB * CONCURRENT_FRAME_COUNT);
 
+    // The command buffer can't shrink
+    if (config.maxCommandBufferSizeMB < config.commandBufferSizeMB) {
+        config.maxCommandBufferSizeMB = 0;
+    }
+
     // Enforce pre-render-pass arena rule-of-thumb
     config.perRenderPassArenaSizeMB = std::max(
             config.perRenderPassArenaSizeMB,
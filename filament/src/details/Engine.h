@@ -23,6 +23,7 @@
 #include "DFG.h"
 #include "PostProcessManager.h"
 #include "ResourceList.h"
+#include "UniformBufferArena.h"
 #include "HwDescriptorSetLayoutFactory.h"
 #include "HwVertexBufferInfoFactory.h"
 
@@ -75,6 +76,7 @@
 #include <thread>
 #include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 #if FILAMENT_ENABLE_MATDBG
 #include <matdbg/DebugServer.h>
@@ -139,6 +141,11 @@ public:
 
     backend::ShaderModel getShaderModel() const noexcept { return getDriver().getShaderModel(); }
 
+    // this must only be called from the backend thread (e.g. from DriverApi::queueCommand())
+    backend::StateChangeStatistics getStateChangeStatistics() const noexcept {
+        return getDriver().getStateChangeStatistics();
+    }
+
     DriverApi& getDriverApi() noexcept {
         return *std::launder(reinterpret_cast<DriverApi*>(&mDriverApiStorage));
     }
@@ -384,6 +391,15 @@ public:
     // flush the current buffer
     void flush();
 
+    // Marks the end of a frame for the command buffer, must be called after flush(). This
+    // latches the statistics returned by getCommandBufferStatistics() and may grow the command
+    // buffer.
+    void endCommandBufferFrame();
+
+    CommandBufferStatistics getCommandBufferStatistics() const noexcept {
+        return mCommandBufferStatistics;
+    }
+
     // flush the current buffer based on some heuristics
     void flushIfNeeded() {
         auto counter = mFlushCounter + 1;
@@ -406,6 +422,11 @@ public:
     void prepare();
     void gc();
 
+    // Material instances are added to this list when they change, and prepare() only commits
+    // the instances in the list.
+    void addDirtyMaterialInstance(FMaterialInstance* p) noexcept;
+    void removeDirtyMaterialInstance(FMaterialInstance* p) noexcept;
+
     using ShaderContent = utils::FixedCapacityVector<uint8_t>;
 
     ShaderContent& getVertexShaderContent() const noexcept {
@@ -426,6 +447,18 @@ public:
         return mJobSystem;
     }
 
+    FColorGrading::StageCache& getColorGradingStageCache() noexcept {
+        return mColorGradingStageCache;
+    }
+
+    FColorGrading::LutCache& getColorGradingLutCache() noexcept {
+        return mColorGradingLutCache;
+    }
+
+    UniformBufferArena& getUniformBufferArena() noexcept {
+        return mUniformBufferArena;
+    }
+
     std::default_random_engine& getRandomEngine() {
         return mRandomEngine;
     }
@@ -447,6 +480,17 @@ public:
         return mAutomaticInstancingEnabled;
     }
 
+    void setMultiDrawIndirectEnabled(bool enable) noexcept {
+        // multi-draw-indirect is only allowed if the backend supports it
+        if (getDriverApi().isMultiDrawIndirectSupported()) {
+            mMultiDrawIndirectEnabled = enable;
+        }
+    }
+
+    bool isMultiDrawIndirectEnabled() const noexcept {
+        return mMultiDrawIndirectEnabled;
+    }
+
     HwVertexBufferInfoFactory& getVertexBufferInfoFactory() noexcept {
         return mHwVertexBufferInfoFactory;
     }
@@ -467,6 +511,11 @@ public:
         return mPerRenderableDescriptorSetLayout;
     }
 
+    // compute program of the GPU instance culling and its descriptor-set layout, they're created
+    // the first time they're needed, see InstanceCuller
+    backend::ProgramHandle getInstanceCullingProgram() noexcept;
+    DescriptorSetLayout const& getInstanceCullingDescriptorSetLayout() noexcept;
+
     backend::Handle<backend::HwTexture> getOneTexture() const { return mDummyOneTexture; }
     backend::Handle<backend::HwTexture> getZeroTexture() const { return mDummyZeroTexture; }
     backend::Handle<backend::HwTexture> getOneTextureArray() const { return mDummyOneTextureArray; }
@@ -521,6 +570,7 @@ private:
     Platform* mPlatform = nullptr;
     bool mOwnPlatform = false;
     bool mAutomaticInstancingEnabled = false;
+    bool mMultiDrawIndirectEnabled = false;
     void* mSharedGLContext = nullptr;
     backend::Handle<backend::HwRenderPrimitive> mFullScreenTriangleRph;
     FVertexBuffer* mFullScreenTriangleVb = nullptr;
@@ -540,6 +590,8 @@ private:
     DescriptorSetLayout mPerViewDescriptorSetLayoutDepthVariant;
     DescriptorSetLayout mPerViewDescriptorSetLayoutSsrVariant;
     DescriptorSetLayout mPerRenderableDescriptorSetLayout;
+    DescriptorSetLayout mInstanceCullingDescriptorSetLayout;
+    backend::ProgramHandle mInstanceCullingProgram;
 
     ResourceList<FBufferObject> mBufferObjects{ "BufferObject" };
     ResourceList<FRenderer> mRenderers{ "Renderer" };
@@ -567,13 +619,17 @@ private:
 
     // FMaterialInstance are handled directly by FMaterial
     std::unordered_map<const FMaterial*, ResourceList<FMaterialInstance>> mMaterialInstances;
+    std::vector<FMaterialInstance*> mDirtyMaterialInstances;
 
     DFG mDFG;
 
     std::thread mDriverThread;
     backend::CommandBufferQueue mCommandBufferQueue;
+    CommandBufferStatistics mCommandBufferStatistics{};
     std::aligned_storage<sizeof(DriverApi), alignof(DriverApi)>::type mDriverApiStorage;
     static_assert( sizeof(mDriverApiStorage) >= sizeof(DriverApi) );
+    // commands that created the live backend resources, see Config::commandStreamCapturePreamble
+    std::unique_ptr<backend::CommandStreamCapture> mCommandStreamResources;
 
     uint32_t mFlushCounter = 0;
 
@@ -595,6 +651,9 @@ private:
     mutable FIndirectLight* mDefaultIbl = nullptr;
 
     mutable FColorGrading* mDefaultColorGrading = nullptr;
+    FColorGrading::StageCache mColorGradingStageCache;
+    FColorGrading::LutCache mColorGradingLutCache;
+    UniformBufferArena mUniformBufferArena;
     FMorphTargetBuffer* mDummyMorphTargetBuffer = nullptr;
 
     mutable utils::CountDownLatch mDriverBarrier;
@@ -649,8 +708,13 @@ public:
             // When set to true, the backend will attempt to capture the next frame and write the
             // capture to file. At the moment, only supported by the Metal backend.
             bool doFrameCapture = false;
+            // When set to true, the commands of the next frame are recorded and written to
+            // "filament-frame-<id>.fcs", which can be replayed with the cmdreplay tool.
+            bool doCommandStreamCapture = false;
             bool disable_buffer_padding = false;
             bool disable_subpasses = false;
+            // cull the instances of InstanceBuffers on the CPU even when compute is available
+            bool disable_gpu_instance_culling = false;
         } renderer;
         struct {
             bool debug_froxel_visualization = false;
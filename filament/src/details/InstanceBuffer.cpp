@@ -31,6 +31,8 @@ using namespace backend;
 struct InstanceBuffer::BuilderDetails {
     size_t mInstanceCount = 0;
     math::mat4f const* mLocalTransforms = nullptr;
+    Box mCullingBox{};
+    bool mCulling = false;
 };
 
 using BuilderType = InstanceBuffer;
@@ -50,6 +52,12 @@ InstanceBuffer::Builder& InstanceBuffer::Builder::localTransforms(
     return *this;
 }
 
+InstanceBuffer::Builder& InstanceBuffer::Builder::culling(Box const& boundingBox) noexcept {
+    mImpl->mCullingBox = boundingBox;
+    mImpl->mCulling = true;
+    return *this;
+}
+
 InstanceBuffer* InstanceBuffer::Builder::build(Engine& engine) {
     FILAMENT_CHECK_PRECONDITION(mImpl->mInstanceCount >= 1) << "instanceCount must be >= 1.";
     FILAMENT_CHECK_PRECONDITION(mImpl->mInstanceCount <= engine.getMaxAutomaticInstances())
@@ -62,7 +70,9 @@ InstanceBuffer* InstanceBuffer::Builder::build(Engine& engine) {
 // ------------------------------------------------------------------------------------------------
 
 FInstanceBuffer::FInstanceBuffer(FEngine& engine, const Builder& builder)
-    : mName(builder.getName()) {
+    : mName(builder.getName()),
+      mCullingBox(builder->mCullingBox),
+      mCulling(builder->mCulling) {
     mInstanceCount = builder->mInstanceCount;
 
     mLocalTransforms.reserve(mInstanceCount);
@@ -92,12 +102,7 @@ void FInstanceBuffer::prepare(FEngine& engine, math::mat4f rootTransform,
     PerRenderableData* stagingBuffer = (PerRenderableData*)::malloc(stagingBufferSize);
     // TODO: consider using JobSystem to parallelize this.
     for (size_t i = 0, c = mInstanceCount; i < c; i++) {
-        stagingBuffer[i] = ubo;
-        math::mat4f model = rootTransform * mLocalTransforms[i];
-        stagingBuffer[i].worldFromModelMatrix = model;
-
-        math::mat3f m = math::mat3f::getTransformForNormals(model.upperLeft());
-        stagingBuffer[i].worldFromModelNormalMatrix = math::prescaleForNormals(m);
+        setInstanceData(stagingBuffer[i], ubo, rootTransform * mLocalTransforms[i]);
     }
     driver.updateBufferObject(handle, {
             stagingBuffer, stagingBufferSize,
@@ -107,6 +112,41 @@ void FInstanceBuffer::prepare(FEngine& engine, math::mat4f rootTransform,
     }, 0);
 }
 
+void FInstanceBuffer::prepareVisible(FEngine& engine, math::mat4f rootTransform,
+        const PerRenderableData& ubo, Handle<HwBufferObject> handle,
+        uint32_t const* visible, size_t count) {
+    assert_invariant(mCulling);
+    assert_invariant(count <= mInstanceCount);
+    if (!count) {
+        // nothing is drawn
+        return;
+    }
+
+    DriverApi& driver = engine.getDriverApi();
+
+    uint32_t const stagingBufferSize = count * sizeof(PerRenderableData);
+    PerRenderableData* stagingBuffer = (PerRenderableData*)::malloc(stagingBufferSize);
+    for (size_t i = 0; i < count; i++) {
+        assert_invariant(visible[i] < mInstanceCount);
+        setInstanceData(stagingBuffer[i], ubo, rootTransform * mLocalTransforms[visible[i]]);
+    }
+    driver.updateBufferObject(handle, {
+            stagingBuffer, stagingBufferSize,
+            +[](void* buffer, size_t, void*) {
+                ::free(buffer);
+            }
+    }, sizeof(PerRenderableUib));
+}
+
+void FInstanceBuffer::setInstanceData(PerRenderableData& data, const PerRenderableData& ubo,
+        math::mat4f const& model) noexcept {
+    data = ubo;
+    data.worldFromModelMatrix = model;
+
+    math::mat3f m = math::mat3f::getTransformForNormals(model.upperLeft());
+    data.worldFromModelNormalMatrix = math::prescaleForNormals(m);
+}
+
 void FInstanceBuffer::terminate(FEngine& engine) {
 }
 
@@ -19,6 +19,7 @@
 
 #include "downcast.h"
 
+#include <filament/Box.h>
 #include <filament/InstanceBuffer.h>
 
 #include <backend/Handle.h>
@@ -44,17 +45,36 @@ public:
 
     void setLocalTransforms(math::mat4f const* localTransforms, size_t count, size_t offset);
 
+    math::mat4f const* getLocalTransforms() const noexcept { return mLocalTransforms.data(); }
+
+    // whether the instances are culled individually, see InstanceCuller
+    bool isCullingEnabled() const noexcept { return mCulling; }
+
+    // bounding box of an instance in its local space
+    Box const& getCullingBox() const noexcept { return mCullingBox; }
+
     void prepare(FEngine& engine, math::mat4f rootTransform, const PerRenderableData& ubo,
             backend::Handle<backend::HwBufferObject> handle);
 
+    // Uploads the data of the `count` instances listed in `visible`, packed after the data of
+    // all the instances, where the passes that draw the culled instances read it.
+    void prepareVisible(FEngine& engine, math::mat4f rootTransform, const PerRenderableData& ubo,
+            backend::Handle<backend::HwBufferObject> handle,
+            uint32_t const* visible, size_t count);
+
     utils::CString const& getName() const noexcept { return mName; }
 
 private:
     friend class RenderableManager;
 
+    static void setInstanceData(PerRenderableData& data, const PerRenderableData& ubo,
+            math::mat4f const& model) noexcept;
+
     utils::FixedCapacityVector<math::mat4f> mLocalTransforms;
     utils::CString mName;
     size_t mInstanceCount;
+    Box mCullingBox;
+    bool mCulling;
 };
 
 FILAMENT_DOWNCAST(InstanceBuffer)
@@ -72,13 +72,12 @@ FMaterialInstance::FMaterialInstance(FEngine& engine, FMaterial const* material)
 
     if (!material->getUniformInterfaceBlock().isEmpty()) {
         mUniforms = UniformBuffer(material->getUniformInterfaceBlock().getSize());
-        mUbHandle = driver.createBufferObject(mUniforms.getSize(),
-                BufferObjectBinding::UNIFORM, backend::BufferUsage::STATIC);
-        driver.setDebugTag(mUbHandle.getId(), material->getName());
+        mUbAllocation = engine.getUniformBufferArena().allocate(driver,
+                uint32_t(mUniforms.getSize()), material->getName().c_str_safe());
     }
 
     // set the UBO, always descriptor 0
-    mDescriptorSet.setBuffer(0, mUbHandle, 0, mUniforms.getSize());
+    mDescriptorSet.setBuffer(0, mUbAllocation.buffer, mUbAllocation.offset, mUniforms.getSize());
 
     const RasterState& rasterState = material->getRasterState();
     // At the moment, only MaterialInstances have a stencil state, but in the future it should be
@@ -111,6 +110,9 @@ FMaterialInstance::FMaterialInstance(FEngine& engine, FMaterial const* material)
     }
 
     setTransparencyMode(material->getTransparencyMode());
+
+    // the descriptor set needs to be committed at least once
+    invalidate();
 }
 
 FMaterialInstance::FMaterialInstance(FEngine& engine,
@@ -138,13 +140,12 @@ FMaterialInstance::FMaterialInstance(FEngine& engine,
 
     if (!material->getUniformInterfaceBlock().isEmpty()) {
         mUniforms.setUniforms(other->getUniformBuffer());
-        mUbHandle = driver.createBufferObject(mUniforms.getSize(),
-                BufferObjectBinding::UNIFORM, backend::BufferUsage::DYNAMIC);
-        driver.setDebugTag(mUbHandle.getId(), material->getName());
+        mUbAllocation = engine.getUniformBufferArena().allocate(driver,
+                uint32_t(mUniforms.getSize()), material->getName().c_str_safe());
     }
 
     // set the UBO, always descriptor 0
-    mDescriptorSet.setBuffer(0, mUbHandle, 0, mUniforms.getSize());
+    mDescriptorSet.setBuffer(0, mUbAllocation.buffer, mUbAllocation.offset, mUniforms.getSize());
 
     if (material->hasDoubleSidedCapability()) {
         setDoubleSided(mIsDoubleSided);
@@ -168,6 +169,8 @@ FMaterialInstance::FMaterialInstance(FEngine& engine,
     if (other->mDescriptorSet.getHandle()) {
         mDescriptorSet.commitSlow(mMaterial->getDescriptorSetLayout(), driver);
     }
+
+    invalidate();
 }
 
 FMaterialInstance* FMaterialInstance::duplicate(
@@ -181,15 +184,31 @@ FMaterialInstance::~FMaterialInstance() noexcept = default;
 
 void FMaterialInstance::terminate(FEngine& engine) {
     FEngine::DriverApi& driver = engine.getDriverApi();
+    engine.removeDirtyMaterialInstance(this);
     mDescriptorSet.terminate(driver);
-    driver.destroyBufferObject(mUbHandle);
+    engine.getUniformBufferArena().free(driver, mUbAllocation);
 }
 
 void FMaterialInstance::commit(DriverApi& driver) const {
     // update uniforms if needed
     if (mUniforms.isDirty()) {
-        driver.updateBufferObject(mUbHandle, mUniforms.toBufferDescriptor(driver), 0);
+        mMaterial->getEngine().getUniformBufferArena().update(driver, mUbAllocation,
+                mUniforms.getBuffer(), uint32_t(mUniforms.getSize()));
+        mUniforms.clean();
     }
+    commitDescriptors(driver);
+}
+
+void FMaterialInstance::commit(DriverApi& driver, UniformBufferArena& arena) const {
+    // update uniforms if needed
+    if (mUniforms.isDirty()) {
+        arena.write(driver, mUbAllocation, mUniforms.getBuffer(), uint32_t(mUniforms.getSize()));
+        mUniforms.clean();
+    }
+    commitDescriptors(driver);
+}
+
+void FMaterialInstance::commitDescriptors(DriverApi& driver) const {
     if (!mTextureParameters.empty()) {
         for (auto const& [binding, p]: mTextureParameters) {
             assert_invariant(p.texture);
@@ -210,12 +229,17 @@ void FMaterialInstance::commit(DriverApi& driver) const {
     mDescriptorSet.commit(mMaterial->getDescriptorSetLayout(), driver);
 }
 
+void FMaterialInstance::addToDirtyList() noexcept {
+    mMaterial->getEngine().addDirtyMaterialInstance(this);
+}
+
 // ------------------------------------------------------------------------------------------------
 
 void FMaterialInstance::setParameter(std::string_view name,
         backend::Handle<backend::HwTexture> texture, backend::SamplerParams params) {
     auto binding = mMaterial->getSamplerBinding(name);
     mDescriptorSet.setSampler(binding, texture, params);
+    invalidate();
 }
 
 void FMaterialInstance::setParameterImpl(std::string_view name,
@@ -254,6 +278,7 @@ void FMaterialInstance::setParameterImpl(std::string_view name,
         }
         mDescriptorSet.setSampler(binding, handle, sampler.getSamplerParams());
     }
+    invalidate();
 }
 
 void FMaterialInstance::setMaskThreshold(float threshold) noexcept {
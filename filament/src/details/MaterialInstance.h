@@ -20,6 +20,7 @@
 #include "downcast.h"
 
 #include "UniformBuffer.h"
+#include "UniformBufferArena.h"
 
 #include "ds/DescriptorSet.h"
 
@@ -64,8 +65,25 @@ public:
 
     void terminate(FEngine& engine);
 
+    // Uploads the uniforms and updates the descriptor set if needed. The uniforms are uploaded
+    // right away, e.g. to update the instance between two draw calls.
     void commit(FEngine::DriverApi& driver) const;
 
+    // Same as above, but the uniforms are only written to the arena, which uploads them later
+    // with the uniforms of other instances.
+    void commit(FEngine::DriverApi& driver, UniformBufferArena& arena) const;
+
+    // Schedules a commit() in the next FEngine::prepare()
+    void invalidate() noexcept {
+        if (mDirtyListIndex == NOT_DIRTY) {
+            addToDirtyList();
+        }
+    }
+
+    // Whether this instance must be committed every frame, because it refers to textures whose
+    // handle can change behind its back.
+    bool needsCommitEveryFrame() const noexcept { return !mTextureParameters.empty(); }
+
     void use(FEngine::DriverApi& driver) const;
 
     FMaterial const* getMaterial() const noexcept { return mMaterial; }
@@ -228,9 +246,12 @@ public:
     using MaterialInstance::setParameter;
 
 private:
+    friend class FEngine;
     friend class FMaterial;
     friend class MaterialInstance;
 
+    static constexpr uint32_t NOT_DIRTY = std::numeric_limits<uint32_t>::max();
+
     template<size_t Size>
     void setParameterUntypedImpl(std::string_view name, const void* value);
 
@@ -249,6 +270,10 @@ private:
     template<typename T>
     T getParameterImpl(std::string_view name) const;
 
+    void addToDirtyList() noexcept;
+
+    void commitDescriptors(FEngine::DriverApi& driver) const;
+
     // keep these grouped, they're accessed together in the render-loop
     FMaterial const* mMaterial = nullptr;
 
@@ -257,7 +282,7 @@ private:
         backend::SamplerParams params;
     };
 
-    backend::Handle<backend::HwBufferObject> mUbHandle;
+    UniformBufferArena::Allocation mUbAllocation;
     tsl::robin_map<backend::descriptor_binding_t, TextureParameter> mTextureParameters;
     mutable filament::DescriptorSet mDescriptorSet;
     UniformBuffer mUniforms;
@@ -280,6 +305,9 @@ private:
 
     uint64_t mMaterialSortingKey = 0;
 
+    // index of this instance in the engine's list of instances to commit
+    uint32_t mDirtyListIndex = NOT_DIRTY;
+
     // Scissor rectangle is specified as: Left Bottom Width Height.
     backend::Viewport mScissorRect = { 0, 0,
             (uint32_t)std::numeric_limits<int32_t>::max(),
@@ -41,6 +41,8 @@
 #include <backend/Handle.h>
 #include <backend/PixelBufferDescriptor.h>
 
+#include <private/backend/CommandStreamCapture.h>
+
 #include "fg/FrameGraph.h"
 #include "fg/FrameGraphId.h"
 #include "fg/FrameGraphResources.h"
@@ -59,8 +61,10 @@
 #include <utils/debug.h>
 
 #include <chrono>
+#include <cstdio>
 #include <limits>
 #include <memory>
+#include <thread>
 #include <utility>
 
 #include <stddef.h>
@@ -98,10 +102,14 @@ FRenderer::FRenderer(FEngine& engine) :
     FDebugRegistry& debugRegistry = engine.getDebugRegistry();
     debugRegistry.registerProperty("d.renderer.doFrameCapture",
             &engine.debug.renderer.doFrameCapture);
+    debugRegistry.registerProperty("d.renderer.doCommandStreamCapture",
+            &engine.debug.renderer.doCommandStreamCapture);
     debugRegistry.registerProperty("d.renderer.disable_buffer_padding",
             &engine.debug.renderer.disable_buffer_padding);
     debugRegistry.registerProperty("d.renderer.disable_subpasses",
             &engine.debug.renderer.disable_subpasses);
+    debugRegistry.registerProperty("d.renderer.disable_gpu_instance_culling",
+            &engine.debug.renderer.disable_gpu_instance_culling);
     debugRegistry.registerProperty("d.shadowmap.display_shadow_texture",
             &engine.debug.shadowmap.display_shadow_texture);
     debugRegistry.registerProperty("d.shadowmap.display_shadow_texture_scale",
@@ -275,6 +283,16 @@ void FRenderer::skipFrame(uint64_t vsyncSteadyClockTimeNano) {
     js.waitAndRelease(job);
 }
 
+std::chrono::steady_clock::time_point FRenderer::getJustInTimeFrameStart(
+        std::chrono::steady_clock::time_point vsync, std::chrono::steady_clock::duration latency,
+        float refreshRate, uint8_t interval, float safetyMargin) noexcept {
+    using namespace std::chrono;
+    auto const frameInterval = duration_cast<steady_clock::duration>(
+            std::chrono::duration<double>(double(interval) / refreshRate));
+    auto const margin = duration_cast<steady_clock::duration>(frameInterval * safetyMargin);
+    return vsync + frameInterval - margin - latency;
+}
+
 bool FRenderer::beginFrame(FSwapChain* swapChain, uint64_t vsyncSteadyClockTimeNano) {
     assert_invariant(swapChain);
 
@@ -300,8 +318,29 @@ bool FRenderer::beginFrame(FSwapChain* swapChain, uint64_t vsyncSteadyClockTimeN
         mVsyncSteadyClockTimeNano = 0;
     }
 
-    // get the timestamp as soon as possible
     using namespace std::chrono;
+
+    // In latency mode, delay the start of the frame so that it's done just before the next
+    // vsync, instead of waiting in a queue for it.
+    if (UTILS_UNLIKELY(mLatencyOptions.enabled && vsyncSteadyClockTimeNano &&
+            mDisplayInfo.refreshRate > 0.0f)) {
+        // we use the longest recent latency to avoid missing vsync because of a slow frame
+        steady_clock::duration const latency =
+                mFrameInfoManager.getLatencyEstimate(mFrameRateOptions.history);
+        if (latency != steady_clock::duration::zero()) {
+            steady_clock::time_point const vsync{
+                    steady_clock::duration(vsyncSteadyClockTimeNano) };
+            steady_clock::time_point const start = getJustInTimeFrameStart(vsync, latency,
+                    mDisplayInfo.refreshRate, mFrameRateOptions.interval,
+                    mLatencyOptions.safetyMargin);
+            if (start > steady_clock::now()) {
+                SYSTRACE_NAME("FRenderer::latencyPacing");
+                std::this_thread::sleep_until(start);
+            }
+        }
+    }
+
+    // get the timestamp as soon as possible
     const steady_clock::time_point now{ steady_clock::now() };
     const steady_clock::time_point userVsync{ steady_clock::duration(vsyncSteadyClockTimeNano) };
     const time_point<steady_clock> appVsync(vsyncSteadyClockTimeNano ? userVsync : now);
@@ -319,6 +358,13 @@ bool FRenderer::beginFrame(FSwapChain* swapChain, uint64_t vsyncSteadyClockTimeN
         driver.startCapture();
     }
 
+    // start recording the command stream, if requested.
+    if (UTILS_UNLIKELY(engine.debug.renderer.doCommandStreamCapture)) {
+        // starts with the commands that re-create the live resources, if the engine keeps them
+        mCommandStreamCapture = std::make_unique<CommandStreamCapture>(driver.getCapture());
+        driver.setCapture(mCommandStreamCapture.get());
+    }
+
     // latch the frame time
     std::chrono::duration<double> const time(appVsync - mUserEpoch);
     float const h = float(time.count());
@@ -412,7 +458,7 @@ void FRenderer::endFrame() {
         mSwapChain = nullptr;
     }
 
-    mFrameInfoManager.endFrame(driver);
+    mFrameInfoManager.endFrame(engine);
     mFrameSkipper.endFrame(driver);
 
     driver.endFrame(mFrameId);
@@ -426,6 +472,20 @@ void FRenderer::endFrame() {
         engine.debug.renderer.doFrameCapture = false;
     }
 
+    // stop recording the command stream and write it to disk, if requested
+    if (UTILS_UNLIKELY(mCommandStreamCapture)) {
+        driver.setCapture(mCommandStreamCapture->getResources());
+        char path[64];
+        snprintf(path, sizeof(path), "filament-frame-%u.fcs", mFrameId);
+        if (mCommandStreamCapture->save(path)) {
+            slog.i << "CommandStream capture: " << mCommandStreamCapture->getCommandCount()
+                   << " commands (" << mCommandStreamCapture->getPreambleCommandCount()
+                   << " in the preamble) written to " << path << io::endl;
+        }
+        mCommandStreamCapture.reset();
+        engine.debug.renderer.doCommandStreamCapture = false;
+    }
+
     // do this before engine.flush()
     mResourceAllocator->gc();
 
@@ -435,10 +495,22 @@ void FRenderer::endFrame() {
 
     auto *job = js.runAndRetain(jobs::createJob(js, nullptr, &FEngine::gc, &engine)); // gc all managers
 
+    auto const flushStart = std::chrono::steady_clock::now();
+
     engine.flush();     // flush command stream
 
+    mFrameInfoManager.setFlushTime(std::chrono::steady_clock::now() - flushStart);
+
+    UniformBufferArena& uniformBufferArena = engine.getUniformBufferArena();
+    UniformBufferArena::Stats const uniformStats = uniformBufferArena.getStats();
+    mFrameInfoManager.setMaterialUniformStats(uniformStats.bufferCount,
+            uniformStats.uploadCount, uniformStats.uploadSize);
+    uniformBufferArena.resetStats();
+
     // make sure we're done with the gcs
     js.waitAndRelease(job);
+
+    engine.endCommandBufferFrame();
 }
 
 void FRenderer::readPixels(uint32_t xoffset, uint32_t yoffset, uint32_t width, uint32_t height,
@@ -575,6 +647,11 @@ void FRenderer::render(FView const* view) {
         }
         renderInternal(view);
         mViewRenderedCount++;
+
+        // the froxelization job is guaranteed to have completed by now
+        mFrameInfoManager.addViewCpuTimings(view->getCpuTimings());
+        mFrameInfoManager.addRenderableUniformStats(view->getRenderableUniformUploadCount(),
+                view->getRenderableUniformUploadSize());
     }
 }
 
@@ -784,6 +861,9 @@ void FRenderer::renderJob(RootArenaScope& rootArenaScope, FView& view) {
         xvp.bottom = int32_t(guardBand);
     }
 
+    ViewCpuTimingsImpl& cpuTimings = view.getCpuTimings();
+    cpuTimings = {};
+
     view.prepare(engine, driver, rootArenaScope, svp, cameraInfo, getShaderUserTime(), needsAlphaChannel);
 
     view.prepareUpscaler(scale, taaOptions, dsrOptions);
@@ -809,6 +889,7 @@ void FRenderer::renderJob(RootArenaScope& rootArenaScope, FView& view) {
 
     RenderPassBuilder passBuilder(commandArena);
     passBuilder.renderFlags(renderFlags);
+    passBuilder.commandGenerationTime(&cpuTimings.commands);
 
     Variant variant;
     variant.setDirectionalLighting(view.hasDirectionalLighting());
@@ -835,10 +916,16 @@ void FRenderer::renderJob(RootArenaScope& rootArenaScope, FView& view) {
         auto shadows = view.renderShadowMaps(engine, fg, cameraInfo, mShaderUserTime,
                 RenderPassBuilder{ commandArena }
                     .renderFlags(renderFlags)
-                    .variant(shadowVariant));
+                    .variant(shadowVariant)
+                    .commandGenerationTime(&cpuTimings.commands));
         blackboard["shadows"] = shadows;
     }
 
+    // the other passes render the camera's point of view, they only draw the instances that
+    // are visible from it.
+    renderFlags |= RenderPass::HAS_INSTANCE_CULLING;
+    passBuilder.renderFlags(renderFlags);
+
     // When we don't have a custom RenderTarget, customRenderTarget below is nullptr and is
     // recorded in the list of targets already rendered into -- this ensures that
     // initializeClearFlags() is called only once for the default RenderTarget.
@@ -1419,12 +1506,20 @@ void FRenderer::renderJob(RootArenaScope& rootArenaScope, FView& view) {
 
     fg.present(fgViewRenderTarget);
 
+    using clock = std::chrono::steady_clock;
+    clock::time_point const compileStart = clock::now();
+
     fg.compile();
 
     //fg.export_graphviz(slog.d, view.getName());
 
+    clock::time_point const executeStart = clock::now();
+
     fg.execute(driver);
 
+    cpuTimings.frameGraphCompile = executeStart - compileStart;
+    cpuTimings.frameGraphExecute = clock::now() - executeStart;
+
     // save the current history entry and destroy the oldest entry
     view.commitFrameHistory(engine);
 
@@ -57,6 +57,7 @@ namespace filament {
 class ResourceAllocator;
 
 namespace backend {
+class CommandStreamCapture;
 class Driver;
 } // namespace backend
 
@@ -139,6 +140,21 @@ public:
         frameRateOptions.headRoomRatio = std::max(frameRateOptions.headRoomRatio, 0.0f);
     }
 
+    void setLatencyOptions(LatencyOptions const& options) noexcept {
+        LatencyOptions& latencyOptions = mLatencyOptions;
+        latencyOptions = options;
+
+        // more than 2 frames in flight would be throttled by the swapchain anyway
+        latencyOptions.maxFramesInFlight = std::clamp(latencyOptions.maxFramesInFlight,
+                uint8_t(1), uint8_t(2));
+
+        // the margin can't be larger than the frame interval, or less than 0
+        latencyOptions.safetyMargin = std::clamp(latencyOptions.safetyMargin, 0.0f, 1.0f);
+
+        mFrameSkipper.setFrameLatency(latencyOptions.enabled ?
+                latencyOptions.maxFramesInFlight : FrameSkipper::DEFAULT_FRAME_LATENCY);
+    }
+
     void setClearOptions(const ClearOptions& options) {
         mClearOptions = options;
     }
@@ -155,6 +171,17 @@ public:
         return MAX_FRAMETIME_HISTORY;
     }
 
+    utils::FixedCapacityVector<Renderer::CpuFrameInfo> getCpuFrameInfoHistory(size_t historySize) const noexcept {
+        return mFrameInfoManager.getCpuFrameInfoHistory(historySize);
+    }
+
+    // In latency mode, returns when a frame taking `latency` must start to be done just before
+    // the vsync following `vsync`, minus the safety margin.
+    static std::chrono::steady_clock::time_point getJustInTimeFrameStart(
+            std::chrono::steady_clock::time_point vsync,
+            std::chrono::steady_clock::duration latency,
+            float refreshRate, uint8_t interval, float safetyMargin) noexcept;
+
 private:
     friend class Renderer;
     using Command = RenderPass::Command;
@@ -206,6 +233,7 @@ private:
     math::float4 mShaderUserTime{};
     DisplayInfo mDisplayInfo;
     FrameRateOptions mFrameRateOptions;
+    LatencyOptions mLatencyOptions;
     ClearOptions mClearOptions;
     backend::TargetBufferFlags mDiscardStartFlags{};
     backend::TargetBufferFlags mClearFlags{};
@@ -213,6 +241,7 @@ private:
     std::function<void()> mBeginFrameInternal;
     uint64_t mVsyncSteadyClockTimeNano = 0;
     std::unique_ptr<ResourceAllocator> mResourceAllocator{};
+    std::unique_ptr<backend::CommandStreamCapture> mCommandStreamCapture{};
 };
 
 FILAMENT_DOWNCAST(Renderer)
@@ -36,6 +36,9 @@
 #include <math/quat.h>
 
 #include <algorithm>
+#include <functional>
+#include <tuple>
+#include <vector>
 
 using namespace filament::backend;
 using namespace filament::math;
@@ -74,9 +77,10 @@ void FScene::prepare(utils::JobSystem& js,
     // go through the list of entities, and gather the data of those that are renderables
     auto& sceneData = mRenderableData;
     auto& lightData = mLightData;
-    auto const& entities = mEntities;
+    auto& entities = mEntities;
 
-    using RenderableContainerData = std::pair<RenderableManager::Instance, TransformManager::Instance>;
+    using RenderableContainerData = std::tuple<
+            RenderableManager::Instance, TransformManager::Instance, uint32_t>;
     using RenderableInstanceContainer = FixedCapacityVector<RenderableContainerData,
             utils::STLAllocator< RenderableContainerData, LinearAllocatorArena >, false>;
 
@@ -101,11 +105,14 @@ void FScene::prepare(utils::JobSystem& js,
      * Also find the main directional light.
      */
 
-    for (Entity const e: entities) {
+    uint32_t uboSlotEnd = 0;
+    for (auto it = entities.begin(), end = entities.end(); it != end; ++it) {
+        Entity const e = it->first;
+        RenderableManager::Instance ri{};
         if (UTILS_LIKELY(em.isAlive(e))) {
             auto ti = tcm.getInstance(e);
             auto li = lcm.getInstance(e);
-            auto ri = rcm.getInstance(e);
+            ri = rcm.getInstance(e);
             if (li) {
                 // we handle the directional light here because it'd prevent multithreading below
                 if (UTILS_UNLIKELY(lcm.isDirectionalLight(li))) {
@@ -119,10 +126,22 @@ void FScene::prepare(utils::JobSystem& js,
                 }
             }
             if (ri) {
-                renderableInstances.emplace_back(ri, ti);
+                // only renderables use a UBO slot, it's assigned the first time we see them
+                uint32_t& slot = it.value();
+                if (UTILS_UNLIKELY(slot == NO_UBO_SLOT)) {
+                    slot = allocateUboSlot();
+                }
+                uboSlotEnd = std::max(uboSlotEnd, slot + 1);
+                renderableInstances.emplace_back(ri, ti, slot);
             }
         }
+        if (UTILS_UNLIKELY(!ri && it->second != NO_UBO_SLOT)) {
+            // the renderable component (or the entity) was destroyed
+            freeUboSlot(it->second);
+            it.value() = NO_UBO_SLOT;
+        }
     }
+    mUboSlotEnd = uboSlotEnd;
 
     SYSTRACE_NAME_END();
 
@@ -175,7 +194,7 @@ void FScene::prepare(utils::JobSystem& js,
         SYSTRACE_NAME("renderableWork");
 
         for (size_t i = 0; i < c; i++) {
-            auto [ri, ti] = p[i];
+            auto [ri, ti, slot] = p[i];
 
             // this is where we go from double to float for our transforms
             const mat4f shaderWorldTransform{
@@ -214,7 +233,9 @@ void FScene::prepare(utils::JobSystem& js,
             //sceneData.elementAt<PRIMITIVES>(index)          = {}; // already initialized, Slice<>
             sceneData.elementAt<SUMMED_PRIMITIVE_COUNT>(index) = 0;
             //sceneData.elementAt<UBO>(index)                 = {}; // not needed here
+            sceneData.elementAt<INSTANCE_CULLING>(index)    = {};
             sceneData.elementAt<USER_DATA>(index)           = scale;
+            sceneData.elementAt<UBO_SLOT>(index)            = slot;
         }
     };
 
@@ -382,27 +403,33 @@ void FScene::prepareVisibleRenderables(Range<uint32_t> visibleRenderables) noexc
     }
 }
 
+// Only the fields written by prepareVisibleRenderables() are compared, the padding and
+// reserved fields are left uninitialized. The normal matrix is derived from the model matrix.
+static bool isSameRenderableData(PerRenderableData const& lhs,
+        PerRenderableData const& rhs) noexcept {
+    return lhs.worldFromModelMatrix == rhs.worldFromModelMatrix &&
+           lhs.morphTargetCount == rhs.morphTargetCount &&
+           lhs.flagsChannels == rhs.flagsChannels &&
+           lhs.objectId == rhs.objectId &&
+           lhs.userData == rhs.userData;
+}
+
 void FScene::updateUBOs(
         Range<uint32_t> visibleRenderables,
-        Handle<HwBufferObject> renderableUbh) noexcept {
+        Handle<HwBufferObject> renderableUbh,
+        RenderableUboCache& cache) noexcept {
     SYSTRACE_CALL();
     FEngine::DriverApi& driver = mEngine.getDriverApi();
 
     // don't allocate more than 16 KiB directly into the render stream
     static constexpr size_t MAX_STREAM_ALLOCATION_COUNT = 64;   // 16 KiB
-    const size_t count = visibleRenderables.size();
-    PerRenderableData* buffer = [&]{
-        if (count >= MAX_STREAM_ALLOCATION_COUNT) {
-            // use the heap allocator
-            auto& bufferPoolAllocator = mSharedState->mBufferPoolAllocator;
-            return (PerRenderableData*)bufferPoolAllocator.get(count * sizeof(PerRenderableData));
-        } else {
-            // allocate space into the command stream directly
-            return driver.allocatePod<PerRenderableData>(count);
-        }
-    }();
+
+    // clean slots separating two dirty ranges are uploaded when there are fewer than this, it's
+    // cheaper than issuing another update.
+    static constexpr size_t MAX_COALESCED_GAP = 4;              // 1 KiB
 
     PerRenderableData const* const uboData = mRenderableData.data<UBO>();
+    uint32_t const* const uboSlots = mRenderableData.data<UBO_SLOT>();
     mat4f const* const worldTransformData = mRenderableData.data<WORLD_TRANSFORM>();
 
     // prepare each InstanceBuffer.
@@ -415,30 +442,100 @@ void FScene::updateUBOs(
         }
     }
 
-    // copy our data into the UBO for each visible renderable
+    // slots past the renderables in use are not in the UBO anymore, their content will be lost
+    uint32_t const slotCount = mUboSlotEnd;
+    if (cache.data.size() < slotCount) {
+        cache.data.resize(slotCount);
+        cache.valid.resize(slotCount, false);
+    } else {
+        std::fill(cache.valid.begin() + slotCount, cache.valid.end(), false);
+    }
+
+    // update our copy of the UBO with the renderables that changed since they were uploaded
+    auto& dirtySlots = cache.dirtySlots;
+    dirtySlots.clear();
     for (uint32_t const i : visibleRenderables) {
-        buffer[i] = uboData[i];
+        uint32_t const slot = uboSlots[i];
+        assert_invariant(slot < cache.data.size());
+        if (!cache.valid[slot] || !isSameRenderableData(cache.data[slot], uboData[i])) {
+            cache.data[slot] = uboData[i];
+            cache.valid[slot] = true;
+            dirtySlots.push_back(slot);
+        }
+    }
+
+    cache.uploadCount = 0;
+    cache.uploadSize = 0;
+    if (dirtySlots.empty()) {
+        return;
     }
 
-    // We capture state shared between Scene and the update buffer callback, because the Scene could
-    // be destroyed before the callback executes.
-    std::weak_ptr<SharedState>* const weakShared = new std::weak_ptr<SharedState>(mSharedState);
-
-    // update the UBO
-    driver.resetBufferObject(renderableUbh);
-    driver.updateBufferObjectUnsynchronized(renderableUbh, {
-            buffer, count * sizeof(PerRenderableData),
-            +[](void* p, size_t s, void* user) {
-                std::weak_ptr<SharedState>* const weakShared =
-                        static_cast<std::weak_ptr<SharedState>*>(user);
-                if (s >= MAX_STREAM_ALLOCATION_COUNT * sizeof(PerRenderableData)) {
-                    if (auto state = weakShared->lock()) {
-                        state->mBufferPoolAllocator.put(p);
+    auto upload = [&](uint32_t first, uint32_t count, bool orphan) {
+        PerRenderableData* buffer = [&]{
+            if (count >= MAX_STREAM_ALLOCATION_COUNT) {
+                // use the heap allocator
+                auto& bufferPoolAllocator = mSharedState->mBufferPoolAllocator;
+                return (PerRenderableData*)bufferPoolAllocator.get(
+                        count * sizeof(PerRenderableData));
+            } else {
+                // allocate space into the command stream directly
+                return driver.allocatePod<PerRenderableData>(count);
+            }
+        }();
+
+        std::copy_n(cache.data.data() + first, count, buffer);
+
+        // We capture state shared between Scene and the update buffer callback, because the
+        // Scene could be destroyed before the callback executes.
+        std::weak_ptr<SharedState>* const weakShared =
+                new std::weak_ptr<SharedState>(mSharedState);
+
+        BufferDescriptor bd{
+                buffer, count * sizeof(PerRenderableData),
+                +[](void* p, size_t s, void* user) {
+                    std::weak_ptr<SharedState>* const weakShared =
+                            static_cast<std::weak_ptr<SharedState>*>(user);
+                    if (s >= MAX_STREAM_ALLOCATION_COUNT * sizeof(PerRenderableData)) {
+                        if (auto state = weakShared->lock()) {
+                            state->mBufferPoolAllocator.put(p);
+                        }
                     }
-                }
-                delete weakShared;
-            }, weakShared
-    }, 0);
+                    delete weakShared;
+                }, weakShared };
+
+        uint32_t const byteOffset = first * sizeof(PerRenderableData);
+        if (orphan) {
+            // the whole UBO is replaced, we don't need to wait for the GPU to be done with it
+            driver.resetBufferObject(renderableUbh);
+            driver.updateBufferObjectUnsynchronized(renderableUbh, std::move(bd), byteOffset);
+        } else {
+            driver.updateBufferObject(renderableUbh, std::move(bd), byteOffset);
+        }
+
+        cache.uploadCount++;
+        cache.uploadSize += count * sizeof(PerRenderableData);
+    };
+
+    if (dirtySlots.size() * 2 >= mRenderableData.size()) {
+        // When most of the renderables changed, it's cheaper to replace the UBO entirely. Every
+        // slot in use is uploaded because the previous content of the UBO is lost.
+        upload(0, slotCount, true);
+        return;
+    }
+
+    // upload the dirty slots as coalesced ranges
+    std::sort(dirtySlots.begin(), dirtySlots.end());
+    uint32_t first = dirtySlots.front();
+    uint32_t last = first + 1;
+    for (size_t i = 1, c = dirtySlots.size(); i < c; i++) {
+        uint32_t const slot = dirtySlots[i];
+        if (slot - last > MAX_COALESCED_GAP) {
+            upload(first, last - first, false);
+            first = slot;
+        }
+        last = slot + 1;
+    }
+    upload(first, last - first, false);
 }
 
 void FScene::terminate(FEngine&) {
@@ -524,19 +621,44 @@ inline void FScene::computeLightRanges(
     }
 }
 
+uint32_t FScene::allocateUboSlot() noexcept {
+    if (!mFreeUboSlots.empty()) {
+        // reuse the lowest free slot, so the UBO stays as small as possible
+        std::pop_heap(mFreeUboSlots.begin(), mFreeUboSlots.end(), std::greater<>());
+        uint32_t const slot = mFreeUboSlots.back();
+        mFreeUboSlots.pop_back();
+        return slot;
+    }
+    return mUboSlotCount++;
+}
+
+void FScene::freeUboSlot(uint32_t slot) noexcept {
+    mFreeUboSlots.push_back(slot);
+    std::push_heap(mFreeUboSlots.begin(), mFreeUboSlots.end(), std::greater<>());
+}
+
 UTILS_NOINLINE
 void FScene::addEntity(Entity entity) {
-    mEntities.insert(entity);
+    // the UBO slot is assigned by prepare(), if the entity is a renderable
+    mEntities.try_emplace(entity, NO_UBO_SLOT);
 }
 
 UTILS_NOINLINE
 void FScene::addEntities(const Entity* entities, size_t count) {
-    mEntities.insert(entities, entities + count);
+    for (size_t i = 0; i < count; ++i, ++entities) {
+        addEntity(*entities);
+    }
 }
 
 UTILS_NOINLINE
 void FScene::remove(Entity entity) {
-    mEntities.erase(entity);
+    auto pos = mEntities.find(entity);
+    if (pos != mEntities.end()) {
+        if (pos->second != NO_UBO_SLOT) {
+            freeUboSlot(pos->second);
+        }
+        mEntities.erase(pos);
+    }
 }
 
 UTILS_NOINLINE
@@ -553,7 +675,7 @@ size_t FScene::getRenderableCount() const noexcept {
     FRenderableManager const& rcm = engine.getRenderableManager();
     size_t count = 0;
     auto const& entities = mEntities;
-    for (Entity const e : entities) {
+    for (auto const& [e, slot] : entities) {
         count += em.isAlive(e) && rcm.getInstance(e) ? 1 : 0;
     }
     return count;
@@ -566,7 +688,7 @@ size_t FScene::getLightCount() const noexcept {
     FLightManager const& lcm = engine.getLightManager();
     size_t count = 0;
     auto const& entities = mEntities;
-    for (Entity const e : entities) {
+    for (auto const& [e, slot] : entities) {
         count += em.isAlive(e) && lcm.getInstance(e) ? 1 : 0;
     }
     return count;
@@ -614,7 +736,9 @@ bool FScene::hasContactShadows() const noexcept {
 
 UTILS_NOINLINE
 void FScene::forEach(Invocable<void(Entity)>&& functor) const noexcept {
-    std::for_each(mEntities.begin(), mEntities.end(), std::move(functor));
+    for (auto const& [e, slot] : mEntities) {
+        functor(e);
+    }
 }
 
 } // namespace filament
@@ -44,9 +44,12 @@
 
 #include <stddef.h>
 
-#include <tsl/robin_set.h>
+#include <tsl/robin_map.h>
 
+#include <algorithm>
+#include <limits>
 #include <memory>
+#include <vector>
 
 namespace filament {
 
@@ -88,6 +91,14 @@ public:
 
     using VisibleMaskType = Culler::result_type;
 
+    // result of the instance culling of a renderable, see InstanceCuller
+    struct InstanceCullingInfo {
+        backend::Handle<backend::HwBufferObject> drawArgs;  // GPU: args written by the culling
+        uint32_t firstDrawArgs;     // GPU: index in drawArgs of the args of the first primitive
+        uint16_t visibleCount;      // CPU: number of visible instances
+        bool culled;                // whether the camera passes only draw the visible instances
+    };
+
     enum {
         RENDERABLE_INSTANCE,    //   4 | instance of the Renderable component
         WORLD_TRANSFORM,        //  16 | instance of the Transform component
@@ -108,9 +119,11 @@ public:
         SUMMED_PRIMITIVE_COUNT, //   4 | summed visible primitive counts
         UBO,                    // 128 |
         DESCRIPTOR_SET_HANDLE,
+        INSTANCE_CULLING,       //  12 | instances visible from the camera
 
         // FIXME: We need a better way to handle this
         USER_DATA,              //   4 | user data currently used to store the scale
+        UBO_SLOT,               //   4 | stable slot of this renderable in the View's UBO
     };
 
     using RenderableSoa = utils::StructureOfArrays<
@@ -129,8 +142,10 @@ public:
             uint32_t,                                   // SUMMED_PRIMITIVE_COUNT
             PerRenderableData,                          // UBO
             backend::DescriptorSetHandle,               // DESCRIPTOR_SET_HANDLE
+            InstanceCullingInfo,                        // INSTANCE_CULLING
             // FIXME: We need a better way to handle this
-            float                                       // USER_DATA
+            float,                                      // USER_DATA
+            uint32_t                                    // UBO_SLOT
     >;
 
     RenderableSoa const& getRenderableData() const noexcept { return mRenderableData; }
@@ -186,8 +201,30 @@ public:
     LightSoa const& getLightData() const noexcept { return mLightData; }
     LightSoa& getLightData() noexcept { return mLightData; }
 
+    /*
+     * Each View keeps a copy of what its renderables UBO contains, so that only the slots that
+     * changed since the last frame are uploaded.
+     */
+    struct RenderableUboCache {
+        std::vector<PerRenderableData> data;    // content of the UBO, indexed by UBO_SLOT
+        std::vector<bool> valid;                // whether a slot of `data` is in the UBO
+        std::vector<uint32_t> dirtySlots;       // scratch list of the slots to upload
+        uint32_t uploadCount = 0;               // buffer updates issued by the last updateUBOs()
+        uint32_t uploadSize = 0;                // bytes uploaded by the last updateUBOs()
+
+        // must be called when the UBO is reallocated
+        void invalidate() noexcept {
+            std::fill(valid.begin(), valid.end(), false);
+        }
+    };
+
+    // Number of UBO slots needed for the renderables of the last prepare(). Renderables get a
+    // slot in prepare(), which is stable as long as the entity stays in the scene.
+    uint32_t getUboSlotCount() const noexcept { return mUboSlotEnd; }
+
     void updateUBOs(utils::Range<uint32_t> visibleRenderables,
-            backend::Handle<backend::HwBufferObject> renderableUbh) noexcept;
+            backend::Handle<backend::HwBufferObject> renderableUbh,
+            RenderableUboCache& cache) noexcept;
 
     bool hasContactShadows() const noexcept;
 
@@ -208,16 +245,25 @@ private:
     static inline void computeLightRanges(math::float2* zrange,
             CameraInfo const& camera, const math::float4* spheres, size_t count) noexcept;
 
+    uint32_t allocateUboSlot() noexcept;
+    void freeUboSlot(uint32_t slot) noexcept;
+
+    static constexpr uint32_t NO_UBO_SLOT = std::numeric_limits<uint32_t>::max();
+
     FEngine& mEngine;
     FSkybox* mSkybox = nullptr;
     FIndirectLight* mIndirectLight = nullptr;
 
     /*
-     * list of Entities in the scene. We use a robin_set<> so we can do efficient removes
-     * (a vector<> could work, but removes would be O(n)). robin_set<> iterates almost as
-     * nicely as vector<>, which is a good compromise.
+     * list of Entities in the scene, with their UBO slot or NO_UBO_SLOT if they're not a
+     * renderable. We use a robin_map<> so we can do efficient removes (a vector<> could work, but
+     * removes would be O(n)). robin_map<> iterates almost as nicely as vector<>, which is a good
+     * compromise.
      */
-    tsl::robin_set<utils::Entity, utils::Entity::Hasher> mEntities;
+    tsl::robin_map<utils::Entity, uint32_t, utils::Entity::Hasher> mEntities;
+    std::vector<uint32_t> mFreeUboSlots;    // min-heap, so that slots in use stay packed
+    uint32_t mUboSlotCount = 0;             // slots ever allocated
+    uint32_t mUboSlotEnd = 0;               // one past the highest slot of the last prepare()
 
 
     /*
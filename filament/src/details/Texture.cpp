@@ -787,6 +787,8 @@ void FTexture::generatePrefilterMipmap(FEngine& engine,
     // Finally generate each pre-filtered mipmap level
     const size_t baseExp = ctz(size);
     size_t const numSamples = options->sampleCount;
+    CubemapIBL::Quality const quality =
+            options->fast ? CubemapIBL::Quality::FAST : CubemapIBL::Quality::HIGH;
     const size_t numLevels = baseExp + 1;
     for (ssize_t i = (ssize_t)baseExp; i >= 0; --i) {
         const size_t dim = 1U << i;
@@ -797,7 +799,7 @@ void FTexture::generatePrefilterMipmap(FEngine& engine,
         Image image;
         Cubemap dst = CubemapUtils::create(image, dim);
         CubemapIBL::roughnessFilter(js, dst, { levels.begin(), uint32_t(levels.size()) },
-                linearRoughness, numSamples, mirror, true);
+                linearRoughness, numSamples, mirror, true, quality);
 
         Texture::PixelBufferDescriptor const pbd(image.getData(), image.getSize(),
                 Texture::PixelBufferDescriptor::PixelDataFormat::RGB,
@@ -49,6 +49,7 @@
 #include <math/fast.h>
 
 #include <array>
+#include <chrono>
 #include <memory>
 #include <tuple>
 
@@ -77,12 +78,6 @@ FView::FView(FEngine& engine)
     debugRegistry.registerProperty("d.view.camera_at_origin",
             &engine.debug.view.camera_at_origin);
 
-    // The integral term is used to fight back the dead-band below, we limit how much it can act.
-    mPidController.setIntegralLimits(-100.0f, 100.0f);
-
-    // Dead-band, 1% for scaling down, 5% for scaling up. This stabilizes all the jitters.
-    mPidController.setOutputDeadBand(-0.01f, 0.05f);
-
 #ifndef NDEBUG
     // This can fail if another view has already registered this data source
     mDebugState->owner = debugRegistry.registerDataSource("d.view.frame_info",
@@ -144,6 +139,7 @@ void FView::terminate(FEngine& engine) {
     mUniforms.terminate(driver);
     mColorPassDescriptorSet.terminate(engine.getDescriptorSetLayoutFactory(), driver);
     mFroxelizer.terminate(driver);
+    mInstanceCuller.terminate(driver);
     mCommonRenderableDescriptorSet.terminate(driver);
 
     engine.getEntityManager().destroy(mFogEntity);
@@ -166,6 +162,10 @@ void FView::setDynamicResolutionOptions(DynamicResolutionOptions const& options)
     DynamicResolutionOptions& dynamicResolution = mDynamicResolution;
     dynamicResolution = options;
 
+    // Without GPU frame times we can't scale the resolution, but we still compute the
+    // level of detail hint from the CPU times.
+    mIsDynamicResolutionRequested = options.enabled;
+
     // only enable if dynamic resolution is supported
     dynamicResolution.enabled = dynamicResolution.enabled && mIsDynamicResolutionSupported;
     if (dynamicResolution.enabled) {
@@ -205,13 +205,7 @@ float2 FView::updateScale(FEngine& engine,
 #endif
 
     DynamicResolutionOptions const& options = mDynamicResolution;
-    if (options.enabled) {
-        if (!UTILS_UNLIKELY(info.valid)) {
-            // always clamp to the min/max scale range
-            mScale = clamp(1.0f, options.minScale, options.maxScale);
-            return mScale;
-        }
-
+    if (mIsDynamicResolutionRequested && (info.valid || info.threadTimesValid)) {
 #ifndef NDEBUG
         const float Kp = engine.debug.view.pid.kp;
         const float Ki = engine.debug.view.pid.ki;
@@ -221,66 +215,83 @@ float2 FView::updateScale(FEngine& engine,
         const float Ki = PID_CONTROLLER_Ki;
         const float Kd = PID_CONTROLLER_Kd;
 #endif
-        mPidController.setParallelGains(Kp, Ki, Kd);
+        mDynamicResolutionController.setGains(Kp, Ki, Kd);
 
         // all values in ms below
         using std::chrono::duration;
-        const float dt = 1.0f; // we don't really need dt here, setting it to 1, means our parameters are in "frames"
         const float target = (1000.0f * float(frameRateOptions.interval)) / displayInfo.refreshRate;
         const float targetWithHeadroom = target * (1.0f - frameRateOptions.headRoomRatio);
-        float const measured = duration<float, std::milli>{ info.denoisedFrameTime }.count();
-        float const out = mPidController.update(measured / targetWithHeadroom, 1.0f, dt);
 
-        // maps pid command to a scale (absolute or relative, see below)
-         const float command = out < 0.0f ? (1.0f / (1.0f - out)) : (1.0f + out);
+        DynamicResolutionController::FrameTimes times;
+        if (info.valid) {
+            times.gpu = duration<float, std::milli>{ info.denoisedFrameTime }.count();
+        }
+        if (info.threadTimesValid) {
+            times.mainThread = duration<float, std::milli>{ info.mainThreadTime }.count();
+            times.backendThread = duration<float, std::milli>{ info.backendThreadTime }.count();
+        }
 
-        /*
-         * There is two ways we can control the scale factor, either by having the PID controller
-         * output a new scale factor directly (like a "position" control), or having it evaluate
-         * a relative scale factor (like a "velocity" control).
-         * More experimentation is needed to figure out which works better in more cases.
-         */
+        // relative scale factor of the number of pixels
+        const float command = mDynamicResolutionController.update(times, targetWithHeadroom);
+
+        if (options.enabled && !UTILS_UNLIKELY(info.valid)) {
+            // always clamp to the min/max scale range
+            mScale = clamp(1.0f, options.minScale, options.maxScale);
+        } else if (options.enabled) {
+            /*
+             * There is two ways we can control the scale factor, either by having the PID
+             * controller output a new scale factor directly (like a "position" control), or
+             * having it evaluate a relative scale factor (like a "velocity" control).
+             * More experimentation is needed to figure out which works better in more cases.
+             */
+
+            // direct scaling ("position" control)
+            //const float scale = command;
+            // relative scaling ("velocity" control)
+            const float scale = mScale.x * mScale.y * command;
+
+            const float w = float(mViewport.width);
+            const float h = float(mViewport.height);
+            if (scale < 1.0f && !options.homogeneousScaling) {
+                // figure out the major and minor axis
+                const float major = std::max(w, h);
+                const float minor = std::min(w, h);
+
+                // the major axis is scaled down first, down to the minor axis
+                const float maxMajorScale = minor / major;
+                const float majorScale = std::max(scale, maxMajorScale);
+
+                // then the minor axis is scaled down to the original aspect-ratio
+                const float minorScale = std::max(scale / majorScale, majorScale * maxMajorScale);
+
+                // if we have some scaling capacity left, scale homogeneously
+                const float homogeneousScale = scale / (majorScale * minorScale);
+
+                // finally, write the scale factors
+                float& majorRef = w > h ? mScale.x : mScale.y;
+                float& minorRef = w > h ? mScale.y : mScale.x;
+                majorRef = std::sqrt(homogeneousScale) * majorScale;
+                minorRef = std::sqrt(homogeneousScale) * minorScale;
+            } else {
+                // when scaling up, we're always using homogeneous scaling.
+                mScale = std::sqrt(scale);
+            }
 
-        // direct scaling ("position" control)
-        //const float scale = command;
-        // relative scaling ("velocity" control)
-        const float scale = mScale.x * mScale.y * command;
-
-        const float w = float(mViewport.width);
-        const float h = float(mViewport.height);
-        if (scale < 1.0f && !options.homogeneousScaling) {
-            // figure out the major and minor axis
-            const float major = std::max(w, h);
-            const float minor = std::min(w, h);
-
-            // the major axis is scaled down first, down to the minor axis
-            const float maxMajorScale = minor / major;
-            const float majorScale = std::max(scale, maxMajorScale);
-
-            // then the minor axis is scaled down to the original aspect-ratio
-            const float minorScale = std::max(scale / majorScale, majorScale * maxMajorScale);
-
-            // if we have some scaling capacity left, scale homogeneously
-            const float homogeneousScale = scale / (majorScale * minorScale);
-
-            // finally, write the scale factors
-            float& majorRef = w > h ? mScale.x : mScale.y;
-            float& minorRef = w > h ? mScale.y : mScale.x;
-            majorRef = std::sqrt(homogeneousScale) * majorScale;
-            minorRef = std::sqrt(homogeneousScale) * minorScale;
+            // always clamp to the min/max scale range
+            const auto s = mScale;
+            mScale = clamp(s, options.minScale, options.maxScale);
+
+            // disable the integration term when we're outside the controllable range
+            // (i.e. we clamped). This help not to have to wait too long for the Integral term
+            // to kick in after a clamping event.
+            mDynamicResolutionController.setScaleClamped(mScale != s);
         } else {
-            // when scaling up, we're always using homogeneous scaling.
-            mScale = std::sqrt(scale);
+            // dynamic resolution isn't supported, only the level of detail hint is computed
+            mScale = 1.0f;
         }
-
+    } else if (options.enabled) {
         // always clamp to the min/max scale range
-        const auto s = mScale;
-        mScale = clamp(s, options.minScale, options.maxScale);
-
-        // disable the integration term when we're outside the controllable range
-        // (i.e. we clamped). This help not to have to wait too long for the Integral term
-        // to kick in after a clamping event.
-        mPidController.setIntegralInhibitionEnabled(mScale != s);
+        mScale = clamp(1.0f, options.minScale, options.maxScale);
     } else {
         mScale = 1.0f;
     }
@@ -293,6 +304,7 @@ float2 FView::updateScale(FEngine& engine,
         using duration_ms = duration<float, std::milli>;
         const float target = (1000.0f * float(frameRateOptions.interval)) / displayInfo.refreshRate;
         const float targetWithHeadroom = target * (1.0f - frameRateOptions.headRoomRatio);
+        PIDController const& pid = mDynamicResolutionController.getPidController();
         std::move(debugFrameHistory->begin() + 1,
                 debugFrameHistory->end(), debugFrameHistory->begin());
         debugFrameHistory->back() = {
@@ -301,9 +313,9 @@ float2 FView::updateScale(FEngine& engine,
                 .frameTime          = duration_cast<duration_ms>(info.frameTime).count(),
                 .frameTimeDenoised  = duration_cast<duration_ms>(info.denoisedFrameTime).count(),
                 .scale              = mScale.x * mScale.y,
-                .pid_e              = mPidController.getError(),
-                .pid_i              = mPidController.getIntegral(),
-                .pid_d              = mPidController.getDerivative()
+                .pid_e              = pid.getError(),
+                .pid_i              = pid.getIntegral(),
+                .pid_d              = pid.getDerivative()
         };
     }
 #endif
@@ -512,6 +524,9 @@ void FView::prepare(FEngine& engine, DriverApi& driver, RootArenaScope& rootAren
 
     FScene* const scene = getScene();
 
+    using clock = std::chrono::steady_clock;
+    clock::time_point start = clock::now();
+
     /*
      * Gather all information needed to render this scene. Apply the world origin to all
      * objects in the scene.
@@ -520,6 +535,8 @@ void FView::prepare(FEngine& engine, DriverApi& driver, RootArenaScope& rootAren
             cameraInfo.worldTransform,
             hasVSM());
 
+    mCpuTimings.prepare = clock::now() - start;
+
     /*
      * Light culling: runs in parallel with Renderable culling (below)
      */
@@ -554,6 +571,8 @@ void FView::prepare(FEngine& engine, DriverApi& driver, RootArenaScope& rootAren
 
     { // all the operations in this scope must happen sequentially
 
+        start = clock::now();
+
         Slice<Culler::result_type> cullingMask = renderableData.slice<FScene::VISIBLE_MASK>();
         std::uninitialized_fill(cullingMask.begin(), cullingMask.end(), 0);
 
@@ -564,6 +583,8 @@ void FView::prepare(FEngine& engine, DriverApi& driver, RootArenaScope& rootAren
 
         prepareVisibleRenderables(js, cullingFrustum, renderableData);
 
+        mCpuTimings.culling = clock::now() - start;
+
 
         /*
          * Shadowing: compute the shadow camera and cull shadow casters
@@ -597,17 +618,24 @@ void FView::prepare(FEngine& engine, DriverApi& driver, RootArenaScope& rootAren
             }
             // We need to pass viewMatrix by value here because it extends the scope of this
             // function.
+            // The froxelization time is written by the job, it can only be read after
+            // the job has been waited on.
             std::function<void(JobSystem&, JobSystem::Job*)> froxelizerWork =
-                    [&froxelizer = mFroxelizer, &engine, viewMatrix = cameraInfo.view, &lightData]
+                    [&froxelizer = mFroxelizer, &engine, viewMatrix = cameraInfo.view, &lightData,
+                     &froxelization = mCpuTimings.froxelization]
                             (JobSystem&, JobSystem::Job*) {
+                        clock::time_point const start = clock::now();
                         froxelizer.froxelizeLights(engine, viewMatrix, lightData);
+                        froxelization = clock::now() - start;
                     };
             froxelizeLightsJob = js.runAndRetain(js.createJob(nullptr, std::move(froxelizerWork)));
         }
 
         setFroxelizerSync(froxelizeLightsJob);
 
+        start = clock::now();
         prepareShadowing(engine, renderableData, lightData, cameraInfo);
+        mCpuTimings.shadows = clock::now() - start;
 
         /*
          * Partition the SoA so that renderables are partitioned w.r.t their visibility into the
@@ -632,6 +660,7 @@ void FView::prepare(FEngine& engine, DriverApi& driver, RootArenaScope& rootAren
         //       and rely on checking visibility in the loops
 
         SYSTRACE_NAME_BEGIN("Partitioning");
+        start = clock::now();
 
         // calculate the sorting key for all elements, based on their visibility
         uint8_t const* layers = renderableData.data<FScene::LAYERS>();
@@ -673,6 +702,7 @@ void FView::prepare(FEngine& engine, DriverApi& driver, RootArenaScope& rootAren
 
         mSpotLightShadowCasters = merged;
 
+        mCpuTimings.culling += clock::now() - start;
         SYSTRACE_NAME_END();
 
         // TODO: when any spotlight is used, `merged` ends-up being the whole list. However,
@@ -680,22 +710,35 @@ void FView::prepare(FEngine& engine, DriverApi& driver, RootArenaScope& rootAren
         //       e.g. could we deffer some of the prepareVisibleRenderables() to later?
         scene->prepareVisibleRenderables(merged);
 
-        // update those UBOs
-        const size_t size = merged.size() * sizeof(PerRenderableData);
-        if (size) {
+        // update those UBOs, renderables are stored at their scene's UBO slot so that only
+        // the ones that changed need to be uploaded.
+        mRenderableUboCache.uploadCount = 0;
+        mRenderableUboCache.uploadSize = 0;
+        const size_t slotCount = scene->getUboSlotCount();
+        const size_t size = slotCount * sizeof(PerRenderableData);
+        if (!merged.empty()) {
             if (mRenderableUBOSize < size) {
                 // allocate 1/3 extra, with a minimum of 16 objects
-                const size_t count = std::max(size_t(16u), (4u * merged.size() + 2u) / 3u);
+                const size_t count = std::max(size_t(16u), (4u * slotCount + 2u) / 3u);
                 mRenderableUBOSize = uint32_t(count * sizeof(PerRenderableData));
                 driver.destroyBufferObject(mRenderableUbh);
                 mRenderableUbh = driver.createBufferObject(
                         mRenderableUBOSize + sizeof(PerRenderableUib),
                         BufferObjectBinding::UNIFORM, BufferUsage::DYNAMIC);
+                // the new UBO is empty
+                mRenderableUboCache.invalidate();
             } else {
                 // TODO: should we shrink the underlying UBO at some point?
             }
             assert_invariant(mRenderableUbh);
-            scene->updateUBOs(merged, mRenderableUbh);
+            scene->updateUBOs(merged, mRenderableUbh, mRenderableUboCache);
+
+            // the instances that are not visible from the camera are skipped by its passes,
+            // this needs the data of all the instances uploaded by updateUBOs().
+            if (isFrustumCullingEnabled() && !hasStereo()) {
+                mInstanceCuller.cull(engine, scene->getRenderableData(), mVisibleRenderables,
+                        cullingFrustum);
+            }
 
             mCommonRenderableDescriptorSet.setBuffer(
                     +PerRenderableBindingPoints::OBJECT_UNIFORMS, mRenderableUbh,
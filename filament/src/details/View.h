@@ -24,7 +24,8 @@
 #include "FrameHistory.h"
 #include "FrameInfo.h"
 #include "Froxelizer.h"
-#include "PIDController.h"
+#include "InstanceCuller.h"
+#include "DynamicResolutionController.h"
 #include "ShadowMapManager.h"
 
 #include "ds/ColorPassDescriptorSet.h"
@@ -176,6 +177,19 @@ public:
     void commitUniformsAndSamplers(backend::DriverApi& driver) const noexcept;
 
     utils::JobSystem::Job* getFroxelizerSync() const noexcept { return mFroxelizerSync; }
+
+    // CPU timings of the last prepare() and render of this view. The froxelization time is
+    // only valid once the froxelizer sync has been waited on.
+    ViewCpuTimingsImpl& getCpuTimings() noexcept { return mCpuTimings; }
+    ViewCpuTimingsImpl const& getCpuTimings() const noexcept { return mCpuTimings; }
+
+    // renderables UBO updates of the last prepare()
+    uint32_t getRenderableUniformUploadCount() const noexcept {
+        return mRenderableUboCache.uploadCount;
+    }
+    uint32_t getRenderableUniformUploadSize() const noexcept {
+        return mRenderableUboCache.uploadSize;
+    }
     void setFroxelizerSync(utils::JobSystem::Job* sync) noexcept { mFroxelizerSync = sync; }
 
     // ultimately decides to use the DIR variant
@@ -315,6 +329,11 @@ public:
         return mDynamicResolution;
     }
 
+    float getLevelOfDetailHint() const noexcept {
+        return mIsDynamicResolutionRequested ?
+                mDynamicResolutionController.getLevelOfDetailHint() : 1.0f;
+    }
+
     void setRenderQuality(RenderQuality const& renderQuality) noexcept {
         mRenderQuality = renderQuality;
     }
@@ -529,6 +548,7 @@ private:
     FCamera* mViewingCamera = nullptr;
 
     mutable Froxelizer mFroxelizer;
+    ViewCpuTimingsImpl mCpuTimings;
     utils::JobSystem::Job* mFroxelizerSync = nullptr;
 
     Viewport mViewport;
@@ -564,10 +584,11 @@ private:
     utils::Entity mFogEntity{};
     bool mIsStereoSupported : 1;
 
-    PIDController mPidController;
+    DynamicResolutionController mDynamicResolutionController;
     DynamicResolutionOptions mDynamicResolution;
     math::float2 mScale = 1.0f;
     bool mIsDynamicResolutionSupported = false;
+    bool mIsDynamicResolutionRequested = false;
 
     RenderQuality mRenderQuality;
 
@@ -585,6 +606,8 @@ private:
     Range mVisibleDirectionalShadowCasters;
     Range mSpotLightShadowCasters;
     uint32_t mRenderableUBOSize = 0;
+    FScene::RenderableUboCache mRenderableUboCache;
+    InstanceCuller mInstanceCuller;
     mutable bool mHasDirectionalLighting = false;
     mutable bool mHasDynamicLighting = false;
     mutable bool mHasShadowing = false;
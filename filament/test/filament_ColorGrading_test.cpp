@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <filament/ColorGrading.h>
+#include <filament/Engine.h>
+#include <filament/ToneMapper.h>
+
+#include "details/ColorGrading.h"
+#include "details/Engine.h"
+
+#include <math/vec3.h>
+#include <math/vec4.h>
+
+#include <vector>
+
+#include <string.h>
+
+using namespace filament;
+using namespace filament::math;
+
+namespace {
+
+// the default dimension, any other one counts as an adjustment
+constexpr uint8_t DIMENSION = 32;
+constexpr size_t ELEMENT_COUNT = DIMENSION * DIMENSION * DIMENSION;
+
+struct Lut {
+    std::vector<half4> data = std::vector<half4>(ELEMENT_COUNT);
+    std::vector<uint32_t> converted = std::vector<uint32_t>(ELEMENT_COUNT);
+
+    bool operator==(Lut const& rhs) const noexcept {
+        return !memcmp(data.data(), rhs.data.data(), ELEMENT_COUNT * sizeof(half4)) &&
+               !memcmp(converted.data(), rhs.converted.data(), ELEMENT_COUNT * sizeof(uint32_t));
+    }
+};
+
+class ColorGradingTest : public testing::Test {
+protected:
+    void SetUp() override {
+        engine = downcast(Engine::create(Engine::Backend::NOOP));
+    }
+
+    void TearDown() override {
+        Engine::destroy((Engine**) &engine);
+    }
+
+    ColorGrading::Builder createBuilder(ToneMapper const& toneMapper, float exposure,
+            float contrast) {
+        ColorGrading::Builder builder;
+        builder.dimensions(DIMENSION)
+                .toneMapper(&toneMapper)
+                .exposure(exposure)
+                .contrast(contrast)
+                .vibrance(1.2f)
+                .curves(float3{ 0.9f }, float3{ 1.1f }, float3{ 0.95f });
+        // build() finds out whether the builder has adjustments, as the engine would
+        engine->destroy(downcast(builder.build(*engine)));
+        return builder;
+    }
+
+    Lut generate(ColorGrading::Builder const& builder, FColorGrading::StageCache* cache) {
+        Lut lut;
+        FColorGrading::generateLut(engine->getJobSystem(), builder, cache,
+                lut.data.data(), lut.converted.data());
+        return lut;
+    }
+
+    // returns whether the LUT of builder is in the engine's LUT cache, and checks its content
+    bool isCached(ColorGrading::Builder const& builder) {
+        FColorGrading::LutKey key;
+        if (!FColorGrading::getLutKey(builder, &key)) {
+            return false;
+        }
+        for (auto const& entry : engine->getColorGradingLutCache().entries) {
+            if (!memcmp(&entry.key, &key, sizeof(key))) {
+                Lut const lut = generate(builder, nullptr);
+                EXPECT_EQ(entry.data.size(), ELEMENT_COUNT * sizeof(uint32_t));
+                EXPECT_FALSE(memcmp(entry.data.data(), lut.converted.data(), entry.data.size()));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    FEngine* engine = nullptr;
+};
+
+// a tone mapper unknown to the engine
+struct HalfToneMapper final : public ToneMapper {
+    float3 operator()(float3 c) const noexcept override { return c * 0.5f; }
+};
+
+} // anonymous namespace
+
+TEST_F(ColorGradingTest, CachedStagesAreBitIdentical) {
+    ACESToneMapper aces;
+    FilmicToneMapper filmic;
+
+    FColorGrading::StageCache cache;
+    auto expectSameAsUncached = [&](ColorGrading::Builder const& builder) {
+        EXPECT_TRUE(generate(builder, &cache) == generate(builder, nullptr));
+    };
+
+    expectSameAsUncached(createBuilder(aces, 0.5f, 1.2f));
+    EXPECT_EQ(cache.inputData.size(), ELEMENT_COUNT);
+    EXPECT_EQ(cache.gradingData.size(), ELEMENT_COUNT);
+
+    // the grading stage changes, then the tone mapper, then the input stage
+    expectSameAsUncached(createBuilder(aces, 0.5f, 1.5f));
+    expectSameAsUncached(createBuilder(filmic, 0.5f, 1.5f));
+    expectSameAsUncached(createBuilder(filmic, -1.0f, 1.5f));
+
+    // everything is cached
+    ColorGrading::Builder const last = createBuilder(filmic, -1.0f, 1.5f);
+    EXPECT_TRUE(generate(last, &cache) == generate(last, &cache));
+    expectSameAsUncached(last);
+
+    // without adjustments the grading stage is skipped
+    ColorGrading::Builder neutral;
+    neutral.dimensions(DIMENSION).toneMapper(&aces);
+    engine->destroy(downcast(neutral.build(*engine)));
+    expectSameAsUncached(neutral);
+    EXPECT_TRUE(cache.gradingData.empty());
+}
+
+TEST_F(ColorGradingTest, CacheIsReleasedWithLastColorGrading) {
+    FColorGrading::StageCache const& cache = engine->getColorGradingStageCache();
+    ACESToneMapper aces;
+
+    ColorGrading::Builder firstBuilder = createBuilder(aces, 0.5f, 1.2f);
+    ColorGrading::Builder secondBuilder = createBuilder(aces, 0.5f, 1.5f);
+
+    // the stages are only used when the LUTs aren't cached
+    engine->getColorGradingLutCache().entries.clear();
+
+    ColorGrading* first = firstBuilder.build(*engine);
+    EXPECT_EQ(cache.owner, downcast(first));
+    EXPECT_FALSE(cache.inputData.empty());
+
+    ColorGrading* second = secondBuilder.build(*engine);
+    EXPECT_EQ(cache.owner, downcast(second));
+
+    // the stages belong to the last ColorGrading
+    engine->destroy(downcast(first));
+    EXPECT_FALSE(cache.inputData.empty());
+
+    engine->destroy(downcast(second));
+    EXPECT_EQ(cache.owner, nullptr);
+    EXPECT_TRUE(cache.inputData.empty());
+    EXPECT_TRUE(cache.gradingData.empty());
+}
+
+TEST_F(ColorGradingTest, LutIsReusedAfterColorGradingIsDestroyed) {
+    FColorGrading::LutCache const& cache = engine->getColorGradingLutCache();
+    ACESToneMapper aces;
+
+    // createBuilder() builds and destroys a ColorGrading, its LUT stays in the cache
+    ColorGrading::Builder builder = createBuilder(aces, 0.5f, 1.2f);
+    EXPECT_TRUE(isCached(builder));
+
+    // building it again doesn't add a LUT
+    size_t const count = cache.entries.size();
+    engine->destroy(downcast(builder.build(*engine)));
+    EXPECT_EQ(cache.entries.size(), count);
+
+    // neither does using another instance of the same tone mapper
+    ACESToneMapper other;
+    EXPECT_TRUE(isCached(createBuilder(other, 0.5f, 1.2f)));
+    EXPECT_EQ(cache.entries.size(), count);
+}
+
+TEST_F(ColorGradingTest, LutCacheUsesToneMapperParameters) {
+    FColorGrading::LutCache const& cache = engine->getColorGradingLutCache();
+
+    // the tone mapper changes without its address changing
+    GenericToneMapper generic;
+    ColorGrading::Builder builder = createBuilder(generic, 0.0f, 1.2f);
+    EXPECT_TRUE(isCached(builder));
+    generic.setContrast(1.2f);
+    EXPECT_FALSE(isCached(builder));
+    engine->destroy(downcast(builder.build(*engine)));
+    EXPECT_TRUE(isCached(builder));
+
+    // the LUTs made with a custom tone mapper are not kept
+    HalfToneMapper half;
+    size_t const count = cache.entries.size();
+    ColorGrading::Builder custom = createBuilder(half, 0.0f, 1.2f);
+    EXPECT_FALSE(isCached(custom));
+    EXPECT_EQ(cache.entries.size(), count);
+}
+
+TEST_F(ColorGradingTest, LutCacheIsBounded) {
+    FColorGrading::LutCache const& cache = engine->getColorGradingLutCache();
+    FilmicToneMapper filmic;
+
+    std::vector<ColorGrading::Builder> builders;
+    for (size_t i = 0; i < FColorGrading::LutCache::CAPACITY + 2; i++) {
+        builders.push_back(createBuilder(filmic, float(i), 1.2f));
+    }
+    EXPECT_EQ(cache.entries.size(), FColorGrading::LutCache::CAPACITY);
+
+    // the least recently used LUTs were evicted
+    EXPECT_FALSE(isCached(builders[0]));
+    EXPECT_FALSE(isCached(builders[1]));
+    for (size_t i = 2; i < builders.size(); i++) {
+        EXPECT_TRUE(isCached(builders[i]));
+    }
+}
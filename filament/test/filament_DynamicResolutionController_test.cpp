@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "DynamicResolutionController.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace filament;
+
+using Bottleneck = DynamicResolutionController::Bottleneck;
+
+namespace {
+
+// Simulates a frame whose GPU time is proportional to the number of pixels, and whose CPU times
+// don't depend on the resolution.
+struct Simulation {
+    float gpuTimeAtFullResolution;  // ms
+    float mainThreadTime;           // ms
+    float backendThreadTime;        // ms
+    float target = 1000.0f / 60.0f; // ms
+    float minScale = 0.25f;         // in pixels
+    float scale = 1.0f;             // in pixels
+
+    DynamicResolutionController controller;
+
+    Simulation(float gpu, float main, float backend) noexcept
+            : gpuTimeAtFullResolution(gpu), mainThreadTime(main), backendThreadTime(backend) {
+        // same gains as FView with the default FrameRateOptions
+        controller.setGains(1.0f - std::exp(-1.0f / 8.0f), 0.002f, 0.0f);
+    }
+
+    float gpuTime() const noexcept {
+        return gpuTimeAtFullResolution * scale;
+    }
+
+    void run(int frames) noexcept {
+        for (int i = 0; i < frames; i++) {
+            float const command = controller.update(
+                    { gpuTime(), mainThreadTime, backendThreadTime }, target);
+            float const s = scale * command;
+            scale = std::clamp(s, minScale, 1.0f);
+            controller.setScaleClamped(scale != s);
+        }
+    }
+};
+
+} // anonymous namespace
+
+TEST(DynamicResolutionController, GpuBoundConvergesToTarget) {
+    Simulation sim(30.0f, 8.0f, 6.0f);
+    sim.run(300);
+
+    EXPECT_EQ(sim.controller.getBottleneck(), Bottleneck::GPU);
+    EXPECT_LT(sim.scale, 1.0f);
+    EXPECT_NEAR(sim.gpuTime() / sim.target, 1.0f, 0.1f);
+    EXPECT_FLOAT_EQ(sim.controller.getLevelOfDetailHint(), 1.0f);
+}
+
+TEST(DynamicResolutionController, GpuBoundWithHeadroomStaysAtFullResolution) {
+    Simulation sim(10.0f, 8.0f, 6.0f);
+    sim.run(300);
+
+    EXPECT_EQ(sim.controller.getBottleneck(), Bottleneck::GPU);
+    EXPECT_FLOAT_EQ(sim.scale, 1.0f);
+    EXPECT_FLOAT_EQ(sim.controller.getLevelOfDetailHint(), 1.0f);
+}
+
+TEST(DynamicResolutionController, CpuBoundDoesNotLowerResolution) {
+    Simulation sim(10.0f, 25.0f, 12.0f);
+    sim.run(300);
+
+    EXPECT_EQ(sim.controller.getBottleneck(), Bottleneck::CPU);
+    EXPECT_FLOAT_EQ(sim.scale, 1.0f);
+
+    // the CPU work must be reduced by the ratio of the target to the slowest thread
+    EXPECT_NEAR(sim.controller.getLevelOfDetailHint(), sim.target / 25.0f, 1e-3f);
+}
+
+TEST(DynamicResolutionController, CpuBoundRaisesResolutionWithGpuHeadroom) {
+    Simulation sim(10.0f, 12.0f, 25.0f);
+    sim.scale = 0.5f;
+    sim.run(300);
+
+    EXPECT_EQ(sim.controller.getBottleneck(), Bottleneck::CPU);
+    EXPECT_FLOAT_EQ(sim.scale, 1.0f);
+    EXPECT_LT(sim.controller.getLevelOfDetailHint(), 1.0f);
+}
+
+TEST(DynamicResolutionController, BecomingCpuBoundStopsLoweringResolution) {
+    Simulation sim(30.0f, 8.0f, 6.0f);
+    sim.run(300);
+    EXPECT_EQ(sim.controller.getBottleneck(), Bottleneck::GPU);
+    float const scale = sim.scale;
+
+    // the CPU becomes the bottleneck, over the frame budget
+    sim.mainThreadTime = 30.0f;
+    sim.run(300);
+
+    EXPECT_EQ(sim.controller.getBottleneck(), Bottleneck::CPU);
+    EXPECT_GE(sim.scale, scale);
+    EXPECT_LT(sim.controller.getLevelOfDetailHint(), 1.0f);
+}
+
+TEST(DynamicResolutionController, NoGpuTime) {
+    Simulation sim(0.0f, 25.0f, 12.0f);
+    sim.run(300);
+
+    EXPECT_EQ(sim.controller.getBottleneck(), Bottleneck::UNKNOWN);
+    EXPECT_FLOAT_EQ(sim.scale, 1.0f);
+    EXPECT_NEAR(sim.controller.getLevelOfDetailHint(), sim.target / 25.0f, 1e-3f);
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <filament/Box.h>
+#include <filament/Camera.h>
+#include <filament/DebugRegistry.h>
+#include <filament/Engine.h>
+#include <filament/Frustum.h>
+#include <filament/IndexBuffer.h>
+#include <filament/InstanceBuffer.h>
+#include <filament/Material.h>
+#include <filament/RenderableManager.h>
+#include <filament/Renderer.h>
+#include <filament/Scene.h>
+#include <filament/Skybox.h>
+#include <filament/VertexBuffer.h>
+#include <filament/View.h>
+#include <filament/Viewport.h>
+
+#include "InstanceCuller.h"
+
+#include "details/Engine.h"
+#include "details/Scene.h"
+
+#include <private/filament/EngineEnums.h>
+
+#include <backend/BufferDescriptor.h>
+#include <backend/DriverEnums.h>
+#include <backend/PixelBufferDescriptor.h>
+
+#include <utils/Entity.h>
+#include <utils/EntityManager.h>
+
+#include <math/mat4.h>
+#include <math/vec3.h>
+
+#include <vector>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+using namespace filament;
+using namespace filament::math;
+using namespace backend;
+
+namespace {
+
+constexpr uint32_t kSize = 32;
+
+// a triangle of size 1, centered on the origin
+constexpr float3 kTriangle[3] = {{ -0.5f, -0.5f, 0.0f }, { 0.5f, -0.5f, 0.0f }, { 0.0f, 0.5f, 0.0f }};
+constexpr uint16_t kIndices[3] = { 0, 1, 2 };
+constexpr Box kTriangleBox = {{ 0.0f, 0.0f, 0.0f }, { 0.5f, 0.5f, 0.0f }};
+
+// The camera is at the origin and looks down -z, the first 4 instances are in front of it.
+std::vector<mat4f> getInstanceTransforms() {
+    return {
+            mat4f::translation(float3{ -1.5f, 0.0f, -5.0f }),
+            mat4f::translation(float3{ -0.5f, 0.0f, -5.0f }),
+            mat4f::translation(float3{  0.5f, 0.0f, -5.0f }),
+            mat4f::translation(float3{  1.5f, 0.0f, -5.0f }),
+            mat4f::translation(float3{  0.0f, 0.0f,  5.0f }),      // behind
+            mat4f::translation(float3{ 50.0f, 0.0f, -5.0f }),      // right
+            mat4f::translation(float3{-50.0f, 0.0f, -5.0f }),      // left
+            mat4f::translation(float3{  0.0f, 0.0f, -500.0f }) };  // past the far plane
+}
+
+constexpr uint32_t kVisibleInstanceCount = 4;
+
+// number of pixels that are not the blue background
+size_t getCoveredPixelCount(std::vector<uint8_t> const& rgba) {
+    size_t count = 0;
+    for (size_t i = 0; i < rgba.size(); i += 4) {
+        count += rgba[i] != 0 || rgba[i + 1] != 0 || rgba[i + 2] != 0xff;
+    }
+    return count;
+}
+
+} // anonymous namespace
+
+TEST(InstanceCullerTest, CullsEachInstance) {
+    Frustum const frustum(mat4f::perspective(60.0f, 1.0f, 0.1f, 100.0f));
+    std::vector<mat4f> const transforms = getInstanceTransforms();
+
+    uint32_t visible[CONFIG_MAX_INSTANCES];
+    size_t const count = InstanceCuller::cull(frustum, kTriangleBox, mat4f{},
+            transforms.data(), transforms.size(), visible);
+
+    ASSERT_EQ(count, kVisibleInstanceCount);
+    for (uint32_t i = 0; i < kVisibleInstanceCount; i++) {
+        EXPECT_EQ(visible[i], i);
+    }
+}
+
+TEST(InstanceCullerTest, AppliesTheRootTransform) {
+    Frustum const frustum(mat4f::perspective(60.0f, 1.0f, 0.1f, 100.0f));
+    std::vector<mat4f> const transforms = getInstanceTransforms();
+
+    // moving everything 50 units to the right leaves only the instance that was on the left
+    uint32_t visible[CONFIG_MAX_INSTANCES];
+    size_t const count = InstanceCuller::cull(frustum, kTriangleBox,
+            mat4f::translation(float3{ 50.0f, 0.0f, 0.0f }),
+            transforms.data(), transforms.size(), visible);
+
+    ASSERT_EQ(count, 1u);
+    EXPECT_EQ(visible[0], 6u);
+}
+
+class InstanceCullingTest : public testing::Test {
+protected:
+    void SetUp() override {
+        mEngine = Engine::create(Engine::Backend::OPENGL);
+        ASSERT_NE(mEngine, nullptr);
+        mSwapChain = mEngine->createSwapChain(kSize, kSize);
+        mRenderer = mEngine->createRenderer();
+        mScene = mEngine->createScene();
+        mSkybox = Skybox::Builder().color({ 0.0f, 0.0f, 1.0f, 1.0f }).build(*mEngine);
+        mScene->setSkybox(mSkybox);
+
+        mCameraEntity = utils::EntityManager::get().create();
+        mCamera = mEngine->createCamera(mCameraEntity);
+        mCamera->setProjection(60.0, 1.0, 0.1, 100.0);
+
+        mView = mEngine->createView();
+        mView->setViewport({ 0, 0, kSize, kSize });
+        mView->setScene(mScene);
+        mView->setCamera(mCamera);
+        mView->setPostProcessingEnabled(false);
+        mView->setShadowingEnabled(false);
+        mView->setDithering(View::Dithering::NONE);
+
+        mVertexBuffer = VertexBuffer::Builder()
+                .vertexCount(3)
+                .bufferCount(1)
+                .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+                .build(*mEngine);
+        mVertexBuffer->setBufferAt(*mEngine, 0, { kTriangle, sizeof(kTriangle) });
+        mIndexBuffer = IndexBuffer::Builder()
+                .indexCount(3)
+                .bufferType(IndexBuffer::IndexType::USHORT)
+                .build(*mEngine);
+        mIndexBuffer->setBuffer(*mEngine, { kIndices, sizeof(kIndices) });
+    }
+
+    void TearDown() override {
+        if (!mEngine) {
+            return;
+        }
+        mEngine->destroy(mIndexBuffer);
+        mEngine->destroy(mVertexBuffer);
+        mEngine->destroyCameraComponent(mCameraEntity);
+        utils::EntityManager::get().destroy(mCameraEntity);
+        mEngine->destroy(mView);
+        mEngine->destroy(mScene);
+        mEngine->destroy(mSkybox);
+        mEngine->destroy(mRenderer);
+        mEngine->destroy(mSwapChain);
+        Engine::destroy(&mEngine);
+    }
+
+    // Renders the instances, culled or not, and returns the image. `visibleCount` is set to the
+    // number of instances drawn by the color pass.
+    std::vector<uint8_t> render(bool culling, uint32_t* visibleCount) {
+        std::vector<mat4f> const transforms = getInstanceTransforms();
+        InstanceBuffer::Builder builder(transforms.size());
+        builder.localTransforms(transforms.data());
+        if (culling) {
+            builder.culling(kTriangleBox);
+        }
+        InstanceBuffer* const instanceBuffer = builder.build(*mEngine);
+
+        utils::Entity const renderable = utils::EntityManager::get().create();
+        RenderableManager::Builder(1)
+                .boundingBox({{ 0.0f, 0.0f, 0.0f }, { 1000.0f, 1000.0f, 1000.0f }})
+                .geometry(0, RenderableManager::PrimitiveType::TRIANGLES,
+                        mVertexBuffer, mIndexBuffer)
+                .material(0, mEngine->getDefaultMaterial()->getDefaultInstance())
+                .instances(transforms.size(), instanceBuffer)
+                .culling(false)
+                .castShadows(false)
+                .receiveShadows(false)
+                .build(*mEngine, renderable);
+        mScene->addEntity(renderable);
+
+        std::vector<uint8_t> image(kSize * kSize * 4);
+        if (mRenderer->beginFrame(mSwapChain)) {
+            mRenderer->render(mView);
+            mRenderer->readPixels(0, 0, kSize, kSize, PixelBufferDescriptor(
+                    image.data(), image.size(), PixelDataFormat::RGBA, PixelDataType::UBYTE));
+            mRenderer->endFrame();
+        }
+        mEngine->flushAndWait();
+
+        *visibleCount = getVisibleCount(transforms.size());
+
+        mScene->remove(renderable);
+        mEngine->destroy(renderable);
+        utils::EntityManager::get().destroy(renderable);
+        mEngine->destroy(instanceBuffer);
+        return image;
+    }
+
+    // reads the result of the instance culling of the last frame
+    uint32_t getVisibleCount(uint32_t instanceCount) {
+        auto const& soa = downcast(mScene)->getRenderableData();
+        for (size_t i = 0, c = soa.size(); i < c; i++) {
+            if (soa.elementAt<FScene::INSTANCES>(i).buffer) {
+                FScene::InstanceCullingInfo const& info = soa.elementAt<FScene::INSTANCE_CULLING>(i);
+                if (!info.culled) {
+                    return instanceCount;
+                }
+                if (!info.drawArgs) {
+                    return info.visibleCount;
+                }
+                DrawIndexedIndirectArgs args{};
+                downcast(mEngine)->getDriverApi().readBufferSubData(info.drawArgs,
+                        info.firstDrawArgs * sizeof(DrawIndexedIndirectArgs),
+                        sizeof(DrawIndexedIndirectArgs), { &args, sizeof(args) });
+                mEngine->flushAndWait();
+                EXPECT_EQ(args.indexCount, 3u);
+                return args.instanceCount;
+            }
+        }
+        return 0;
+    }
+
+    Engine* mEngine = nullptr;
+    SwapChain* mSwapChain = nullptr;
+    Renderer* mRenderer = nullptr;
+    Scene* mScene = nullptr;
+    Skybox* mSkybox = nullptr;
+    View* mView = nullptr;
+    Camera* mCamera = nullptr;
+    utils::Entity mCameraEntity;
+    VertexBuffer* mVertexBuffer = nullptr;
+    IndexBuffer* mIndexBuffer = nullptr;
+};
+
+TEST_F(InstanceCullingTest, CpuCullingDrawsTheVisibleInstances) {
+    mEngine->getDebugRegistry().setProperty("d.renderer.disable_gpu_instance_culling", true);
+
+    uint32_t allCount = 0;
+    std::vector<uint8_t> const reference = render(false, &allCount);
+    EXPECT_EQ(allCount, getInstanceTransforms().size());
+
+    EXPECT_GT(getCoveredPixelCount(reference), 0u);
+
+    uint32_t visibleCount = 0;
+    std::vector<uint8_t> const culled = render(true, &visibleCount);
+    EXPECT_EQ(visibleCount, kVisibleInstanceCount);
+    EXPECT_EQ(culled, reference);
+}
+
+TEST_F(InstanceCullingTest, GpuCullingDrawsTheVisibleInstances) {
+    if (!InstanceCuller::isGpuCullingSupported(*downcast(mEngine))) {
+        GTEST_SKIP() << "compute or indirect draws are not supported";
+    }
+
+    uint32_t allCount = 0;
+    std::vector<uint8_t> const reference = render(false, &allCount);
+    EXPECT_EQ(allCount, getInstanceTransforms().size());
+    EXPECT_GT(getCoveredPixelCount(reference), 0u);
+
+    uint32_t visibleCount = 0;
+    std::vector<uint8_t> const culled = render(true, &visibleCount);
+    EXPECT_EQ(visibleCount, kVisibleInstanceCount);
+    EXPECT_EQ(culled, reference);
+}
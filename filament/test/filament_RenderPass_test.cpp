@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <filament/Engine.h>
+
+#include "RenderPass.h"
+
+#include "details/Engine.h"
+
+#include <backend/DriverEnums.h>
+#include <backend/Handle.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+using namespace filament;
+using namespace filament::backend;
+
+class RenderPassTest : public testing::Test {
+protected:
+    using Command = RenderPass::Command;
+    using Pass = RenderPass::Pass;
+
+    void SetUp() override {
+        engine = downcast(Engine::create(Engine::Backend::NOOP));
+    }
+
+    void TearDown() override {
+        ::free(args);
+        Engine::destroy((Engine**) &engine);
+    }
+
+    // a color pass draw command of `rph`, drawing `indexCount` indices from `indexOffset`
+    static Command draw(uint32_t rph, uint32_t indexOffset, uint32_t indexCount) {
+        Command command{};
+        command.key = uint64_t(Pass::COLOR) | uint64_t(RenderPass::CustomCommand::PASS);
+        command.info.mi = reinterpret_cast<FMaterialInstance const*>(uintptr_t(0x1000));
+        command.info.rph = Handle<HwRenderPrimitive>(rph);
+        command.info.vbih = Handle<HwVertexBufferInfo>(1);
+        command.info.dsh = Handle<HwDescriptorSet>(1);
+        command.info.indexOffset = indexOffset;
+        command.info.indexCount = indexCount;
+        command.info.instanceCount = 1;
+        return command;
+    }
+
+    // runs the merging part of multidrawify() and returns the remaining commands
+    std::vector<Command> merge(std::vector<Command> commands) {
+        Command* const last = RenderPass::mergeMultiDraws(
+                commands.data(), commands.data() + commands.size(), args, argsCount);
+        commands.resize(last - commands.data());
+        return commands;
+    }
+
+    FEngine* engine = nullptr;
+    DrawIndexedIndirectArgs* args = nullptr;
+    uint32_t argsCount = 0;
+};
+
+TEST_F(RenderPassTest, MultiDrawIndirectEnabled) {
+    // the NOOP backend reports multi-draw indirect support, so it can be turned on
+    EXPECT_FALSE(engine->isMultiDrawIndirectEnabled());
+    engine->setMultiDrawIndirectEnabled(true);
+    EXPECT_TRUE(engine->isMultiDrawIndirectEnabled());
+    engine->setMultiDrawIndirectEnabled(false);
+    EXPECT_FALSE(engine->isMultiDrawIndirectEnabled());
+}
+
+TEST_F(RenderPassTest, MultiDrawMergesRuns) {
+    std::vector<Command> const commands = merge({
+            draw(1, 0, 30),
+            draw(1, 30, 60),
+            draw(1, 90, 12) });
+
+    // the run is replaced by a single multi-draw, the other commands are trimmed
+    ASSERT_EQ(commands.size(), 1u);
+    EXPECT_TRUE(commands[0].info.hasMultiDraw);
+    EXPECT_EQ(commands[0].info.indexOffset, 0u);    // first draw arguments
+    EXPECT_EQ(commands[0].info.indexCount, 3u);     // draw count
+
+    // one argument per merged draw, in order
+    ASSERT_NE(args, nullptr);
+    ASSERT_EQ(argsCount, 3u);
+    uint32_t const firstIndex[] = { 0, 30, 90 };
+    uint32_t const indexCount[] = { 30, 60, 12 };
+    for (uint32_t i = 0; i < argsCount; i++) {
+        EXPECT_EQ(args[i].indexCount, indexCount[i]);
+        EXPECT_EQ(args[i].instanceCount, 1u);
+        EXPECT_EQ(args[i].firstIndex, firstIndex[i]);
+        EXPECT_EQ(args[i].baseVertex, 0);
+        EXPECT_EQ(args[i].baseInstance, 0u);
+    }
+}
+
+TEST_F(RenderPassTest, MultiDrawKeepsIncompatibleNeighbours) {
+    std::vector<Command> input = {
+            draw(1, 0, 3),
+            draw(1, 3, 3),
+            draw(2, 0, 6),      // different primitive
+            draw(3, 0, 6),
+            draw(3, 6, 6),
+            draw(3, 12, 6),
+            draw(3, 18, 6) };
+    input[6].info.uboSlot = 1; // different per-renderable data
+
+    std::vector<Command> const commands = merge(input);
+
+    ASSERT_EQ(commands.size(), 4u);
+
+    // first run: 2 draws starting at argument 0
+    EXPECT_TRUE(commands[0].info.hasMultiDraw);
+    EXPECT_EQ(commands[0].info.rph, Handle<HwRenderPrimitive>(1));
+    EXPECT_EQ(commands[0].info.indexOffset, 0u);
+    EXPECT_EQ(commands[0].info.indexCount, 2u);
+
+    // the lone draw is left alone
+    EXPECT_FALSE(commands[1].info.hasMultiDraw);
+    EXPECT_EQ(commands[1].info.rph, Handle<HwRenderPrimitive>(2));
+    EXPECT_EQ(commands[1].info.indexOffset, 0u);
+    EXPECT_EQ(commands[1].info.indexCount, 6u);
+
+    // second run: 3 draws starting at argument 2
+    EXPECT_TRUE(commands[2].info.hasMultiDraw);
+    EXPECT_EQ(commands[2].info.rph, Handle<HwRenderPrimitive>(3));
+    EXPECT_EQ(commands[2].info.indexOffset, 2u);
+    EXPECT_EQ(commands[2].info.indexCount, 3u);
+
+    // the draw using a different UBO slot can't join the run
+    EXPECT_FALSE(commands[3].info.hasMultiDraw);
+    EXPECT_EQ(commands[3].info.uboSlot, 1u);
+    EXPECT_EQ(commands[3].info.indexOffset, 18u);
+    EXPECT_EQ(commands[3].info.indexCount, 6u);
+
+    ASSERT_EQ(argsCount, 5u);
+    EXPECT_EQ(args[1].firstIndex, 3u);
+    EXPECT_EQ(args[4].firstIndex, 12u);
+}
+
+TEST_F(RenderPassTest, MultiDrawSkipsCustomCommands) {
+    std::vector<Command> input = {
+            draw(1, 0, 3),
+            draw(1, 3, 3) };
+    input[1].key = uint64_t(Pass::COLOR) | uint64_t(RenderPass::CustomCommand::EPILOG);
+
+    std::vector<Command> const commands = merge(input);
+
+    // nothing to merge: no arguments are allocated and the commands are untouched
+    ASSERT_EQ(commands.size(), 2u);
+    EXPECT_FALSE(commands[0].info.hasMultiDraw);
+    EXPECT_FALSE(commands[1].info.hasMultiDraw);
+    EXPECT_EQ(args, nullptr);
+    EXPECT_EQ(argsCount, 0u);
+}
+
+TEST_F(RenderPassTest, MultiDrawSkipsGpuCulledInstances) {
+    // the instance counts of GPU culled instances are in draw arguments written by the GPU
+    std::vector<Command> input = {
+            draw(1, 0, 3),
+            draw(1, 1, 3) };
+    for (Command& command : input) {
+        command.info.hasHybridInstancing = true;
+        command.info.hasInstanceCulling = true;
+        command.info.drawArgs = Handle<HwBufferObject>(1);
+    }
+
+    std::vector<Command> const commands = merge(input);
+
+    ASSERT_EQ(commands.size(), 2u);
+    EXPECT_FALSE(commands[0].info.hasMultiDraw);
+    EXPECT_FALSE(commands[1].info.hasMultiDraw);
+    EXPECT_EQ(commands[0].info.indexOffset, 0u);
+    EXPECT_EQ(commands[1].info.indexOffset, 1u);
+    EXPECT_EQ(args, nullptr);
+}
+
+TEST_F(RenderPassTest, MultiDrawKeepsInstanceCullingApart) {
+    // CPU culled instances are read from another part of the instance buffer
+    std::vector<Command> input = {
+            draw(1, 0, 3),
+            draw(1, 3, 3),
+            draw(1, 6, 3) };
+    for (Command& command : input) {
+        command.info.hasHybridInstancing = true;
+    }
+    input[1].info.hasInstanceCulling = true;
+    input[2].info.hasInstanceCulling = true;
+
+    std::vector<Command> const commands = merge(input);
+
+    ASSERT_EQ(argsCount, 2u);
+    ASSERT_EQ(commands.size(), 2u);
+    EXPECT_FALSE(commands[0].info.hasMultiDraw);
+    EXPECT_FALSE(commands[0].info.hasInstanceCulling);
+    EXPECT_TRUE(commands[1].info.hasMultiDraw);
+    EXPECT_TRUE(commands[1].info.hasInstanceCulling);
+    EXPECT_EQ(args[0].firstIndex, 3u);
+    EXPECT_EQ(args[1].firstIndex, 6u);
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <filament/Engine.h>
+
+#include "UniformBufferArena.h"
+
+#include "details/Engine.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace filament;
+
+using Allocation = UniformBufferArena::Allocation;
+
+namespace {
+
+constexpr uint32_t ALIGNMENT = UniformBufferArena::ALIGNMENT;
+constexpr uint32_t PAGE_SIZE = UniformBufferArena::PAGE_SIZE;
+constexpr uint32_t SLOTS_PER_PAGE = PAGE_SIZE / ALIGNMENT;
+
+class UniformBufferArenaTest : public testing::Test {
+protected:
+    void SetUp() override {
+        engine = downcast(Engine::create(Engine::Backend::NOOP));
+    }
+
+    void TearDown() override {
+        for (Allocation const& allocation : allocations) {
+            arena.free(engine->getDriverApi(), allocation);
+        }
+        arena.terminate(engine->getDriverApi());
+        Engine::destroy((Engine**) &engine);
+    }
+
+    Allocation allocate(uint32_t size) {
+        return allocations.emplace_back(arena.allocate(engine->getDriverApi(), size, "test"));
+    }
+
+    void free(Allocation const& allocation) {
+        arena.free(engine->getDriverApi(), allocation);
+        allocations.erase(std::find_if(allocations.begin(), allocations.end(),
+                [&allocation](Allocation const& a) {
+                    return a.page == allocation.page && a.offset == allocation.offset &&
+                           a.buffer == allocation.buffer;
+                }));
+    }
+
+    FEngine* engine = nullptr;
+    UniformBufferArena arena;
+    std::vector<Allocation> allocations;
+};
+
+} // anonymous namespace
+
+TEST_F(UniformBufferArenaTest, AllocationsAreAligned) {
+    Allocation const a = allocate(16);
+    Allocation const b = allocate(ALIGNMENT + 1);
+    Allocation const c = allocate(ALIGNMENT);
+    EXPECT_EQ(a.page, 0u);
+    EXPECT_EQ(a.offset, 0u);
+    EXPECT_EQ(a.size, 16u);
+    EXPECT_EQ(b.offset, ALIGNMENT);
+    EXPECT_EQ(c.offset, 3 * ALIGNMENT);
+    EXPECT_EQ(a.buffer, c.buffer);
+    EXPECT_EQ(arena.getStats().bufferCount, 1u);
+}
+
+TEST_F(UniformBufferArenaTest, AdjacentFreesAreCoalesced) {
+    Allocation const a = allocate(ALIGNMENT);
+    Allocation const b = allocate(ALIGNMENT);
+    Allocation const c = allocate(ALIGNMENT);
+    Allocation const d = allocate(ALIGNMENT);
+    allocate(ALIGNMENT);    // keeps the end of the page out of the way
+
+    // a merges with b, then c with both a and d
+    free(b);
+    free(a);
+    free(d);
+    free(c);
+
+    // the four slots are a single free range again
+    Allocation const e = allocate(4 * ALIGNMENT);
+    EXPECT_EQ(e.page, 0u);
+    EXPECT_EQ(e.offset, 0u);
+    EXPECT_EQ(arena.getStats().bufferCount, 1u);
+}
+
+TEST_F(UniformBufferArenaTest, FragmentedPageIsSkipped) {
+    std::vector<Allocation> page;
+    for (uint32_t i = 0; i < SLOTS_PER_PAGE; i++) {
+        page.push_back(allocate(ALIGNMENT));
+    }
+    EXPECT_EQ(page.back().page, 0u);
+    EXPECT_EQ(page.back().offset, PAGE_SIZE - ALIGNMENT);
+
+    // half of the page is free, but no two free slots are adjacent
+    for (uint32_t i = 0; i < SLOTS_PER_PAGE; i += 2) {
+        free(page[i]);
+    }
+    Allocation const large = allocate(2 * ALIGNMENT);
+    EXPECT_EQ(large.page, 1u);
+    EXPECT_EQ(large.offset, 0u);
+    EXPECT_EQ(arena.getStats().bufferCount, 2u);
+
+    // small allocations still fill the holes first
+    Allocation const small = allocate(ALIGNMENT);
+    EXPECT_EQ(small.page, 0u);
+    EXPECT_EQ(small.offset, 0u);
+}
+
+TEST_F(UniformBufferArenaTest, FullPageAddsPage) {
+    for (uint32_t i = 0; i < SLOTS_PER_PAGE; i++) {
+        EXPECT_EQ(allocate(ALIGNMENT).page, 0u);
+    }
+    EXPECT_EQ(arena.getStats().bufferCount, 1u);
+
+    Allocation const a = allocate(ALIGNMENT);
+    EXPECT_EQ(a.page, 1u);
+    EXPECT_EQ(a.offset, 0u);
+    EXPECT_EQ(arena.getStats().bufferCount, 2u);
+
+    // a freed slot of the first page is reused before the second page
+    free(allocations[3]);
+    Allocation const b = allocate(ALIGNMENT);
+    EXPECT_EQ(b.page, 0u);
+    EXPECT_EQ(b.offset, 3 * ALIGNMENT);
+}
+
+TEST_F(UniformBufferArenaTest, DedicatedAllocations) {
+    // too large for a page
+    Allocation const large = allocate(PAGE_SIZE + 1);
+    EXPECT_EQ(large.page, UniformBufferArena::DEDICATED);
+    EXPECT_EQ(large.offset, 0u);
+    EXPECT_EQ(arena.getStats().bufferCount, 1u);
+
+    // all of them when suballocation is disabled
+    arena.setSuballocationEnabled(false);
+    Allocation const small = allocate(16);
+    EXPECT_EQ(small.page, UniformBufferArena::DEDICATED);
+    EXPECT_NE(small.buffer, large.buffer);
+    EXPECT_EQ(arena.getStats().bufferCount, 2u);
+
+    free(large);
+    free(small);
+    EXPECT_EQ(arena.getStats().bufferCount, 0u);
+}
+
+TEST_F(UniformBufferArenaTest, NearbyWritesAreUploadedTogether) {
+    FEngine::DriverApi& driver = engine->getDriverApi();
+    uint8_t const data[ALIGNMENT] = {};
+
+    std::vector<Allocation> page;
+    for (uint32_t i = 0; i < SLOTS_PER_PAGE; i++) {
+        page.push_back(allocate(ALIGNMENT));
+    }
+
+    // adjacent or close enough, in any order
+    arena.resetStats();
+    arena.write(driver, page[2], data, ALIGNMENT);
+    arena.write(driver, page[0], data, ALIGNMENT);
+    arena.write(driver, page[1], data, 64);
+    arena.write(driver, page[4], data, ALIGNMENT);
+    arena.commit(driver);
+    EXPECT_EQ(arena.getStats().uploadCount, 1u);
+    EXPECT_EQ(arena.getStats().uploadSize, 5 * ALIGNMENT);
+
+    // too far apart
+    uint32_t const far = 2 + (UniformBufferArena::MAX_UPLOAD_GAP + ALIGNMENT) / ALIGNMENT;
+    arena.resetStats();
+    arena.write(driver, page[0], data, ALIGNMENT);
+    arena.write(driver, page[far], data, ALIGNMENT);
+    arena.commit(driver);
+    EXPECT_EQ(arena.getStats().uploadCount, 2u);
+    EXPECT_EQ(arena.getStats().uploadSize, 2 * ALIGNMENT);
+
+    // nothing left to upload
+    arena.resetStats();
+    arena.commit(driver);
+    EXPECT_EQ(arena.getStats().uploadCount, 0u);
+}
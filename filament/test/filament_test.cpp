@@ -16,6 +16,7 @@
 
 #include <iostream>
 #include <random>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -41,6 +42,7 @@
 #include "details/Camera.h"
 #include "Froxelizer.h"
 #include "details/Engine.h"
+#include "details/Scene.h"
 #include "components/RenderableManager.h"
 #include "components/TransformManager.h"
 #include "UniformBuffer.h"
@@ -758,6 +760,127 @@ TEST(FilamentTest, FroxelData) {
     Engine::destroy((Engine **)&engine);
 }
 
+TEST(FilamentTest, RenderableUboDirtyRanges) {
+    using namespace filament;
+    using namespace filament::backend;
+
+    FEngine* engine = downcast(Engine::create(Engine::Backend::NOOP));
+    Scene* const publicScene = engine->createScene();
+    FScene* const scene = downcast(publicScene);
+    FTransformManager& tcm = engine->getTransformManager();
+    FRenderableManager& rcm = engine->getRenderableManager();
+    auto& driver = engine->getDriverApi();
+
+    LinearAllocatorArena arena("FRenderer: per-frame allocator", 3 * 1024 * 1024);
+    RootArenaScope rootArenaScope(arena);
+
+    auto createRenderable = [&]() {
+        Entity const e = engine->getEntityManager().create();
+        tcm.create(e);
+        RenderableManager::Builder(1)
+                .boundingBox({{ -1, -1, -1 }, { 1, 1, 1 }})
+                .build(*engine, e);
+        return e;
+    };
+
+    constexpr size_t kRenderableCount = 16;
+    for (size_t i = 0; i < kRenderableCount; i++) {
+        publicScene->addEntity(createRenderable());
+    }
+
+    // entities that are not renderables don't use a UBO slot
+    Entity const node = engine->getEntityManager().create();
+    tcm.create(node);
+    publicScene->addEntity(node);
+
+    // slots are assigned by prepare()
+    EXPECT_EQ(scene->getUboSlotCount(), 0u);
+
+    Handle<HwBufferObject> ubh = driver.createBufferObject(
+            kRenderableCount * sizeof(PerRenderableData) + sizeof(PerRenderableUib),
+            BufferObjectBinding::UNIFORM, BufferUsage::DYNAMIC);
+    FScene::RenderableUboCache cache;
+
+    auto update = [&]() {
+        scene->prepare(engine->getJobSystem(), rootArenaScope, mat4{}, false);
+        Range<uint32_t> const visible{ 0, uint32_t(scene->getRenderableData().size()) };
+        scene->prepareVisibleRenderables(visible);
+        scene->updateUBOs(visible, ubh, cache);
+    };
+
+    // the order of the slots depends on the scene, find the renderable using each of them
+    auto getSlotEntities = [&]() {
+        auto const& renderables = scene->getRenderableData();
+        std::vector<Entity> slotEntities(scene->getUboSlotCount());
+        for (size_t i = 0, c = renderables.size(); i < c; i++) {
+            slotEntities[renderables.elementAt<FScene::UBO_SLOT>(i)] =
+                    rcm.getEntity(renderables.elementAt<FScene::RENDERABLE_INSTANCE>(i));
+        }
+        return slotEntities;
+    };
+
+    auto translate = [&](Entity e, float x) {
+        tcm.setTransform(tcm.getInstance(e), mat4f::translation(float3{ x, 0, 0 }));
+    };
+
+    // everything is uploaded the first time
+    update();
+    EXPECT_EQ(scene->getUboSlotCount(), kRenderableCount);
+    EXPECT_EQ(cache.uploadCount, 1u);
+    EXPECT_EQ(cache.uploadSize, kRenderableCount * sizeof(PerRenderableData));
+
+    std::vector<Entity> const slotEntities = getSlotEntities();
+    for (Entity const e : slotEntities) {
+        EXPECT_FALSE(e.isNull());
+    }
+
+    // nothing changed
+    update();
+    EXPECT_EQ(cache.uploadCount, 0u);
+    EXPECT_EQ(cache.uploadSize, 0u);
+
+    // renderables far apart are uploaded separately
+    translate(slotEntities[0], 1.0f);
+    translate(slotEntities[15], 1.0f);
+    update();
+    EXPECT_EQ(cache.uploadCount, 2u);
+    EXPECT_EQ(cache.uploadSize, 2 * sizeof(PerRenderableData));
+
+    // renderables close to each other are uploaded together
+    translate(slotEntities[3], 1.0f);
+    translate(slotEntities[5], 1.0f);
+    update();
+    EXPECT_EQ(cache.uploadCount, 1u);
+    EXPECT_EQ(cache.uploadSize, 3 * sizeof(PerRenderableData));
+
+    // when half of the renderables changed, the whole UBO is replaced
+    for (size_t i = 0; i < kRenderableCount / 2; i++) {
+        translate(slotEntities[i * 2], 2.0f);
+    }
+    update();
+    EXPECT_EQ(cache.uploadCount, 1u);
+    EXPECT_EQ(cache.uploadSize, kRenderableCount * sizeof(PerRenderableData));
+
+    // the UBO only needs the slots in use
+    publicScene->remove(slotEntities[15]);
+    update();
+    EXPECT_EQ(scene->getUboSlotCount(), kRenderableCount - 1);
+    EXPECT_EQ(cache.uploadCount, 0u);
+
+    // slots are reused, a new renderable doesn't move the others
+    Entity const e = createRenderable();
+    publicScene->addEntity(e);
+    update();
+    EXPECT_EQ(scene->getUboSlotCount(), kRenderableCount);
+    EXPECT_EQ(getSlotEntities()[15], e);
+    EXPECT_EQ(cache.uploadCount, 1u);
+    EXPECT_EQ(cache.uploadSize, sizeof(PerRenderableData));
+
+    driver.destroyBufferObject(ubh);
+    engine->destroy(scene);
+    Engine::destroy((Engine **)&engine);
+}
+
 TEST(FilamentTest, GoogleLineDirective) {
     {
         char s[512] = "#line 10 \"foobar\"";
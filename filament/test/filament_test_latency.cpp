@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <filament/Engine.h>
+
+#include "FrameSkipper.h"
+
+#include "details/Engine.h"
+#include "details/Renderer.h"
+
+#include <chrono>
+
+using namespace filament;
+using namespace std::chrono;
+
+using fmilliseconds = duration<double, std::milli>;
+
+class FrameSkipperTest : public testing::Test {
+protected:
+    void SetUp() override {
+        engine = downcast(Engine::create(Engine::Backend::NOOP));
+    }
+
+    void TearDown() override {
+        skipper.terminate(engine->getDriverApi());
+        Engine::destroy((Engine**) &engine);
+    }
+
+    // the noop backend signals fences immediately, beginFrame() never skips
+    void frame() {
+        EXPECT_TRUE(skipper.beginFrame(engine->getDriverApi()));
+        skipper.endFrame(engine->getDriverApi());
+    }
+
+    FEngine* engine = nullptr;
+    FrameSkipper skipper;
+};
+
+TEST_F(FrameSkipperTest, DefaultLatency) {
+    EXPECT_EQ(skipper.getFramesInFlight(), 0u);
+    frame();
+    EXPECT_EQ(skipper.getFramesInFlight(), 1u);
+    for (int i = 0; i < 4; i++) {
+        frame();
+        EXPECT_EQ(skipper.getFramesInFlight(), FrameSkipper::DEFAULT_FRAME_LATENCY);
+    }
+}
+
+TEST_F(FrameSkipperTest, LatencyLoweredWithFramesInFlight) {
+    frame();
+    frame();
+    EXPECT_EQ(skipper.getFramesInFlight(), 2u);
+
+    // the extra fence is only dropped at the next endFrame()
+    skipper.setFrameLatency(1);
+    EXPECT_EQ(skipper.getFramesInFlight(), 2u);
+    frame();
+    EXPECT_EQ(skipper.getFramesInFlight(), 1u);
+    frame();
+    EXPECT_EQ(skipper.getFramesInFlight(), 1u);
+}
+
+TEST_F(FrameSkipperTest, LatencyRaisedWithFramesInFlight) {
+    skipper.setFrameLatency(1);
+    frame();
+    frame();
+    EXPECT_EQ(skipper.getFramesInFlight(), 1u);
+
+    // the queue fills up again one frame at a time
+    skipper.setFrameLatency(2);
+    frame();
+    EXPECT_EQ(skipper.getFramesInFlight(), 1u);
+    frame();
+    EXPECT_EQ(skipper.getFramesInFlight(), 2u);
+    frame();
+    EXPECT_EQ(skipper.getFramesInFlight(), 2u);
+}
+
+TEST_F(FrameSkipperTest, LatencyIsClamped) {
+    skipper.setFrameLatency(0);
+    frame();
+    frame();
+    EXPECT_EQ(skipper.getFramesInFlight(), 1u);
+
+    skipper.setFrameLatency(8);
+    for (int i = 0; i < 4; i++) {
+        frame();
+    }
+    EXPECT_EQ(skipper.getFramesInFlight(), 2u);
+}
+
+TEST(LatencyPacingTest, JustInTimeFrameStart) {
+    steady_clock::time_point const vsync{ seconds(10) };
+
+    // 60 Hz, the frame must be done 10% of an interval before the next vsync
+    auto start = FRenderer::getJustInTimeFrameStart(vsync, milliseconds(5), 60.0f, 1, 0.1f);
+    fmilliseconds expected{ 1000.0 / 60.0 * 0.9 - 5.0 };
+    EXPECT_NEAR(fmilliseconds(start - vsync).count(), expected.count(), 1e-3);
+
+    // the interval is a number of refresh periods
+    start = FRenderer::getJustInTimeFrameStart(vsync, milliseconds(5), 120.0f, 2, 0.0f);
+    expected = fmilliseconds{ 1000.0 / 60.0 - 5.0 };
+    EXPECT_NEAR(fmilliseconds(start - vsync).count(), expected.count(), 1e-3);
+
+    // a frame longer than the interval must start before the current vsync
+    start = FRenderer::getJustInTimeFrameStart(vsync, milliseconds(20), 60.0f, 1, 0.0f);
+    EXPECT_LT(start, vsync);
+
+    // no margin and no latency, the frame starts at the next vsync
+    start = FRenderer::getJustInTimeFrameStart(vsync, steady_clock::duration::zero(),
+            50.0f, 1, 0.0f);
+    EXPECT_EQ(start, vsync + milliseconds(20));
+}
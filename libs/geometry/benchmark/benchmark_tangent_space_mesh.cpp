@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <geometry/TangentSpaceMesh.h>
+
+#include <utils/JobSystem.h>
+
+#include <math/quat.h>
+#include <math/vec2.h>
+#include <math/vec3.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <string.h>
+
+using namespace filament::geometry;
+using namespace filament::math;
+using namespace utils;
+
+/*
+ * Tangent space benchmarks. The mesh is a bumpy grid of state.range(0) quads on a side, which
+ * looks a bit like a photogrammetry scan, and state.range(1) selects the algorithm. If
+ * state.range(2) isn't 0, the grid is cut into uv charts of that many quads on a side, like a
+ * texture atlas. Each benchmark runs once on the calling thread and once on a JobSystem ("MT"
+ * variants); the latter checks that its quaternions match the former's.
+ */
+
+struct Method {
+    char const* name;
+    TangentSpaceMesh::Algorithm algorithm;
+    bool normals;
+};
+
+static constexpr Method METHODS[] = {
+        { "MIKKTSPACE",    TangentSpaceMesh::Algorithm::MIKKTSPACE,    true  },
+        { "LENGYEL",       TangentSpaceMesh::Algorithm::LENGYEL,       true  },
+        { "HUGHES_MOLLER", TangentSpaceMesh::Algorithm::HUGHES_MOLLER, true  },
+        { "FRISVAD",       TangentSpaceMesh::Algorithm::FRISVAD,       true  },
+        { "FLAT_SHADING",  TangentSpaceMesh::Algorithm::DEFAULT,       false },
+};
+
+struct Mesh {
+    std::vector<float3> positions;
+    std::vector<float3> normals;
+    std::vector<float2> uvs;
+    std::vector<uint3> triangles;
+};
+
+// Meshes are expensive to create, so they're shared by all the benchmarks.
+static Mesh const& getMesh(uint32_t size, uint32_t chartSize) {
+    static std::map<std::pair<uint32_t, uint32_t>, Mesh> sCache;
+    auto pos = sCache.find({ size, chartSize });
+    if (pos == sCache.end()) {
+        Mesh mesh;
+        std::default_random_engine gen; // NOLINT
+        std::uniform_real_distribution<float> rand(-0.5f, 0.5f);
+        float const scale = 1.0f / float(size);
+        for (uint32_t y = 0; y <= size; y++) {
+            for (uint32_t x = 0; x <= size; x++) {
+                float const h = 0.1f * std::sin(float(x) * scale * 20.0f) *
+                        std::cos(float(y) * scale * 20.0f) + rand(gen) * scale;
+                mesh.positions.push_back({ float(x) * scale, h, float(y) * scale });
+                mesh.uvs.push_back({ float(x) * scale, float(y) * scale });
+            }
+        }
+        mesh.normals.resize(mesh.positions.size(), float3{ 0 });
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                uint32_t const a = y * (size + 1) + x;
+                uint32_t const c = a + size + 1;
+                mesh.triangles.push_back({ a, c, a + 1 });
+                mesh.triangles.push_back({ a + 1, c, c + 1 });
+            }
+        }
+        for (uint3 const& tri : mesh.triangles) {
+            float3 const& pa = mesh.positions[tri.x];
+            float3 const& pb = mesh.positions[tri.y];
+            float3 const& pc = mesh.positions[tri.z];
+            float3 const n = cross(pb - pa, pc - pa);
+            mesh.normals[tri.x] += n;
+            mesh.normals[tri.y] += n;
+            mesh.normals[tri.z] += n;
+        }
+        for (float3& n : mesh.normals) {
+            n = normalize(n);
+        }
+        if (chartSize) {
+            // each chart gets its own copy of its vertices, with uvs moved to its place in the atlas
+            Mesh charts;
+            std::vector<uint32_t> remap(mesh.positions.size());
+            for (uint32_t cy = 0; cy < size; cy += chartSize) {
+                for (uint32_t cx = 0; cx < size; cx += chartSize) {
+                    uint32_t const w = std::min(chartSize, size - cx);
+                    uint32_t const h = std::min(chartSize, size - cy);
+                    for (uint32_t y = cy; y <= cy + h; y++) {
+                        for (uint32_t x = cx; x <= cx + w; x++) {
+                            uint32_t const v = y * (size + 1) + x;
+                            remap[v] = uint32_t(charts.positions.size());
+                            charts.positions.push_back(mesh.positions[v]);
+                            charts.normals.push_back(mesh.normals[v]);
+                            charts.uvs.push_back(mesh.uvs[v] + float2{ cx, cy });
+                        }
+                    }
+                    for (uint32_t y = cy; y < cy + h; y++) {
+                        for (uint32_t x = cx; x < cx + w; x++) {
+                            uint3 const* quad = &mesh.triangles[(y * size + x) * 2];
+                            charts.triangles.push_back({
+                                    remap[quad[0].x], remap[quad[0].y], remap[quad[0].z] });
+                            charts.triangles.push_back({
+                                    remap[quad[1].x], remap[quad[1].y], remap[quad[1].z] });
+                        }
+                    }
+                }
+            }
+            mesh = std::move(charts);
+        }
+        pos = sCache.emplace(std::make_pair(size, chartSize), std::move(mesh)).first;
+    }
+    return pos->second;
+}
+
+static TangentSpaceMesh* build(Mesh const& mesh, Method const& method, JobSystem* js) {
+    TangentSpaceMesh::Builder builder;
+    builder.vertexCount(mesh.positions.size())
+            .positions(mesh.positions.data())
+            .triangleCount(mesh.triangles.size())
+            .triangles(mesh.triangles.data())
+            .algorithm(method.algorithm)
+            .jobSystem(js);
+    if (method.normals) {
+        builder.normals(mesh.normals.data()).uvs(mesh.uvs.data());
+    }
+    return builder.build();
+}
+
+static std::vector<quatf> getQuats(TangentSpaceMesh const* tsm) {
+    std::vector<quatf> quats(tsm->getVertexCount());
+    tsm->getQuats(quats.data());
+    return quats;
+}
+
+static void sizesAndMethods(benchmark::internal::Benchmark* b) {
+    for (int64_t size : { 128, 1024, 2048 }) {
+        for (int64_t method = 0; method < int64_t(std::size(METHODS)); method++) {
+            b->Args({ size, method, 0 });
+        }
+        // mikktspace is split over the charts of a mesh
+        b->Args({ size, 0, 64 });
+    }
+    b->ArgNames({ "size", "method", "charts" })->Unit(benchmark::kMillisecond);
+}
+
+static void setCounters(benchmark::State& state, Method const& method, Mesh const& mesh) {
+    state.SetLabel(std::string(method.name) + ", " +
+            std::to_string(mesh.triangles.size()) + " triangles" +
+            (state.range(2) ? ", charts" : ""));
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(mesh.triangles.size()));
+}
+
+static void BM_tangentSpaceMesh(benchmark::State& state) {
+    Mesh const& mesh = getMesh(uint32_t(state.range(0)), uint32_t(state.range(2)));
+    Method const& method = METHODS[state.range(1)];
+    for (auto _ : state) {
+        TangentSpaceMesh* tsm = build(mesh, method, nullptr);
+        benchmark::DoNotOptimize(tsm);
+        TangentSpaceMesh::destroy(tsm);
+    }
+    setCounters(state, method, mesh);
+}
+
+static void BM_tangentSpaceMeshMT(benchmark::State& state) {
+    Mesh const& mesh = getMesh(uint32_t(state.range(0)), uint32_t(state.range(2)));
+    Method const& method = METHODS[state.range(1)];
+    JobSystem js;
+    js.adopt();
+    std::vector<quatf> quats;
+    for (auto _ : state) {
+        TangentSpaceMesh* tsm = build(mesh, method, &js);
+        benchmark::DoNotOptimize(tsm);
+        state.PauseTiming();
+        quats = getQuats(tsm);
+        state.ResumeTiming();
+        TangentSpaceMesh::destroy(tsm);
+    }
+    js.emancipate();
+
+    TangentSpaceMesh* reference = build(mesh, method, nullptr);
+    std::vector<quatf> const expected = getQuats(reference);
+    TangentSpaceMesh::destroy(reference);
+    if (quats.size() != expected.size() ||
+            memcmp(quats.data(), expected.data(), quats.size() * sizeof(quatf)) != 0) {
+        state.SkipWithError("quaternions don't match the single-threaded ones");
+    }
+    setCounters(state, method, mesh);
+}
+
+BENCHMARK(BM_tangentSpaceMesh)->Apply(sizesAndMethods);
+BENCHMARK(BM_tangentSpaceMeshMT)->Apply(sizesAndMethods);
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <geometry/Transcoder.h>
+
+#include <utils/JobSystem.h>
+
+#include <math/half.h>
+
+#include <benchmark/benchmark.h>
+
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace filament::geometry;
+using namespace filament::math;
+using namespace utils;
+
+/*
+ * Transcoder benchmarks. state.range(0) is the number of vertices, and state.range(1) selects the
+ * component type. BM_scalar is a plain loop, the reference for BM_transcoder which converts the
+ * same tightly packed data.
+ */
+
+struct Type {
+    char const* name;
+    ComponentType type;
+    size_t size;
+};
+
+static constexpr Type TYPES[] = {
+        { "BYTE",   ComponentType::BYTE,   1 },
+        { "UBYTE",  ComponentType::UBYTE,  1 },
+        { "SHORT",  ComponentType::SHORT,  2 },
+        { "USHORT", ComponentType::USHORT, 2 },
+        { "HALF",   ComponentType::HALF,   2 },
+};
+
+// A typical interleaved quantized vertex.
+struct Vertex {
+    int16_t position[4];
+    int8_t normal[4];
+    uint16_t uv0[2];
+    uint8_t color[4];
+    half uv1[2];
+};
+
+static std::vector<uint8_t> createData(size_t size) {
+    std::vector<uint8_t> data(size);
+    std::default_random_engine gen; // NOLINT
+    std::uniform_int_distribution<uint32_t> rand(0, 255);
+    for (uint8_t& b : data) {
+        b = uint8_t(rand(gen));
+    }
+    return data;
+}
+
+template<typename T>
+static void convertScalar(float* target, void const* source, size_t count, float scale) {
+    T const* src = (T const*) source;
+    for (size_t i = 0; i < count; i++) {
+        float const value = float(src[i]) * scale;
+        target[i] = value < -1.0f ? -1.0f : value;
+    }
+}
+
+static void sizesAndTypes(benchmark::internal::Benchmark* b) {
+    for (int64_t size : { 1 << 12, 1 << 20 }) {
+        for (int64_t type = 0; type < int64_t(std::size(TYPES)); type++) {
+            b->Args({ size, type });
+        }
+    }
+    b->ArgNames({ "size", "type" });
+}
+
+static void setCounters(benchmark::State& state, Type const& type, size_t componentCount) {
+    state.SetLabel(type.name);
+    state.SetBytesProcessed(int64_t(state.iterations()) *
+            state.range(0) * int64_t(componentCount * type.size));
+}
+
+static void BM_scalar(benchmark::State& state) {
+    Type const& type = TYPES[state.range(1)];
+    size_t const count = size_t(state.range(0)) * 3;
+    std::vector<uint8_t> const data = createData(count * type.size);
+    std::vector<float> result(count);
+    for (auto _ : state) {
+        switch (type.type) {
+            case ComponentType::BYTE:
+                convertScalar<int8_t>(result.data(), data.data(), count, 1.0f / 127.0f);
+                break;
+            case ComponentType::UBYTE:
+                convertScalar<uint8_t>(result.data(), data.data(), count, 1.0f / 255.0f);
+                break;
+            case ComponentType::SHORT:
+                convertScalar<int16_t>(result.data(), data.data(), count, 1.0f / 32767.0f);
+                break;
+            case ComponentType::USHORT:
+                convertScalar<uint16_t>(result.data(), data.data(), count, 1.0f / 65535.0f);
+                break;
+            case ComponentType::HALF:
+                convertScalar<half>(result.data(), data.data(), count, 1.0f);
+                break;
+            case ComponentType::FLOAT:
+                break;
+        }
+        benchmark::DoNotOptimize(result.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, type, 3);
+}
+
+static void BM_transcoder(benchmark::State& state) {
+    Type const& type = TYPES[state.range(1)];
+    size_t const count = size_t(state.range(0));
+    std::vector<uint8_t> const data = createData(count * 3 * type.size);
+    std::vector<float> result(count * 3);
+    Transcoder const transcode({ type.type, true, 3 });
+    for (auto _ : state) {
+        transcode(result.data(), data.data(), count);
+        benchmark::DoNotOptimize(result.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, type, 3);
+}
+
+static void BM_transcoderMT(benchmark::State& state) {
+    Type const& type = TYPES[state.range(1)];
+    size_t const count = size_t(state.range(0));
+    std::vector<uint8_t> const data = createData(count * 3 * type.size);
+    std::vector<float> result(count * 3);
+    Transcoder const transcode({ type.type, true, 3 });
+    JobSystem js;
+    js.adopt();
+    for (auto _ : state) {
+        transcode(js, result.data(), data.data(), count);
+        benchmark::DoNotOptimize(result.data());
+        benchmark::ClobberMemory();
+    }
+    js.emancipate();
+    setCounters(state, type, 3);
+}
+
+// Interleaved streams: one Transcoder per attribute vs. decode()
+
+static std::vector<Transcoder::Attribute> getAttributes(std::vector<std::vector<float>>& targets,
+        size_t count) {
+    std::vector<Transcoder::Attribute> attributes = {
+        { { ComponentType::SHORT,  true, 3, sizeof(Vertex) }, offsetof(Vertex, position) },
+        { { ComponentType::BYTE,   true, 3, sizeof(Vertex) }, offsetof(Vertex, normal)   },
+        { { ComponentType::USHORT, true, 2, sizeof(Vertex) }, offsetof(Vertex, uv0)      },
+        { { ComponentType::UBYTE,  true, 4, sizeof(Vertex) }, offsetof(Vertex, color)    },
+        { { ComponentType::HALF,  false, 2, sizeof(Vertex) }, offsetof(Vertex, uv1)      },
+    };
+    targets.resize(attributes.size());
+    for (size_t i = 0; i < attributes.size(); i++) {
+        targets[i].resize(count * attributes[i].config.componentCount);
+        attributes[i].target = targets[i].data();
+    }
+    return attributes;
+}
+
+static void BM_interleaved(benchmark::State& state) {
+    size_t const count = size_t(state.range(0));
+    std::vector<uint8_t> const data = createData(count * sizeof(Vertex));
+    std::vector<std::vector<float>> targets;
+    std::vector<Transcoder::Attribute> const attributes = getAttributes(targets, count);
+    for (auto _ : state) {
+        for (Transcoder::Attribute const& attribute : attributes) {
+            Transcoder const transcode(attribute.config);
+            transcode(attribute.target, data.data() + attribute.offset, count);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(count * sizeof(Vertex)));
+}
+
+static void BM_decode(benchmark::State& state) {
+    size_t const count = size_t(state.range(0));
+    std::vector<uint8_t> const data = createData(count * sizeof(Vertex));
+    std::vector<std::vector<float>> targets;
+    std::vector<Transcoder::Attribute> const attributes = getAttributes(targets, count);
+    for (auto _ : state) {
+        Transcoder::decode(attributes.data(), attributes.size(), data.data(), count);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(count * sizeof(Vertex)));
+}
+
+static void BM_decodeMT(benchmark::State& state) {
+    size_t const count = size_t(state.range(0));
+    std::vector<uint8_t> const data = createData(count * sizeof(Vertex));
+    std::vector<std::vector<float>> targets;
+    std::vector<Transcoder::Attribute> const attributes = getAttributes(targets, count);
+    JobSystem js;
+    js.adopt();
+    for (auto _ : state) {
+        Transcoder::decode(attributes.data(), attributes.size(), data.data(), count, &js);
+        benchmark::ClobberMemory();
+    }
+    js.emancipate();
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(count * sizeof(Vertex)));
+}
+
+BENCHMARK(BM_scalar)->Apply(sizesAndTypes);
+BENCHMARK(BM_transcoder)->Apply(sizesAndTypes);
+BENCHMARK(BM_transcoderMT)->Apply(sizesAndTypes);
+BENCHMARK(BM_interleaved)->Arg(1 << 12)->Arg(1 << 20);
+BENCHMARK(BM_decode)->Arg(1 << 12)->Arg(1 << 20);
+BENCHMARK(BM_decodeMT)->Arg(1 << 12)->Arg(1 << 20);
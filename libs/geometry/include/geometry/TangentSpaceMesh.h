@@ -23,6 +23,10 @@
 
 #include <variant>
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament {
 namespace geometry {
 
@@ -223,6 +227,17 @@ public:
          */
         Builder& algorithm(Algorithm algorithm) noexcept;
 
+        /**
+         * Lets the computation split its work over ranges of vertices and triangles, and run them
+         * on the given JobSystem. The result is identical to the one computed on the calling
+         * thread. build() must then be called from a thread known to the JobSystem, e.g. from
+         * within a job.
+         *
+         * @param jobSystem The JobSystem to use, or nullptr to compute on the calling thread.
+         * @return Builder
+         */
+        Builder& jobSystem(utils::JobSystem* jobSystem) noexcept;
+
         /**
          * Computes the tangent space mesh. The resulting mesh object is owned by the callee. The
          * callee must call TangentSpaceMesh::destroy on the object once they are finished with it.
@@ -22,6 +22,10 @@
 #include <stddef.h>
 #include <stdint.h>
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament {
 namespace geometry {
 
@@ -55,6 +59,10 @@ enum class ComponentType {
  * transcode(outputPtr, inputPtr, count);
  * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
  *
+ * Tightly packed data is converted with SIMD instructions when available (SSE2, AVX2 if the CPU
+ * supports it, or NEON). Whole interleaved vertex streams can be converted in a single pass with
+ * decode().
+ *
  * The interpretation of signed normalized data is consistent with Vulkan and OpenGL ES 3.0+.
  * Note that this slightly differs from earlier versions of OpenGL ES.  For example, a signed byte
  * value of -127 maps exactly to -1.0f under ES3 and VK rules, but not ES2.
@@ -95,6 +103,36 @@ public:
     size_t operator()(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
             size_t count) const noexcept;
 
+    /**
+     * Same as above, but large conversions are split across the jobs of the given JobSystem. This
+     * call returns when the conversion is complete.
+     */
+    size_t operator()(utils::JobSystem& js, float* UTILS_RESTRICT target,
+            void const* UTILS_RESTRICT source, size_t count) const noexcept;
+
+    /**
+     * Describes one attribute of an interleaved vertex stream, for decode().
+     */
+    struct Attribute {
+        Config config;          //!< inputStrideBytes is the size of a vertex (0 if tightly packed)
+        uint32_t offset = 0;    //!< offset of the attribute in a vertex, in bytes
+        float* target = nullptr;//!< receives "count" tightly packed items
+    };
+
+    /**
+     * Converts all the attributes of an interleaved vertex stream. The stream is read once, a
+     * block of vertices at a time, rather than once per attribute.
+     *
+     * @param attributes Attributes to convert, their targets must not overlap
+     * @param attributeCount Number of attributes
+     * @param source Pointer to the first vertex of the stream
+     * @param count Number of vertices to convert
+     * @param js Optional JobSystem to split large streams across jobs
+     */
+    static void decode(Attribute const* attributes, size_t attributeCount,
+            void const* UTILS_RESTRICT source, size_t count,
+            utils::JobSystem* js = nullptr) noexcept;
+
 private:
     const Config mConfig;
 };
@@ -18,11 +18,16 @@
 
 #include <math/mat3.h>
 #include <math/norm.h>
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 
 #include <meshoptimizer.h>
 #include <mikktspace/mikktspace.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <numeric>
 #include <vector>
 
 #include <string.h>  // memcpy
@@ -32,8 +37,7 @@ namespace filament::geometry {
 using namespace filament::math;
 
 int MikktspaceImpl::getNumFaces(SMikkTSpaceContext const* context) noexcept {
-    auto const wrapper = MikktspaceImpl::getThis(context);
-    return wrapper->mFaceCount;
+    return MikktspaceImpl::getChunk(context)->faceCount;
 }
 
 int MikktspaceImpl::getNumVerticesOfFace(SMikkTSpaceContext const* context,
@@ -43,9 +47,10 @@ int MikktspaceImpl::getNumVerticesOfFace(SMikkTSpaceContext const* context,
 
 void MikktspaceImpl::getPosition(SMikkTSpaceContext const* context, float fvPosOut[],
         int const iFace, int const iVert) noexcept {
-    auto const wrapper = MikktspaceImpl::getThis(context);
-    float3 const pos = *pointerAdd(wrapper->mPositions, wrapper->getTriangle(iFace)[iVert],
-            wrapper->mPositionStride);
+    auto const chunk = MikktspaceImpl::getChunk(context);
+    auto const wrapper = chunk->impl;
+    float3 const pos = *pointerAdd(wrapper->mPositions,
+            wrapper->getTriangle(chunk->getFace(iFace))[iVert], wrapper->mPositionStride);
     fvPosOut[0] = pos.x;
     fvPosOut[1] = pos.y;
     fvPosOut[2] = pos.z;
@@ -53,9 +58,10 @@ void MikktspaceImpl::getPosition(SMikkTSpaceContext const* context, float fvPosO
 
 void MikktspaceImpl::getNormal(SMikkTSpaceContext const* context, float fvNormOut[],
         int const iFace, int const iVert) noexcept {
-    auto const wrapper = MikktspaceImpl::getThis(context);
-    float3 const normal = *pointerAdd(wrapper->mNormals, wrapper->getTriangle(iFace)[iVert],
-            wrapper->mNormalStride);
+    auto const chunk = MikktspaceImpl::getChunk(context);
+    auto const wrapper = chunk->impl;
+    float3 const normal = *pointerAdd(wrapper->mNormals,
+            wrapper->getTriangle(chunk->getFace(iFace))[iVert], wrapper->mNormalStride);
     fvNormOut[0] = normal.x;
     fvNormOut[1] = normal.y;
     fvNormOut[2] = normal.z;
@@ -63,50 +69,132 @@ void MikktspaceImpl::getNormal(SMikkTSpaceContext const* context, float fvNormOu
 
 void MikktspaceImpl::getTexCoord(SMikkTSpaceContext const* context, float fvTexcOut[],
         int const iFace, int const iVert) noexcept {
-    auto const wrapper = MikktspaceImpl::getThis(context);
-    float2 const texc
-            = *pointerAdd(wrapper->mUVs, wrapper->getTriangle(iFace)[iVert], wrapper->mUVStride);
+    auto const chunk = MikktspaceImpl::getChunk(context);
+    auto const wrapper = chunk->impl;
+    float2 const texc = *pointerAdd(wrapper->mUVs,
+            wrapper->getTriangle(chunk->getFace(iFace))[iVert], wrapper->mUVStride);
     fvTexcOut[0] = texc.x;
     fvTexcOut[1] = texc.y;
 }
 
 void MikktspaceImpl::setTSpaceBasic(SMikkTSpaceContext const* context, float const fvTangent[],
         float const fSign, int const iFace, int const iVert) noexcept {
-    auto const wrapper = MikktspaceImpl::getThis(context);
-    uint32_t const vertInd = wrapper->getTriangle(iFace)[iVert];
-    float3 const pos = *pointerAdd(wrapper->mPositions, vertInd, wrapper->mPositionStride);
-    float3 const n = normalize(*pointerAdd(wrapper->mNormals, vertInd, wrapper->mNormalStride));
-    float2 const uv = *pointerAdd(wrapper->mUVs, vertInd, wrapper->mUVStride);
-    float3 const t { fvTangent[0], fvTangent[1], fvTangent[2] };
-    float3 const b = fSign * normalize(cross(n, t));
+    // Only the tangents are recorded here, the output elements are assembled afterwards, in
+    // parallel, by writeElement().
+    auto const chunk = MikktspaceImpl::getChunk(context);
+    chunk->impl->mTangents[size_t(chunk->getFace(iFace)) * 3 + iVert] =
+            float4{ fvTangent[0], fvTangent[1], fvTangent[2], fSign };
+}
+
+void MikktspaceImpl::writeElement(size_t const corner, uint8_t* cursor) const noexcept {
+    uint32_t const vertInd = getTriangle(int(corner / 3))[corner % 3];
+    float3 const pos = *pointerAdd(mPositions, vertInd, mPositionStride);
+    float3 const n = normalize(*pointerAdd(mNormals, vertInd, mNormalStride));
+    float2 const uv = *pointerAdd(mUVs, vertInd, mUVStride);
+    float4 const& tangent = mTangents[corner];
+    float3 const t = tangent.xyz;
+    float3 const b = tangent.w * normalize(cross(n, t));
 
     // TODO: packTangentFrame actually changes the orientation of b.
     quatf const quat = mat3f::packTangentFrame({t, b, n}, sizeof(int32_t));
 
-    auto& output = wrapper->mOutputData;
-    auto const& EMPTY_ELEMENT = wrapper->EMPTY_ELEMENT;
-
-    size_t const outputCurSize = output.size();
-
-    // Prepare for the next element
-    output.insert(output.end(), EMPTY_ELEMENT.begin(), EMPTY_ELEMENT.end());
-
-    uint8_t* cursor = output.data() + outputCurSize;
-
     *((float3*) (cursor + POS_OFFSET)) = pos;
     *((float2*) (cursor + UV_OFFSET)) = uv;
     *((quatf*) (cursor + TBN_OFFSET)) = quat;
 
     cursor += BASE_OUTPUT_SIZE;
-    for (auto const& inputAttrib: wrapper->mInputAttribArrays) {
+    for (auto const& inputAttrib: mInputAttribArrays) {
         uint8_t const* input = pointerAdd(inputAttrib.data, vertInd, inputAttrib.stride);
         memcpy(cursor, input, inputAttrib.size);
         cursor += inputAttrib.size;
     }
 }
 
+// Same result as meshopt_generateVertexRemap(), i.e. vertices are numbered in order of first
+// occurrence, but computed in parallel. Each vertex is inserted in a lock-free hash table which
+// keeps the lowest index of each set of identical vertices, regardless of the order in which the
+// insertions happen. That index is then looked up for each vertex.
+size_t MikktspaceImpl::weld(utils::JobSystem* js, uint32_t* remap, uint8_t const* vertices,
+        size_t const vertexCount, size_t const vertexSize) {
+    constexpr uint32_t EMPTY = UINT32_MAX;
+    assert_invariant(vertexCount < EMPTY);
+    assert_invariant(vertexSize % sizeof(uint32_t) == 0);
+
+    size_t tableSize = 1;
+    while (tableSize < vertexCount * 2) {
+        tableSize *= 2;
+    }
+    size_t const mask = tableSize - 1;
+    std::unique_ptr<std::atomic<uint32_t>[]> table(new std::atomic<uint32_t>[tableSize]);
+
+    // MurmurHash2, like meshoptimizer
+    auto const hash = [=](size_t i) {
+        uint32_t const* key = (uint32_t const*) (vertices + i * vertexSize);
+        uint32_t h = 0;
+        for (size_t k = 0; k < vertexSize / sizeof(uint32_t); k++) {
+            uint32_t w = key[k];
+            w *= 0x5bd1e995;
+            w ^= w >> 24;
+            w *= 0x5bd1e995;
+            h *= 0x5bd1e995;
+            h ^= w;
+        }
+        return h;
+    };
+
+    auto const equal = [=](size_t i, size_t j) {
+        return !memcmp(vertices + i * vertexSize, vertices + j * vertexSize, vertexSize);
+    };
+
+    parallelFor(js, tableSize, [&](size_t start, size_t count) {
+        for (size_t i = start, end = start + count; i < end; i++) {
+            table[i].store(EMPTY, std::memory_order_relaxed);
+        }
+    });
+
+    parallelFor(js, vertexCount, [&](size_t start, size_t count) {
+        for (size_t i = start, end = start + count; i < end; i++) {
+            for (size_t slot = hash(i) & mask;; slot = (slot + 1) & mask) {
+                uint32_t current = table[slot].load(std::memory_order_relaxed);
+                if (current == EMPTY && table[slot].compare_exchange_strong(current, uint32_t(i),
+                        std::memory_order_relaxed)) {
+                    break;
+                }
+                // the slot is taken, only identical vertices can replace its index from now on
+                if (equal(current, i)) {
+                    while (i < current && !table[slot].compare_exchange_weak(current, uint32_t(i),
+                            std::memory_order_relaxed)) {
+                    }
+                    break;
+                }
+            }
+        }
+    });
+
+    parallelFor(js, vertexCount, [&](size_t start, size_t count) {
+        for (size_t i = start, end = start + count; i < end; i++) {
+            for (size_t slot = hash(i) & mask;; slot = (slot + 1) & mask) {
+                uint32_t const first = table[slot].load(std::memory_order_relaxed);
+                if (equal(first, i)) {
+                    remap[i] = first;
+                    break;
+                }
+            }
+        }
+    });
+
+    // The first vertex of each set is always before the others, so it's already been numbered.
+    uint32_t next = 0;
+    for (size_t i = 0; i < vertexCount; i++) {
+        uint32_t const first = remap[i];
+        remap[i] = first == i ? next++ : remap[first];
+    }
+    return next;
+}
+
 MikktspaceImpl::MikktspaceImpl(const TangentSpaceMeshInput* input) noexcept
     : mFaceCount((int) input->triangleCount),
+      mVertexCount(input->vertexCount),
       mPositions(input->positions()),
       mPositionStride(input->positionsStride()),
       mNormals(input->normals()),
@@ -116,6 +204,7 @@ MikktspaceImpl::MikktspaceImpl(const TangentSpaceMeshInput* input) noexcept
       mIsTriangle16(input->triangles16),
       mTriangles(
               input->triangles16 ? (uint8_t*) input->triangles16 : (uint8_t*) input->triangles32),
+      mJobSystem(input->jobSystem),
       mOutputElementSize(BASE_OUTPUT_SIZE) {
 
     // We don't know how many attributes there are so we have to create an ordering of the
@@ -133,14 +222,11 @@ MikktspaceImpl::MikktspaceImpl(const TangentSpaceMeshInput* input) noexcept
             .size = attribSize,
         });
     }
-    mOutputData.reserve(mFaceCount * 3 * mOutputElementSize);
-
-    // We will insert 0s to signify a new element being added to the output.
-    EMPTY_ELEMENT = std::vector<uint8_t>(mOutputElementSize);
+    mTangents.resize(size_t(mFaceCount) * 3);
 }
 
-MikktspaceImpl* MikktspaceImpl::getThis(SMikkTSpaceContext const* context) noexcept {
-    return (MikktspaceImpl*) context->m_pUserData;
+MikktspaceImpl::Chunk const* MikktspaceImpl::getChunk(SMikkTSpaceContext const* context) noexcept {
+    return (Chunk const*) context->m_pUserData;
 }
 
 inline const uint3 MikktspaceImpl::getTriangle(int const triangleIndex) const noexcept {
@@ -149,7 +235,7 @@ inline const uint3 MikktspaceImpl::getTriangle(int const triangleIndex) const no
                          : *(uint3*) (pointerAdd(mTriangles, triangleIndex, tstride));
 }
 
-void MikktspaceImpl::run(TangentSpaceMeshOutput* output) noexcept {
+void MikktspaceImpl::generateTangents(Chunk const& chunk) noexcept {
     SMikkTSpaceInterface interface {
         .m_getNumFaces = MikktspaceImpl::getNumFaces,
         .m_getNumVerticesOfFace = MikktspaceImpl::getNumVerticesOfFace,
@@ -158,27 +244,165 @@ void MikktspaceImpl::run(TangentSpaceMeshOutput* output) noexcept {
         .m_getTexCoord = MikktspaceImpl::getTexCoord,
         .m_setTSpaceBasic = MikktspaceImpl::setTSpaceBasic,
     };
-    SMikkTSpaceContext context{.m_pInterface = &interface, .m_pUserData = this};
+    SMikkTSpaceContext context{.m_pInterface = &interface, .m_pUserData = (void*) &chunk};
     genTangSpaceDefault(&context);
+}
 
-    size_t oVertexCount = mOutputData.size() / mOutputElementSize;
-    std::vector<unsigned int> remap;
-    remap.resize(oVertexCount);
-    size_t vertexCount = meshopt_generateVertexRemap(remap.data(), NULL, remap.size(),
-            mOutputData.data(), oVertexCount, mOutputElementSize);
+// mikktspace only relates two triangles if they share a vertex, once the vertices with the same
+// position, normal and uv are welded, and it keeps the order of the triangles. The tangents of a
+// triangle therefore only depend on the triangles of its connected component, in order. The
+// components, e.g. the uv charts of a mesh, are packed in chunks of similar sizes which are
+// processed in parallel, each by its own genTangSpaceDefault() call. The result is the same as
+// processing the whole mesh at once.
+void MikktspaceImpl::generateTangentsInChunks() noexcept {
+    utils::JobSystem* const js = mJobSystem;
+    size_t const faceCount = size_t(mFaceCount);
+
+    // Chunks smaller than this aren't worth a job
+    constexpr size_t MIN_CHUNK_SIZE = 4096;
+    size_t const threadCount = std::max(js->getThreadCount(), size_t(1));
+    size_t const chunkSize = std::max(faceCount / (threadCount * 4), MIN_CHUNK_SIZE);
+    if (faceCount < chunkSize * 2) {
+        generateTangents({ this, nullptr, mFaceCount });
+        return;
+    }
 
-    std::vector<uint8_t> newVertices(vertexCount * mOutputElementSize);
-    meshopt_remapVertexBuffer((void*) newVertices.data(), mOutputData.data(), oVertexCount,
-            mOutputElementSize, remap.data());
+    // Weld the vertices like mikktspace does. It compares floats, so -0 and 0 are the same.
+    struct Key {
+        float3 position;
+        float3 normal;
+        float2 uv;
+    };
+    std::vector<Key> keys(mVertexCount);
+    parallelFor(js, mVertexCount, [this, &keys](size_t start, size_t count) {
+        for (size_t i = start, end = start + count; i < end; ++i) {
+            Key& key = keys[i];
+            key.position = *pointerAdd(mPositions, i, mPositionStride);
+            key.normal = *pointerAdd(mNormals, i, mNormalStride);
+            key.uv = *pointerAdd(mUVs, i, mUVStride);
+            uint32_t words[sizeof(Key) / sizeof(uint32_t)];
+            memcpy(words, &key, sizeof(Key));
+            for (uint32_t& word : words) {
+                word = word == 0x80000000u ? 0u : word;
+            }
+            memcpy(&key, words, sizeof(Key));
+        }
+    });
+    std::vector<uint32_t> remap(mVertexCount);
+    size_t const vertexCount = weld(js, remap.data(), (uint8_t const*) keys.data(), mVertexCount,
+            sizeof(Key));
+    keys = {};
+
+    // Find the connected components with a union-find over the welded vertices
+    std::vector<uint32_t> parent(vertexCount);
+    std::iota(parent.begin(), parent.end(), 0u);
+    auto const find = [&parent](uint32_t v) {
+        while (parent[v] != v) {
+            v = parent[v] = parent[parent[v]];
+        }
+        return v;
+    };
+    for (size_t f = 0; f < faceCount; ++f) {
+        uint3 const triangle = getTriangle(int(f));
+        uint32_t a = find(remap[triangle[0]]);
+        for (size_t k = 1; k < 3; ++k) {
+            uint32_t const b = find(remap[triangle[k]]);
+            parent[std::max(a, b)] = std::min(a, b);
+            a = std::min(a, b);
+        }
+    }
+
+    std::vector<uint32_t> componentSize(vertexCount);
+    std::vector<uint32_t> faceComponent(faceCount);
+    for (size_t f = 0; f < faceCount; ++f) {
+        faceComponent[f] = find(remap[getTriangle(int(f))[0]]);
+        componentSize[faceComponent[f]]++;
+    }
+
+    // Components go to the current chunk, in order of first face, until it's full. Then the faces
+    // are sorted by chunk, keeping their order.
+    constexpr uint32_t UNASSIGNED = UINT32_MAX;
+    std::vector<uint32_t>& componentChunk = parent;
+    std::fill(componentChunk.begin(), componentChunk.end(), UNASSIGNED);
+    std::vector<uint32_t> chunkSizes(1, 0u);
+    for (size_t f = 0; f < faceCount; ++f) {
+        uint32_t const component = faceComponent[f];
+        if (componentChunk[component] == UNASSIGNED) {
+            if (chunkSizes.back() >= chunkSize) {
+                chunkSizes.push_back(0u);
+            }
+            componentChunk[component] = uint32_t(chunkSizes.size() - 1);
+            chunkSizes.back() += componentSize[component];
+        }
+    }
+    size_t const chunkCount = chunkSizes.size();
+    if (chunkCount == 1) {
+        generateTangents({ this, nullptr, mFaceCount });
+        return;
+    }
+
+    std::vector<uint32_t> faces(faceCount);
+    std::vector<uint32_t> next(chunkCount);
+    for (size_t c = 1; c < chunkCount; ++c) {
+        next[c] = next[c - 1] + chunkSizes[c - 1];
+    }
+    std::vector<Chunk> chunks(chunkCount);
+    for (size_t c = 0; c < chunkCount; ++c) {
+        chunks[c] = { this, faces.data() + next[c], int(chunkSizes[c]) };
+    }
+    for (size_t f = 0; f < faceCount; ++f) {
+        faces[next[componentChunk[faceComponent[f]]]++] = uint32_t(f);
+    }
+
+    utils::JobSystem::Job* parentJob = js->createJob();
+    for (Chunk const& chunk : chunks) {
+        js->run(utils::jobs::createJob(*js, parentJob, [&chunk] { generateTangents(chunk); }));
+    }
+    js->runAndWait(parentJob);
+}
+
+void MikktspaceImpl::run(TangentSpaceMeshOutput* output) noexcept {
+    if (mJobSystem) {
+        generateTangentsInChunks();
+    } else {
+        generateTangents({ this, nullptr, mFaceCount });
+    }
+
+    // everything else is split over ranges of corners or vertices.
+    size_t const oVertexCount = size_t(mFaceCount) * 3;
+    mOutputData.resize(oVertexCount * mOutputElementSize);
+    parallelFor(mJobSystem, oVertexCount, [this](size_t start, size_t count) {
+        for (size_t i = start, end = start + count; i < end; ++i) {
+            writeElement(i, mOutputData.data() + i * mOutputElementSize);
+        }
+    });
+
+    std::vector<uint32_t> remap(oVertexCount);
+    size_t const vertexCount = mJobSystem ?
+            weld(mJobSystem, remap.data(), mOutputData.data(), oVertexCount, mOutputElementSize) :
+            meshopt_generateVertexRemap(remap.data(), NULL, oVertexCount, mOutputData.data(),
+                    oVertexCount, mOutputElementSize);
+
+    // The first corner of each vertex is the one its data is copied from.
+    std::vector<uint32_t> firstCorner(vertexCount);
+    for (size_t i = 0, next = 0; i < oVertexCount; ++i) {
+        if (remap[i] == next) {
+            firstCorner[next++] = uint32_t(i);
+        }
+    }
 
     uint3* triangles32 = output->triangles32.allocate(mFaceCount);
-    meshopt_remapIndexBuffer((uint32_t*) triangles32, NULL, remap.size(), remap.data());
+    parallelFor(mJobSystem, size_t(mFaceCount), [&remap, triangles32](size_t start, size_t count) {
+        for (size_t i = start, end = start + count; i < end; ++i) {
+            triangles32[i] = uint3{ remap[i * 3], remap[i * 3 + 1], remap[i * 3 + 2] };
+        }
+    });
 
     float3* outPositions = output->positions().allocate(vertexCount);
     float2* outUVs = output->uvs().allocate(vertexCount);
     quatf* outQuats = output->tspace().allocate(vertexCount);
 
-    uint8_t* const verts = newVertices.data();
+    uint8_t const* const verts = mOutputData.data();
 
     std::vector<std::tuple<AttributeImpl, void*, size_t>> attributes;
 
@@ -210,17 +434,20 @@ void MikktspaceImpl::run(TangentSpaceMeshOutput* output) noexcept {
         }
     }
 
-    for (size_t i = 0, vi=0; i < vertexCount; ++i, vi+=mOutputElementSize) {
-        outPositions[i] =  *((float3*) (verts + vi + POS_OFFSET));
-        outUVs[i] = *((float2*) (verts + vi + UV_OFFSET));
-        outQuats[i] = *((quatf*) (verts + vi + TBN_OFFSET));
-
-        uint8_t* cursor = verts + vi + BASE_OUTPUT_SIZE;
-        for (auto const [attrib, outdata, size] : attributes) {
-            memcpy((uint8_t*) outdata + (i * size), cursor, size);
-            cursor += size;
+    parallelFor(mJobSystem, vertexCount, [&](size_t start, size_t count) {
+        for (size_t i = start, end = start + count; i < end; ++i) {
+            uint8_t const* cursor = verts + firstCorner[i] * mOutputElementSize;
+            outPositions[i] = *((float3*) (cursor + POS_OFFSET));
+            outUVs[i] = *((float2*) (cursor + UV_OFFSET));
+            outQuats[i] = *((quatf*) (cursor + TBN_OFFSET));
+
+            cursor += BASE_OUTPUT_SIZE;
+            for (auto const& [attrib, outdata, size] : attributes) {
+                memcpy((uint8_t*) outdata + (i * size), cursor, size);
+                cursor += size;
+            }
         }
-    }
+    });
 
     output->vertexCount = vertexCount;
     output->triangleCount = mFaceCount;
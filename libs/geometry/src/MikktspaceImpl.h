@@ -22,6 +22,7 @@
 #include <math/quat.h>
 #include <math/vec2.h>
 #include <math/vec3.h>
+#include <math/vec4.h>
 
 #include <vector>
 
@@ -68,11 +69,28 @@ private:
     static void setTSpaceBasic(SMikkTSpaceContext const* context, float const fvTangent[],
             float const fSign, int const iFace, int const iVert) noexcept;
 
-    static MikktspaceImpl* getThis(SMikkTSpaceContext const* context) noexcept;
+    // The faces processed by one genTangSpaceDefault() call, all of them if faces is null
+    struct Chunk {
+        MikktspaceImpl* impl;
+        uint32_t const* faces;
+        int faceCount;
+        int getFace(int const i) const noexcept { return faces ? int(faces[i]) : i; }
+    };
+
+    static Chunk const* getChunk(SMikkTSpaceContext const* context) noexcept;
+
+    static void generateTangents(Chunk const& chunk) noexcept;
+    void generateTangentsInChunks() noexcept;
 
     inline const uint3 getTriangle(int const triangleIndex) const noexcept;
 
+    void writeElement(size_t corner, uint8_t* cursor) const noexcept;
+
+    static size_t weld(utils::JobSystem* js, uint32_t* remap, uint8_t const* vertices,
+            size_t vertexCount, size_t vertexSize);
+
     int const mFaceCount;
+    size_t const mVertexCount;
     float3 const* mPositions;
     size_t const mPositionStride;
     float3 const* mNormals;
@@ -81,6 +99,7 @@ private:
     size_t const mUVStride;
     uint8_t const* mTriangles;
     bool mIsTriangle16;
+    utils::JobSystem* mJobSystem;
 
     struct InputAttribute {
         AttributeImpl attrib;
@@ -92,7 +111,9 @@ private:
 
     size_t mOutputElementSize;
     std::vector<uint8_t> mOutputData;
-    std::vector<uint8_t> EMPTY_ELEMENT;
+
+    // Tangent and sign computed by mikktspace for each corner of each triangle
+    std::vector<float4> mTangents;
 };
 
 }// namespace filament::geometry
@@ -22,9 +22,13 @@
 #include <math/mat3.h>
 #include <math/norm.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Log.h>
 #include <utils/Panic.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <vector>
 
 namespace filament {
@@ -190,12 +194,13 @@ void frisvadMethod(TangentSpaceMeshInput const* input, TangentSpaceMeshOutput* o
     float3 const* UTILS_RESTRICT normals = input->normals();
     size_t const nstride = input->normalsStride();
 
-    for (size_t qindex = 0; qindex < vertexCount; ++qindex) {
-        float3 const n = *normals;
-        auto const [b, t] = frisvadKernel(n);
-        quats[qindex] = mat3f::packTangentFrame({t, b, n}, sizeof(int32_t));
-        normals = pointerAdd(normals, 1, nstride);
-    }
+    parallelFor(input->jobSystem, vertexCount, [=](size_t start, size_t count) {
+        for (size_t qindex = start, end = start + count; qindex < end; ++qindex) {
+            float3 const n = *pointerAdd(normals, qindex, nstride);
+            auto const [b, t] = frisvadKernel(n);
+            quats[qindex] = mat3f::packTangentFrame({t, b, n}, sizeof(int32_t));
+        }
+    });
     output->vertexCount = input->vertexCount;
     output->triangleCount = input->triangleCount;
     output->passthrough(input->attributeData, {AttributeImpl::UV0, AttributeImpl::POSITIONS});
@@ -212,21 +217,22 @@ void hughesMollerMethod(TangentSpaceMeshInput const* input, TangentSpaceMeshOutp
     float3 const* UTILS_RESTRICT normals = input->normals();
     size_t const nstride = input->normalsStride();
 
-    for (size_t qindex = 0; qindex < vertexCount; ++qindex) {
-        float3 const n = *normals;
-        float3 b, t;
+    parallelFor(input->jobSystem, vertexCount, [=](size_t start, size_t count) {
+        for (size_t qindex = start, end = start + count; qindex < end; ++qindex) {
+            float3 const n = *pointerAdd(normals, qindex, nstride);
+            float3 b, t;
 
-        if (abs(n.x) > abs(n.z) + std::numeric_limits<float>::epsilon()) {
-            t = float3{-n.y, n.x, 0.0f};
-        } else {
-            t = float3{0.0f, -n.z, n.y};
-        }
-        t = normalize(t);
-        b = cross(n, t);
+            if (abs(n.x) > abs(n.z) + std::numeric_limits<float>::epsilon()) {
+                t = float3{-n.y, n.x, 0.0f};
+            } else {
+                t = float3{0.0f, -n.z, n.y};
+            }
+            t = normalize(t);
+            b = cross(n, t);
 
-        quats[qindex] = mat3f::packTangentFrame({t, b, n}, sizeof(int32_t));
-        normals = pointerAdd(normals, 1, nstride);
-    }
+            quats[qindex] = mat3f::packTangentFrame({t, b, n}, sizeof(int32_t));
+        }
+    });
     output->vertexCount = input->vertexCount;
     output->triangleCount = input->triangleCount;
     output->passthrough(input->attributeData, {AttributeImpl::UV0, AttributeImpl::POSITIONS});
@@ -309,66 +315,67 @@ void flatShadingMethod(TangentSpaceMeshInput const* input, TangentSpaceMeshOutpu
     size_t const outTriangleCount = triangleCount;
     uint3* outTriangles = output->triangles32.allocate(outTriangleCount);
 
-    size_t vindex = 0;
-    for (size_t tindex = 0; tindex < triangleCount; ++tindex) {
-        uint3 tri = isTriangle16 ?
-                uint3(*(ushort3*)(pointerAdd(triangles, tindex, tstride))) :
-                *(uint3*)(pointerAdd(triangles, tindex, tstride));
-
-        float3 const pa = *pointerAdd(positions, tri.x, pstride);
-        float3 const pb = *pointerAdd(positions, tri.y, pstride);
-        float3 const pc = *pointerAdd(positions, tri.z, pstride);
-
-        uint32_t i0 = vindex++, i1 = vindex++, i2 = vindex++;
-        outTriangles[tindex] = uint3{i0, i1, i2};
-
-        outPositions[i0] = pa;
-        outPositions[i1] = pb;
-        outPositions[i2] = pc;
-
-        float3 const n = normalize(cross(pc - pb, pa - pb));
-        const auto [t, b] = frisvadKernel(n);
-
-        quatf const tspace = mat3f::packTangentFrame({t, b, n}, sizeof(int32_t));
-        quats[i0] = tspace;
-        quats[i1] = tspace;
-        quats[i2] = tspace;
-
-        // We need to make sure that the aux data is ported to the new mesh
-        for (auto& [indata, outdata, attrib, stride]: outAttributes) {
-            if (std::holds_alternative<float2 const*>(indata)) {
-                float2* out = std::get<float2*>(outdata);
-                float2 const* in = std::get<float2 const*>(indata);
-                out[i0] = *pointerAdd(in, tri.x, stride);
-                out[i1] = *pointerAdd(in, tri.y, stride);
-                out[i2] = *pointerAdd(in, tri.z, stride);
-            } else if (std::holds_alternative<float3 const*>(indata)) {
-                float3* out = std::get<float3*>(outdata);
-                float3 const* in = std::get<float3 const*>(indata);
-                out[i0] = *pointerAdd(in, tri.x, stride);
-                out[i1] = *pointerAdd(in, tri.y, stride);
-                out[i2] = *pointerAdd(in, tri.z, stride);
-            } else if (std::holds_alternative<float4 const*>(indata)) {
-                float4* out = std::get<float4*>(outdata);
-                float4 const* in = std::get<float4 const*>(indata);
-                out[i0] = *pointerAdd(in, tri.x, stride);
-                out[i1] = *pointerAdd(in, tri.y, stride);
-                out[i2] = *pointerAdd(in, tri.z, stride);
-            } else if (std::holds_alternative<ushort3 const*>(indata)) {
-                ushort3* out = std::get<ushort3*>(outdata);
-                ushort3 const* in = std::get<ushort3 const*>(indata);
-                out[i0] = *pointerAdd(in, tri.x, stride);
-                out[i1] = *pointerAdd(in, tri.y, stride);
-                out[i2] = *pointerAdd(in, tri.z, stride);
-            } else if (std::holds_alternative<ushort4 const*>(indata)) {
-                ushort4* out = std::get<ushort4*>(outdata);
-                ushort4 const* in = std::get<ushort4 const*>(indata);
-                out[i0] = *pointerAdd(in, tri.x, stride);
-                out[i1] = *pointerAdd(in, tri.y, stride);
-                out[i2] = *pointerAdd(in, tri.z, stride);
+    parallelFor(input->jobSystem, triangleCount, [&](size_t start, size_t count) {
+        for (size_t tindex = start, end = start + count; tindex < end; ++tindex) {
+            uint3 tri = isTriangle16 ?
+                    uint3(*(ushort3*)(pointerAdd(triangles, tindex, tstride))) :
+                    *(uint3*)(pointerAdd(triangles, tindex, tstride));
+
+            float3 const pa = *pointerAdd(positions, tri.x, pstride);
+            float3 const pb = *pointerAdd(positions, tri.y, pstride);
+            float3 const pc = *pointerAdd(positions, tri.z, pstride);
+
+            uint32_t const i0 = tindex * 3, i1 = i0 + 1, i2 = i0 + 2;
+            outTriangles[tindex] = uint3{i0, i1, i2};
+
+            outPositions[i0] = pa;
+            outPositions[i1] = pb;
+            outPositions[i2] = pc;
+
+            float3 const n = normalize(cross(pc - pb, pa - pb));
+            const auto [t, b] = frisvadKernel(n);
+
+            quatf const tspace = mat3f::packTangentFrame({t, b, n}, sizeof(int32_t));
+            quats[i0] = tspace;
+            quats[i1] = tspace;
+            quats[i2] = tspace;
+
+            // We need to make sure that the aux data is ported to the new mesh
+            for (auto& [indata, outdata, attrib, stride]: outAttributes) {
+                if (std::holds_alternative<float2 const*>(indata)) {
+                    float2* out = std::get<float2*>(outdata);
+                    float2 const* in = std::get<float2 const*>(indata);
+                    out[i0] = *pointerAdd(in, tri.x, stride);
+                    out[i1] = *pointerAdd(in, tri.y, stride);
+                    out[i2] = *pointerAdd(in, tri.z, stride);
+                } else if (std::holds_alternative<float3 const*>(indata)) {
+                    float3* out = std::get<float3*>(outdata);
+                    float3 const* in = std::get<float3 const*>(indata);
+                    out[i0] = *pointerAdd(in, tri.x, stride);
+                    out[i1] = *pointerAdd(in, tri.y, stride);
+                    out[i2] = *pointerAdd(in, tri.z, stride);
+                } else if (std::holds_alternative<float4 const*>(indata)) {
+                    float4* out = std::get<float4*>(outdata);
+                    float4 const* in = std::get<float4 const*>(indata);
+                    out[i0] = *pointerAdd(in, tri.x, stride);
+                    out[i1] = *pointerAdd(in, tri.y, stride);
+                    out[i2] = *pointerAdd(in, tri.z, stride);
+                } else if (std::holds_alternative<ushort3 const*>(indata)) {
+                    ushort3* out = std::get<ushort3*>(outdata);
+                    ushort3 const* in = std::get<ushort3 const*>(indata);
+                    out[i0] = *pointerAdd(in, tri.x, stride);
+                    out[i1] = *pointerAdd(in, tri.y, stride);
+                    out[i2] = *pointerAdd(in, tri.z, stride);
+                } else if (std::holds_alternative<ushort4 const*>(indata)) {
+                    ushort4* out = std::get<ushort4*>(outdata);
+                    ushort4 const* in = std::get<ushort4 const*>(indata);
+                    out[i0] = *pointerAdd(in, tri.x, stride);
+                    out[i1] = *pointerAdd(in, tri.y, stride);
+                    out[i2] = *pointerAdd(in, tri.z, stride);
+                }
             }
         }
-    }
+    });
 
     output->vertexCount = outVertexCount;
     output->triangleCount = outTriangleCount;
@@ -385,20 +392,22 @@ void tangentsProvidedMethod(TangentSpaceMeshInput const* input, TangentSpaceMesh
     float4 const* tanvec = input->tangents();
     size_t const tstride = input->tangentsStride();
 
-    for (size_t qindex = 0; qindex < vertexCount; ++qindex) {
-        float3 const& n = *pointerAdd(normal, qindex, nstride);
-        float4 const& t4 = *pointerAdd(tanvec, qindex, nstride);
-        float3 tv = t4.xyz;
-        float3 b = t4.w > 0 ? cross(tv, n) : cross(n, tv);
+    parallelFor(input->jobSystem, vertexCount, [=](size_t start, size_t count) {
+        for (size_t qindex = start, end = start + count; qindex < end; ++qindex) {
+            float3 const& n = *pointerAdd(normal, qindex, nstride);
+            float4 const& t4 = *pointerAdd(tanvec, qindex, nstride);
+            float3 tv = t4.xyz;
+            float3 b = t4.w > 0 ? cross(tv, n) : cross(n, tv);
 
-        // Some assets do not provide perfectly orthogonal tangents and normals, so we adjust the
-        // tangent to enforce orthonormality. We would rather honor the exact normal vector than
-        // the exact tangent vector since the latter is only used for bump mapping and anisotropic
-        // lighting.
-        tv = t4.w > 0 ? cross(n, b) : cross(b, n);
+            // Some assets do not provide perfectly orthogonal tangents and normals, so we adjust
+            // the tangent to enforce orthonormality. We would rather honor the exact normal vector
+            // than the exact tangent vector since the latter is only used for bump mapping and
+            // anisotropic lighting.
+            tv = t4.w > 0 ? cross(n, b) : cross(b, n);
 
-        quats[qindex] = mat3f::packTangentFrame({tv, b, n});
-    }
+            quats[qindex] = mat3f::packTangentFrame({tv, b, n});
+        }
+    });
 
     output->vertexCount = vertexCount;
     output->triangleCount = input->triangleCount;
@@ -434,12 +443,16 @@ void lengyelMethod(TangentSpaceMeshInput const* input, TangentSpaceMeshOutput* o
     auto positions = input->positions();
     auto uvs = input->uvs();
     auto normals = input->normals();
+    utils::JobSystem* const js = input->jobSystem;
 
-    std::vector<float3> tan1(vertexCount, float3{0.0f});
-    std::vector<float3> tan2(vertexCount, float3{0.0f});
-    for (size_t a = 0; a < triangleCount; ++a) {
-        uint3 tri = triangles16 ? uint3(triangles16[a]) : triangles32[a];
+    auto const getTriangle = [=](size_t a) {
+        uint3 const tri = triangles16 ? uint3(triangles16[a]) : triangles32[a];
         assert_invariant(tri.x < vertexCount && tri.y < vertexCount && tri.z < vertexCount);
+        return tri;
+    };
+
+    // Computes the (unnormalized) directions of increasing u and v of a triangle.
+    auto const getDirections = [=](uint3 const& tri) -> std::pair<float3, float3> {
         float3 const& v1 = *pointerAdd(positions, tri.x, positionStride);
         float3 const& v2 = *pointerAdd(positions, tri.y, positionStride);
         float3 const& v3 = *pointerAdd(positions, tri.z, positionStride);
@@ -471,19 +484,11 @@ void lengyelMethod(TangentSpaceMeshInput const* input, TangentSpaceMeshOutput* o
             sdir *= r;
             tdir *= r;
         }
-        tan1[tri.x] += sdir;
-        tan1[tri.y] += sdir;
-        tan1[tri.z] += sdir;
-        tan2[tri.x] += tdir;
-        tan2[tri.y] += tdir;
-        tan2[tri.z] += tdir;
-    }
+        return { sdir, tdir };
+    };
 
-    quatf* quats = output->tspace().allocate(vertexCount);
-    for (size_t a = 0; a < vertexCount; a++) {
+    auto const getTangentFrame = [=](size_t a, float3 const& t1, float3 const& t2) {
         float3 const& n = *pointerAdd(normals, a, normalStride);
-        float3 const& t1 = tan1[a];
-        float3 const& t2 = tan2[a];
 
         // Gram-Schmidt orthogonalize
         float3 const t = normalize(t1 - n * dot(n, t1));
@@ -492,9 +497,67 @@ void lengyelMethod(TangentSpaceMeshInput const* input, TangentSpaceMeshOutput* o
         float const w = (dot(cross(n, t1), t2) < 0.0f) ? -1.0f : 1.0f;
 
         float3 b = w < 0 ? cross(t, n) : cross(n, t);
-        quats[a] = mat3f::packTangentFrame({t, b, n}, sizeof(int32_t));
+        return mat3f::packTangentFrame({t, b, n}, sizeof(int32_t));
+    };
+
+    quatf* quats = output->tspace().allocate(vertexCount);
+
+    // Accumulating into the vertices from ranges of triangles would change the order of the
+    // additions, and therefore the result. Instead, each vertex gathers the directions of its
+    // triangles, in triangle order, through a list of the triangle corners sorted by vertex.
+    std::unique_ptr<float3[]> sdirs(new float3[triangleCount]);
+    std::unique_ptr<float3[]> tdirs(new float3[triangleCount]);
+    std::unique_ptr<uint32_t[]> corners(new uint32_t[triangleCount * 3]);
+    std::unique_ptr<std::atomic<uint32_t>[]> offsets(new std::atomic<uint32_t>[vertexCount + 1]);
+
+    parallelFor(js, vertexCount + 1, [&](size_t start, size_t count) {
+        for (size_t a = start, end = start + count; a < end; a++) {
+            offsets[a].store(0, std::memory_order_relaxed);
+        }
+    });
+
+    parallelFor(js, triangleCount, [&](size_t start, size_t count) {
+        for (size_t a = start, end = start + count; a < end; ++a) {
+            uint3 const tri = getTriangle(a);
+            std::tie(sdirs[a], tdirs[a]) = getDirections(tri);
+            for (size_t k = 0; k < 3; k++) {
+                offsets[tri[k]].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    // offsets[a] becomes the end of the corners of vertex a...
+    for (size_t a = 1; a <= vertexCount; a++) {
+        offsets[a].store(offsets[a].load(std::memory_order_relaxed) +
+                offsets[a - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
     }
 
+    // ...and then their start, once they're all filled in
+    parallelFor(js, triangleCount, [&](size_t start, size_t count) {
+        for (size_t a = start, end = start + count; a < end; ++a) {
+            uint3 const tri = getTriangle(a);
+            for (size_t k = 0; k < 3; k++) {
+                uint32_t const i = offsets[tri[k]].fetch_sub(1, std::memory_order_relaxed);
+                corners[i - 1] = uint32_t(a * 3 + k);
+            }
+        }
+    });
+
+    parallelFor(js, vertexCount, [&](size_t start, size_t count) {
+        for (size_t a = start, end = start + count; a < end; a++) {
+            uint32_t* const first = corners.get() + offsets[a].load(std::memory_order_relaxed);
+            uint32_t* const last = corners.get() + offsets[a + 1].load(std::memory_order_relaxed);
+            std::sort(first, last);
+            float3 t1{ 0.0f };
+            float3 t2{ 0.0f };
+            for (uint32_t const* corner = first; corner != last; ++corner) {
+                t1 += sdirs[*corner / 3];
+                t2 += tdirs[*corner / 3];
+            }
+            quats[a] = getTangentFrame(a, t1, t2);
+        }
+    });
+
     output->vertexCount = vertexCount;
     output->triangleCount = triangleCount;
     output->passthrough(input->attributeData, {AttributeImpl::UV0, AttributeImpl::POSITIONS});
@@ -579,6 +642,11 @@ Builder& Builder::algorithm(Algorithm algo) noexcept {
     return *this;
 }
 
+Builder& Builder::jobSystem(utils::JobSystem* jobSystem) noexcept {
+    mMesh->mInput->jobSystem = jobSystem;
+    return *this;
+}
+
 TangentSpaceMesh* Builder::build() {
     FILAMENT_CHECK_PRECONDITION(!mMesh->mInput->triangles32 || !mMesh->mInput->triangles16)
             << "Cannot provide both uint32 triangles and uint16 triangles";
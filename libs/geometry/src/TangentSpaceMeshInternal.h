@@ -23,6 +23,7 @@
 #include <math/norm.h>
 #include <math/quat.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 
 #include <unordered_map>
@@ -52,6 +53,25 @@ inline InputType* pointerAdd(InputType* ptr, size_t index, size_t stride) noexce
     return (InputType*) (((uint8_t*) ptr) + (index * stride));
 }
 
+// Ranges of vertices or triangles shorter than this are not split further across the JobSystem.
+constexpr size_t PARALLEL_GRAIN = 4096;
+
+// Calls fn(start, count) for ranges covering [0, count), on the JobSystem if there is one and the
+// range is worth splitting, on the calling thread otherwise. fn must only write the elements of its
+// own range.
+template<typename F>
+inline void parallelFor(utils::JobSystem* js, size_t count, F const& fn) {
+    if (!js || count < PARALLEL_GRAIN * 2) {
+        fn(size_t(0), count);
+        return;
+    }
+    assert_invariant(count <= UINT32_MAX);
+    utils::JobSystem::Job* job = utils::jobs::parallel_for(*js, nullptr, 0, uint32_t(count),
+            [&fn](uint32_t start, uint32_t c) { fn(size_t(start), size_t(c)); },
+            utils::jobs::CountSplitter<PARALLEL_GRAIN>());
+    js->runAndWait(job);
+}
+
 // Defines the actual implementation used to compute the TBN, where as TangentSpaceMesh::Algorithm
 // is a hint that the client can provide.
 enum class AlgorithmImpl : uint8_t {
@@ -327,6 +347,8 @@ struct TangentSpaceMeshInput {
     AttributeMap attributeData;
 
     Algorithm algorithm;
+
+    utils::JobSystem* jobSystem = nullptr;
 };
 
 struct TangentSpaceMeshOutput {
@@ -16,8 +16,26 @@
 
 #include <geometry/Transcoder.h>
 
+#include <utils/JobSystem.h>
+
 #include <math/half.h>
 
+#include <algorithm>
+#include <type_traits>
+
+#include <string.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#   include <arm_neon.h>
+#   define TRANSCODER_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#   include <immintrin.h>
+#   define TRANSCODER_SSE2 1
+#   if defined(__GNUC__) || defined(__clang__)
+#       define TRANSCODER_AVX2 1
+#   endif
+#endif
+
 using filament::math::half;
 
 namespace filament {
@@ -85,17 +103,366 @@ void convertClamped(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT sou
     }
 }
 
-size_t Transcoder::operator()(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
-        size_t count) const noexcept {
-    const size_t required = count * mConfig.componentCount * sizeof(float);
-    if (target == nullptr) {
-        return required;
+// Tightly packed data is converted as a flat array of components, regardless of the component
+// count, which is what the kernels below do. "clamp" is only set for signed normalized types.
+using Kernel = void(*)(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
+        size_t count, float scale, bool clamp) noexcept;
+
+template<typename SOURCE_TYPE>
+void convertPacked(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
+        size_t count, float scale, bool clamp) noexcept {
+    SOURCE_TYPE const* src = (SOURCE_TYPE const*) source;
+    for (size_t i = 0; i < count; ++i) {
+        const float value = float(src[i]) * scale;
+        target[i] = clamp && value < -1.0f ? -1.0f : value;
+    }
+}
+
+#if TRANSCODER_SSE2
+
+// SSE2 has no sign or zero extensions, they're done by interleaving each element with itself
+// (then shifting arithmetically) or with zeros.
+
+inline void storeSSE2(float* target, __m128i v, __m128 scale, __m128 minusOne, bool clamp) {
+    __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(v), scale);
+    _mm_storeu_ps(target, clamp ? _mm_max_ps(f, minusOne) : f);
+}
+
+template<bool SIGNED>
+void convertBytesSSE2(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
+        size_t count, float scale, bool clamp) noexcept {
+    uint8_t const* src = (uint8_t const*) source;
+    __m128 const s = _mm_set1_ps(scale);
+    __m128 const minusOne = _mm_set1_ps(-1.0f);
+    __m128i const zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i const v = _mm_loadu_si128((__m128i const*) (src + i));
+        __m128i const lo = SIGNED ? _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8)
+                                  : _mm_unpacklo_epi8(v, zero);
+        __m128i const hi = SIGNED ? _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8)
+                                  : _mm_unpackhi_epi8(v, zero);
+        __m128i const shorts[2] = { lo, hi };
+        for (size_t j = 0; j < 2; j++) {
+            __m128i const w = shorts[j];
+            __m128i const a = SIGNED ? _mm_srai_epi32(_mm_unpacklo_epi16(w, w), 16)
+                                     : _mm_unpacklo_epi16(w, zero);
+            __m128i const b = SIGNED ? _mm_srai_epi32(_mm_unpackhi_epi16(w, w), 16)
+                                     : _mm_unpackhi_epi16(w, zero);
+            storeSSE2(target + i + j * 8, a, s, minusOne, clamp);
+            storeSSE2(target + i + j * 8 + 4, b, s, minusOne, clamp);
+        }
+    }
+    using T = std::conditional_t<SIGNED, int8_t, uint8_t>;
+    convertPacked<T>(target + i, src + i, count - i, scale, clamp);
+}
+
+template<bool SIGNED>
+void convertShortsSSE2(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
+        size_t count, float scale, bool clamp) noexcept {
+    uint16_t const* src = (uint16_t const*) source;
+    __m128 const s = _mm_set1_ps(scale);
+    __m128 const minusOne = _mm_set1_ps(-1.0f);
+    __m128i const zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i const w = _mm_loadu_si128((__m128i const*) (src + i));
+        __m128i const a = SIGNED ? _mm_srai_epi32(_mm_unpacklo_epi16(w, w), 16)
+                                 : _mm_unpacklo_epi16(w, zero);
+        __m128i const b = SIGNED ? _mm_srai_epi32(_mm_unpackhi_epi16(w, w), 16)
+                                 : _mm_unpackhi_epi16(w, zero);
+        storeSSE2(target + i, a, s, minusOne, clamp);
+        storeSSE2(target + i + 4, b, s, minusOne, clamp);
+    }
+    using T = std::conditional_t<SIGNED, int16_t, uint16_t>;
+    convertPacked<T>(target + i, src + i, count - i, scale, clamp);
+}
+
+#endif // TRANSCODER_SSE2
+
+#if TRANSCODER_AVX2
+
+#define TRANSCODER_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+
+TRANSCODER_TARGET_AVX2
+inline void storeAVX2(float* target, __m256i v, __m256 scale, bool clamp) {
+    __m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale);
+    _mm256_storeu_ps(target, clamp ? _mm256_max_ps(f, _mm256_set1_ps(-1.0f)) : f);
+}
+
+TRANSCODER_TARGET_AVX2
+static void convertBytesAVX2(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
+        size_t count, float scale, bool clamp) noexcept {
+    int8_t const* src = (int8_t const*) source;
+    __m256 const s = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i const v = _mm_loadl_epi64((__m128i const*) (src + i));
+        storeAVX2(target + i, _mm256_cvtepi8_epi32(v), s, clamp);
+    }
+    convertPacked<int8_t>(target + i, src + i, count - i, scale, clamp);
+}
+
+TRANSCODER_TARGET_AVX2
+static void convertUnsignedBytesAVX2(float* UTILS_RESTRICT target,
+        void const* UTILS_RESTRICT source, size_t count, float scale, bool clamp) noexcept {
+    uint8_t const* src = (uint8_t const*) source;
+    __m256 const s = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i const v = _mm_loadl_epi64((__m128i const*) (src + i));
+        storeAVX2(target + i, _mm256_cvtepu8_epi32(v), s, clamp);
+    }
+    convertPacked<uint8_t>(target + i, src + i, count - i, scale, clamp);
+}
+
+TRANSCODER_TARGET_AVX2
+static void convertShortsAVX2(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
+        size_t count, float scale, bool clamp) noexcept {
+    int16_t const* src = (int16_t const*) source;
+    __m256 const s = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i const v = _mm_loadu_si128((__m128i const*) (src + i));
+        storeAVX2(target + i, _mm256_cvtepi16_epi32(v), s, clamp);
+    }
+    convertPacked<int16_t>(target + i, src + i, count - i, scale, clamp);
+}
+
+TRANSCODER_TARGET_AVX2
+static void convertUnsignedShortsAVX2(float* UTILS_RESTRICT target,
+        void const* UTILS_RESTRICT source, size_t count, float scale, bool clamp) noexcept {
+    uint16_t const* src = (uint16_t const*) source;
+    __m256 const s = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i const v = _mm_loadu_si128((__m128i const*) (src + i));
+        storeAVX2(target + i, _mm256_cvtepu16_epi32(v), s, clamp);
+    }
+    convertPacked<uint16_t>(target + i, src + i, count - i, scale, clamp);
+}
+
+TRANSCODER_TARGET_AVX2
+static void convertHalfsAVX2(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
+        size_t count, float, bool) noexcept {
+    uint16_t const* src = (uint16_t const*) source;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i const v = _mm_loadu_si128((__m128i const*) (src + i));
+        _mm256_storeu_ps(target + i, _mm256_cvtph_ps(v));
+    }
+    convertPacked<half>(target + i, src + i, count - i, 1.0f, false);
+}
+
+#undef TRANSCODER_TARGET_AVX2
+
+#endif // TRANSCODER_AVX2
+
+#if TRANSCODER_NEON
+
+inline void storeNEON(float* target, float32x4_t f, float scale, bool clamp) {
+    f = vmulq_n_f32(f, scale);
+    vst1q_f32(target, clamp ? vmaxq_f32(f, vdupq_n_f32(-1.0f)) : f);
+}
+
+static void convertBytesNEON(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
+        size_t count, float scale, bool clamp) noexcept {
+    int8_t const* src = (int8_t const*) source;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t const w = vmovl_s8(vld1_s8(src + i));
+        storeNEON(target + i, vcvtq_f32_s32(vmovl_s16(vget_low_s16(w))), scale, clamp);
+        storeNEON(target + i + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(w))), scale, clamp);
+    }
+    convertPacked<int8_t>(target + i, src + i, count - i, scale, clamp);
+}
+
+static void convertUnsignedBytesNEON(float* UTILS_RESTRICT target,
+        void const* UTILS_RESTRICT source, size_t count, float scale, bool clamp) noexcept {
+    uint8_t const* src = (uint8_t const*) source;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t const w = vmovl_u8(vld1_u8(src + i));
+        storeNEON(target + i, vcvtq_f32_u32(vmovl_u16(vget_low_u16(w))), scale, clamp);
+        storeNEON(target + i + 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(w))), scale, clamp);
+    }
+    convertPacked<uint8_t>(target + i, src + i, count - i, scale, clamp);
+}
+
+static void convertShortsNEON(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
+        size_t count, float scale, bool clamp) noexcept {
+    int16_t const* src = (int16_t const*) source;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t const w = vld1q_s16(src + i);
+        storeNEON(target + i, vcvtq_f32_s32(vmovl_s16(vget_low_s16(w))), scale, clamp);
+        storeNEON(target + i + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(w))), scale, clamp);
+    }
+    convertPacked<int16_t>(target + i, src + i, count - i, scale, clamp);
+}
+
+static void convertUnsignedShortsNEON(float* UTILS_RESTRICT target,
+        void const* UTILS_RESTRICT source, size_t count, float scale, bool clamp) noexcept {
+    uint16_t const* src = (uint16_t const*) source;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t const w = vld1q_u16(src + i);
+        storeNEON(target + i, vcvtq_f32_u32(vmovl_u16(vget_low_u16(w))), scale, clamp);
+        storeNEON(target + i + 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(w))), scale, clamp);
+    }
+    convertPacked<uint16_t>(target + i, src + i, count - i, scale, clamp);
+}
+
+static void convertHalfsNEON(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
+        size_t count, float, bool) noexcept {
+    uint16_t const* src = (uint16_t const*) source;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(target + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+    }
+    convertPacked<half>(target + i, src + i, count - i, 1.0f, false);
+}
+
+#endif // TRANSCODER_NEON
+
+struct Kernels {
+    Kernel byteKernel;
+    Kernel ubyteKernel;
+    Kernel shortKernel;
+    Kernel ushortKernel;
+    Kernel halfKernel;
+};
+
+// The best kernels for the CPU we're running on, AVX2 is only used if it's available.
+static Kernels const& getKernels() noexcept {
+    static Kernels const kernels = []() -> Kernels {
+#if TRANSCODER_NEON
+        return { convertBytesNEON, convertUnsignedBytesNEON,
+                 convertShortsNEON, convertUnsignedShortsNEON, convertHalfsNEON };
+#else
+#   if TRANSCODER_AVX2
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c")) {
+            return { convertBytesAVX2, convertUnsignedBytesAVX2,
+                     convertShortsAVX2, convertUnsignedShortsAVX2, convertHalfsAVX2 };
+        }
+#   endif
+#   if TRANSCODER_SSE2
+        return { convertBytesSSE2<true>, convertBytesSSE2<false>,
+                 convertShortsSSE2<true>, convertShortsSSE2<false>, convertPacked<half> };
+#   else
+        return { convertPacked<int8_t>, convertPacked<uint8_t>,
+                 convertPacked<int16_t>, convertPacked<uint16_t>, convertPacked<half> };
+#   endif
+#endif
+    }();
+    return kernels;
+}
+
+static size_t getComponentSize(ComponentType type) noexcept {
+    switch (type) {
+        case ComponentType::BYTE:
+        case ComponentType::UBYTE:
+            return 1;
+        case ComponentType::SHORT:
+        case ComponentType::USHORT:
+        case ComponentType::HALF:
+            return 2;
+        case ComponentType::FLOAT:
+            return 4;
+    }
+    return 0;
+}
+
+static size_t getStride(Transcoder::Config const& config) noexcept {
+    return config.inputStrideBytes ? config.inputStrideBytes :
+            getComponentSize(config.componentType) * config.componentCount;
+}
+
+// Interleaved attributes of up to 16 bytes are gathered into a small packed buffer, a chunk of
+// vertices at a time, so they can be converted with the kernels as well.
+template<size_t SIZE>
+static void gather(uint8_t* UTILS_RESTRICT packed, uint8_t const* UTILS_RESTRICT source,
+        size_t count, size_t stride) noexcept {
+    for (size_t i = 0; i < count; ++i, packed += SIZE, source += stride) {
+        memcpy(packed, source, SIZE);
+    }
+}
+
+static bool gatherAndTranscode(Transcoder::Config const& config, Kernels const& kernels,
+        float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source, size_t count) noexcept {
+    constexpr size_t CHUNK_VERTEX_COUNT = 256;
+    const size_t size = getComponentSize(config.componentType) * config.componentCount;
+    const size_t stride = getStride(config);
+    if (stride == size || size > 16 || config.componentType == ComponentType::FLOAT) {
+        return false;
+    }
+
+    Kernel kernel;
+    float scale = 1.0f;
+    bool clamp = false;
+    switch (config.componentType) {
+        case ComponentType::BYTE:
+            kernel = kernels.byteKernel;
+            scale = config.normalized ? 1.0f / 127.0f : 1.0f;
+            clamp = config.normalized;
+            break;
+        case ComponentType::UBYTE:
+            kernel = kernels.ubyteKernel;
+            scale = config.normalized ? 1.0f / 255.0f : 1.0f;
+            break;
+        case ComponentType::SHORT:
+            kernel = kernels.shortKernel;
+            scale = config.normalized ? 1.0f / 32767.0f : 1.0f;
+            clamp = config.normalized;
+            break;
+        case ComponentType::USHORT:
+            kernel = kernels.ushortKernel;
+            scale = config.normalized ? 1.0f / 65535.0f : 1.0f;
+            break;
+        case ComponentType::HALF:
+        case ComponentType::FLOAT:
+            kernel = kernels.halfKernel;
+            break;
+    }
+
+    alignas(16) uint8_t packed[CHUNK_VERTEX_COUNT * 16];
+    uint8_t const* src = (uint8_t const*) source;
+    for (size_t i = 0; i < count; i += CHUNK_VERTEX_COUNT) {
+        const size_t n = std::min(CHUNK_VERTEX_COUNT, count - i);
+        switch (size) {
+            case 2:  gather<2>(packed, src, n, stride);  break;
+            case 3:  gather<3>(packed, src, n, stride);  break;
+            case 4:  gather<4>(packed, src, n, stride);  break;
+            case 6:  gather<6>(packed, src, n, stride);  break;
+            case 8:  gather<8>(packed, src, n, stride);  break;
+            default:
+                for (size_t j = 0; j < n; j++) {
+                    memcpy(packed + j * size, src + j * stride, size);
+                }
+                break;
+        }
+        kernel(target, packed, n * config.componentCount, scale, clamp);
+        target += n * config.componentCount;
+        src += n * stride;
+    }
+    return true;
+}
+
+static void transcode(Transcoder::Config const& config, float* UTILS_RESTRICT target,
+        void const* UTILS_RESTRICT source, size_t count) noexcept {
+    const uint32_t comp = config.componentCount;
+    Kernels const& kernels = getKernels();
+    if (gatherAndTranscode(config, kernels, target, source, count)) {
+        return;
     }
-    const uint32_t comp = mConfig.componentCount;
-    switch (mConfig.componentType) {
+    switch (config.componentType) {
         case ComponentType::BYTE: {
-            const uint32_t stride = mConfig.inputStrideBytes ? mConfig.inputStrideBytes : comp;
-            if (mConfig.normalized) {
+            const uint32_t stride = config.inputStrideBytes ? config.inputStrideBytes : comp;
+            if (stride == comp) {
+                kernels.byteKernel(target, source, count * comp,
+                        config.normalized ? 1.0f / 127.0f : 1.0f, config.normalized);
+            } else if (config.normalized) {
                 if (comp == 2) {
                     convertClamped<int8_t, 127, 2>(target, source, count, stride);
                 } else if (comp == 3) {
@@ -112,11 +479,14 @@ size_t Transcoder::operator()(float* UTILS_RESTRICT target, void const* UTILS_RE
                     convert<int8_t, 1>(target, source, count, comp, stride);
                 }
             }
-            return required;
+            return;
         }
         case ComponentType::UBYTE: {
-            const uint32_t stride = mConfig.inputStrideBytes ? mConfig.inputStrideBytes : comp;
-            if (mConfig.normalized) {
+            const uint32_t stride = config.inputStrideBytes ? config.inputStrideBytes : comp;
+            if (stride == comp) {
+                kernels.ubyteKernel(target, source, count * comp,
+                        config.normalized ? 1.0f / 255.0f : 1.0f, false);
+            } else if (config.normalized) {
                 if (comp == 2) {
                     convert<uint8_t, 255, 2>(target, source, count, stride);
                 } else if (comp == 3) {
@@ -133,11 +503,14 @@ size_t Transcoder::operator()(float* UTILS_RESTRICT target, void const* UTILS_RE
                     convert<uint8_t, 1>(target, source, count, comp, stride);
                 }
             }
-            return required;
+            return;
         }
         case ComponentType::SHORT: {
-            const uint32_t stride = mConfig.inputStrideBytes ? mConfig.inputStrideBytes : (2 * comp);
-            if (mConfig.normalized) {
+            const uint32_t stride = config.inputStrideBytes ? config.inputStrideBytes : (2 * comp);
+            if (stride == 2 * comp) {
+                kernels.shortKernel(target, source, count * comp,
+                        config.normalized ? 1.0f / 32767.0f : 1.0f, config.normalized);
+            } else if (config.normalized) {
                 if (comp == 2) {
                     convertClamped<int16_t, 32767, 2>(target, source, count, stride);
                 } else if (comp == 3) {
@@ -154,11 +527,14 @@ size_t Transcoder::operator()(float* UTILS_RESTRICT target, void const* UTILS_RE
                     convert<int16_t, 1>(target, source, count, comp, stride);
                 }
             }
-            return required;
+            return;
         }
         case ComponentType::USHORT: {
-            const uint32_t stride = mConfig.inputStrideBytes ? mConfig.inputStrideBytes : (2 * comp);
-            if (mConfig.normalized) {
+            const uint32_t stride = config.inputStrideBytes ? config.inputStrideBytes : (2 * comp);
+            if (stride == 2 * comp) {
+                kernels.ushortKernel(target, source, count * comp,
+                        config.normalized ? 1.0f / 65535.0f : 1.0f, false);
+            } else if (config.normalized) {
                 if (comp == 2) {
                     convert<uint16_t, 65535, 2>(target, source, count, stride);
                 } else if (comp == 3) {
@@ -175,10 +551,14 @@ size_t Transcoder::operator()(float* UTILS_RESTRICT target, void const* UTILS_RE
                     convert<uint16_t, 1>(target, source, count, comp, stride);
                 }
             }
-            return required;
+            return;
         }
         case ComponentType::HALF: {
-            const uint32_t stride = mConfig.inputStrideBytes ? mConfig.inputStrideBytes : (2 * comp);
+            const uint32_t stride = config.inputStrideBytes ? config.inputStrideBytes : (2 * comp);
+            if (stride == 2 * comp) {
+                kernels.halfKernel(target, source, count * comp, 1.0f, false);
+                return;
+            }
             uint8_t const* srcBytes = (uint8_t const*) source;
             for (size_t i = 0; i < count; ++i, target += comp, srcBytes += stride) {
                 half const* src = (half const*) srcBytes;
@@ -186,11 +566,15 @@ size_t Transcoder::operator()(float* UTILS_RESTRICT target, void const* UTILS_RE
                     target[n] = float(src[n]);
                 }
             }
-            return required;
+            return;
         }
         case ComponentType::FLOAT: {
             const uint32_t srcStride =
-                    mConfig.inputStrideBytes ? mConfig.inputStrideBytes : (4 * comp);
+                    config.inputStrideBytes ? config.inputStrideBytes : (4 * comp);
+            if (srcStride == 4 * comp) {
+                memcpy(target, source, count * comp * sizeof(float));
+                return;
+            }
             uint8_t const* srcBytes = (uint8_t const*) source;
             for (size_t i = 0; i < count; ++i, target += comp, srcBytes += srcStride) {
                 // This will never break alignment rules because the glTF spec stipulates that the
@@ -200,10 +584,72 @@ size_t Transcoder::operator()(float* UTILS_RESTRICT target, void const* UTILS_RE
                     target[n] = src[n];
                 }
             }
-            return required;
+            return;
         }
     }
-    return 0;
+}
+
+// Number of vertices converted by a job. Conversions are memory bound, so this is large enough
+// for the overhead of a job to be negligible.
+static constexpr size_t JOB_VERTEX_COUNT = 64 * 1024;
+
+// Number of vertices of an interleaved stream converted attribute by attribute, while they're in
+// the cache.
+static constexpr size_t BLOCK_VERTEX_COUNT = 1024;
+
+template<typename F>
+static void parallelFor(utils::JobSystem& js, size_t count, F const& fn) {
+    if (count < JOB_VERTEX_COUNT * 2) {
+        fn(size_t(0), count);
+        return;
+    }
+    utils::JobSystem::Job* job = utils::jobs::parallel_for(js, nullptr, 0, uint32_t(count),
+            [&fn](uint32_t start, uint32_t c) { fn(size_t(start), size_t(c)); },
+            utils::jobs::CountSplitter<JOB_VERTEX_COUNT>());
+    js.runAndWait(job);
+}
+
+size_t Transcoder::operator()(float* UTILS_RESTRICT target, void const* UTILS_RESTRICT source,
+        size_t count) const noexcept {
+    const size_t required = count * mConfig.componentCount * sizeof(float);
+    if (target != nullptr) {
+        transcode(mConfig, target, source, count);
+    }
+    return required;
+}
+
+size_t Transcoder::operator()(utils::JobSystem& js, float* UTILS_RESTRICT target,
+        void const* UTILS_RESTRICT source, size_t count) const noexcept {
+    const size_t required = count * mConfig.componentCount * sizeof(float);
+    if (target != nullptr) {
+        size_t const stride = getStride(mConfig);
+        parallelFor(js, count, [&](size_t start, size_t c) {
+            transcode(mConfig, target + start * mConfig.componentCount,
+                    (uint8_t const*) source + start * stride, c);
+        });
+    }
+    return required;
+}
+
+void Transcoder::decode(Attribute const* attributes, size_t attributeCount,
+        void const* UTILS_RESTRICT source, size_t count, utils::JobSystem* js) noexcept {
+    auto const decodeRange = [=](size_t start, size_t c) {
+        for (size_t end = start + c; start < end; start += BLOCK_VERTEX_COUNT) {
+            size_t const n = std::min(BLOCK_VERTEX_COUNT, end - start);
+            for (size_t i = 0; i < attributeCount; i++) {
+                Attribute const& attribute = attributes[i];
+                transcode(attribute.config,
+                        attribute.target + start * attribute.config.componentCount,
+                        (uint8_t const*) source + attribute.offset +
+                                start * getStride(attribute.config), n);
+            }
+        }
+    };
+    if (js) {
+        parallelFor(*js, count, decodeRange);
+    } else {
+        decodeRange(0, count);
+    }
 }
 
 } // namespace geometry
@@ -21,8 +21,10 @@
 
 #include <gtest/gtest.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Log.h>
 
+#include <functional>
 #include <vector>
 
 class TangentSpaceMeshTest : public testing::Test {};
@@ -137,6 +139,43 @@ bool isAlmostEqual2(const float2& a, const float2& b) noexcept { ALMOST_EQUAL();
 
 #undef ALMOST_EQUAL
 
+// A UV sphere, with enough vertices and triangles for the computations to be split across a
+// JobSystem. The poles are made of degenerate triangles.
+struct Sphere {
+    std::vector<float3> positions;
+    std::vector<float3> normals;
+    std::vector<float4> tangents;
+    std::vector<float2> uvs;
+    std::vector<float4> colors;
+    std::vector<uint3> triangles;
+};
+
+Sphere createSphere(uint32_t const segments) {
+    Sphere sphere;
+    for (uint32_t i = 0; i <= segments; i++) {
+        float const theta = float(i) / float(segments) * float(M_PI);
+        for (uint32_t j = 0; j <= segments; j++) {
+            float const phi = float(j) / float(segments) * float(2.0 * M_PI);
+            float3 const p{ std::sin(theta) * std::cos(phi), std::cos(theta),
+                    std::sin(theta) * std::sin(phi) };
+            sphere.positions.push_back(p);
+            sphere.normals.push_back(p);
+            sphere.tangents.push_back({ -std::sin(phi), 0, std::cos(phi), 1 });
+            sphere.uvs.push_back({ float(j) / float(segments), float(i) / float(segments) });
+            sphere.colors.push_back({ p * 0.5f + 0.5f, 1 });
+        }
+    }
+    for (uint32_t i = 0; i < segments; i++) {
+        for (uint32_t j = 0; j < segments; j++) {
+            uint32_t const a = i * (segments + 1) + j;
+            uint32_t const c = a + segments + 1;
+            sphere.triangles.push_back({ a, c, a + 1 });
+            sphere.triangles.push_back({ a + 1, c, c + 1 });
+        }
+    }
+    return sphere;
+}
+
 } // anonymous namespace
 
 TEST_F(TangentSpaceMeshTest, BuilderDefaultAlgorithmsRemeshes) {
@@ -427,6 +466,113 @@ TEST_F(TangentSpaceMeshTest, Lengyel) {
     TangentSpaceMesh::destroy(mesh);
 }
 
+TEST_F(TangentSpaceMeshTest, JobSystem) {
+    utils::JobSystem js;
+    js.adopt();
+
+    Sphere const sphere = createSphere(128);
+
+    // The same mesh computed with and without a JobSystem must be identical.
+    auto const check = [&js](std::function<void(TangentSpaceMesh::Builder&)> const& setup) {
+        TangentSpaceMesh::Builder builder;
+        setup(builder);
+        TangentSpaceMesh* expected = builder.build();
+        setup(builder);
+        TangentSpaceMesh* actual = builder.jobSystem(&js).build();
+
+        size_t const vertexCount = expected->getVertexCount();
+        size_t const triangleCount = expected->getTriangleCount();
+        ASSERT_EQ(actual->getVertexCount(), vertexCount);
+        ASSERT_EQ(actual->getTriangleCount(), triangleCount);
+
+        std::vector<quatf> expectedQuats(vertexCount), actualQuats(vertexCount);
+        expected->getQuats(expectedQuats.data());
+        actual->getQuats(actualQuats.data());
+        EXPECT_EQ(0, memcmp(expectedQuats.data(), actualQuats.data(),
+                vertexCount * sizeof(quatf)));
+
+        if (expected->remeshed()) {
+            std::vector<uint3> expectedTriangles(triangleCount), actualTriangles(triangleCount);
+            expected->getTriangles(expectedTriangles.data());
+            actual->getTriangles(actualTriangles.data());
+            EXPECT_EQ(0, memcmp(expectedTriangles.data(), actualTriangles.data(),
+                    triangleCount * sizeof(uint3)));
+
+            std::vector<float4> expectedColors(vertexCount), actualColors(vertexCount);
+            expected->getAux(AuxAttribute::COLORS, expectedColors.data());
+            actual->getAux(AuxAttribute::COLORS, actualColors.data());
+            EXPECT_EQ(0, memcmp(expectedColors.data(), actualColors.data(),
+                    vertexCount * sizeof(float4)));
+        }
+
+        TangentSpaceMesh::destroy(expected);
+        TangentSpaceMesh::destroy(actual);
+    };
+
+    for (auto algorithm : { TangentSpaceMesh::Algorithm::MIKKTSPACE,
+                            TangentSpaceMesh::Algorithm::LENGYEL,
+                            TangentSpaceMesh::Algorithm::HUGHES_MOLLER,
+                            TangentSpaceMesh::Algorithm::FRISVAD }) {
+        check([&sphere, algorithm](TangentSpaceMesh::Builder& builder) {
+            builder.vertexCount(sphere.positions.size())
+                    .normals(sphere.normals.data())
+                    .positions(sphere.positions.data())
+                    .uvs(sphere.uvs.data())
+                    .aux(AuxAttribute::COLORS, sphere.colors.data())
+                    .triangleCount(sphere.triangles.size())
+                    .triangles(sphere.triangles.data())
+                    .algorithm(algorithm);
+        });
+    }
+
+    // mikktspace splits a mesh made of separate parts in chunks, interleave the triangles of the
+    // parts to check that the order of the triangles is preserved
+    Sphere spheres;
+    constexpr uint32_t SPHERE_COUNT = 3;
+    Sphere const part = createSphere(64);
+    for (uint32_t s = 0; s < SPHERE_COUNT; s++) {
+        for (float3 const& p : part.positions) {
+            spheres.positions.push_back(p + float3{ 3.0f * float(s), 0, 0 });
+        }
+        spheres.normals.insert(spheres.normals.end(), part.normals.begin(), part.normals.end());
+        spheres.uvs.insert(spheres.uvs.end(), part.uvs.begin(), part.uvs.end());
+        spheres.colors.insert(spheres.colors.end(), part.colors.begin(), part.colors.end());
+    }
+    for (uint3 const& tri : part.triangles) {
+        for (uint32_t s = 0; s < SPHERE_COUNT; s++) {
+            spheres.triangles.push_back(tri + uint32_t(s * part.positions.size()));
+        }
+    }
+    check([&spheres](TangentSpaceMesh::Builder& builder) {
+        builder.vertexCount(spheres.positions.size())
+                .normals(spheres.normals.data())
+                .positions(spheres.positions.data())
+                .uvs(spheres.uvs.data())
+                .aux(AuxAttribute::COLORS, spheres.colors.data())
+                .triangleCount(spheres.triangles.size())
+                .triangles(spheres.triangles.data())
+                .algorithm(TangentSpaceMesh::Algorithm::MIKKTSPACE);
+    });
+
+    // flat shading
+    check([&sphere](TangentSpaceMesh::Builder& builder) {
+        builder.vertexCount(sphere.positions.size())
+                .positions(sphere.positions.data())
+                .aux(AuxAttribute::COLORS, sphere.colors.data())
+                .triangleCount(sphere.triangles.size())
+                .triangles(sphere.triangles.data());
+    });
+
+    // tangents provided
+    check([&sphere](TangentSpaceMesh::Builder& builder) {
+        builder.vertexCount(sphere.positions.size())
+                .normals(sphere.normals.data())
+                .tangents(sphere.tangents.data());
+    });
+
+    js.emancipate();
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -16,10 +16,19 @@
 
 #include <geometry/Transcoder.h>
 
+#include <utils/JobSystem.h>
+
 #include <math/half.h>
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <stddef.h>
+#include <string.h>
+
 using filament::math::half;
 using filament::geometry::Transcoder;
 using filament::geometry::ComponentType;
@@ -124,6 +133,182 @@ TEST_F(TranscoderTest, NonNormalized) {
     ASSERT_EQ(result[1], 1.0f);
 }
 
+// A large interleaved stream, with all the interesting values at the start.
+struct BigVertex {
+    int8_t b[3];
+    uint8_t ub[3];
+    int16_t s[3];
+    uint16_t us[3];
+    half h[3];
+    float f[3];
+};
+
+static std::vector<BigVertex> createStream(size_t count) {
+    std::vector<BigVertex> vertices(count);
+    std::default_random_engine gen; // NOLINT
+    std::uniform_int_distribution<uint32_t> rand;
+    uint8_t* bytes = (uint8_t*) vertices.data();
+    for (size_t i = 0; i < count * sizeof(BigVertex); i++) {
+        bytes[i] = uint8_t(rand(gen));
+    }
+    for (BigVertex& v : vertices) {
+        for (size_t i = 0; i < 3; i++) {
+            v.h[i] = half(float(int8_t(v.b[i])) / 8.0f);
+            v.f[i] = float(v.s[i]) / 16.0f;
+        }
+    }
+    vertices[0] = { { -128, -127, 127 }, { 0, 1, 255 },
+            { -32768, -32767, 32767 }, { 0, 1, 65535 },
+            { half(-0.5f), half(0.0f), half(65504.0f) }, { -1.0f, 0.0f, 1.0f } };
+    return vertices;
+}
+
+static size_t getComponentSize(ComponentType type) {
+    switch (type) {
+        case ComponentType::BYTE:
+        case ComponentType::UBYTE:
+            return 1;
+        case ComponentType::SHORT:
+        case ComponentType::USHORT:
+        case ComponentType::HALF:
+            return 2;
+        case ComponentType::FLOAT:
+            return 4;
+    }
+    return 0;
+}
+
+static std::vector<Transcoder::Attribute> getAttributes(bool normalized) {
+    return {
+        { { ComponentType::BYTE,   normalized, 3, sizeof(BigVertex) }, offsetof(BigVertex, b)  },
+        { { ComponentType::UBYTE,  normalized, 3, sizeof(BigVertex) }, offsetof(BigVertex, ub) },
+        { { ComponentType::SHORT,  normalized, 3, sizeof(BigVertex) }, offsetof(BigVertex, s)  },
+        { { ComponentType::USHORT, normalized, 3, sizeof(BigVertex) }, offsetof(BigVertex, us) },
+        { { ComponentType::HALF,   normalized, 3, sizeof(BigVertex) }, offsetof(BigVertex, h)  },
+        { { ComponentType::FLOAT,  normalized, 3, sizeof(BigVertex) }, offsetof(BigVertex, f)  },
+    };
+}
+
+// Straightforward conversion of one of the attributes of a BigVertex stream.
+static std::vector<float> reference(std::vector<BigVertex> const& vertices,
+        Transcoder::Attribute const& attribute) {
+    bool const normalized = attribute.config.normalized;
+    std::vector<float> result;
+    for (BigVertex const& v : vertices) {
+        for (size_t i = 0; i < 3; i++) {
+            switch (attribute.config.componentType) {
+                case ComponentType::BYTE:
+                    result.push_back(normalized ?
+                            std::max(v.b[i] * (1.0f / 127.0f), -1.0f) : v.b[i]);
+                    break;
+                case ComponentType::UBYTE:
+                    result.push_back(normalized ? v.ub[i] * (1.0f / 255.0f) : v.ub[i]);
+                    break;
+                case ComponentType::SHORT:
+                    result.push_back(normalized ?
+                            std::max(v.s[i] * (1.0f / 32767.0f), -1.0f) : v.s[i]);
+                    break;
+                case ComponentType::USHORT:
+                    result.push_back(normalized ? v.us[i] * (1.0f / 65535.0f) : v.us[i]);
+                    break;
+                case ComponentType::HALF:
+                    result.push_back(float(v.h[i]));
+                    break;
+                case ComponentType::FLOAT:
+                    result.push_back(v.f[i]);
+                    break;
+            }
+        }
+    }
+    return result;
+}
+
+TEST_F(TranscoderTest, Packed) {
+    // An odd count exercises the tails of the vectorized loops.
+    constexpr size_t vertexCount = 100003;
+    std::vector<BigVertex> const vertices = createStream(vertexCount);
+
+    for (bool normalized : { true, false }) {
+        for (Transcoder::Attribute const& attribute : getAttributes(normalized)) {
+            Transcoder::Config config = attribute.config;
+            std::vector<float> const expected = reference(vertices, attribute);
+            if (normalized && (config.componentType == ComponentType::BYTE ||
+                    config.componentType == ComponentType::SHORT)) {
+                ASSERT_EQ(expected[0], -1.0f);
+                ASSERT_EQ(expected[1], -1.0f);
+            }
+
+            std::vector<float> result(vertexCount * 3);
+            Transcoder transcodeInterleaved(config);
+            transcodeInterleaved(result.data(),
+                    (uint8_t const*) vertices.data() + attribute.offset, vertexCount);
+            ASSERT_EQ(memcmp(result.data(), expected.data(), result.size() * sizeof(float)), 0);
+
+            size_t const size = getComponentSize(config.componentType) * 3;
+            std::vector<uint8_t> packed(vertexCount * size);
+            for (size_t i = 0; i < vertexCount; i++) {
+                memcpy(packed.data() + i * size,
+                        (uint8_t const*) &vertices[i] + attribute.offset, size);
+            }
+            config.inputStrideBytes = 0;
+
+            Transcoder transcodePacked(config);
+            transcodePacked(result.data(), packed.data(), vertexCount);
+            ASSERT_EQ(memcmp(result.data(), expected.data(), result.size() * sizeof(float)), 0);
+
+            // Any count, to check that nothing is written past the end.
+            for (size_t count = 0; count < 40; count++) {
+                std::vector<float> small(count * 3 + 1, 42.0f);
+                transcodePacked(small.data(), packed.data(), count);
+                ASSERT_EQ(memcmp(small.data(), expected.data(), count * 3 * sizeof(float)), 0);
+                ASSERT_EQ(small.back(), 42.0f);
+            }
+        }
+    }
+}
+
+TEST_F(TranscoderTest, Decode) {
+    constexpr size_t vertexCount = 300007;
+    std::vector<BigVertex> const vertices = createStream(vertexCount);
+
+    utils::JobSystem js;
+    js.adopt();
+
+    for (bool normalized : { true, false }) {
+        std::vector<Transcoder::Attribute> attributes = getAttributes(normalized);
+        std::vector<std::vector<float>> expected;
+        for (Transcoder::Attribute const& attribute : attributes) {
+            expected.emplace_back(vertexCount * 3);
+            Transcoder transcode(attribute.config);
+            transcode(expected.back().data(),
+                    (uint8_t const*) vertices.data() + attribute.offset, vertexCount);
+
+            // the JobSystem variant gives the same results
+            std::vector<float> result(vertexCount * 3);
+            size_t const written = transcode(js, result.data(),
+                    (uint8_t const*) vertices.data() + attribute.offset, vertexCount);
+            ASSERT_EQ(written, result.size() * sizeof(float));
+            ASSERT_EQ(memcmp(result.data(), expected.back().data(), written), 0);
+        }
+
+        for (utils::JobSystem* jobSystem : { (utils::JobSystem*) nullptr, &js }) {
+            std::vector<std::vector<float>> results;
+            for (Transcoder::Attribute& attribute : attributes) {
+                results.emplace_back(vertexCount * 3);
+                attribute.target = results.back().data();
+            }
+            Transcoder::decode(attributes.data(), attributes.size(), vertices.data(),
+                    vertexCount, jobSystem);
+            for (size_t i = 0; i < attributes.size(); i++) {
+                ASSERT_EQ(memcmp(results[i].data(), expected[i].data(),
+                        vertexCount * 3 * sizeof(float)), 0);
+            }
+        }
+    }
+
+    js.emancipate();
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
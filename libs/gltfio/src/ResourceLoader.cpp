@@ -252,7 +252,7 @@ inline void uploadBuffers(FFilamentAsset* asset, Engine& engine,
                 const size_t floatsCount = accessor->count * cgltf_num_components(accessor->type);
                 const size_t floatsByteCount = sizeof(float) * floatsCount;
                 float* floatsData = (float*) malloc(floatsByteCount);
-                cgltf_accessor_unpack_floats(accessor, floatsData, floatsCount);
+                utility::unpackFloats(accessor, floatsData, floatsCount, &engine.getJobSystem());
                 BufferObject* bo = BufferObject::Builder().size(floatsByteCount).build(engine);
                 asset->mBufferObjects.push_back(bo);
                 bo->setBuffer(engine, BufferDescriptor(floatsData, floatsByteCount, FREE_CALLBACK));
@@ -290,7 +290,7 @@ inline void uploadBuffers(FFilamentAsset* asset, Engine& engine,
             const size_t floatsCount = accessor->count * cgltf_num_components(accessor->type);
             const size_t floatsByteCount = sizeof(float) * floatsCount;
             float* floatsData = (float*) malloc(floatsByteCount);
-            cgltf_accessor_unpack_floats(accessor, floatsData, floatsCount);
+            utility::unpackFloats(accessor, floatsData, floatsCount, &engine.getJobSystem());
             if (accessor->type == cgltf_type_vec3) {
                 slot.morphTargetBuffer->setPositionsAt(engine, slot.bufferIndex,
                         (const float3*) floatsData,
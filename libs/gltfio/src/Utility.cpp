@@ -20,6 +20,9 @@
 #include "FFilamentAsset.h"
 #include "GltfEnums.h"
 
+#include <geometry/Transcoder.h>
+
+#include <utils/JobSystem.h>
 #include <utils/Log.h>
 #include <utils/Systrace.h>
 
@@ -27,6 +30,8 @@
 #include <cgltf.h>
 #include <meshoptimizer.h>
 
+#include <algorithm>
+
 namespace filament::gltfio::utility {
 
 using namespace utils;
@@ -205,6 +210,49 @@ bool requiresPacking(cgltf_accessor const* accessor) {
     }
 }
 
+// Same as cgltf_accessor_unpack_floats, but vectorized and possibly multithreaded for the common
+// case of a dense vector accessor.
+void unpackFloats(cgltf_accessor const* accessor, float* out, size_t floatCount,
+        utils::JobSystem* js) {
+    using filament::geometry::ComponentType;
+    using filament::geometry::Transcoder;
+
+    ComponentType componentType;
+    switch (accessor->component_type) {
+        case cgltf_component_type_r_8:   componentType = ComponentType::BYTE;   break;
+        case cgltf_component_type_r_8u:  componentType = ComponentType::UBYTE;  break;
+        case cgltf_component_type_r_16:  componentType = ComponentType::SHORT;  break;
+        case cgltf_component_type_r_16u: componentType = ComponentType::USHORT; break;
+        case cgltf_component_type_r_32f: componentType = ComponentType::FLOAT;  break;
+        default:
+            cgltf_accessor_unpack_floats(accessor, out, floatCount);
+            return;
+    }
+
+    // Matrices have padded columns, sparse accessors need their indices applied.
+    const size_t componentCount = cgltf_num_components(accessor->type);
+    uint8_t const* data = accessor->buffer_view ?
+            cgltf_buffer_view_data(accessor->buffer_view) : nullptr;
+    if (accessor->is_sparse || !data || componentCount == 0 ||
+            accessor->type > cgltf_type_vec4) {
+        cgltf_accessor_unpack_floats(accessor, out, floatCount);
+        return;
+    }
+
+    const size_t count = std::min(size_t(accessor->count), floatCount / componentCount);
+    Transcoder const transcode({
+        .componentType = componentType,
+        .normalized = bool(accessor->normalized),
+        .componentCount = uint32_t(componentCount),
+        .inputStrideBytes = uint32_t(accessor->stride)
+    });
+    if (js) {
+        transcode(*js, out, data + accessor->offset, count);
+    } else {
+        transcode(out, data + accessor->offset, count);
+    }
+}
+
 bool loadCgltfBuffers(cgltf_data const* gltf, char const* gltfPath,
         UriDataCacheHandle uriDataCacheHandle) {
     SYSTRACE_CONTEXT();
@@ -31,6 +31,10 @@ class DracoCache;
 
 struct cgltf_accessor;
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament::gltfio {
 
 // Referenced in ResourceLoader and AssetLoaderExtended
@@ -51,6 +55,8 @@ void convertBytesToShorts(uint16_t* dst, uint8_t const* src, size_t count);
 uint32_t computeBindingOffset(cgltf_accessor const* accessor);
 bool requiresConversion(cgltf_accessor const* accessor);
 bool requiresPacking(cgltf_accessor const* accessor);
+void unpackFloats(cgltf_accessor const* accessor, float* out, size_t floatCount,
+        utils::JobSystem* js);
 bool loadCgltfBuffers(cgltf_data const* gltf, char const* gltfPath,
         UriDataCacheHandle uriDataCacheHandle);
 
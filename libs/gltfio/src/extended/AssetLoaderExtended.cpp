@@ -164,6 +164,7 @@ std::vector<BufferSlot> computeGeometries(cgltf_primitive const* prim, uint8_t c
     utils::JobSystem& js = engine->getJobSystem();
     utils::JobSystem::Job* parent = js.createJob();
     for (auto& [key, params]: jobs) {
+        params.in.jobSystem = &js;
         js.run(utils::jobs::createJob(js, parent,
                 [pptr = &params] { TangentsJobExtended::run(pptr); }));
     }
@@ -231,6 +231,13 @@ struct TangentSpaceMeshWrapper::Builder::Impl {
     void triangles(uint3 const* triangles) noexcept { DO_BUILDER_IMPL(triangles, triangles); }
     void triangleCount(size_t count) noexcept { DO_BUILDER_IMPL(triangleCount, count); }
 
+    void jobSystem(utils::JobSystem* jobSystem) noexcept {
+        // passthrough has nothing worth splitting
+        if (mTsmBuilder) {
+            mTsmBuilder->jobSystem(jobSystem);
+        }
+    }
+
     template<typename T, typename = is_supported_aux_t<T>>
     void aux(AuxType type, T data) {
         DO_BUILDER_IMPL(aux, type, data);
@@ -292,6 +299,11 @@ Builder& Builder::triangles(uint3 const* triangles) noexcept {
     return *this;
 }
 
+Builder& Builder::jobSystem(utils::JobSystem* jobSystem) noexcept {
+    mImpl->jobSystem(jobSystem);
+    return *this;
+}
+
 template Builder& Builder::aux<float2*>(AuxType attribute, float2* data);
 template Builder& Builder::aux<float3*>(AuxType attribute, float3* data);
 template Builder& Builder::aux<float4*>(AuxType attribute, float4* data);
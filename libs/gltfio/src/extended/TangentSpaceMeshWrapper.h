@@ -48,6 +48,7 @@ struct TangentSpaceMeshWrapper {
         Builder& positions(float3 const* positions) noexcept;
         Builder& triangleCount(size_t triangleCount) noexcept;
         Builder& triangles(uint3 const* triangles) noexcept;
+        Builder& jobSystem(utils::JobSystem* jobSystem) noexcept;
 
         template<typename T, typename = is_supported_aux_t<T>>
         Builder& aux(AuxType type, T data);
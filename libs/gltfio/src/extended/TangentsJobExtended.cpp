@@ -397,6 +397,7 @@ void TangentsJobExtended::run(Params* params) {
     using AuxType = TangentSpaceMeshWrapper::AuxType;
     TangentSpaceMeshWrapper::Builder tob(isUnlit);
     tob.vertexCount(vertexCount);
+    tob.jobSystem(params->in.jobSystem);
 
     // We go through all of the accessors (that we care about) associated with the primitive and
     // extra the associated data. For morph targets, we also find the associated morph target offset
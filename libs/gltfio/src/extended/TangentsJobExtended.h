@@ -22,6 +22,10 @@
 
 #include <cgltf.h>
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament::gltfio {
 
 // Encapsulates a tangent-space transformation, which computes tangents (and maybe transform the
@@ -37,6 +41,8 @@ struct TangentsJobExtended {
         cgltf_primitive const* prim;
         int morphTargetIndex = kMorphTargetUnused;
         UvMap uvmap;
+        // Used to split the tangent space computation of large primitives, can be null.
+        utils::JobSystem* jobSystem = nullptr;
     };
 
     // The outputs of the procedure. The results array gets malloc'd by the procedure, so clients
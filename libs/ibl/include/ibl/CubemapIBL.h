@@ -17,6 +17,8 @@
 #ifndef IBL_CUBEMAPIBL_H
 #define IBL_CUBEMAPIBL_H
 
+#include <ibl/Cubemap.h>
+
 #include <math/vec3.h>
 
 #include <utils/Slice.h>
@@ -34,7 +36,6 @@ class JobSystem;
 namespace filament {
 namespace ibl {
 
-class Cubemap;
 class Image;
 
 /**
@@ -44,20 +45,72 @@ class UTILS_PUBLIC CubemapIBL {
 public:
     typedef void (*Progress)(size_t, float, void*);
 
+    /**
+     * Quality / speed trade-off of roughnessFilter()
+     */
+    enum class Quality : uint8_t {
+        /**
+         * Each sample is trilinearly filtered between the two prefiltered lods that bracket its
+         * footprint. This is the reference, used by cmgen.
+         */
+        HIGH,
+
+        /**
+         * Meant for runtime updates, e.g. when swapping environments or updating reflection
+         * probes. Compared to HIGH:
+         *
+         * - Each sample is bilinearly filtered from the single lod closest to its footprint,
+         *   which halves the number of texel fetches. The footprint of a sample is off by at most
+         *   half a lod, i.e. a factor sqrt(2) in texel size.
+         *
+         * - The least significant samples, whose weights add up to at most
+         *   FAST_WEIGHT_TOLERANCE, are skipped and the remaining ones are renormalized.
+         *   Compared to HIGH with the same lods, this changes the result of a texel by at most
+         *   w / (1 - w) times the brightest texel covered by any of its samples, skipped or
+         *   kept, where w <= FAST_WEIGHT_TOLERANCE is the skipped weight: the skipped samples
+         *   are lost, and the kept ones are scaled up by 1 / (1 - w).
+         */
+        FAST
+    };
+
+    //! Upper bound of the total weight of the samples skipped by Quality::FAST
+    static constexpr float FAST_WEIGHT_TOLERANCE = 1.0f / 32.0f;
+
     /**
      * Computes a roughness LOD using prefiltered importance sampling GGX
      *
+     * The importance samples only depend on the roughness, the sample count and the size of the
+     * source, they're computed once and cached across calls.
+     *
      * @param dst               the destination cubemap
      * @param levels            a list of prefiltered lods of the source environment
      * @param linearRoughness   roughness
      * @param maxNumSamples     number of samples for importance sampling
+     * @param quality           quality / speed trade-off, HIGH if not specified
      * @param updater           a callback for the caller to track progress
      */
+    static void roughnessFilter(
+            utils::JobSystem& js, Cubemap& dst, const utils::Slice<Cubemap>& levels,
+            float linearRoughness, size_t maxNumSamples, math::float3 mirror, bool prefilter,
+            Quality quality, Progress updater = nullptr, void* userdata = nullptr);
+
     static void roughnessFilter(
             utils::JobSystem& js, Cubemap& dst, const utils::Slice<Cubemap>& levels,
             float linearRoughness, size_t maxNumSamples, math::float3 mirror, bool prefilter,
             Progress updater = nullptr, void* userdata = nullptr);
 
+    /**
+     * Computes the rows [y, y + count) of one face of a roughness LOD, see above.
+     *
+     * This lets callers spread the filtering of an environment over time, e.g. across several
+     * frames. Each row is seeded independently, so the result doesn't depend on how a face is
+     * split.
+     */
+    static void roughnessFilter(
+            utils::JobSystem& js, Cubemap& dst, const utils::Slice<Cubemap>& levels,
+            float linearRoughness, size_t maxNumSamples, math::float3 mirror, bool prefilter,
+            Quality quality, Cubemap::Face face, size_t y, size_t count);
+
     static void roughnessFilter(
             utils::JobSystem& js, Cubemap& dst, const std::vector<Cubemap>& levels,
             float linearRoughness, size_t maxNumSamples, math::float3 mirror, bool prefilter,
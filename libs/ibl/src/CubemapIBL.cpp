@@ -23,11 +23,16 @@
 
 #include "CubemapUtilsImpl.h"
 
+#include <utils/Hash.h>
 #include <utils/JobSystem.h>
+#include <utils/debug.h>
 
 #include <math/mat3.h>
 #include <math/scalar.h>
 
+#include <algorithm>
+#include <memory>
+#include <mutex>
 #include <random>
 #include <vector>
 
@@ -292,65 +297,53 @@ static float UTILS_UNUSED VisibilityAshikhmin(float NoV, float NoL, float /*a*/)
  *
  */
 
-UTILS_ALWAYS_INLINE
-void CubemapIBL::roughnessFilter(
-        utils::JobSystem& js, Cubemap& dst, const std::vector<Cubemap>& levels,
-        float linearRoughness, size_t maxNumSamples, math::float3 mirror, bool prefilter,
-        Progress updater, void* userdata) {
-    roughnessFilter(js, dst, { levels.data(), uint32_t(levels.size()) },
-            linearRoughness, maxNumSamples, mirror, prefilter, updater, userdata);
-}
+namespace {
+
+// be careful w/ the size of this structure, the smaller the better
+struct SampleEntry {
+    float3 L;
+    float brdf_NoL;
+    float lerp;
+    uint8_t l0;
+    uint8_t l1;
+};
+
+// everything the importance samples depend on
+struct SampleTableKey {
+    float linearRoughness;
+    uint32_t maxNumSamples;
+    uint32_t dim0;
+    uint32_t numLevels;
+    bool prefilter;
+    CubemapIBL::Quality quality;
+
+    bool operator==(SampleTableKey const& rhs) const noexcept {
+        return linearRoughness == rhs.linearRoughness &&
+               maxNumSamples == rhs.maxNumSamples &&
+               dim0 == rhs.dim0 &&
+               numLevels == rhs.numLevels &&
+               prefilter == rhs.prefilter &&
+               quality == rhs.quality;
+    }
+};
 
-void CubemapIBL::roughnessFilter(
-        utils::JobSystem& js, Cubemap& dst, const utils::Slice<Cubemap>& levels,
-        float linearRoughness, size_t maxNumSamples, math::float3 mirror, bool prefilter,
-        Progress updater, void* userdata)
-{
-    const float numSamples = maxNumSamples;
+struct SampleTable {
+    SampleTableKey key;
+    std::vector<SampleEntry> samples;
+};
+
+std::vector<SampleEntry> computeSamples(SampleTableKey const& key) {
+    const size_t maxNumSamples = key.maxNumSamples;
+    const float linearRoughness = key.linearRoughness;
+    const float numSamples = float(maxNumSamples);
     const float inumSamples = 1.0f / numSamples;
-    const size_t maxLevel = levels.size()-1;
-    const float maxLevelf = maxLevel;
-    const Cubemap& base(levels[0]);
-    const size_t dim0 = base.getDimensions();
+    const size_t maxLevel = key.numLevels - 1;
+    const float maxLevelf = float(maxLevel);
+    const size_t dim0 = key.dim0;
     const float omegaP = (4.0f * (float) F_PI) / float(6 * dim0 * dim0);
-    std::atomic_uint progress = {0};
-
-    if (linearRoughness == 0) {
-        auto scanline = [&]
-                (CubemapUtils::EmptyState&, size_t y, Cubemap::Face f, Cubemap::Texel* data, size_t dim) {
-                    if (UTILS_UNLIKELY(updater)) {
-                        size_t p = progress.fetch_add(1, std::memory_order_relaxed) + 1;
-                        updater(0, (float)p / ((float) dim * 6.0f), userdata);
-                    }
-                    const Cubemap& cm = levels[0];
-                    for (size_t x = 0; x < dim; ++x, ++data) {
-                        const float2 p(Cubemap::center(x, y));
-                        const float3 N(dst.getDirectionFor(f, p.x, p.y) * mirror);
-                        // FIXME: we should pick the proper LOD here and do trilinear filtering
-                        Cubemap::writeAt(data, cm.sampleAt(N));
-                    }
-        };
-        // at least 256 pixel cubemap before we use multithreading -- the overhead of launching
-        // jobs is too large compared to the work above.
-        if (dst.getDimensions() <= 256) {
-            CubemapUtils::processSingleThreaded<CubemapUtils::EmptyState>(
-                    dst, js, std::ref(scanline));
-        } else {
-            CubemapUtils::process<CubemapUtils::EmptyState>(dst, js, std::ref(scanline));
-        }
-        return;
-    }
-
-    // be careful w/ the size of this structure, the smaller the better
-    struct CacheEntry {
-        float3 L;
-        float brdf_NoL;
-        float lerp;
-        uint8_t l0;
-        uint8_t l1;
-    };
+    const bool fast = key.quality == CubemapIBL::Quality::FAST;
 
-    std::vector<CacheEntry> cache;
+    std::vector<SampleEntry> cache;
     cache.reserve(maxNumSamples);
 
     // precompute everything that only depends on the sample #
@@ -392,15 +385,24 @@ void CubemapIBL::roughnessFilter(
             constexpr float K = 4;
             const float omegaS = 1 / (numSamples * pdf);
             const float l = float(log4(omegaS) - log4(omegaP) + log4(K));
-            const float mipLevel = prefilter ? clamp(float(l), 0.0f, maxLevelf) : 0.0f;
+            const float mipLevel = key.prefilter ? clamp(float(l), 0.0f, maxLevelf) : 0.0f;
 
             const float brdf_NoL = float(NoL);
 
             weight += brdf_NoL;
 
-            uint8_t l0 = uint8_t(mipLevel);
-            uint8_t l1 = uint8_t(std::min(maxLevel, size_t(l0 + 1)));
-            float lerp = mipLevel - (float) l0;
+            uint8_t l0, l1;
+            float lerp;
+            if (fast) {
+                // bilinear filtering from the closest lod
+                l0 = uint8_t(std::min(maxLevel, size_t(mipLevel + 0.5f)));
+                l1 = l0;
+                lerp = 0;
+            } else {
+                l0 = uint8_t(mipLevel);
+                l1 = uint8_t(std::min(maxLevel, size_t(l0 + 1)));
+                lerp = mipLevel - (float) l0;
+            }
 
             cache.push_back({ L, brdf_NoL, lerp, l0, l1 });
         }
@@ -411,59 +413,348 @@ void CubemapIBL::roughnessFilter(
     }
 
     // we can sample the cubemap in any order, sort by the weight, it could improve fp precision
-    std::sort(cache.begin(), cache.end(), [](CacheEntry const& lhs, CacheEntry const& rhs) {
+    std::sort(cache.begin(), cache.end(), [](SampleEntry const& lhs, SampleEntry const& rhs) {
         return lhs.brdf_NoL < rhs.brdf_NoL;
     });
 
+    if (fast) {
+        // skip the least significant samples, as long as their total weight stays within the
+        // tolerance, and renormalize the others.
+        size_t skipped = 0;
+        float skippedWeight = 0;
+        while (skipped + 1 < cache.size() &&
+                skippedWeight + cache[skipped].brdf_NoL <= CubemapIBL::FAST_WEIGHT_TOLERANCE) {
+            skippedWeight += cache[skipped].brdf_NoL;
+            skipped++;
+        }
+        cache.erase(cache.begin(), cache.begin() + ssize_t(skipped));
+        for (auto& entry : cache) {
+            entry.brdf_NoL *= 1.0f / (1.0f - skippedWeight);
+        }
+    }
 
-    struct State {
-        // maybe blue-noise instead would look even better
-        std::default_random_engine gen;
-        std::uniform_real_distribution<float> distribution{ -F_PI, F_PI };
-    };
+    return cache;
+}
 
-    auto scanline = [&](State& state, size_t y,
-            Cubemap::Face f, Cubemap::Texel* data, size_t dim) {
-        if (UTILS_UNLIKELY(updater)) {
-            size_t p = progress.fetch_add(1, std::memory_order_relaxed) + 1;
-            updater(0, (float) p / ((float) dim * 6.0f), userdata);
+/*
+ * The importance samples are shared by all the faces of the destination, and cached across calls:
+ * typically the same set of roughnesses is used each time an environment is prefiltered.
+ * Tables are held by shared_ptr so that an entry can be evicted while it's still being used.
+ */
+std::shared_ptr<const SampleTable> getSampleTable(SampleTableKey const& key) {
+    constexpr size_t MAX_CACHED_SAMPLE_TABLES = 32;
+    static std::mutex sLock;
+    static std::vector<std::shared_ptr<const SampleTable>> sCache; // most recently used last
+
+    std::unique_lock<std::mutex> lock(sLock);
+    auto pos = std::find_if(sCache.begin(), sCache.end(),
+            [&key](auto const& table) { return table->key == key; });
+    if (pos != sCache.end()) {
+        std::rotate(pos, pos + 1, sCache.end());
+        return sCache.back();
+    }
+    lock.unlock();
+
+    auto table = std::make_shared<const SampleTable>(SampleTable{ key, computeSamples(key) });
+
+    lock.lock();
+    if (sCache.size() == MAX_CACHED_SAMPLE_TABLES) {
+        sCache.erase(sCache.begin());
+    }
+    sCache.push_back(table);
+    return table;
+}
+
+// A lod of the source environment, flattened for fast access from the filtering loop
+struct LevelView {
+    uint8_t const* faces[6];
+    size_t bpr;
+    float dim;
+    float upperBound;
+};
+
+// same as Cubemap::filterAt()
+inline Cubemap::Texel filterAt(LevelView const& level, size_t face, float s, float t) {
+    const float x = std::min(s * level.dim, level.upperBound);
+    const float y = std::min(t * level.dim, level.upperBound);
+    const size_t x0 = size_t(x);
+    const size_t y0 = size_t(y);
+    const float u = float(x - x0);
+    const float v = float(y - y0);
+    const float one_minus_u = 1 - u;
+    const float one_minus_v = 1 - v;
+    // we allow ourselves to read past the width/height of the Image because the data is valid
+    // and contain the "seamless" data.
+    uint8_t const* const p0 = level.faces[face] + y0 * level.bpr + x0 * sizeof(Cubemap::Texel);
+    uint8_t const* const p1 = p0 + level.bpr;
+    const Cubemap::Texel& c0 = Cubemap::sampleAt(p0);
+    const Cubemap::Texel& c1 = Cubemap::sampleAt(p0 + sizeof(Cubemap::Texel));
+    const Cubemap::Texel& c2 = Cubemap::sampleAt(p1);
+    const Cubemap::Texel& c3 = Cubemap::sampleAt(p1 + sizeof(Cubemap::Texel));
+    return (one_minus_u*one_minus_v)*c0 + (u*one_minus_v)*c1 + (one_minus_u*v)*c2 + (u*v)*c3;
+}
+
+/*
+ * Texels are filtered in batches: the part of the work that doesn't depend on the content of the
+ * environment -- rotating the samples into each texel's frame and finding their address in the
+ * cubemap -- is done for the whole batch at once, on structures of arrays that compilers
+ * vectorize. Only the texel fetches are done one texel at a time.
+ */
+constexpr size_t BATCH_SIZE = 8;
+
+struct Batch {
+    // rotation of each texel, column-major: R[column * 3 + row]
+    float R[9][BATCH_SIZE];
+    float3 Li[BATCH_SIZE];
+};
+
+template<bool TRILINEAR>
+void filterBatch(Batch& batch, utils::Slice<const SampleEntry> samples,
+        LevelView const* levels) noexcept {
+    for (SampleEntry const& e : samples) {
+        float sc[BATCH_SIZE];
+        float tc[BATCH_SIZE];
+        uint32_t face[BATCH_SIZE];
+
+        // this is Cubemap::getAddressFor() without branches
+        for (size_t i = 0; i < BATCH_SIZE; i++) {
+            const float x = batch.R[0][i] * e.L.x + batch.R[3][i] * e.L.y + batch.R[6][i] * e.L.z;
+            const float y = batch.R[1][i] * e.L.x + batch.R[4][i] * e.L.y + batch.R[7][i] * e.L.z;
+            const float z = batch.R[2][i] * e.L.x + batch.R[5][i] * e.L.y + batch.R[8][i] * e.L.z;
+            const float rx = std::abs(x);
+            const float ry = std::abs(y);
+            const float rz = std::abs(z);
+            const bool xMajor = rx >= ry && rx >= rz;
+            const bool yMajor = !xMajor && ry >= rz;
+            const bool zMajor = !xMajor && !yMajor;
+            const float ma = 1.0f / (xMajor ? rx : (yMajor ? ry : rz));
+            const float s = xMajor ? (x >= 0 ? -z : z) : (yMajor ? x : (z >= 0 ? x : -x));
+            const float t = yMajor ? (y >= 0 ? z : -z) : -y;
+            const uint32_t axis = xMajor ? 0u : (yMajor ? 2u : 4u);
+            const bool negative = xMajor ? x < 0 : (zMajor ? z < 0 : y < 0);
+            face[i] = axis + uint32_t(negative);
+            sc[i] = (s * ma + 1.0f) * 0.5f;
+            tc[i] = (t * ma + 1.0f) * 0.5f;
         }
-        mat3 R;
-        const size_t numSamples = cache.size();
-        for (size_t x = 0; x < dim; ++x, ++data) {
-            const float2 p(Cubemap::center(x, y));
-            const float3 N(dst.getDirectionFor(f, p.x, p.y) * mirror);
+
+        LevelView const& l0 = levels[e.l0];
+        LevelView const& l1 = levels[e.l1];
+        for (size_t i = 0; i < BATCH_SIZE; i++) {
+            float3 c0 = filterAt(l0, face[i], sc[i], tc[i]);
+            if (TRILINEAR) {
+                c0 += e.lerp * (filterAt(l1, face[i], sc[i], tc[i]) - c0);
+            }
+            batch.Li[i] += c0 * e.brdf_NoL;
+        }
+    }
+}
+
+struct FilterState {
+    // maybe blue-noise instead would look even better
+    std::default_random_engine gen;
+    std::uniform_real_distribution<float> distribution{ -F_PI, F_PI };
+};
+
+// Everything needed to compute the scanlines of a roughness LOD
+class RoughnessFilter {
+public:
+    RoughnessFilter(const Cubemap& dst, const utils::Slice<Cubemap>& levels,
+            float linearRoughness, size_t maxNumSamples, float3 mirror, bool prefilter,
+            CubemapIBL::Quality quality);
+
+    // true when the environment only needs to be copied (roughness 0)
+    bool isCopy() const noexcept { return !mTable; }
+
+    void copyScanline(size_t y, Cubemap::Face f, Cubemap::Texel* data, size_t dim) const;
+
+    void filterScanline(FilterState& state, size_t y,
+            Cubemap::Face f, Cubemap::Texel* data, size_t dim) const;
+
+private:
+    using FilterBatchProc = void(*)(Batch&, utils::Slice<const SampleEntry>, LevelView const*);
+    const Cubemap& mDst;
+    const Cubemap& mBase;
+    float3 mMirror;
+    std::shared_ptr<const SampleTable> mTable;
+    std::vector<LevelView> mViews;
+    FilterBatchProc mFilterBatch = nullptr;
+};
+
+RoughnessFilter::RoughnessFilter(const Cubemap& dst, const utils::Slice<Cubemap>& levels,
+        float linearRoughness, size_t maxNumSamples, float3 mirror, bool prefilter,
+        CubemapIBL::Quality quality)
+        : mDst(dst), mBase(levels[0]), mMirror(mirror) {
+    if (linearRoughness == 0) {
+        return;
+    }
+
+    mTable = getSampleTable({
+            linearRoughness, uint32_t(maxNumSamples), uint32_t(mBase.getDimensions()),
+            uint32_t(levels.size()), prefilter, quality });
+
+    mViews.resize(levels.size());
+    for (size_t i = 0; i < levels.size(); i++) {
+        const Cubemap& cm = levels[i];
+        const size_t dim = cm.getDimensions();
+        LevelView& view = mViews[i];
+        for (size_t f = 0; f < 6; f++) {
+            view.faces[f] = static_cast<uint8_t const*>(
+                    cm.getImageForFace(Cubemap::Face(f)).getData());
+        }
+        view.bpr = cm.getImageForFace(Cubemap::Face::PX).getBytesPerRow();
+        view.dim = float(dim);
+        view.upperBound = std::nextafter(float(dim), 0.0f);
+    }
+
+    mFilterBatch = quality == CubemapIBL::Quality::FAST ? &filterBatch<false> : &filterBatch<true>;
+}
+
+void RoughnessFilter::copyScanline(size_t y,
+        Cubemap::Face f, Cubemap::Texel* data, size_t dim) const {
+    for (size_t x = 0; x < dim; ++x, ++data) {
+        const float2 p(Cubemap::center(x, y));
+        const float3 N(mDst.getDirectionFor(f, p.x, p.y) * mMirror);
+        // FIXME: we should pick the proper LOD here and do trilinear filtering
+        Cubemap::writeAt(data, mBase.sampleAt(N));
+    }
+}
+
+void RoughnessFilter::filterScanline(FilterState& state, size_t y,
+        Cubemap::Face f, Cubemap::Texel* data, size_t dim) const {
+    utils::Slice<const SampleEntry> const samples{
+            mTable->samples.data(), uint32_t(mTable->samples.size()) };
+    Batch batch;
+    for (size_t x = 0; x < dim; x += BATCH_SIZE) {
+        const size_t count = std::min(BATCH_SIZE, dim - x);
+        for (size_t i = 0; i < BATCH_SIZE; i++) {
+            // the lanes past the end of the scanline just repeat the last texel
+            const float2 p(Cubemap::center(x + std::min(i, count - 1), y));
+            const float3 N(mDst.getDirectionFor(f, p.x, p.y) * mMirror);
 
             // center the cone around the normal (handle case of normal close to up)
             const float3 up = std::abs(N.z) < 0.999 ? float3(0, 0, 1) : float3(1, 0, 0);
+            mat3 R;
             R[0] = normalize(cross(up, N));
             R[1] = cross(N, R[0]);
             R[2] = N;
 
-            R *= mat3f::rotation(state.distribution(state.gen), float3{0,0,1});
+            if (i < count) {
+                R *= mat3f::rotation(state.distribution(state.gen), float3{0,0,1});
+            }
 
-            float3 Li = 0;
-            for (size_t sample = 0; sample < numSamples; sample++) {
-                const CacheEntry& e = cache[sample];
-                const float3 L(R * e.L);
-                const Cubemap& cmBase = levels[e.l0];
-                const Cubemap& next = levels[e.l1];
-                const float3 c0 = Cubemap::trilinearFilterAt(cmBase, next, e.lerp, L);
-                Li += c0 * e.brdf_NoL;
+            for (size_t c = 0; c < 9; c++) {
+                batch.R[c][i] = R[c / 3][c % 3];
             }
-            Cubemap::writeAt(data, Cubemap::Texel(Li));
+            batch.Li[i] = 0;
         }
+
+        mFilterBatch(batch, samples, mViews.data());
+
+        for (size_t i = 0; i < count; i++) {
+            Cubemap::writeAt(data + x + i, Cubemap::Texel(batch.Li[i]));
+        }
+    }
+}
+
+} // anonymous namespace
+
+UTILS_ALWAYS_INLINE
+void CubemapIBL::roughnessFilter(
+        utils::JobSystem& js, Cubemap& dst, const std::vector<Cubemap>& levels,
+        float linearRoughness, size_t maxNumSamples, math::float3 mirror, bool prefilter,
+        Progress updater, void* userdata) {
+    roughnessFilter(js, dst, { levels.data(), uint32_t(levels.size()) },
+            linearRoughness, maxNumSamples, mirror, prefilter, Quality::HIGH, updater, userdata);
+}
+
+void CubemapIBL::roughnessFilter(
+        utils::JobSystem& js, Cubemap& dst, const utils::Slice<Cubemap>& levels,
+        float linearRoughness, size_t maxNumSamples, math::float3 mirror, bool prefilter,
+        Progress updater, void* userdata) {
+    roughnessFilter(js, dst, levels,
+            linearRoughness, maxNumSamples, mirror, prefilter, Quality::HIGH, updater, userdata);
+}
+
+void CubemapIBL::roughnessFilter(
+        utils::JobSystem& js, Cubemap& dst, const utils::Slice<Cubemap>& levels,
+        float linearRoughness, size_t maxNumSamples, math::float3 mirror, bool prefilter,
+        Quality quality, Progress updater, void* userdata)
+{
+    const RoughnessFilter filter(dst, levels,
+            linearRoughness, maxNumSamples, mirror, prefilter, quality);
+    std::atomic_uint progress = {0};
+
+    if (filter.isCopy()) {
+        auto scanline = [&]
+                (CubemapUtils::EmptyState&, size_t y, Cubemap::Face f, Cubemap::Texel* data, size_t dim) {
+                    if (UTILS_UNLIKELY(updater)) {
+                        size_t p = progress.fetch_add(1, std::memory_order_relaxed) + 1;
+                        updater(0, (float)p / ((float) dim * 6.0f), userdata);
+                    }
+                    filter.copyScanline(y, f, data, dim);
+        };
+        // at least 256 pixel cubemap before we use multithreading -- the overhead of launching
+        // jobs is too large compared to the work above.
+        if (dst.getDimensions() <= 256) {
+            CubemapUtils::processSingleThreaded<CubemapUtils::EmptyState>(
+                    dst, js, std::ref(scanline));
+        } else {
+            CubemapUtils::process<CubemapUtils::EmptyState>(dst, js, std::ref(scanline));
+        }
+        return;
+    }
+
+    auto scanline = [&](FilterState& state, size_t y,
+            Cubemap::Face f, Cubemap::Texel* data, size_t dim) {
+        if (UTILS_UNLIKELY(updater)) {
+            size_t p = progress.fetch_add(1, std::memory_order_relaxed) + 1;
+            updater(0, (float) p / ((float) dim * 6.0f), userdata);
+        }
+        filter.filterScanline(state, y, f, data, dim);
     };
 
     // don't use the jobsystem unless we have enough work per scanline -- or the overhead of
     // launching jobs will prevail.
     if (dst.getDimensions() * maxNumSamples <= 256) {
-        CubemapUtils::processSingleThreaded<State>(dst, js, std::ref(scanline));
+        CubemapUtils::processSingleThreaded<FilterState>(dst, js, std::ref(scanline));
     } else {
-        CubemapUtils::process<State>(dst, js, std::ref(scanline));
+        CubemapUtils::process<FilterState>(dst, js, std::ref(scanline));
     }
 }
 
+void CubemapIBL::roughnessFilter(
+        utils::JobSystem& js, Cubemap& dst, const utils::Slice<Cubemap>& levels,
+        float linearRoughness, size_t maxNumSamples, math::float3 mirror, bool prefilter,
+        Quality quality, Cubemap::Face face, size_t y, size_t count)
+{
+    assert_invariant(y + count <= dst.getDimensions());
+
+    const RoughnessFilter filter(dst, levels,
+            linearRoughness, maxNumSamples, mirror, prefilter, quality);
+    const size_t dim = dst.getDimensions();
+    Image& image(dst.getImageForFace(face));
+
+    auto rows = [&](uint32_t y0, uint32_t c) {
+        FilterState state;
+        for (size_t i = y0; i < y0 + c; i++) {
+            auto* const data = static_cast<Cubemap::Texel*>(image.getPixelRef(0, i));
+            if (filter.isCopy()) {
+                filter.copyScanline(i, face, data, dim);
+            } else {
+                // each row has its own seed, so the result doesn't depend on how the rows are
+                // split between jobs, or between calls.
+                const uint32_t key[2] = { uint32_t(face), uint32_t(i) };
+                state.gen.seed(utils::hash::murmur3(key, 2, 0));
+                filter.filterScanline(state, i, face, data, dim);
+            }
+        }
+    };
+
+    auto* job = jobs::parallel_for(js, nullptr, uint32_t(y), uint32_t(count),
+            std::ref(rows), jobs::CountSplitter<1, 8>());
+    js.runAndWait(job);
+}
+
 /*
  *
  * Importance sampling
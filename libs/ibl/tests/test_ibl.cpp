@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ibl/Cubemap.h>
+#include <ibl/CubemapIBL.h>
+#include <ibl/CubemapUtils.h>
+#include <ibl/Image.h>
+
+#include <gtest/gtest.h>
+
+#include <utils/JobSystem.h>
+#include <utils/Slice.h>
+
+#include <math/vec3.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <string.h>
+
+using namespace filament::ibl;
+using filament::math::float3;
+
+namespace {
+
+// A source environment and its box-filtered mip levels, as cmgen prepares them
+struct Environment {
+    std::vector<Image> images;
+    std::vector<Cubemap> levels;
+
+    utils::Slice<Cubemap> slice() {
+        return { levels.data(), uint32_t(levels.size()) };
+    }
+};
+
+template<typename F>
+Environment createEnvironment(utils::JobSystem& js, size_t dim, F radiance) {
+    Environment env;
+    Image image;
+    Cubemap base = CubemapUtils::create(image, dim);
+    for (size_t f = 0; f < 6; f++) {
+        Image const& face = base.getImageForFace(Cubemap::Face(f));
+        for (size_t y = 0; y < dim; y++) {
+            for (size_t x = 0; x < dim; x++) {
+                Cubemap::writeAt(face.getPixelRef(x, y),
+                        radiance(base.getDirectionFor(Cubemap::Face(f), x, y)));
+            }
+        }
+    }
+    base.makeSeamless();
+    env.images.push_back(std::move(image));
+    env.levels.push_back(std::move(base));
+
+    while (dim > 1) {
+        dim >>= 1u;
+        Image levelImage;
+        Cubemap level = CubemapUtils::create(levelImage, dim);
+        CubemapUtils::downsampleCubemapLevelBoxFilter(js, level, env.levels.back());
+        level.makeSeamless();
+        env.images.push_back(std::move(levelImage));
+        env.levels.push_back(std::move(level));
+    }
+    return env;
+}
+
+float3 gradient(float3 const& direction) {
+    return { std::max(direction.x, 0.0f) * 4.0f, 0.5f + 0.5f * direction.y, 0.25f };
+}
+
+bool isSame(Cubemap const& lhs, Cubemap const& rhs) {
+    size_t const dim = lhs.getDimensions();
+    for (size_t f = 0; f < 6; f++) {
+        Image const& a = lhs.getImageForFace(Cubemap::Face(f));
+        Image const& b = rhs.getImageForFace(Cubemap::Face(f));
+        for (size_t y = 0; y < dim; y++) {
+            if (memcmp(a.getPixelRef(0, y), b.getPixelRef(0, y), dim * sizeof(Cubemap::Texel))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+class IblTest : public testing::Test {
+protected:
+    void SetUp() override { js.adopt(); }
+    void TearDown() override { js.emancipate(); }
+    utils::JobSystem js;
+};
+
+} // anonymous namespace
+
+TEST_F(IblTest, CachedSamplesAreReused) {
+    // small enough that roughnessFilter() runs single-threaded and is deterministic
+    constexpr size_t DIM = 8;
+    constexpr size_t SAMPLE_COUNT = 32;
+    Environment env = createEnvironment(js, DIM, gradient);
+
+    auto filter = [&](Image& image, float roughness) {
+        Cubemap dst = CubemapUtils::create(image, DIM);
+        CubemapIBL::roughnessFilter(js, dst, env.slice(), roughness, SAMPLE_COUNT,
+                float3{ 1 }, true, CubemapIBL::Quality::HIGH);
+        return dst;
+    };
+
+    // the first call computes the importance samples, the last one uses the cached ones
+    Image i0, i1, i2;
+    Cubemap const first = filter(i0, 0.5f);
+    Cubemap const other = filter(i1, 0.8f);
+    Cubemap const cached = filter(i2, 0.5f);
+
+    EXPECT_TRUE(isSame(first, cached));
+    EXPECT_FALSE(isSame(first, other));
+}
+
+TEST_F(IblTest, ConstantEnvironmentIsPreserved) {
+    // whatever the samples and their weights, filtering a constant environment must return it
+    constexpr size_t DIM = 16;
+    float3 const color{ 0.25f, 0.5f, 1.0f };
+    Environment env = createEnvironment(js, DIM, [color](float3 const&) { return color; });
+
+    for (auto quality : { CubemapIBL::Quality::HIGH, CubemapIBL::Quality::FAST }) {
+        for (float roughness : { 0.0f, 0.3f, 1.0f }) {
+            Image image;
+            Cubemap dst = CubemapUtils::create(image, DIM);
+            CubemapIBL::roughnessFilter(js, dst, env.slice(), roughness, 64,
+                    float3{ 1 }, true, quality);
+            for (size_t f = 0; f < 6; f++) {
+                Image const& face = dst.getImageForFace(Cubemap::Face(f));
+                for (size_t y = 0; y < DIM; y++) {
+                    for (size_t x = 0; x < DIM; x++) {
+                        float3 const c = Cubemap::sampleAt(face.getPixelRef(x, y));
+                        ASSERT_NEAR(c.r, color.r, 1e-4f);
+                        ASSERT_NEAR(c.g, color.g, 1e-4f);
+                        ASSERT_NEAR(c.b, color.b, 1e-4f);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_F(IblTest, RowsDontDependOnSplit) {
+    constexpr size_t DIM = 16;
+    Environment env = createEnvironment(js, DIM, gradient);
+
+    for (auto quality : { CubemapIBL::Quality::HIGH, CubemapIBL::Quality::FAST }) {
+        // a whole face per call
+        Image wholeImage;
+        Cubemap whole = CubemapUtils::create(wholeImage, DIM);
+        for (size_t f = 0; f < 6; f++) {
+            CubemapIBL::roughnessFilter(js, whole, env.slice(), 0.5f, 32,
+                    float3{ 1 }, true, quality, Cubemap::Face(f), 0, DIM);
+        }
+
+        // uneven chunks of rows, faces in reverse order, like a time-sliced update would do
+        Image chunkedImage;
+        Cubemap chunked = CubemapUtils::create(chunkedImage, DIM);
+        for (size_t f = 6; f-- > 0;) {
+            for (size_t y = 0; y < DIM; y += 3) {
+                size_t const count = std::min<size_t>(3, DIM - y);
+                CubemapIBL::roughnessFilter(js, chunked, env.slice(), 0.5f, 32,
+                        float3{ 1 }, true, quality, Cubemap::Face(f), y, count);
+            }
+        }
+
+        EXPECT_TRUE(isSame(whole, chunked));
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_IBLBAKER_CUBEMAPEXPORT_H
+#define TNT_IBLBAKER_CUBEMAPEXPORT_H
+
+#include <image/LinearImage.h>
+
+#include <stdint.h>
+
+namespace filament::ibl {
+class Cubemap;
+class Image;
+} // namespace filament::ibl
+
+namespace image {
+class Ktx1Bundle;
+} // namespace image
+
+namespace filament::iblbaker {
+
+/**
+ * Returns the perceptual roughness prefiltered into a given level of the reflections cubemap.
+ *
+ * This is the inverse of the perceptualRoughness-to-LOD mapping used by the engine: a quadratic
+ * fit for log2(perceptualRoughness) + iblMaxMipLevel when iblMaxMipLevel is 4. It works very
+ * well for a 256 cubemap with 5 levels used, and scales well for other iblMaxMipLevel values.
+ */
+float lodToPerceptualRoughness(float lod) noexcept;
+
+//! Copies a RGB float image of libibl, which has padding, into a LinearImage
+image::LinearImage toLinearImage(ibl::Image const& image);
+
+//! Sets up a KTX bundle for a R11F_G11F_B10F cubemap whose base level is dim x dim
+void initKtxCubemap(image::Ktx1Bundle& container, uint32_t dim);
+
+//! Stores the six faces of a cubemap into a level of a bundle set up with initKtxCubemap()
+void exportKtxFaces(image::Ktx1Bundle& container, uint32_t level, ibl::Cubemap const& cm);
+
+} // namespace filament::iblbaker
+
+#endif // TNT_IBLBAKER_CUBEMAPEXPORT_H
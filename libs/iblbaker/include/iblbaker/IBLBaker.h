@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_IBLBAKER_IBLBAKER_H
+#define TNT_IBLBAKER_IBLBAKER_H
+
+#include <image/LinearImage.h>
+
+#include <utils/Path.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
+namespace filament::iblbaker {
+
+/**
+ * IBLBaker is a long-lived service that bakes image based lights on the CPU.
+ *
+ * It's meant for baking many environments in a row, e.g. a whole asset library, where running
+ * cmgen once per environment is dominated by process startup: a baker keeps its JobSystem, the
+ * DFG LUTs and the importance sampling tables of libibl warm across requests.
+ *
+ * Requests are queued and run concurrently by a few "driver" threads sharing one JobSystem. The
+ * parallel stages of a bake (filtering, SH projection) are split across all the cores, and the
+ * serial ones (decoding, encoding, writing files) of one bake overlap with the parallel stages of
+ * the others, so that throughput is bounded by the number of cores.
+ *
+ * For each environment, a request writes the same files as
+ * `cmgen --deploy=<dir> --format=ktx --size=<size> <input>`, named after the input:
+ * - <name>_ibl.ktx, the prefiltered reflections with the irradiance SH in the "sh" metadata
+ * - <name>_skybox.ktx, the environment as a cubemap
+ * - optionally, the DFG LUT
+ *
+ * Usage Example:
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * using namespace filament::iblbaker;
+ *
+ * IBLBaker baker;
+ * for (Path const& input : inputs) {
+ *     IBLBaker::Request request;
+ *     request.input = input;
+ *     request.outputDirectory = outputDirectory;
+ *     baker.submit(std::move(request), [](IBLBaker::Id id, IBLBaker::Result const& result) {
+ *         if (!result.success) {
+ *             std::cerr << result.error << std::endl;
+ *         }
+ *     });
+ * }
+ * baker.waitForAll();
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ */
+class IBLBaker {
+public:
+    using Id = uint32_t;
+
+    struct Config {
+        //! Number of threads of the JobSystem, 0 to use the number of cores
+        size_t threadCount = 0;
+
+        //! Number of requests baked at the same time, 0 to pick a default
+        size_t concurrency = 0;
+    };
+
+    struct Request {
+        //! Environment to bake: an equirectangular image or a cross, decoded with imageio
+        utils::Path input;
+
+        //! Environment to bake if input is empty, with 3 channels
+        image::LinearImage image;
+
+        //! Name of the outputs, defaults to the name of the input without its extension
+        std::string name;
+
+        //! Directory receiving the outputs, created if needed
+        utils::Path outputDirectory;
+
+        //! Size of the reflections cubemap and skybox, a power of two
+        size_t size = 256;
+
+        //! Size of the smallest level of the reflections cubemap
+        size_t minLodSize = 16;
+
+        //! Number of samples of the first levels of reflections, doubled at each level after
+        size_t sampleCount = 1024;
+
+        //! Use prefiltered importance sampling
+        bool prefilter = true;
+
+        //! Mirror the environment, as cmgen does unless --no-mirror is specified
+        bool mirror = true;
+
+        //! Clamp the input to remove outliers
+        bool clamp = false;
+
+        //! Write the skybox
+        bool skybox = true;
+
+        //! If not empty, writes the DFG LUT to this file too; its format is chosen from its name
+        utils::Path dfg;
+        size_t dfgSize = 128;
+        bool dfgMultiscatter = false;
+        bool dfgCloth = false;
+    };
+
+    enum class Stage : uint8_t {
+        QUEUED,
+        LOADING,
+        SPHERICAL_HARMONICS,
+        REFLECTIONS,
+        SKYBOX,
+        DFG,
+        DONE,
+    };
+
+    struct Result {
+        bool success = false;
+        std::string error;                  //!< why the bake failed
+        std::vector<utils::Path> outputs;   //!< files written by the bake
+    };
+
+    /**
+     * Called with the overall progress of a request, between 0 and 1.
+     * This can be called from any thread, concurrently for different requests.
+     */
+    using ProgressCallback = std::function<void(Id id, Stage stage, float progress)>;
+
+    //! Called once a request completes, from any thread
+    using CompletionCallback = std::function<void(Id id, Result const& result)>;
+
+    IBLBaker();
+    explicit IBLBaker(Config const& config);
+
+    //! Waits for all the pending requests
+    ~IBLBaker();
+
+    IBLBaker(IBLBaker const&) = delete;
+    IBLBaker& operator=(IBLBaker const&) = delete;
+
+    /**
+     * Queues a request. Requests start in the order they're submitted.
+     *
+     * @return an identifier of the request, passed to the callbacks
+     */
+    Id submit(Request request, CompletionCallback completion = {},
+            ProgressCallback progress = {});
+
+    //! Waits until all the submitted requests have completed
+    void waitForAll();
+
+    //! Returns the number of requests baked at the same time
+    size_t getConcurrency() const noexcept { return mDrivers.size(); }
+
+private:
+    struct Task {
+        Id id;
+        Request request;
+        CompletionCallback completion;
+        ProgressCallback progress;
+    };
+
+    struct DFGKey {
+        size_t size;
+        bool multiscatter;
+        bool cloth;
+    };
+
+    void driverLoop();
+
+    // Runs on a driver thread, adopted by the JobSystem.
+    Result bake(Id id, Request const& request, ProgressCallback const& progress);
+
+    // Returns a DFG LUT as a RGB32F image, computing it only once per set of parameters.
+    std::shared_ptr<const image::LinearImage> getDFG(DFGKey key);
+
+    std::unique_ptr<utils::JobSystem> mJobSystem;
+    std::vector<std::thread> mDrivers;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<Task> mQueue;
+    size_t mPendingCount = 0;
+    Id mNextId = 0;
+    bool mExitRequested = false;
+
+    std::mutex mDFGLock;
+    std::vector<std::pair<DFGKey, std::shared_ptr<const image::LinearImage>>> mDFGCache;
+};
+
+} // namespace filament::iblbaker
+
+#endif // TNT_IBLBAKER_IBLBAKER_H
@@ -14,16 +14,22 @@
  * limitations under the License.
  */
 
-#ifndef SRC_PROGRESS_UPDATER_H
-#define SRC_PROGRESS_UPDATER_H
+#ifndef TNT_IBLBAKER_PROGRESSUPDATER_H
+#define TNT_IBLBAKER_PROGRESSUPDATER_H
 
 #include <condition_variable>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <thread>
 #include <vector>
 
+namespace filament::iblbaker {
+
+/**
+ * Draws progress bars on the console, shared by the IBL command line tools.
+ */
 class ProgressUpdater {
 public:
     explicit ProgressUpdater(size_t numProgressBars) : mNumBars(numProgressBars) {
@@ -64,4 +70,6 @@ private:
     bool mExitRequested = false;
 };
 
-#endif // SRC_PROGRESS_UPDATER_H
+} // namespace filament::iblbaker
+
+#endif // TNT_IBLBAKER_PROGRESSUPDATER_H
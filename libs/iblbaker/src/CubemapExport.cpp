@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iblbaker/CubemapExport.h>
+
+#include <ibl/Cubemap.h>
+#include <ibl/Image.h>
+
+#include <image/ColorTransform.h>
+#include <image/Ktx1Bundle.h>
+
+#include <math/scalar.h>
+#include <math/vec3.h>
+
+#include <cmath>
+#include <memory>
+
+#include <string.h>
+
+using namespace filament::ibl;
+using namespace filament::math;
+using namespace image;
+
+namespace filament::iblbaker {
+
+float lodToPerceptualRoughness(float lod) noexcept {
+    const float a = 2.0f;
+    const float b = -1.0f;
+    return (lod != 0)
+            ? saturate((std::sqrt(a * a + 4.0f * b * lod) - a) / (2.0f * b))
+            : 0.0f;
+}
+
+LinearImage toLinearImage(Image const& image) {
+    LinearImage linearImage(uint32_t(image.getWidth()), uint32_t(image.getHeight()), 3);
+    // copy row by row since the image has padding
+    size_t const w = image.getWidth();
+    for (size_t y = 0, h = image.getHeight(); y < h; y++) {
+        memcpy(linearImage.getPixelRef(0, uint32_t(y)), image.getPixelRef(0, y),
+                w * sizeof(float3));
+    }
+    return linearImage;
+}
+
+void initKtxCubemap(Ktx1Bundle& container, uint32_t dim) {
+    container.info() = {
+        .endianness = Ktx1Bundle::ENDIAN_DEFAULT,
+        .glType = Ktx1Bundle::R11F_G11F_B10F,
+        .glTypeSize = 1,
+        .glFormat = Ktx1Bundle::RGB,
+        .glInternalFormat = Ktx1Bundle::R11F_G11F_B10F,
+        .glBaseInternalFormat = Ktx1Bundle::R11F_G11F_B10F,
+        .pixelWidth = dim,
+        .pixelHeight = dim,
+        .pixelDepth = 0,
+    };
+}
+
+void exportKtxFaces(Ktx1Bundle& container, uint32_t level, Cubemap const& cm) {
+    uint32_t const dim = uint32_t(cm.getDimensions());
+    // Cubemap::Face is in KTX order
+    for (uint32_t j = 0; j < 6; j++) {
+        LinearImage const image = toLinearImage(cm.getImageForFace(Cubemap::Face(j)));
+        std::unique_ptr<uint8_t[]> const data = fromLinearToRGB_10_11_11_REV(image);
+        container.setBlob({ level, 0, j }, data.get(), dim * dim * 4);
+    }
+}
+
+} // namespace filament::iblbaker
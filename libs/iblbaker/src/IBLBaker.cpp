@@ -0,0 +1,368 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iblbaker/IBLBaker.h>
+#include <iblbaker/CubemapExport.h>
+
+#include <ibl/Cubemap.h>
+#include <ibl/CubemapIBL.h>
+#include <ibl/CubemapSH.h>
+#include <ibl/CubemapUtils.h>
+#include <ibl/Image.h>
+
+#include <image/Ktx1Bundle.h>
+
+#include <imageio/ImageDecoder.h>
+#include <imageio/ImageEncoder.h>
+
+#include <utils/JobSystem.h>
+#include <utils/algorithm.h>
+
+#include <math/scalar.h>
+#include <math/vec3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include <string.h>
+
+using namespace filament::ibl;
+using namespace filament::math;
+using namespace image;
+using namespace utils;
+
+namespace filament::iblbaker {
+
+// Same defaults as cmgen --deploy
+static constexpr size_t SH_BAND_COUNT = 3;
+static constexpr size_t DEFAULT_CONCURRENCY = 2;
+
+// Share of the progress of a request taken by each stage. The reflections take the rest.
+static constexpr float LOADING_PROGRESS = 0.05f;
+static constexpr float SH_PROGRESS = 0.05f;
+static constexpr float SKYBOX_PROGRESS = 0.05f;
+static constexpr float DFG_PROGRESS = 0.05f;
+
+static bool isPOT(size_t x) {
+    return x && !(x & (x - 1));
+}
+
+static bool writeKtx(Path const& path, Ktx1Bundle const& container) {
+    std::vector<uint8_t> contents(container.getSerializedLength());
+    container.serialize(contents.data(), uint32_t(contents.size()));
+    std::ofstream out(path.getPath(), std::ios::binary | std::ios::trunc);
+    out.write((char const*) contents.data(), std::streamsize(contents.size()));
+    out.close();
+    return bool(out);
+}
+
+// Forwards the progress of a libibl filter to the progress callback of a request.
+struct FilterProgress {
+    IBLBaker::ProgressCallback const* callback;
+    IBLBaker::Id id;
+    float base;
+    float scale;
+
+    static void update(size_t, float v, void* userdata) {
+        auto const* self = static_cast<FilterProgress const*>(userdata);
+        (*self->callback)(self->id, IBLBaker::Stage::REFLECTIONS, self->base + v * self->scale);
+    }
+};
+
+// ------------------------------------------------------------------------------------------------
+
+IBLBaker::IBLBaker() : IBLBaker(Config{}) {
+}
+
+IBLBaker::IBLBaker(Config const& config) {
+    size_t const concurrency = config.concurrency ? config.concurrency : DEFAULT_CONCURRENCY;
+    mJobSystem = std::make_unique<JobSystem>(config.threadCount, concurrency);
+    for (size_t i = 0; i < concurrency; i++) {
+        mDrivers.emplace_back(&IBLBaker::driverLoop, this);
+    }
+}
+
+IBLBaker::~IBLBaker() {
+    waitForAll();
+    std::unique_lock<std::mutex> lock(mLock);
+    mExitRequested = true;
+    lock.unlock();
+    mCondition.notify_all();
+    for (std::thread& driver : mDrivers) {
+        driver.join();
+    }
+}
+
+IBLBaker::Id IBLBaker::submit(Request request, CompletionCallback completion,
+        ProgressCallback progress) {
+    std::unique_lock<std::mutex> lock(mLock);
+    Id const id = mNextId++;
+    if (progress) {
+        // the callback is called without holding the lock, so it can use the baker
+        lock.unlock();
+        progress(id, Stage::QUEUED, 0.0f);
+        lock.lock();
+    }
+    mQueue.push_back({ id, std::move(request), std::move(completion), std::move(progress) });
+    mPendingCount++;
+    lock.unlock();
+    mCondition.notify_all();
+    return id;
+}
+
+void IBLBaker::waitForAll() {
+    std::unique_lock<std::mutex> lock(mLock);
+    mCondition.wait(lock, [this] { return mPendingCount == 0; });
+}
+
+void IBLBaker::driverLoop() {
+    JobSystem::setThreadName("IBLBaker");
+    mJobSystem->adopt();
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCondition.wait(lock, [this] { return mExitRequested || !mQueue.empty(); });
+        if (mQueue.empty()) {
+            break;
+        }
+        Task task = std::move(mQueue.front());
+        mQueue.pop_front();
+        lock.unlock();
+
+        Result const result = bake(task.id, task.request, task.progress);
+        if (task.completion) {
+            task.completion(task.id, result);
+        }
+
+        lock.lock();
+        mPendingCount--;
+        if (mPendingCount == 0) {
+            mCondition.notify_all();
+        }
+    }
+    lock.unlock();
+    mJobSystem->emancipate();
+}
+
+std::shared_ptr<const LinearImage> IBLBaker::getDFG(DFGKey key) {
+    // The lock is held while computing a LUT, so that concurrent requests for the same one
+    // compute it only once.
+    std::lock_guard<std::mutex> const lock(mDFGLock);
+    for (auto const& [k, lut] : mDFGCache) {
+        if (k.size == key.size && k.multiscatter == key.multiscatter && k.cloth == key.cloth) {
+            return lut;
+        }
+    }
+    Image image(key.size, key.size);
+    CubemapIBL::DFG(*mJobSystem, image, key.multiscatter, key.cloth);
+    auto lut = std::make_shared<const LinearImage>(toLinearImage(image));
+    mDFGCache.emplace_back(key, lut);
+    return lut;
+}
+
+IBLBaker::Result IBLBaker::bake(Id id, Request const& request, ProgressCallback const& progress) {
+    JobSystem& js = *mJobSystem;
+    Result result;
+
+    auto report = [&](Stage stage, float value) {
+        if (progress) {
+            progress(id, stage, value);
+        }
+    };
+
+    auto fail = [&result](std::string error) {
+        result.error = std::move(error);
+        return result;
+    };
+
+    if (!isPOT(request.size) || !isPOT(request.minLodSize)) {
+        return fail("The sizes must be powers of two");
+    }
+
+    Path const outputDirectory = request.outputDirectory.getAbsolutePath();
+    if (!outputDirectory.exists() && !outputDirectory.mkdirRecursive()) {
+        return fail("Unable to create " + outputDirectory.getPath());
+    }
+
+    bool const hasEnvironment = !request.input.isEmpty() || request.image.isValid();
+    float const reflectionsProgress = 1.0f - LOADING_PROGRESS - SH_PROGRESS -
+            SKYBOX_PROGRESS - DFG_PROGRESS;
+
+    if (hasEnvironment) {
+        report(Stage::LOADING, 0.0f);
+
+        LinearImage source = request.image;
+        if (!request.input.isEmpty()) {
+            std::ifstream in(request.input.getPath(), std::ios::binary);
+            source = ImageDecoder::decode(in, request.input.getPath());
+            if (!source.isValid()) {
+                return fail("Unable to open image: " + request.input.getPath());
+            }
+        }
+        if (source.getChannels() != 3) {
+            return fail("The environment must be RGB (3 channels)");
+        }
+
+        std::string name = request.name;
+        if (name.empty()) {
+            name = request.input.isEmpty() ? "environment" : request.input.getNameWithoutExtension();
+        }
+
+        size_t const width = source.getWidth();
+        size_t const height = source.getHeight();
+        Image input(width, height);
+        for (size_t y = 0; y < height; y++) {
+            memcpy(input.getPixelRef(0, y), source.getPixelRef(0, uint32_t(y)),
+                    width * sizeof(float3));
+        }
+        source = {};
+        if (request.clamp) {
+            CubemapUtils::clamp(input);
+        }
+
+        // Images store the actual data, cubemaps are views on them
+        std::vector<Image> images(1);
+        std::vector<Cubemap> levels;
+        levels.push_back(CubemapUtils::create(images[0], request.size));
+        if ((isPOT(width) && width * 3 == height * 4) ||
+                (isPOT(height) && height * 3 == width * 4)) {
+            CubemapUtils::crossToCubemap(js, levels[0], input);
+        } else if (width == 2 * height) {
+            CubemapUtils::equirectangularToCubemap(js, levels[0], input);
+        } else {
+            return fail("Aspect ratio not supported: " +
+                    std::to_string(width) + "x" + std::to_string(height));
+        }
+        input = {};
+
+        if (request.mirror) {
+            Image temp;
+            Cubemap cm = CubemapUtils::create(temp, request.size);
+            CubemapUtils::mirrorCubemap(js, cm, levels[0]);
+            std::swap(levels[0], cm);
+            std::swap(images[0], temp);
+        }
+        levels[0].makeSeamless();
+
+        for (size_t dim = request.size; dim > 1; ) {
+            dim >>= 1u;
+            Image temp;
+            Cubemap dst = CubemapUtils::create(temp, dim);
+            CubemapUtils::downsampleCubemapLevelBoxFilter(js, dst, levels.back());
+            dst.makeSeamless();
+            images.push_back(std::move(temp));
+            levels.push_back(std::move(dst));
+        }
+
+        report(Stage::SPHERICAL_HARMONICS, LOADING_PROGRESS);
+
+        // pre-scaled irradiance SH, as cmgen --deploy
+        std::unique_ptr<float3[]> sh = CubemapSH::computeSH(js, levels[0], SH_BAND_COUNT, true);
+        CubemapSH::windowSH(sh, SH_BAND_COUNT, 0.0f);
+        CubemapSH::preprocessSHForShader(sh);
+
+        // The work of each level is proportional to its area and sample count, except for the
+        // first one which is a copy of the environment.
+        size_t const baseExp = ctz(request.size);
+        size_t minLod = ctz(request.minLodSize);
+        if (minLod >= baseExp) {
+            minLod = 0;
+        }
+        size_t const levelCount = (baseExp + 1) - minLod;
+        std::vector<float> levelWork(levelCount);
+        float totalWork = 0.0f;
+        for (size_t level = 0, samples = request.sampleCount; level < levelCount; level++) {
+            samples = level >= 2 ? samples * 2 : samples;
+            size_t const dim = request.size >> level;
+            levelWork[level] = float(dim * dim) * float(level ? samples : 1);
+            totalWork += levelWork[level];
+        }
+
+        Ktx1Bundle ibl(uint32_t(levelCount), 1, true);
+        initKtxCubemap(ibl, uint32_t(request.size));
+        float done = LOADING_PROGRESS + SH_PROGRESS;
+        for (size_t level = 0, samples = request.sampleCount; level < levelCount; level++) {
+            // starting at level 2, the number of samples doubles at each level, see cmgen
+            samples = level >= 2 ? samples * 2 : samples;
+            float const lod = saturate(float(level) / (float(levelCount) - 1.0f));
+            float const perceptualRoughness = lodToPerceptualRoughness(lod);
+            float const roughness = perceptualRoughness * perceptualRoughness;
+
+            FilterProgress filterProgress{ &progress, id, done,
+                    reflectionsProgress * levelWork[level] / totalWork };
+            Image image;
+            Cubemap dst = CubemapUtils::create(image, request.size >> level);
+            CubemapIBL::roughnessFilter(js, dst, levels, roughness, samples, float3{ 1 },
+                    request.prefilter, progress ? &FilterProgress::update : nullptr,
+                    &filterProgress);
+            dst.makeSeamless();
+            exportKtxFaces(ibl, uint32_t(level), dst);
+            done += filterProgress.scale;
+        }
+
+        std::ostringstream coefficients;
+        for (size_t l = 0; l < SH_BAND_COUNT; l++) {
+            for (ssize_t m = -ssize_t(l); m <= ssize_t(l); m++) {
+                float3 const v = sh[CubemapSH::getShIndex(m, l)];
+                coefficients << v.r << " " << v.g << " " << v.b << "\n";
+            }
+        }
+        ibl.setMetadata("sh", coefficients.str().c_str());
+
+        Path const iblPath = outputDirectory + (name + "_ibl.ktx");
+        if (!writeKtx(iblPath, ibl)) {
+            return fail("Unable to write " + iblPath.getPath());
+        }
+        result.outputs.push_back(iblPath);
+
+        report(Stage::SKYBOX, done);
+        if (request.skybox) {
+            Ktx1Bundle skybox(1, 1, true);
+            initKtxCubemap(skybox, uint32_t(request.size));
+            exportKtxFaces(skybox, 0, levels[0]);
+            Path const skyboxPath = outputDirectory + (name + "_skybox.ktx");
+            if (!writeKtx(skyboxPath, skybox)) {
+                return fail("Unable to write " + skyboxPath.getPath());
+            }
+            result.outputs.push_back(skyboxPath);
+        }
+    }
+
+    if (!request.dfg.isEmpty()) {
+        report(Stage::DFG, 1.0f - DFG_PROGRESS);
+        std::shared_ptr<const LinearImage> const lut =
+                getDFG({ request.dfgSize, request.dfgMultiscatter, request.dfgCloth });
+        Path const dfgPath = request.dfg.getAbsolutePath();
+        Path const parent = dfgPath.getParent();
+        if (!parent.exists()) {
+            parent.mkdirRecursive();
+        }
+        std::ofstream out(dfgPath.getPath(), std::ios::binary | std::ios::trunc);
+        ImageEncoder::Format const format = ImageEncoder::chooseFormat(dfgPath.getName(), true);
+        if (!out || !ImageEncoder::encode(out, format, *lut, "", dfgPath.getPath())) {
+            return fail("Unable to write " + dfgPath.getPath());
+        }
+        result.outputs.push_back(dfgPath);
+    }
+
+    report(Stage::DONE, 1.0f);
+    result.success = true;
+    return result;
+}
+
+} // namespace filament::iblbaker
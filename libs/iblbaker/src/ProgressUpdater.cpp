@@ -14,13 +14,15 @@
  * limitations under the License.
  */
 
-#include "ProgressUpdater.h"
+#include <iblbaker/ProgressUpdater.h>
 
 #include <algorithm>
 #include <string>
 
 #include <signal.h>
 
+namespace filament::iblbaker {
+
 static void moveCursorUp(size_t n) {
     std::cout << "\033[" << n << "F";
 }
@@ -131,3 +133,5 @@ void ProgressUpdater::printProgressBars() {
         std::cout << std::endl;
     }
 }
+
+} // namespace filament::iblbaker
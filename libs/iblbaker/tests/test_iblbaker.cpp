@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iblbaker/IBLBaker.h>
+
+#include <image/Ktx1Bundle.h>
+#include <image/LinearImage.h>
+
+#include <utils/Path.h>
+
+#include <gtest/gtest.h>
+
+#include "TemporaryDirectoryTest.h"
+
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace filament::iblbaker;
+using namespace image;
+using namespace utils;
+
+class IBLBakerTest : public TemporaryDirectoryTest {};
+
+// A small equirectangular environment with a bright "sun" that depends on the seed.
+static LinearImage createEnvironment(uint32_t seed) {
+    uint32_t const width = 64;
+    uint32_t const height = 32;
+    LinearImage image(width, height, 3);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            float* pixel = image.getPixelRef(x, y);
+            float const sky = 1.0f - float(y) / float(height);
+            bool const sun = x == (seed * 7) % width && y == (seed * 3) % (height / 2);
+            pixel[0] = sun ? 50.0f : 0.2f * sky;
+            pixel[1] = sun ? 40.0f : 0.4f * sky;
+            pixel[2] = sun ? 30.0f : 0.8f * sky + 0.1f;
+        }
+    }
+    return image;
+}
+
+static std::vector<uint8_t> readFile(Path const& path) {
+    std::ifstream in(path.getPath(), std::ios::binary);
+    return { std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+}
+
+static IBLBaker::Request createRequest(uint32_t seed, Path const& outputDirectory) {
+    IBLBaker::Request request;
+    request.image = createEnvironment(seed);
+    request.name = "env" + std::to_string(seed);
+    request.outputDirectory = outputDirectory;
+    request.size = 32;
+    request.minLodSize = 4;
+    request.sampleCount = 64;
+    return request;
+}
+
+TEST_F(IBLBakerTest, Outputs) {
+    IBLBaker baker(IBLBaker::Config{ .threadCount = 2, .concurrency = 1 });
+    IBLBaker::Result result;
+    baker.submit(createRequest(1, mRoot), [&result](IBLBaker::Id, IBLBaker::Result const& r) {
+        result = r;
+    });
+    baker.waitForAll();
+
+    ASSERT_TRUE(result.success) << result.error;
+    ASSERT_EQ(result.outputs.size(), 2);
+    EXPECT_EQ(result.outputs[0].getName(), "env1_ibl.ktx");
+    EXPECT_EQ(result.outputs[1].getName(), "env1_skybox.ktx");
+
+    std::vector<uint8_t> const ibl = readFile(result.outputs[0]);
+    Ktx1Bundle bundle(ibl.data(), uint32_t(ibl.size()));
+    EXPECT_TRUE(bundle.isCubemap());
+    EXPECT_EQ(bundle.getNumMipLevels(), 4);     // 32 down to 4
+    EXPECT_EQ(bundle.info().pixelWidth, 32);
+    ASSERT_NE(bundle.getMetadata("sh"), nullptr);
+
+    // 9 RGB coefficients, one per line
+    std::string const sh = bundle.getMetadata("sh");
+    EXPECT_EQ(std::count(sh.begin(), sh.end(), '\n'), 9);
+
+    std::vector<uint8_t> const skybox = readFile(result.outputs[1]);
+    Ktx1Bundle const skyboxBundle(skybox.data(), uint32_t(skybox.size()));
+    EXPECT_EQ(skyboxBundle.getNumMipLevels(), 1);
+}
+
+TEST_F(IBLBakerTest, ConcurrentBakesMatchSerialBakes) {
+    constexpr uint32_t COUNT = 6;
+    Path const serial = mRoot + "serial";
+    Path const concurrent = mRoot + "concurrent";
+    {
+        IBLBaker baker(IBLBaker::Config{ .threadCount = 1, .concurrency = 1 });
+        for (uint32_t i = 0; i < COUNT; i++) {
+            baker.submit(createRequest(i, serial));
+        }
+        baker.waitForAll();
+    }
+
+    std::mutex lock;
+    std::vector<float> progress(COUNT, -1.0f);
+    std::vector<IBLBaker::Stage> stages(COUNT, IBLBaker::Stage::QUEUED);
+    size_t failures = 0;
+    {
+        IBLBaker baker(IBLBaker::Config{ .threadCount = 3, .concurrency = 3 });
+        EXPECT_EQ(baker.getConcurrency(), 3);
+        for (uint32_t i = 0; i < COUNT; i++) {
+            IBLBaker::Id const id = baker.submit(createRequest(i, concurrent),
+                    [&](IBLBaker::Id, IBLBaker::Result const& result) {
+                        std::lock_guard<std::mutex> const guard(lock);
+                        failures += result.success ? 0 : 1;
+                    },
+                    [&](IBLBaker::Id id, IBLBaker::Stage stage, float value) {
+                        std::lock_guard<std::mutex> const guard(lock);
+                        EXPECT_GE(value, 0.0f);
+                        EXPECT_LE(value, 1.0f);
+                        progress[id] = std::max(progress[id], value);
+                        stages[id] = std::max(stages[id], stage);
+                    });
+            EXPECT_EQ(id, i);
+        }
+        // the destructor waits for the pending requests
+    }
+
+    EXPECT_EQ(failures, 0);
+    for (uint32_t i = 0; i < COUNT; i++) {
+        EXPECT_EQ(progress[i], 1.0f);
+        EXPECT_EQ(stages[i], IBLBaker::Stage::DONE);
+        for (char const* suffix : { "_ibl.ktx", "_skybox.ktx" }) {
+            std::string const name = "env" + std::to_string(i) + suffix;
+            std::vector<uint8_t> const expected = readFile(serial + name);
+            EXPECT_FALSE(expected.empty());
+            EXPECT_EQ(readFile(concurrent + name), expected) << name;
+        }
+    }
+}
+
+TEST_F(IBLBakerTest, Errors) {
+    IBLBaker baker(IBLBaker::Config{ .threadCount = 1, .concurrency = 2 });
+    std::vector<IBLBaker::Result> results(3);
+    auto completion = [&results](IBLBaker::Id id, IBLBaker::Result const& result) {
+        results[id] = result;
+    };
+
+    IBLBaker::Request badSize = createRequest(0, mRoot);
+    badSize.size = 30;
+    baker.submit(std::move(badSize), completion);
+
+    IBLBaker::Request badAspectRatio = createRequest(0, mRoot);
+    badAspectRatio.image = LinearImage(16, 16, 3);
+    baker.submit(std::move(badAspectRatio), completion);
+
+    IBLBaker::Request missing;
+    missing.input = mRoot + "missing.hdr";
+    missing.outputDirectory = mRoot;
+    baker.submit(std::move(missing), completion);
+
+    baker.waitForAll();
+    for (IBLBaker::Result const& result : results) {
+        EXPECT_FALSE(result.success);
+        EXPECT_FALSE(result.error.empty());
+        EXPECT_TRUE(result.outputs.empty());
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
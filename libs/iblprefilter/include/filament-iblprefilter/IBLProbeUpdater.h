@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_IBL_PREFILTER_IBLPROBEUPDATER_H
+#define TNT_IBL_PREFILTER_IBLPROBEUPDATER_H
+
+#include <utils/compiler.h>
+
+#include <filament/Texture.h>
+
+#include <memory>
+
+#include <stdint.h>
+
+namespace filament {
+class Engine;
+class IndirectLight;
+class Scene;
+} // namespace filament
+
+/**
+ * IBLProbeUpdater refreshes the IndirectLight of a Scene from a new environment, without blocking
+ * the frame.
+ *
+ * The work -- mipmapping the environment, projecting it onto spherical harmonics for the
+ * irradiance and filtering each roughness level of the reflections -- is cut into small chunks
+ * that use the Engine's JobSystem. Each call to update() runs chunks for about the given time
+ * budget, so that calling it once per frame spreads an update over several frames. When the last
+ * chunk is done, a new IndirectLight is set on the Scene and the previous one is destroyed, so
+ * that a frame never sees a partially updated probe.
+ *
+ * Unlike IBLPrefilterContext, the filtering is done on the CPU with the ibl library, like
+ * Texture::generatePrefilterMipmap().
+ *
+ * IBLProbeUpdater owns the IndirectLight of the Scene, and must be used from the Engine's thread.
+ *
+ * Usage Example:
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * IBLProbeUpdater updater(*engine, *scene);
+ *
+ * // each time the environment changes, e.g. after capturing a probe
+ * updater.start(std::move(buffer), 256);
+ *
+ * // every frame, before rendering
+ * updater.update(2.0f);
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ */
+class UTILS_PUBLIC IBLProbeUpdater {
+public:
+    struct Config {
+        uint16_t sampleCount = 16;   //!< sample count used for filtering the reflections
+        bool fast = true;            //!< see Texture::PrefilterOptions::fast
+        bool mirror = true;          //!< whether the environment must be mirrored
+        /**
+         * Intensity of the first IndirectLight, the following ones keep the intensity and
+         * rotation of the IndirectLight they replace.
+         */
+        float intensity = 30000.0f;
+    };
+
+    IBLProbeUpdater(filament::Engine& engine, filament::Scene& scene);
+    IBLProbeUpdater(filament::Engine& engine, filament::Scene& scene, Config const& config);
+
+    /**
+     * Destroys the IndirectLight and reflections texture created by this IBLProbeUpdater. The
+     * IndirectLight is removed from the Scene.
+     */
+    ~IBLProbeUpdater() noexcept;
+
+    // not copyable
+    IBLProbeUpdater(IBLProbeUpdater const&) = delete;
+    IBLProbeUpdater& operator=(IBLProbeUpdater const&) = delete;
+
+    /**
+     * Starts updating the probe from a new environment. An update in progress is abandoned.
+     *
+     * @param buffer  Client-side buffer containing the six faces of the environment, one after
+     *                the other in the following order: +x, -x, +y, -y, +z, -z. The data must be
+     *                RGB or RGBA, FLOAT or HALF. It's copied before this call returns.
+     * @param size    Width and height of the faces, must be a power-of-two.
+     *
+     * @exception utils::PreConditionPanic if the source data constraints are not respected.
+     */
+    void start(filament::Texture::PixelBufferDescriptor&& buffer, uint32_t size);
+
+    /**
+     * Works on the update in progress, if any, for about \p budgetMs milliseconds. At least one
+     * chunk of work is done per call, which keeps the update going with a zero budget.
+     *
+     * @return true if the update completed during this call, i.e. a new IndirectLight was set
+     *         on the Scene.
+     */
+    bool update(float budgetMs);
+
+    //! Returns whether an update is in progress
+    bool isUpdating() const noexcept;
+
+    //! Returns the current IndirectLight, or nullptr before the first update has completed
+    filament::IndirectLight* UTILS_NULLABLE getIndirectLight() const noexcept {
+        return mIndirectLight;
+    }
+
+private:
+    struct Update;
+    bool step();
+    void finish();
+    filament::Engine& mEngine;
+    filament::Scene& mScene;
+    Config mConfig;
+    std::unique_ptr<Update> mUpdate;
+    filament::IndirectLight* mIndirectLight = nullptr;
+    filament::Texture* mReflections = nullptr;
+};
+
+#endif //TNT_IBL_PREFILTER_IBLPROBEUPDATER_H
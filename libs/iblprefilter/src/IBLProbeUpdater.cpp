@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "filament-iblprefilter/IBLProbeUpdater.h"
+
+#include <filament/Engine.h>
+#include <filament/IndirectLight.h>
+#include <filament/Scene.h>
+#include <filament/Texture.h>
+
+#include <ibl/Cubemap.h>
+#include <ibl/CubemapIBL.h>
+#include <ibl/CubemapSH.h>
+#include <ibl/CubemapUtils.h>
+#include <ibl/Image.h>
+
+#include <utils/algorithm.h>
+#include <utils/compiler.h>
+#include <utils/JobSystem.h>
+#include <utils/Panic.h>
+#include <utils/Systrace.h>
+
+#include <math/half.h>
+#include <math/mat3.h>
+#include <math/scalar.h>
+#include <math/vec3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace filament::math;
+using namespace filament;
+using namespace filament::ibl;
+
+// The irradiance SH are computed from the largest level of the mip chain that is at most this
+// size: 3 bands don't need more, and the projection then takes a negligible amount of time.
+static constexpr size_t SH_MAX_SIZE = 64;
+
+// Approximate number of importance samples evaluated per chunk of work. On a single core, this
+// is in the order of a millisecond.
+static constexpr size_t SAMPLES_PER_CHUNK = 1u << 16u;
+
+struct IBLProbeUpdater::Update {
+    enum class Stage : uint8_t {
+        MIPMAPS,        // one chunk per level of the mip chain
+        IRRADIANCE,     // a single chunk
+        REFLECTIONS,    // a few rows of a face of a level of the reflections per chunk
+        DONE
+    };
+
+    Stage stage = Stage::MIPMAPS;
+    std::vector<Image> images;
+    std::vector<Cubemap> levels;
+    std::unique_ptr<float3[]> sh;
+    Texture* reflections = nullptr;
+
+    // level of the reflections being filtered
+    Image image;
+    Cubemap cubemap{ 1 };
+    uint32_t level = 0;
+    uint8_t face = 0;
+    uint32_t row = 0;
+};
+
+IBLProbeUpdater::IBLProbeUpdater(Engine& engine, Scene& scene)
+        : IBLProbeUpdater(engine, scene, {}) {
+}
+
+IBLProbeUpdater::IBLProbeUpdater(Engine& engine, Scene& scene, Config const& config)
+        : mEngine(engine), mScene(scene), mConfig(config) {
+}
+
+IBLProbeUpdater::~IBLProbeUpdater() noexcept {
+    if (mUpdate) {
+        mEngine.destroy(mUpdate->reflections);
+    }
+    if (mIndirectLight) {
+        if (mScene.getIndirectLight() == mIndirectLight) {
+            mScene.setIndirectLight(nullptr);
+        }
+        mEngine.destroy(mIndirectLight);
+        mEngine.destroy(mReflections);
+    }
+}
+
+bool IBLProbeUpdater::isUpdating() const noexcept {
+    return bool(mUpdate);
+}
+
+void IBLProbeUpdater::start(Texture::PixelBufferDescriptor&& buffer, uint32_t size) {
+    SYSTRACE_CALL();
+
+    using PixelDataFormat = Texture::PixelBufferDescriptor::PixelDataFormat;
+    using PixelDataType = Texture::PixelBufferDescriptor::PixelDataType;
+
+    FILAMENT_CHECK_PRECONDITION(
+            buffer.format == PixelDataFormat::RGB || buffer.format == PixelDataFormat::RGBA)
+            << "input data format must be RGB or RGBA";
+
+    FILAMENT_CHECK_PRECONDITION(
+            buffer.type == PixelDataType::FLOAT || buffer.type == PixelDataType::HALF)
+            << "input data type must be FLOAT or HALF";
+
+    FILAMENT_CHECK_PRECONDITION(size && !(size & (size - 1)))
+            << "input data cubemap dimensions must be a power-of-two";
+
+    const size_t stride = buffer.stride ? buffer.stride : size;
+    const size_t bpr = Texture::computeTextureDataSize(
+            buffer.format, buffer.type, stride, 1, buffer.alignment);
+    const size_t bpp = (buffer.format == PixelDataFormat::RGB ? 3 : 4) *
+            (buffer.type == PixelDataType::FLOAT ? 4 : 2);
+
+    FILAMENT_CHECK_PRECONDITION(buffer.size >= bpr * size * 6)
+            << "buffer is too small for six " << size << "x" << size << " faces";
+
+    // an update in progress is simply abandoned
+    if (mUpdate) {
+        mEngine.destroy(mUpdate->reflections);
+    }
+    mUpdate = std::make_unique<Update>();
+    Update& u = *mUpdate;
+
+    const size_t levelCount = utils::ctz(size) + 1;
+    u.images.reserve(levelCount);
+    u.levels.reserve(levelCount);
+
+    Image image;
+    Cubemap cm = CubemapUtils::create(image, size);
+    for (size_t j = 0; j < 6; j++) {
+        Image const& faceImage = cm.getImageForFace((Cubemap::Face)j);
+        for (size_t y = 0; y < size; y++) {
+            auto* out = static_cast<Cubemap::Texel*>(faceImage.getPixelRef(0, y));
+            uint8_t const* src = static_cast<uint8_t const*>(buffer.buffer) + (j * size + y) * bpr;
+            for (size_t x = 0; x < size; x++, out++, src += bpp) {
+                if (buffer.type == PixelDataType::FLOAT) {
+                    Cubemap::writeAt(out, *reinterpret_cast<float3 const*>(src));
+                } else {
+                    Cubemap::writeAt(out, float3{ *reinterpret_cast<half3 const*>(src) });
+                }
+            }
+        }
+    }
+    cm.makeSeamless();
+    u.images.push_back(std::move(image));
+    u.levels.push_back(std::move(cm));
+    u.stage = size > 1 ? Update::Stage::MIPMAPS : Update::Stage::IRRADIANCE;
+
+    u.reflections = Texture::Builder()
+            .sampler(Texture::Sampler::SAMPLER_CUBEMAP)
+            .format(Texture::InternalFormat::R11F_G11F_B10F)
+            .width(size).height(size).levels(uint8_t(levelCount))
+            .build(mEngine);
+}
+
+bool IBLProbeUpdater::update(float budgetMs) {
+    SYSTRACE_CALL();
+
+    if (!mUpdate) {
+        return false;
+    }
+
+    using clock = std::chrono::steady_clock;
+    const auto deadline = clock::now() + std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<float, std::milli>(budgetMs));
+    do {
+        if (step()) {
+            finish();
+            return true;
+        }
+    } while (clock::now() < deadline);
+    return false;
+}
+
+bool IBLProbeUpdater::step() {
+    Update& u = *mUpdate;
+    utils::JobSystem& js = mEngine.getJobSystem();
+
+    switch (u.stage) {
+        case Update::Stage::MIPMAPS: {
+            const size_t dim = u.levels.back().getDimensions() / 2;
+            Image image;
+            Cubemap dst = CubemapUtils::create(image, dim);
+            CubemapUtils::downsampleCubemapLevelBoxFilter(js, dst, u.levels.back());
+            dst.makeSeamless();
+            u.images.push_back(std::move(image));
+            u.levels.push_back(std::move(dst));
+            if (dim == 1) {
+                u.stage = Update::Stage::IRRADIANCE;
+            }
+            break;
+        }
+
+        case Update::Stage::IRRADIANCE: {
+            auto pos = std::find_if(u.levels.begin(), u.levels.end(), [](Cubemap const& cm) {
+                return cm.getDimensions() <= SH_MAX_SIZE;
+            });
+            u.sh = CubemapSH::computeSH(js, *pos, 3, false);
+            if (mConfig.mirror) {
+                // mirroring along x flips the sign of the basis functions that are odd in x
+                u.sh[CubemapSH::getShIndex( 1, 1)] = -u.sh[CubemapSH::getShIndex( 1, 1)];
+                u.sh[CubemapSH::getShIndex(-2, 2)] = -u.sh[CubemapSH::getShIndex(-2, 2)];
+                u.sh[CubemapSH::getShIndex( 1, 2)] = -u.sh[CubemapSH::getShIndex( 1, 2)];
+            }
+            u.stage = Update::Stage::REFLECTIONS;
+            break;
+        }
+
+        case Update::Stage::REFLECTIONS: {
+            // same parameters as Texture::generatePrefilterMipmap()
+            const size_t levelCount = u.levels.size();
+            const size_t dim = u.levels[0].getDimensions() >> u.level;
+            const float lod = levelCount > 1 ? float(u.level) / float(levelCount - 1) : 0.0f;
+            const float linearRoughness = lod * lod;
+            const float3 mirror = mConfig.mirror ? float3{ -1, 1, 1 } : float3{ 1, 1, 1 };
+            const CubemapIBL::Quality quality =
+                    mConfig.fast ? CubemapIBL::Quality::FAST : CubemapIBL::Quality::HIGH;
+
+            if (u.face == 0 && u.row == 0) {
+                u.cubemap = CubemapUtils::create(u.image, dim);
+            }
+
+            // a roughness of 0 is just a copy
+            const size_t samplesPerRow = dim * (linearRoughness == 0 ? 1 : mConfig.sampleCount);
+            const size_t rows = std::clamp(SAMPLES_PER_CHUNK / samplesPerRow,
+                    size_t(1), dim - u.row);
+
+            CubemapIBL::roughnessFilter(js, u.cubemap,
+                    { u.levels.data(), uint32_t(levelCount) },
+                    linearRoughness, mConfig.sampleCount, mirror, true, quality,
+                    (Cubemap::Face)u.face, u.row, rows);
+
+            u.row += rows;
+            if (u.row < dim) {
+                break;
+            }
+            u.row = 0;
+            if (++u.face < 6) {
+                break;
+            }
+            u.face = 0;
+
+            // the level is complete, upload it
+            for (size_t j = 0; j < 6; j++) {
+                Image const& faceImage = u.cubemap.getImageForFace((Cubemap::Face)j);
+                const size_t size = dim * dim * sizeof(Cubemap::Texel);
+                auto* const data = static_cast<Cubemap::Texel*>(malloc(size));
+                for (size_t y = 0; y < dim; y++) {
+                    memcpy(data + y * dim, faceImage.getPixelRef(0, y),
+                            dim * sizeof(Cubemap::Texel));
+                }
+                u.reflections->setImage(mEngine, u.level, 0, 0, uint32_t(j),
+                        uint32_t(dim), uint32_t(dim), 1, {
+                                data, size,
+                                Texture::PixelBufferDescriptor::PixelDataFormat::RGB,
+                                Texture::PixelBufferDescriptor::PixelDataType::FLOAT,
+                                [](void* buffer, size_t, void*) { free(buffer); }});
+            }
+
+            if (++u.level == levelCount) {
+                u.stage = Update::Stage::DONE;
+            }
+            break;
+        }
+
+        case Update::Stage::DONE:
+            break;
+    }
+    return u.stage == Update::Stage::DONE;
+}
+
+void IBLProbeUpdater::finish() {
+    Update& u = *mUpdate;
+
+    float intensity = mConfig.intensity;
+    mat3f rotation;
+    if (mIndirectLight) {
+        intensity = mIndirectLight->getIntensity();
+        rotation = mIndirectLight->getRotation();
+    }
+
+    IndirectLight* const indirectLight = IndirectLight::Builder()
+            .reflections(u.reflections)
+            .radiance(3, u.sh.get())
+            .intensity(intensity)
+            .rotation(rotation)
+            .build(mEngine);
+
+    // swap the new IndirectLight in, between two frames
+    mScene.setIndirectLight(indirectLight);
+    if (mIndirectLight) {
+        mEngine.destroy(mIndirectLight);
+        mEngine.destroy(mReflections);
+    }
+    mIndirectLight = indirectLight;
+    mReflections = u.reflections;
+    mUpdate.reset();
+}
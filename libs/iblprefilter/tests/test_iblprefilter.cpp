@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filament-iblprefilter/IBLProbeUpdater.h>
+
+#include <filament/Engine.h>
+#include <filament/IndirectLight.h>
+#include <filament/Scene.h>
+#include <filament/Texture.h>
+
+#include <gtest/gtest.h>
+
+#include <math/vec3.h>
+
+#include <stdlib.h>
+
+using namespace filament;
+using namespace filament::math;
+
+namespace {
+
+constexpr uint32_t SIZE = 16;
+
+// six faces of a constant environment
+Texture::PixelBufferDescriptor createEnvironment(float3 const& color) {
+    size_t const count = SIZE * SIZE * 6;
+    auto* const data = static_cast<float3*>(malloc(count * sizeof(float3)));
+    for (size_t i = 0; i < count; i++) {
+        data[i] = color;
+    }
+    return { data, count * sizeof(float3),
+            Texture::Format::RGB, Texture::Type::FLOAT,
+            [](void* buffer, size_t, void*) { free(buffer); }};
+}
+
+// runs update() with a zero budget until the update completes, returns the number of calls
+size_t complete(IBLProbeUpdater& updater) {
+    size_t calls = 0;
+    while (updater.isUpdating()) {
+        calls++;
+        if (updater.update(0.0f)) {
+            break;
+        }
+    }
+    return calls;
+}
+
+class IBLProbeUpdaterTest : public testing::Test {
+protected:
+    void SetUp() override {
+        engine = Engine::create(Engine::Backend::NOOP);
+        scene = engine->createScene();
+    }
+
+    void TearDown() override {
+        engine->destroy(scene);
+        Engine::destroy(&engine);
+    }
+
+    Engine* engine = nullptr;
+    Scene* scene = nullptr;
+};
+
+} // anonymous namespace
+
+TEST_F(IBLProbeUpdaterTest, UpdateIsSpreadOverCalls) {
+    IBLProbeUpdater updater(*engine, *scene);
+    EXPECT_FALSE(updater.isUpdating());
+    EXPECT_EQ(updater.getIndirectLight(), nullptr);
+    EXPECT_FALSE(updater.update(0.0f));
+
+    updater.start(createEnvironment({ 1.0f, 0.5f, 0.25f }), SIZE);
+    EXPECT_TRUE(updater.isUpdating());
+
+    // the scene doesn't see the new probe until the last chunk is done
+    EXPECT_FALSE(updater.update(0.0f));
+    EXPECT_EQ(scene->getIndirectLight(), nullptr);
+    EXPECT_GT(complete(updater), 1u);
+
+    EXPECT_FALSE(updater.isUpdating());
+    IndirectLight* const first = updater.getIndirectLight();
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(scene->getIndirectLight(), first);
+    EXPECT_EQ(first->getIntensity(), IBLProbeUpdater::Config{}.intensity);
+    ASSERT_NE(first->getReflectionsTexture(), nullptr);
+    EXPECT_EQ(first->getReflectionsTexture()->getWidth(), SIZE);
+
+    // the next probe replaces the previous one and keeps its intensity
+    first->setIntensity(1000.0f);
+    updater.start(createEnvironment({ 0.0f, 1.0f, 0.0f }), SIZE);
+    EXPECT_EQ(scene->getIndirectLight(), first);
+    complete(updater);
+    IndirectLight* const second = updater.getIndirectLight();
+    ASSERT_NE(second, nullptr);
+    EXPECT_NE(second, first);
+    EXPECT_EQ(scene->getIndirectLight(), second);
+    EXPECT_EQ(second->getIntensity(), 1000.0f);
+}
+
+TEST_F(IBLProbeUpdaterTest, LargeBudgetCompletesInOneCall) {
+    IBLProbeUpdater updater(*engine, *scene);
+    updater.start(createEnvironment({ 1.0f }), SIZE);
+    EXPECT_TRUE(updater.update(60000.0f));
+    EXPECT_FALSE(updater.isUpdating());
+    EXPECT_NE(updater.getIndirectLight(), nullptr);
+}
+
+TEST_F(IBLProbeUpdaterTest, StartAbandonsUpdateInProgress) {
+    IBLProbeUpdater updater(*engine, *scene);
+    updater.start(createEnvironment({ 1.0f }), SIZE);
+    updater.update(0.0f);
+    updater.update(0.0f);
+
+    updater.start(createEnvironment({ 0.5f }), SIZE);
+    EXPECT_TRUE(updater.isUpdating());
+    EXPECT_EQ(updater.getIndirectLight(), nullptr);
+    complete(updater);
+    EXPECT_NE(updater.getIndirectLight(), nullptr);
+    EXPECT_EQ(scene->getIndirectLight(), updater.getIndirectLight());
+}
+
+TEST_F(IBLProbeUpdaterTest, DestructorRemovesIndirectLight) {
+    {
+        IBLProbeUpdater updater(*engine, *scene);
+        updater.start(createEnvironment({ 1.0f }), SIZE);
+        complete(updater);
+        EXPECT_NE(scene->getIndirectLight(), nullptr);
+
+        // an update in progress is released too
+        updater.start(createEnvironment({ 1.0f }), SIZE);
+        updater.update(0.0f);
+    }
+    EXPECT_EQ(scene->getIndirectLight(), nullptr);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
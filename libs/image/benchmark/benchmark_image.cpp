@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <image/ImageSampler.h>
+#include <image/LinearImage.h>
+
+#include <utils/JobSystem.h>
+
+#include <benchmark/benchmark.h>
+
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace image;
+using namespace utils;
+
+/*
+ * Resampling benchmarks. The source is a square RGB image of state.range(0) pixels on a side,
+ * filled with noise, and state.range(1) selects the image::Filter. Each benchmark runs once
+ * on the calling thread and once on a JobSystem ("MT" variants).
+ */
+
+static constexpr Filter FILTERS[] = {
+        Filter::BOX,
+        Filter::NEAREST,
+        Filter::HERMITE,
+        Filter::GAUSSIAN_SCALARS,
+        Filter::GAUSSIAN_NORMALS,
+        Filter::MITCHELL,
+        Filter::LANCZOS,
+        Filter::MINIMUM,
+};
+
+// Source images are expensive to create (an 8k image is 768 MiB), so they're shared by all
+// the benchmarks.
+static LinearImage const& getSourceImage(uint32_t size) {
+    static std::map<uint32_t, LinearImage> sCache;
+    auto pos = sCache.find(size);
+    if (pos == sCache.end()) {
+        LinearImage image(size, size, 3);
+        std::default_random_engine gen; // NOLINT
+        std::uniform_real_distribution<float> rand(0.0f, 1.0f);
+        float* const data = image.getPixelRef();
+        for (size_t i = 0, c = size_t(size) * size * 3; i < c; i++) {
+            data[i] = rand(gen);
+        }
+        pos = sCache.emplace(size, image).first;
+    }
+    return pos->second;
+}
+
+static void sizesAndFilters(benchmark::internal::Benchmark* b) {
+    for (int64_t size : { 1024, 4096, 8192 }) {
+        for (int64_t filter = 0; filter < int64_t(std::size(FILTERS)); filter++) {
+            b->Args({ size, filter });
+        }
+    }
+    b->ArgNames({ "size", "filter" })->Unit(benchmark::kMillisecond);
+}
+
+static void setCounters(benchmark::State& state, uint32_t size) {
+    state.SetLabel(std::to_string(size) + "px");
+    state.SetBytesProcessed(int64_t(state.iterations()) * size * size * 3 * sizeof(float));
+}
+
+static void BM_resampleImage(benchmark::State& state) {
+    uint32_t const size = uint32_t(state.range(0));
+    Filter const filter = FILTERS[state.range(1)];
+    LinearImage const& source = getSourceImage(size);
+    for (auto _ : state) {
+        LinearImage result = resampleImage(source, size / 2, size / 2, filter);
+        benchmark::DoNotOptimize(result.getPixelRef());
+    }
+    setCounters(state, size);
+}
+
+static void BM_resampleImageMT(benchmark::State& state) {
+    uint32_t const size = uint32_t(state.range(0));
+    Filter const filter = FILTERS[state.range(1)];
+    LinearImage const& source = getSourceImage(size);
+    JobSystem js;
+    js.adopt();
+    for (auto _ : state) {
+        LinearImage result = resampleImage(js, source, size / 2, size / 2, filter);
+        benchmark::DoNotOptimize(result.getPixelRef());
+    }
+    js.emancipate();
+    setCounters(state, size);
+}
+
+static void BM_generateMipmaps(benchmark::State& state) {
+    uint32_t const size = uint32_t(state.range(0));
+    Filter const filter = FILTERS[state.range(1)];
+    LinearImage const& source = getSourceImage(size);
+    uint32_t const count = getMipmapCount(source);
+    std::vector<LinearImage> levels(count);
+    for (auto _ : state) {
+        generateMipmaps(source, filter, levels.data(), count);
+        benchmark::DoNotOptimize(levels.data());
+    }
+    setCounters(state, size);
+}
+
+static void BM_generateMipmapsMT(benchmark::State& state) {
+    uint32_t const size = uint32_t(state.range(0));
+    Filter const filter = FILTERS[state.range(1)];
+    LinearImage const& source = getSourceImage(size);
+    uint32_t const count = getMipmapCount(source);
+    std::vector<LinearImage> levels(count);
+    JobSystem js;
+    js.adopt();
+    for (auto _ : state) {
+        generateMipmaps(js, source, filter, levels.data(), count);
+        benchmark::DoNotOptimize(levels.data());
+    }
+    js.emancipate();
+    setCounters(state, size);
+}
+
+BENCHMARK(BM_resampleImage)->Apply(sizesAndFilters);
+BENCHMARK(BM_resampleImageMT)->Apply(sizesAndFilters);
+BENCHMARK(BM_generateMipmaps)->Apply(sizesAndFilters);
+BENCHMARK(BM_generateMipmapsMT)->Apply(sizesAndFilters);
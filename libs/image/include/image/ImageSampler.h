@@ -21,8 +21,15 @@
 
 #include <utils/compiler.h>
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace image {
 
+class ScanlineReader;
+class ScanlineWriter;
+
 /**
  * Value of a single point sample, allocated according to the number of image channels.
  */
@@ -114,6 +121,41 @@ UTILS_PUBLIC
 LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
         Filter filter = Filter::DEFAULT);
 
+/**
+ * Multithreaded variants of resampleImage. Rows are filtered in parallel using the given job
+ * system, and the calling thread must have been adopted by it. The result is bit-identical to the
+ * single-threaded variants: every output sample accumulates its source samples in the same order
+ * regardless of how the rows are split.
+ *
+ * Note that builds using -ffast-math may contract the multiply-adds differently from one release
+ * to the next; results are then only guaranteed to be within a few ULPs of previous versions.
+ */
+UTILS_PUBLIC
+LinearImage resampleImage(utils::JobSystem& js, const LinearImage& source, uint32_t width,
+        uint32_t height, const ImageSampler& sampler);
+
+UTILS_PUBLIC
+LinearImage resampleImage(utils::JobSystem& js, const LinearImage& source, uint32_t width,
+        uint32_t height, Filter filter = Filter::DEFAULT);
+
+/**
+ * Streaming variants of resampleImage, for images that are too large to be held in memory.
+ *
+ * Source rows are pulled from the reader and target rows are pushed to the writer as soon as they
+ * are complete; the dimensions of the result are those of the writer, which must have as many
+ * channels as the reader. Only the source rows covered by the vertical extent of the filter are
+ * kept in memory (horizontally resampled), so the memory footprint does not depend on the height
+ * of the images. The result is identical to the in-memory variants.
+ *
+ * Returns false if the reader or the writer reported an error.
+ */
+UTILS_PUBLIC
+bool resampleImage(ScanlineReader& source, ScanlineWriter& target, const ImageSampler& sampler);
+
+UTILS_PUBLIC
+bool resampleImage(ScanlineReader& source, ScanlineWriter& target,
+        Filter filter = Filter::DEFAULT);
+
 /**
  * Computes a single sample for the given texture coordinate and writes the resulting color
  * components into the given output holder.
@@ -145,6 +187,26 @@ void computeSingleSample(const LinearImage& source, float x, float y, SingleSamp
 UTILS_PUBLIC
 void generateMipmaps(const LinearImage& source, Filter, LinearImage* result, uint32_t mipCount);
 
+/**
+ * Multithreaded variant of generateMipmaps. Miplevels are generated concurrently, and each of them
+ * is resampled with the multithreaded resampleImage. The calling thread must have been adopted by
+ * the job system.
+ */
+UTILS_PUBLIC
+void generateMipmaps(utils::JobSystem& js, const LinearImage& source, Filter,
+        LinearImage* result, uint32_t mipCount);
+
+/**
+ * Streaming variant of generateMipmaps. The source is read once, and each of its rows is fed to
+ * the resamplers of all the levels, so that all the miplevels are produced in a single pass over
+ * the source. result[n] receives the level n + 1, and must have its dimensions.
+ *
+ * Returns false if the reader or one of the writers reported an error.
+ */
+UTILS_PUBLIC
+bool generateMipmaps(ScanlineReader& source, Filter, ScanlineWriter* const* result,
+        uint32_t mipCount);
+
 /**
  * Returns the number of miplevels it would take to downsample the given image down to 1x1. This
  * number does not include the original image (i.e. mip 0).
@@ -152,6 +214,9 @@ void generateMipmaps(const LinearImage& source, Filter, LinearImage* result, uin
 UTILS_PUBLIC
 uint32_t getMipmapCount(const LinearImage& source);
 
+UTILS_PUBLIC
+uint32_t getMipmapCount(uint32_t width, uint32_t height);
+
 /**
  * Given the string name of a filter, converts it to uppercase and returns the corresponding
  * enum value. If no corresponding enumerant exists, returns DEFAULT.
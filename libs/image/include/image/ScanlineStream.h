@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IMAGE_SCANLINESTREAM_H
+#define IMAGE_SCANLINESTREAM_H
+
+#include <image/LinearImage.h>
+
+#include <utils/compiler.h>
+
+#include <cstdint>
+
+namespace image {
+
+/**
+ * ScanlineReader is a source of image rows, consumed from top to bottom.
+ *
+ * Together with ScanlineWriter, it lets the streaming variants of the image filters process
+ * images that are too large to be held in memory as a whole: only the few rows covered by the
+ * filter footprint are kept around at any given time.
+ *
+ * Rows use the same layout as LinearImage, i.e. each row is made of width * channels
+ * interleaved floats.
+ */
+class UTILS_PUBLIC ScanlineReader {
+public:
+    ScanlineReader(uint32_t width, uint32_t height, uint32_t channels) noexcept;
+    virtual ~ScanlineReader();
+
+    ScanlineReader(const ScanlineReader&) = delete;
+    ScanlineReader& operator=(const ScanlineReader&) = delete;
+
+    /**
+     * Reads the next "count" rows into "rows", which must be large enough to hold them.
+     * Returns false if the rows could not be read, or if there are fewer than "count" rows left.
+     */
+    bool read(float* rows, uint32_t count);
+
+    uint32_t getWidth() const noexcept { return mWidth; }
+    uint32_t getHeight() const noexcept { return mHeight; }
+    uint32_t getChannels() const noexcept { return mChannels; }
+
+    /**
+     * Number of rows that have not been read yet.
+     */
+    uint32_t getRemainingRows() const noexcept { return mHeight - mRow; }
+
+protected:
+    /**
+     * Implementations read "count" rows, which are guaranteed to be available.
+     */
+    virtual bool readRows(float* rows, uint32_t count) = 0;
+
+private:
+    uint32_t mWidth;
+    uint32_t mHeight;
+    uint32_t mChannels;
+    uint32_t mRow = 0;
+};
+
+/**
+ * ScanlineWriter is a sink of image rows, produced from top to bottom.
+ *
+ * The image is complete once its last row has been written, so implementations that need to
+ * finalize their output (e.g. an encoder writing a trailer) do so when they receive it.
+ */
+class UTILS_PUBLIC ScanlineWriter {
+public:
+    ScanlineWriter(uint32_t width, uint32_t height, uint32_t channels) noexcept;
+    virtual ~ScanlineWriter();
+
+    ScanlineWriter(const ScanlineWriter&) = delete;
+    ScanlineWriter& operator=(const ScanlineWriter&) = delete;
+
+    /**
+     * Writes the next "count" rows.
+     * Returns false if the rows could not be written, or if that would overflow the image.
+     */
+    bool write(float const* rows, uint32_t count);
+
+    uint32_t getWidth() const noexcept { return mWidth; }
+    uint32_t getHeight() const noexcept { return mHeight; }
+    uint32_t getChannels() const noexcept { return mChannels; }
+
+    /**
+     * Number of rows that have not been written yet.
+     */
+    uint32_t getRemainingRows() const noexcept { return mHeight - mRow; }
+
+protected:
+    /**
+     * Implementations write "count" rows, which are guaranteed to fit in the image. The last row
+     * is part of the call for which getRemainingRows() equals "count".
+     */
+    virtual bool writeRows(float const* rows, uint32_t count) = 0;
+
+private:
+    uint32_t mWidth;
+    uint32_t mHeight;
+    uint32_t mChannels;
+    uint32_t mRow = 0;
+};
+
+/**
+ * Reads the rows of an in-memory image.
+ */
+class UTILS_PUBLIC LinearImageReader : public ScanlineReader {
+public:
+    explicit LinearImageReader(const LinearImage& image) noexcept;
+    ~LinearImageReader() override;
+
+private:
+    bool readRows(float* rows, uint32_t count) override;
+    LinearImage mImage;
+    float const* mCurrent;
+};
+
+/**
+ * Collects rows into an in-memory image, which is allocated upfront.
+ */
+class UTILS_PUBLIC LinearImageWriter : public ScanlineWriter {
+public:
+    LinearImageWriter(uint32_t width, uint32_t height, uint32_t channels);
+    ~LinearImageWriter() override;
+
+    /**
+     * Returns the image, which is complete once all the rows have been written.
+     */
+    LinearImage const& getImage() const noexcept { return mImage; }
+
+private:
+    bool writeRows(float const* rows, uint32_t count) override;
+    LinearImage mImage;
+    float* mCurrent;
+};
+
+} // namespace image
+
+#endif // IMAGE_SCANLINESTREAM_H
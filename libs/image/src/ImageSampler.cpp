@@ -15,14 +15,18 @@
  */
 
 #include <image/ImageSampler.h>
-#include <image/ImageOps.h>
+#include <image/ScanlineStream.h>
 
 #include <math/scalar.h>
 #include <math/vec3.h>
 #include <math/vec4.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 
+#include <algorithm>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -33,6 +37,7 @@ using namespace image;
 namespace {
 
 using namespace filament::math;
+using namespace utils;
 
 struct FilterFunction {
     float (*fn)(float) = nullptr;
@@ -134,6 +139,10 @@ void generateMadProgram(uint32_t ntarget, uint32_t nsource, float left, float ri
     // than necessary.
     const float filterBounds = domainScale * std::abs(filter.boundingRadius);
 
+    // The bounds above ignore the source range and are usually much wider than the actual
+    // support of the filter, which is the range of source samples that can get a non-zero weight.
+    const float filterSupport = std::abs(filter.boundingRadius) / domainScale;
+
     // Iterate through target samples. "xtarget" points to the center of each target pixel.
     float xtarget = dtarget / 2.0f;
     for (uint32_t itarget = 0; itarget < ntarget; ++itarget, xtarget += dtarget) {
@@ -144,8 +153,23 @@ void generateMadProgram(uint32_t ntarget, uint32_t nsource, float left, float ri
         float sum = 0;
 
         // Iterate through source samples that lie within the bounded region.
-        const auto isource_lower = int32_t((xtarget - filterBounds) * nsource);
-        const auto isource_upper = int32_t(std::ceil((xtarget + filterBounds) * nsource));
+        auto isource_lower = int32_t((xtarget - filterBounds) * nsource);
+        auto isource_upper = int32_t(std::ceil((xtarget + filterBounds) * nsource));
+
+        // Skip the samples that are outside of the filter support, they would get a zero weight.
+        // The support is mapped to source indices and padded by one sample to absorb rounding.
+        if (filterSupport > 0) {
+            const float ulower = left + (xtarget - filterSupport) * (right - left);
+            const float uupper = left + (xtarget + filterSupport) * (right - left);
+            isource_lower = std::max(isource_lower,
+                    int32_t(std::floor(std::min(ulower, uupper) * nsource)) - 1);
+            isource_upper = std::min(isource_upper,
+                    int32_t(std::ceil(std::max(ulower, uupper) * nsource)) + 1);
+        }
+        if (filter.rejectExternalSamples) {
+            isource_lower = std::max(isource_lower, 0);
+            isource_upper = std::min(isource_upper, int32_t(nsource) - 1);
+        }
         for (int32_t isource = isource_lower; isource <= isource_upper; ++isource) {
             const float xsource = (((isource + 0.5f) / nsource) - left) / (right - left);
             const bool outside_image = isource < 0 || isource >= int32_t(nsource);
@@ -172,22 +196,122 @@ void generateMadProgram(uint32_t ntarget, uint32_t nsource, float left, float ri
     }
 }
 
-// Transforms a MAD program intended for single-channel data into a program intended for
-// multi-channel data.
-void expandMadProgram(uint32_t nchannels, MadProgram* program) {
-    if (nchannels == 1) {
-        return;
+// A MAD program rearranged for execution: the taps of each target sample are stored contiguously,
+// as parallel arrays of source indices and weights. The taps are kept in the order in which
+// generateMadProgram emitted them, so every target sample accumulates its sources in the same
+// order as a sequential execution of the program, regardless of how the rows are split across
+// threads. This keeps the multithreaded result bit-identical to the single-threaded one.
+struct FilterKernel {
+    std::vector<uint32_t> offsets;  // ntarget + 1 entries, indexing sources and weights
+    std::vector<int32_t> sources;
+    std::vector<float> weights;
+};
+
+FilterKernel compileMadProgram(uint32_t ntarget, MadProgram const& program) {
+    FilterKernel kernel;
+    kernel.offsets.resize(ntarget + 1, 0);
+    kernel.sources.reserve(program.size());
+    kernel.weights.reserve(program.size());
+    // generateMadProgram emits instructions sorted by target index
+    for (auto const& mad : program) {
+        kernel.offsets[mad.targetIndex + 1]++;
+        kernel.sources.push_back(mad.sourceIndex);
+        kernel.weights.push_back(mad.weight);
+    }
+    for (uint32_t i = 0; i < ntarget; ++i) {
+        kernel.offsets[i + 1] += kernel.offsets[i];
+    }
+    return kernel;
+}
+
+// Accumulation operators for the filter kernels. MINIMUM is special because it starts with
+// non-zero values and ignores filter weights.
+struct MultiplyAdd {
+    static constexpr float INIT = 0.0f;
+    static float apply(float acc, float source, float weight) noexcept {
+        return acc + source * weight;
     }
-    MadProgram result;
-    result.reserve(program->size() * nchannels);
-    for (auto mad : *program) {
-        mad.sourceIndex *= nchannels;
-        mad.targetIndex *= nchannels;
-        for (uint32_t j = 0; j < nchannels; ++j, ++mad.sourceIndex, ++mad.targetIndex) {
-            result.push_back(mad);
+};
+
+struct Minimum {
+    static constexpr float INIT = std::numeric_limits<float>::max();
+    static float apply(float acc, float source, float) noexcept {
+        return std::min(source, acc);
+    }
+};
+
+// Filters a row of N interleaved channels. Fixing the channel count at compile time lets the
+// compiler keep a whole pixel in a SIMD register while iterating over the taps.
+template<typename Op, uint32_t N>
+void filterRow(float* UTILS_RESTRICT dst, float const* UTILS_RESTRICT src,
+        FilterKernel const& kernel, uint32_t ntarget) {
+    uint32_t const* const offsets = kernel.offsets.data();
+    int32_t const* const sources = kernel.sources.data();
+    float const* const weights = kernel.weights.data();
+    for (uint32_t t = 0; t < ntarget; ++t, dst += N) {
+        float acc[N];
+        for (uint32_t c = 0; c < N; ++c) {
+            acc[c] = Op::INIT;
+        }
+        for (uint32_t k = offsets[t], e = offsets[t + 1]; k < e; ++k) {
+            float const* const s = src + size_t(sources[k]) * N;
+            float const w = weights[k];
+            for (uint32_t c = 0; c < N; ++c) {
+                acc[c] = Op::apply(acc[c], s[c], w);
+            }
+        }
+        for (uint32_t c = 0; c < N; ++c) {
+            dst[c] = acc[c];
+        }
+    }
+}
+
+template<typename Op>
+void filterRow(float* UTILS_RESTRICT dst, float const* UTILS_RESTRICT src,
+        FilterKernel const& kernel, uint32_t ntarget, uint32_t nchan) {
+    switch (nchan) {
+        case 1: filterRow<Op, 1>(dst, src, kernel, ntarget); return;
+        case 2: filterRow<Op, 2>(dst, src, kernel, ntarget); return;
+        case 3: filterRow<Op, 3>(dst, src, kernel, ntarget); return;
+        case 4: filterRow<Op, 4>(dst, src, kernel, ntarget); return;
+        default: break;
+    }
+    uint32_t const* const offsets = kernel.offsets.data();
+    int32_t const* const sources = kernel.sources.data();
+    float const* const weights = kernel.weights.data();
+    for (uint32_t t = 0; t < ntarget; ++t, dst += nchan) {
+        std::fill_n(dst, nchan, Op::INIT);
+        for (uint32_t k = offsets[t], e = offsets[t + 1]; k < e; ++k) {
+            float const* const s = src + size_t(sources[k]) * nchan;
+            float const w = weights[k];
+            for (uint32_t c = 0; c < nchan; ++c) {
+                dst[c] = Op::apply(dst[c], s[c], w);
+            }
+        }
+    }
+}
+
+// Computes target row "t" from whole source rows, where rowAt(i) returns source row "i". The rows
+// are processed in tiles small enough for the partial sums to stay in L1, and the innermost loop
+// runs over contiguous floats.
+template<typename Op, typename RowAt>
+void filterColumns(float* UTILS_RESTRICT dst, RowAt const& rowAt, size_t rowSize,
+        FilterKernel const& kernel, uint32_t t) {
+    constexpr size_t TILE_SIZE = 1024;
+    uint32_t const begin = kernel.offsets[t];
+    uint32_t const end = kernel.offsets[t + 1];
+    for (size_t x0 = 0; x0 < rowSize; x0 += TILE_SIZE) {
+        size_t const n = std::min(TILE_SIZE, rowSize - x0);
+        float* const d = dst + x0;
+        std::fill_n(d, n, Op::INIT);
+        for (uint32_t k = begin; k < end; ++k) {
+            float const* const UTILS_RESTRICT s = rowAt(kernel.sources[k]) + x0;
+            float const w = kernel.weights[k];
+            for (size_t x = 0; x < n; ++x) {
+                d[x] = Op::apply(d[x], s[x], w);
+            }
         }
     }
-    program->swap(result);
 }
 
 FilterFunction createFilterFunction(Filter ftype) {
@@ -207,75 +331,310 @@ FilterFunction createFilterFunction(Filter ftype) {
     return fn;
 }
 
+Filter resolveFilter(Filter filter, uint32_t ntarget, uint32_t nsource) {
+    if (filter == Filter::DEFAULT) {
+        return ntarget > nsource ? Filter::MITCHELL : Filter::LANCZOS;
+    }
+    return filter;
+}
+
+FilterKernel createFilterKernel(uint32_t ntarget, uint32_t nsource, Filter filter,
+        float left, float right, float filterRadiusMultiplier) {
+    MadProgram program;
+    generateMadProgram(ntarget, nsource, left, right, createFilterFunction(filter),
+            filterRadiusMultiplier, &program);
+    return compileMadProgram(ntarget, program);
+}
+
 template <class VecT>
-void normalizeImpl(LinearImage& image) {
-    const uint32_t width = image.getWidth(), height = image.getHeight();
-    auto vecs = (VecT*) image.getPixelRef();
-    for (uint32_t n = 0; n < width * height; ++n) {
+void normalizeImpl(float* pixels, uint32_t count) {
+    auto vecs = (VecT*) pixels;
+    for (uint32_t n = 0; n < count; ++n) {
         vecs[n] = normalize(vecs[n]);
     }
 }
 
-void normalize(LinearImage& image) {
-    FILAMENT_CHECK_PRECONDITION(image.getChannels() == 3 || image.getChannels() == 4)
-            << "Must be a 3 or 4 channel image";
-    if (image.getChannels() == 3) {
-      normalizeImpl< filament::math::float3>(image);
+void normalize(float* pixels, uint32_t count, uint32_t nchan) {
+    if (nchan == 3) {
+      normalizeImpl< filament::math::float3>(pixels, count);
     } else {
-      normalizeImpl< filament::math::float4>(image);
+      normalizeImpl< filament::math::float4>(pixels, count);
     }
 }
 
-LinearImage resampleImage1D(const LinearImage& source, MadProgram* program,
-        uint32_t twidth, Filter filter, float left, float right, float filterRadiusMultiplier) {
+void checkNormalsFilter(Filter filter, uint32_t nchan) {
+    FILAMENT_CHECK_PRECONDITION(filter != Filter::GAUSSIAN_NORMALS || nchan == 3 || nchan == 4)
+            << "Must be a 3 or 4 channel image";
+}
+
+// Calls fn(first, count) over ranges of [0, count), using the job system if one is provided.
+// fn must be safe to call concurrently on disjoint ranges.
+template<typename F>
+void forEachRow(JobSystem* js, uint32_t count, F& fn) {
+    constexpr size_t ROWS_PER_JOB = 8;
+    if (!js || count < 2 * ROWS_PER_JOB) {
+        fn(0u, count);
+        return;
+    }
+    auto job = jobs::parallel_for(*js, nullptr, 0, count,
+            std::ref(fn), jobs::CountSplitter<ROWS_PER_JOB, 8>());
+    js->runAndWait(job);
+}
+
+// Resizes the image horizontally by executing the filter kernel over each row.
+LinearImage resampleHorizontal(JobSystem* js, const LinearImage& source, uint32_t twidth,
+        Filter filter, float left, float right, float filterRadiusMultiplier) {
     const uint32_t swidth = source.getWidth();
     const uint32_t sheight = source.getHeight();
     const uint32_t nchan = source.getChannels();
-    const bool mag = twidth > swidth;
-    if (filter == Filter::DEFAULT) filter = mag ? Filter::MITCHELL : Filter::LANCZOS;
-    const FilterFunction hfn = createFilterFunction(filter);
+    filter = resolveFilter(filter, twidth, swidth);
+    checkNormalsFilter(filter, nchan);
 
-    // Generate a flat list of multiply-add (MAD) instructions.
-    program->clear();
-    generateMadProgram(twidth, swidth, left, right, hfn, filterRadiusMultiplier, program);
-    expandMadProgram(nchan, program);
+    FilterKernel const kernel = createFilterKernel(twidth, swidth, filter, left, right,
+            filterRadiusMultiplier);
 
-    // Allocate the target image.
     LinearImage result(twidth, sheight, nchan);
-    float const* sourceRow = source.getPixelRef();
-    float* targetRow = result.getPixelRef();
-
-    // The MIN filter is special because it starts with non-zero values and ignores filter weights.
-    if (filter == Filter::MINIMUM) {
-        for (uint32_t n = 0; n < twidth * sheight * nchan; ++n) {
-            targetRow[n] = std::numeric_limits<float>::max();
+    float const* const src = source.getPixelRef();
+    float* const dst = result.getPixelRef();
+    auto rows = [&](uint32_t first, uint32_t count) {
+        for (uint32_t row = first; row < first + count; ++row) {
+            float* const targetRow = dst + size_t(row) * twidth * nchan;
+            float const* const sourceRow = src + size_t(row) * swidth * nchan;
+            if (filter == Filter::MINIMUM) {
+                filterRow<Minimum>(targetRow, sourceRow, kernel, twidth, nchan);
+            } else {
+                filterRow<MultiplyAdd>(targetRow, sourceRow, kernel, twidth, nchan);
+            }
+            if (filter == Filter::GAUSSIAN_NORMALS) {
+                normalize(targetRow, twidth, nchan);
+            }
         }
-        for (uint32_t row = 0; row < sheight; ++row) {
-            for (auto mad : *program) {
-                const float a = sourceRow[mad.sourceIndex];
-                const float b = targetRow[mad.targetIndex];
-                targetRow[mad.targetIndex] = std::min(a, b);
+    };
+    forEachRow(js, sheight, rows);
+    return result;
+}
+
+// Resizes the image vertically. This computes the same sums as resampling the transposed image
+// horizontally, in the same order, but without the two transpositions.
+LinearImage resampleVertical(JobSystem* js, const LinearImage& source, uint32_t theight,
+        Filter filter, float top, float bottom, float filterRadiusMultiplier) {
+    const uint32_t width = source.getWidth();
+    const uint32_t sheight = source.getHeight();
+    const uint32_t nchan = source.getChannels();
+    filter = resolveFilter(filter, theight, sheight);
+    checkNormalsFilter(filter, nchan);
+
+    FilterKernel const kernel = createFilterKernel(theight, sheight, filter, top, bottom,
+            filterRadiusMultiplier);
+
+    LinearImage result(width, theight, nchan);
+    size_t const rowSize = size_t(width) * nchan;
+    float const* const src = source.getPixelRef();
+    float* const dst = result.getPixelRef();
+    auto rowAt = [src, rowSize](int32_t i) { return src + size_t(i) * rowSize; };
+    auto rows = [&](uint32_t first, uint32_t count) {
+        for (uint32_t row = first; row < first + count; ++row) {
+            float* const targetRow = dst + row * rowSize;
+            if (filter == Filter::MINIMUM) {
+                filterColumns<Minimum>(targetRow, rowAt, rowSize, kernel, row);
+            } else {
+                filterColumns<MultiplyAdd>(targetRow, rowAt, rowSize, kernel, row);
+            }
+            if (filter == Filter::GAUSSIAN_NORMALS) {
+                normalize(targetRow, width, nchan);
             }
-            targetRow += twidth * nchan;
-            sourceRow += swidth * nchan;
         }
-        return result;
+    };
+    forEachRow(js, theight, rows);
+    return result;
+}
+
+void checkBoundaries(const ImageSampler& sampler) {
+    FILAMENT_CHECK_PRECONDITION(sampler.east.mode == Boundary::EXCLUDE &&
+            sampler.north.mode == Boundary::EXCLUDE && sampler.west.mode == Boundary::EXCLUDE &&
+            sampler.south.mode == Boundary::EXCLUDE)
+            << "Not yet implemented.";
+}
+
+LinearImage resampleImageImpl(JobSystem* js, const LinearImage& source, uint32_t width,
+        uint32_t height, const ImageSampler& sampler) {
+    checkBoundaries(sampler);
+    const auto hfilter = sampler.horizontalFilter;
+    const auto vfilter = sampler.verticalFilter;
+    const float radius = sampler.filterRadiusMultiplier;
+    const float left = sampler.sourceRegion.left;
+    const float top = sampler.sourceRegion.top;
+    const float right = sampler.sourceRegion.right;
+    const float bottom = sampler.sourceRegion.bottom;
+    LinearImage result = resampleHorizontal(js, source, width, hfilter, left, right, radius);
+    return resampleVertical(js, result, height, vfilter, top, bottom, radius);
+}
+
+void generateMipmapsImpl(JobSystem* js, const LinearImage& source, Filter filter,
+        LinearImage* result, uint32_t mips) {
+    mips = std::min(mips, getMipmapCount(source));
+    uint32_t width = source.getWidth();
+    uint32_t height = source.getHeight();
+    if (!js) {
+        for (uint32_t n = 0; n < mips; ++n) {
+            width = std::max(width >> 1u, 1u);
+            height = std::max(height >> 1u, 1u);
+            result[n] = resampleImageImpl(nullptr, source, width, height, ImageSampler {
+                .horizontalFilter = filter,
+                .verticalFilter = filter
+            });
+        }
+        return;
+    }
+
+    // All levels are generated from the source image, so they are independent from each other.
+    // Because the filter footprint grows with the minification factor, each level costs roughly
+    // as much as the first one; the rows of each level are further split across jobs.
+    JobSystem::Job* parent = js->createJob();
+    for (uint32_t n = 0; n < mips; ++n) {
+        width = std::max(width >> 1u, 1u);
+        height = std::max(height >> 1u, 1u);
+        JobSystem::Job* level = jobs::createJob(*js, parent,
+                [js, &source, filter, width, height, dst = result + n]() {
+                    *dst = resampleImageImpl(js, source, width, height, ImageSampler {
+                        .horizontalFilter = filter,
+                        .verticalFilter = filter
+                    });
+                });
+        js->run(level);
     }
+    js->runAndWait(parent);
+}
 
-    // Resize the image horizontally by executing the MAD instructions over each row.
-    for (uint32_t row = 0; row < sheight; ++row) {
-        for (auto mad : *program) {
-            targetRow[mad.targetIndex] += sourceRow[mad.sourceIndex] * mad.weight;
+// Resamples a stream of source rows into a ScanlineWriter. Each source row is resized horizontally
+// as soon as it is pushed, into a ring of rows that is just large enough to hold the vertical
+// footprint of the filter, and target rows are written as soon as their last tap is available.
+// The kernels are the ones used by resampleHorizontal and resampleVertical, and their taps are
+// accumulated in the same order, so the result is identical to the in-memory one.
+class StreamingResampler {
+public:
+    StreamingResampler(uint32_t swidth, uint32_t sheight, ScanlineWriter& target,
+            const ImageSampler& sampler);
+
+    // Adds the next source row, returns false if the writer failed.
+    bool push(float const* sourceRow);
+
+private:
+    // Number of target rows handed to the writer at once.
+    static constexpr uint32_t OUTPUT_ROWS = 16;
+
+    ScanlineWriter& mTarget;
+    Filter mHorizontalFilter;
+    Filter mVerticalFilter;
+    FilterKernel mHorizontalKernel;
+    FilterKernel mVerticalKernel;
+    std::vector<int32_t> mLastSource;   // for each target row, the source row completing it
+    std::vector<float> mRing;           // horizontally resampled source rows
+    std::vector<float> mOutput;         // target rows not yet written
+    size_t mRowSize;
+    uint32_t mRingSize = 1;
+    uint32_t mOutputCapacity;
+    uint32_t mOutputRows = 0;
+    uint32_t mNextTarget = 0;
+    int32_t mNextSource = 0;
+};
+
+StreamingResampler::StreamingResampler(uint32_t swidth, uint32_t sheight,
+        ScanlineWriter& target, const ImageSampler& sampler)
+        : mTarget(target),
+          mRowSize(size_t(target.getWidth()) * target.getChannels()),
+          mOutputCapacity(std::min(OUTPUT_ROWS, target.getHeight())) {
+    checkBoundaries(sampler);
+    uint32_t const twidth = target.getWidth();
+    uint32_t const theight = target.getHeight();
+    uint32_t const nchan = target.getChannels();
+    float const radius = sampler.filterRadiusMultiplier;
+    mHorizontalFilter = resolveFilter(sampler.horizontalFilter, twidth, swidth);
+    mVerticalFilter = resolveFilter(sampler.verticalFilter, theight, sheight);
+    checkNormalsFilter(mHorizontalFilter, nchan);
+    checkNormalsFilter(mVerticalFilter, nchan);
+    mHorizontalKernel = createFilterKernel(twidth, swidth, mHorizontalFilter,
+            sampler.sourceRegion.left, sampler.sourceRegion.right, radius);
+    mVerticalKernel = createFilterKernel(theight, sheight, mVerticalFilter,
+            sampler.sourceRegion.top, sampler.sourceRegion.bottom, radius);
+
+    // Target rows are written in order, so a row is complete once the last tap of all the rows up
+    // to and including it has been pushed. At that point, the ring must still hold its first tap.
+    mLastSource.resize(theight);
+    int32_t last = -1;
+    for (uint32_t t = 0; t < theight; ++t) {
+        int32_t first = std::numeric_limits<int32_t>::max();
+        for (uint32_t k = mVerticalKernel.offsets[t]; k < mVerticalKernel.offsets[t + 1]; ++k) {
+            first = std::min(first, mVerticalKernel.sources[k]);
+            last = std::max(last, mVerticalKernel.sources[k]);
+        }
+        mLastSource[t] = last;
+        if (first <= last) {
+            mRingSize = std::max(mRingSize, uint32_t(last - first + 1));
         }
-        targetRow += twidth * nchan;
-        sourceRow += swidth * nchan;
     }
+    mRing.resize(mRingSize * mRowSize);
+    mOutput.resize(mOutputCapacity * mRowSize);
+}
 
-    // Perform post processing for the current pass.
-    if (filter == Filter::GAUSSIAN_NORMALS) {
-        normalize(result);
+bool StreamingResampler::push(float const* sourceRow) {
+    uint32_t const twidth = mTarget.getWidth();
+    uint32_t const theight = mTarget.getHeight();
+    uint32_t const nchan = mTarget.getChannels();
+    int32_t const current = mNextSource++;
+    float* const row = mRing.data() + size_t(current % mRingSize) * mRowSize;
+    if (mHorizontalFilter == Filter::MINIMUM) {
+        filterRow<Minimum>(row, sourceRow, mHorizontalKernel, twidth, nchan);
+    } else {
+        filterRow<MultiplyAdd>(row, sourceRow, mHorizontalKernel, twidth, nchan);
     }
-    return result;
+    if (mHorizontalFilter == Filter::GAUSSIAN_NORMALS) {
+        normalize(row, twidth, nchan);
+    }
+
+    float const* const ring = mRing.data();
+    auto rowAt = [ring, ringSize = mRingSize, rowSize = mRowSize](int32_t i) {
+        return ring + size_t(uint32_t(i) % ringSize) * rowSize;
+    };
+    while (mNextTarget < theight && mLastSource[mNextTarget] <= current) {
+        float* const targetRow = mOutput.data() + mOutputRows * mRowSize;
+        if (mVerticalFilter == Filter::MINIMUM) {
+            filterColumns<Minimum>(targetRow, rowAt, mRowSize, mVerticalKernel, mNextTarget);
+        } else {
+            filterColumns<MultiplyAdd>(targetRow, rowAt, mRowSize, mVerticalKernel, mNextTarget);
+        }
+        if (mVerticalFilter == Filter::GAUSSIAN_NORMALS) {
+            normalize(targetRow, twidth, nchan);
+        }
+        ++mNextTarget;
+        if (++mOutputRows == mOutputCapacity || mNextTarget == theight) {
+            if (!mTarget.write(mOutput.data(), mOutputRows)) {
+                return false;
+            }
+            mOutputRows = 0;
+        }
+    }
+    return true;
+}
+
+// Reads the whole source in bands and calls fn(row) for each of its rows, in order. Stops as
+// soon as the reader or fn fail.
+template<typename F>
+bool forEachSourceRow(ScanlineReader& source, F const& fn) {
+    constexpr uint32_t BAND_ROWS = 16;
+    size_t const rowSize = size_t(source.getWidth()) * source.getChannels();
+    std::vector<float> band(BAND_ROWS * rowSize);
+    while (uint32_t const count = std::min(BAND_ROWS, source.getRemainingRows())) {
+        if (!source.read(band.data(), count)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!fn(band.data() + i * rowSize)) {
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
 } // anonymous namespace
@@ -288,22 +647,7 @@ SingleSample::~SingleSample() {
 
 LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
         const ImageSampler& sampler) {
-    FILAMENT_CHECK_PRECONDITION(sampler.east.mode == Boundary::EXCLUDE &&
-            sampler.north.mode == Boundary::EXCLUDE && sampler.west.mode == Boundary::EXCLUDE &&
-            sampler.south.mode == Boundary::EXCLUDE)
-            << "Not yet implemented.";
-    const auto hfilter = sampler.horizontalFilter;
-    const auto vfilter = sampler.verticalFilter;
-    const float radius = sampler.filterRadiusMultiplier;
-    const float left = sampler.sourceRegion.left;
-    const float top = sampler.sourceRegion.top;
-    const float right = sampler.sourceRegion.right;
-    const float bottom = sampler.sourceRegion.bottom;
-    MadProgram program;
-    LinearImage result;
-    result = transpose(resampleImage1D(source, &program, width, hfilter, left, right, radius));
-    result = transpose(resampleImage1D(result, &program, height, vfilter, top, bottom, radius));
-    return result;
+    return resampleImageImpl(nullptr, source, width, height, sampler);
 }
 
 LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
@@ -314,6 +658,35 @@ LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t he
     });
 }
 
+LinearImage resampleImage(utils::JobSystem& js, const LinearImage& source, uint32_t width,
+        uint32_t height, const ImageSampler& sampler) {
+    return resampleImageImpl(&js, source, width, height, sampler);
+}
+
+LinearImage resampleImage(utils::JobSystem& js, const LinearImage& source, uint32_t width,
+        uint32_t height, Filter filter) {
+    return resampleImage(js, source, width, height, ImageSampler {
+        .horizontalFilter = filter,
+        .verticalFilter = filter
+    });
+}
+
+bool resampleImage(ScanlineReader& source, ScanlineWriter& target, const ImageSampler& sampler) {
+    FILAMENT_CHECK_PRECONDITION(source.getChannels() == target.getChannels())
+            << "The source and target must have the same number of channels.";
+    StreamingResampler resampler(source.getWidth(), source.getHeight(), target, sampler);
+    return forEachSourceRow(source, [&resampler](float const* row) {
+        return resampler.push(row);
+    });
+}
+
+bool resampleImage(ScanlineReader& source, ScanlineWriter& target, Filter filter) {
+    return resampleImage(source, target, ImageSampler {
+        .horizontalFilter = filter,
+        .verticalFilter = filter
+    });
+}
+
 void computeSingleSample(const LinearImage& source, float x, float y, SingleSample* result,
         Filter filter) {
     const float radius = 1.0f;
@@ -321,9 +694,8 @@ void computeSingleSample(const LinearImage& source, float x, float y, SingleSamp
     const float top = y - radius / source.getHeight();
     const float right = x + radius / source.getWidth();
     const float bottom = y + radius / source.getHeight();
-    MadProgram program;
-    LinearImage row = transpose(resampleImage1D(source, &program, 1, filter, left, right, radius));
-    row = resampleImage1D(row, &program, 1, filter, top, bottom, radius);
+    LinearImage row = resampleHorizontal(nullptr, source, 1, filter, left, right, radius);
+    row = resampleVertical(nullptr, row, 1, filter, top, bottom, radius);
     if (!result->data) {
         result->data = new float[source.getChannels()];
     }
@@ -338,19 +710,51 @@ void computeSingleSample(const LinearImage& source, float x, float y, SingleSamp
 // Unlike traditional mipmap generation, our implementation generates all levels from the original
 // image, under the premise that this produces a higher quality result.
 void generateMipmaps(const LinearImage& source, Filter filter, LinearImage* result, uint32_t mips) {
-    mips = std::min(mips, getMipmapCount(source));
-    uint32_t width = source.getWidth();
-    uint32_t height = source.getHeight();
+    generateMipmapsImpl(nullptr, source, filter, result, mips);
+}
+
+void generateMipmaps(utils::JobSystem& js, const LinearImage& source, Filter filter,
+        LinearImage* result, uint32_t mips) {
+    generateMipmapsImpl(&js, source, filter, result, mips);
+}
+
+bool generateMipmaps(ScanlineReader& source, Filter filter, ScanlineWriter* const* result,
+        uint32_t mips) {
+    uint32_t const swidth = source.getWidth();
+    uint32_t const sheight = source.getHeight();
+    mips = std::min(mips, getMipmapCount(swidth, sheight));
+    std::vector<StreamingResampler> levels;
+    levels.reserve(mips);
+    uint32_t width = swidth;
+    uint32_t height = sheight;
     for (uint32_t n = 0; n < mips; ++n) {
         width = std::max(width >> 1u, 1u);
         height = std::max(height >> 1u, 1u);
-        result[n] = resampleImage(source, width, height, filter);
+        ScanlineWriter& target = *result[n];
+        FILAMENT_CHECK_PRECONDITION(target.getWidth() == width && target.getHeight() == height &&
+                target.getChannels() == source.getChannels())
+                << "Miplevel " << n + 1 << " must be " << width << "x" << height << " with "
+                << source.getChannels() << " channels.";
+        levels.emplace_back(swidth, sheight, target, ImageSampler {
+            .horizontalFilter = filter,
+            .verticalFilter = filter
+        });
     }
+    return forEachSourceRow(source, [&levels](float const* row) {
+        for (auto& level : levels) {
+            if (!level.push(row)) {
+                return false;
+            }
+        }
+        return true;
+    });
 }
 
 uint32_t getMipmapCount(const LinearImage& source) {
-    uint32_t width = source.getWidth();
-    uint32_t height = source.getHeight();
+    return getMipmapCount(source.getWidth(), source.getHeight());
+}
+
+uint32_t getMipmapCount(uint32_t width, uint32_t height) {
     uint32_t count = 0;
     while (width > 1 || height > 1) {
         ++count;
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <image/ScanlineStream.h>
+
+#include <cstring>
+
+namespace image {
+
+ScanlineReader::ScanlineReader(uint32_t width, uint32_t height, uint32_t channels) noexcept
+        : mWidth(width), mHeight(height), mChannels(channels) {
+}
+
+ScanlineReader::~ScanlineReader() = default;
+
+bool ScanlineReader::read(float* rows, uint32_t count) {
+    if (count > getRemainingRows()) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+    if (!readRows(rows, count)) {
+        return false;
+    }
+    mRow += count;
+    return true;
+}
+
+ScanlineWriter::ScanlineWriter(uint32_t width, uint32_t height, uint32_t channels) noexcept
+        : mWidth(width), mHeight(height), mChannels(channels) {
+}
+
+ScanlineWriter::~ScanlineWriter() = default;
+
+bool ScanlineWriter::write(float const* rows, uint32_t count) {
+    if (count > getRemainingRows()) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+    if (!writeRows(rows, count)) {
+        return false;
+    }
+    mRow += count;
+    return true;
+}
+
+LinearImageReader::LinearImageReader(const LinearImage& image) noexcept
+        : ScanlineReader(image.getWidth(), image.getHeight(), image.getChannels()),
+          mImage(image), mCurrent(image.getPixelRef()) {
+}
+
+LinearImageReader::~LinearImageReader() = default;
+
+bool LinearImageReader::readRows(float* rows, uint32_t count) {
+    size_t const size = size_t(getWidth()) * getChannels() * count;
+    memcpy(rows, mCurrent, size * sizeof(float));
+    mCurrent += size;
+    return true;
+}
+
+LinearImageWriter::LinearImageWriter(uint32_t width, uint32_t height, uint32_t channels)
+        : ScanlineWriter(width, height, channels),
+          mImage(width, height, channels), mCurrent(mImage.getPixelRef()) {
+}
+
+LinearImageWriter::~LinearImageWriter() = default;
+
+bool LinearImageWriter::writeRows(float const* rows, uint32_t count) {
+    size_t const size = size_t(getWidth()) * getChannels() * count;
+    memcpy(mCurrent, rows, size * sizeof(float));
+    mCurrent += size;
+    return true;
+}
+
+} // namespace image
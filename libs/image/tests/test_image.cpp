@@ -19,6 +19,7 @@
 #include <image/ImageOps.h>
 #include <image/ImageSampler.h>
 #include <image/LinearImage.h>
+#include <image/ScanlineStream.h>
 
 #include <imageio/ImageDecoder.h>
 #include <imageio/ImageDiffer.h>
@@ -26,13 +27,19 @@
 
 #include <gtest/gtest.h>
 
+#include "TemporaryDirectoryTest.h"
+
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 #include <utils/Path.h>
 
 #include <math/vec3.h>
 #include <math/vec4.h>
 
+#include <algorithm>
 #include <fstream>
+#include <iterator>
+#include <memory>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -48,6 +55,7 @@ using filament::math::float4;
 using namespace image;
 
 class ImageTest : public testing::Test {};
+class ImageDifferTest : public TemporaryDirectoryTest {};
 
 static ComparisonMode g_comparisonMode;
 static utils::Path g_comparisonPath;
@@ -76,6 +84,9 @@ static void updateOrCompare(const LinearImage& limg, const utils::Path& fname);
 // Subtracts two images, does an abs(), then normalizes such that min/max transform to 0/1.
 static LinearImage diffImages(const LinearImage& a, const LinearImage& b);
 
+// Returns true if two images have the same dimensions and exactly the same pixels.
+static bool isIdentical(const LinearImage& a, const LinearImage& b);
+
 TEST_F(ImageTest, LuminanceFilters) { // NOLINT
     auto tiny = createGrayFromAscii("000 010 000");
     ASSERT_EQ(tiny.getWidth(), 3);
@@ -362,6 +373,223 @@ TEST_F(ImageTest, Mipmaps) { // NOLINT
     }
 }
 
+TEST_F(ImageTest, Multithreaded) { // NOLINT
+    utils::JobSystem js;
+    js.adopt();
+
+    // The multithreaded resampler must produce the exact same result, with every filter.
+    const LinearImage normals = createNormalMap(256);
+    const Filter filters[] = { Filter::DEFAULT, Filter::BOX, Filter::NEAREST, Filter::HERMITE,
+            Filter::GAUSSIAN_SCALARS, Filter::GAUSSIAN_NORMALS, Filter::MITCHELL,
+            Filter::LANCZOS, Filter::MINIMUM };
+    for (Filter filter : filters) {
+        EXPECT_TRUE(isIdentical(resampleImage(normals, 100, 37, filter),
+                resampleImage(js, normals, 100, 37, filter)));
+        EXPECT_TRUE(isIdentical(resampleImage(normals, 301, 512, filter),
+                resampleImage(js, normals, 301, 512, filter)));
+
+        const uint32_t count = getMipmapCount(normals);
+        vector<LinearImage> expected(count);
+        vector<LinearImage> mips(count);
+        generateMipmaps(normals, filter, expected.data(), count);
+        generateMipmaps(js, normals, filter, mips.data(), count);
+        for (uint32_t index = 0; index < count; ++index) {
+            EXPECT_TRUE(isIdentical(expected[index], mips[index]));
+        }
+    }
+
+    // Also check a source region and a blur, which exercise the filter bounds.
+    ImageSampler sampler;
+    sampler.horizontalFilter = sampler.verticalFilter = Filter::GAUSSIAN_SCALARS;
+    sampler.sourceRegion = {0, 0.25f, 0.25f, 0.5f};
+    sampler.filterRadiusMultiplier = 20;
+    EXPECT_TRUE(isIdentical(resampleImage(normals, 100, 100, sampler),
+            resampleImage(js, normals, 100, 100, sampler)));
+
+    js.emancipate();
+}
+
+TEST_F(ImageTest, Streaming) { // NOLINT
+    // Resampling a stream of rows must produce the exact same result as the in-memory resampler,
+    // when minifying and magnifying.
+    const LinearImage normals = createNormalMap(256);
+    const Filter filters[] = { Filter::DEFAULT, Filter::BOX, Filter::NEAREST, Filter::HERMITE,
+            Filter::GAUSSIAN_SCALARS, Filter::GAUSSIAN_NORMALS, Filter::MITCHELL,
+            Filter::LANCZOS, Filter::MINIMUM };
+    for (Filter filter : filters) {
+        for (auto [width, height] : { std::pair{ 100u, 37u }, std::pair{ 301u, 512u } }) {
+            LinearImageReader reader(normals);
+            LinearImageWriter writer(width, height, normals.getChannels());
+            EXPECT_TRUE(resampleImage(reader, writer, filter));
+            EXPECT_EQ(writer.getRemainingRows(), 0);
+            EXPECT_TRUE(isIdentical(resampleImage(normals, width, height, filter),
+                    writer.getImage()));
+        }
+
+        const uint32_t count = getMipmapCount(normals);
+        vector<LinearImage> expected(count);
+        generateMipmaps(normals, filter, expected.data(), count);
+        vector<std::unique_ptr<LinearImageWriter>> writers;
+        vector<ScanlineWriter*> levels;
+        for (const LinearImage& level : expected) {
+            writers.emplace_back(new LinearImageWriter(level.getWidth(), level.getHeight(),
+                    level.getChannels()));
+            levels.push_back(writers.back().get());
+        }
+        LinearImageReader reader(normals);
+        EXPECT_TRUE(generateMipmaps(reader, filter, levels.data(), count));
+        for (uint32_t index = 0; index < count; ++index) {
+            EXPECT_TRUE(isIdentical(expected[index], writers[index]->getImage()));
+        }
+    }
+
+    // A wide filter footprint needs a deeper ring of rows.
+    ImageSampler sampler;
+    sampler.horizontalFilter = sampler.verticalFilter = Filter::GAUSSIAN_SCALARS;
+    sampler.sourceRegion = {0, 0.25f, 0.25f, 0.5f};
+    sampler.filterRadiusMultiplier = 20;
+    LinearImageReader reader(normals);
+    LinearImageWriter writer(100, 100, normals.getChannels());
+    EXPECT_TRUE(resampleImage(reader, writer, sampler));
+    EXPECT_TRUE(isIdentical(resampleImage(normals, 100, 100, sampler), writer.getImage()));
+
+    // Encoding rows as they come must produce the same file, and decoding it incrementally must
+    // produce the same image.
+    auto copyRows = [](ScanlineReader& source, ScanlineWriter& target) {
+        vector<float> rows(source.getWidth() * source.getChannels() * 10);
+        while (uint32_t count = std::min(10u, source.getRemainingRows())) {
+            if (!source.read(rows.data(), count) || !target.write(rows.data(), count)) {
+                return false;
+            }
+        }
+        return target.getRemainingRows() == 0;
+    };
+    std::ostringstream expectedPng;
+    std::ostringstream streamedPng;
+    const LinearImage colors = vectorsToColors(normals);
+    ASSERT_TRUE(ImageEncoder::encode(expectedPng, ImageEncoder::Format::PNG, colors, "", ""));
+    std::unique_ptr<ScanlineWriter> encoder = ImageEncoder::createWriter(streamedPng,
+            ImageEncoder::Format::PNG, colors.getWidth(), colors.getHeight(),
+            colors.getChannels(), "", "");
+    ASSERT_TRUE(encoder);
+    LinearImageReader colorReader(colors);
+    EXPECT_TRUE(copyRows(colorReader, *encoder));
+    EXPECT_EQ(expectedPng.str(), streamedPng.str());
+
+    std::istringstream expectedStream(expectedPng.str());
+    std::istringstream streamedStream(expectedPng.str());
+    const LinearImage decoded = ImageDecoder::decode(expectedStream, "test.png");
+    std::unique_ptr<ScanlineReader> decoder = ImageDecoder::createReader(streamedStream,
+            "test.png");
+    ASSERT_TRUE(decoder);
+    LinearImageWriter decodedWriter(decoder->getWidth(), decoder->getHeight(),
+            decoder->getChannels());
+    EXPECT_TRUE(copyRows(*decoder, decodedWriter));
+    EXPECT_TRUE(isIdentical(decoded, decodedWriter.getImage()));
+}
+
+TEST_F(ImageTest, ParallelEncoding) { // NOLINT
+    utils::JobSystem js;
+    js.adopt();
+
+    // Large enough to be split into several bands.
+    const LinearImage colors = vectorsToColors(createNormalMap(512));
+
+    // PNG bands are compressed differently, but must decode to the same pixels.
+    for (auto format : { ImageEncoder::Format::PNG, ImageEncoder::Format::PNG_LINEAR,
+            ImageEncoder::Format::RGBM }) {
+        std::ostringstream expectedPng;
+        std::ostringstream parallelPng;
+        ASSERT_TRUE(ImageEncoder::encode(expectedPng, format, colors, "", ""));
+        ASSERT_TRUE(ImageEncoder::encode(js, parallelPng, format, colors, "", ""));
+        std::istringstream expectedStream(expectedPng.str());
+        std::istringstream parallelStream(parallelPng.str());
+        EXPECT_TRUE(isIdentical(ImageDecoder::decode(expectedStream, "test.png"),
+                ImageDecoder::decode(parallelStream, "test.png")));
+    }
+
+    // HDR scanlines are compressed independently, the files must be identical.
+    std::ostringstream expectedHdr;
+    std::ostringstream parallelHdr;
+    ASSERT_TRUE(ImageEncoder::encode(expectedHdr, ImageEncoder::Format::HDR, colors, "", ""));
+    ASSERT_TRUE(ImageEncoder::encode(js, parallelHdr, ImageEncoder::Format::HDR, colors, "", ""));
+    EXPECT_EQ(expectedHdr.str(), parallelHdr.str());
+
+    // Batches must produce the same images as encoding and decoding them one by one.
+    std::ostringstream encoded[4];
+    ImageEncoder::Request encodeRequests[4];
+    for (size_t i = 0; i < 4; i++) {
+        encodeRequests[i] = { &encoded[i],
+                i % 2 ? ImageEncoder::Format::HDR : ImageEncoder::Format::PNG,
+                resampleImage(colors, 64 << i, 32 << i), "", "" };
+    }
+    EXPECT_TRUE(ImageEncoder::encode(js, encodeRequests, 4));
+
+    std::istringstream streams[4];
+    ImageDecoder::Request decodeRequests[4];
+    for (size_t i = 0; i < 4; i++) {
+        EXPECT_TRUE(encodeRequests[i].result);
+        streams[i].str(encoded[i].str());
+        decodeRequests[i].stream = &streams[i];
+        decodeRequests[i].sourceName = "test";
+    }
+    ImageDecoder::decode(js, decodeRequests, 4);
+
+    for (size_t i = 0; i < 4; i++) {
+        std::ostringstream expected;
+        ASSERT_TRUE(ImageEncoder::encode(expected, encodeRequests[i].format,
+                encodeRequests[i].image, "", ""));
+        std::istringstream expectedStream(expected.str());
+        EXPECT_TRUE(isIdentical(ImageDecoder::decode(expectedStream, "test"),
+                decodeRequests[i].image));
+    }
+
+    js.emancipate();
+}
+
+TEST_F(ImageDifferTest, Batched) { // NOLINT
+    utils::JobSystem js;
+    js.adopt();
+
+    // A few images of different sizes, formats and channel counts.
+    LinearImage const src = resampleImage(createColorFromAscii("12"), 200, 100, Filter::NEAREST);
+    uint32_t const count = getMipmapCount(src);
+    vector<LinearImage> mips(count);
+    generateMipmaps(src, Filter::HERMITE, mips.data(), count);
+    vector<Comparison> comparisons;
+    for (uint32_t index = 0; index < count; ++index) {
+        comparisons.push_back({ mips[index],
+                mRoot + ("mip" + std::to_string(index) + (index % 2 ? ".rgbm" : ".png")) });
+    }
+    comparisons.push_back({ createGrayFromAscii("01 10 11"), mRoot + "grays.png" });
+
+    // The batch writes the same golden images as updating them one by one.
+    updateOrCompare(js, comparisons.data(), comparisons.size(), ComparisonMode::UPDATE, 0.0f);
+    ASSERT_TRUE((mRoot + "single").mkdir());
+    for (Comparison const& comparison : comparisons) {
+        utils::Path const single = mRoot + "single" + comparison.golden.getName();
+        updateOrCompare(comparison.result, single, ComparisonMode::UPDATE, 0.0f);
+        std::ifstream expected(single, std::ios::binary);
+        std::ifstream actual(comparison.golden, std::ios::binary);
+        ASSERT_TRUE(expected && actual) << comparison.golden;
+        EXPECT_TRUE(std::equal(std::istreambuf_iterator<char>(expected), {},
+                std::istreambuf_iterator<char>(actual), {})) << comparison.golden;
+    }
+
+    // The results match their golden images, up to quantization.
+    constexpr float epsilon = 0.01f;
+    updateOrCompare(js, comparisons.data(), comparisons.size(), ComparisonMode::COMPARE, epsilon);
+
+#ifdef __EXCEPTIONS
+    // Any mismatch is reported.
+    comparisons[2].result = resampleImage(comparisons[2].result, 7, 7, Filter::NEAREST);
+    EXPECT_THROW(updateOrCompare(js, comparisons.data(), comparisons.size(),
+            ComparisonMode::COMPARE, epsilon), utils::PreconditionPanic);
+#endif
+
+    js.emancipate();
+}
+
 TEST_F(ImageTest, Ktx) { // NOLINT
     uint8_t foo[] = {1, 2, 3};
     uint8_t* data;
@@ -692,3 +920,10 @@ static LinearImage diffImages(const LinearImage& a, const LinearImage& b) {
     }
     return result;
 }
+
+static bool isIdentical(const LinearImage& a, const LinearImage& b) {
+    const size_t size = a.getWidth() * a.getHeight() * a.getChannels();
+    return a.getWidth() == b.getWidth() && a.getHeight() == b.getHeight() &&
+            a.getChannels() == b.getChannels() &&
+            std::equal(a.getPixelRef(), a.getPixelRef() + size, b.getPixelRef());
+}
@@ -26,6 +26,9 @@ public:
     static HDRDecoder* create(std::istream& stream);
     static bool checkSignature(char const* buf);
 
+    // Returns a reader that decodes the scanlines as they are read, or nullptr on error.
+    static std::unique_ptr<ScanlineReader> createReader(std::istream& stream);
+
     HDRDecoder(const HDRDecoder&) = delete;
     HDRDecoder& operator=(const HDRDecoder&) = delete;
 
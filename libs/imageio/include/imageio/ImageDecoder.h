@@ -18,12 +18,20 @@
 #define IMAGE_IMAGEDECODER_H_
 
 #include <iosfwd>
+#include <memory>
 #include <string>
 
 #include <image/LinearImage.h>
+#include <image/ScanlineStream.h>
 
 #include <utils/compiler.h>
 
+#include <stddef.h>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace image {
 
 class UTILS_PUBLIC ImageDecoder {
@@ -37,6 +45,25 @@ public:
     static LinearImage decode(std::istream& stream, const std::string& sourceName,
             ColorSpace sourceSpace = ColorSpace::SRGB);
 
+    // One image of a batch, see decode(utils::JobSystem&, Request*, size_t).
+    struct Request {
+        std::istream* stream = nullptr;
+        std::string sourceName;
+        ColorSpace sourceSpace = ColorSpace::SRGB;
+        LinearImage image;          // set by decode(), non-valid if an error occured
+    };
+
+    // Decodes a batch of images concurrently, each from its own stream, using the JobSystem.
+    // The calling thread must be a thread of the JobSystem, or adopted by it.
+    static void decode(utils::JobSystem& js, Request* requests, size_t count);
+
+    // Returns a reader that produces the same linear floating-point data as decode(), or nullptr
+    // if an error occured. Non-interlaced PNG and HDR images are decoded incrementally, as their
+    // rows are read, which keeps the memory footprint independent of the image height. Other
+    // images are decoded as a whole when the reader is created.
+    static std::unique_ptr<ScanlineReader> createReader(std::istream& stream,
+            const std::string& sourceName, ColorSpace sourceSpace = ColorSpace::SRGB);
+
     class Decoder {
     public:
         virtual LinearImage decode() = 0;
@@ -18,6 +18,12 @@
 
 #include <utils/Path.h>
 
+#include <stddef.h>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace image {
 
 enum class ComparisonMode {
@@ -31,4 +37,16 @@ enum class ComparisonMode {
 // The passed-in image is the "result image" and the expected image is the "golden image".
 void updateOrCompare(LinearImage result, const utils::Path& golden, ComparisonMode, float epsilon);
 
+// A result image and the path of its golden image.
+struct Comparison {
+    LinearImage result;
+    utils::Path golden;
+};
+
+// Same as updateOrCompare() for a batch of images, which are encoded, or decoded and compared,
+// concurrently using the JobSystem. The first mismatch is reported once all the images are
+// processed. The calling thread must be a thread of the JobSystem, or adopted by it.
+void updateOrCompare(utils::JobSystem& js, Comparison* comparisons, size_t count, ComparisonMode,
+        float epsilon);
+
 }  // namespace image
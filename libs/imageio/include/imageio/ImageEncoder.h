@@ -18,12 +18,20 @@
 #define IMAGE_IMAGEENCODER_H_
 
 #include <iosfwd>
+#include <memory>
 #include <string>
 
 #include <image/LinearImage.h>
+#include <image/ScanlineStream.h>
 
 #include <utils/compiler.h>
 
+#include <stddef.h>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace image {
 
 class UTILS_PUBLIC ImageEncoder {
@@ -49,12 +57,42 @@ public:
     static bool encode(std::ostream& stream, Format format, const LinearImage& image,
             const std::string& compression, const std::string& destName);
 
+    // Same as above, but spreads the encoding of the image across the JobSystem: PNG formats are
+    // filtered and compressed by bands of rows, and HDR scanlines are compressed independently.
+    // The output decodes to the same pixels. Other formats are encoded on the calling thread.
+    // The calling thread must be a thread of the JobSystem, or adopted by it.
+    static bool encode(utils::JobSystem& js, std::ostream& stream, Format format,
+            const LinearImage& image, const std::string& compression, const std::string& destName);
+
+    // One image of a batch, see encode(utils::JobSystem&, Request*, size_t).
+    struct Request {
+        std::ostream* stream = nullptr;
+        Format format = Format::PNG;
+        LinearImage image;
+        std::string compression;
+        std::string destName;
+        bool result = false;        // set by encode()
+    };
+
+    // Encodes a batch of images concurrently, each into its own stream. Returns true if all the
+    // images were encoded, the result of each of them is stored in its Request.
+    static bool encode(utils::JobSystem& js, Request* requests, size_t count);
+
+    // Returns a writer that encodes the linear floating-point rows it receives, or nullptr if
+    // unable to encode. PNG formats (PNG, PNG_LINEAR, RGBM and RGB_10_11_11_REV) are encoded
+    // incrementally, as rows are written, so that the image is never held in memory as a whole.
+    // Other formats are buffered, and encoded when the last row is written.
+    static std::unique_ptr<ScanlineWriter> createWriter(std::ostream& stream, Format format,
+            uint32_t width, uint32_t height, uint32_t channels,
+            const std::string& compression, const std::string& destName);
+
     static Format chooseFormat(const std::string& name, bool forceLinear = false);
     static std::string chooseExtension(Format format);
 
     class Encoder {
     public:
         virtual bool encode(const LinearImage& image) = 0;
+        virtual bool encode(utils::JobSystem&, const LinearImage& image) { return encode(image); }
         virtual ~Encoder() = default;
     };
 };
@@ -16,7 +16,7 @@
 
 #include <imageio/HDRDecoder.h>
 
-#include <image/ImageOps.h>
+#include <image/ScanlineStream.h>
 
 #include <math/vec3.h>
 
@@ -58,7 +58,17 @@ HDRDecoder::HDRDecoder(std::istream& stream)
 
 HDRDecoder::~HDRDecoder() = default;
 
-LinearImage HDRDecoder::decode() {
+namespace {
+
+struct HDRHeader {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool rle = false;
+};
+
+// Parses the header up to the resolution string, and checks whether the scanlines that follow are
+// run-length encoded.
+HDRHeader readHeader(std::istream& stream) {
     float gamma;
     float exposure;
     char sy, sx;
@@ -67,7 +77,7 @@ LinearImage HDRDecoder::decode() {
         char buf[1024];
         do {
             char format[128];
-            mStream.getline(buf, sizeof(buf), 0xa);
+            stream.getline(buf, sizeof(buf), 0xa);
             if (buf[0] == '#') continue;
             sscanf(buf, "FORMAT=%127s", format); // NOLINT
             sscanf(buf, "GAMMA=%f", &gamma); // NOLINT
@@ -78,94 +88,147 @@ LinearImage HDRDecoder::decode() {
             }
         } while (true);
     }
-    LinearImage image(width, height, 3);
 
-    if (sx == '-') image = (image);
-    if (sy == '+') image = verticalFlip(image);
+    // Test for non-RLE images.
+    uint8_t rgbe[3] = {};
+    const auto pos = stream.tellg();
+    stream.read((char*) rgbe, 3);
+    stream.seekg(pos);
 
-    // Allocate memory to hold one row of decoded pixel data.
-    std::unique_ptr<uint8_t[]> rgbe(new uint8_t[width * 4]);
-
-    // First, test for non-RLE images.
-    const auto pos = mStream.tellg();
-    mStream.read((char*) rgbe.get(), 3);
-    mStream.seekg(pos);
-
-    if (rgbe[0] != 0x2 || rgbe[1] != 0x2 || (rgbe[2] & 0x80) || width < 8 || width > 32767) {
-        for (uint32_t y = 0; y < height; y++) {
-            filament::math::float3* dst = reinterpret_cast<filament::math::float3*>(image.getPixelRef(0, y));
-            mStream.read((char*) rgbe.get(), width * 4);
-            // (rgb/256) * 2^(e-128)
-            size_t pixel = 0;
-            for (size_t x = 0; x < width; x++, pixel += 4) {
-                if (rgbe[pixel + 3] == 0.0f) {
-                    dst[x] = filament::math::float3{0.0f};
-                } else {
-                    filament::math::float3 v(rgbe[pixel], rgbe[pixel + 1], rgbe[pixel + 2]);
-                    dst[x] = (v + 0.5f) * std::ldexp(1.0f, rgbe[pixel + 3] - (128 + 8));
-                }
+    HDRHeader header;
+    header.width = width;
+    header.height = height;
+    header.rle = !(rgbe[0] != 0x2 || rgbe[1] != 0x2 || (rgbe[2] & 0x80) ||
+            width < 8 || width > 32767);
+    return header;
+}
+
+// Decodes the next scanline into dst. rgbe must hold width * 4 bytes.
+bool readScanline(std::istream& stream, HDRHeader const& header, uint8_t* rgbe,
+        filament::math::float3* dst) {
+    const uint32_t width = header.width;
+    if (!header.rle) {
+        stream.read((char*) rgbe, width * 4);
+        // (rgb/256) * 2^(e-128)
+        size_t pixel = 0;
+        for (size_t x = 0; x < width; x++, pixel += 4) {
+            if (rgbe[pixel + 3] == 0.0f) {
+                dst[x] = filament::math::float3{0.0f};
+            } else {
+                filament::math::float3 v(rgbe[pixel], rgbe[pixel + 1], rgbe[pixel + 2]);
+                dst[x] = (v + 0.5f) * std::ldexp(1.0f, rgbe[pixel + 3] - (128 + 8));
             }
         }
-    } else {
-        for (uint32_t y = 0; y < height; y++) {
-            uint16_t magic;
-            mStream.read((char*) &magic, 2);
-            if (magic != 0x0202) {
-                slog.e << "invalid scanline (magic)" << io::endl;
-                return {};
-            }
+        return true;
+    }
 
-            uint16_t w;
-            mStream.read((char*) &w, 2);
-            if (ntohs(w) != width) {
-                slog.e << "invalid scanline (width)" << io::endl;
-                return {};
-            }
+    uint16_t magic;
+    stream.read((char*) &magic, 2);
+    if (magic != 0x0202) {
+        slog.e << "invalid scanline (magic)" << io::endl;
+        return false;
+    }
+
+    uint16_t w;
+    stream.read((char*) &w, 2);
+    if (ntohs(w) != width) {
+        slog.e << "invalid scanline (width)" << io::endl;
+        return false;
+    }
 
-            char* d = (char*) rgbe.get();
-            for (size_t p = 0; p < 4; p++) {
-                size_t num_bytes = 0;
-                while (num_bytes < width) {
-                    uint8_t rle_count;
-                    mStream.read((char*) &rle_count, 1);
-                    if (rle_count > 128) {
-                        char v;
-                        mStream.read(&v, 1);
-                        memset(d, v, size_t(rle_count - 128));
-                        d += rle_count - 128;
-                        num_bytes += rle_count - 128;
-                    } else {
-                        if (rle_count == 0) {
-                            slog.e << "run length is zero" << io::endl;
-                            return {};
-                        }
-                        mStream.read(d, rle_count);
-                        d += rle_count;
-                        num_bytes += rle_count;
-                    }
+    char* d = (char*) rgbe;
+    for (size_t p = 0; p < 4; p++) {
+        size_t num_bytes = 0;
+        while (num_bytes < width) {
+            uint8_t rle_count;
+            stream.read((char*) &rle_count, 1);
+            if (rle_count > 128) {
+                char v;
+                stream.read(&v, 1);
+                memset(d, v, size_t(rle_count - 128));
+                d += rle_count - 128;
+                num_bytes += rle_count - 128;
+            } else {
+                if (rle_count == 0) {
+                    slog.e << "run length is zero" << io::endl;
+                    return false;
                 }
+                stream.read(d, rle_count);
+                d += rle_count;
+                num_bytes += rle_count;
             }
+        }
+    }
 
-            uint8_t const* r = &rgbe[0];
-            uint8_t const* g = &rgbe[width];
-            uint8_t const* b = &rgbe[2 * width];
-            uint8_t const* e = &rgbe[3 * width];
-            filament::math::float3* dst = reinterpret_cast<filament::math::float3*>(image.getPixelRef(0, y));
-            // (rgb/256) * 2^(e-128)
-            for (size_t x = 0; x < width; x++, r++, g++, b++, e++) {
-                if (e[0] == 0.0f) {
-                    dst[x] = filament::math::float3{0.0f};
-                } else {
-                    filament::math::float3 v(r[0], g[0], b[0]);
-                    dst[x] = (v + 0.5f) * std::ldexp(1.0f, e[0] - (128 + 8));
-                }
+    uint8_t const* r = &rgbe[0];
+    uint8_t const* g = &rgbe[width];
+    uint8_t const* b = &rgbe[2 * width];
+    uint8_t const* e = &rgbe[3 * width];
+    // (rgb/256) * 2^(e-128)
+    for (size_t x = 0; x < width; x++, r++, g++, b++, e++) {
+        if (e[0] == 0.0f) {
+            dst[x] = filament::math::float3{0.0f};
+        } else {
+            filament::math::float3 v(r[0], g[0], b[0]);
+            dst[x] = (v + 0.5f) * std::ldexp(1.0f, e[0] - (128 + 8));
+        }
+    }
+    return true;
+}
+
+// Decodes the scanlines as they are read, so that only one row of RGBE data is held in memory.
+class HDRScanlineReader : public ScanlineReader {
+public:
+    HDRScanlineReader(std::istream& stream, HDRHeader const& header)
+            : ScanlineReader(header.width, header.height, 3),
+              mStream(stream), mHeader(header), mRGBE(new uint8_t[header.width * 4]) {
+    }
+
+private:
+    bool readRows(float* rows, uint32_t count) override {
+        for (uint32_t y = 0; y < count; y++) {
+            auto* dst = reinterpret_cast<filament::math::float3*>(rows) + size_t(y) * getWidth();
+            if (!readScanline(mStream, mHeader, mRGBE.get(), dst) || mStream.fail()) {
+                return false;
             }
         }
+        return true;
+    }
+
+    std::istream& mStream;
+    HDRHeader mHeader;
+    std::unique_ptr<uint8_t[]> mRGBE;
+};
+
+} // anonymous namespace
+
+LinearImage HDRDecoder::decode() {
+    // Scanlines are returned in the order in which they are stored, regardless of the orientation
+    // given by the resolution string.
+    HDRHeader const header = readHeader(mStream);
+    LinearImage image(header.width, header.height, 3);
+
+    // Allocate memory to hold one row of decoded pixel data.
+    std::unique_ptr<uint8_t[]> rgbe(new uint8_t[header.width * 4]);
+
+    for (uint32_t y = 0; y < header.height; y++) {
+        auto* dst = reinterpret_cast<filament::math::float3*>(image.getPixelRef(0, y));
+        if (!readScanline(mStream, header, rgbe.get(), dst)) {
+            return {};
+        }
     }
 
     return image;
 }
 
+std::unique_ptr<ScanlineReader> HDRDecoder::createReader(std::istream& stream) {
+    HDRHeader const header = readHeader(stream);
+    if (!stream) {
+        return nullptr;
+    }
+    return std::make_unique<HDRScanlineReader>(stream, header);
+}
+
 #ifdef IMAGEIO_LITE
 
 LinearImage ImageDecoder::decode(std::istream& stream, const std::string& sourceName,
@@ -196,6 +259,18 @@ LinearImage ImageDecoder::decode(std::istream& stream, const std::string& source
     return decoder->decode();
 }
 
+std::unique_ptr<ScanlineReader> ImageDecoder::createReader(std::istream& stream,
+        const std::string&, ColorSpace) {
+    std::streampos pos = stream.tellg();
+    char buf[16];
+    stream.read(buf, sizeof(buf));
+    stream.seekg(pos);
+    if (HDRDecoder::checkSignature(buf)) {
+        return HDRDecoder::createReader(stream);
+    }
+    return nullptr;
+}
+
 #endif
 
 } // namespace image
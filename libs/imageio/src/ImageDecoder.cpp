@@ -18,6 +18,8 @@
 
 #include <imageio/ImageDecoder.h>
 
+#include "ParallelFor.h"
+
 #include <cstdint>
 #include <cstring> // for memcmp
 #include <iostream> // for cerr
@@ -45,6 +47,8 @@
 #include <image/ColorTransform.h>
 #include <image/ImageOps.h>
 
+#include <utils/JobSystem.h>
+
 #include <imageio/HDRDecoder.h>
 
 namespace image {
@@ -61,11 +65,19 @@ private:
     explicit PNGDecoder(std::istream& stream);
     ~PNGDecoder() override;
 
+    friend class PNGScanlineReader;
+
     void init();
 
     // ImageDecoder::Decoder interface
     LinearImage decode() override;
 
+    // Reads the header and sets up the transformations to 16-bit RGB or RGBA.
+    void readInfo();
+
+    // Converts rows of 16-bit data, as returned by libpng, to linear floats.
+    LinearImage toLinearImage(uint8_t const* data, uint32_t rows) const;
+
     static void cb_error(png_structp, png_const_charp);
     static void cb_stream(png_structp png, png_bytep buffer, png_size_t size);
 
@@ -76,6 +88,28 @@ private:
     png_infop mInfo = nullptr;
     std::istream& mStream;
     std::streampos mStreamStartPos;
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    size_t mRowBytes = 0;
+    int mColorType = 0;
+};
+
+// Decodes the rows of a non-interlaced PNG image as they are read.
+class PNGScanlineReader : public ScanlineReader {
+public:
+    // Returns nullptr if the header cannot be read or if the image is interlaced.
+    static std::unique_ptr<ScanlineReader> create(std::istream& stream,
+            ImageDecoder::ColorSpace sourceSpace);
+
+    PNGScanlineReader(std::unique_ptr<ImageDecoder::Decoder> decoder, PNGDecoder& png);
+
+private:
+    bool readRows(float* rows, uint32_t count) override;
+
+    std::unique_ptr<ImageDecoder::Decoder> mOwner;
+    PNGDecoder& mDecoder;
+    std::unique_ptr<uint8_t[]> mRowData;
+    uint32_t mRowDataSize = 0;
 };
 
 // -----------------------------------------------------------------------------------------------
@@ -171,6 +205,39 @@ LinearImage ImageDecoder::decode(std::istream& stream, const std::string& source
     return decoder->decode();
 }
 
+void ImageDecoder::decode(utils::JobSystem& js, Request* requests, size_t count) {
+    parallelFor(js, uint32_t(count), [requests](uint32_t i) {
+        Request& request = requests[i];
+        request.image = decode(*request.stream, request.sourceName, request.sourceSpace);
+    });
+}
+
+std::unique_ptr<ScanlineReader> ImageDecoder::createReader(std::istream& stream,
+        const std::string& sourceName, ColorSpace sourceSpace) {
+    std::streampos pos = stream.tellg();
+    char buf[16];
+    stream.read(buf, sizeof(buf));
+    stream.seekg(pos);
+
+    if (PNGDecoder::checkSignature(buf)) {
+        std::unique_ptr<ScanlineReader> reader = PNGScanlineReader::create(stream, sourceSpace);
+        if (reader) {
+            return reader;
+        }
+        // interlaced images need all their passes to produce a row
+        stream.clear();
+        stream.seekg(pos);
+    } else if (HDRDecoder::checkSignature(buf)) {
+        return HDRDecoder::createReader(stream);
+    }
+
+    LinearImage image = decode(stream, sourceName, sourceSpace);
+    if (!image) {
+        return nullptr;
+    }
+    return std::make_unique<LinearImageReader>(image);
+}
+
 // -----------------------------------------------------------------------------------------------
 
 static inline float read32(std::istream& istream) {
@@ -212,80 +279,88 @@ PNGDecoder::~PNGDecoder() {
     png_destroy_read_struct(&mPNG, &mInfo, nullptr);
 }
 
-LinearImage PNGDecoder::decode() {
-    std::unique_ptr<uint8_t[]> imageData;
-    try {
-        mInfo = png_create_info_struct(mPNG);
-        png_read_info(mPNG, mInfo);
+void PNGDecoder::readInfo() {
+    mInfo = png_create_info_struct(mPNG);
+    png_read_info(mPNG, mInfo);
 
-        int colorType = png_get_color_type(mPNG, mInfo);
-        int bitDepth = png_get_bit_depth(mPNG, mInfo);
+    int colorType = png_get_color_type(mPNG, mInfo);
+    int bitDepth = png_get_bit_depth(mPNG, mInfo);
 
-        if (colorType == PNG_COLOR_TYPE_PALETTE) {
-            png_set_palette_to_rgb(mPNG);
-        }
-        if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA) {
-            if (bitDepth < 8) {
-                png_set_expand_gray_1_2_4_to_8(mPNG);
-            }
-            png_set_gray_to_rgb(mPNG);
+    if (colorType == PNG_COLOR_TYPE_PALETTE) {
+        png_set_palette_to_rgb(mPNG);
+    }
+    if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA) {
+        if (bitDepth < 8) {
+            png_set_expand_gray_1_2_4_to_8(mPNG);
         }
-        if (png_get_valid(mPNG, mInfo, PNG_INFO_tRNS)) {
-            png_set_tRNS_to_alpha(mPNG);
+        png_set_gray_to_rgb(mPNG);
+    }
+    if (png_get_valid(mPNG, mInfo, PNG_INFO_tRNS)) {
+        png_set_tRNS_to_alpha(mPNG);
+    }
+    if (getColorSpace() == ImageDecoder::ColorSpace::SRGB) {
+        double gamma = 1.0;
+        png_get_gAMA(mPNG, mInfo, &gamma);
+        if (gamma != 1.0) {
+            png_set_alpha_mode(mPNG, PNG_ALPHA_PNG, PNG_DEFAULT_sRGB);
         }
+    } else {
+        png_set_gamma_fixed(mPNG, PNG_FP_1, PNG_FP_1);
+        png_set_alpha_mode(mPNG, PNG_ALPHA_PNG, PNG_GAMMA_LINEAR);
+    }
+    if (bitDepth < 16) {
+        png_set_expand_16(mPNG);
+    }
+
+    png_read_update_info(mPNG, mInfo);
+
+    // Read updated color type since we may have asked for a conversion before
+    mColorType = png_get_color_type(mPNG, mInfo);
+
+    mWidth  = png_get_image_width(mPNG, mInfo);
+    mHeight = png_get_image_height(mPNG, mInfo);
+    mRowBytes = png_get_rowbytes(mPNG, mInfo);
+}
+
+LinearImage PNGDecoder::toLinearImage(uint8_t const* data, uint32_t rows) const {
+    if (mColorType == PNG_COLOR_TYPE_RGBA) {
         if (getColorSpace() == ImageDecoder::ColorSpace::SRGB) {
-            double gamma = 1.0;
-            png_get_gAMA(mPNG, mInfo, &gamma);
-            if (gamma != 1.0) {
-                png_set_alpha_mode(mPNG, PNG_ALPHA_PNG, PNG_DEFAULT_sRGB);
-            }
+            return toLinearWithAlpha<uint16_t>(mWidth, rows, mRowBytes, data,
+                    [](uint16_t v) -> uint16_t { return ntohs(v); },
+                    sRGBToLinear<filament::math::float4>);
         } else {
-            png_set_gamma_fixed(mPNG, PNG_FP_1, PNG_FP_1);
-            png_set_alpha_mode(mPNG, PNG_ALPHA_PNG, PNG_GAMMA_LINEAR);
+            return toLinearWithAlpha<uint16_t>(mWidth, rows, mRowBytes, data,
+                    [](uint16_t v) -> uint16_t { return ntohs(v); },
+                    [](const filament::math::float4& color) ->  filament::math::float4 { return color; });
         }
-        if (bitDepth < 16) {
-            png_set_expand_16(mPNG);
+    } else {
+        // Convert to linear float (PNG 16 stores data in network order (big endian).
+        if (getColorSpace() == ImageDecoder::ColorSpace::SRGB) {
+            return toLinear<uint16_t>(mWidth, rows, mRowBytes, data,
+                    [](uint16_t v) -> uint16_t { return ntohs(v); },
+                    sRGBToLinear< filament::math::float3>);
+        } else {
+            return toLinear<uint16_t>(mWidth, rows, mRowBytes, data,
+                    [](uint16_t v) -> uint16_t { return ntohs(v); },
+                    [](const filament::math::float3& color) ->  filament::math::float3 { return color; });
         }
+    }
+}
 
-        png_read_update_info(mPNG, mInfo);
-
-        // Read updated color type since we may have asked for a conversion before
-        colorType = png_get_color_type(mPNG, mInfo);
-
-        uint32_t width  = png_get_image_width(mPNG, mInfo);
-        uint32_t height = png_get_image_height(mPNG, mInfo);
-        size_t rowBytes = png_get_rowbytes(mPNG, mInfo);
+LinearImage PNGDecoder::decode() {
+    std::unique_ptr<uint8_t[]> imageData;
+    try {
+        readInfo();
 
-        imageData = std::make_unique<uint8_t[]>(height * rowBytes);
-        std::unique_ptr<png_bytep[]> rowPointers(new png_bytep[height]);
-        for (size_t y = 0 ; y < height ; y++) {
-            rowPointers[y] = &imageData[y * rowBytes];
+        imageData = std::make_unique<uint8_t[]>(mHeight * mRowBytes);
+        std::unique_ptr<png_bytep[]> rowPointers(new png_bytep[mHeight]);
+        for (size_t y = 0 ; y < mHeight ; y++) {
+            rowPointers[y] = &imageData[y * mRowBytes];
         }
         png_read_image(mPNG, rowPointers.get());
         png_read_end(mPNG, mInfo);
 
-        if (colorType == PNG_COLOR_TYPE_RGBA) {
-            if (getColorSpace() == ImageDecoder::ColorSpace::SRGB) {
-                return toLinearWithAlpha<uint16_t>(width, height, rowBytes, imageData,
-                        [](uint16_t v) -> uint16_t { return ntohs(v); },
-                        sRGBToLinear<filament::math::float4>);
-            } else {
-                return toLinearWithAlpha<uint16_t>(width, height, rowBytes, imageData,
-                        [](uint16_t v) -> uint16_t { return ntohs(v); },
-                        [](const filament::math::float4& color) ->  filament::math::float4 { return color; });
-            }
-        } else {
-            // Convert to linear float (PNG 16 stores data in network order (big endian).
-            if (getColorSpace() == ImageDecoder::ColorSpace::SRGB) {
-                return toLinear<uint16_t>(width, height, rowBytes, imageData,
-                        [](uint16_t v) -> uint16_t { return ntohs(v); },
-                        sRGBToLinear< filament::math::float3>);
-            } else {
-                return toLinear<uint16_t>(width, height, rowBytes, imageData,
-                        [](uint16_t v) -> uint16_t { return ntohs(v); },
-                        [](const filament::math::float3& color) ->  filament::math::float3 { return color; });
-            }
-        }
+        return toLinearImage(imageData.get(), mHeight);
     } catch(std::runtime_error& e) {
         // reset the stream, like we found it
         std::cerr << "Runtime error while decoding PNG: " << e.what() << std::endl;
@@ -318,6 +393,52 @@ void PNGDecoder::error() {
 
 // -----------------------------------------------------------------------------------------------
 
+std::unique_ptr<ScanlineReader> PNGScanlineReader::create(std::istream& stream,
+        ImageDecoder::ColorSpace sourceSpace) {
+    PNGDecoder* png = PNGDecoder::create(stream);
+    std::unique_ptr<ImageDecoder::Decoder> decoder(png);
+    decoder->setColorSpace(sourceSpace);
+    try {
+        png->readInfo();
+        if (png_get_interlace_type(png->mPNG, png->mInfo) != PNG_INTERLACE_NONE) {
+            return nullptr;
+        }
+    } catch(std::runtime_error& e) {
+        std::cerr << "Runtime error while decoding PNG: " << e.what() << std::endl;
+        return nullptr;
+    }
+    return std::make_unique<PNGScanlineReader>(std::move(decoder), *png);
+}
+
+PNGScanlineReader::PNGScanlineReader(std::unique_ptr<ImageDecoder::Decoder> decoder,
+        PNGDecoder& png)
+        : ScanlineReader(png.mWidth, png.mHeight, png.mColorType == PNG_COLOR_TYPE_RGBA ? 4 : 3),
+          mOwner(std::move(decoder)), mDecoder(png) {
+}
+
+bool PNGScanlineReader::readRows(float* rows, uint32_t count) {
+    if (mRowDataSize < count) {
+        mRowData = std::make_unique<uint8_t[]>(count * mDecoder.mRowBytes);
+        mRowDataSize = count;
+    }
+    try {
+        for (uint32_t y = 0; y < count; y++) {
+            png_read_row(mDecoder.mPNG, &mRowData[y * mDecoder.mRowBytes], nullptr);
+        }
+        if (count == getRemainingRows()) {
+            png_read_end(mDecoder.mPNG, mDecoder.mInfo);
+        }
+    } catch(std::runtime_error& e) {
+        std::cerr << "Runtime error while decoding PNG: " << e.what() << std::endl;
+        return false;
+    }
+    LinearImage const band = mDecoder.toLinearImage(mRowData.get(), count);
+    memcpy(rows, band.getPixelRef(), size_t(getWidth()) * getChannels() * count * sizeof(float));
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------
+
 const char PSDDecoder::sig[] = { '8', 'B', 'P', 'S', 0x0, 0x1, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0 };
 
 PSDDecoder* PSDDecoder::create(std::istream& stream) {
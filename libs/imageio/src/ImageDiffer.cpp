@@ -16,6 +16,8 @@
 
 #include <imageio/ImageDiffer.h>
 
+#include "ParallelFor.h"
+
 #include <image/ColorTransform.h>
 #include <image/ImageOps.h>
 #include <imageio/ImageDecoder.h>
@@ -23,10 +25,34 @@
 #include <utils/Panic.h>
 
 #include <fstream>
+#include <memory>
+#include <vector>
 
 namespace image {
 
+static ImageEncoder::Format getGoldenFormat(const utils::Path& fnameGolden) {
+    return fnameGolden.getExtension() == "rgbm" ?
+            ImageEncoder::Format::RGBM : ImageEncoder::Format::PNG_LINEAR;
+}
+
 // TODO: Remove special treatment of 1-channel data.
+static LinearImage expandResult(LinearImage limgResult) {
+    if (limgResult.getChannels() == 1) {
+        return combineChannels({limgResult, limgResult, limgResult});
+    }
+    return limgResult;
+}
+
+// Convert 4-channel RGBM into proper RGB.
+static LinearImage expandGolden(LinearImage limgGolden, const utils::Path& fnameGolden) {
+    if (fnameGolden.getExtension() == "rgbm" && limgGolden.getChannels() == 4) {
+        return toLinearFromRGBM(
+                reinterpret_cast< filament::math::float4 const*>(limgGolden.getPixelRef()),
+                limgGolden.getWidth(), limgGolden.getHeight());
+    }
+    return limgGolden;
+}
+
 void updateOrCompare(LinearImage limgResult, const utils::Path& fnameGolden,
         ComparisonMode mode, float epsilon) {
     if (mode == ComparisonMode::SKIP) {
@@ -36,38 +62,62 @@ void updateOrCompare(LinearImage limgResult, const utils::Path& fnameGolden,
     // Regenerate the PNG file at the given path.
     if (mode == ComparisonMode::UPDATE) {
         std::ofstream out(fnameGolden, std::ios::binary | std::ios::trunc);
-        auto format = ImageEncoder::Format::PNG_LINEAR;
-        if (fnameGolden.getExtension() == "rgbm") {
-            format = ImageEncoder::Format::RGBM;
-        }
-        if (limgResult.getChannels() != 1) {
-            ImageEncoder::encode(out, format, limgResult, "", fnameGolden);
-        } else {
-            auto limg2 = combineChannels({limgResult, limgResult, limgResult});
-            ImageEncoder::encode(out, format, limg2, "", fnameGolden);
-        }
+        ImageEncoder::encode(out, getGoldenFormat(fnameGolden), expandResult(limgResult), "",
+                fnameGolden);
         return;
     }
 
     // Load the PNG file at the given path.
     std::ifstream in(fnameGolden, std::ios::binary);
     FILAMENT_CHECK_PRECONDITION(in) << "Unable to open: " << fnameGolden.c_str();
-    LinearImage limgGolden = ImageDecoder::decode(in, fnameGolden);
+    LinearImage limgGolden = expandGolden(ImageDecoder::decode(in, fnameGolden), fnameGolden);
 
-    // Convert 4-channel RGBM into proper RGB.
-    if (fnameGolden.getExtension() == "rgbm" && limgGolden.getChannels() == 4) {
-        limgGolden = toLinearFromRGBM(
-                reinterpret_cast< filament::math::float4 const*>(limgGolden.getPixelRef()),
-                limgGolden.getWidth(), limgGolden.getHeight());
+    // Perform a simple comparison of the two images.
+    FILAMENT_CHECK_PRECONDITION(compare(expandResult(limgResult), limgGolden, epsilon) == 0)
+            << "Image mismatch.";
+}
+
+void updateOrCompare(utils::JobSystem& js, Comparison* comparisons, size_t count,
+        ComparisonMode mode, float epsilon) {
+    if (mode == ComparisonMode::SKIP || count == 0) {
+        return;
     }
 
-    // Expand the result image from L to RGB.
-    if (limgResult.getChannels() == 1) {
-        limgResult = combineChannels({limgResult, limgResult, limgResult});
+    // Regenerate the PNG files, the encoder can split each image into bands as well.
+    if (mode == ComparisonMode::UPDATE) {
+        std::unique_ptr<std::ofstream[]> out(new std::ofstream[count]);
+        std::vector<ImageEncoder::Request> requests(count);
+        for (size_t i = 0; i < count; i++) {
+            utils::Path const& fnameGolden = comparisons[i].golden;
+            out[i].open(fnameGolden, std::ios::binary | std::ios::trunc);
+            requests[i] = { &out[i], getGoldenFormat(fnameGolden),
+                    expandResult(comparisons[i].result), "", fnameGolden };
+        }
+        ImageEncoder::encode(js, requests.data(), count);
+        return;
     }
 
-    // Perform a simple comparison of the two images.
-    FILAMENT_CHECK_PRECONDITION(compare(limgResult, limgGolden, epsilon) == 0) << "Image mismatch.";
+    // Load the PNG files, the streams are opened first so that a missing golden fails early.
+    std::unique_ptr<std::ifstream[]> in(new std::ifstream[count]);
+    std::vector<ImageDecoder::Request> requests(count);
+    for (size_t i = 0; i < count; i++) {
+        utils::Path const& fnameGolden = comparisons[i].golden;
+        in[i].open(fnameGolden, std::ios::binary);
+        FILAMENT_CHECK_PRECONDITION(in[i]) << "Unable to open: " << fnameGolden.c_str();
+        requests[i] = { &in[i], fnameGolden };
+    }
+    ImageDecoder::decode(js, requests.data(), count);
+
+    // Compare concurrently too, but report on this thread.
+    std::unique_ptr<bool[]> identical(new bool[count]);
+    parallelFor(js, uint32_t(count), [&](uint32_t i) {
+        LinearImage const limgGolden = expandGolden(requests[i].image, comparisons[i].golden);
+        identical[i] = compare(expandResult(comparisons[i].result), limgGolden, epsilon) == 0;
+    });
+    for (size_t i = 0; i < count; i++) {
+        FILAMENT_CHECK_PRECONDITION(identical[i])
+                << "Image mismatch: " << comparisons[i].golden.c_str();
+    }
 }
 
 }
@@ -16,6 +16,8 @@
 
 #include <imageio/ImageEncoder.h>
 
+#include "ParallelFor.h"
+
 #include <algorithm>
 #include <cstdint>
 #include <cstring> // for memset
@@ -23,6 +25,9 @@
 #include <limits>
 #include <memory>
 #include <iostream> // for cerr
+#include <sstream>
+#include <string>
+#include <vector>
 
 #if defined(WIN32)
     #include <Winsock2.h>
@@ -35,11 +40,14 @@
 
 #include <tinyexr.h>
 
+#include <zlib.h>
+
 #include <math/half.h>
 #include <math/vec3.h>
 #include <math/vec4.h>
 
 #include <utils/compiler.h>
+#include <utils/JobSystem.h>
 
 #include <image/ColorTransform.h>
 
@@ -47,6 +55,10 @@ using namespace filament::math;
 
 namespace image {
 
+// Amount of pixel data encoded by each job when an image is encoded with a JobSystem. Bands are
+// compressed independently, so they must be large enough for the compression ratio not to suffer.
+static constexpr size_t BAND_SIZE = 256 * 1024;
+
 class PNGEncoder : public ImageEncoder::Encoder {
 public:
     enum class PixelFormat {
@@ -65,14 +77,33 @@ private:
     PNGEncoder(std::ostream& stream, PixelFormat format);
     ~PNGEncoder() override;
 
+    friend class PNGScanlineWriter;
+
     void init();
 
     // ImageEncoder::Encoder interface
     bool encode(const LinearImage& image) override;
+    bool encode(utils::JobSystem& js, const LinearImage& image) override;
 
-    int chooseColorType(const LinearImage& image) const;
+    bool checkChannels(uint32_t srcChannels) const;
+    int chooseColorType(uint32_t channels) const;
     uint32_t getChannelsCount(int colorType) const;
 
+    // Writes the header and computes the number of channels per pixel in the file.
+    void writeInfo(uint32_t width, uint32_t height, uint32_t srcChannels);
+
+    // Converts linear floats to the 8-bit pixels of the file.
+    std::unique_ptr<uint8_t[]> convert(const LinearImage& image) const;
+
+    // Filters a row with the filter type that libpng's heuristic would choose.
+    static void filterRow(uint8_t* UTILS_RESTRICT out, uint8_t const* UTILS_RESTRICT row,
+            uint8_t const* UTILS_RESTRICT prev, size_t size, size_t bpp);
+
+    // Compresses data[begin, end) into a raw deflate stream that continues the one of the
+    // preceding data.
+    static bool deflateBand(std::vector<uint8_t>& out, uint8_t const* data,
+            size_t begin, size_t end, bool last);
+
     static void cb_error(png_structp png, png_const_charp error);
     static void cb_stream(png_structp png, png_bytep buffer, png_size_t size);
 
@@ -85,6 +116,43 @@ private:
     std::streampos mStreamStartPos;
 
     PixelFormat mFormat;
+    uint32_t mDstChannels = 0;
+};
+
+// Encodes the rows of a PNG image as they are written.
+class PNGScanlineWriter : public ScanlineWriter {
+public:
+    // Returns nullptr if the header cannot be written.
+    static std::unique_ptr<ScanlineWriter> create(std::ostream& stream,
+            PNGEncoder::PixelFormat format, uint32_t width, uint32_t height, uint32_t channels);
+
+    PNGScanlineWriter(std::unique_ptr<ImageEncoder::Encoder> encoder, PNGEncoder& png,
+            uint32_t width, uint32_t height, uint32_t channels);
+
+private:
+    bool writeRows(float const* rows, uint32_t count) override;
+
+    std::unique_ptr<ImageEncoder::Encoder> mOwner;
+    PNGEncoder& mEncoder;
+};
+
+// Collects the rows of the formats that can't be encoded incrementally, and encodes the image
+// when its last row is written.
+class BufferedScanlineWriter : public ScanlineWriter {
+public:
+    BufferedScanlineWriter(std::ostream& stream, ImageEncoder::Format format,
+            uint32_t width, uint32_t height, uint32_t channels,
+            const std::string& compression, const std::string& destName);
+
+private:
+    bool writeRows(float const* rows, uint32_t count) override;
+
+    std::ostream& mStream;
+    ImageEncoder::Format mFormat;
+    std::string mCompression;
+    std::string mDestName;
+    LinearImage mImage;
+    float* mCurrent;
 };
 
 // ------------------------------------------------------------------------------------------------
@@ -102,6 +170,10 @@ private:
 
     // ImageEncoder::Encoder interface
     bool encode(const LinearImage& image) override;
+    bool encode(utils::JobSystem& js, const LinearImage& image) override;
+
+    void writeHeader(size_t width, size_t height);
+    static void encodeRows(std::ostream& out, const LinearImage& image, uint32_t y, uint32_t count);
 
     static void float2rgbe(uint8_t rgbe[4], const float3& in);
     static size_t countRepeats(uint8_t const* data, size_t length);
@@ -188,9 +260,10 @@ private:
 
 // ------------------------------------------------------------------------------------------------
 
-bool ImageEncoder::encode(std::ostream& stream, Format format, const LinearImage& image,
-        const std::string& compression, const std::string& destName) {
-    std::unique_ptr<Encoder> encoder;
+static std::unique_ptr<ImageEncoder::Encoder> createEncoder(std::ostream& stream,
+        ImageEncoder::Format format, const std::string& compression, const std::string& destName) {
+    using Format = ImageEncoder::Format;
+    std::unique_ptr<ImageEncoder::Encoder> encoder;
     switch(format) {
         case Format::PNG:
             encoder.reset(PNGEncoder::create(stream));
@@ -220,7 +293,50 @@ bool ImageEncoder::encode(std::ostream& stream, Format format, const LinearImage
             encoder.reset(DDSEncoder::create(stream, compression, DDSEncoder::PixelFormat::LINEAR_RGB));
             break;
     }
-    return encoder->encode(image);
+    return encoder;
+}
+
+bool ImageEncoder::encode(std::ostream& stream, Format format, const LinearImage& image,
+        const std::string& compression, const std::string& destName) {
+    return createEncoder(stream, format, compression, destName)->encode(image);
+}
+
+bool ImageEncoder::encode(utils::JobSystem& js, std::ostream& stream, Format format,
+        const LinearImage& image, const std::string& compression, const std::string& destName) {
+    return createEncoder(stream, format, compression, destName)->encode(js, image);
+}
+
+bool ImageEncoder::encode(utils::JobSystem& js, Request* requests, size_t count) {
+    // each image can itself be split into jobs
+    parallelFor(js, uint32_t(count), [&js, requests](uint32_t i) {
+        Request& request = requests[i];
+        request.result = encode(js, *request.stream, request.format, request.image,
+                request.compression, request.destName);
+    });
+    return std::all_of(requests, requests + count,
+            [](Request const& request) { return request.result; });
+}
+
+std::unique_ptr<ScanlineWriter> ImageEncoder::createWriter(std::ostream& stream, Format format,
+        uint32_t width, uint32_t height, uint32_t channels,
+        const std::string& compression, const std::string& destName) {
+    switch (format) {
+        case Format::PNG:
+            return PNGScanlineWriter::create(stream, PNGEncoder::PixelFormat::sRGB,
+                    width, height, channels);
+        case Format::PNG_LINEAR:
+            return PNGScanlineWriter::create(stream, PNGEncoder::PixelFormat::LINEAR_RGB,
+                    width, height, channels);
+        case Format::RGB_10_11_11_REV:
+            return PNGScanlineWriter::create(stream, PNGEncoder::PixelFormat::RGB_10_11_11_REV,
+                    width, height, channels);
+        case Format::RGBM:
+            return PNGScanlineWriter::create(stream, PNGEncoder::PixelFormat::RGBM,
+                    width, height, channels);
+        default:
+            return std::make_unique<BufferedScanlineWriter>(stream, format,
+                    width, height, channels, compression, destName);
+    }
 }
 
 ImageEncoder::Format ImageEncoder::chooseFormat(const std::string& name, bool forceLinear) {
@@ -293,8 +409,7 @@ void PNGEncoder::init() {
     png_set_write_fn(mPNG, this, cb_stream, nullptr);
 }
 
-int PNGEncoder::chooseColorType(const LinearImage& image) const {
-    size_t channels = image.getChannels();
+int PNGEncoder::chooseColorType(uint32_t channels) const {
     switch (channels) {
         case 1:
             return PNG_COLOR_TYPE_GRAY;
@@ -329,9 +444,7 @@ uint32_t PNGEncoder::getChannelsCount(int colorType) const {
     }
 }
 
-bool PNGEncoder::encode(const LinearImage& image) {
-    size_t srcChannels = image.getChannels();
-
+bool PNGEncoder::checkChannels(uint32_t srcChannels) const {
     switch (mFormat) {
         case PixelFormat::RGBM:
         case PixelFormat::RGB_10_11_11_REV:
@@ -347,63 +460,69 @@ bool PNGEncoder::encode(const LinearImage& image) {
             }
             break;
     }
+    return true;
+}
 
-    try {
-        mInfo = png_create_info_struct(mPNG);
+void PNGEncoder::writeInfo(uint32_t width, uint32_t height, uint32_t srcChannels) {
+    mInfo = png_create_info_struct(mPNG);
 
-        // Write header (8 bit colour depth)
-        size_t width = image.getWidth();
-        size_t height = image.getHeight();
-        int colorType = chooseColorType(image);
+    // Write header (8 bit colour depth)
+    int colorType = chooseColorType(srcChannels);
 
-        png_set_IHDR(mPNG, mInfo, width, height,
-                     8, colorType, PNG_INTERLACE_NONE,
-                     PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+    png_set_IHDR(mPNG, mInfo, width, height,
+                 8, colorType, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
-        if (mFormat == PixelFormat::LINEAR_RGB || mFormat == PixelFormat::RGB_10_11_11_REV) {
-            png_set_gAMA(mPNG, mInfo, 1.0);
-        } else {
-            png_set_sRGB_gAMA_and_cHRM(mPNG, mInfo, PNG_sRGB_INTENT_PERCEPTUAL);
-        }
+    if (mFormat == PixelFormat::LINEAR_RGB || mFormat == PixelFormat::RGB_10_11_11_REV) {
+        png_set_gAMA(mPNG, mInfo, 1.0);
+    } else {
+        png_set_sRGB_gAMA_and_cHRM(mPNG, mInfo, PNG_sRGB_INTENT_PERCEPTUAL);
+    }
 
-        png_write_info(mPNG, mInfo);
+    png_write_info(mPNG, mInfo);
 
-        std::unique_ptr<png_bytep[]> row_pointers(new png_bytep[height]);
-        std::unique_ptr<uint8_t[]> data;
+    mDstChannels = srcChannels == 1 ? 1 : getChannelsCount(colorType);
+}
 
-        uint32_t dstChannels;
-        if (srcChannels == 1) {
-            dstChannels = 1;
-            data = fromLinearToGrayscale<uint8_t>(image);
-        } else {
-            dstChannels = getChannelsCount(colorType);
-            switch (mFormat) {
-                case PixelFormat::RGBM:
-                    data = fromLinearToRGBM<uint8_t>(image);
-                    break;
-                case PixelFormat::RGB_10_11_11_REV:
-                    data = fromLinearToRGB_10_11_11_REV(image);
-                    break;
-                case PixelFormat::sRGB:
-                    if (dstChannels == 4) {
-                        data = fromLinearTosRGB<uint8_t, 4>(image);
-                    } else {
-                        data = fromLinearTosRGB<uint8_t, 3>(image);
-                    }
-                    break;
-                case PixelFormat::LINEAR_RGB:
-                    if (dstChannels == 4) {
-                        data = fromLinearToRGB<uint8_t, 4>(image);
-                    } else {
-                        data = fromLinearToRGB<uint8_t, 3>(image);
-                    }
-                    break;
+std::unique_ptr<uint8_t[]> PNGEncoder::convert(const LinearImage& image) const {
+    if (image.getChannels() == 1) {
+        return fromLinearToGrayscale<uint8_t>(image);
+    }
+    switch (mFormat) {
+        case PixelFormat::RGBM:
+            return fromLinearToRGBM<uint8_t>(image);
+        case PixelFormat::RGB_10_11_11_REV:
+            return fromLinearToRGB_10_11_11_REV(image);
+        case PixelFormat::sRGB:
+            if (mDstChannels == 4) {
+                return fromLinearTosRGB<uint8_t, 4>(image);
             }
-        }
+            return fromLinearTosRGB<uint8_t, 3>(image);
+        case PixelFormat::LINEAR_RGB:
+            if (mDstChannels == 4) {
+                return fromLinearToRGB<uint8_t, 4>(image);
+            }
+            return fromLinearToRGB<uint8_t, 3>(image);
+    }
+    return nullptr;
+}
+
+bool PNGEncoder::encode(const LinearImage& image) {
+    if (!checkChannels(image.getChannels())) {
+        return false;
+    }
+
+    try {
+        size_t width = image.getWidth();
+        size_t height = image.getHeight();
+        writeInfo(image.getWidth(), image.getHeight(), image.getChannels());
+
+        std::unique_ptr<png_bytep[]> row_pointers(new png_bytep[height]);
+        std::unique_ptr<uint8_t[]> data = convert(image);
 
         for (size_t y = 0; y < height; y++) {
             row_pointers[y] = reinterpret_cast<png_bytep>
-                    (&data[y * width * dstChannels * sizeof(uint8_t)]);
+                    (&data[y * width * mDstChannels * sizeof(uint8_t)]);
         }
 
         png_write_image(mPNG, row_pointers.get());
@@ -418,6 +537,189 @@ bool PNGEncoder::encode(const LinearImage& image) {
     return true;
 }
 
+bool PNGEncoder::encode(utils::JobSystem& js, const LinearImage& image) {
+    if (!checkChannels(image.getChannels())) {
+        return false;
+    }
+
+    const uint32_t width = image.getWidth();
+    const uint32_t height = image.getHeight();
+    const uint32_t channels = image.getChannels();
+    mDstChannels = channels == 1 ? 1 : getChannelsCount(chooseColorType(channels));
+
+    const size_t rowSize = size_t(width) * mDstChannels;
+    const uint32_t rowsPerBand = uint32_t(std::max(size_t(1), BAND_SIZE / rowSize));
+    const uint32_t bandCount = (height + rowsPerBand - 1) / rowsPerBand;
+    if (bandCount <= 1) {
+        return encode(image);
+    }
+
+    // The bands are converted, filtered and compressed in separate passes, because filtering a
+    // row needs the previous one, and compressing a band needs the end of the previous one. Each
+    // filtered row starts with its filter type.
+    const size_t filteredRowSize = rowSize + 1;
+    std::unique_ptr<uint8_t[]> pixels(new uint8_t[rowSize * height]);
+    std::unique_ptr<uint8_t[]> filtered(new uint8_t[filteredRowSize * height]);
+    std::unique_ptr<uint8_t[]> zeroes(new uint8_t[rowSize]());
+    std::vector<std::vector<uint8_t>> bands(bandCount);
+    std::vector<uLong> checksums(bandCount);
+    std::unique_ptr<bool[]> succeeded(new bool[bandCount]);
+
+    auto rowsOf = [=](uint32_t band) {
+        return std::make_pair(band * rowsPerBand, std::min(height, (band + 1) * rowsPerBand));
+    };
+
+    parallelFor(js, bandCount, [&](uint32_t band) {
+        auto [begin, end] = rowsOf(band);
+        LinearImage rows(width, end - begin, channels);
+        memcpy(rows.getPixelRef(), image.getPixelRef(0, begin),
+                sizeof(float) * width * channels * (end - begin));
+        memcpy(&pixels[begin * rowSize], convert(rows).get(), rowSize * (end - begin));
+    });
+
+    parallelFor(js, bandCount, [&](uint32_t band) {
+        auto [begin, end] = rowsOf(band);
+        for (size_t y = begin; y < end; y++) {
+            filterRow(&filtered[y * filteredRowSize], &pixels[y * rowSize],
+                    y ? &pixels[(y - 1) * rowSize] : zeroes.get(), rowSize, mDstChannels);
+        }
+    });
+
+    parallelFor(js, bandCount, [&](uint32_t band) {
+        auto [begin, end] = rowsOf(band);
+        succeeded[band] = deflateBand(bands[band], filtered.get(),
+                begin * filteredRowSize, end * filteredRowSize, band == bandCount - 1);
+        checksums[band] = adler32(adler32(0, nullptr, 0),
+                &filtered[begin * filteredRowSize], uInt((end - begin) * filteredRowSize));
+    });
+
+    if (!std::all_of(succeeded.get(), succeeded.get() + bandCount, [](bool b) { return b; })) {
+        std::cerr << "Error while compressing PNG data." << std::endl;
+        return false;
+    }
+
+    uLong checksum = adler32(0, nullptr, 0);
+    for (uint32_t band = 0; band < bandCount; band++) {
+        auto [begin, end] = rowsOf(band);
+        checksum = adler32_combine(checksum, checksums[band],
+                z_off_t((end - begin) * filteredRowSize));
+    }
+
+    try {
+        writeInfo(width, height, channels);
+
+        // The compressed bands are wrapped in a zlib stream, one IDAT chunk per band
+        const uint8_t header[2] = { 0x78, 0x9c }; // deflate, 32K window, default compression
+        const uint8_t trailer[4] = {
+                uint8_t(checksum >> 24), uint8_t(checksum >> 16),
+                uint8_t(checksum >> 8), uint8_t(checksum) };
+        for (uint32_t band = 0; band < bandCount; band++) {
+            const bool first = band == 0;
+            const bool last = band == bandCount - 1;
+            const size_t size = bands[band].size();
+            png_write_chunk_start(mPNG, (png_const_bytep) "IDAT",
+                    png_uint_32(size + (first ? sizeof(header) : 0) + (last ? sizeof(trailer) : 0)));
+            if (first) {
+                png_write_chunk_data(mPNG, header, sizeof(header));
+            }
+            png_write_chunk_data(mPNG, bands[band].data(), size);
+            if (last) {
+                png_write_chunk_data(mPNG, trailer, sizeof(trailer));
+            }
+            png_write_chunk_end(mPNG);
+        }
+        png_write_chunk(mPNG, (png_const_bytep) "IEND", nullptr, 0);
+        mStream.flush();
+    } catch (std::runtime_error& e) {
+        // reset the stream, like we found it
+        std::cerr << "Runtime error while encoding PNG: " << e.what() << std::endl;
+        mStream.seekp(mStreamStartPos);
+        return false;
+    }
+    return true;
+}
+
+static inline uint8_t paeth(int a, int b, int c) noexcept {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    return uint8_t((pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c));
+}
+
+void PNGEncoder::filterRow(uint8_t* UTILS_RESTRICT out, uint8_t const* UTILS_RESTRICT row,
+        uint8_t const* UTILS_RESTRICT prev, size_t size, size_t bpp) {
+    auto filter = [=](int type, size_t i) -> uint8_t {
+        const int x = row[i];
+        const int a = i >= bpp ? row[i - bpp] : 0;
+        const int b = prev[i];
+        const int c = i >= bpp ? prev[i - bpp] : 0;
+        switch (type) {
+            case PNG_FILTER_VALUE_SUB:   return uint8_t(x - a);
+            case PNG_FILTER_VALUE_UP:    return uint8_t(x - b);
+            case PNG_FILTER_VALUE_AVG:   return uint8_t(x - ((a + b) >> 1));
+            case PNG_FILTER_VALUE_PAETH: return uint8_t(x - paeth(a, b, c));
+            default:                     return uint8_t(x);
+        }
+    };
+
+    // Like libpng, pick the filter that minimizes the sum of the filtered bytes taken as signed
+    // values, the first one in case of a tie. A filter is abandoned as soon as it can't win.
+    int best = PNG_FILTER_VALUE_NONE;
+    size_t mins = std::numeric_limits<size_t>::max();
+    for (int type = PNG_FILTER_VALUE_NONE; type < PNG_FILTER_VALUE_LAST; type++) {
+        size_t sum = 0;
+        for (size_t i = 0; i < size && sum < mins; i++) {
+            const uint8_t v = filter(type, i);
+            sum += v < 128 ? v : 256 - v;
+        }
+        if (sum < mins) {
+            mins = sum;
+            best = type;
+        }
+    }
+
+    out[0] = uint8_t(best);
+    for (size_t i = 0; i < size; i++) {
+        out[i + 1] = filter(best, i);
+    }
+}
+
+bool PNGEncoder::deflateBand(std::vector<uint8_t>& out, uint8_t const* data,
+        size_t begin, size_t end, bool last) {
+    // same settings as libpng
+    z_stream stream{};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_FILTERED)
+            != Z_OK) {
+        return false;
+    }
+
+    // back-references can reach into the preceding data, as if it was a single stream
+    const size_t dictionarySize = std::min(begin, size_t(1) << MAX_WBITS);
+    if (dictionarySize) {
+        deflateSetDictionary(&stream, data + begin - dictionarySize, uInt(dictionarySize));
+    }
+
+    out.resize(deflateBound(&stream, uLong(end - begin)) + 16);
+    stream.next_in = const_cast<Bytef*>(data + begin);
+    stream.avail_in = uInt(end - begin);
+    stream.next_out = out.data();
+    stream.avail_out = uInt(out.size());
+
+    // a sync flush ends the stream on a byte boundary, so that the next band can follow it
+    const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    int result;
+    while ((result = deflate(&stream, flush)) == Z_OK && stream.avail_out == 0) {
+        const size_t size = out.size();
+        out.resize(size * 2);
+        stream.next_out = out.data() + size;
+        stream.avail_out = uInt(size);
+    }
+    out.resize(out.size() - stream.avail_out);
+    deflateEnd(&stream);
+    return last ? result == Z_STREAM_END : (result == Z_OK || result == Z_BUF_ERROR);
+}
+
 void PNGEncoder::cb_stream(png_structp png, png_bytep buffer, png_size_t size) {
     PNGEncoder* that = static_cast<PNGEncoder*>(png_get_io_ptr(png));
     that->stream(buffer, size);
@@ -441,6 +743,69 @@ void PNGEncoder::error() {
 
 //-------------------------------------------------------------------------------------------------
 
+std::unique_ptr<ScanlineWriter> PNGScanlineWriter::create(std::ostream& stream,
+        PNGEncoder::PixelFormat format, uint32_t width, uint32_t height, uint32_t channels) {
+    PNGEncoder* png = PNGEncoder::create(stream, format);
+    std::unique_ptr<ImageEncoder::Encoder> encoder(png);
+    if (!png->checkChannels(channels)) {
+        return nullptr;
+    }
+    try {
+        png->writeInfo(width, height, channels);
+    } catch (std::runtime_error& e) {
+        std::cerr << "Runtime error while encoding PNG: " << e.what() << std::endl;
+        return nullptr;
+    }
+    return std::make_unique<PNGScanlineWriter>(std::move(encoder), *png, width, height, channels);
+}
+
+PNGScanlineWriter::PNGScanlineWriter(std::unique_ptr<ImageEncoder::Encoder> encoder,
+        PNGEncoder& png, uint32_t width, uint32_t height, uint32_t channels)
+        : ScanlineWriter(width, height, channels), mOwner(std::move(encoder)), mEncoder(png) {
+}
+
+bool PNGScanlineWriter::writeRows(float const* rows, uint32_t count) {
+    LinearImage band(getWidth(), count, getChannels());
+    memcpy(band.getPixelRef(), rows, size_t(getWidth()) * getChannels() * count * sizeof(float));
+    std::unique_ptr<uint8_t[]> data = mEncoder.convert(band);
+    try {
+        size_t const rowSize = size_t(getWidth()) * mEncoder.mDstChannels;
+        for (size_t y = 0; y < count; y++) {
+            png_write_row(mEncoder.mPNG, &data[y * rowSize]);
+        }
+        if (count == getRemainingRows()) {
+            png_write_end(mEncoder.mPNG, mEncoder.mInfo);
+            mEncoder.mStream.flush();
+        }
+    } catch (std::runtime_error& e) {
+        std::cerr << "Runtime error while encoding PNG: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+BufferedScanlineWriter::BufferedScanlineWriter(std::ostream& stream, ImageEncoder::Format format,
+        uint32_t width, uint32_t height, uint32_t channels,
+        const std::string& compression, const std::string& destName)
+        : ScanlineWriter(width, height, channels),
+          mStream(stream), mFormat(format), mCompression(compression), mDestName(destName),
+          mImage(width, height, channels), mCurrent(mImage.getPixelRef()) {
+}
+
+bool BufferedScanlineWriter::writeRows(float const* rows, uint32_t count) {
+    size_t const size = size_t(getWidth()) * getChannels() * count;
+    memcpy(mCurrent, rows, size * sizeof(float));
+    mCurrent += size;
+    if (count == getRemainingRows()) {
+        return ImageEncoder::encode(mStream, mFormat, mImage, mCompression, mDestName);
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 HDREncoder* HDREncoder::create(std::ostream& stream) {
     HDREncoder* encoder = new HDREncoder(stream);
     return encoder;
@@ -524,60 +889,44 @@ bool HDREncoder::encode(const LinearImage& image) {
     }
 
     try {
-        // Write header (8 bit color depth)
-        size_t width = image.getWidth();
-        size_t height = image.getHeight();
+        writeHeader(image.getWidth(), image.getHeight());
+        encodeRows(mStream, image, 0, image.getHeight());
+        mStream.flush();
+    } catch(std::runtime_error& e) {
+        // reset the stream, like we found it
+        std::cerr << "Runtime error while encoding HDR: " << e.what() << std::endl;
+        mStream.seekp(mStreamStartPos);
+        return false;
+    }
+    return true;
+}
 
-        mStream << "#?RADIANCE" << std::endl;
-        mStream << "# cmgen" << std::endl;
-        mStream << "FORMAT=32-bit_rle_rgbe" << std::endl;
-        mStream << "GAMMA=" << std::to_string(1) << std::endl;
-        mStream << "EXPOSURE=" << std::to_string(0) << std::endl;
-        mStream << std::endl;
-        mStream << "-Y " << std::to_string(height) << " "
-                << "+X " << std::to_string(width) << std::endl;
-
-        // The Radiance format is not expected to use RLE encoding when
-        // scanlines are less than 8 pixels or more than 32,767 pixels
-        if (width < 8 || width > 32767) {
-            for (uint32_t y = 0; y < height; y++) {
-                uint8_t p[4];
-                auto data = image.get<float3>(0, y);
-                for (size_t x = 0; x < width; ++x, ++data) {
-                    float2rgbe(p, *data);
-                    mStream.write((char*) &p, 4);
-                }
-            }
-        } else {
-            std::unique_ptr<uint8_t[]> rgbe(new uint8_t[width*4]);
-            uint8_t* const r = &rgbe[0];
-            uint8_t* const g = &rgbe[width];
-            uint8_t* const b = &rgbe[2*width];
-            uint8_t* const e = &rgbe[3*width];
-            uint16_t magic = 0x0202;
-            uint16_t widthNetwork = htons(width);
-
-            for (uint32_t y = 0; y < height; y++) {
-                // convert one scanline to RGBE
-                uint8_t p[4];
-                auto data = image.get<float3>(0, y);
-                for (size_t x = 0; x < width; ++x, ++data) {
-                    float2rgbe(p, *data);
-                    r[x] = p[0];
-                    g[x] = p[1];
-                    b[x] = p[2];
-                    e[x] = p[3];
-                }
-                // now RLE-compress each plane
-                mStream.write((char*) &magic, 2);
-                mStream.write((char*) &widthNetwork, 2);
-                rle(mStream, r, width);
-                rle(mStream, g, width);
-                rle(mStream, b, width);
-                rle(mStream, e, width);
-            }
-        }
+bool HDREncoder::encode(utils::JobSystem& js, const LinearImage& image) {
+    if (image.getChannels() != 3) {
+        return false;
+    }
+
+    const uint32_t height = image.getHeight();
+    const uint32_t rowsPerBand = uint32_t(std::max(size_t(1), BAND_SIZE / (image.getWidth() * 4)));
+    const uint32_t bandCount = (height + rowsPerBand - 1) / rowsPerBand;
+    if (bandCount <= 1) {
+        return encode(image);
+    }
 
+    // scanlines are compressed independently, each band is encoded into its own buffer
+    std::vector<std::string> bands(bandCount);
+    parallelFor(js, bandCount, [&](uint32_t band) {
+        const uint32_t y = band * rowsPerBand;
+        std::ostringstream out;
+        encodeRows(out, image, y, std::min(rowsPerBand, height - y));
+        bands[band] = out.str();
+    });
+
+    try {
+        writeHeader(image.getWidth(), height);
+        for (std::string const& band : bands) {
+            mStream.write(band.data(), std::streamsize(band.size()));
+        }
         mStream.flush();
     } catch(std::runtime_error& e) {
         // reset the stream, like we found it
@@ -588,6 +937,66 @@ bool HDREncoder::encode(const LinearImage& image) {
     return true;
 }
 
+void HDREncoder::writeHeader(size_t width, size_t height) {
+    // Write header (8 bit color depth)
+    mStream << "#?RADIANCE" << std::endl;
+    mStream << "# cmgen" << std::endl;
+    mStream << "FORMAT=32-bit_rle_rgbe" << std::endl;
+    mStream << "GAMMA=" << std::to_string(1) << std::endl;
+    mStream << "EXPOSURE=" << std::to_string(0) << std::endl;
+    mStream << std::endl;
+    mStream << "-Y " << std::to_string(height) << " "
+            << "+X " << std::to_string(width) << std::endl;
+}
+
+void HDREncoder::encodeRows(std::ostream& out, const LinearImage& image,
+        uint32_t y, uint32_t count) {
+    const size_t width = image.getWidth();
+    const uint32_t end = y + count;
+
+    // The Radiance format is not expected to use RLE encoding when
+    // scanlines are less than 8 pixels or more than 32,767 pixels
+    if (width < 8 || width > 32767) {
+        for (; y < end; y++) {
+            uint8_t p[4];
+            auto data = image.get<float3>(0, y);
+            for (size_t x = 0; x < width; ++x, ++data) {
+                float2rgbe(p, *data);
+                out.write((char*) &p, 4);
+            }
+        }
+        return;
+    }
+
+    std::unique_ptr<uint8_t[]> rgbe(new uint8_t[width*4]);
+    uint8_t* const r = &rgbe[0];
+    uint8_t* const g = &rgbe[width];
+    uint8_t* const b = &rgbe[2*width];
+    uint8_t* const e = &rgbe[3*width];
+    uint16_t magic = 0x0202;
+    uint16_t widthNetwork = htons(width);
+
+    for (; y < end; y++) {
+        // convert one scanline to RGBE
+        uint8_t p[4];
+        auto data = image.get<float3>(0, y);
+        for (size_t x = 0; x < width; ++x, ++data) {
+            float2rgbe(p, *data);
+            r[x] = p[0];
+            g[x] = p[1];
+            b[x] = p[2];
+            e[x] = p[3];
+        }
+        // now RLE-compress each plane
+        out.write((char*) &magic, 2);
+        out.write((char*) &widthNetwork, 2);
+        rle(out, r, width);
+        rle(out, g, width);
+        rle(out, b, width);
+        rle(out, e, width);
+    }
+}
+
 //-------------------------------------------------------------------------------------------------
 
 const char PSDEncoder::sig[] = { '8', 'B', 'P', 'S', 0x0, 0x1, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0 };
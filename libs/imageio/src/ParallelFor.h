@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IMAGE_PARALLELFOR_H_
+#define IMAGE_PARALLELFOR_H_
+
+#include <utils/JobSystem.h>
+
+#include <stdint.h>
+
+namespace image {
+
+// Calls fn(i) for all i in [0, count), concurrently, one job per index: the images and bands
+// processed by imageio are large enough for the JobSystem overhead not to matter. The calling
+// thread must be a thread of the JobSystem, or adopted by it.
+template<typename F>
+inline void parallelFor(utils::JobSystem& js, uint32_t count, F fn) {
+    utils::JobSystem::Job* job = utils::jobs::parallel_for(js, nullptr, 0, count,
+            [&fn](uint32_t start, uint32_t c) {
+                for (uint32_t i = start, end = start + c; i < end; i++) {
+                    fn(i);
+                }
+            }, utils::jobs::CountSplitter<1>());
+    js.runAndWait(job);
+}
+
+} // namespace image
+
+#endif // IMAGE_PARALLELFOR_H_
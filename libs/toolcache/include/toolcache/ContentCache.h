@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_TOOLCACHE_CONTENTCACHE_H
+#define TNT_TOOLCACHE_CONTENTCACHE_H
+
+#include <utils/Path.h>
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament::toolcache {
+
+/**
+ * ContentCache is a local, content-addressed cache for the outputs of command line tools.
+ *
+ * An entry is keyed on everything that determines the outputs of a run of a tool: the name and
+ * version of the tool, its options and the contents of its input files. It holds the files
+ * written by that run, and optionally a log (e.g. text the tool printed). A cache hit restores
+ * the files instead of running the tool.
+ *
+ * The files are recorded relative to a list of output locations, so that a hit can restore them
+ * to different locations. Output paths must therefore not be part of the key, but the names of
+ * the output files should be if they're derived from the options.
+ *
+ * The cache is safe to share between concurrent processes: entries are written to temporary
+ * files which are renamed in place, and an entry is only visible once complete.
+ *
+ * Usage Example:
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * using namespace filament::toolcache;
+ *
+ * ContentCache cache(cacheDirectory);
+ * ContentCache::Key key("mytool", ContentCache::getExecutableVersion());
+ * key.add("size", size);
+ * key.addFile("input", inputPath);
+ *
+ * ContentCache::Outputs outputs({ outputDirectory });
+ * if (cache.fetch(key, outputs)) {
+ *     return 0;
+ * }
+ * // ... run the tool, writing into outputDirectory ...
+ * outputs.add(outputDirectory + "output.png");
+ * cache.store(key, outputs);
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ */
+class ContentCache {
+public:
+    /**
+     * Describes a run of a tool. The key of the entry is the SHA-256 digest of this description.
+     */
+    class Key {
+    public:
+        /**
+         * @param tool Name of the tool
+         * @param version Version of the tool, which must change whenever its outputs change,
+         *                typically getExecutableVersion()
+         */
+        Key(std::string_view tool, std::string_view version);
+
+        //! Adds a named value, e.g. an option
+        Key& add(std::string_view name, std::string_view value);
+
+        //! Adds a named string
+        Key& add(std::string_view name, char const* value) {
+            return add(name, std::string_view(value));
+        }
+
+        //! Adds a named number or boolean
+        template<typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+        Key& add(std::string_view name, T value) {
+            if constexpr (std::is_floating_point_v<T>) {
+                return addFloat(name, double(value));
+            } else {
+                return add(name, std::string_view(std::to_string(value)));
+            }
+        }
+
+        /**
+         * Adds the contents of a file, which is typically an input of the tool.
+         *
+         * @return false if the file can't be read, in which case the tool shouldn't use the cache.
+         */
+        bool addFile(std::string_view name, utils::Path const& path);
+
+        //! Returns the human readable description of the run, which is stored with the entry
+        std::string const& getDescription() const noexcept { return mDescription; }
+
+        //! Returns the hexadecimal SHA-256 digest of the description
+        std::string getDigest() const;
+
+    private:
+        Key& addFloat(std::string_view name, double value);
+        std::string mDescription;
+    };
+
+    /**
+     * The output locations of a run, directories or files, and the files the run wrote in them.
+     * Only the files recorded with add() are stored, so that nothing else written in the same
+     * locations, e.g. by a concurrent run of the tool, ends up in the entry. Unused locations
+     * can be left empty.
+     */
+    class Outputs {
+    public:
+        explicit Outputs(std::vector<utils::Path> locations);
+
+        //! Records a file written by the run, files outside of the output locations are ignored
+        void add(utils::Path const& file);
+
+        std::vector<utils::Path> const& getLocations() const noexcept { return mLocations; }
+
+    private:
+        friend class ContentCache;
+
+        struct File {
+            size_t location;        // index of the output location the file belongs to
+            std::string path;       // path relative to that location, empty if it's a file
+            utils::Path absolute;
+        };
+
+        // Lists the recorded files that exist, relative to their output location.
+        std::vector<File> collect() const;
+
+        std::vector<utils::Path> mLocations;
+        std::vector<utils::Path> mFiles;
+    };
+
+    /**
+     * Opens or creates a cache.
+     *
+     * @param directory Root directory of the cache, created if needed
+     */
+    explicit ContentCache(utils::Path directory);
+
+    /**
+     * Returns the directory of the cache shared by the Filament tools, i.e. the value of the
+     * FILAMENT_TOOL_CACHE environment variable. An empty path means no cache should be used.
+     */
+    static utils::Path getDefaultDirectory();
+
+    /**
+     * Returns a version of the running tool suitable for Key: the SHA-256 digest of its
+     * executable. It changes whenever the tool is rebuilt differently, including when a library
+     * it links, e.g. libibl or libimage, changes its outputs. This is computed once per process.
+     *
+     * @return the digest, or an empty string if the executable can't be read, in which case the
+     *         tool shouldn't use the cache.
+     */
+    static std::string const& getExecutableVersion();
+
+    utils::Path const& getDirectory() const noexcept { return mDirectory; }
+
+    /**
+     * Looks up an entry and, if found, restores its files into the given output locations.
+     *
+     * @param key Key of the entry
+     * @param outputs Where to restore the files, the locations must be in the same order as when
+     *                the entry was stored
+     * @param log If not null, receives the log stored with the entry
+     * @param fileCount If not null, receives the number of restored files
+     * @return true on a cache hit, false if there is no such entry or it couldn't be restored
+     */
+    bool fetch(Key const& key, Outputs const& outputs, std::string* log = nullptr,
+            size_t* fileCount = nullptr) const;
+
+    /**
+     * Stores the files recorded in the Outputs object.
+     *
+     * @param key Key of the entry
+     * @param outputs Output locations of the run
+     * @param log Arbitrary text to store with the entry, returned by fetch()
+     * @param fileCount If not null, receives the number of stored files
+     * @return true if the entry was stored
+     */
+    bool store(Key const& key, Outputs const& outputs, std::string_view log = {},
+            size_t* fileCount = nullptr) const;
+
+private:
+    utils::Path getEntryDirectory(std::string const& digest) const;
+    utils::Path mDirectory;
+};
+
+} // namespace filament::toolcache
+
+#endif // TNT_TOOLCACHE_CONTENTCACHE_H
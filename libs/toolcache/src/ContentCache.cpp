@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <toolcache/ContentCache.h>
+
+#include "Sha256.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <tuple>
+#include <utility>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace utils;
+
+namespace filament::toolcache {
+
+// An entry is a directory named after its key, holding one file per output (named after its index
+// in the manifest), the log, the description of the key and the manifest. The manifest is written
+// last: an entry without one is incomplete and ignored.
+static constexpr char const* MANIFEST_HEADER = "filament-toolcache 1";
+static constexpr char const* MANIFEST = "manifest";
+static constexpr char const* LOG = "log";
+static constexpr char const* DESCRIPTION = "key";
+
+// Suffix of the temporary files of this process.
+static std::string const& getTemporarySuffix() {
+    static std::string const suffix = [] {
+        std::random_device rd;
+        std::ostringstream s;
+        s << "." << std::hex << rd() << rd() << ".tmp";
+        return s.str();
+    }();
+    return suffix;
+}
+
+static bool digestFile(Path const& path, std::string& digest) {
+    std::ifstream in(path.getPath(), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    Sha256 sha;
+    char buffer[64 * 1024];
+    while (in) {
+        in.read(buffer, sizeof(buffer));
+        sha.update(buffer, size_t(in.gcount()));
+    }
+    if (in.bad()) {
+        return false;
+    }
+    digest = sha.finish();
+    return true;
+}
+
+static bool copyStream(std::istream& in, std::ostream& out) {
+    char buffer[64 * 1024];
+    while (in) {
+        in.read(buffer, sizeof(buffer));
+        out.write(buffer, in.gcount());
+    }
+    return !in.bad() && bool(out);
+}
+
+// Writes a file of the cache under a temporary name first, so that it's never seen partially
+// written. Concurrent writers of the same entry write the same contents.
+template<typename WRITER>
+static bool writeAtomically(Path const& path, WRITER writer) {
+    Path const temporary(path.getPath() + getTemporarySuffix());
+    {
+        std::ofstream out(temporary.getPath(), std::ios::binary | std::ios::trunc);
+        if (!out || !writer(out)) {
+            out.close();
+            Path(temporary).unlinkFile();
+            return false;
+        }
+        out.close();
+        if (!out) {
+            Path(temporary).unlinkFile();
+            return false;
+        }
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        // On some platforms rename() doesn't replace an existing file, which then has the same
+        // contents anyway.
+        bool const exists = path.exists();
+        Path(temporary).unlinkFile();
+        return exists;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+
+ContentCache::Key::Key(std::string_view tool, std::string_view version) {
+    add("tool", tool);
+    add("version", version);
+}
+
+ContentCache::Key& ContentCache::Key::add(std::string_view name, std::string_view value) {
+    // one "name=value" line per field, with escaped line breaks so that fields can't be confused
+    mDescription.append(name);
+    mDescription.push_back('=');
+    for (char c : value) {
+        if (c == '\\') {
+            mDescription.append("\\\\");
+        } else if (c == '\n') {
+            mDescription.append("\\n");
+        } else {
+            mDescription.push_back(c);
+        }
+    }
+    mDescription.push_back('\n');
+    return *this;
+}
+
+ContentCache::Key& ContentCache::Key::addFloat(std::string_view name, double value) {
+    // enough digits to round-trip a double
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.17g", value);
+    return add(name, std::string_view(buffer));
+}
+
+bool ContentCache::Key::addFile(std::string_view name, Path const& path) {
+    std::string digest;
+    if (!digestFile(path, digest)) {
+        return false;
+    }
+    add(name, digest);
+    return true;
+}
+
+std::string ContentCache::Key::getDigest() const {
+    Sha256 sha;
+    sha.update(mDescription.data(), mDescription.size());
+    return sha.finish();
+}
+
+// ------------------------------------------------------------------------------------------------
+
+ContentCache::Outputs::Outputs(std::vector<Path> locations)
+        : mLocations(std::move(locations)) {
+}
+
+void ContentCache::Outputs::add(Path const& file) {
+    mFiles.push_back(file.getAbsolutePath());
+}
+
+std::vector<ContentCache::Outputs::File> ContentCache::Outputs::collect() const {
+    std::vector<File> files;
+    std::set<std::string> seen;
+    for (Path const& file : mFiles) {
+        if (!file.isFile() || !seen.insert(file.getPath()).second) {
+            continue;
+        }
+        // locations may overlap, a file belongs to the first one it's found in
+        for (size_t i = 0; i < mLocations.size(); i++) {
+            // unused locations are empty, so that the indices of the others don't change
+            if (mLocations[i].isEmpty()) {
+                continue;
+            }
+            std::string const location = mLocations[i].getAbsolutePath().getPath();
+            if (file.getPath() == location) {
+                files.push_back({ i, {}, file });
+                break;
+            }
+            std::string const prefix = location.back() == '/' ? location : location + "/";
+            if (file.getPath().compare(0, prefix.size(), prefix) == 0) {
+                files.push_back({ i, file.getPath().substr(prefix.size()), file });
+                break;
+            }
+        }
+    }
+
+    std::sort(files.begin(), files.end(), [](File const& lhs, File const& rhs) {
+        return std::tie(lhs.location, lhs.path) < std::tie(rhs.location, rhs.path);
+    });
+    return files;
+}
+
+// ------------------------------------------------------------------------------------------------
+
+ContentCache::ContentCache(Path directory)
+        : mDirectory(directory.getAbsolutePath()) {
+    if (!mDirectory.exists()) {
+        mDirectory.mkdirRecursive();
+    }
+}
+
+Path ContentCache::getDefaultDirectory() {
+    char const* directory = getenv("FILAMENT_TOOL_CACHE");
+    return directory ? Path(directory) : Path();
+}
+
+std::string const& ContentCache::getExecutableVersion() {
+    static std::string const version = [] {
+        std::string digest;
+        Path const executable = Path::getCurrentExecutable();
+        if (executable.isEmpty() || !digestFile(executable, digest)) {
+            digest.clear();
+        }
+        return digest;
+    }();
+    return version;
+}
+
+Path ContentCache::getEntryDirectory(std::string const& digest) const {
+    // a level of sub-directories keeps the number of entries per directory reasonable
+    return mDirectory + digest.substr(0, 2) + digest;
+}
+
+bool ContentCache::fetch(Key const& key, Outputs const& outputs, std::string* log,
+        size_t* fileCount) const {
+    Path const entry = getEntryDirectory(key.getDigest());
+    std::ifstream manifest((entry + MANIFEST).getPath());
+    if (!manifest) {
+        return false;
+    }
+
+    std::string header;
+    size_t count = 0;
+    if (!std::getline(manifest, header) || header != MANIFEST_HEADER || !(manifest >> count)) {
+        return false;
+    }
+
+    std::vector<std::pair<size_t, std::string>> files;
+    for (size_t i = 0; i < count; i++) {
+        size_t location;
+        std::string path;
+        if (!(manifest >> location) || location >= outputs.getLocations().size()) {
+            return false;
+        }
+        manifest.get(); // the separator, paths can have leading spaces
+        std::getline(manifest, path);
+        files.emplace_back(location, std::move(path));
+    }
+    if (!manifest) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        auto const& [location, path] = files[i];
+        Path const& root = outputs.getLocations()[location];
+        Path const target = path.empty() ? root : root + path;
+        Path const parent = target.getAbsolutePath().getParent();
+        if (!parent.exists()) {
+            parent.mkdirRecursive();
+        }
+        std::ifstream in((entry + std::to_string(i)).getPath(), std::ios::binary);
+        std::ofstream out(target.getPath(), std::ios::binary | std::ios::trunc);
+        if (!in || !out || !copyStream(in, out)) {
+            return false;
+        }
+    }
+
+    if (log) {
+        std::ifstream in((entry + LOG).getPath(), std::ios::binary);
+        std::ostringstream out;
+        if (in) {
+            copyStream(in, out);
+        }
+        *log = out.str();
+    }
+    if (fileCount) {
+        *fileCount = count;
+    }
+    return true;
+}
+
+bool ContentCache::store(Key const& key, Outputs const& outputs, std::string_view log,
+        size_t* fileCount) const {
+    std::vector<Outputs::File> files = outputs.collect();
+
+    // never store the cache into itself
+    std::string const prefix = mDirectory.getPath() + "/";
+    files.erase(std::remove_if(files.begin(), files.end(), [&prefix](Outputs::File const& file) {
+        return file.absolute.getPath().compare(0, prefix.size(), prefix) == 0;
+    }), files.end());
+
+    Path const entry = getEntryDirectory(key.getDigest());
+    if (!entry.exists() && !entry.mkdirRecursive()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < files.size(); i++) {
+        bool const success = writeAtomically(entry + std::to_string(i), [&](std::ostream& out) {
+            std::ifstream in(files[i].absolute.getPath(), std::ios::binary);
+            return in && copyStream(in, out);
+        });
+        if (!success) {
+            return false;
+        }
+    }
+
+    bool success = writeAtomically(entry + LOG, [log](std::ostream& out) {
+        return bool(out.write(log.data(), std::streamsize(log.size())));
+    });
+    success = success && writeAtomically(entry + DESCRIPTION, [&key](std::ostream& out) {
+        return bool(out << key.getDescription());
+    });
+    success = success && writeAtomically(entry + MANIFEST, [&files](std::ostream& out) {
+        out << MANIFEST_HEADER << "\n" << files.size() << "\n";
+        for (Outputs::File const& file : files) {
+            out << file.location << " " << file.path << "\n";
+        }
+        return bool(out);
+    });
+    if (success && fileCount) {
+        *fileCount = files.size();
+    }
+    return success;
+}
+
+} // namespace filament::toolcache
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Sha256.h"
+
+#include <string.h>
+
+namespace filament::toolcache {
+
+static constexpr uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+        0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+        0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+        0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+        0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+        0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+        0xc67178f2,
+};
+
+static inline uint32_t rotr(uint32_t x, uint32_t n) noexcept {
+    return (x >> n) | (x << (32u - n));
+}
+
+Sha256::Sha256() noexcept
+        : mState{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 } {
+}
+
+void Sha256::transform(uint8_t const* block) noexcept {
+    uint32_t w[64];
+    for (size_t i = 0; i < 16; i++) {
+        w[i] = uint32_t(block[i * 4]) << 24u | uint32_t(block[i * 4 + 1]) << 16u |
+               uint32_t(block[i * 4 + 2]) << 8u | uint32_t(block[i * 4 + 3]);
+    }
+    for (size_t i = 16; i < 64; i++) {
+        uint32_t const s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3u);
+        uint32_t const s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10u);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = mState[0], b = mState[1], c = mState[2], d = mState[3];
+    uint32_t e = mState[4], f = mState[5], g = mState[6], h = mState[7];
+    for (size_t i = 0; i < 64; i++) {
+        uint32_t const s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        uint32_t const ch = (e & f) ^ (~e & g);
+        uint32_t const t1 = h + s1 + ch + K[i] + w[i];
+        uint32_t const s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        uint32_t const maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t const t2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    mState[0] += a; mState[1] += b; mState[2] += c; mState[3] += d;
+    mState[4] += e; mState[5] += f; mState[6] += g; mState[7] += h;
+}
+
+void Sha256::update(void const* data, size_t size) noexcept {
+    uint8_t const* bytes = (uint8_t const*) data;
+    mLength += size;
+    if (mBlockSize) {
+        size_t const n = size < 64 - mBlockSize ? size : 64 - mBlockSize;
+        memcpy(mBlock + mBlockSize, bytes, n);
+        mBlockSize += n;
+        bytes += n;
+        size -= n;
+        if (mBlockSize < 64) {
+            return;
+        }
+        transform(mBlock);
+        mBlockSize = 0;
+    }
+    for (; size >= 64; bytes += 64, size -= 64) {
+        transform(bytes);
+    }
+    memcpy(mBlock, bytes, size);
+    mBlockSize = size;
+}
+
+std::string Sha256::finish() noexcept {
+    uint64_t const bitLength = mLength * 8;
+    uint8_t const one = 0x80;
+    update(&one, 1);
+    uint8_t const zero = 0;
+    while (mBlockSize != 56) {
+        update(&zero, 1);
+    }
+    uint8_t length[8];
+    for (size_t i = 0; i < 8; i++) {
+        length[i] = uint8_t(bitLength >> (56u - i * 8u));
+    }
+    update(length, 8);
+
+    static constexpr char HEX[] = "0123456789abcdef";
+    std::string digest;
+    digest.reserve(64);
+    for (uint32_t s : mState) {
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            digest.push_back(HEX[(s >> uint32_t(shift)) & 0xfu]);
+        }
+    }
+    return digest;
+}
+
+} // namespace filament::toolcache
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_TOOLCACHE_SHA256_H
+#define TNT_TOOLCACHE_SHA256_H
+
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament::toolcache {
+
+// Incremental SHA-256 (FIPS 180-4), used to address the entries of the cache.
+class Sha256 {
+public:
+    Sha256() noexcept;
+    void update(void const* data, size_t size) noexcept;
+    // Returns the digest as a lowercase hexadecimal string. Must be called once.
+    std::string finish() noexcept;
+
+private:
+    void transform(uint8_t const* block) noexcept;
+    uint32_t mState[8];
+    uint64_t mLength = 0;
+    uint8_t mBlock[64];
+    size_t mBlockSize = 0;
+};
+
+} // namespace filament::toolcache
+
+#endif // TNT_TOOLCACHE_SHA256_H
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <toolcache/ContentCache.h>
+
+#include "../src/Sha256.h"
+
+#include <utils/Path.h>
+
+#include <gtest/gtest.h>
+
+#include "TemporaryDirectoryTest.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace filament::toolcache;
+using namespace utils;
+
+class ToolCacheTest : public TemporaryDirectoryTest {};
+
+static void writeFile(Path const& path, std::string const& contents) {
+    path.getParent().mkdirRecursive();
+    std::ofstream out(path.getPath(), std::ios::binary | std::ios::trunc);
+    out << contents;
+}
+
+static std::string readFile(Path const& path) {
+    std::ifstream in(path.getPath(), std::ios::binary);
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+TEST_F(ToolCacheTest, Sha256) {
+    auto digest = [](std::string const& s) {
+        Sha256 sha;
+        sha.update(s.data(), s.size());
+        return sha.finish();
+    };
+    EXPECT_EQ(digest(""),
+            "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(digest("abc"),
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_EQ(digest("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+    // split updates
+    Sha256 sha;
+    std::string const million(1000000, 'a');
+    for (size_t i = 0; i < million.size(); i += 333) {
+        sha.update(million.data() + i, std::min(size_t(333), million.size() - i));
+    }
+    EXPECT_EQ(sha.finish(), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST_F(ToolCacheTest, Key) {
+    Path const input = mRoot + "input.bin";
+    writeFile(input, "input");
+
+    auto createKey = [&](float value, char const* option) {
+        ContentCache::Key key("tool", "1");
+        key.add("value", value).add("option", option).add("flag", true);
+        EXPECT_TRUE(key.addFile("input", input));
+        return key;
+    };
+
+    EXPECT_EQ(createKey(0.5f, "a").getDigest(), createKey(0.5f, "a").getDigest());
+    EXPECT_NE(createKey(0.5f, "a").getDigest(), createKey(0.50001f, "a").getDigest());
+    EXPECT_NE(createKey(0.5f, "a").getDigest(), createKey(0.5f, "b").getDigest());
+
+    // fields can't run into each other
+    EXPECT_NE(ContentCache::Key("t", "1").add("a", "b\nc=d").getDigest(),
+              ContentCache::Key("t", "1").add("a", "b").add("c", "d").getDigest());
+
+    std::string const digest = createKey(0.5f, "a").getDigest();
+    writeFile(input, "modified input");
+    EXPECT_NE(createKey(0.5f, "a").getDigest(), digest);
+
+    ContentCache::Key key("tool", "1");
+    EXPECT_FALSE(key.addFile("input", mRoot + "missing.bin"));
+}
+
+TEST_F(ToolCacheTest, ExecutableVersion) {
+    // the version is the digest of the running executable, computed once
+    std::string const contents = readFile(Path::getCurrentExecutable());
+    ASSERT_FALSE(contents.empty());
+    Sha256 sha;
+    sha.update(contents.data(), contents.size());
+    EXPECT_EQ(ContentCache::getExecutableVersion(), sha.finish());
+    EXPECT_EQ(&ContentCache::getExecutableVersion(), &ContentCache::getExecutableVersion());
+}
+
+TEST_F(ToolCacheTest, StoreAndFetch) {
+    ContentCache cache(mRoot + "cache");
+    ContentCache::Key key("tool", "1");
+    key.add("size", 256);
+
+    Path const directory = mRoot + "out";
+    Path const file = mRoot + "sh.txt";
+    {
+        ContentCache::Outputs outputs({ directory, file });
+        EXPECT_FALSE(cache.fetch(key, outputs));
+
+        writeFile(directory + "a.png", "a");
+        writeFile(directory + "sub/b.png", "bb");
+        writeFile(file, "sh");
+        outputs.add(directory + "a.png");
+        outputs.add(directory + "sub/b.png");
+        outputs.add(file);
+
+        size_t count = 0;
+        EXPECT_TRUE(cache.store(key, outputs, "log", &count));
+        EXPECT_EQ(count, 3);
+    }
+
+    // restore to other locations
+    Path const otherDirectory = mRoot + "other";
+    Path const otherFile = mRoot + "other.txt";
+    ContentCache::Outputs outputs({ otherDirectory, otherFile });
+    std::string log;
+    size_t count = 0;
+    EXPECT_TRUE(cache.fetch(key, outputs, &log, &count));
+    EXPECT_EQ(count, 3);
+    EXPECT_EQ(log, "log");
+    EXPECT_EQ(readFile(otherDirectory + "a.png"), "a");
+    EXPECT_EQ(readFile(otherDirectory + "sub/b.png"), "bb");
+    EXPECT_EQ(readFile(otherFile), "sh");
+
+    // another key misses
+    ContentCache::Key otherKey("tool", "2");
+    otherKey.add("size", 256);
+    EXPECT_FALSE(cache.fetch(otherKey, outputs));
+
+    // an incomplete entry misses
+    std::string const digest = key.getDigest();
+    Path(mRoot + "cache" + digest.substr(0, 2) + digest + "manifest").unlinkFile();
+    EXPECT_FALSE(cache.fetch(key, outputs));
+}
+
+TEST_F(ToolCacheTest, OverlappingLocations) {
+    ContentCache cache(mRoot + "out/cache");
+    ContentCache::Key key("tool", "1");
+
+    Path const directory = mRoot + "out";
+    Path const file = directory + "env/sh.txt";
+    {
+        ContentCache::Outputs outputs({ directory, file });
+        writeFile(directory + "env/m0.ktx", "ktx");
+        writeFile(file, "sh");
+        outputs.add(directory + "env/m0.ktx");
+        outputs.add(file);
+        outputs.add(file);
+        size_t count = 0;
+        EXPECT_TRUE(cache.store(key, outputs, {}, &count));
+        // each file is stored once, and the cache itself isn't stored
+        EXPECT_EQ(count, 2);
+    }
+
+    Path const otherDirectory = mRoot + "other";
+    ContentCache::Outputs outputs({ otherDirectory, otherDirectory + "env/sh.txt" });
+    EXPECT_TRUE(cache.fetch(key, outputs));
+    EXPECT_EQ(readFile(otherDirectory + "env/m0.ktx"), "ktx");
+    EXPECT_EQ(readFile(otherDirectory + "env/sh.txt"), "sh");
+}
+
+TEST_F(ToolCacheTest, OnlyRecordedFilesAreStored) {
+    ContentCache cache(mRoot + "cache");
+    ContentCache::Key key("tool", "1");
+
+    Path const directory = mRoot + "out";
+    {
+        ContentCache::Outputs outputs({ directory });
+        writeFile(directory + "mine.png", "mine");
+        outputs.add(directory + "mine.png");
+
+        // written in the same location at the same time, e.g. by another run of the tool
+        writeFile(directory + "theirs.png", "theirs");
+
+        // outside of the output locations, or never written
+        writeFile(mRoot + "elsewhere.png", "elsewhere");
+        outputs.add(mRoot + "elsewhere.png");
+        outputs.add(directory + "missing.png");
+
+        size_t count = 0;
+        EXPECT_TRUE(cache.store(key, outputs, {}, &count));
+        EXPECT_EQ(count, 1);
+    }
+
+    Path const otherDirectory = mRoot + "other";
+    ContentCache::Outputs outputs({ otherDirectory });
+    size_t count = 0;
+    EXPECT_TRUE(cache.fetch(key, outputs, nullptr, &count));
+    EXPECT_EQ(count, 1);
+    EXPECT_EQ(readFile(otherDirectory + "mine.png"), "mine");
+    EXPECT_FALSE((otherDirectory + "theirs.png").exists());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_UTILS_TEST_TEMPORARYDIRECTORYTEST_H
+#define TNT_UTILS_TEST_TEMPORARYDIRECTORYTEST_H
+
+#include <utils/Path.h>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <system_error>
+
+/**
+ * A test fixture for tests that write files: each test gets its own empty directory, mRoot,
+ * which is removed with everything in it when the test ends, whether it passed or not.
+ */
+class TemporaryDirectoryTest : public testing::Test {
+protected:
+    void SetUp() override {
+        testing::TestInfo const* info = testing::UnitTest::GetInstance()->current_test_info();
+        std::random_device rd;
+        mRoot = utils::Path::getTemporaryDirectory() + (std::string(info->test_suite_name()) +
+                "_" + info->name() + "_" + std::to_string(rd()));
+        ASSERT_TRUE(mRoot.mkdirRecursive()) << mRoot;
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(mRoot.getPath(), ec);
+        EXPECT_FALSE(ec) << "Unable to remove " << mRoot << ": " << ec.message();
+    }
+
+    utils::Path mRoot;
+};
+
+#endif // TNT_UTILS_TEST_TEMPORARYDIRECTORYTEST_H
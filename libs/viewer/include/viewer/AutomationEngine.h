@@ -19,6 +19,9 @@
 
 #include <viewer/AutomationSpec.h>
 
+#include <future>
+#include <vector>
+
 namespace filament {
 
 class ColorGrading;
@@ -212,9 +215,10 @@ public:
     void setOptions(Options options) { mOptions = options; }
 
     /**
-     * Returns true if automation is in batch mode and all tests have finished.
+     * Returns true if automation is in batch mode and all tests have finished, including the
+     * writing of their screenshots.
      */
-    bool shouldClose() const { return mShouldClose; }
+    bool shouldClose() const;
 
     /**
      * Convenience function that writes out a JSON file to disk containing all settings.
@@ -224,6 +228,11 @@ public:
      */
     static void exportSettings(const Settings& settings, const char* filename);
 
+    /**
+     * Requests an asynchronous screenshot of the given view. Once the pixels are read back, the
+     * PPM file is written on a separate thread, so that the render thread isn't blocked by the
+     * file system.
+     */
     static void exportScreenshot(View* view, Renderer* renderer, std::string filename,
             bool autoclose, AutomationEngine* automationEngine);
 
@@ -255,10 +264,14 @@ private:
     bool mTerminated = false;
     bool mOwnsSettings = false;
 
+    // Screenshots being written, destroying the futures waits for them.
+    std::vector<std::future<void>> mScreenshotWrites;
+
 public:
     // For internal use from a screenshot callback.
     void requestClose() { mShouldClose = true; }
     bool isTerminated() const { return mTerminated; }
+    void addScreenshotWrite(std::future<void> write);
 };
 
 } // namespace viewer
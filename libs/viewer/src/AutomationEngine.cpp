@@ -26,6 +26,8 @@
 #include <utils/Log.h>
 #include <utils/Path.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <fstream>
 #include <sstream>
@@ -75,15 +77,20 @@ void AutomationEngine::exportScreenshot(View* view, Renderer* renderer, std::str
             }
             const Viewport& vp = state->view->getViewport();
 
-            // ReadPixels on Metal only supports RGBA, but the PPM format only supports RGB.
-            // So, manually perform a quick transformation here.
-            convertRGBAtoRGB(buffer, vp.width, vp.height);
-
-            Path out(state->filename);
-            std::ofstream ppmStream(out);
-            ppmStream << "P6 " << vp.width << " " << vp.height << " " << 255 << std::endl;
-            ppmStream.write(static_cast<char*>(buffer), vp.width * vp.height * 3);
-            delete[] static_cast<uint8_t*>(buffer);
+            // Don't hold up the thread that renders frames with the file system, write from another.
+            state->engine->addScreenshotWrite(std::async(std::launch::async,
+                    [buffer, width = vp.width, height = vp.height,
+                            filename = std::move(state->filename)]() {
+                // ReadPixels on Metal only supports RGBA, but the PPM format only supports RGB.
+                // So, manually perform a quick transformation here.
+                convertRGBAtoRGB(buffer, width, height);
+
+                Path out(filename);
+                std::ofstream ppmStream(out);
+                ppmStream << "P6 " << width << " " << height << " " << 255 << std::endl;
+                ppmStream.write(static_cast<char*>(buffer), width * height * 3);
+                delete[] static_cast<uint8_t*>(buffer);
+            }));
             if (state->autoclose) {
                 state->engine->requestClose();
             }
@@ -143,6 +150,22 @@ void AutomationEngine::terminate() {
     mTerminated = true;
 }
 
+bool AutomationEngine::shouldClose() const {
+    return mShouldClose && std::all_of(mScreenshotWrites.begin(), mScreenshotWrites.end(),
+            [](std::future<void> const& write) {
+                return write.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            });
+}
+
+void AutomationEngine::addScreenshotWrite(std::future<void> write) {
+    // forget about the writes that are done
+    mScreenshotWrites.erase(std::remove_if(mScreenshotWrites.begin(), mScreenshotWrites.end(),
+            [](std::future<void> const& write) {
+                return write.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            }), mScreenshotWrites.end());
+    mScreenshotWrites.push_back(std::move(write));
+}
+
 void AutomationEngine::exportSettings(const Settings& settings, const char* filename) {
     JsonSerializer serializer;
     std::string contents = serializer.writeJson(settings);
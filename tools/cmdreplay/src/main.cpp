@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <private/backend/CommandBufferQueue.h>
+#include <private/backend/CommandStream.h>
+#include <private/backend/CommandStreamCapture.h>
+#include <private/backend/Driver.h>
+#include <private/backend/PlatformFactory.h>
+
+#include <backend/DriverEnums.h>
+#include <backend/Platform.h>
+
+#include <getopt/getopt.h>
+
+#include <utils/Path.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace filament::backend;
+
+using Clock = std::chrono::steady_clock;
+using Duration = std::chrono::duration<double, std::milli>;
+
+static Backend g_backend = Backend::NOOP;
+static int g_iterations = 1;
+static bool g_verbose = false;
+
+// Same sizes as the default Engine::Config
+static constexpr size_t REQUIRED_SIZE = 2u * 1024u * 1024u;
+static constexpr size_t BUFFER_SIZE = 3u * REQUIRED_SIZE;
+
+static void printUsage(const char* name) {
+    std::string execName(utils::Path(name).getName());
+    std::string usage(
+            "CMDREPLAY replays a Filament backend command stream capture\n"
+            "Usage:\n"
+            "    CMDREPLAY [options] <capture.fcs>\n"
+            "\n"
+            "Options:\n"
+            "   --help, -h\n"
+            "       Print this message\n\n"
+            "   --license\n"
+            "       Print copyright and license information\n\n"
+            "   --api, -a\n"
+            "       Backend to replay on: noop (default), opengl, vulkan, metal\n\n"
+            "   --iterations=[count], -i [count]\n"
+            "       Number of times the capture is replayed, 1 by default\n\n"
+            "   --verbose, -v\n"
+            "       Print the number of recorded commands of each type\n\n"
+    );
+
+    const std::string from("CMDREPLAY");
+    for (size_t pos = usage.find(from); pos != std::string::npos; pos = usage.find(from, pos)) {
+        usage.replace(pos, from.length(), execName);
+    }
+    printf("%s", usage.c_str());
+}
+
+static void license() {
+    static const char *license[] = {
+        #include "licenses/licenses.inc"
+        nullptr
+    };
+
+    const char **p = &license[0];
+    while (*p)
+        std::cout << *p++ << std::endl;
+}
+
+static int handleArguments(int argc, char* argv[]) {
+    static constexpr const char* OPTSTR = "hla:i:v";
+    static const struct option OPTIONS[] = {
+        { "help",       no_argument,       nullptr, 'h' },
+        { "license",    no_argument,       nullptr, 'l' },
+        { "api",        required_argument, nullptr, 'a' },
+        { "iterations", required_argument, nullptr, 'i' },
+        { "verbose",    no_argument,       nullptr, 'v' },
+        { nullptr, 0, nullptr, 0 }  // termination of the option list
+    };
+
+    int opt;
+    int optionIndex = 0;
+
+    while ((opt = getopt_long(argc, argv, OPTSTR, OPTIONS, &optionIndex)) >= 0) {
+        std::string arg(optarg ? optarg : "");
+        switch (opt) {
+            default:
+            case 'h':
+                printUsage(argv[0]);
+                exit(0);
+            case 'l':
+                license();
+                exit(0);
+            case 'a':
+                if (arg == "noop") {
+                    g_backend = Backend::NOOP;
+                } else if (arg == "opengl") {
+                    g_backend = Backend::OPENGL;
+                } else if (arg == "vulkan") {
+                    g_backend = Backend::VULKAN;
+                } else if (arg == "metal") {
+                    g_backend = Backend::METAL;
+                } else {
+                    std::cerr << "Unrecognized backend: " << arg << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'i':
+                g_iterations = std::max(1, atoi(arg.c_str()));
+                break;
+            case 'v':
+                g_verbose = true;
+                break;
+        }
+    }
+
+    return optind;
+}
+
+struct Timings {
+    Duration record{};
+    Duration execute{};
+    size_t commands = 0;
+};
+
+static void executeCommands(CommandBufferQueue& queue, CommandStream& driverApi,
+        Driver& driver, Timings& timings) {
+    if (queue.getCircularBuffer().empty()) {
+        return;
+    }
+    queue.flush();
+    auto const buffers = queue.waitForCommands();
+    Clock::time_point const start = Clock::now();
+    for (auto const& item : buffers) {
+        if (item.begin) {
+            driverApi.execute(item.begin);
+            queue.releaseBuffer(item);
+        }
+    }
+    timings.execute += Clock::now() - start;
+    // run the BufferDescriptor callbacks
+    driver.purge();
+}
+
+int main(int argc, char* argv[]) {
+    int const optionIndex = handleArguments(argc, argv);
+    if (optionIndex >= argc) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    CommandStreamReplay replay = CommandStreamReplay::load(argv[optionIndex]);
+    if (!replay.isValid()) {
+        std::cerr << "Not a command stream capture: " << argv[optionIndex] << std::endl;
+        return 1;
+    }
+
+    Backend backend = g_backend;
+    Platform* platform = PlatformFactory::create(&backend);
+    if (!platform || backend != g_backend) {
+        std::cerr << "Backend not supported: " << backendToString(g_backend) << std::endl;
+        return 1;
+    }
+
+    Driver* driver = platform->createDriver(nullptr, {});
+    if (!driver) {
+        std::cerr << "Could not create the driver" << std::endl;
+        PlatformFactory::destroy(&platform);
+        return 1;
+    }
+
+    {
+        CommandBufferQueue queue(REQUIRED_SIZE, BUFFER_SIZE, false);
+        CommandStream driverApi(*driver, queue.getCircularBuffer());
+
+        std::array<size_t, size_t(CommandId::COUNT)> histogram{};
+        Timings total;
+
+        // the preamble re-creates the resources used by the frame, only once
+        Timings preamble;
+        while (replay.inPreamble()) {
+            if (replay.replayNextCommand(driverApi) == CommandId::COUNT) {
+                break;
+            }
+            preamble.commands++;
+            if (queue.getCircularBuffer().getUsed() > REQUIRED_SIZE / 2) {
+                executeCommands(queue, driverApi, *driver, preamble);
+            }
+        }
+        executeCommands(queue, driverApi, *driver, preamble);
+        if (preamble.commands) {
+            printf("preamble: %zu commands re-creating the resources, execute %.3f ms\n",
+                    preamble.commands, preamble.execute.count());
+        }
+
+        for (int i = 0; i < g_iterations; i++) {
+            Timings timings;
+            replay.rewindToFrame();
+            while (!replay.done()) {
+                Clock::time_point const start = Clock::now();
+                CommandId const id = replay.replayNextCommand(driverApi);
+                timings.record += Clock::now() - start;
+                if (id == CommandId::COUNT) {
+                    break;
+                }
+                timings.commands++;
+                if (i == 0) {
+                    histogram[size_t(id)]++;
+                }
+                // leave enough room for the next command and its DescriptorSetOffsetArray
+                if (id == CommandId::endFrame ||
+                        queue.getCircularBuffer().getUsed() > REQUIRED_SIZE / 2) {
+                    executeCommands(queue, driverApi, *driver, timings);
+                }
+            }
+            executeCommands(queue, driverApi, *driver, timings);
+
+            if (g_iterations > 1) {
+                printf("iteration %d: %zu commands, record %.3f ms, execute %.3f ms\n",
+                        i, timings.commands, timings.record.count(), timings.execute.count());
+            }
+            total.record += timings.record;
+            total.execute += timings.execute;
+            total.commands += timings.commands;
+        }
+
+        if (g_verbose) {
+            for (size_t i = 0; i < histogram.size(); i++) {
+                if (histogram[i]) {
+                    printf("%8zu %s\n", histogram[i], getCommandName(CommandId(i)));
+                }
+            }
+        }
+
+        if (replay.getUnresolvedHandleCount()) {
+            printf("%zu handles created before the capture started were replayed as null\n",
+                    replay.getUnresolvedHandleCount());
+        }
+
+        double const n = double(g_iterations);
+        double const commandsPerIteration = double(total.commands) / n;
+        printf("backend %s, %d iteration(s), %.0f commands per iteration\n",
+                backendToString(backend), g_iterations, commandsPerIteration);
+        printf("record  : %.3f ms per iteration, %.1f ns per command\n",
+                total.record.count() / n,
+                total.record.count() * 1e6 / double(std::max(size_t(1), total.commands)));
+        printf("execute : %.3f ms per iteration, %.1f ns per command\n",
+                total.execute.count() / n,
+                total.execute.count() * 1e6 / double(std::max(size_t(1), total.commands)));
+
+        driverApi.terminate();
+    }
+
+    driver->purge();
+    delete driver;
+    PlatformFactory::destroy(&platform);
+    return 0;
+}
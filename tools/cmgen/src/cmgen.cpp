@@ -14,8 +14,6 @@
  * limitations under the License.
  */
 
-#include "ProgressUpdater.h"
-
 #include <ibl/Cubemap.h>
 #include <ibl/CubemapIBL.h>
 #include <ibl/CubemapSH.h>
@@ -23,12 +21,17 @@
 #include <ibl/Image.h>
 #include <ibl/utilities.h>
 
+#include <iblbaker/CubemapExport.h>
+#include <iblbaker/ProgressUpdater.h>
+
 #include <imageio/ImageDecoder.h>
 #include <imageio/ImageEncoder.h>
 
 #include <image/Ktx1Bundle.h>
 #include <image/ColorTransform.h>
 
+#include <toolcache/ContentCache.h>
+
 #include <utils/JobSystem.h>
 #include <utils/Path.h>
 #include <utils/algorithm.h>
@@ -49,8 +52,11 @@
 
 using namespace filament::math;
 using namespace filament::ibl;
+using namespace filament::iblbaker;
 using namespace image;
 
+using filament::toolcache::ContentCache;
+
 // -----------------------------------------------------------------------------------------------
 
 enum class ShFile {
@@ -108,6 +114,14 @@ static size_t g_num_samples = 1024;
 
 static bool g_mirror = false;
 
+static utils::Path g_cache_dir = ContentCache::getDefaultDirectory();
+
+// Text output that is part of the results (e.g. SH coefficients), replayed on cache hits.
+static std::string g_log;
+
+// Files written by this run, the only ones stored in the cache.
+static std::vector<utils::Path> g_output_files;
+
 // -----------------------------------------------------------------------------------------------
 
 static void generateMipmaps(utils::JobSystem& js, std::vector<Cubemap>& levels,
@@ -133,10 +147,11 @@ static void outputBinarySh(std::ostream& out, const std::unique_ptr<filament::ma
         size_t numBands);
 static void UTILS_UNUSED outputSpectrum(std::ostream& out,
         const std::unique_ptr<filament::math::float3[]>& sh, size_t numBands);
+static std::ofstream openOutput(const std::string& path, std::ios::openmode mode);
 static void saveImage(const std::string& path, ImageEncoder::Format format, const Image& image,
         const std::string& compression);
-static LinearImage toLinearImage(const Image& image);
-static void exportKtxFaces(Ktx1Bundle& container, uint32_t miplevel, const Cubemap& cm);
+static void saveFaces(utils::JobSystem& js, const utils::Path& dir, const std::string& prefix,
+        const std::string& ext, const Cubemap& cm);
 
 // -----------------------------------------------------------------------------------------------
 
@@ -224,6 +239,9 @@ static void printUsage(char* name) {
             "       SH windowing to reduce ringing\n\n"
             "   --debug, -d\n"
             "       Generate extra data for debugging\n\n"
+            "   --cache=dir\n"
+            "       Reuse the outputs of a previous identical run stored in the cache <dir>,\n"
+            "       or store them there. Defaults to $FILAMENT_TOOL_CACHE if set\n\n"
     );
     const std::string from("CMGEN");
     for (size_t pos = usage.find(from); pos != std::string::npos; pos = usage.find(from, pos)) {
@@ -273,6 +291,7 @@ static int handleCommandLineArgments(int argc, char* argv[]) {
             { "deploy",               required_argument, nullptr, 'x' },
             { "no-mirror",                  no_argument, nullptr, 'm' },
             { "debug",                      no_argument, nullptr, 'd' },
+            { "cache",                required_argument, nullptr, 'X' },
             { nullptr, 0, nullptr, 0 }  // termination of the option list
     };
     int opt;
@@ -452,6 +471,9 @@ static int handleCommandLineArgments(int argc, char* argv[]) {
             case 'm':
                 g_mirror = true;
                 break;
+            case 'X':
+                g_cache_dir = arg;
+                break;
         }
     }
 
@@ -474,6 +496,56 @@ static int handleCommandLineArgments(int argc, char* argv[]) {
     return optind;
 }
 
+// Describes everything that determines the outputs: the input and all the options except the
+// output directories. The names of output files matter because they determine their format.
+static bool createCacheKey(ContentCache::Key& key, int num_args, char* argv[], int option_index) {
+    if (num_args >= 1) {
+        utils::Path iname(argv[option_index]);
+        key.add("input-name", iname.getName());
+        if (iname.exists() && !key.addFile("input", iname)) {
+            return false;
+        }
+    }
+    key.add("type", int(g_type))
+        .add("format", int(g_format))
+        .add("compression", g_compression)
+        .add("extract", g_extract_faces)
+        .add("extract-blur", g_extract_blur)
+        .add("size", g_output_size)
+        .add("min-lod-size", g_min_lod_size)
+        .add("debug", g_debug)
+        .add("sh", g_sh_compute)
+        .add("sh-output", g_sh_output)
+        .add("sh-shader", g_sh_shader)
+        .add("sh-irradiance", g_sh_irradiance)
+        .add("sh-window", g_sh_window)
+        .add("clamp", !g_noclamp)
+        .add("sh-file", int(g_sh_file))
+        .add("sh-filename", g_sh_filename.getName())
+        .add("ibl-is-mipmap", g_is_mipmap)
+        .add("ibl-ld", g_prefilter)
+        .add("ibl-dfg", g_dfg)
+        .add("ibl-dfg-filename", g_dfg_filename.getName())
+        .add("ibl-dfg-multiscatter", g_dfg_multiscatter)
+        .add("ibl-dfg-cloth", g_dfg_cloth)
+        .add("ibl-irradiance", g_ibl_irradiance)
+        .add("ibl-no-prefilter", g_ibl_no_prefilter)
+        .add("deploy", g_deploy)
+        .add("ibl-samples", g_num_samples)
+        .add("no-mirror", g_mirror);
+    return true;
+}
+
+static ContentCache::Outputs getCacheOutputs() {
+    // debug images are written next to the SH file
+    return ContentCache::Outputs({
+            g_deploy_dir, g_extract_dir, g_is_mipmap_dir, g_prefilter_dir, g_ibl_irradiance_dir,
+            g_sh_filename, g_debug && !g_sh_filename.isEmpty() ? g_sh_filename.getParent() : "",
+            g_dfg_filename });
+}
+
+static int generate(utils::JobSystem& js, int num_args, char* argv[], int option_index);
+
 int main(int argc, char* argv[]) {
     utils::JobSystem js;
     js.adopt();
@@ -485,6 +557,53 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    if (g_cache_dir.isEmpty()) {
+        return generate(js, num_args, argv, option_index);
+    }
+
+    std::string const& version = ContentCache::getExecutableVersion();
+    if (version.empty()) {
+        std::cerr << "Unable to read the cmgen executable, the cache is not used." << std::endl;
+        return generate(js, num_args, argv, option_index);
+    }
+
+    ContentCache::Key key("cmgen", version);
+    if (!createCacheKey(key, num_args, argv, option_index)) {
+        std::cerr << "Unable to read the input, the cache is not used." << std::endl;
+        return generate(js, num_args, argv, option_index);
+    }
+
+    ContentCache cache(g_cache_dir);
+    ContentCache::Outputs outputs = getCacheOutputs();
+    std::string log;
+    size_t count = 0;
+    if (cache.fetch(key, outputs, &log, &count)) {
+        if (!g_quiet) {
+            std::cout << log;
+            std::cout << "Cache hit: restored " << count << " file(s) from entry "
+                      << key.getDigest() << std::endl;
+        }
+        return 0;
+    }
+
+    int result = generate(js, num_args, argv, option_index);
+    if (result == 0) {
+        for (utils::Path const& file : g_output_files) {
+            outputs.add(file);
+        }
+        if (cache.store(key, outputs, g_log, &count)) {
+            if (!g_quiet) {
+                std::cout << "Cache miss: stored " << count << " file(s) in entry "
+                          << key.getDigest() << std::endl;
+            }
+        } else {
+            std::cerr << "Unable to store the outputs in the cache " << g_cache_dir << std::endl;
+        }
+    }
+    return result;
+}
+
+int generate(utils::JobSystem& js, int num_args, char* argv[], int option_index) {
     if (g_dfg) {
         if (!g_quiet) {
             std::cout << "Generating IBL DFG LUT..." << std::endl;
@@ -737,8 +856,13 @@ void sphericalHarmonics(utils::JobSystem& js, const utils::Path& iname, const Cu
         CubemapSH::preprocessSHForShader(sh);
     }
 
-    if (!g_quiet && g_sh_output) {
-        outputSh(std::cout, sh, g_sh_compute);
+    if (g_sh_output) {
+        std::ostringstream text;
+        outputSh(text, sh, g_sh_compute);
+        g_log += text.str();
+        if (!g_quiet) {
+            std::cout << text.str();
+        }
     }
 
     if (g_sh_file != ShFile::SH_NONE || g_debug) {
@@ -775,10 +899,11 @@ void sphericalHarmonics(utils::JobSystem& js, const utils::Path& iname, const Cu
                 saveImage(g_sh_filename, ImageEncoder::chooseFormat(
                         g_sh_filename.getName()), outputImage, g_compression);
             } else if (g_sh_file == ShFile::SH_TEXT) {
-                std::ofstream outputStream(g_sh_filename, std::ios::trunc);
+                std::ofstream outputStream = openOutput(g_sh_filename, std::ios::trunc);
                 outputSh(outputStream, sh, g_sh_compute);
             } else if (g_sh_file == ShFile::SH_BIN) {
-                std::ofstream outputStream(g_sh_filename, std::ios::trunc | std::ios::binary);
+                std::ofstream outputStream = openOutput(g_sh_filename,
+                        std::ios::trunc | std::ios::binary);
                 outputBinarySh(outputStream, sh, g_sh_compute);
             }
         }
@@ -896,28 +1021,10 @@ void iblMipmapPrefilter(utils::JobSystem& js, const utils::Path& iname,
             continue;
         }
 
-        for (size_t i = 0; i < 6; i++) {
-            Cubemap::Face face = (Cubemap::Face)i;
-            std::string filename = outputDir
-                    + ("is_m" + std::to_string(level) + "_" + CubemapUtils::getFaceName(face) + ext);
-            saveImage(filename, g_format, dst.getImageForFace(face), g_compression);
-        }
+        saveFaces(js, outputDir, "is_m" + std::to_string(level) + "_", ext, dst);
     }
 }
 
-static float lodToPerceptualRoughness(float lod) noexcept {
-    // Inverse perceptualRoughness-to-LOD mapping:
-    // The LOD-to-perceptualRoughness mapping is a quadratic fit for
-    // log2(perceptualRoughness)+iblMaxMipLevel when iblMaxMipLevel is 4.
-    // We found empirically that this mapping works very well for a 256 cubemap with 5 levels used,
-    // but also scales well for other iblMaxMipLevel values.
-    const float a = 2.0f;
-    const float b = -1.0f;
-    return (lod != 0)
-            ? saturate((std::sqrt(a * a + 4.0f * b * lod) - a) / (2.0f * b))
-            : 0.0f;
-}
-
 void iblRoughnessPrefilter(
         utils::JobSystem& js, const utils::Path& iname, const std::vector<Cubemap>& levels,
         bool prefilter, const utils::Path& dir) {
@@ -946,17 +1053,7 @@ void iblRoughnessPrefilter(
     // It's convenient to create an empty KTX bundle on the stack in this scope, regardless of
     // whether KTX is requested. It does not consume memory if empty.
     Ktx1Bundle container((uint32_t) numLevels, 1, true);
-    container.info() = {
-        .endianness = Ktx1Bundle::ENDIAN_DEFAULT,
-        .glType = Ktx1Bundle::R11F_G11F_B10F,
-        .glTypeSize = 1,
-        .glFormat = Ktx1Bundle::RGB,
-        .glInternalFormat = Ktx1Bundle::R11F_G11F_B10F,
-        .glBaseInternalFormat = Ktx1Bundle::R11F_G11F_B10F,
-        .pixelWidth = 1U << baseExp,
-        .pixelHeight = 1U << baseExp,
-        .pixelDepth = 0,
-    };
+    initKtxCubemap(container, 1U << baseExp);
 
     for (ssize_t i = baseExp; i >= ssize_t((baseExp + 1) - numLevels) ; --i) {
         const size_t dim = 1U << (DEBUG_FULL_RESOLUTION ? baseExp : i); // NOLINT
@@ -1031,12 +1128,7 @@ void iblRoughnessPrefilter(
             continue;
         }
 
-        for (size_t j = 0; j < 6; j++) {
-            Cubemap::Face face = (Cubemap::Face) j;
-            std::string filename = outputDir
-                    + ("m" + std::to_string(level) + "_" + CubemapUtils::getFaceName(face) + ext);
-            saveImage(filename, g_format, dst.getImageForFace(face), g_compression);
-        }
+        saveFaces(js, outputDir, "m" + std::to_string(level) + "_", ext, dst);
     }
 
     if (g_type == OutputType::KTX) {
@@ -1054,7 +1146,7 @@ void iblRoughnessPrefilter(
         container.serialize(fileContents.data(), (uint32_t) fileContents.size());
         std::string filename = dir.getNameWithoutExtension() + "_ibl.ktx";
         auto fullpath = outputDir + filename;
-        std::ofstream outputStream(fullpath.c_str(), std::ios::out | std::ios::binary);
+        std::ofstream outputStream = openOutput(fullpath, std::ios::out | std::ios::binary);
         outputStream.write((const char*) fileContents.data(), fileContents.size());
         outputStream.close();
     }
@@ -1158,7 +1250,7 @@ void iblLutDfg(utils::JobSystem& js, const utils::Path& filename, size_t size, b
 
     if (isTextFile(filename)) {
         const bool isInclude = isIncludeFile(filename);
-        std::ofstream outputStream(filename, std::ios::trunc);
+        std::ofstream outputStream = openOutput(filename, std::ios::trunc);
 
         outputStream << "// generated with: cmgen --ibl-dfg=" << filename.c_str() << std::endl;
         outputStream << "// DFG LUT stored as an RG16F texture, in GL order" << std::endl;
@@ -1205,23 +1297,13 @@ void extractCubemapFaces(utils::JobSystem& js, const utils::Path& iname, const C
     if (g_type == OutputType::KTX) {
         const uint32_t dim = (const uint32_t) cm.getDimensions();
         Ktx1Bundle container(1, 1, true);
-        container.info() = {
-            .endianness = Ktx1Bundle::ENDIAN_DEFAULT,
-            .glType = Ktx1Bundle::R11F_G11F_B10F,
-            .glTypeSize = 1,
-            .glFormat = Ktx1Bundle::RGB,
-            .glInternalFormat = Ktx1Bundle::R11F_G11F_B10F,
-            .glBaseInternalFormat = Ktx1Bundle::R11F_G11F_B10F,
-            .pixelWidth = dim,
-            .pixelHeight = dim,
-            .pixelDepth = 0,
-        };
+        initKtxCubemap(container, dim);
         exportKtxFaces(container, 0, cm);
         std::string filename = dir.getNameWithoutExtension() + "_skybox.ktx";
         auto fullpath = outputDir + filename;
         std::vector<uint8_t> fileContents(container.getSerializedLength());
         container.serialize(fileContents.data(), (uint32_t) fileContents.size());
-        std::ofstream outputStream(fullpath.c_str(), std::ios::out | std::ios::binary);
+        std::ofstream outputStream = openOutput(fullpath, std::ios::out | std::ios::binary);
         outputStream.write((const char*) fileContents.data(), fileContents.size());
         outputStream.close();
         return;
@@ -1247,53 +1329,37 @@ void extractCubemapFaces(utils::JobSystem& js, const utils::Path& iname, const C
         return;
     }
 
-    for (size_t i = 0; i < 6; i++) {
-        Cubemap::Face face = (Cubemap::Face) i;
-        std::string filename(outputDir + (CubemapUtils::getFaceName(face) + ext));
-        saveImage(filename, g_format, cm.getImageForFace(face), g_compression);
-    }
+    saveFaces(js, outputDir, "", ext, cm);
 }
 
 // Converts a cmgen Image into a libimage LinearImage
-static LinearImage toLinearImage(const Image& image) {
-    LinearImage linearImage((uint32_t) image.getWidth(), (uint32_t) image.getHeight(), 3);
-
-    // Copy row by row since the image has padding.
-    assert(image.getBytesPerPixel() == 12);
-    const size_t w = image.getWidth(), h = image.getHeight();
-    for (size_t row = 0; row < h; ++row) {
-        float* dst = linearImage.getPixelRef(0, (uint32_t) row);
-        float const* src = static_cast<float const*>(image.getPixelRef(0, row));
-        memcpy(dst, src, w * 12);
-    }
-    return linearImage;
+static std::ofstream openOutput(const std::string& path, std::ios::openmode mode) {
+    g_output_files.emplace_back(path);
+    return std::ofstream(path, mode);
 }
 
 static void saveImage(const std::string& path, ImageEncoder::Format format, const Image& image,
         const std::string& compression) {
-    std::ofstream outputStream(path, std::ios::binary | std::ios::trunc);
+    std::ofstream outputStream = openOutput(path, std::ios::binary | std::ios::trunc);
     if (!ImageEncoder::encode(outputStream, format, toLinearImage(image), compression, path)) {
         exit(1);
     }
 }
 
-static void exportKtxFaces(Ktx1Bundle& container, uint32_t miplevel, const Cubemap& cm) {
-    auto& info = container.info();
-    const uint32_t dim = (const uint32_t) cm.getDimensions();
-    for (uint32_t j = 0; j < 6; j++) {
-        KtxBlobIndex blobIndex {(uint32_t) miplevel, 0, j};
-        Cubemap::Face face;
-        switch (j) {
-            case 0: face = Cubemap::Face::PX; break;
-            case 1: face = Cubemap::Face::NX; break;
-            case 2: face = Cubemap::Face::PY; break;
-            case 3: face = Cubemap::Face::NY; break;
-            case 4: face = Cubemap::Face::PZ; break;
-            case 5: face = Cubemap::Face::NZ; break;
-            default: face = Cubemap::Face::PX; break; // make linters happy
-        }
-        LinearImage image = toLinearImage(cm.getImageForFace(face));
-        auto uintData = fromLinearToRGB_10_11_11_REV(image);
-        container.setBlob(blobIndex, uintData.get(), dim * dim * 4);
+// Encodes the six faces of a cubemap concurrently
+static void saveFaces(utils::JobSystem& js, const utils::Path& dir, const std::string& prefix,
+        const std::string& ext, const Cubemap& cm) {
+    std::ofstream outputStreams[6];
+    ImageEncoder::Request requests[6];
+    for (size_t i = 0; i < 6; i++) {
+        Cubemap::Face face = (Cubemap::Face) i;
+        std::string filename = dir + (prefix + CubemapUtils::getFaceName(face) + ext);
+        outputStreams[i] = openOutput(filename, std::ios::binary | std::ios::trunc);
+        requests[i] = { &outputStreams[i], g_format, toLinearImage(cm.getImageForFace(face)),
+                g_compression, filename };
+    }
+    if (!ImageEncoder::encode(js, requests, 6)) {
+        exit(1);
     }
 }
+
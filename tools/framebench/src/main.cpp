@@ -0,0 +1,544 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filament/Box.h>
+#include <filament/Camera.h>
+#include <filament/Engine.h>
+#include <filament/IndexBuffer.h>
+#include <filament/LightManager.h>
+#include <filament/Material.h>
+#include <filament/RenderableManager.h>
+#include <filament/Renderer.h>
+#include <filament/Scene.h>
+#include <filament/SwapChain.h>
+#include <filament/TransformManager.h>
+#include <filament/VertexBuffer.h>
+#include <filament/View.h>
+#include <filament/Viewport.h>
+
+#include <gltfio/AssetLoader.h>
+#include <gltfio/FilamentAsset.h>
+#include <gltfio/MaterialProvider.h>
+#include <gltfio/ResourceLoader.h>
+#include <gltfio/TextureProvider.h>
+
+#include "materials/uberarchive.h"
+
+#include <getopt/getopt.h>
+
+#include <utils/EntityManager.h>
+#include <utils/NameComponentManager.h>
+#include <utils/Path.h>
+
+#include <math/mat4.h>
+#include <math/scalar.h>
+#include <math/vec3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace filament;
+using namespace filament::math;
+using namespace filament::gltfio;
+using namespace utils;
+
+using Clock = std::chrono::steady_clock;
+using Duration = std::chrono::duration<double, std::milli>;
+
+static constexpr uint32_t WIDTH = 1920;
+static constexpr uint32_t HEIGHT = 1080;
+
+static size_t g_renderableCount = 1000;
+static size_t g_lightCount = 64;
+static size_t g_shadowCasterCount = 100;
+static size_t g_frameCount = 300;
+static size_t g_warmupFrameCount = 30;
+static std::string g_jsonPath;
+
+static void printUsage(const char* name) {
+    std::string execName(utils::Path(name).getName());
+    std::string usage(
+            "FRAMEBENCH measures the CPU cost of rendering frames with the noop backend\n"
+            "Usage:\n"
+            "    FRAMEBENCH [options] [scene.gltf|scene.glb]\n"
+            "\n"
+            "Without a glTF file, a procedural scene is generated.\n"
+            "\n"
+            "Options:\n"
+            "   --help, -h\n"
+            "       Print this message\n\n"
+            "   --license\n"
+            "       Print copyright and license information\n\n"
+            "   --renderables=[count], -n [count]\n"
+            "       Number of renderables of the procedural scene, 1000 by default\n\n"
+            "   --lights=[count], -l [count]\n"
+            "       Number of point lights, 64 by default\n\n"
+            "   --shadow-casters=[count], -s [count]\n"
+            "       Number of renderables casting shadows from the sun, 100 by default\n\n"
+            "   --frames=[count], -f [count]\n"
+            "       Number of measured frames along the camera path, 300 by default\n\n"
+            "   --warmup=[count], -w [count]\n"
+            "       Number of frames rendered before measuring, 30 by default\n\n"
+            "   --json=[path], -j [path]\n"
+            "       Write the results as JSON to the given file\n\n"
+    );
+
+    const std::string from("FRAMEBENCH");
+    for (size_t pos = usage.find(from); pos != std::string::npos; pos = usage.find(from, pos)) {
+        usage.replace(pos, from.length(), execName);
+    }
+    printf("%s", usage.c_str());
+}
+
+static void license() {
+    static const char *license[] = {
+        #include "licenses/licenses.inc"
+        nullptr
+    };
+
+    const char **p = &license[0];
+    while (*p)
+        std::cout << *p++ << std::endl;
+}
+
+static int handleArguments(int argc, char* argv[]) {
+    static constexpr const char* OPTSTR = "hLn:l:s:f:w:j:";
+    static const struct option OPTIONS[] = {
+        { "help",           no_argument,       nullptr, 'h' },
+        { "license",        no_argument,       nullptr, 'L' },
+        { "renderables",    required_argument, nullptr, 'n' },
+        { "lights",         required_argument, nullptr, 'l' },
+        { "shadow-casters", required_argument, nullptr, 's' },
+        { "frames",         required_argument, nullptr, 'f' },
+        { "warmup",         required_argument, nullptr, 'w' },
+        { "json",           required_argument, nullptr, 'j' },
+        { nullptr, 0, nullptr, 0 }  // termination of the option list
+    };
+
+    int opt;
+    int optionIndex = 0;
+
+    while ((opt = getopt_long(argc, argv, OPTSTR, OPTIONS, &optionIndex)) >= 0) {
+        std::string arg(optarg ? optarg : "");
+        switch (opt) {
+            default:
+            case 'h':
+                printUsage(argv[0]);
+                exit(0);
+            case 'L':
+                license();
+                exit(0);
+            case 'n':
+                g_renderableCount = std::max(0, atoi(arg.c_str()));
+                break;
+            case 'l':
+                g_lightCount = std::max(0, atoi(arg.c_str()));
+                break;
+            case 's':
+                g_shadowCasterCount = std::max(0, atoi(arg.c_str()));
+                break;
+            case 'f':
+                g_frameCount = std::max(1, atoi(arg.c_str()));
+                break;
+            case 'w':
+                g_warmupFrameCount = std::max(0, atoi(arg.c_str()));
+                break;
+            case 'j':
+                g_jsonPath = arg;
+                break;
+        }
+    }
+
+    return optind;
+}
+
+// ------------------------------------------------------------------------------------------------
+
+struct ProceduralScene {
+    VertexBuffer* vertexBuffer = nullptr;
+    IndexBuffer* indexBuffer = nullptr;
+    std::vector<Entity> entities;
+
+    void create(Engine& engine, Scene& scene) {
+        static const float3 vertices[8] = {
+                { -1, -1, -1 }, {  1, -1, -1 }, { -1,  1, -1 }, {  1,  1, -1 },
+                { -1, -1,  1 }, {  1, -1,  1 }, { -1,  1,  1 }, {  1,  1,  1 },
+        };
+        static const uint16_t indices[36] = {
+                0, 1, 3,  0, 3, 2,  4, 6, 7,  4, 7, 5,  0, 2, 6,  0, 6, 4,
+                1, 5, 7,  1, 7, 3,  0, 4, 5,  0, 5, 1,  2, 3, 7,  2, 7, 6,
+        };
+
+        vertexBuffer = VertexBuffer::Builder()
+                .vertexCount(8)
+                .bufferCount(1)
+                .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+                .build(engine);
+        vertexBuffer->setBufferAt(engine, 0, { vertices, sizeof(vertices) });
+
+        indexBuffer = IndexBuffer::Builder()
+                .indexCount(36)
+                .bufferType(IndexBuffer::IndexType::USHORT)
+                .build(engine);
+        indexBuffer->setBuffer(engine, { indices, sizeof(indices) });
+
+        EntityManager& em = EntityManager::get();
+        TransformManager& tcm = engine.getTransformManager();
+        MaterialInstance const* const mi = engine.getDefaultMaterial()->getDefaultInstance();
+
+        // the scene fills a cube of SCENE_EXTENT centered on the origin
+        std::default_random_engine gen; // NOLINT
+        std::uniform_real_distribution<float> rand(-SCENE_EXTENT, SCENE_EXTENT);
+
+        size_t const renderableCount = g_renderableCount;
+        size_t const lightCount = g_lightCount;
+        entities.resize(renderableCount + lightCount + 1);
+        em.create(entities.size(), entities.data());
+
+        for (size_t i = 0; i < renderableCount; i++) {
+            RenderableManager::Builder(1)
+                    .boundingBox({{ -1, -1, -1 }, { 1, 1, 1 }})
+                    .material(0, mi)
+                    .geometry(0, RenderableManager::PrimitiveType::TRIANGLES,
+                            vertexBuffer, indexBuffer, 0, 36)
+                    .castShadows(i < g_shadowCasterCount)
+                    .receiveShadows(true)
+                    .build(engine, entities[i]);
+            tcm.create(entities[i], {},
+                    mat4f::translation(float3{ rand(gen), rand(gen), rand(gen) }));
+        }
+
+        for (size_t i = 0; i < lightCount; i++) {
+            LightManager::Builder(LightManager::Type::POINT)
+                    .position({ rand(gen), rand(gen), rand(gen) })
+                    .falloff(SCENE_EXTENT * 0.25f)
+                    .intensity(10000.0f)
+                    .build(engine, entities[renderableCount + i]);
+        }
+
+        LightManager::Builder(LightManager::Type::SUN)
+                .direction({ 0.2f, -1.0f, -0.3f })
+                .castShadows(g_shadowCasterCount > 0)
+                .build(engine, entities.back());
+
+        scene.addEntities(entities.data(), entities.size());
+    }
+
+    void destroy(Engine& engine) {
+        for (Entity const e : entities) {
+            engine.destroy(e);
+        }
+        EntityManager::get().destroy(entities.size(), entities.data());
+        entities.clear();
+        engine.destroy(vertexBuffer);
+        engine.destroy(indexBuffer);
+    }
+
+    static constexpr float SCENE_EXTENT = 50.0f;
+};
+
+struct GltfScene {
+    NameComponentManager* names = nullptr;
+    MaterialProvider* materials = nullptr;
+    AssetLoader* assetLoader = nullptr;
+    ResourceLoader* resourceLoader = nullptr;
+    TextureProvider* stbDecoder = nullptr;
+    TextureProvider* ktxDecoder = nullptr;
+    FilamentAsset* asset = nullptr;
+    Entity sun;
+
+    bool create(Engine& engine, Scene& scene, Path const& filename) {
+        std::ifstream in(filename.c_str(), std::ifstream::binary | std::ifstream::ate);
+        if (!in) {
+            std::cerr << "Unable to open " << filename << std::endl;
+            return false;
+        }
+        std::vector<uint8_t> buffer(size_t(in.tellg()));
+        in.seekg(0);
+        if (!in.read((char*)buffer.data(), std::streamsize(buffer.size()))) {
+            std::cerr << "Unable to read " << filename << std::endl;
+            return false;
+        }
+
+        names = new NameComponentManager(EntityManager::get());
+        materials = createUbershaderProvider(&engine,
+                UBERARCHIVE_DEFAULT_DATA, UBERARCHIVE_DEFAULT_SIZE);
+        assetLoader = AssetLoader::create({ &engine, materials, names });
+        asset = assetLoader->createAsset(buffer.data(), uint32_t(buffer.size()));
+        if (!asset) {
+            std::cerr << "Unable to parse " << filename << std::endl;
+            return false;
+        }
+
+        std::string const gltfPath = filename.getAbsolutePath();
+        resourceLoader = new ResourceLoader({ &engine, gltfPath.c_str(), true });
+        stbDecoder = createStbProvider(&engine);
+        ktxDecoder = createKtx2Provider(&engine);
+        resourceLoader->addTextureProvider("image/png", stbDecoder);
+        resourceLoader->addTextureProvider("image/jpeg", stbDecoder);
+        resourceLoader->addTextureProvider("image/ktx2", ktxDecoder);
+        if (!resourceLoader->loadResources(asset)) {
+            std::cerr << "Unable to load resources for " << filename << std::endl;
+            return false;
+        }
+        asset->releaseSourceData();
+
+        scene.addEntities(asset->getEntities(), asset->getEntityCount());
+
+        // glTF doesn't always come with lights, make sure there is something to shadow
+        sun = EntityManager::get().create();
+        LightManager::Builder(LightManager::Type::SUN)
+                .direction({ 0.2f, -1.0f, -0.3f })
+                .castShadows(true)
+                .build(engine, sun);
+        scene.addEntity(sun);
+        return true;
+    }
+
+    // also releases what a failed create() left behind
+    void destroy(Engine& engine) {
+        if (!assetLoader) {
+            return;
+        }
+        if (sun) {
+            engine.destroy(sun);
+            EntityManager::get().destroy(sun);
+        }
+        if (asset) {
+            assetLoader->destroyAsset(asset);
+        }
+        delete resourceLoader;
+        delete stbDecoder;
+        delete ktxDecoder;
+        if (materials) {
+            materials->destroyMaterials();
+            delete materials;
+        }
+        AssetLoader::destroy(&assetLoader);
+        delete names;
+    }
+};
+
+// ------------------------------------------------------------------------------------------------
+
+struct Phase {
+    const char* name;
+    bool nested = false;         // part of the previous non-nested phase
+    std::vector<double> samples; // in ms
+
+    double mean() const noexcept {
+        double sum = 0;
+        for (double const s : samples) {
+            sum += s;
+        }
+        return samples.empty() ? 0.0 : sum / double(samples.size());
+    }
+
+    double percentile(double p) const {
+        if (samples.empty()) {
+            return 0.0;
+        }
+        std::vector<double> sorted(samples);
+        std::sort(sorted.begin(), sorted.end());
+        size_t const index = std::min(sorted.size() - 1, size_t(p * double(sorted.size())));
+        return sorted[index];
+    }
+};
+
+static void printResults(std::vector<Phase> const& phases, size_t skippedFrames) {
+    printf("%zu frames (%zu skipped), %ux%u\n", g_frameCount, skippedFrames, WIDTH, HEIGHT);
+    printf("%-16s %10s %10s %10s %10s\n", "phase [ms]", "mean", "median", "p95", "max");
+    for (Phase const& phase : phases) {
+        printf("%s%-*s %10.3f %10.3f %10.3f %10.3f\n",
+                phase.nested ? "  " : "", phase.nested ? 14 : 16, phase.name,
+                phase.mean(), phase.percentile(0.5), phase.percentile(0.95),
+                phase.percentile(1.0));
+    }
+}
+
+static bool writeJson(std::string const& path, std::vector<Phase> const& phases,
+        size_t skippedFrames) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "{\n";
+    out << "  \"frames\": " << g_frameCount << ",\n";
+    out << "  \"skippedFrames\": " << skippedFrames << ",\n";
+    out << "  \"renderables\": " << g_renderableCount << ",\n";
+    out << "  \"lights\": " << g_lightCount << ",\n";
+    out << "  \"shadowCasters\": " << g_shadowCasterCount << ",\n";
+    out << "  \"phases\": {\n";
+    for (size_t i = 0; i < phases.size(); i++) {
+        Phase const& phase = phases[i];
+        out << "    \"" << phase.name << "\": { "
+            << "\"mean\": " << phase.mean() << ", "
+            << "\"median\": " << phase.percentile(0.5) << ", "
+            << "\"p95\": " << phase.percentile(0.95) << ", "
+            << "\"max\": " << phase.percentile(1.0) << " }"
+            << (i + 1 < phases.size() ? ",\n" : "\n");
+    }
+    out << "  }\n";
+    out << "}\n";
+    return bool(out);
+}
+
+int main(int argc, char* argv[]) {
+    int const optionIndex = handleArguments(argc, argv);
+
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    SwapChain* swapChain = engine->createSwapChain(WIDTH, HEIGHT);
+    Renderer* renderer = engine->createRenderer();
+    Scene* scene = engine->createScene();
+    View* view = engine->createView();
+    Entity const cameraEntity = EntityManager::get().create();
+    Camera* camera = engine->createCamera(cameraEntity);
+
+    view->setScene(scene);
+    view->setCamera(camera);
+    view->setViewport({ 0, 0, WIDTH, HEIGHT });
+    view->setShadowingEnabled(true);
+    camera->setProjection(45.0, double(WIDTH) / HEIGHT, 0.1, 1000.0);
+
+    ProceduralScene procedural;
+    GltfScene gltf;
+
+    auto destroyAll = [&]() {
+        gltf.destroy(*engine);
+        procedural.destroy(*engine);
+        engine->destroyCameraComponent(cameraEntity);
+        EntityManager::get().destroy(cameraEntity);
+        engine->destroy(view);
+        engine->destroy(scene);
+        engine->destroy(renderer);
+        engine->destroy(swapChain);
+        Engine::destroy(&engine);
+    };
+
+    float3 center{};
+    float radius = ProceduralScene::SCENE_EXTENT * 2.0f;
+    if (optionIndex < argc) {
+        if (!gltf.create(*engine, *scene, Path(argv[optionIndex]))) {
+            destroyAll();
+            return 1;
+        }
+        Aabb const aabb = gltf.asset->getBoundingBox();
+        center = aabb.center();
+        radius = std::max(length(aabb.extent()) * 2.0f, 0.1f);
+    } else {
+        procedural.create(*engine, *scene);
+    }
+
+    enum {
+        BEGIN_FRAME, RENDER, PREPARE, CULLING, SHADOWS, FROXELIZATION, COMMANDS,
+        FRAME_GRAPH_COMPILE, FRAME_GRAPH_EXECUTE, END_FRAME, FLUSH, BACKEND, FRAME
+    };
+    std::vector<Phase> phases = {
+            { "beginFrame" },           // frame skipping, per-frame setup
+            { "render" },               // the nested phases below, and more
+            { "prepare", true },
+            { "culling", true },
+            { "shadows", true },
+            { "froxelize", true },      // runs concurrently with culling
+            { "commands", true },
+            { "fg.compile", true },
+            { "fg.execute", true },     // includes some of the command generation
+            { "endFrame" },             // gc and command buffer flush
+            { "flush", true },
+            { "backend" },              // noop backend executing the frame's commands
+            { "frame" },                // all of the above
+    };
+    for (Phase& phase : phases) {
+        phase.samples.reserve(g_frameCount);
+    }
+
+    size_t skippedFrames = 0;
+    size_t const totalFrameCount = g_warmupFrameCount + g_frameCount;
+    for (size_t i = 0; i < totalFrameCount; i++) {
+        // the camera orbits around the scene, once over the measured frames
+        float const t = float(i) / float(g_frameCount) * float(F_TAU);
+        float3 const eye = center + float3{ std::cos(t), 0.3f, std::sin(t) } * radius;
+        camera->lookAt(eye, center, { 0, 1, 0 });
+
+        Clock::time_point const t0 = Clock::now();
+        bool const rendered = renderer->beginFrame(swapChain);
+        Clock::time_point const t1 = Clock::now();
+        Clock::time_point t2 = t1;
+        Clock::time_point t3 = t1;
+        if (rendered) {
+            renderer->render(view);
+            t2 = Clock::now();
+            renderer->endFrame();
+            t3 = Clock::now();
+        }
+        engine->flushAndWait();
+        Clock::time_point const t4 = Clock::now();
+
+        if (i < g_warmupFrameCount) {
+            continue;
+        }
+        if (!rendered) {
+            skippedFrames++;
+            continue;
+        }
+        phases[BEGIN_FRAME].samples.push_back(Duration(t1 - t0).count());
+        phases[RENDER].samples.push_back(Duration(t2 - t1).count());
+        phases[END_FRAME].samples.push_back(Duration(t3 - t2).count());
+        phases[BACKEND].samples.push_back(Duration(t4 - t3).count());
+        phases[FRAME].samples.push_back(Duration(t4 - t0).count());
+
+        // breakdown measured by the Renderer itself, summed over all views
+        auto const history = renderer->getCpuFrameInfoHistory(1);
+        if (!history.empty()) {
+            Renderer::CpuFrameInfo const& info = history[0];
+            auto ms = [](Renderer::CpuFrameInfo::duration_ns ns) { return double(ns) * 1e-6; };
+            double breakdown[FRAME_GRAPH_EXECUTE - PREPARE + 1] = {};
+            for (size_t v = 0; v < info.viewCount; v++) {
+                Renderer::ViewCpuTimings const& timings = info.views[v];
+                breakdown[PREPARE - PREPARE] += ms(timings.prepare);
+                breakdown[CULLING - PREPARE] += ms(timings.culling);
+                breakdown[SHADOWS - PREPARE] += ms(timings.shadows);
+                breakdown[FROXELIZATION - PREPARE] += ms(timings.froxelization);
+                breakdown[COMMANDS - PREPARE] += ms(timings.commands);
+                breakdown[FRAME_GRAPH_COMPILE - PREPARE] += ms(timings.frameGraphCompile);
+                breakdown[FRAME_GRAPH_EXECUTE - PREPARE] += ms(timings.frameGraphExecute);
+            }
+            for (size_t p = PREPARE; p <= FRAME_GRAPH_EXECUTE; p++) {
+                phases[p].samples.push_back(breakdown[p - PREPARE]);
+            }
+            phases[FLUSH].samples.push_back(ms(info.flush));
+        }
+    }
+
+    printResults(phases, skippedFrames);
+
+    int result = 0;
+    if (!g_jsonPath.empty() && !writeJson(g_jsonPath, phases, skippedFrames)) {
+        std::cerr << "Unable to write " << g_jsonPath << std::endl;
+        result = 1;
+    }
+
+    destroyAll();
+    return result;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Reporter.h"
+
+#include <algorithm>
+#include <iostream>
+
+// Above this number of requests, a single bar shows the overall progress.
+static constexpr size_t MAX_PROGRESS_BARS = 16;
+
+Reporter::Reporter(size_t count, bool quiet)
+        : mCount(count), mQuiet(quiet), mStart(std::chrono::steady_clock::now()),
+          mProgress(count, 0.0f), mUpdater(count <= MAX_PROGRESS_BARS ? count : 1) {
+    if (!mQuiet) {
+        mUpdater.start();
+    }
+}
+
+void Reporter::progress(size_t index, float value) {
+    if (mQuiet || index >= mCount) {
+        return;
+    }
+    if (mCount <= MAX_PROGRESS_BARS) {
+        mUpdater.update(index, value);
+        return;
+    }
+    std::lock_guard<std::mutex> const lock(mLock);
+    mTotal += std::max(0.0f, value - mProgress[index]);
+    mProgress[index] = std::max(mProgress[index], value);
+    mUpdater.update(0, mTotal / float(mCount));
+}
+
+void Reporter::done(size_t index, bool success, std::string const& error) {
+    progress(index, 1.0f);
+    if (!success) {
+        std::lock_guard<std::mutex> const lock(mLock);
+        mErrors.push_back(error);
+    }
+}
+
+int Reporter::finish() {
+    if (!mQuiet) {
+        mUpdater.stop();
+    }
+    for (std::string const& error : mErrors) {
+        std::cerr << error << std::endl;
+    }
+    if (!mQuiet) {
+        std::chrono::duration<double> const duration = std::chrono::steady_clock::now() - mStart;
+        std::cout << "Baked " << (mCount - mErrors.size()) << " of " << mCount
+                  << " environment(s) in " << duration.count() << "s" << std::endl;
+    }
+    return mErrors.empty() ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_IBL_BAKER_REPORTER_H
+#define TNT_IBL_BAKER_REPORTER_H
+
+#include <iblbaker/ProgressUpdater.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+
+/**
+ * Shows the progress of a batch of bake requests, one bar per request or a single bar for the
+ * whole batch if it's large, and collects their errors. Thread safe.
+ */
+class Reporter {
+public:
+    Reporter(size_t count, bool quiet);
+
+    void progress(size_t index, float value);
+
+    void done(size_t index, bool success, std::string const& error);
+
+    //! Stops the progress bars, prints the errors and a summary, and returns the exit code
+    int finish();
+
+private:
+    size_t mCount;
+    bool mQuiet;
+    std::chrono::steady_clock::time_point mStart;
+    std::mutex mLock;
+    std::vector<float> mProgress;
+    float mTotal = 0.0f;
+    std::vector<std::string> mErrors;
+    filament::iblbaker::ProgressUpdater mUpdater;
+};
+
+#endif // TNT_IBL_BAKER_REPORTER_H
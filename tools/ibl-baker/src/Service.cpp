@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Service.h"
+
+#include "Reporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(WIN32)
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace filament::iblbaker;
+using namespace utils;
+
+#if !defined(WIN32)
+
+static bool writeAll(int fd, std::string const& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        // MSG_NOSIGNAL doesn't exist on Apple platforms, both ends ignore SIGPIPE instead
+        ssize_t const n = send(fd, data.data() + offset, data.size() - offset, 0);
+        if (n <= 0) {
+            return false;
+        }
+        offset += size_t(n);
+    }
+    return true;
+}
+
+// Reads a socket line by line.
+class LineReader {
+public:
+    explicit LineReader(int fd) : mFd(fd) {}
+
+    bool read(std::string& line) {
+        while (true) {
+            size_t const end = mBuffer.find('\n');
+            if (end != std::string::npos) {
+                line = mBuffer.substr(0, end);
+                mBuffer.erase(0, end + 1);
+                return true;
+            }
+            char data[4096];
+            ssize_t const n = recv(mFd, data, sizeof(data), 0);
+            if (n <= 0) {
+                return false;
+            }
+            mBuffer.append(data, size_t(n));
+        }
+    }
+
+private:
+    int mFd;
+    std::string mBuffer;
+};
+
+static std::string serialize(IBLBaker::Request const& request) {
+    std::ostringstream out;
+    out << "input " << request.input.getPath() << "\n"
+        << "output " << request.outputDirectory.getPath() << "\n"
+        << "size " << request.size << "\n"
+        << "min-lod-size " << request.minLodSize << "\n"
+        << "samples " << request.sampleCount << "\n"
+        << "prefilter " << request.prefilter << "\n"
+        << "mirror " << request.mirror << "\n"
+        << "clamp " << request.clamp << "\n"
+        << "skybox " << request.skybox << "\n"
+        << "dfg " << request.dfg.getPath() << "\n"
+        << "dfg-multiscatter " << request.dfgMultiscatter << "\n"
+        << "dfg-cloth " << request.dfgCloth << "\n"
+        << "end\n";
+    return out.str();
+}
+
+// Returns false if the line is not a valid field.
+static bool deserialize(IBLBaker::Request& request, std::string const& line) {
+    size_t const space = line.find(' ');
+    std::string const key = line.substr(0, space);
+    std::string const value = space == std::string::npos ? "" : line.substr(space + 1);
+    char* end = nullptr;
+    unsigned long const number = strtoul(value.c_str(), &end, 10);
+    bool const isNumber = !value.empty() && *end == '\0';
+    if (key == "input") {
+        request.input = value;
+    } else if (key == "output") {
+        request.outputDirectory = value;
+    } else if (key == "dfg") {
+        request.dfg = value;
+    } else if (!isNumber) {
+        return false;
+    } else if (key == "size") {
+        request.size = number;
+    } else if (key == "min-lod-size") {
+        request.minLodSize = number;
+    } else if (key == "samples") {
+        request.sampleCount = number;
+    } else if (key == "prefilter") {
+        request.prefilter = number != 0;
+    } else if (key == "mirror") {
+        request.mirror = number != 0;
+    } else if (key == "clamp") {
+        request.clamp = number != 0;
+    } else if (key == "skybox") {
+        request.skybox = number != 0;
+    } else if (key == "dfg-multiscatter") {
+        request.dfgMultiscatter = number != 0;
+    } else if (key == "dfg-cloth") {
+        request.dfgCloth = number != 0;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// The requests of a client. It's kept alive by the callbacks of its pending requests.
+class Connection {
+public:
+    explicit Connection(int fd) : mFd(fd) {}
+    ~Connection() { close(mFd); }
+
+    int getFd() const noexcept { return mFd; }
+
+    void send(std::string const& message) {
+        std::lock_guard<std::mutex> const lock(mLock);
+        writeAll(mFd, message);
+    }
+
+    // Only sends significant progress, to keep the traffic low.
+    void progress(size_t index, float value) {
+        std::lock_guard<std::mutex> const lock(mLock);
+        if (mProgress.size() <= index) {
+            mProgress.resize(index + 1, 0.0f);
+        }
+        if (value - mProgress[index] >= 0.01f) {
+            mProgress[index] = value;
+            writeAll(mFd, "progress " + std::to_string(index) + " " + std::to_string(value) + "\n");
+        }
+    }
+
+private:
+    int mFd;
+    std::mutex mLock;
+    std::vector<float> mProgress;
+};
+
+static void serveConnection(IBLBaker& baker, std::shared_ptr<Connection> connection) {
+    LineReader reader(connection->getFd());
+    IBLBaker::Request request;
+    std::string error;
+    std::string line;
+    size_t index = 0;
+    while (reader.read(line)) {
+        if (line != "end") {
+            if (!deserialize(request, line) && error.empty()) {
+                error = "invalid field: " + line;
+            }
+            continue;
+        }
+        if (!error.empty()) {
+            connection->send("failed " + std::to_string(index) + " " + error + "\n");
+        } else {
+            baker.submit(std::move(request),
+                    [connection, index](IBLBaker::Id, IBLBaker::Result const& result) {
+                        std::string message = result.error;
+                        std::replace(message.begin(), message.end(), '\n', ' ');
+                        connection->send(result.success ?
+                                "done " + std::to_string(index) + "\n" :
+                                "failed " + std::to_string(index) + " " + message + "\n");
+                    },
+                    [connection, index](IBLBaker::Id, IBLBaker::Stage, float value) {
+                        connection->progress(index, value);
+                    });
+        }
+        request = {};
+        error.clear();
+        index++;
+    }
+    // the connection is closed once the callbacks of its last request have run
+}
+
+static int createSocket(std::string const& path, sockaddr_un& address) {
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "The socket path is too long: " << path << std::endl;
+        return -1;
+    }
+    address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    int const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "Unable to create a socket" << std::endl;
+    }
+    return fd;
+}
+
+int serve(std::string const& path, size_t concurrency, bool quiet) {
+    sockaddr_un address;
+    int const fd = createSocket(path, address);
+    if (fd < 0) {
+        return 1;
+    }
+    // a previous service may have left its socket behind, but never remove anything else
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode) || unlink(path.c_str()) != 0) {
+            std::cerr << path << " already exists and is not a stale socket" << std::endl;
+            close(fd);
+            return 1;
+        }
+    }
+    if (bind(fd, (sockaddr const*) &address, sizeof(address)) != 0 || listen(fd, 16) != 0) {
+        std::cerr << "Unable to listen on " << path << std::endl;
+        close(fd);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    IBLBaker baker(IBLBaker::Config{ .concurrency = concurrency });
+    if (!quiet) {
+        std::cout << "Listening on " << path << ", baking " << baker.getConcurrency()
+                  << " environment(s) at a time" << std::endl;
+    }
+    std::chrono::milliseconds backoff{ 0 };
+    while (true) {
+        int const client = accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            switch (errno) {
+                case EINTR:
+                case ECONNABORTED:
+                    // the client went away or we were interrupted, just try again
+                    continue;
+                case EMFILE:
+                case ENFILE:
+                case ENOBUFS:
+                case ENOMEM:
+                    // out of resources, give the running connections a chance to finish
+                    backoff = std::clamp(backoff * 2,
+                            std::chrono::milliseconds{ 10 }, std::chrono::milliseconds{ 1000 });
+                    std::this_thread::sleep_for(backoff);
+                    continue;
+                default:
+                    std::cerr << "Unable to accept connections: " << strerror(errno) << std::endl;
+                    close(fd);
+                    return 1;
+            }
+        }
+        backoff = {};
+        std::thread(serveConnection, std::ref(baker), std::make_shared<Connection>(client))
+                .detach();
+    }
+}
+
+int sendRequests(std::string const& path, std::vector<IBLBaker::Request> const& requests,
+        bool quiet) {
+    sockaddr_un address;
+    int const fd = createSocket(path, address);
+    if (fd < 0) {
+        return 1;
+    }
+    if (connect(fd, (sockaddr const*) &address, sizeof(address)) != 0) {
+        std::cerr << "Unable to connect to the service on " << path << std::endl;
+        close(fd);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    std::string message;
+    for (IBLBaker::Request const& request : requests) {
+        message += serialize(request);
+    }
+    if (!writeAll(fd, message)) {
+        std::cerr << "Unable to send the requests" << std::endl;
+        close(fd);
+        return 1;
+    }
+    shutdown(fd, SHUT_WR);
+
+    Reporter reporter(requests.size(), quiet);
+    LineReader reader(fd);
+    std::string line;
+    size_t remaining = requests.size();
+    while (remaining && reader.read(line)) {
+        std::istringstream in(line);
+        std::string type;
+        size_t index = 0;
+        in >> type >> index;
+        if (index >= requests.size()) {
+            continue;
+        }
+        if (type == "progress") {
+            float value = 0.0f;
+            in >> value;
+            reporter.progress(index, value);
+        } else if (type == "done" || type == "failed") {
+            std::string error;
+            std::getline(in >> std::ws, error);
+            reporter.done(index, type == "done", requests[index].input.getPath() + ": " + error);
+            remaining--;
+        }
+    }
+    close(fd);
+    int const result = reporter.finish();
+    if (remaining) {
+        std::cerr << "The service closed the connection with " << remaining
+                  << " request(s) pending" << std::endl;
+        return 1;
+    }
+    return result;
+}
+
+#else
+
+int serve(std::string const&, size_t, bool) {
+    std::cerr << "The service is not supported on this platform." << std::endl;
+    return 1;
+}
+
+int sendRequests(std::string const&, std::vector<IBLBaker::Request> const&, bool) {
+    std::cerr << "The service is not supported on this platform." << std::endl;
+    return 1;
+}
+
+#endif
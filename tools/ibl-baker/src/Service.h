@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_IBL_BAKER_SERVICE_H
+#define TNT_IBL_BAKER_SERVICE_H
+
+#include <iblbaker/IBLBaker.h>
+
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+
+/*
+ * The baking service listens on a Unix socket, and bakes the requests of any number of clients
+ * with a single IBLBaker.
+ *
+ * The protocol is line based. A client sends requests as blocks of "key value" lines, each block
+ * terminated by an "end" line, then shuts down its side of the connection. The service answers
+ * with "progress <index> <value>", "done <index>" and "failed <index> <error>" lines, where
+ * <index> is the index of the request in the connection. All paths are absolute.
+ */
+
+//! Runs the service until the process is killed, returns only on error
+int serve(std::string const& path, size_t concurrency, bool quiet);
+
+//! Sends requests to the service and shows their progress, returns the exit code of the tool
+int sendRequests(std::string const& path,
+        std::vector<filament::iblbaker::IBLBaker::Request> const& requests, bool quiet);
+
+#endif // TNT_IBL_BAKER_SERVICE_H
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Reporter.h"
+#include "Service.h"
+
+#include <iblbaker/IBLBaker.h>
+
+#include <utils/Path.h>
+
+#include <getopt/getopt.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace filament::iblbaker;
+using namespace utils;
+
+static IBLBaker::Request g_request;
+static bool g_quiet = false;
+static size_t g_concurrency = 0;
+static std::string g_serve;
+static std::string g_socket;
+
+static void printUsage(char* name) {
+    std::string execName(Path(name).getName());
+    std::string usage(
+            "IBLBAKER bakes many environments into IBLs, keeping its worker threads and lookup\n"
+            "tables warm between them. Each environment produces the same files as\n"
+            "`cmgen --deploy=<dir> --format=ktx <input>`: <name>_ibl.ktx and <name>_skybox.ktx.\n"
+            "\n"
+            "Usages:\n"
+            "    IBLBAKER [options] --deploy=<dir> <input-file>...\n"
+            "        bakes the environments in this process\n"
+            "    IBLBAKER [options] --serve=<socket>\n"
+            "        starts a baking service listening on the Unix socket <socket>\n"
+            "    IBLBAKER [options] --socket=<socket> --deploy=<dir> <input-file>...\n"
+            "        sends the environments to the service listening on <socket>\n"
+            "\n"
+            "Options:\n"
+            "   --help, -h\n"
+            "       Print this message\n\n"
+            "   --license\n"
+            "       Print copyright and license information\n\n"
+            "   --quiet, -q\n"
+            "       Quiet mode. Suppress all non-error output\n\n"
+            "   --deploy=dir, -x dir\n"
+            "       Output directory\n\n"
+            "   --size=power-of-two, -s power-of-two\n"
+            "       Size of the reflections cubemap and skybox (default: 256)\n\n"
+            "   --ibl-min-lod-size=power-of-two\n"
+            "       Size of the smallest level of the reflections cubemap (default: 16)\n\n"
+            "   --ibl-samples=numSamples\n"
+            "       Number of samples to use for IBL integrations (default 1024)\n\n"
+            "   --ibl-no-prefilter\n"
+            "       Use importance sampling instead of prefiltered importance sampling\n\n"
+            "   --ibl-dfg=filename.[exr|hdr|psd|png|rgbm|rgb32f|dds]\n"
+            "       Also compute the IBL DFG LUT\n\n"
+            "   --ibl-dfg-multiscatter\n"
+            "       If --ibl-dfg is set, computes the DFG for multi-scattering GGX\n\n"
+            "   --ibl-dfg-cloth\n"
+            "       If --ibl-dfg is set, adds a 3rd channel to the DFG for cloth shading\n\n"
+            "   --clamp\n"
+            "       Clamp environment before processing\n\n"
+            "   --no-mirror\n"
+            "       Skip mirroring of generated cubemaps (for assets with mirroring already baked in)\n\n"
+            "   --no-skybox\n"
+            "       Don't write the skyboxes\n\n"
+            "   --jobs=N, -j N\n"
+            "       Number of environments baked at the same time, by this process or the service\n\n"
+    );
+    const std::string from("IBLBAKER");
+    for (size_t pos = usage.find(from); pos != std::string::npos; pos = usage.find(from, pos)) {
+        usage.replace(pos, from.length(), execName);
+    }
+    printf("%s", usage.c_str());
+}
+
+static void license() {
+    static const char *license[] = {
+        #include "licenses/licenses.inc"
+        nullptr
+    };
+
+    const char **p = &license[0];
+    while (*p)
+        std::cout << *p++ << std::endl;
+}
+
+static int handleArguments(int argc, char* argv[]) {
+    static constexpr const char* OPTSTR = "hqx:s:j:";
+    static const struct option OPTIONS[] = {
+            { "help",                       no_argument, nullptr, 'h' },
+            { "license",                    no_argument, nullptr, 'l' },
+            { "quiet",                      no_argument, nullptr, 'q' },
+            { "deploy",               required_argument, nullptr, 'x' },
+            { "size",                 required_argument, nullptr, 's' },
+            { "ibl-min-lod-size",     required_argument, nullptr, 'S' },
+            { "ibl-samples",          required_argument, nullptr, 'k' },
+            { "ibl-no-prefilter",           no_argument, nullptr, 'n' },
+            { "ibl-dfg",              required_argument, nullptr, 'a' },
+            { "ibl-dfg-multiscatter",       no_argument, nullptr, 'u' },
+            { "ibl-dfg-cloth",              no_argument, nullptr, 'C' },
+            { "clamp",                      no_argument, nullptr, 'K' },
+            { "no-mirror",                  no_argument, nullptr, 'm' },
+            { "no-skybox",                  no_argument, nullptr, 'B' },
+            { "jobs",                 required_argument, nullptr, 'j' },
+            { "serve",                required_argument, nullptr, 'V' },
+            { "socket",               required_argument, nullptr, 'O' },
+            { nullptr, 0, nullptr, 0 }  // termination of the option list
+    };
+    int opt;
+    int optionIndex = 0;
+    while ((opt = getopt_long(argc, argv, OPTSTR, OPTIONS, &optionIndex)) >= 0) {
+        std::string arg(optarg ? optarg : "");
+        switch (opt) {
+            default:
+            case 'h':
+                printUsage(argv[0]);
+                exit(0);
+            case 'l':
+                license();
+                exit(0);
+            case 'q':
+                g_quiet = true;
+                break;
+            case 'x':
+                g_request.outputDirectory = arg;
+                break;
+            case 's':
+                g_request.size = std::stoul(arg);
+                break;
+            case 'S':
+                g_request.minLodSize = std::stoul(arg);
+                break;
+            case 'k':
+                g_request.sampleCount = std::stoul(arg);
+                break;
+            case 'n':
+                g_request.prefilter = false;
+                break;
+            case 'a':
+                g_request.dfg = arg;
+                break;
+            case 'u':
+                g_request.dfgMultiscatter = true;
+                break;
+            case 'C':
+                g_request.dfgCloth = true;
+                break;
+            case 'K':
+                g_request.clamp = true;
+                break;
+            case 'm':
+                g_request.mirror = false;
+                break;
+            case 'B':
+                g_request.skybox = false;
+                break;
+            case 'j':
+                g_concurrency = std::stoul(arg);
+                break;
+            case 'V':
+                g_serve = arg;
+                break;
+            case 'O':
+                g_socket = arg;
+                break;
+        }
+    }
+    return optind;
+}
+
+static std::vector<IBLBaker::Request> createRequests(int argc, char* argv[], int optionIndex) {
+    std::vector<IBLBaker::Request> requests;
+    for (int i = optionIndex; i < argc; i++) {
+        IBLBaker::Request request = g_request;
+        request.input = Path(argv[i]).getAbsolutePath();
+        request.outputDirectory = g_request.outputDirectory.getAbsolutePath();
+        // the DFG LUT only needs to be written once
+        if (i > optionIndex) {
+            request.dfg = {};
+        }
+        requests.push_back(std::move(request));
+    }
+    if (requests.empty() && !g_request.dfg.isEmpty()) {
+        requests.push_back(g_request);
+    }
+    if (!requests.empty() && !requests[0].dfg.isEmpty()) {
+        requests[0].dfg = requests[0].dfg.getAbsolutePath();
+    }
+    return requests;
+}
+
+static int bakeLocally(std::vector<IBLBaker::Request> requests) {
+    IBLBaker baker(IBLBaker::Config{ .concurrency = g_concurrency });
+    Reporter reporter(requests.size(), g_quiet);
+    for (IBLBaker::Request& request : requests) {
+        baker.submit(std::move(request),
+                [&reporter](IBLBaker::Id id, IBLBaker::Result const& result) {
+                    reporter.done(id, result.success, result.error);
+                },
+                [&reporter](IBLBaker::Id id, IBLBaker::Stage, float value) {
+                    reporter.progress(id, value);
+                });
+    }
+    baker.waitForAll();
+    return reporter.finish();
+}
+
+int main(int argc, char* argv[]) {
+    int optionIndex = handleArguments(argc, argv);
+
+    if (!g_serve.empty()) {
+        return serve(g_serve, g_concurrency, g_quiet);
+    }
+
+    if (g_request.outputDirectory.isEmpty() && optionIndex < argc) {
+        std::cerr << "An output directory must be specified with --deploy." << std::endl;
+        return 1;
+    }
+    std::vector<IBLBaker::Request> requests = createRequests(argc, argv, optionIndex);
+    if (requests.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (!g_socket.empty()) {
+        return sendRequests(g_socket, requests, g_quiet);
+    }
+    return bakeLocally(std::move(requests));
+}
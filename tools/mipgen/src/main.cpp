@@ -19,23 +19,33 @@
 #include <image/ImageSampler.h>
 #include <image/Ktx1Bundle.h>
 #include <image/LinearImage.h>
+#include <image/ScanlineStream.h>
 
 #include <imageio/BasisEncoder.h>
 #include <imageio/ImageDecoder.h>
 #include <imageio/ImageEncoder.h>
 
+#include <toolcache/ContentCache.h>
+
+#include <utils/JobSystem.h>
 #include <utils/Path.h>
 
 #include <getopt/getopt.h>
 
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 using namespace image;
 using namespace std;
 using namespace utils;
 
+using filament::toolcache::ContentCache;
+
 enum KtxCompression {
     NONE,
     UASTC,
@@ -58,6 +68,14 @@ static bool g_ktx2Container = false;
 static bool g_sourceIsLinear = false;
 static bool g_quietMode = false;
 static uint32_t g_mipLevelCount = 0;
+static bool g_streaming = false;
+static Path g_cacheDir = ContentCache::getDefaultDirectory();
+
+// Files written by this run, the only ones stored in the cache.
+static vector<Path> g_outputFiles;
+
+// Upper bound of the number of miplevels of an image.
+static constexpr uint32_t MAX_MIP_LEVEL_COUNT = 32;
 
 static const char* USAGE = R"TXT(
 MIPGEN generates mipmaps for an image down to the 1x1 level.
@@ -96,6 +114,13 @@ Options:
    --mip-levels=N, -m N
        specifies the number of mip levels to generate
        if 0 (default), all levels are generated
+   --streaming, -S
+       process the image a few rows at a time, for images too large to fit in memory
+       the source is read once and all levels are written as they are generated
+       only PNG and HDR sources are decoded incrementally; not supported with KTX2
+   --cache=dir
+       reuse the outputs of a previous identical run stored in the cache <dir>,
+       or store them there; defaults to $FILAMENT_TOOL_CACHE if set
    --compression=COMPRESSION, -c COMPRESSION
        format specific compression:
            KTX, PNG, Radiance: Ignored
@@ -108,6 +133,7 @@ Examples:
     MIPGEN -g --kernel=hermite grassland.png mip_%03d.png
     MIPGEN -f ktx2 --compression=uastc grassland.png mips.ktx
     MIPGEN -f ktx grassland.png mips.ktx
+    MIPGEN --streaming --kernel=box terrain_32k.png mip_%02d.png
 )TXT";
 
 static const char* HTML_PREFIX = R"HTML(<!DOCTYPE html>
@@ -151,7 +177,7 @@ static void license() {
 }
 
 static int handleArguments(int argc, char* argv[]) {
-    static constexpr const char* OPTSTR = "hLlgpf:c:k:saqm:";
+    static constexpr const char* OPTSTR = "hLlgpf:c:k:saqm:SX:";
     static const struct option OPTIONS[] = {
             { "help",                 no_argument, 0, 'h' },
             { "license",              no_argument, 0, 'L' },
@@ -165,6 +191,8 @@ static int handleArguments(int argc, char* argv[]) {
             { "add-alpha",            no_argument, 0, 'a' },
             { "quiet",                no_argument, 0, 'q' },
             { "mip-levels",     required_argument, 0, 'm' },
+            { "streaming",            no_argument, 0, 'S' },
+            { "cache",          required_argument, 0, 'X' },
             { 0, 0, 0, 0 }  // termination of the option list
     };
 
@@ -259,42 +287,20 @@ static int handleArguments(int argc, char* argv[]) {
                     // keep default value
                 }
                 break;
+            case 'S':
+                g_streaming = true;
+                break;
+            case 'X':
+                g_cacheDir = arg;
+                break;
         }
     }
 
     return optind;
 }
 
-int main(int argc, char* argv[]) {
-    int optionIndex = handleArguments(argc, argv);
-    int numArgs = argc - optionIndex;
-    if (numArgs < 2) {
-        printUsage(argv[0]);
-        return 1;
-    }
-    Path inputPath(argv[optionIndex++]);
-    std::string outputPattern(argv[optionIndex]);
-    if (Path(outputPattern).getExtension() == "ktx") {
-        g_ktx1Container = true;
-        g_formatSpecified = true;
-    } else if (Path(outputPattern).getExtension() == "ktx2") {
-        g_ktx2Container = true;
-        g_formatSpecified = true;
-    } else if (!g_formatSpecified) {
-        g_format = ImageEncoder::chooseFormat(outputPattern, g_sourceIsLinear);
-    }
-
-    if (!g_quietMode) {
-        puts("Reading image...");
-    }
-
-    ifstream inputStream(inputPath.getPath(), ios::binary);
-    LinearImage sourceImage = ImageDecoder::decode(inputStream, inputPath.getPath(),
-            g_sourceIsLinear ? ImageDecoder::ColorSpace::LINEAR : ImageDecoder::ColorSpace::SRGB);
-    if (!sourceImage.isValid()) {
-        cerr << "Unable to open image: " << inputPath.getPath() << endl;
-        return 1;
-    }
+// Applies the channel transformations requested on the command line to the source image.
+static LinearImage prepareSource(LinearImage sourceImage) {
     if (g_stripAlpha && sourceImage.getChannels() == 4) {
         auto r = extractChannel(sourceImage, 0);
         auto g = extractChannel(sourceImage, 1);
@@ -316,6 +322,363 @@ int main(int argc, char* argv[]) {
     if (g_filter == Filter::GAUSSIAN_NORMALS) {
         sourceImage = colorsToVectors(sourceImage);
     }
+    return sourceImage;
+}
+
+static uint32_t getPreparedChannelCount(uint32_t channels) {
+    if (g_stripAlpha && channels == 4) {
+        channels = 3;
+    }
+    if (g_addAlpha && channels == 3) {
+        channels = 4;
+    }
+    return g_grayscale ? 1 : channels;
+}
+
+// Sets up the header of a KTX1 bundle holding 8-bit versions of the miplevels.
+static bool initKtx1Info(Ktx1Bundle& container, uint32_t width, uint32_t height,
+        size_t componentCount, bool* destIsLinear) {
+    auto& info = container.info();
+    info = {
+        .endianness = Ktx1Bundle::ENDIAN_DEFAULT,
+        .glType = Ktx1Bundle::UNSIGNED_BYTE,
+        .glTypeSize = 1,
+        .pixelWidth = width,
+        .pixelHeight = height,
+        .pixelDepth = 0,
+    };
+
+    // Try to choose an internal format that has the same transformation function as the
+    // source format. This varible may be adjusted later, after the destination format has
+    // been resolved.
+    *destIsLinear = g_sourceIsLinear;
+
+    if (componentCount == 1) {
+        info.glFormat = info.glBaseInternalFormat = Ktx1Bundle::RED;
+        info.glInternalFormat = Ktx1Bundle::R8;
+        *destIsLinear = true;
+    } else if (componentCount == 3) {
+        info.glFormat = info.glBaseInternalFormat = Ktx1Bundle::RGB;
+        info.glInternalFormat = *destIsLinear ? Ktx1Bundle::RGB8 : Ktx1Bundle::SRGB8;
+    } else if (componentCount == 4) {
+        info.glFormat = info.glBaseInternalFormat = Ktx1Bundle::RGBA;
+        info.glInternalFormat = *destIsLinear ? Ktx1Bundle::RGBA8 : Ktx1Bundle::SRGB8_ALPHA8;
+    } else {
+        cerr << "Bad component count." << endl;
+        return false;
+    }
+    if (g_ktxCompression != NONE) {
+        cerr << "Compression not supported with KTX1." << endl;
+        return false;
+    }
+    return true;
+}
+
+// Converts a miplevel, or some of its rows, to the 8-bit pixels stored in a KTX1 bundle.
+static std::unique_ptr<uint8_t[]> toKtx1Pixels(LinearImage image, bool destIsLinear,
+        size_t componentCount) {
+    if (g_filter == Filter::GAUSSIAN_NORMALS) {
+        image = vectorsToColors(image);
+    }
+    if (g_grayscale && destIsLinear) {
+        return fromLinearToGrayscale<uint8_t>(image);
+    } else if (g_grayscale) {
+        return fromLinearTosRGB<uint8_t, 1>(image);
+    } else if (destIsLinear) {
+        if (componentCount == 3) {
+            return fromLinearToRGB<uint8_t, 3>(image);
+        }
+        return fromLinearToRGB<uint8_t, 4>(image);
+    }
+    if (componentCount == 3) {
+        return fromLinearTosRGB<uint8_t, 3>(image);
+    }
+    return fromLinearTosRGB<uint8_t, 4>(image);
+}
+
+static ofstream openOutput(const std::string& path, ios::openmode mode) {
+    g_outputFiles.emplace_back(path);
+    return ofstream(path, mode);
+}
+
+static int writeGallery(const Path& inputPath, const std::string& outputPattern,
+        uint32_t width, uint32_t height, uint32_t count) {
+    if (!g_quietMode) {
+        puts("Generating mipmaps.html...");
+    }
+
+    char path[256];
+    char tag[256];
+    const char* pattern = R"(<image src="%s" width="%dpx" height="%dpx">)";
+    ofstream html = openOutput("mipmaps.html", ios::trunc);
+    html << HTML_PREFIX;
+    int result = snprintf(tag, sizeof(tag), pattern, inputPath.c_str(), width, height);
+    if (result < 0 || result >= sizeof(tag)) {
+        cerr << "Output pattern is too long." << endl;
+        return 1;
+    }
+    html << tag << std::endl;
+    for (uint32_t mip = 1; mip <= count; mip++) {
+        snprintf(path, sizeof(path), outputPattern.c_str(), mip);
+        result = snprintf(tag, sizeof(tag), pattern, path, width, height);
+        if (result < 0 || result >= sizeof(tag)) {
+            cerr << "Output pattern is too long." << endl;
+            return 1;
+        }
+        html << tag << std::endl;
+    }
+    html << HTML_SUFFIX;
+    return 0;
+}
+
+// Applies a transformation to the rows of another reader, a band at a time.
+class TransformReader : public ScanlineReader {
+public:
+    using Transform = std::function<LinearImage(LinearImage)>;
+
+    TransformReader(std::unique_ptr<ScanlineReader> source, uint32_t channels, Transform fn)
+            : ScanlineReader(source->getWidth(), source->getHeight(), channels),
+              mSource(std::move(source)), mTransform(std::move(fn)) {
+    }
+
+private:
+    bool readRows(float* rows, uint32_t count) override {
+        LinearImage band(getWidth(), count, mSource->getChannels());
+        if (!mSource->read(band.getPixelRef(), count)) {
+            return false;
+        }
+        band = mTransform(band);
+        memcpy(rows, band.getPixelRef(), sizeof(float) * getWidth() * getChannels() * count);
+        return true;
+    }
+
+    std::unique_ptr<ScanlineReader> mSource;
+    Transform mTransform;
+};
+
+// Copies the rows of a reader to a writer as they are read.
+class TeeReader : public ScanlineReader {
+public:
+    TeeReader(ScanlineReader& source, ScanlineWriter& copy)
+            : ScanlineReader(source.getWidth(), source.getHeight(), source.getChannels()),
+              mSource(source), mCopy(copy) {
+    }
+
+private:
+    bool readRows(float* rows, uint32_t count) override {
+        return mSource.read(rows, count) && mCopy.write(rows, count);
+    }
+
+    ScanlineReader& mSource;
+    ScanlineWriter& mCopy;
+};
+
+// Applies a transformation to rows before handing them to another writer.
+class TransformWriter : public ScanlineWriter {
+public:
+    using Transform = std::function<LinearImage(LinearImage)>;
+
+    TransformWriter(std::unique_ptr<ScanlineWriter> target, Transform fn)
+            : ScanlineWriter(target->getWidth(), target->getHeight(), target->getChannels()),
+              mTarget(std::move(target)), mTransform(std::move(fn)) {
+    }
+
+private:
+    bool writeRows(float const* rows, uint32_t count) override {
+        LinearImage band(getWidth(), count, getChannels());
+        memcpy(band.getPixelRef(), rows, sizeof(float) * getWidth() * getChannels() * count);
+        band = mTransform(band);
+        return mTarget->write(band.getPixelRef(), count);
+    }
+
+    std::unique_ptr<ScanlineWriter> mTarget;
+    Transform mTransform;
+};
+
+// Quantizes the rows of a miplevel and stores them into a KTX1 bundle.
+class Ktx1LevelWriter : public ScanlineWriter {
+public:
+    Ktx1LevelWriter(Ktx1Bundle& container, uint32_t level, uint32_t width, uint32_t height,
+            uint32_t channels, bool destIsLinear)
+            : ScanlineWriter(width, height, channels),
+              mContainer(container), mLevel(level), mDestIsLinear(destIsLinear) {
+        mPixels.reserve(size_t(width) * height * channels);
+    }
+
+private:
+    bool writeRows(float const* rows, uint32_t count) override {
+        LinearImage band(getWidth(), count, getChannels());
+        memcpy(band.getPixelRef(), rows, sizeof(float) * getWidth() * getChannels() * count);
+        std::unique_ptr<uint8_t[]> data = toKtx1Pixels(band, mDestIsLinear, getChannels());
+        size_t const size = size_t(getWidth()) * count * getChannels();
+        mPixels.insert(mPixels.end(), data.get(), data.get() + size);
+        if (count == getRemainingRows()) {
+            return mContainer.setBlob({ mLevel, 0, 0 }, mPixels.data(), mPixels.size());
+        }
+        return true;
+    }
+
+    Ktx1Bundle& mContainer;
+    uint32_t mLevel;
+    bool mDestIsLinear;
+    std::vector<uint8_t> mPixels;
+};
+
+// Generates the miplevels without ever holding a whole image in floating point: the source is
+// decoded a band of rows at a time, and each level is written as its rows are produced.
+static int streamMipmaps(const Path& inputPath, const std::string& outputPattern) {
+    if (g_ktx2Container) {
+        cerr << "KTX2 output is not supported in streaming mode." << endl;
+        return 1;
+    }
+
+    ifstream inputStream(inputPath.getPath(), ios::binary);
+    std::unique_ptr<ScanlineReader> input = ImageDecoder::createReader(inputStream,
+            inputPath.getPath(),
+            g_sourceIsLinear ? ImageDecoder::ColorSpace::LINEAR : ImageDecoder::ColorSpace::SRGB);
+    if (!input) {
+        cerr << "Unable to open image: " << inputPath.getPath() << endl;
+        return 1;
+    }
+    uint32_t const width = input->getWidth();
+    uint32_t const height = input->getHeight();
+    uint32_t const channels = getPreparedChannelCount(input->getChannels());
+    TransformReader source(std::move(input), channels, prepareSource);
+
+    uint32_t count = getMipmapCount(width, height);
+    count = g_mipLevelCount == 0 ? count : min(g_mipLevelCount - 1, count);
+
+    if (!g_quietMode) {
+        puts("Generating miplevels...");
+    }
+
+    std::vector<std::unique_ptr<ofstream>> outputStreams;
+    std::vector<std::unique_ptr<ScanlineWriter>> writers;
+    std::vector<ScanlineWriter*> levels;
+    uint32_t w = width;
+    uint32_t h = height;
+
+    if (g_ktx1Container) {
+        Ktx1Bundle container(1 + count, 1, false);
+        bool destIsLinear;
+        if (!initKtx1Info(container, width, height, channels, &destIsLinear)) {
+            return 1;
+        }
+        Ktx1LevelWriter baseLevel(container, 0, width, height, channels, destIsLinear);
+        for (uint32_t mip = 1; mip <= count; mip++) {
+            w = std::max(w >> 1u, 1u);
+            h = std::max(h >> 1u, 1u);
+            writers.emplace_back(new Ktx1LevelWriter(container, mip, w, h, channels,
+                    destIsLinear));
+            levels.push_back(writers.back().get());
+        }
+        TeeReader reader(source, baseLevel);
+        if (!generateMipmaps(reader, g_filter, levels.data(), count)) {
+            cerr << "An error occurred while generating the miplevels." << endl;
+            return 1;
+        }
+
+        if (!g_quietMode) {
+            puts("Writing KTX file to disk...");
+        }
+        vector<uint8_t> fileContents(container.getSerializedLength());
+        container.serialize(fileContents.data(), fileContents.size());
+        Path(outputPattern).getParent().mkdirRecursive();
+        ofstream outputStream = openOutput(outputPattern, ios::out | ios::binary);
+        outputStream.write((const char*) fileContents.data(), fileContents.size());
+        outputStream.close();
+        if (!g_quietMode) {
+            puts("Done.");
+        }
+        return 0;
+    }
+
+    char path[256];
+    for (uint32_t mip = 1; mip <= count; mip++) {
+        w = std::max(w >> 1u, 1u);
+        h = std::max(h >> 1u, 1u);
+        int result = snprintf(path, sizeof(path), outputPattern.c_str(), mip);
+        if (result < 0 || result >= sizeof(path)) {
+            cerr << "Output pattern is too long." << endl;
+            return 1;
+        }
+        Path(path).getParent().mkdirRecursive();
+        outputStreams.push_back(make_unique<ofstream>(openOutput(path, ios::binary | ios::trunc)));
+        if (!*outputStreams.back()) {
+            cerr << "The output file cannot be opened: " << path << endl;
+            return 1;
+        }
+        std::unique_ptr<ScanlineWriter> writer = ImageEncoder::createWriter(
+                *outputStreams.back(), g_format, w, h, channels, g_compressionString, path);
+        if (!writer) {
+            cerr << "An error occurred while encoding the image." << endl;
+            return 1;
+        }
+        if (g_filter == Filter::GAUSSIAN_NORMALS) {
+            writer.reset(new TransformWriter(std::move(writer), vectorsToColors));
+        }
+        writers.push_back(std::move(writer));
+        levels.push_back(writers.back().get());
+    }
+
+    if (!generateMipmaps(source, g_filter, levels.data(), count)) {
+        cerr << "An error occurred while generating the miplevels." << endl;
+        return 1;
+    }
+    for (auto& outputStream : outputStreams) {
+        outputStream->close();
+        if (!*outputStream) {
+            cerr << "An error occurred while writing the output files." << endl;
+            return 1;
+        }
+    }
+
+    if (g_createGallery && writeGallery(inputPath, outputPattern, width, height, count)) {
+        return 1;
+    }
+
+    if (!g_quietMode) {
+        puts("Done.");
+    }
+    return 0;
+}
+
+// The possible outputs are listed file by file, only the ones this run wrote are stored, see
+// openOutput().
+static ContentCache::Outputs getCacheOutputs(const std::string& outputPattern) {
+    std::vector<Path> locations;
+    if (g_ktx1Container || g_ktx2Container) {
+        locations.emplace_back(outputPattern);
+    } else {
+        char path[256];
+        for (uint32_t mip = 1; mip <= MAX_MIP_LEVEL_COUNT; mip++) {
+            int result = snprintf(path, sizeof(path), outputPattern.c_str(), mip);
+            locations.emplace_back(result < 0 || result >= sizeof(path) ? "" : path);
+        }
+    }
+    if (g_createGallery) {
+        locations.emplace_back("mipmaps.html");
+    }
+    return ContentCache::Outputs(std::move(locations));
+}
+
+static int generate(const Path& inputPath, const std::string& outputPattern) {
+    if (g_streaming) {
+        return streamMipmaps(inputPath, outputPattern);
+    }
+
+    if (!g_quietMode) {
+        puts("Reading image...");
+    }
+
+    ifstream inputStream(inputPath.getPath(), ios::binary);
+    LinearImage sourceImage = ImageDecoder::decode(inputStream, inputPath.getPath(),
+            g_sourceIsLinear ? ImageDecoder::ColorSpace::LINEAR : ImageDecoder::ColorSpace::SRGB);
+    if (!sourceImage.isValid()) {
+        cerr << "Unable to open image: " << inputPath.getPath() << endl;
+        return 1;
+    }
+    sourceImage = prepareSource(sourceImage);
 
     if (!g_quietMode) {
         puts("Generating miplevels...");
@@ -324,7 +687,12 @@ int main(int argc, char* argv[]) {
     uint32_t count = getMipmapCount(sourceImage);
     count = g_mipLevelCount == 0 ? count : min(g_mipLevelCount - 1, count);
     vector<LinearImage> miplevels(count);
-    generateMipmaps(sourceImage, g_filter, miplevels.data(), count);
+    {
+        JobSystem js;
+        js.adopt();
+        generateMipmaps(js, sourceImage, g_filter, miplevels.data(), count);
+        js.emancipate();
+    }
 
     if (g_ktx1Container) {
         if (!g_quietMode) {
@@ -335,63 +703,15 @@ int main(int argc, char* argv[]) {
         // which might make sense when generating individual files, but for a KTX
         // bundle, we want to include level 0, so add 1 to the KTX level count.
         Ktx1Bundle container(1 + miplevels.size(), 1, false);
-        auto& info = container.info();
-        info = {
-            .endianness = Ktx1Bundle::ENDIAN_DEFAULT,
-            .glType = Ktx1Bundle::UNSIGNED_BYTE,
-            .glTypeSize = 1,
-            .pixelWidth = sourceImage.getWidth(),
-            .pixelHeight = sourceImage.getHeight(),
-            .pixelDepth = 0,
-        };
         size_t componentCount = sourceImage.getChannels();
-
-        // Try to choose an internal format that has the same transformation function as the
-        // source format. This varible may be adjusted later, after the destination format has
-        // been resolved.
-        bool destIsLinear = g_sourceIsLinear;
-
-        if (componentCount == 1) {
-            info.glFormat = info.glBaseInternalFormat = Ktx1Bundle::RED;
-            info.glInternalFormat = Ktx1Bundle::R8;
-            destIsLinear = true;
-        } else if (componentCount == 3) {
-            info.glFormat = info.glBaseInternalFormat = Ktx1Bundle::RGB;
-            info.glInternalFormat = destIsLinear ? Ktx1Bundle::RGB8 : Ktx1Bundle::SRGB8;
-        } else if (componentCount == 4) {
-            info.glFormat = info.glBaseInternalFormat = Ktx1Bundle::RGBA;
-            info.glInternalFormat = destIsLinear ? Ktx1Bundle::RGBA8 : Ktx1Bundle::SRGB8_ALPHA8;
-        } else {
-            cerr << "Bad component count." << endl;
-            return 1;
-        }
-        if (g_ktxCompression != NONE) {
-            cerr << "Compression not supported with KTX1." << endl;
+        bool destIsLinear;
+        if (!initKtx1Info(container, sourceImage.getWidth(), sourceImage.getHeight(),
+                componentCount, &destIsLinear)) {
             return 1;
         }
         uint32_t mip = 0;
         auto addLevel = [&](LinearImage image) {
-            if (g_filter == Filter::GAUSSIAN_NORMALS) {
-                image = vectorsToColors(image);
-            }
-            std::unique_ptr<uint8_t[]> data;
-            if (g_grayscale && destIsLinear) {
-                data = fromLinearToGrayscale<uint8_t>(image);
-            } else if (g_grayscale) {
-                data = fromLinearTosRGB<uint8_t, 1>(image);
-            } else if (destIsLinear) {
-                if (componentCount == 3) {
-                    data = fromLinearToRGB<uint8_t, 3>(image);
-                } else {
-                    data = fromLinearToRGB<uint8_t, 4>(image);
-                }
-            } else {
-                if (componentCount == 3) {
-                    data = fromLinearTosRGB<uint8_t, 3>(image);
-                } else {
-                    data = fromLinearTosRGB<uint8_t, 4>(image);
-                }
-            }
+            std::unique_ptr<uint8_t[]> data = toKtx1Pixels(image, destIsLinear, componentCount);
             container.setBlob({mip++, 0, 0}, data.get(), image.getWidth() * image.getHeight() *
                     container.info().glTypeSize * componentCount);
         };
@@ -402,7 +722,7 @@ int main(int argc, char* argv[]) {
         vector<uint8_t> fileContents(container.getSerializedLength());
         container.serialize(fileContents.data(), fileContents.size());
         Path(outputPattern).getParent().mkdirRecursive();
-        ofstream outputStream(outputPattern, ios::out | ios::binary);
+        ofstream outputStream = openOutput(outputPattern, ios::out | ios::binary);
         outputStream.write((const char*) fileContents.data(), fileContents.size());
         outputStream.close();
         if (!g_quietMode) {
@@ -446,7 +766,7 @@ int main(int argc, char* argv[]) {
         }
 
         Path(outputPattern).getParent().mkdirRecursive();
-        ofstream outputStream(outputPattern, ios::out | ios::binary);
+        ofstream outputStream = openOutput(outputPattern, ios::out | ios::binary);
         outputStream.write((const char*) encoder->getKtx2Data(), encoder->getKtx2ByteCount());
         outputStream.close();
         if (!g_quietMode) {
@@ -469,7 +789,7 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         Path(path).getParent().mkdirRecursive();
-        ofstream outputStream(path, ios::binary | ios::trunc);
+        ofstream outputStream = openOutput(path, ios::binary | ios::trunc);
         if (!outputStream) {
             cerr << "The output file cannot be opened: " << path << endl;
         } else {
@@ -488,37 +808,91 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    if (g_createGallery) {
+    if (g_createGallery && writeGallery(inputPath, outputPattern, sourceImage.getWidth(),
+            sourceImage.getHeight(), miplevels.size())) {
+        return 1;
+    }
+
+    if (!g_quietMode) {
+        puts("Done.");
+    }    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int optionIndex = handleArguments(argc, argv);
+    int numArgs = argc - optionIndex;
+    if (numArgs < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    Path inputPath(argv[optionIndex++]);
+    std::string outputPattern(argv[optionIndex]);
+    if (Path(outputPattern).getExtension() == "ktx") {
+        g_ktx1Container = true;
+        g_formatSpecified = true;
+    } else if (Path(outputPattern).getExtension() == "ktx2") {
+        g_ktx2Container = true;
+        g_formatSpecified = true;
+    } else if (!g_formatSpecified) {
+        g_format = ImageEncoder::chooseFormat(outputPattern, g_sourceIsLinear);
+    }
+
+    if (g_cacheDir.isEmpty()) {
+        return generate(inputPath, outputPattern);
+    }
+
+    std::string const& version = ContentCache::getExecutableVersion();
+    if (version.empty()) {
+        cerr << "Unable to read the mipgen executable, the cache is not used." << endl;
+        return generate(inputPath, outputPattern);
+    }
+
+    // The outputs and the HTML page depend on the names of the files, but not on their location
+    // unless the page is generated.
+    ContentCache::Key key("mipgen", version);
+    if (!key.addFile("input", inputPath)) {
+        cerr << "Unable to open image: " << inputPath.getPath() << endl;
+        return 1;
+    }
+    key.add("output", g_createGallery ? outputPattern : Path(outputPattern).getName())
+        .add("input-name", g_createGallery ? inputPath.getPath() : inputPath.getName())
+        .add("format", int(g_format))
+        .add("ktx", g_ktx1Container)
+        .add("ktx2", g_ktx2Container)
+        .add("compression", g_compressionString)
+        .add("kernel", int(g_filter))
+        .add("linear", g_sourceIsLinear)
+        .add("grayscale", g_grayscale)
+        .add("add-alpha", g_addAlpha)
+        .add("strip-alpha", g_stripAlpha)
+        .add("page", g_createGallery)
+        .add("mip-levels", g_mipLevelCount)
+        .add("streaming", g_streaming);
+
+    ContentCache cache(g_cacheDir);
+    ContentCache::Outputs outputs = getCacheOutputs(outputPattern);
+    size_t count = 0;
+    if (cache.fetch(key, outputs, nullptr, &count)) {
         if (!g_quietMode) {
-            puts("Generating mipmaps.html...");
+            printf("Cache hit: restored %zu file(s) from entry %s\n", count,
+                    key.getDigest().c_str());
         }
+        return 0;
+    }
 
-        char tag[256];
-        mip = 1;
-        const char* pattern = R"(<image src="%s" width="%dpx" height="%dpx">)";
-        const uint32_t width = sourceImage.getWidth();
-        const uint32_t height = sourceImage.getHeight();
-        ofstream html("mipmaps.html", ios::trunc);
-        html << HTML_PREFIX;
-        int result = snprintf(tag, sizeof(tag), pattern, inputPath.c_str(), width, height);
-        if (result < 0 || result >= sizeof(tag)) {
-            cerr << "Output pattern is too long." << endl;
-            return 1;
+    int result = generate(inputPath, outputPattern);
+    if (result == 0) {
+        for (Path const& file : g_outputFiles) {
+            outputs.add(file);
         }
-        html << tag << std::endl;
-        for (auto image: miplevels) {
-            snprintf(path, sizeof(path), outputPattern.c_str(), mip++);
-            result = snprintf(tag, sizeof(tag), pattern, path, width, height);
-            if (result < 0 || result >= sizeof(tag)) {
-                cerr << "Output pattern is too long." << endl;
-                return 1;
+        if (cache.store(key, outputs, {}, &count)) {
+            if (!g_quietMode) {
+                printf("Cache miss: stored %zu file(s) in entry %s\n", count,
+                        key.getDigest().c_str());
             }
-            html << tag << std::endl;
+        } else {
+            cerr << "Unable to store the outputs in the cache " << g_cacheDir << endl;
         }
-        html << HTML_SUFFIX;
-    }
-
-    if (!g_quietMode) {
-        puts("Done.");
     }
+    return result;
 }
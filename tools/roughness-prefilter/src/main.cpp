@@ -15,10 +15,13 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include <math/vec3.h>
 
@@ -30,6 +33,8 @@
 #include <imageio/ImageDecoder.h>
 #include <imageio/ImageEncoder.h>
 
+#include <toolcache/ContentCache.h>
+
 #include <utils/JobSystem.h>
 #include <utils/Path.h>
 
@@ -39,6 +44,8 @@ using namespace filament::math;
 using namespace image;
 using namespace utils;
 
+using filament::toolcache::ContentCache;
+
 static ImageEncoder::Format g_format = ImageEncoder::Format::PNG_LINEAR;
 static bool g_formatSpecified = false;
 static bool g_ktxContainer = false;
@@ -48,6 +55,16 @@ static std::string g_compression;
 static Path g_roughnessMap;
 static float g_roughness = 0.0;
 
+static Path g_cacheDir = ContentCache::getDefaultDirectory();
+
+// Files written by this run, the only ones stored in the cache. Mip levels are written from
+// jobs, hence the lock.
+static std::vector<Path> g_outputFiles;
+static std::mutex g_outputFilesLock;
+
+// Upper bound of the number of miplevels of an image.
+static constexpr size_t MAX_MIP_LEVEL_COUNT = 32;
+
 static void printUsage(const char* name) {
     std::string execName(Path(name).getName());
     std::string usage(
@@ -86,6 +103,9 @@ static void printUsage(const char* name) {
             "           DDS: 8, 16 (default), 32\n\n"
             "   --linear, -l\n"
             "       force linear output when the PNG format is selected\n\n"
+            "   --cache=dir\n"
+            "       reuse the outputs of a previous identical run stored in the cache <dir>,\n"
+            "       or store them there; defaults to $FILAMENT_TOOL_CACHE if set\n\n"
     );
 
     const std::string from("ROUGHNESSPREFILTER");
@@ -107,7 +127,7 @@ static void license() {
 }
 
 static int handleArguments(int argc, char* argv[]) {
-    static constexpr const char* OPTSTR = "hr:c:f:m:l";
+    static constexpr const char* OPTSTR = "hr:c:f:m:lX:";
     static const struct option OPTIONS[] = {
             { "help",                 no_argument, nullptr, 'h' },
             { "license",              no_argument, nullptr, 's' },
@@ -116,6 +136,7 @@ static int handleArguments(int argc, char* argv[]) {
             { "roughness",      required_argument, nullptr, 'r' },
             { "roughness-map",  required_argument, nullptr, 'm' },
             { "linear",               no_argument, nullptr, 'l' },
+            { "cache",          required_argument, nullptr, 'X' },
             { nullptr, 0, nullptr, 0 }  // termination of the option list
     };
 
@@ -180,6 +201,9 @@ static int handleArguments(int argc, char* argv[]) {
             case 'l':
                 g_linearOutput = true;
                 break;
+            case 'X':
+                g_cacheDir = arg;
+                break;
         }
     }
 
@@ -267,6 +291,37 @@ void prefilter(const LinearImage& normal, const LinearImage& roughness, const si
     }
 }
 
+static Path getMipLevelPath(const Path& outputMap, size_t level) {
+    const std::string ext = outputMap.getExtension();
+    const std::string name = outputMap.getNameWithoutExtension();
+    return Path(outputMap.getParent()).concat(
+            name + "_" + std::to_string(level) + "." + ext); // NOLINT
+}
+
+// The possible outputs are listed file by file, only the ones this run wrote are stored, see
+// openOutput().
+static ContentCache::Outputs getCacheOutputs(const Path& outputMap) {
+    std::vector<Path> locations;
+    if (g_ktxContainer) {
+        locations.push_back(outputMap);
+    } else {
+        for (size_t i = 0; i < MAX_MIP_LEVEL_COUNT; i++) {
+            locations.push_back(getMipLevelPath(outputMap, i));
+        }
+    }
+    return ContentCache::Outputs(std::move(locations));
+}
+
+static std::ofstream openOutput(const Path& path, std::ios::openmode mode) {
+    {
+        std::lock_guard<std::mutex> lock(g_outputFilesLock);
+        g_outputFiles.push_back(path);
+    }
+    return std::ofstream(path, mode);
+}
+
+static int generate(const Path& normalMap, const Path& outputMap);
+
 int main(int argc, char* argv[]) {
     int optionIndex = handleArguments(argc, argv);
 
@@ -279,6 +334,58 @@ int main(int argc, char* argv[]) {
     Path normalMap(argv[optionIndex    ]);
     Path outputMap(argv[optionIndex + 1]);
 
+    if (g_cacheDir.isEmpty()) {
+        return generate(normalMap, outputMap);
+    }
+
+    std::string const& version = ContentCache::getExecutableVersion();
+    if (version.empty()) {
+        std::cerr << "Unable to read the roughness-prefilter executable, the cache is not used." << std::endl;
+        return generate(normalMap, outputMap);
+    }
+
+    ContentCache::Key key("roughness-prefilter", version);
+    if (!key.addFile("normal-map", normalMap)) {
+        std::cerr << "The input normal map does not exist: " << normalMap << std::endl;
+        return 1;
+    }
+    if (!g_roughnessMap.isEmpty() && !key.addFile("roughness-map", g_roughnessMap)) {
+        std::cerr << "The input roughness map does not exist: " << g_roughnessMap << std::endl;
+        return 1;
+    }
+    key.add("output", outputMap.getName())
+        .add("roughness", g_roughness)
+        .add("format", int(g_format))
+        .add("format-specified", g_formatSpecified)
+        .add("ktx", g_ktxContainer)
+        .add("linear", g_linearOutput)
+        .add("compression", g_compression);
+
+    ContentCache cache(g_cacheDir);
+    ContentCache::Outputs outputs = getCacheOutputs(outputMap);
+    size_t count = 0;
+    if (cache.fetch(key, outputs, nullptr, &count)) {
+        std::cout << "Cache hit: restored " << count << " file(s) from entry "
+                  << key.getDigest() << std::endl;
+        return 0;
+    }
+
+    int result = generate(normalMap, outputMap);
+    if (result == 0) {
+        for (Path const& file : g_outputFiles) {
+            outputs.add(file);
+        }
+        if (cache.store(key, outputs, {}, &count)) {
+            std::cout << "Cache miss: stored " << count << " file(s) in entry "
+                      << key.getDigest() << std::endl;
+        } else {
+            std::cerr << "Unable to store the outputs in the cache " << g_cacheDir << std::endl;
+        }
+    }
+    return result;
+}
+
+static int generate(const Path& normalMap, const Path& outputMap) {
     if (!normalMap.exists()) {
         std::cerr << "The input normal map does not exist: " << normalMap << std::endl;
         exit(1);
@@ -354,15 +461,16 @@ int main(int argc, char* argv[]) {
     const size_t height = hasRoughnessMap ? roughnessImage.getHeight() : normalImage.getHeight();
     const size_t mipLevels = size_t(std::log2f(width)) + 1;
 
+    JobSystem js;
+    js.adopt();
+
     if (hasRoughnessMap) {
         mipImages.resize(mipLevels);
         mipImages[0] = roughnessImage;
-        image::generateMipmaps(roughnessImage, image::Filter::BOX, &mipImages[1], mipLevels - 1);
+        image::generateMipmaps(js, roughnessImage, image::Filter::BOX,
+                &mipImages[1], mipLevels - 1);
     }
 
-    JobSystem js;
-    js.adopt();
-
     // For thread safety, we allocate each KTX blob now, before invoking the job system.
     image::Ktx1Bundle bundle(mipLevels, 1, false);
     if (g_ktxContainer) {
@@ -382,10 +490,11 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    std::atomic<bool> failed = false;
     JobSystem::Job* parent = js.createJob();
     for (size_t i = 0; i < mipLevels; i++) {
         JobSystem::Job* mip = jobs::createJob(js, parent, [&bundle, &normalImage, &mipImages,
-                outputMap, i, width, height, hasRoughnessMap]() {
+                &failed, outputMap, i, width, height, hasRoughnessMap]() {
             const size_t w = width >> i;
             const size_t h = height >> i;
 
@@ -421,14 +530,12 @@ int main(int argc, char* argv[]) {
                 return;
             }
 
-            const std::string ext = outputMap.getExtension();
-            const std::string name = outputMap.getNameWithoutExtension();
-            Path out = Path(outputMap.getParent()).concat(
-                    name + "_" + std::to_string(i) + "." + ext); // NOLINT
+            Path out = getMipLevelPath(outputMap, i);
 
-            std::ofstream outputStream(out, std::ios::binary | std::ios::trunc);
+            std::ofstream outputStream = openOutput(out, std::ios::binary | std::ios::trunc);
             if (!outputStream.good()) {
                 std::cerr << "The output file cannot be opened: " << out << std::endl;
+                failed = true;
                 return;
             }
             ImageEncoder::encode(outputStream, g_format, image, g_compression, out.getPath());
@@ -436,6 +543,7 @@ int main(int argc, char* argv[]) {
             if (!outputStream.good()) {
                 std::cerr << "An error occurred while writing the output file: " << out <<
                         std::endl;
+                failed = true;
             }
         });
         js.run(mip);
@@ -446,8 +554,11 @@ int main(int argc, char* argv[]) {
         using namespace std;
         vector<uint8_t> fileContents(bundle.getSerializedLength());
         bundle.serialize(fileContents.data(), fileContents.size());
-        ofstream outputStream(outputMap.c_str(), ios::out | ios::binary);
+        ofstream outputStream = openOutput(outputMap, ios::out | ios::binary);
         outputStream.write((const char*) fileContents.data(), fileContents.size());
         outputStream.close();
+        failed = failed || !outputStream;
     }
+
+    return failed ? 1 : 0;
 }
@@ -398,6 +398,10 @@ class_<Engine>("Engine")
 
     .function("isAutomaticInstancingEnabled", &Engine::isAutomaticInstancingEnabled)
 
+    .function("setMultiDrawIndirectEnabled", &Engine::setMultiDrawIndirectEnabled)
+
+    .function("isMultiDrawIndirectEnabled", &Engine::isMultiDrawIndirectEnabled)
+
     .function("getSupportedFeatureLevel", &Engine::getSupportedFeatureLevel)
 
     .function("setActiveFeatureLevel", &Engine::setActiveFeatureLevel)